@@ -18,7 +18,7 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 
 ovrOpenGLExtensions extensionsOpenGL;
 
-#if defined( ANDROID )
+#if defined( ANDROID ) || defined( OVR_GL_HOST_SHIM )
 
 PFNGLDISCARDFRAMEBUFFEREXTPROC glDiscardFramebufferEXT_;
 
@@ -213,7 +213,7 @@ static void LogStringWords( const char * allExtensions )
 
 void * GetExtensionProc( const char * functionName )
 {
-#if defined( ANDROID )
+#if defined( ANDROID ) || defined( OVR_GL_HOST_SHIM )
 	void * ptr = (void *)eglGetProcAddress( functionName );
 #elif defined( WIN32 ) || defined( WIN64 ) || defined( _WIN32 ) || defined( _WIN64 )
 	void * ptr = (void *)wglGetProcAddress( functionName );
@@ -246,7 +246,7 @@ void GL_InitExtensions()
 	LOG( "GL_EXTENSIONS:" );
 	LogStringWords( extensions );
 
-#if defined( ANDROID )
+#if defined( ANDROID ) || defined( OVR_GL_HOST_SHIM )
 	const bool es3 = ( strncmp( (const char *)glGetString( GL_VERSION ), "OpenGL ES 3", 11 ) == 0 );
 	LOG( "es3 = %s", es3 ? "TRUE" : "FALSE" );
 
@@ -477,7 +477,7 @@ void GL_InitExtensions()
 #endif
 }
 
-#if defined( ANDROID )
+#if defined( ANDROID ) || defined( OVR_GL_HOST_SHIM )
 EGLConfig EglConfigForConfigID( const EGLDisplay display, const GLint configID )
 {
 	static const int MAX_CONFIGS = 1024;
@@ -521,7 +521,7 @@ bool GL_ExtensionStringPresent( const char * extension, const char * allExtensio
 	}
 }
 
-#if defined( ANDROID )
+#if defined( ANDROID ) || defined( OVR_GL_HOST_SHIM )
 EGLint GL_FlushSync( int timeout )
 {
 	// if extension not present, return NO_SYNC
@@ -563,7 +563,7 @@ void GL_InvalidateFramebuffer( const invalidateTarget_t isFBO, const bool colorB
 
 void GL_Finish()
 {
-#if defined( ANDROID )
+#if defined( ANDROID ) || defined( OVR_GL_HOST_SHIM )
 	// Given the common driver "optimization" of ignoring glFinish, we
 	// can't run reliably while drawing to the front buffer without
 	// the Sync extension.
@@ -587,7 +587,7 @@ void GL_Finish()
 
 void GL_Flush()
 {
-#if defined( ANDROID )
+#if defined( ANDROID ) || defined( OVR_GL_HOST_SHIM )
 	if ( eglCreateSyncKHR_ != NULL )
 	{
 		const EGLint wait = GL_FlushSync( 0 );
@@ -607,7 +607,7 @@ void GL_Flush()
 
 const char * GL_GetErrorString()
 {
-#if defined( ANDROID )
+#if defined( ANDROID ) || defined( OVR_GL_HOST_SHIM )
 	const EGLint err = eglGetError();
 	switch( err )
 	{
@@ -29,7 +29,9 @@ struct ovrOpenGLExtensions
 
 extern ovrOpenGLExtensions extensionsOpenGL;
 
-#if defined( ANDROID )	// FIXME: Use OVR_Types defines when used consistently
+// The host benches in Tools/ define OVR_GL_HOST_SHIM to use the same GLES3 function
+// pointer table as Android. No driver is loaded there: the table is filled by ovrGlRecorder.
+#if defined( ANDROID ) || defined( OVR_GL_HOST_SHIM )	// FIXME: Use OVR_Types defines when used consistently
 
 #define OVR_HAS_OPENGL_LOADER
 #if defined( OVR_HAS_OPENGL_LOADER )
@@ -62,11 +64,13 @@ extern ovrOpenGLExtensions extensionsOpenGL;
 #endif
 
 // We need to detect the API level because Google tweaked some of the GL headers in version 21+
+#if defined( ANDROID )
 #include <android/api-level.h>
 #if __ANDROID_API__ < 21
 typedef khronos_int64_t GLint64;
 typedef khronos_uint64_t GLuint64;
 #endif
+#endif
 
 #if !defined( GL_EXT_multisampled_render_to_texture )
 typedef void (GL_APIENTRY* PFNGLRENDERBUFFERSTORAGEMULTISAMPLEEXTPROC) (GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height);
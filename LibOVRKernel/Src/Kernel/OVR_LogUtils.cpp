@@ -86,6 +86,14 @@ void LogWithTag( const int prio, const char * tag, const char * fmt, ... )
 	va_end( args );
 
 	OutputDebugString( buffer );
+#elif defined( OVR_OS_LINUX )
+	OVR_UNUSED( prio );
+	va_list args;
+	va_start( args, fmt );
+	fprintf( stderr, "%s: ", tag );
+	vfprintf( stderr, fmt, args );
+	fprintf( stderr, "\n" );
+	va_end( args );
 #else
 #error "Not implemented"
 #endif
@@ -155,6 +163,14 @@ void LogWithFileTag( const int prio, const char * fileTag, const char * fmt, ...
 
 	OutputDebugString( buffer );
 	OutputDebugString( "\n" );
+#elif defined( OVR_OS_LINUX )
+	OVR_UNUSED( prio );
+	OVR_UNUSED( fileTag );
+	va_list args;
+	va_start( args, fmt );
+	vfprintf( stderr, fmt, args );
+	fprintf( stderr, "\n" );
+	va_end( args );
 #else
 #error "Not implemented"
 #endif
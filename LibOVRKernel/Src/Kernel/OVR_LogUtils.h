@@ -20,7 +20,7 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 #include <time.h>
 #include <stdint.h>
 
-#if defined( OVR_OS_WIN32 )		// allow this file to be included in PC projects
+#if defined( OVR_OS_WIN32 ) || ( defined( OVR_OS_LINUX ) && !defined( OVR_OS_ANDROID ) )		// allow this file to be included in PC and Linux host projects
 
 // stub common functions for non-Android platforms
 // TODO: Review latest Desktop LibOVRKernel for new cross-platform variants of these
@@ -0,0 +1,57 @@
+/************************************************************************************
+
+Filename    :   BenchCommon.h
+Content     :   Timing and random number helpers shared by the host benches.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#if !defined( OVR_BenchCommon_h )
+#define OVR_BenchCommon_h
+
+#include <stdint.h>
+#include <time.h>
+
+namespace OVR {
+
+// Monotonic wall clock.
+inline double GetSeconds()
+{
+	struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return (double)now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// CPU time of the calling thread, without the time other threads preempted it.
+inline double GetThreadSeconds()
+{
+	struct timespec now;
+	clock_gettime( CLOCK_THREAD_CPUTIME_ID, &now );
+	return (double)now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// Deterministic, so every run builds the same data on every host.
+inline uint32_t Random( uint32_t & seed )
+{
+	seed = seed * 1664525u + 1013904223u;
+	return seed >> 8;
+}
+
+// In [0, 1).
+inline float RandomFloat( uint32_t & seed )
+{
+	return ( Random( seed ) & 0xFFFF ) * ( 1.0f / 65536.0f );
+}
+
+// In [minValue, maxValue].
+inline float RandomFloat( uint32_t & seed, const float minValue, const float maxValue )
+{
+	return minValue + ( maxValue - minValue ) * ( Random( seed ) & 0xFFFF ) * ( 1.0f / 65535.0f );
+}
+
+} // namespace OVR
+
+#endif // OVR_BenchCommon_h
@@ -0,0 +1,136 @@
+# Build rules shared by the host benches in Tools/. A bench Makefile sets
+# BENCH_NAME and the sources it tests, then includes this file:
+#
+#   BENCH_NAME        the bench directory and executable name
+#   BENCH_GL          1 to run GL code against ovrGlRecorder instead of a driver
+#   BENCH_ZIP         1 to build minizip and link zlib
+#   VRLIB_SRC_FILES   VrAppFramework sources
+#   MODEL_SRC_FILES   VrModel sources
+#   LOCALE_SRC_FILES  VrLocale sources
+#   TOOLS_SRC_FILES   converter sources
+#   C_SRC_FILES       C sources, like the stb codecs
+#
+# All of them are compiled unchanged. Extra targets go after the include; the
+# bench adds its own lines to help with another help:: rule.
+
+help::
+	@echo Usage....
+	@echo "make help           - displays this text"
+	@echo "make clean          - delete intermediate files"
+	@echo "make all -j20       - build $(BENCH_NAME)"
+	@echo "make run -j20       - build and run $(BENCH_NAME)"
+	@echo "make run_debug -j20 - build and run inside debugger"
+
+
+HOST_OS          = $(shell uname -s | tr \'[:upper:]\' \'[:lower:]\')
+HOST_ARCH        = $(shell uname -m | tr \'[:upper:]\' \'[:lower:]\')
+HOST_PLATFORM    = $(HOST_OS)_$(HOST_ARCH)
+
+BRANCH_ROOT      = $(realpath ../..)
+PROJECT_ROOT     = $(BRANCH_ROOT)/Tools/$(BENCH_NAME)
+COMMON_ROOT      = $(BRANCH_ROOT)/Tools/BenchCommon
+KERNEL_ROOT      = $(BRANCH_ROOT)/LibOVRKernel/Src
+VRLIB_ROOT       = $(BRANCH_ROOT)/VrAppFramework
+MODEL_ROOT       = $(BRANCH_ROOT)/VrAppSupport/VrModel
+LOCALE_ROOT      = $(BRANCH_ROOT)/VrAppSupport/VrLocale
+LOADER_ROOT      = $(BRANCH_ROOT)/1stParty/OpenGL_Loader
+MINIZIP_ROOT     = $(BRANCH_ROOT)/3rdParty/minizip/src
+STB_ROOT         = $(BRANCH_ROOT)/3rdParty/stb/src
+
+BIN_ROOT         = $(PROJECT_ROOT)/bin/$(HOST_PLATFORM)
+OBJ_ROOT         = $(PROJECT_ROOT)/obj/$(HOST_PLATFORM)
+OUT_PATH         = $(BIN_ROOT)/$(BENCH_NAME)
+
+KERNEL_SRC_FILES = $(addprefix $(KERNEL_ROOT)/Kernel/, \
+                   OVR_Alg.cpp \
+                   OVR_Allocator.cpp \
+                   OVR_Atomic.cpp \
+                   OVR_BinaryFile.cpp \
+                   OVR_File.cpp \
+                   OVR_FileFILE.cpp \
+                   OVR_Geometry.cpp \
+                   OVR_JSON.cpp \
+                   OVR_Log.cpp \
+                   OVR_LogUtils.cpp \
+                   OVR_MappedFile.cpp \
+                   OVR_Math.cpp \
+                   OVR_MemBuffer.cpp \
+                   OVR_RefCount.cpp \
+                   OVR_Std.cpp \
+                   OVR_String.cpp \
+                   OVR_String_FormatUtil.cpp \
+                   OVR_String_PathUtil.cpp \
+                   OVR_SysFile.cpp \
+                   OVR_System.cpp \
+                   OVR_ThreadsPthread.cpp \
+                   OVR_UTF8Util.cpp )
+
+INCLUDES         = -I$(KERNEL_ROOT) -I$(COMMON_ROOT) -I$(VRLIB_ROOT)/Include -I$(VRLIB_ROOT)/Src -I$(MODEL_ROOT)/Src \
+                   -I$(LOCALE_ROOT)/Include -I$(LOCALE_ROOT)/Src -I$(LOADER_ROOT)/Include -I$(BRANCH_ROOT)/VrApi/Include \
+                   -I$(MINIZIP_ROOT) -I$(STB_ROOT)
+# OVR_GL_HOST_SHIM selects the Android GLES3 headers and function pointer table
+# in OVR_GlUtils.h, which the framework headers need even without BENCH_GL.
+CXXFLAGS         = -std=c++11 -O2 -g -DNDEBUG -DOVR_GL_HOST_SHIM -MMD -MP $(INCLUDES)
+CFLAGS           = -O2 -g -DNDEBUG -MMD -MP -DNOCRYPT -DNOUNCRYPT
+LIBS             = -ldl -lpthread
+
+# The GL function pointers are filled in by ovrGlRecorder instead of a driver.
+ifeq ($(BENCH_GL),1)
+KERNEL_SRC_FILES += $(KERNEL_ROOT)/Kernel/OVR_GlUtils.cpp
+GL_SRC_FILES     = $(COMMON_ROOT)/GlRecorder.cpp $(LOADER_ROOT)/Src/gles3_loader.cpp
+LIBS             += -lEGL
+endif
+
+ifeq ($(BENCH_ZIP),1)
+C_SRC_FILES      += $(addprefix $(MINIZIP_ROOT)/, \
+                   ioapi.c \
+                   unzip.c \
+                   zip.c )
+LIBS             += -lz
+endif
+
+CXX_SRC_FILES    = $(wildcard $(PROJECT_ROOT)/*.cpp) $(KERNEL_SRC_FILES) $(VRLIB_SRC_FILES) $(MODEL_SRC_FILES) \
+                   $(LOCALE_SRC_FILES) $(TOOLS_SRC_FILES) $(GL_SRC_FILES)
+CXX_OBJ_FILES    = $(addprefix $(OBJ_ROOT)/,$(addsuffix .o, $(subst $(BRANCH_ROOT)/,,$(CXX_SRC_FILES))))
+C_OBJ_FILES      = $(addprefix $(OBJ_ROOT)/,$(addsuffix .o, $(subst $(BRANCH_ROOT)/,,$(C_SRC_FILES))))
+
+ifeq ($(HOST_OS),darwin)
+	export CXX = clang++
+	export CC  = clang
+	DEBUGGER   = lldb
+else
+	export CXX = g++
+	export CC  = gcc
+	DEBUGGER   = gdb
+endif
+
+$(OBJ_ROOT)/%.cpp.o: $(BRANCH_ROOT)/%.cpp
+	@mkdir -p $(dir $@)
+	@echo Compiling $(notdir $<)...
+	@$(CXX) $(CXXFLAGS) -c -o $@ $<
+
+$(OBJ_ROOT)/%.c.o: $(BRANCH_ROOT)/%.c
+	@mkdir -p $(dir $@)
+	@echo Compiling $(notdir $<)...
+	@$(CC) $(CFLAGS) -c -o $@ $<
+
+$(OUT_PATH): $(CXX_OBJ_FILES) $(C_OBJ_FILES)
+	@mkdir -p $(dir $@)
+	@echo Linking $@...
+	@$(CXX) -g $(CXX_OBJ_FILES) $(C_OBJ_FILES) $(LIBS) -o $(OUT_PATH)
+
+-include $(CXX_OBJ_FILES:.o=.d) $(C_OBJ_FILES:.o=.d)
+
+all: $(OUT_PATH)
+	@echo Done!
+
+run: $(OUT_PATH)
+	@$(OUT_PATH)
+
+run_debug: $(OUT_PATH)
+	@$(DEBUGGER) $(OUT_PATH)
+
+clean:
+	@rm -rf $(BIN_ROOT) $(OBJ_ROOT)
+
+.PHONY: help all run run_debug clean
@@ -0,0 +1,947 @@
+/************************************************************************************
+
+Filename    :   GlRecorder.cpp
+Content     :   Headless GL backend that records calls instead of executing them.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include "GlRecorder.h"
+
+#include <string.h>
+#include "Kernel/OVR_LogUtils.h"
+
+namespace OVR
+{
+
+ovrGlRecorder * ovrGlRecorder::Current = NULL;
+
+// Argument formats used by DumpCommands. One character per argument word:
+// e = enum (hex), u = unsigned, i = signed, f = float, b = boolean, x = hash (hex).
+// The format after '|' is repeated for the inline data words.
+struct ovrGlCommandInfo
+{
+	const char *	Name;
+	const char *	Format;
+};
+
+static const ovrGlCommandInfo CommandInfo[GL_CMD_MAX] =
+{
+	{ "glActiveTexture",				"e" },
+	{ "glAttachShader",					"uu" },
+	{ "glBindAttribLocation",			"uu" },
+	{ "glBindBuffer",					"eu" },
+	{ "glBindBufferBase",				"euu" },
+	{ "glBindTexture",					"eu" },
+	{ "glBindVertexArray",				"u" },
+	{ "glBlendEquation",				"e" },
+	{ "glBlendEquationSeparate",		"ee" },
+	{ "glBlendFunc",					"ee" },
+	{ "glBlendFuncSeparate",			"eeee" },
+	{ "glBufferData",					"eiex" },
+	{ "glBufferSubData",				"eiix" },
+	{ "glColorMask",					"bbbb" },
+	{ "glCompileShader",				"u" },
+	{ "glCompressedTexImage2D",			"eieiiiix" },
+	{ "glCreateProgram",				"u" },
+	{ "glCreateShader",					"eu" },
+	{ "glCullFace",						"e" },
+	{ "glDeleteBuffers",				"i|u" },
+	{ "glDeleteProgram",				"u" },
+	{ "glDeleteShader",					"u" },
+	{ "glDeleteTextures",				"i|u" },
+	{ "glDeleteVertexArrays",			"i|u" },
+	{ "glDepthFunc",					"e" },
+	{ "glDepthMask",					"b" },
+	{ "glDepthRangef",					"ff" },
+	{ "glDisable",						"e" },
+	{ "glDisableVertexAttribArray",		"u" },
+	{ "glDrawArrays",					"eii" },
+	{ "glDrawElements",					"eieu" },
+	{ "glDrawElementsInstanced",		"eieui" },
+	{ "glEnable",						"e" },
+	{ "glEnableVertexAttribArray",		"u" },
+	{ "glFrontFace",					"e" },
+	{ "glGenBuffers",					"i|u" },
+	{ "glGenTextures",					"i|u" },
+	{ "glGenVertexArrays",				"i|u" },
+	{ "glGenerateMipmap",				"e" },
+	{ "glLineWidth",					"f" },
+	{ "glLinkProgram",					"u" },
+	{ "glMapBufferRange",				"eiie" },
+	{ "glPolygonOffset",				"ff" },
+	{ "glShaderSource",					"ux" },
+	{ "glTexImage2D",					"eieiiieex" },
+	{ "glTexParameterf",				"eef" },
+	{ "glTexParameteri",				"eei" },
+	{ "glUniform1f",					"i|f" },
+	{ "glUniform1i",					"i|i" },
+	{ "glUniformfv",					"uii|f" },
+	{ "glUniformiv",					"uii|i" },
+	{ "glUniformBlockBinding",			"uuu" },
+	{ "glUniformMatrix4fv",				"iib|f" },
+	{ "glUnmapBuffer",					"ex" },
+	{ "glUseProgram",					"u" },
+	{ "glVertexAttribDivisor",			"uu" },
+	{ "glVertexAttribIPointer",			"uieiu" },
+	{ "glVertexAttribPointer",			"uiebiu" }
+};
+
+// FNV-1a, used to reduce buffer contents and shader sources to a single word.
+static uint32_t HashBytes( const void * data, const size_t size, uint32_t hash = 2166136261u )
+{
+	const uint8_t * bytes = static_cast< const uint8_t * >( data );
+	for ( size_t i = 0; i < size; i++ )
+	{
+		hash = ( hash ^ bytes[i] ) * 16777619u;
+	}
+	return hash;
+}
+
+static uint32_t FloatBits( const float f )
+{
+	uint32_t u;
+	memcpy( &u, &f, sizeof( u ) );
+	return u;
+}
+
+// Uniform values are shadowed per program and location, with this group in the state key.
+static const int UNIFORM_STATE_GROUP = GL_CMD_MAX;
+
+//==============================================================
+// recording entry points
+
+#define REC_ARGS( ... )		const uint32_t args[] = { __VA_ARGS__ }
+#define REC( cmd )			ovrGlRecorder::Current->Record( cmd, args, ( sizeof( args ) / sizeof( args[0] ) ) )
+#define REC_STATE( cmd, key, value )	ovrGlRecorder::Current->RecordState( cmd, args, ( sizeof( args ) / sizeof( args[0] ) ), key, value )
+
+static void GL_APIENTRY Rec_glActiveTexture( GLenum texture )
+{
+	REC_ARGS( texture );
+	REC_STATE( GL_CMD_ACTIVE_TEXTURE, ovrGlRecorder::StateKey( GL_CMD_ACTIVE_TEXTURE, 0 ), texture );
+}
+
+static void GL_APIENTRY Rec_glAttachShader( GLuint program, GLuint shader )
+{
+	ovrGlRecorder::Current->AttachShader( program, shader );
+	REC_ARGS( program, shader );
+	REC( GL_CMD_ATTACH_SHADER );
+}
+
+static void GL_APIENTRY Rec_glBindAttribLocation( GLuint program, GLuint index, const GLchar * name )
+{
+	OVR_UNUSED( name );
+	REC_ARGS( program, index );
+	REC( GL_CMD_BIND_ATTRIB_LOCATION );
+}
+
+static void GL_APIENTRY Rec_glBindBuffer( GLenum target, GLuint buffer )
+{
+	REC_ARGS( target, buffer );
+	REC_STATE( GL_CMD_BIND_BUFFER, ovrGlRecorder::StateKey( GL_CMD_BIND_BUFFER, target ), buffer );
+}
+
+static void GL_APIENTRY Rec_glBindBufferBase( GLenum target, GLuint index, GLuint buffer )
+{
+	REC_ARGS( target, index, buffer );
+	REC_STATE( GL_CMD_BIND_BUFFER_BASE, ovrGlRecorder::StateKey( GL_CMD_BIND_BUFFER_BASE, target, index ), buffer );
+}
+
+static void GL_APIENTRY Rec_glBindTexture( GLenum target, GLuint texture )
+{
+	uint32_t unit = 0;
+	ovrGlRecorder::Current->GetState( ovrGlRecorder::StateKey( GL_CMD_ACTIVE_TEXTURE, 0 ), unit );
+	REC_ARGS( target, texture );
+	REC_STATE( GL_CMD_BIND_TEXTURE, ovrGlRecorder::StateKey( GL_CMD_BIND_TEXTURE, unit, target ), texture );
+}
+
+static void GL_APIENTRY Rec_glBindVertexArray( GLuint array )
+{
+	REC_ARGS( array );
+	REC_STATE( GL_CMD_BIND_VERTEX_ARRAY, ovrGlRecorder::StateKey( GL_CMD_BIND_VERTEX_ARRAY, 0 ), array );
+}
+
+// glBlendEquation( e ) sets the same state as glBlendEquationSeparate( e, e ), same for the blend functions.
+static void GL_APIENTRY Rec_glBlendEquation( GLenum mode )
+{
+	REC_ARGS( mode );
+	REC_STATE( GL_CMD_BLEND_EQUATION, ovrGlRecorder::StateKey( GL_CMD_BLEND_EQUATION, 0 ), HashBytes( args, sizeof( args ), HashBytes( args, sizeof( args ) ) ) );
+}
+
+static void GL_APIENTRY Rec_glBlendEquationSeparate( GLenum modeRGB, GLenum modeAlpha )
+{
+	REC_ARGS( modeRGB, modeAlpha );
+	REC_STATE( GL_CMD_BLEND_EQUATION_SEPARATE, ovrGlRecorder::StateKey( GL_CMD_BLEND_EQUATION, 0 ), HashBytes( args + 1, sizeof( args[0] ), HashBytes( args, sizeof( args[0] ) ) ) );
+}
+
+static void GL_APIENTRY Rec_glBlendFunc( GLenum sfactor, GLenum dfactor )
+{
+	REC_ARGS( sfactor, dfactor );
+	REC_STATE( GL_CMD_BLEND_FUNC, ovrGlRecorder::StateKey( GL_CMD_BLEND_FUNC, 0 ), HashBytes( args, sizeof( args ), HashBytes( args, sizeof( args ) ) ) );
+}
+
+static void GL_APIENTRY Rec_glBlendFuncSeparate( GLenum sfactorRGB, GLenum dfactorRGB, GLenum sfactorAlpha, GLenum dfactorAlpha )
+{
+	REC_ARGS( sfactorRGB, dfactorRGB, sfactorAlpha, dfactorAlpha );
+	REC_STATE( GL_CMD_BLEND_FUNC_SEPARATE, ovrGlRecorder::StateKey( GL_CMD_BLEND_FUNC, 0 ), HashBytes( args, sizeof( args ) ) );
+}
+
+static void GL_APIENTRY Rec_glBufferData( GLenum target, GLsizeiptr size, const void * data, GLenum usage )
+{
+	REC_ARGS( target, (uint32_t)size, usage, data != NULL ? HashBytes( data, size ) : 0 );
+	REC( GL_CMD_BUFFER_DATA );
+}
+
+static void GL_APIENTRY Rec_glBufferSubData( GLenum target, GLintptr offset, GLsizeiptr size, const void * data )
+{
+	REC_ARGS( target, (uint32_t)offset, (uint32_t)size, HashBytes( data, size ) );
+	REC( GL_CMD_BUFFER_SUB_DATA );
+}
+
+static void GL_APIENTRY Rec_glColorMask( GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha )
+{
+	REC_ARGS( red, green, blue, alpha );
+	REC_STATE( GL_CMD_COLOR_MASK, ovrGlRecorder::StateKey( GL_CMD_COLOR_MASK, 0 ), ( red << 24 ) | ( green << 16 ) | ( blue << 8 ) | alpha );
+}
+
+static void GL_APIENTRY Rec_glCompileShader( GLuint shader )
+{
+	REC_ARGS( shader );
+	REC( GL_CMD_COMPILE_SHADER );
+}
+
+static void GL_APIENTRY Rec_glCompressedTexImage2D( GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height,
+		GLint border, GLsizei imageSize, const void * data )
+{
+	REC_ARGS( target, (uint32_t)level, internalformat, (uint32_t)width, (uint32_t)height, (uint32_t)border, (uint32_t)imageSize,
+				data != NULL ? HashBytes( data, imageSize ) : 0 );
+	REC( GL_CMD_COMPRESSED_TEX_IMAGE_2D );
+}
+
+static GLuint GL_APIENTRY Rec_glCreateProgram()
+{
+	const GLuint program = ovrGlRecorder::Current->GenName();
+	REC_ARGS( program );
+	REC( GL_CMD_CREATE_PROGRAM );
+	return program;
+}
+
+static GLuint GL_APIENTRY Rec_glCreateShader( GLenum type )
+{
+	const GLuint shader = ovrGlRecorder::Current->GenName();
+	REC_ARGS( type, shader );
+	REC( GL_CMD_CREATE_SHADER );
+	return shader;
+}
+
+static void GL_APIENTRY Rec_glCullFace( GLenum mode )
+{
+	REC_ARGS( mode );
+	REC_STATE( GL_CMD_CULL_FACE, ovrGlRecorder::StateKey( GL_CMD_CULL_FACE, 0 ), mode );
+}
+
+static void RecordNames( const ovrGlCommand cmd, GLsizei n, const GLuint * names )
+{
+	REC_ARGS( (uint32_t)n );
+	ovrGlRecorder::Current->Record( cmd, args, ( sizeof( args ) / sizeof( args[0] ) ), names, n );
+}
+
+static void GL_APIENTRY Rec_glDeleteBuffers( GLsizei n, const GLuint * buffers )
+{
+	RecordNames( GL_CMD_DELETE_BUFFERS, n, buffers );
+}
+
+static void GL_APIENTRY Rec_glDeleteProgram( GLuint program )
+{
+	REC_ARGS( program );
+	REC( GL_CMD_DELETE_PROGRAM );
+}
+
+static void GL_APIENTRY Rec_glDeleteShader( GLuint shader )
+{
+	REC_ARGS( shader );
+	REC( GL_CMD_DELETE_SHADER );
+}
+
+static void GL_APIENTRY Rec_glDeleteTextures( GLsizei n, const GLuint * textures )
+{
+	RecordNames( GL_CMD_DELETE_TEXTURES, n, textures );
+}
+
+static void GL_APIENTRY Rec_glDeleteVertexArrays( GLsizei n, const GLuint * arrays )
+{
+	RecordNames( GL_CMD_DELETE_VERTEX_ARRAYS, n, arrays );
+}
+
+static void GL_APIENTRY Rec_glDepthFunc( GLenum func )
+{
+	REC_ARGS( func );
+	REC_STATE( GL_CMD_DEPTH_FUNC, ovrGlRecorder::StateKey( GL_CMD_DEPTH_FUNC, 0 ), func );
+}
+
+static void GL_APIENTRY Rec_glDepthMask( GLboolean flag )
+{
+	REC_ARGS( flag );
+	REC_STATE( GL_CMD_DEPTH_MASK, ovrGlRecorder::StateKey( GL_CMD_DEPTH_MASK, 0 ), flag );
+}
+
+static void GL_APIENTRY Rec_glDepthRangef( GLfloat n, GLfloat f )
+{
+	REC_ARGS( FloatBits( n ), FloatBits( f ) );
+	REC_STATE( GL_CMD_DEPTH_RANGEF, ovrGlRecorder::StateKey( GL_CMD_DEPTH_RANGEF, 0 ), HashBytes( args, sizeof( args ) ) );
+}
+
+// glEnable and glDisable set the same state.
+static void GL_APIENTRY Rec_glDisable( GLenum cap )
+{
+	REC_ARGS( cap );
+	REC_STATE( GL_CMD_DISABLE, ovrGlRecorder::StateKey( GL_CMD_ENABLE, cap ), 0 );
+}
+
+static void GL_APIENTRY Rec_glDisableVertexAttribArray( GLuint index )
+{
+	REC_ARGS( index );
+	REC( GL_CMD_DISABLE_VERTEX_ATTRIB_ARRAY );
+}
+
+static void GL_APIENTRY Rec_glDrawArrays( GLenum mode, GLint first, GLsizei count )
+{
+	REC_ARGS( mode, (uint32_t)first, (uint32_t)count );
+	REC( GL_CMD_DRAW_ARRAYS );
+}
+
+static void GL_APIENTRY Rec_glDrawElements( GLenum mode, GLsizei count, GLenum type, const void * indices )
+{
+	REC_ARGS( mode, (uint32_t)count, type, (uint32_t)(size_t)indices );
+	REC( GL_CMD_DRAW_ELEMENTS );
+}
+
+static void GL_APIENTRY Rec_glDrawElementsInstanced( GLenum mode, GLsizei count, GLenum type, const void * indices, GLsizei instancecount )
+{
+	REC_ARGS( mode, (uint32_t)count, type, (uint32_t)(size_t)indices, (uint32_t)instancecount );
+	REC( GL_CMD_DRAW_ELEMENTS_INSTANCED );
+}
+
+static void GL_APIENTRY Rec_glEnable( GLenum cap )
+{
+	REC_ARGS( cap );
+	REC_STATE( GL_CMD_ENABLE, ovrGlRecorder::StateKey( GL_CMD_ENABLE, cap ), 1 );
+}
+
+static void GL_APIENTRY Rec_glEnableVertexAttribArray( GLuint index )
+{
+	REC_ARGS( index );
+	REC( GL_CMD_ENABLE_VERTEX_ATTRIB_ARRAY );
+}
+
+static void GL_APIENTRY Rec_glFrontFace( GLenum mode )
+{
+	REC_ARGS( mode );
+	REC_STATE( GL_CMD_FRONT_FACE, ovrGlRecorder::StateKey( GL_CMD_FRONT_FACE, 0 ), mode );
+}
+
+static void GenNames( const ovrGlCommand cmd, GLsizei n, GLuint * names )
+{
+	for ( int i = 0; i < n; i++ )
+	{
+		names[i] = ovrGlRecorder::Current->GenName();
+	}
+	RecordNames( cmd, n, names );
+}
+
+static void GL_APIENTRY Rec_glGenBuffers( GLsizei n, GLuint * buffers )
+{
+	GenNames( GL_CMD_GEN_BUFFERS, n, buffers );
+}
+
+static void GL_APIENTRY Rec_glGenTextures( GLsizei n, GLuint * textures )
+{
+	GenNames( GL_CMD_GEN_TEXTURES, n, textures );
+}
+
+static void GL_APIENTRY Rec_glGenVertexArrays( GLsizei n, GLuint * arrays )
+{
+	GenNames( GL_CMD_GEN_VERTEX_ARRAYS, n, arrays );
+}
+
+static void GL_APIENTRY Rec_glGenerateMipmap( GLenum target )
+{
+	REC_ARGS( target );
+	REC( GL_CMD_GENERATE_MIPMAP );
+}
+
+static void GL_APIENTRY Rec_glLineWidth( GLfloat width )
+{
+	REC_ARGS( FloatBits( width ) );
+	REC_STATE( GL_CMD_LINE_WIDTH, ovrGlRecorder::StateKey( GL_CMD_LINE_WIDTH, 0 ), args[0] );
+}
+
+static void GL_APIENTRY Rec_glLinkProgram( GLuint program )
+{
+	REC_ARGS( program );
+	REC( GL_CMD_LINK_PROGRAM );
+}
+
+static void * GL_APIENTRY Rec_glMapBufferRange( GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access )
+{
+	REC_ARGS( target, (uint32_t)offset, (uint32_t)length, access );
+	REC( GL_CMD_MAP_BUFFER_RANGE );
+	return ovrGlRecorder::Current->MapBuffer( length );
+}
+
+static void GL_APIENTRY Rec_glPolygonOffset( GLfloat factor, GLfloat units )
+{
+	REC_ARGS( FloatBits( factor ), FloatBits( units ) );
+	REC_STATE( GL_CMD_POLYGON_OFFSET, ovrGlRecorder::StateKey( GL_CMD_POLYGON_OFFSET, 0 ), HashBytes( args, sizeof( args ) ) );
+}
+
+static void GL_APIENTRY Rec_glShaderSource( GLuint shader, GLsizei count, const GLchar * const * string, const GLint * length )
+{
+	String source;
+	for ( int i = 0; i < count; i++ )
+	{
+		if ( length != NULL && length[i] >= 0 )
+		{
+			source.AppendString( string[i], length[i] );
+		}
+		else
+		{
+			source.AppendString( string[i] );
+		}
+	}
+	ovrGlRecorder::Current->SetShaderSource( shader, source );
+	REC_ARGS( shader, HashBytes( source.ToCStr(), source.GetSize() ) );
+	REC( GL_CMD_SHADER_SOURCE );
+}
+
+// Size of the pixels passed to glTexImage2D, with the default unpack alignment of 4.
+static size_t TexImageSize( const GLsizei width, const GLsizei height, const GLenum format, const GLenum type )
+{
+	int components = 4;
+	switch ( format )
+	{
+		case GL_RED:
+		case GL_ALPHA:
+		case GL_LUMINANCE:			components = 1; break;
+		case GL_RG:
+		case GL_LUMINANCE_ALPHA:	components = 2; break;
+		case GL_RGB:				components = 3; break;
+		default:					components = 4; break;
+	}
+	const int bytesPerComponent = ( type == GL_FLOAT ) ? 4 : ( ( type == GL_HALF_FLOAT || type == GL_UNSIGNED_SHORT ) ? 2 : 1 );
+	const size_t rowSize = ( (size_t)width * components * bytesPerComponent + 3 ) & ~(size_t)3;
+	return rowSize * height;
+}
+
+static void GL_APIENTRY Rec_glTexImage2D( GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+		GLint border, GLenum format, GLenum type, const void * pixels )
+{
+	REC_ARGS( target, (uint32_t)level, (uint32_t)internalformat, (uint32_t)width, (uint32_t)height, (uint32_t)border, format, type,
+				pixels != NULL ? HashBytes( pixels, TexImageSize( width, height, format, type ) ) : 0 );
+	REC( GL_CMD_TEX_IMAGE_2D );
+}
+
+static void GL_APIENTRY Rec_glTexParameterf( GLenum target, GLenum pname, GLfloat param )
+{
+	REC_ARGS( target, pname, FloatBits( param ) );
+	REC( GL_CMD_TEX_PARAMETER_F );
+}
+
+static void GL_APIENTRY Rec_glTexParameteri( GLenum target, GLenum pname, GLint param )
+{
+	REC_ARGS( target, pname, (uint32_t)param );
+	REC( GL_CMD_TEX_PARAMETER_I );
+}
+
+static void RecordUniform( const ovrGlCommand cmd, const uint32_t * args, const int numArgs,
+		const GLint location, const void * data, const int numDataWords )
+{
+	if ( location < 0 )
+	{
+		// GL silently ignores location -1, it doesn't change any state
+		ovrGlRecorder::Current->Record( cmd, args, numArgs, data, numDataWords );
+		return;
+	}
+	const uint64_t key = ovrGlRecorder::StateKey( UNIFORM_STATE_GROUP, ovrGlRecorder::Current->CurrentProgram, location );
+	// Only the data is hashed, so glUniform1i( loc, v ) and glUniform1iv( loc, 1, &v ) set the same value.
+	const uint32_t value = HashBytes( data, numDataWords * sizeof( uint32_t ) );
+	ovrGlRecorder::Current->RecordState( cmd, args, numArgs, key, value, data, numDataWords );
+}
+
+static void GL_APIENTRY Rec_glUniform1f( GLint location, GLfloat v0 )
+{
+	const uint32_t args[] = { (uint32_t)location };
+	const uint32_t bits = FloatBits( v0 );
+	RecordUniform( GL_CMD_UNIFORM_1F, args, ( sizeof( args ) / sizeof( args[0] ) ), location, &bits, 1 );
+}
+
+static void GL_APIENTRY Rec_glUniform1i( GLint location, GLint v0 )
+{
+	const uint32_t args[] = { (uint32_t)location };
+	RecordUniform( GL_CMD_UNIFORM_1I, args, ( sizeof( args ) / sizeof( args[0] ) ), location, &v0, 1 );
+}
+
+template< int COMPONENTS >
+static void GL_APIENTRY Rec_glUniformfv( GLint location, GLsizei count, const GLfloat * value )
+{
+	const uint32_t args[] = { COMPONENTS, (uint32_t)location, (uint32_t)count };
+	RecordUniform( GL_CMD_UNIFORM_FV, args, ( sizeof( args ) / sizeof( args[0] ) ), location, value, COMPONENTS * count );
+}
+
+template< int COMPONENTS >
+static void GL_APIENTRY Rec_glUniformiv( GLint location, GLsizei count, const GLint * value )
+{
+	const uint32_t args[] = { COMPONENTS, (uint32_t)location, (uint32_t)count };
+	RecordUniform( GL_CMD_UNIFORM_IV, args, ( sizeof( args ) / sizeof( args[0] ) ), location, value, COMPONENTS * count );
+}
+
+static void GL_APIENTRY Rec_glUniformBlockBinding( GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding )
+{
+	REC_ARGS( program, uniformBlockIndex, uniformBlockBinding );
+	REC( GL_CMD_UNIFORM_BLOCK_BINDING );
+}
+
+static void GL_APIENTRY Rec_glUniformMatrix4fv( GLint location, GLsizei count, GLboolean transpose, const GLfloat * value )
+{
+	const uint32_t args[] = { (uint32_t)location, (uint32_t)count, transpose };
+	RecordUniform( GL_CMD_UNIFORM_MATRIX_4FV, args, ( sizeof( args ) / sizeof( args[0] ) ), location, value, 16 * count );
+}
+
+static GLboolean GL_APIENTRY Rec_glUnmapBuffer( GLenum target )
+{
+	REC_ARGS( target, ovrGlRecorder::Current->GetMappedHash() );
+	REC( GL_CMD_UNMAP_BUFFER );
+	return GL_TRUE;
+}
+
+static void GL_APIENTRY Rec_glUseProgram( GLuint program )
+{
+	ovrGlRecorder::Current->CurrentProgram = program;
+	REC_ARGS( program );
+	REC_STATE( GL_CMD_USE_PROGRAM, ovrGlRecorder::StateKey( GL_CMD_USE_PROGRAM, 0 ), program );
+}
+
+static void GL_APIENTRY Rec_glVertexAttribDivisor( GLuint index, GLuint divisor )
+{
+	REC_ARGS( index, divisor );
+	REC( GL_CMD_VERTEX_ATTRIB_DIVISOR );
+}
+
+static void GL_APIENTRY Rec_glVertexAttribIPointer( GLuint index, GLint size, GLenum type, GLsizei stride, const void * pointer )
+{
+	REC_ARGS( index, (uint32_t)size, type, (uint32_t)stride, (uint32_t)(size_t)pointer );
+	REC( GL_CMD_VERTEX_ATTRIB_I_POINTER );
+}
+
+static void GL_APIENTRY Rec_glVertexAttribPointer( GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void * pointer )
+{
+	REC_ARGS( index, (uint32_t)size, type, normalized, (uint32_t)stride, (uint32_t)(size_t)pointer );
+	REC( GL_CMD_VERTEX_ATTRIB_POINTER );
+}
+
+// Queries are not recorded, they only answer what the framework needs to build programs.
+static GLenum GL_APIENTRY Rec_glGetError()
+{
+	return GL_NO_ERROR;
+}
+
+static void GL_APIENTRY Rec_glGetShaderiv( GLuint shader, GLenum pname, GLint * params )
+{
+	OVR_UNUSED( shader );
+	*params = ( pname == GL_COMPILE_STATUS ) ? GL_TRUE : 0;
+}
+
+static void GL_APIENTRY Rec_glGetProgramiv( GLuint program, GLenum pname, GLint * params )
+{
+	OVR_UNUSED( program );
+	*params = ( pname == GL_LINK_STATUS ) ? GL_TRUE : 0;
+}
+
+static void GL_APIENTRY Rec_glGetShaderInfoLog( GLuint shader, GLsizei bufSize, GLsizei * length, GLchar * infoLog )
+{
+	OVR_UNUSED( shader );
+	if ( length != NULL )
+	{
+		*length = 0;
+	}
+	if ( bufSize > 0 )
+	{
+		infoLog[0] = '\0';
+	}
+}
+
+static void GL_APIENTRY Rec_glGetProgramInfoLog( GLuint program, GLsizei bufSize, GLsizei * length, GLchar * infoLog )
+{
+	Rec_glGetShaderInfoLog( program, bufSize, length, infoLog );
+}
+
+static GLint GL_APIENTRY Rec_glGetUniformLocation( GLuint program, const GLchar * name )
+{
+	return ovrGlRecorder::Current->GetUniformLocation( program, name );
+}
+
+static GLuint GL_APIENTRY Rec_glGetUniformBlockIndex( GLuint program, const GLchar * uniformBlockName )
+{
+	const GLint index = ovrGlRecorder::Current->GetUniformLocation( program, uniformBlockName );
+	return ( index >= 0 ) ? (GLuint)index : GL_INVALID_INDEX;
+}
+
+#undef REC_ARGS
+#undef REC
+#undef REC_STATE
+
+struct ovrGlEntryPoint
+{
+	void **	Pointer;
+	void *	Recorder;
+};
+
+#define GL_ENTRY_POINT( name, recorder )	{ (void **)&name, (void *)recorder }
+
+static const ovrGlEntryPoint EntryPoints[] =
+{
+	GL_ENTRY_POINT( glActiveTexture, Rec_glActiveTexture ),
+	GL_ENTRY_POINT( glAttachShader, Rec_glAttachShader ),
+	GL_ENTRY_POINT( glBindAttribLocation, Rec_glBindAttribLocation ),
+	GL_ENTRY_POINT( glBindBuffer, Rec_glBindBuffer ),
+	GL_ENTRY_POINT( glBindBufferBase, Rec_glBindBufferBase ),
+	GL_ENTRY_POINT( glBindTexture, Rec_glBindTexture ),
+	GL_ENTRY_POINT( glBindVertexArray, Rec_glBindVertexArray ),
+	GL_ENTRY_POINT( glBlendEquation, Rec_glBlendEquation ),
+	GL_ENTRY_POINT( glBlendEquationSeparate, Rec_glBlendEquationSeparate ),
+	GL_ENTRY_POINT( glBlendFunc, Rec_glBlendFunc ),
+	GL_ENTRY_POINT( glBlendFuncSeparate, Rec_glBlendFuncSeparate ),
+	GL_ENTRY_POINT( glBufferData, Rec_glBufferData ),
+	GL_ENTRY_POINT( glBufferSubData, Rec_glBufferSubData ),
+	GL_ENTRY_POINT( glColorMask, Rec_glColorMask ),
+	GL_ENTRY_POINT( glCompileShader, Rec_glCompileShader ),
+	GL_ENTRY_POINT( glCompressedTexImage2D, Rec_glCompressedTexImage2D ),
+	GL_ENTRY_POINT( glCreateProgram, Rec_glCreateProgram ),
+	GL_ENTRY_POINT( glCreateShader, Rec_glCreateShader ),
+	GL_ENTRY_POINT( glCullFace, Rec_glCullFace ),
+	GL_ENTRY_POINT( glDeleteBuffers, Rec_glDeleteBuffers ),
+	GL_ENTRY_POINT( glDeleteProgram, Rec_glDeleteProgram ),
+	GL_ENTRY_POINT( glDeleteShader, Rec_glDeleteShader ),
+	GL_ENTRY_POINT( glDeleteTextures, Rec_glDeleteTextures ),
+	GL_ENTRY_POINT( glDeleteVertexArrays, Rec_glDeleteVertexArrays ),
+	GL_ENTRY_POINT( glDepthFunc, Rec_glDepthFunc ),
+	GL_ENTRY_POINT( glDepthMask, Rec_glDepthMask ),
+	GL_ENTRY_POINT( glDepthRangef, Rec_glDepthRangef ),
+	GL_ENTRY_POINT( glDisable, Rec_glDisable ),
+	GL_ENTRY_POINT( glDisableVertexAttribArray, Rec_glDisableVertexAttribArray ),
+	GL_ENTRY_POINT( glDrawArrays, Rec_glDrawArrays ),
+	GL_ENTRY_POINT( glDrawElements, Rec_glDrawElements ),
+	GL_ENTRY_POINT( glDrawElementsInstanced, Rec_glDrawElementsInstanced ),
+	GL_ENTRY_POINT( glEnable, Rec_glEnable ),
+	GL_ENTRY_POINT( glEnableVertexAttribArray, Rec_glEnableVertexAttribArray ),
+	GL_ENTRY_POINT( glFrontFace, Rec_glFrontFace ),
+	GL_ENTRY_POINT( glGenBuffers, Rec_glGenBuffers ),
+	GL_ENTRY_POINT( glGenTextures, Rec_glGenTextures ),
+	GL_ENTRY_POINT( glGenVertexArrays, Rec_glGenVertexArrays ),
+	GL_ENTRY_POINT( glGenerateMipmap, Rec_glGenerateMipmap ),
+	GL_ENTRY_POINT( glLineWidth, Rec_glLineWidth ),
+	GL_ENTRY_POINT( glLinkProgram, Rec_glLinkProgram ),
+	GL_ENTRY_POINT( glMapBufferRange, Rec_glMapBufferRange ),
+	GL_ENTRY_POINT( glPolygonOffset, Rec_glPolygonOffset ),
+	GL_ENTRY_POINT( glShaderSource, Rec_glShaderSource ),
+	GL_ENTRY_POINT( glTexImage2D, Rec_glTexImage2D ),
+	GL_ENTRY_POINT( glTexParameterf, Rec_glTexParameterf ),
+	GL_ENTRY_POINT( glTexParameteri, Rec_glTexParameteri ),
+	GL_ENTRY_POINT( glUniform1f, Rec_glUniform1f ),
+	GL_ENTRY_POINT( glUniform1i, Rec_glUniform1i ),
+	GL_ENTRY_POINT( glUniform1fv, Rec_glUniformfv< 1 > ),
+	GL_ENTRY_POINT( glUniform2fv, Rec_glUniformfv< 2 > ),
+	GL_ENTRY_POINT( glUniform3fv, Rec_glUniformfv< 3 > ),
+	GL_ENTRY_POINT( glUniform4fv, Rec_glUniformfv< 4 > ),
+	GL_ENTRY_POINT( glUniform1iv, Rec_glUniformiv< 1 > ),
+	GL_ENTRY_POINT( glUniform2iv, Rec_glUniformiv< 2 > ),
+	GL_ENTRY_POINT( glUniform3iv, Rec_glUniformiv< 3 > ),
+	GL_ENTRY_POINT( glUniform4iv, Rec_glUniformiv< 4 > ),
+	GL_ENTRY_POINT( glUniformBlockBinding, Rec_glUniformBlockBinding ),
+	GL_ENTRY_POINT( glUniformMatrix4fv, Rec_glUniformMatrix4fv ),
+	GL_ENTRY_POINT( glUnmapBuffer, Rec_glUnmapBuffer ),
+	GL_ENTRY_POINT( glUseProgram, Rec_glUseProgram ),
+	GL_ENTRY_POINT( glVertexAttribDivisor, Rec_glVertexAttribDivisor ),
+	GL_ENTRY_POINT( glVertexAttribIPointer, Rec_glVertexAttribIPointer ),
+	GL_ENTRY_POINT( glVertexAttribPointer, Rec_glVertexAttribPointer ),
+	GL_ENTRY_POINT( glGetError, Rec_glGetError ),
+	GL_ENTRY_POINT( glGetShaderiv, Rec_glGetShaderiv ),
+	GL_ENTRY_POINT( glGetProgramiv, Rec_glGetProgramiv ),
+	GL_ENTRY_POINT( glGetShaderInfoLog, Rec_glGetShaderInfoLog ),
+	GL_ENTRY_POINT( glGetProgramInfoLog, Rec_glGetProgramInfoLog ),
+	GL_ENTRY_POINT( glGetUniformLocation, Rec_glGetUniformLocation ),
+	GL_ENTRY_POINT( glGetUniformBlockIndex, Rec_glGetUniformBlockIndex )
+};
+
+#undef GL_ENTRY_POINT
+
+static const int NUM_ENTRY_POINTS = sizeof( EntryPoints ) / sizeof( EntryPoints[0] );
+
+//==============================================================
+// ovrGlRecorder
+
+ovrGlRecorder::ovrGlRecorder() :
+	CurrentProgram( 0 ),
+	NumCommands( 0 ),
+	NumStateChanges( 0 ),
+	NumRedundantCalls( 0 ),
+	NextName( 1 ),
+	NextUniformLocation( 0 )
+{
+	memset( CommandCounts, 0, sizeof( CommandCounts ) );
+	memset( RedundantCounts, 0, sizeof( RedundantCounts ) );
+}
+
+ovrGlRecorder::~ovrGlRecorder()
+{
+	if ( Current == this )
+	{
+		Uninstall();
+	}
+}
+
+void ovrGlRecorder::Install()
+{
+	OVR_ASSERT( Current == NULL );
+	Current = this;
+
+	SavedPointers.Resize( NUM_ENTRY_POINTS );
+	for ( int i = 0; i < NUM_ENTRY_POINTS; i++ )
+	{
+		SavedPointers[i] = *EntryPoints[i].Pointer;
+		*EntryPoints[i].Pointer = EntryPoints[i].Recorder;
+	}
+}
+
+void ovrGlRecorder::Uninstall()
+{
+	OVR_ASSERT( Current == this );
+
+	for ( int i = 0; i < NUM_ENTRY_POINTS; i++ )
+	{
+		*EntryPoints[i].Pointer = SavedPointers[i];
+	}
+	SavedPointers.Clear();
+
+	Current = NULL;
+}
+
+void ovrGlRecorder::Clear()
+{
+	Stream.Clear();
+	NumCommands = 0;
+	NumStateChanges = 0;
+	NumRedundantCalls = 0;
+	memset( CommandCounts, 0, sizeof( CommandCounts ) );
+	memset( RedundantCounts, 0, sizeof( RedundantCounts ) );
+}
+
+uint32_t ovrGlRecorder::GetStreamHash() const
+{
+	return HashBytes( Stream.GetDataPtr(), Stream.GetSize() * sizeof( uint32_t ) );
+}
+
+const char * ovrGlRecorder::GetCommandName( const ovrGlCommand cmd )
+{
+	return ( cmd >= 0 && cmd < GL_CMD_MAX ) ? CommandInfo[cmd].Name : "unknown";
+}
+
+void ovrGlRecorder::Record( const ovrGlCommand cmd, const uint32_t * args, const int numArgs,
+		const void * data, const int numDataWords )
+{
+	const int numWords = numArgs + numDataWords;
+	OVR_ASSERT( numWords <= 0xFFFF );
+
+	const UPInt offset = Stream.GetSize();
+	Stream.Resize( offset + 1 + numWords );
+	uint32_t * words = &Stream[offset];
+	words[0] = ( (uint32_t)cmd << 16 ) | (uint32_t)numWords;
+	memcpy( words + 1, args, numArgs * sizeof( uint32_t ) );
+	if ( numDataWords > 0 )
+	{
+		memcpy( words + 1 + numArgs, data, numDataWords * sizeof( uint32_t ) );
+	}
+
+	NumCommands++;
+	CommandCounts[cmd]++;
+}
+
+void ovrGlRecorder::RecordState( const ovrGlCommand cmd, const uint32_t * args, const int numArgs,
+		const uint64_t stateKey, const uint32_t value, const void * data, const int numDataWords )
+{
+	Record( cmd, args, numArgs, data, numDataWords );
+
+	uint32_t * current = StateShadow.Get( stateKey );
+	if ( current != NULL && *current == value )
+	{
+		NumRedundantCalls++;
+		RedundantCounts[cmd]++;
+		return;
+	}
+	if ( current != NULL )
+	{
+		*current = value;
+	}
+	else
+	{
+		StateShadow.Add( stateKey, value );
+	}
+	NumStateChanges++;
+}
+
+bool ovrGlRecorder::GetState( const uint64_t stateKey, uint32_t & value ) const
+{
+	const uint32_t * current = StateShadow.Get( stateKey );
+	if ( current == NULL )
+	{
+		return false;
+	}
+	value = *current;
+	return true;
+}
+
+void ovrGlRecorder::SetShaderSource( const GLuint shader, const String & source )
+{
+	ShaderSources.Set( shader, source );
+}
+
+void ovrGlRecorder::AttachShader( const GLuint program, const GLuint shader )
+{
+	const String * source = ShaderSources.Get( shader );
+	if ( source == NULL )
+	{
+		return;
+	}
+	String * programSource = ProgramSources.Get( program );
+	if ( programSource != NULL )
+	{
+		programSource->AppendString( source->ToCStr() );
+	}
+	else
+	{
+		ProgramSources.Add( program, *source );
+	}
+}
+
+static bool IsIdentifierChar( const char c )
+{
+	return ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) || ( c >= '0' && c <= '9' ) || c == '_';
+}
+
+// Returns true if name appears in source as a whole identifier.
+static bool FindIdentifier( const char * source, const char * name )
+{
+	const size_t nameLength = strlen( name );
+	for ( const char * p = strstr( source, name ); p != NULL; p = strstr( p + 1, name ) )
+	{
+		if ( ( p == source || !IsIdentifierChar( p[-1] ) ) && !IsIdentifierChar( p[nameLength] ) )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+GLint ovrGlRecorder::GetUniformLocation( const GLuint program, const char * name )
+{
+	const String * programSource = ProgramSources.Get( program );
+	if ( programSource == NULL || !FindIdentifier( programSource->ToCStr(), name ) )
+	{
+		return -1;
+	}
+
+	const String key = String::Format( "%u/%s", program, name );
+	const GLint * location = UniformLocations.Get( key );
+	if ( location != NULL )
+	{
+		return *location;
+	}
+	UniformLocations.Add( key, NextUniformLocation );
+	return NextUniformLocation++;
+}
+
+void * ovrGlRecorder::MapBuffer( const size_t length )
+{
+	MappedBuffer.Resize( length );
+	memset( MappedBuffer.GetDataPtr(), 0, length );
+	return MappedBuffer.GetDataPtr();
+}
+
+uint32_t ovrGlRecorder::GetMappedHash() const
+{
+	return HashBytes( MappedBuffer.GetDataPtr(), MappedBuffer.GetSize() );
+}
+
+static void AppendWord( StringBuffer & out, const char format, const uint32_t word )
+{
+	char buffer[32];
+	switch ( format )
+	{
+		case 'e':	OVR_sprintf( buffer, sizeof( buffer ), " 0x%04x", word ); break;
+		case 'i':	OVR_sprintf( buffer, sizeof( buffer ), " %d", (int32_t)word ); break;
+		case 'f':
+		{
+			float f;
+			memcpy( &f, &word, sizeof( f ) );
+			OVR_sprintf( buffer, sizeof( buffer ), " %g", f );
+			break;
+		}
+		case 'b':	OVR_sprintf( buffer, sizeof( buffer ), " %s", word ? "true" : "false" ); break;
+		case 'x':	OVR_sprintf( buffer, sizeof( buffer ), " #%08x", word ); break;
+		default:	OVR_sprintf( buffer, sizeof( buffer ), " %u", word ); break;
+	}
+	out += buffer;
+}
+
+void ovrGlRecorder::DumpCommands( StringBuffer & out ) const
+{
+	for ( UPInt i = 0; i < Stream.GetSize(); )
+	{
+		const ovrGlCommand cmd = (ovrGlCommand)( Stream[i] >> 16 );
+		const int numWords = Stream[i] & 0xFFFF;
+		const uint32_t * words = &Stream[i + 1];
+		i += 1 + numWords;
+
+		const char * format = CommandInfo[cmd].Format;
+		const char * dataFormat = strchr( format, '|' );
+		const int numArgs = dataFormat != NULL ? (int)( dataFormat - format ) : (int)strlen( format );
+
+		out += CommandInfo[cmd].Name;
+		for ( int j = 0; j < numWords; j++ )
+		{
+			if ( j == numArgs )
+			{
+				out += " [";
+			}
+			AppendWord( out, j < numArgs ? format[j] : dataFormat[1], words[j] );
+		}
+		if ( numWords > numArgs )
+		{
+			out += " ]";
+		}
+		out += "\n";
+	}
+}
+
+void ovrGlRecorder::DumpCounts( StringBuffer & out ) const
+{
+	char buffer[128];
+	for ( int i = 0; i < GL_CMD_MAX; i++ )
+	{
+		if ( CommandCounts[i] == 0 )
+		{
+			continue;
+		}
+		OVR_sprintf( buffer, sizeof( buffer ), "%-28s %8d calls %8d redundant\n",
+				CommandInfo[i].Name, CommandCounts[i], RedundantCounts[i] );
+		out += buffer;
+	}
+	OVR_sprintf( buffer, sizeof( buffer ), "%-28s %8d calls %8d state changes %8d redundant\n",
+			"total", NumCommands, NumStateChanges, NumRedundantCalls );
+	out += buffer;
+}
+
+}	// namespace OVR
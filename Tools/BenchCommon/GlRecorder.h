@@ -0,0 +1,192 @@
+/************************************************************************************
+
+Filename    :   GlRecorder.h
+Content     :   Headless GL backend that records calls instead of executing them.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+#ifndef OVR_GlRecorder_h
+#define OVR_GlRecorder_h
+
+#include "Kernel/OVR_Types.h"
+#include "Kernel/OVR_Array.h"
+#include "Kernel/OVR_Hash.h"
+#include "Kernel/OVR_String.h"
+#include "Kernel/OVR_GlUtils.h"
+
+namespace OVR {
+
+enum ovrGlCommand
+{
+	GL_CMD_ACTIVE_TEXTURE,
+	GL_CMD_ATTACH_SHADER,
+	GL_CMD_BIND_ATTRIB_LOCATION,
+	GL_CMD_BIND_BUFFER,
+	GL_CMD_BIND_BUFFER_BASE,
+	GL_CMD_BIND_TEXTURE,
+	GL_CMD_BIND_VERTEX_ARRAY,
+	GL_CMD_BLEND_EQUATION,
+	GL_CMD_BLEND_EQUATION_SEPARATE,
+	GL_CMD_BLEND_FUNC,
+	GL_CMD_BLEND_FUNC_SEPARATE,
+	GL_CMD_BUFFER_DATA,
+	GL_CMD_BUFFER_SUB_DATA,
+	GL_CMD_COLOR_MASK,
+	GL_CMD_COMPILE_SHADER,
+	GL_CMD_COMPRESSED_TEX_IMAGE_2D,
+	GL_CMD_CREATE_PROGRAM,
+	GL_CMD_CREATE_SHADER,
+	GL_CMD_CULL_FACE,
+	GL_CMD_DELETE_BUFFERS,
+	GL_CMD_DELETE_PROGRAM,
+	GL_CMD_DELETE_SHADER,
+	GL_CMD_DELETE_TEXTURES,
+	GL_CMD_DELETE_VERTEX_ARRAYS,
+	GL_CMD_DEPTH_FUNC,
+	GL_CMD_DEPTH_MASK,
+	GL_CMD_DEPTH_RANGEF,
+	GL_CMD_DISABLE,
+	GL_CMD_DISABLE_VERTEX_ATTRIB_ARRAY,
+	GL_CMD_DRAW_ARRAYS,
+	GL_CMD_DRAW_ELEMENTS,
+	GL_CMD_DRAW_ELEMENTS_INSTANCED,
+	GL_CMD_ENABLE,
+	GL_CMD_ENABLE_VERTEX_ATTRIB_ARRAY,
+	GL_CMD_FRONT_FACE,
+	GL_CMD_GEN_BUFFERS,
+	GL_CMD_GEN_TEXTURES,
+	GL_CMD_GEN_VERTEX_ARRAYS,
+	GL_CMD_GENERATE_MIPMAP,
+	GL_CMD_LINE_WIDTH,
+	GL_CMD_LINK_PROGRAM,
+	GL_CMD_MAP_BUFFER_RANGE,
+	GL_CMD_POLYGON_OFFSET,
+	GL_CMD_SHADER_SOURCE,
+	GL_CMD_TEX_IMAGE_2D,
+	GL_CMD_TEX_PARAMETER_F,
+	GL_CMD_TEX_PARAMETER_I,
+	GL_CMD_UNIFORM_1F,
+	GL_CMD_UNIFORM_1I,
+	GL_CMD_UNIFORM_FV,			// glUniform1fv - glUniform4fv, the first argument is the number of components
+	GL_CMD_UNIFORM_IV,			// glUniform1iv - glUniform4iv, the first argument is the number of components
+	GL_CMD_UNIFORM_BLOCK_BINDING,
+	GL_CMD_UNIFORM_MATRIX_4FV,
+	GL_CMD_UNMAP_BUFFER,
+	GL_CMD_USE_PROGRAM,
+	GL_CMD_VERTEX_ATTRIB_DIVISOR,
+	GL_CMD_VERTEX_ATTRIB_I_POINTER,
+	GL_CMD_VERTEX_ATTRIB_POINTER,
+	GL_CMD_MAX
+};
+
+//==============================================================
+// ovrGlRecorder
+//
+// Replaces the GLES3 function pointer table with functions that append each
+// call to a compact command stream instead of calling a driver. This makes it
+// possible to run the framework render code (SurfaceRender, GlProgram,
+// GlGeometry, GlBuffer) on a host without a GPU to benchmark its CPU cost and
+// to diff the emitted call stream against a known good dump. It is only built
+// into the host benches, never into the framework.
+//
+// Each command is stored as a header word ( command << 16 | number of argument
+// words ) followed by the arguments. Floats are stored as their bits. Uniform
+// arrays are stored inline; buffer and texture contents are reduced to a hash.
+//
+// The recorder also keeps a shadow of the GL state, so every state setting
+// call can be counted as either an effective change or a redundant call.
+//
+// Only the entry points used by the framework render path are recorded, all
+// other pointers keep their previous value. Object names are handed out
+// sequentially, shaders always compile and programs always link, and uniform
+// locations are assigned in the order they are queried.
+class ovrGlRecorder
+{
+public:
+							ovrGlRecorder();
+							~ovrGlRecorder();
+
+	// Only one recorder can be installed at a time. Uninstall restores the
+	// function pointers that were set before Install.
+	void					Install();
+	void					Uninstall();
+
+	// Clears the command stream and the counters, but not the state shadow or object names.
+	void					Clear();
+
+	int						GetNumCommands() const { return NumCommands; }
+	typedef Array< uint32_t, ArrayConstPolicy< 0, 16, true > > StreamArray;	// keeps its memory when cleared
+
+	const StreamArray &		GetStream() const { return Stream; }
+	// Hash of the command stream, for a quick golden comparison.
+	uint32_t				GetStreamHash() const;
+
+	int						GetCommandCount( const ovrGlCommand cmd ) const { return CommandCounts[cmd]; }
+	int						GetRedundantCount( const ovrGlCommand cmd ) const { return RedundantCounts[cmd]; }
+	int						GetNumStateChanges() const { return NumStateChanges; }
+	int						GetNumRedundantCalls() const { return NumRedundantCalls; }
+
+	static const char *		GetCommandName( const ovrGlCommand cmd );
+
+	// Appends one line per command, suitable for diffing.
+	void					DumpCommands( StringBuffer & out ) const;
+	// Appends one line per command type with the number of calls and redundant calls.
+	void					DumpCounts( StringBuffer & out ) const;
+
+public:
+	// Called by the recording entry points.
+	static ovrGlRecorder *	Current;
+
+	void					Record( const ovrGlCommand cmd, const uint32_t * args, const int numArgs,
+									const void * data = NULL, const int numDataWords = 0 );
+	// Records a state setting call and counts it as an effective change or a redundant call.
+	// stateKey identifies the piece of state (see StateKey), value is its new value.
+	void					RecordState( const ovrGlCommand cmd, const uint32_t * args, const int numArgs,
+										 const uint64_t stateKey, const uint32_t value,
+										 const void * data = NULL, const int numDataWords = 0 );
+
+	static uint64_t			StateKey( const int group, const uint32_t a, const uint32_t b = 0 )
+							{
+								return ( (uint64_t)group << 56 ) | ( (uint64_t)( a & 0xFFFFFF ) << 32 ) | b;
+							}
+	// Returns false if the state has not been set since the recorder was created.
+	bool					GetState( const uint64_t stateKey, uint32_t & value ) const;
+
+	GLuint					GenName() { return NextName++; }
+	void					SetShaderSource( const GLuint shader, const String & source );
+	void					AttachShader( const GLuint program, const GLuint shader );
+	// Returns -1 if the name does not appear in the sources attached to the program.
+	GLint					GetUniformLocation( const GLuint program, const char * name );
+	void *					MapBuffer( const size_t length );
+	uint32_t				GetMappedHash() const;
+
+	GLuint					CurrentProgram;
+
+private:
+	StreamArray				Stream;
+	int						NumCommands;
+	int						CommandCounts[GL_CMD_MAX];
+	int						RedundantCounts[GL_CMD_MAX];
+	int						NumStateChanges;
+	int						NumRedundantCalls;
+
+	Hash< uint64_t, uint32_t >	StateShadow;		// StateKey -> value
+	Hash< GLuint, String >	ShaderSources;
+	Hash< GLuint, String >	ProgramSources;		// all sources attached to the program
+	Hash< String, GLint, String::HashFunctor >	UniformLocations;	// "program/name" -> location
+	GLuint					NextName;
+	GLint					NextUniformLocation;
+	Array< uint8_t, ArrayConstPolicy< 0, 16, true > >	MappedBuffer;
+
+	Array< void * >			SavedPointers;
+
+	// private assignment operator to prevent copying
+	ovrGlRecorder &			operator = ( ovrGlRecorder & );
+};
+
+} // namespace OVR
+
+#endif // OVR_GlRecorder_h
@@ -0,0 +1,1187 @@
+/************************************************************************************
+
+Filename    :   main.cpp
+Content     :   Host test and benchmark of BitmapFont text submission on the GL recorder.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Kernel/OVR_System.h"
+#include "Kernel/OVR_Alg.h"
+#include "Kernel/OVR_Std.h"
+#include "Kernel/OVR_Hash.h"
+#include "Kernel/OVR_MemBuffer.h"
+#include "BitmapFont.h"
+#include "GlRecorder.h"
+#include "PathUtils.h"
+#include "OVR_FileSys.h"
+#include "OVR_MountTable.h"
+#include "OVR_Uri.h"
+#include "BenchCommon.h"
+
+using namespace OVR;
+
+//==============================================================
+// PathUtils.cpp needs the App and JNI, these are the URI helpers
+// BitmapFont::Load and OVR_Uri use, for plain ASCII paths.
+namespace OVR {
+
+void ovrPathUtils::StripFilename( char const * inPath, char * outPath, size_t const outPathSize )
+{
+	char const * lastSlash = strrchr( inPath, '/' );
+	const size_t length = ( lastSlash != NULL ) ? ( lastSlash - inPath + 1 ) : 0;
+	OVR_strncpy( outPath, outPathSize, inPath, length );
+}
+
+bool ovrPathUtils::AppendUriPath( char const * inPath, char const * appendPath, char * outPath, size_t const outPathSize )
+{
+	while ( *appendPath == '/' )
+	{
+		appendPath++;
+	}
+	const size_t inLength = strlen( inPath );
+	const bool needSlash = inLength == 0 || inPath[inLength - 1] != '/';
+	if ( inLength + ( needSlash ? 1 : 0 ) + strlen( appendPath ) + 1 > outPathSize )
+	{
+		return false;
+	}
+	OVR_sprintf( outPath, outPathSize, "%s%s%s", inPath, needSlash ? "/" : "", appendPath );
+	return true;
+}
+
+bool ovrPathUtils::AppendUriPath( char * inPath, size_t const inPathSize, char const * append )
+{
+	if ( inPath[0] == '\0' )
+	{
+		OVR_strcpy( inPath, inPathSize, append );
+		return true;
+	}
+	char path[URI_MAX_PATH];
+	OVR_strcpy( path, sizeof( path ), inPath );
+	return AppendUriPath( path, append, inPath, inPathSize );
+}
+
+} // namespace OVR
+
+//==============================================================
+// ovrBenchFileSys
+// Reads the path of any URI from a mount table.
+class ovrBenchFileSys : public ovrFileSys
+{
+public:
+	virtual ovrStream *		OpenStream( char const * uri, ovrStreamMode const mode ) { return NULL; }
+	virtual void			CloseStream( ovrStream * & stream ) { stream = NULL; }
+	virtual bool			ReadFile( char const * uri, MemBufferT< uint8_t > & outBuffer )
+							{
+								char path[OVR_MAX_PATH_LEN];
+								return GetPath( uri, path, sizeof( path ) ) && MountTable.ReadFile( path, outBuffer );
+							}
+	virtual bool			FileExists( char const * uri )
+							{
+								char path[OVR_MAX_PATH_LEN];
+								return GetPath( uri, path, sizeof( path ) ) && MountTable.FileExists( path );
+							}
+	virtual bool			GetLocalPathForURI( char const * uri, String & outputPath )
+							{
+								char path[OVR_MAX_PATH_LEN];
+								return GetPath( uri, path, sizeof( path ) ) && MountTable.GetLocalPath( path, outputPath );
+							}
+	virtual ovrMountTable &	GetMountTable() { return MountTable; }
+
+private:
+	ovrMountTable			MountTable;
+
+	static bool				GetPath( char const * uri, char * path, const size_t pathSize )
+							{
+								char scheme[OVR_MAX_SCHEME_LEN];
+								char host[OVR_MAX_HOST_NAME_LEN];
+								int port;
+								return ovrUri::ParseUri( uri, scheme, sizeof( scheme ), NULL, 0, NULL, 0, host, sizeof( host ), port,
+											path, pathSize, NULL, 0, NULL, 0 );
+							}
+};
+
+//==============================================================
+// Shadow buffers
+// The recorder only keeps a hash of uploaded data. These entry points forward
+// to the recorder and also keep a copy of every buffer, so the vertices a font
+// surface draws can be read back.
+static PFNGLBINDVERTEXARRAYPROC		RecBindVertexArray;
+static PFNGLBINDBUFFERPROC			RecBindBuffer;
+static PFNGLBUFFERDATAPROC			RecBufferData;
+static PFNGLBUFFERSUBDATAPROC		RecBufferSubData;
+static PFNGLDELETEBUFFERSPROC		RecDeleteBuffers;
+
+static Hash< GLuint, Array< uint8_t > >	ShadowBuffers;
+static Hash< GLuint, GLuint >				ShadowElementBuffers;	// vertex array -> element array buffer
+static GLuint								ShadowVertexArray;
+static GLuint								ShadowArrayBuffer;
+static int									ShadowUploadBytes[2];	// glBufferSubData vertex and index bytes since the last reset
+static bool									ShadowCountOnly;		// only count glBufferSubData bytes, for timing
+
+static Array< uint8_t > * GetBoundShadow( GLenum target )
+{
+	GLuint buffer = 0;
+	if ( target == GL_ARRAY_BUFFER )
+	{
+		buffer = ShadowArrayBuffer;
+	}
+	else if ( target == GL_ELEMENT_ARRAY_BUFFER )
+	{
+		const GLuint * bound = ShadowElementBuffers.Get( ShadowVertexArray );
+		buffer = ( bound != NULL ) ? *bound : 0;
+	}
+	if ( buffer == 0 )
+	{
+		return NULL;
+	}
+	if ( ShadowBuffers.Get( buffer ) == NULL )
+	{
+		ShadowBuffers.Set( buffer, Array< uint8_t >() );
+	}
+	return ShadowBuffers.Get( buffer );
+}
+
+static void GL_APIENTRY Shadow_glBindVertexArray( GLuint array )
+{
+	ShadowVertexArray = array;
+	RecBindVertexArray( array );
+}
+
+static void GL_APIENTRY Shadow_glBindBuffer( GLenum target, GLuint buffer )
+{
+	if ( target == GL_ARRAY_BUFFER )
+	{
+		ShadowArrayBuffer = buffer;
+	}
+	else if ( target == GL_ELEMENT_ARRAY_BUFFER )
+	{
+		ShadowElementBuffers.Set( ShadowVertexArray, buffer );
+	}
+	RecBindBuffer( target, buffer );
+}
+
+static void GL_APIENTRY Shadow_glBufferData( GLenum target, GLsizeiptr size, const void * data, GLenum usage )
+{
+	Array< uint8_t > * shadow = GetBoundShadow( target );
+	if ( shadow != NULL )
+	{
+		shadow->Resize( size );
+		if ( data != NULL )
+		{
+			memcpy( shadow->GetDataPtr(), data, size );
+		}
+		else
+		{
+			memset( shadow->GetDataPtr(), 0, size );
+		}
+	}
+	RecBufferData( target, size, data, usage );
+}
+
+static void GL_APIENTRY Shadow_glBufferSubData( GLenum target, GLintptr offset, GLsizeiptr size, const void * data )
+{
+	ShadowUploadBytes[target == GL_ELEMENT_ARRAY_BUFFER] += (int)size;
+	if ( ShadowCountOnly )
+	{
+		return;
+	}
+	Array< uint8_t > * shadow = GetBoundShadow( target );
+	if ( shadow != NULL && offset >= 0 && offset + size <= shadow->GetSizeI() )
+	{
+		memcpy( shadow->GetDataPtr() + offset, data, size );
+	}
+	RecBufferSubData( target, offset, size, data );
+}
+
+static void GL_APIENTRY Shadow_glDeleteBuffers( GLsizei n, const GLuint * buffers )
+{
+	for ( int i = 0; i < n; i++ )
+	{
+		ShadowBuffers.Remove( buffers[i] );
+	}
+	RecDeleteBuffers( n, buffers );
+}
+
+// Call after ovrGlRecorder::Install.
+static void InstallShadowBuffers()
+{
+	RecBindVertexArray = glBindVertexArray;
+	RecBindBuffer = glBindBuffer;
+	RecBufferData = glBufferData;
+	RecBufferSubData = glBufferSubData;
+	RecDeleteBuffers = glDeleteBuffers;
+	glBindVertexArray = Shadow_glBindVertexArray;
+	glBindBuffer = Shadow_glBindBuffer;
+	glBufferData = Shadow_glBufferData;
+	glBufferSubData = Shadow_glBufferSubData;
+	glDeleteBuffers = Shadow_glDeleteBuffers;
+}
+
+// Call before ovrGlRecorder::Uninstall.
+static void UninstallShadowBuffers()
+{
+	glBindVertexArray = RecBindVertexArray;
+	glBindBuffer = RecBindBuffer;
+	glBufferData = RecBufferData;
+	glBufferSubData = RecBufferSubData;
+	glDeleteBuffers = RecDeleteBuffers;
+	ShadowBuffers.Clear();
+	ShadowElementBuffers.Clear();
+}
+
+// sizeof( fontVertex_t ) in BitmapFont.cpp: position, texture coordinate, color and outline parms.
+static const int FONT_VERTEX_SIZE = 28;
+
+// Appends the vertices the surface draws, in the order of its index buffer.
+// Returns false if the indices point outside the vertex buffer, or if the
+// vertex buffer doesn't hold geo.vertexCount vertices of FONT_VERTEX_SIZE.
+static bool ResolveDrawnVertices( const BitmapFontSurface & surface, const BitmapFont & font, Array< uint8_t > & out )
+{
+	out.Resize( 0 );
+	Array< ovrDrawSurface > surfaceList;
+	surface.AppendSurfaceList( font, surfaceList );
+	if ( surfaceList.GetSizeI() == 0 )
+	{
+		return true;
+	}
+	const GlGeometry & geo = surfaceList[0].surface->geo;
+	const Array< uint8_t > * vertices = ShadowBuffers.Get( geo.vertexBuffer );
+	const Array< uint8_t > * indices = ShadowBuffers.Get( geo.indexBuffer );
+	if ( vertices == NULL || indices == NULL || vertices->GetSizeI() != geo.vertexCount * FONT_VERTEX_SIZE ||
+			geo.indexCount * (int)sizeof( uint16_t ) > indices->GetSizeI() )
+	{
+		return false;
+	}
+	const uint16_t * index = (const uint16_t *)indices->GetDataPtr();
+	out.Resize( geo.indexCount * FONT_VERTEX_SIZE );
+	for ( int i = 0; i < geo.indexCount; i++ )
+	{
+		if ( ( index[i] + 1 ) * FONT_VERTEX_SIZE > vertices->GetSizeI() )
+		{
+			return false;
+		}
+		memcpy( &out[i * FONT_VERTEX_SIZE], &(*vertices)[index[i] * FONT_VERTEX_SIZE], FONT_VERTEX_SIZE );
+	}
+	return true;
+}
+
+//==============================================================
+// Scenes
+
+struct ovrBenchOptions
+{
+	ovrBenchOptions() :
+		FontFolder( "../../VrAppFramework/res/raw" ),
+		CjkFontFolder( "../fontue/data/CJK_notosans" ),
+		GoldenFile( "wordwrap_golden.txt" ),
+		NumFrames( 200 ),
+		WrapBytes( 100 * 1024 ),
+		NumEdits( 400 ) {}
+
+	const char *	FontFolder;		// mounted as res/raw
+	const char *	CjkFontFolder;	// mounted as res/cjk
+	const char *	GoldenFile;		// word wrap results of the old wrapper
+	int				NumFrames;		// frames timed per scene
+	int				WrapBytes;		// size of the word wrapped text
+	int				NumEdits;		// single character edits of the wrapped text
+};
+
+struct ovrBenchLabel
+{
+	String			Text;
+	fontParms_t		Parms;
+	Vector3f		Position;
+	float			Scale;
+	Vector4f		Color;
+};
+
+struct ovrBenchScene
+{
+	const char *			Name;
+	Array< ovrBenchLabel >	Labels;
+	bool					Animated;		// also draw a frame counter and a tooltip that moves every frame
+};
+
+static const char * MenuWords[] =
+{
+	"Play", "Settings", "Volume", "Brightness", "Library", "Back", "Resume", "Quit", "Home", "Store",
+	"Friends", "Downloads", "Notifications", "Battery", "Wi-Fi", "Bluetooth", "Controller", "Recenter",
+	"Screenshot", "Passthrough", "Cinema", "Gallery", "Search", "Profile", "Help", "Privacy"
+};
+static const int NUM_MENU_WORDS = sizeof( MenuWords ) / sizeof( MenuWords[0] );
+
+static const Vector4f LabelColors[] =
+{
+	Vector4f( 1.0f, 1.0f, 1.0f, 1.0f ),
+	Vector4f( 0.5f, 0.8f, 1.0f, 1.0f ),
+	Vector4f( 1.0f, 0.9f, 0.3f, 1.0f )
+};
+
+static ovrBenchLabel MakeLabel( uint32_t & seed, const char * text, const Vector3f & position, const float scale, const bool billboard )
+{
+	ovrBenchLabel label;
+	label.Text = text;
+	label.Parms.AlignHoriz = (HorizontalJustification)( Random( seed ) % 3 );
+	label.Parms.AlignVert = ( Random( seed ) & 1 ) ? VERTICAL_CENTER : VERTICAL_BASELINE;
+	label.Parms.Billboard = billboard;
+	label.Position = position;
+	label.Scale = scale;
+	label.Color = LabelColors[Random( seed ) % 3];
+	return label;
+}
+
+// A head-locked HUD: static menu labels and a frame counter.
+static void BuildHudScene( ovrBenchScene & scene )
+{
+	scene.Name = "HUD, 32 static labels";
+	scene.Animated = true;
+	uint32_t seed = 1;
+	for ( int i = 0; i < 32; i++ )
+	{
+		StringBuffer text;
+		const int numWords = 1 + Random( seed ) % 3;
+		for ( int w = 0; w < numWords; w++ )
+		{
+			text.AppendFormat( "%s%s", ( w > 0 ) ? " " : "", MenuWords[Random( seed ) % NUM_MENU_WORDS] );
+		}
+		const Vector3f position( -1.0f + ( i % 4 ) * 0.6f, 0.8f - ( i / 4 ) * 0.2f, -3.0f );
+		scene.Labels.PushBack( MakeLabel( seed, text.ToCStr(), position, 0.5f, false ) );
+	}
+}
+
+// Name tags over a crowd, always facing the viewer.
+static void BuildBillboardScene( ovrBenchScene & scene )
+{
+	scene.Name = "500 billboarded labels";
+	scene.Animated = false;
+	uint32_t seed = 2;
+	for ( int i = 0; i < 500; i++ )
+	{
+		char text[64];
+		OVR_sprintf( text, sizeof( text ), "%s %d", MenuWords[Random( seed ) % NUM_MENU_WORDS], i );
+		const Vector3f position( ( Random( seed ) % 2000 ) * 0.01f - 10.0f, ( Random( seed ) % 400 ) * 0.01f - 2.0f,
+				-2.0f - ( Random( seed ) % 2000 ) * 0.01f );
+		scene.Labels.PushBack( MakeLabel( seed, text, position, 0.25f, true ) );
+	}
+}
+
+// More distinct strings than the layout cache keeps.
+static void BuildOverBudgetScene( ovrBenchScene & scene )
+{
+	scene.Name = "2000 labels (over budget)";
+	scene.Animated = false;
+	uint32_t seed = 3;
+	for ( int i = 0; i < 2000; i++ )
+	{
+		char text[64];
+		OVR_sprintf( text, sizeof( text ), "#%d", 1000 + i );
+		const Vector3f position( ( i % 50 ) * 0.4f - 10.0f, ( i / 50 ) * 0.2f - 4.0f, -8.0f );
+		scene.Labels.PushBack( MakeLabel( seed, text, position, 0.2f, false ) );
+	}
+}
+
+static void DrawScene( BitmapFontSurface & surface, const BitmapFont & font, const ovrBenchScene & scene, const int frame )
+{
+	const Vector3f normal( 0.0f, 0.0f, 1.0f );
+	const Vector3f up( 0.0f, 1.0f, 0.0f );
+	for ( int i = 0; i < scene.Labels.GetSizeI(); i++ )
+	{
+		const ovrBenchLabel & label = scene.Labels[i];
+		if ( label.Parms.Billboard )
+		{
+			surface.DrawTextBillboarded3D( font, label.Parms, label.Position, label.Scale, label.Color, label.Text.ToCStr() );
+		}
+		else
+		{
+			surface.DrawText3D( font, label.Parms, label.Position, normal, up, label.Scale, label.Color, label.Text.ToCStr() );
+		}
+	}
+	if ( scene.Animated )
+	{
+		surface.DrawText3Df( font, fontParms_t(), Vector3f( -1.0f, -1.0f, -3.0f ), normal, up, 0.5f,
+				Vector4f( 1.0f ), "frame %d", frame );
+		surface.DrawText3D( font, fontParms_t(), Vector3f( -1.0f + ( frame % 100 ) * 0.02f, -1.2f, -3.0f ), normal, up, 0.4f,
+				Vector4f( 1.0f ), "Hold to recenter" );
+	}
+}
+
+static Matrix4f SceneViewMatrix( const int frame )
+{
+	// a slow turn, so the billboards and the depth order change
+	const Vector3f eye( 0.0f, 0.0f, 0.0f );
+	const Vector3f target( sinf( frame * 0.01f ), 0.0f, -cosf( frame * 0.01f ) );
+	return Matrix4f::LookAtRH( eye, target, Vector3f( 0.0f, 1.0f, 0.0f ) );
+}
+
+static const int MAX_SURFACE_VERTICES = 64 * 1024;
+
+//==============================================================
+// Layout cache
+
+// Draws the scene with and without the layout cache and checks that both surfaces draw the
+// same vertices. Then times the submission, DrawText3D only, with and without the cache.
+static bool TestLayoutCache( const ovrBenchOptions & options, const BitmapFont & font, const ovrBenchScene & scene )
+{
+	static const int NUM_CHECK_FRAMES = 4;
+
+	BitmapFontSurface * cached = BitmapFontSurface::Create();
+	BitmapFontSurface * uncached = BitmapFontSurface::Create();
+	cached->Init( MAX_SURFACE_VERTICES );
+	uncached->Init( MAX_SURFACE_VERTICES );
+	uncached->SetLayoutCacheBudget( 0, 0 );
+
+	bool ok = true;
+	int numQuads = 0;
+	Array< uint8_t > cachedVertices;
+	Array< uint8_t > uncachedVertices;
+	for ( int frame = 0; frame < NUM_CHECK_FRAMES; frame++ )
+	{
+		const Matrix4f viewMatrix = SceneViewMatrix( frame );
+		DrawScene( *cached, font, scene, frame );
+		DrawScene( *uncached, font, scene, frame );
+		cached->Finish( viewMatrix );
+		uncached->Finish( viewMatrix );
+		ok &= ResolveDrawnVertices( *cached, font, cachedVertices );
+		ok &= ResolveDrawnVertices( *uncached, font, uncachedVertices );
+		ok &= cachedVertices.GetSizeI() > 0 && cachedVertices.GetSizeI() == uncachedVertices.GetSizeI() &&
+				memcmp( cachedVertices.GetDataPtr(), uncachedVertices.GetDataPtr(), cachedVertices.GetSizeI() ) == 0;
+		numQuads = cachedVertices.GetSizeI() / ( 6 * FONT_VERTEX_SIZE );
+	}
+
+	double seconds[2] = { 0.0, 0.0 };
+	BitmapFontSurface * surfaces[2] = { uncached, cached };
+	for ( int s = 0; s < 2; s++ )
+	{
+		for ( int frame = NUM_CHECK_FRAMES; frame < NUM_CHECK_FRAMES + options.NumFrames; frame++ )
+		{
+			const double start = GetSeconds();
+			DrawScene( *surfaces[s], font, scene, frame );
+			seconds[s] += GetSeconds() - start;
+			surfaces[s]->Finish( SceneViewMatrix( frame ) );
+		}
+	}
+
+	const double quads = (double)Alg::Max( numQuads, 1 ) * options.NumFrames;
+	printf( "%-28s %5d quads: %6.1f -> %6.1f ns/quad submitted, draws %s\n", scene.Name, numQuads,
+			seconds[0] * 1e9 / quads, seconds[1] * 1e9 / quads, ok ? "match" : "DIFFER" );
+
+	BitmapFontSurface::Free( cached );
+	BitmapFontSurface::Free( uncached );
+	return ok;
+}
+
+//==============================================================
+// Word wrap
+
+static const char * ParagraphWords[] =
+{
+	"the", "a", "of", "and", "to", "in", "is", "it", "headset", "controller", "application", "frame", "rate",
+	"latency", "texture", "resolution", "panel", "lens", "distortion", "chromatic", "aberration", "tracking",
+	"caf\xC3\xA9", "na\xC3\xAFve", "Gr\xC3\xB6\xC3\x9F" "e", "se\xC3\xB1or", "\xC3\xA9t\xC3\xA9", "(optional)", "100%", "e.g.",
+	"don't", "well-known", "http://developer.oculus.com/documentation/mobilesdk/latest/concepts/mobile-intro/"
+};
+static const int NUM_PARAGRAPH_WORDS = sizeof( ParagraphWords ) / sizeof( ParagraphWords[0] );
+
+// Paragraphs of words with punctuation, the odd tab and a URL that is wider than a line.
+static void BuildWrapText( const int numBytes, Array< char > & text )
+{
+	uint32_t seed = 4;
+	StringBuffer buffer;
+	int wordsInSentence = 0;
+	int sentencesInParagraph = 0;
+	while ( (int)buffer.GetSize() < numBytes )
+	{
+		const char * word = ParagraphWords[Random( seed ) % ( NUM_PARAGRAPH_WORDS - ( Random( seed ) % 64 != 0 ) )];
+		buffer.AppendFormat( "%s%s", ( wordsInSentence == 0 || Random( seed ) % 32 != 0 ) ? "" : "\t", word );
+		wordsInSentence++;
+		if ( wordsInSentence > 4 && Random( seed ) % 8 == 0 )
+		{
+			buffer.AppendString( ( Random( seed ) % 4 == 0 ) ? "? " : ". " );
+			wordsInSentence = 0;
+			if ( ++sentencesInParagraph > 3 && Random( seed ) % 4 == 0 )
+			{
+				buffer.AppendString( "\n" );
+				sentencesInParagraph = 0;
+			}
+		}
+		else
+		{
+			buffer.AppendString( ( Random( seed ) % 16 == 0 ) ? ", " : " " );
+		}
+	}
+	text.Resize( buffer.GetSize() + 1 );
+	memcpy( text.GetDataPtr(), buffer.ToCStr(), buffer.GetSize() + 1 );
+}
+
+// Inserts, removes or replaces one character at a random character boundary.
+static void EditText( uint32_t & seed, Array< char > & text )
+{
+	static const char EditChars[] = "  \nabcdefghijklmnopqrstuvwxyz.,-";
+	const int length = text.GetSizeI() - 1;
+	int pos = Random( seed ) % ( length + 1 );
+	while ( pos < length && (uint8_t)text[pos] >= 0x80 )
+	{
+		pos++;
+	}
+	const char c = EditChars[Random( seed ) % ( sizeof( EditChars ) - 1 )];
+	const int op = Random( seed ) % 3;
+	if ( op == 0 || pos == length )
+	{
+		text.InsertAt( pos, c );
+	}
+	else if ( op == 1 )
+	{
+		text.RemoveAt( pos );
+	}
+	else
+	{
+		text[pos] = c;
+	}
+}
+
+struct ovrTextMetrics
+{
+	size_t			Length;
+	float			Width;
+	float			Height;
+	float			Ascent;
+	float			Descent;
+	float			FontHeight;
+	int				NumLines;
+	Array< float >	LineWidths;
+
+	bool operator==( const ovrTextMetrics & other ) const
+	{
+		if ( Length != other.Length || Width != other.Width || Height != other.Height || Ascent != other.Ascent ||
+				Descent != other.Descent || FontHeight != other.FontHeight || NumLines != other.NumLines )
+		{
+			return false;
+		}
+		const int numWidths = Alg::Min( NumLines, LineWidths.GetSizeI() );
+		return memcmp( LineWidths.GetDataPtr(), other.LineWidths.GetDataPtr(), numWidths * sizeof( float ) ) == 0;
+	}
+};
+
+static const int MAX_METRICS_LINES = 8192;
+
+static void GetTextMetrics( const BitmapFont & font, const char * text, ovrTextMetrics & m )
+{
+	m.LineWidths.Resize( MAX_METRICS_LINES );
+	font.CalcTextMetrics( text, m.Length, m.Width, m.Height, m.Ascent, m.Descent, m.FontHeight,
+			m.LineWidths.GetDataPtr(), MAX_METRICS_LINES, m.NumLines );
+}
+
+static void GetCacheMetrics( const BitmapFont & font, const ovrTextWrapCache & cache, ovrTextMetrics & m )
+{
+	m.LineWidths.Resize( MAX_METRICS_LINES );
+	font.CalcTextMetrics( cache, m.Length, m.Width, m.Height, m.Ascent, m.Descent, m.FontHeight,
+			m.LineWidths.GetDataPtr(), MAX_METRICS_LINES, m.NumLines );
+}
+
+// Wraps the text from scratch and checks that the cache holds the same lines and metrics.
+static bool CheckWrapCache( const BitmapFont & font, const ovrTextWrapCache & cache, const char * text,
+		const float widthMeters )
+{
+	ovrTextWrapCache full;
+	font.WordWrapText( full, text, widthMeters );
+
+	ovrTextMetrics cacheMetrics;
+	ovrTextMetrics textMetrics;
+	GetCacheMetrics( font, cache, cacheMetrics );
+	GetTextMetrics( font, full.GetWrappedText().ToCStr(), textMetrics );
+
+	return strcmp( cache.GetSourceText().ToCStr(), text ) == 0 &&
+			strcmp( cache.GetWrappedText().ToCStr(), full.GetWrappedText().ToCStr() ) == 0 &&
+			cache.GetNumLines() == full.GetNumLines() && cacheMetrics == textMetrics;
+}
+
+// Wraps about 100 KB of text, then re-wraps it after single character edits and a few
+// changes of the wrap width. Every re-wrap must match a wrap from scratch, and the metrics
+// read from the cache must match CalcTextMetrics on the wrapped text.
+static bool TestWordWrap( const ovrBenchOptions & options, const BitmapFont & font )
+{
+	static const int NUM_TIMED_RUNS = 10;
+
+	Array< char > text;
+	BuildWrapText( options.WrapBytes, text );
+
+	// about 60 characters per line
+	const float widthMeters = font.CalcTextWidth( "the headset controller and the application frame rate latency" );
+	const float widths[3] = { widthMeters, widthMeters * 1.5f, widthMeters * 0.5f };
+
+	bool ok = true;
+
+	// the String version wraps the same way
+	String wrappedString( text.GetDataPtr() );
+	font.WordWrapText( wrappedString, widthMeters );
+	ovrTextWrapCache cache;
+	font.WordWrapText( cache, text.GetDataPtr(), widthMeters );
+	const bool stringOk = strcmp( wrappedString.ToCStr(), cache.GetWrappedText().ToCStr() ) == 0;
+	ok &= stringOk;
+
+	// without a width, lines are only split at '\n' and the cache measures the text as is
+	ovrTextWrapCache unwrapped;
+	font.WordWrapText( unwrapped, text.GetDataPtr(), -1.0f );
+	ovrTextMetrics cacheMetrics;
+	ovrTextMetrics textMetrics;
+	GetCacheMetrics( font, unwrapped, cacheMetrics );
+	GetTextMetrics( font, text.GetDataPtr(), textMetrics );
+	const bool unwrappedOk = strcmp( unwrapped.GetWrappedText().ToCStr(), text.GetDataPtr() ) == 0 && cacheMetrics == textMetrics;
+	ok &= unwrappedOk;
+
+	double bestFullSeconds = 1e9;
+	double bestStringSeconds = 1e9;
+	double bestTextMetricsSeconds = 1e9;
+	double bestCacheMetricsSeconds = 1e9;
+	for ( int run = 0; run < NUM_TIMED_RUNS; run++ )
+	{
+		ovrTextWrapCache fresh;
+		double start = GetSeconds();
+		font.WordWrapText( fresh, text.GetDataPtr(), widthMeters );
+		bestFullSeconds = Alg::Min( bestFullSeconds, GetSeconds() - start );
+
+		String copy( text.GetDataPtr() );
+		start = GetSeconds();
+		font.WordWrapText( copy, widthMeters );
+		bestStringSeconds = Alg::Min( bestStringSeconds, GetSeconds() - start );
+
+		start = GetSeconds();
+		GetTextMetrics( font, fresh.GetWrappedText().ToCStr(), textMetrics );
+		bestTextMetricsSeconds = Alg::Min( bestTextMetricsSeconds, GetSeconds() - start );
+
+		start = GetSeconds();
+		GetCacheMetrics( font, fresh, cacheMetrics );
+		bestCacheMetricsSeconds = Alg::Min( bestCacheMetricsSeconds, GetSeconds() - start );
+	}
+
+	// single character edits, with a change of width every 100 edits
+	uint32_t seed = 5;
+	int numBad = 0;
+	int numTimed = 0;
+	int reflowedLines = 0;
+	double editSeconds = 0.0;
+	int widthIndex = 0;
+	for ( int edit = 0; edit < options.NumEdits; edit++ )
+	{
+		if ( edit % 100 == 99 )
+		{
+			widthIndex = ( widthIndex + 1 ) % 3;
+			font.WordWrapText( cache, cache.GetSourceText().ToCStr(), widths[widthIndex] );
+		}
+		else
+		{
+			EditText( seed, text );
+			const double start = GetSeconds();
+			font.WordWrapText( cache, text.GetDataPtr(), widths[widthIndex] );
+			editSeconds += GetSeconds() - start;
+			reflowedLines += cache.GetNumReflowedLines();
+			numTimed++;
+		}
+		numBad += !CheckWrapCache( font, cache, text.GetDataPtr(), widths[widthIndex] );
+	}
+	ok &= ( numBad == 0 );
+
+	printf( "%d KB, %d lines, String wrap %s, metrics without a width %s\n", text.GetSizeI() / 1024, cache.GetNumLines(),
+			stringOk ? "matches" : "DIFFERS", unwrappedOk ? "match" : "DIFFER" );
+	printf( "full wrap:           %.3f ms, String version %.3f ms\n", bestFullSeconds * 1e3, bestStringSeconds * 1e3 );
+	printf( "single-char edit:    %.3f ms, %.1f lines re-flowed on average\n",
+			editSeconds * 1e3 / Alg::Max( numTimed, 1 ), (double)reflowedLines / Alg::Max( numTimed, 1 ) );
+	printf( "CalcTextMetrics:     %.3f ms from the text, %.3f ms from the cache\n",
+			bestTextMetricsSeconds * 1e3, bestCacheMetricsSeconds * 1e3 );
+	printf( "%d edits and width changes, %d re-wraps differ from a full wrap\n", options.NumEdits, numBad );
+	return ok;
+}
+
+// Undoes the escapes of a golden file field in place.
+static void UnescapeField( char * field )
+{
+	char * out = field;
+	for ( const char * in = field; *in != '\0'; in++ )
+	{
+		if ( in[0] == '\\' && in[1] != '\0' )
+		{
+			in++;
+			*out++ = ( *in == 'n' ) ? '\n' : ( *in == 'r' ) ? '\r' : ( *in == 't' ) ? '\t' : *in;
+		}
+		else
+		{
+			*out++ = *in;
+		}
+	}
+	*out = '\0';
+}
+
+// Wraps each case of the golden file with the String version and with a cache that holds
+// the case before, and compares with the break positions of the old wrapper. Where the old
+// wrapper broke an earlier line, the file also records the result of the current one.
+static bool TestWrapGolden( const ovrBenchOptions & options, const BitmapFont & efigs, const BitmapFont & cjk )
+{
+	FILE * file = fopen( options.GoldenFile, "rb" );
+	if ( file == NULL )
+	{
+		printf( "Failed to open '%s'\n", options.GoldenFile );
+		return false;
+	}
+	fseek( file, 0, SEEK_END );
+	const long fileSize = ftell( file );
+	fseek( file, 0, SEEK_SET );
+	Array< char > buffer;
+	buffer.Resize( fileSize + 1 );
+	const size_t numRead = fread( buffer.GetDataPtr(), 1, fileSize, file );
+	fclose( file );
+	buffer[numRead] = '\0';
+
+	ovrTextWrapCache caches[2];
+	int numCases = 0;
+	int numAsBefore = 0;
+	int numAsRecorded = 0;
+	int numBad = 0;
+	for ( char * line = buffer.GetDataPtr(); *line != '\0'; )
+	{
+		char * lineEnd = strchr( line, '\n' );
+		char * next = ( lineEnd != NULL ) ? lineEnd + 1 : line + strlen( line );
+		if ( lineEnd != NULL )
+		{
+			*lineEnd = '\0';
+		}
+		if ( line[0] == '#' || line[0] == '\0' )
+		{
+			line = next;
+			continue;
+		}
+
+		char * fields[5] = {};
+		int numFields = 0;
+		for ( char * field = line; field != NULL && numFields < 5; numFields++ )
+		{
+			fields[numFields] = field;
+			field = strchr( field, '\t' );
+			if ( field != NULL )
+			{
+				*field++ = '\0';
+			}
+		}
+		line = next;
+		if ( numFields < 4 )
+		{
+			numBad++;
+			continue;
+		}
+		for ( int i = 2; i < numFields; i++ )
+		{
+			UnescapeField( fields[i] );
+		}
+
+		const bool isCjk = strcmp( fields[0], "cjk" ) == 0;
+		const BitmapFont & font = isCjk ? cjk : efigs;
+		const float widthMeters = (float)strtod( fields[1], NULL );
+		const char * expected = ( numFields > 4 ) ? fields[4] : fields[3];
+
+		String wrapped( fields[2] );
+		font.WordWrapText( wrapped, widthMeters );
+		ovrTextWrapCache & cache = caches[isCjk];
+		font.WordWrapText( cache, fields[2], widthMeters );
+
+		const bool ok = strcmp( wrapped.ToCStr(), expected ) == 0 && strcmp( cache.GetWrappedText().ToCStr(), expected ) == 0;
+		numCases++;
+		numAsBefore += ok && numFields == 4;
+		numAsRecorded += ok && numFields > 4;
+		numBad += !ok;
+	}
+
+	printf( "%d cases, %d wrap as before, %d as recorded where the old wrapper broke an earlier line, %d differ\n",
+			numCases, numAsBefore, numAsRecorded, numBad );
+	return numCases > 0 && numBad == 0;
+}
+
+//==============================================================
+// Finish
+
+// Static labels around the viewer and a few billboarded labels whose text changes every
+// frame, about 10K glyphs. Each label has its own color, so the drawn quads can be traced
+// back to their label.
+static void BuildFinishScene( ovrBenchScene & scene )
+{
+	scene.Name = "240 static + 8 billboarded labels";
+	scene.Animated = false;
+	uint32_t seed = 6;
+	for ( int i = 0; i < 248; i++ )
+	{
+		const bool billboard = ( i >= 240 );
+		StringBuffer text;
+		const int numWords = billboard ? 1 : 4 + Random( seed ) % 5;
+		for ( int w = 0; w < numWords; w++ )
+		{
+			text.AppendFormat( "%s%s", ( w > 0 ) ? " " : "", MenuWords[Random( seed ) % NUM_MENU_WORDS] );
+		}
+		const float angle = ( Random( seed ) % 3600 ) * ( MATH_FLOAT_PI / 1800.0f );
+		const float distance = 2.0f + ( Random( seed ) % 1000 ) * 0.01f;
+		const Vector3f position( sinf( angle ) * distance, ( Random( seed ) % 400 ) * 0.01f - 2.0f, -cosf( angle ) * distance );
+		ovrBenchLabel label = MakeLabel( seed, text.ToCStr(), position, billboard ? 0.4f : 0.25f, billboard );
+		label.Color = Vector4f( ( ( i + 1 ) & 255 ) + 0.5f, ( ( i + 1 ) >> 8 ) + 0.5f, 255.0f, 255.0f ) * ( 1.0f / 255.0f );
+		scene.Labels.PushBack( label );
+	}
+}
+
+// Label index from the color of a drawn vertex, -1 if it isn't a scene label.
+static int LabelFromVertex( const uint8_t * vertex )
+{
+	const uint8_t * rgba = vertex + 5 * sizeof( float );
+	return ( rgba[0] | ( rgba[1] << 8 ) ) - 1;
+}
+
+// How the labels are drawn in one frame of the random test.
+struct ovrFinishFrame
+{
+	Array< int >		Drawn;			// label indices, a label can be drawn twice
+	Array< Vector3f >	Positions;
+};
+
+static void DrawFinishFrame( BitmapFontSurface & surface, const BitmapFont & font, const ovrBenchScene & scene,
+		const ovrFinishFrame & frame )
+{
+	const Vector3f normal( 0.0f, 0.0f, 1.0f );
+	const Vector3f up( 0.0f, 1.0f, 0.0f );
+	for ( int i = 0; i < frame.Drawn.GetSizeI(); i++ )
+	{
+		const ovrBenchLabel & label = scene.Labels[frame.Drawn[i]];
+		if ( label.Parms.Billboard )
+		{
+			surface.DrawTextBillboarded3D( font, label.Parms, frame.Positions[i], label.Scale, label.Color, label.Text.ToCStr() );
+		}
+		else
+		{
+			surface.DrawText3D( font, label.Parms, frame.Positions[i], normal, up, label.Scale, label.Color, label.Text.ToCStr() );
+		}
+	}
+}
+
+static Matrix4f FinishViewMatrix( const int frame )
+{
+	// turn and walk a little, so the billboards and the depth order change
+	const Vector3f eye( sinf( frame * 0.05f ) * 0.5f, 0.0f, 0.0f );
+	const Vector3f forward( sinf( frame * 0.02f ), 0.0f, -cosf( frame * 0.02f ) );
+	return Matrix4f::LookAtRH( eye, eye + forward, Vector3f( 0.0f, 1.0f, 0.0f ) );
+}
+
+// Checks that labels are drawn as whole blocks, nearest first. The sort key keeps 7 bits
+// of mantissa of the squared distance, so labels within 1/128 of each other can swap.
+static bool CheckDrawOrder( const Array< uint8_t > & vertices, const ovrFinishFrame & frame, const Vector3f & viewPos )
+{
+	Array< int > timesDrawn;
+	timesDrawn.Resize( 65536 );
+	memset( timesDrawn.GetDataPtr(), 0, timesDrawn.GetSize() * sizeof( int ) );
+	Hash< int, Vector3f > positions;
+	for ( int i = 0; i < frame.Drawn.GetSizeI(); i++ )
+	{
+		timesDrawn[frame.Drawn[i]]++;
+		positions.Set( frame.Drawn[i], frame.Positions[i] );
+	}
+
+	const int quadSize = 6 * FONT_VERTEX_SIZE;
+	Array< bool > finished;
+	finished.Resize( 65536 );
+	memset( finished.GetDataPtr(), 0, finished.GetSize() * sizeof( bool ) );
+	int current = -1;
+	float currentDistance = 0.0f;
+	for ( int q = 0; q < vertices.GetSizeI() / quadSize; q++ )
+	{
+		const int label = LabelFromVertex( &vertices[q * quadSize] );
+		if ( label < 0 || label >= timesDrawn.GetSizeI() || timesDrawn[label] == 0 || finished[label] )
+		{
+			return false;
+		}
+		if ( label == current || timesDrawn[label] > 1 )
+		{
+			continue;	// duplicated labels share a color and are drawn as separate blocks
+		}
+		if ( current >= 0 )
+		{
+			finished[current] = true;
+		}
+		const float distance = ( *positions.Get( label ) - viewPos ).LengthSq();
+		if ( distance < currentDistance * ( 1.0f - 1.0f / 64.0f ) )
+		{
+			return false;
+		}
+		current = label;
+		currentDistance = distance;
+	}
+	return true;
+}
+
+// Draws random frames where labels disappear, move, change their text or are drawn twice,
+// and the layout cache budget changes. Every frame, the surface must draw the same vertices
+// as a new surface that transforms and uploads everything, and in depth order.
+static bool TestFinish( const BitmapFont & font, const ovrBenchScene & baseScene )
+{
+	static const int NUM_CHECK_FRAMES = 64;
+	static const int UNDERSIZED_VERTICES = 8 * 1024;
+
+	ovrBenchScene scene = baseScene;
+	BitmapFontSurface * surface = BitmapFontSurface::Create();
+	surface->Init( MAX_SURFACE_VERTICES );
+	BitmapFontSurface * undersized = BitmapFontSurface::Create();
+	undersized->Init( UNDERSIZED_VERTICES );
+
+	uint32_t seed = 7;
+	int numDiffer = 0;
+	int numOutOfOrder = 0;
+	int numUndersizedBad = 0;
+	Array< uint8_t > drawn;
+	Array< uint8_t > reference;
+	for ( int f = 0; f < NUM_CHECK_FRAMES; f++ )
+	{
+		ovrFinishFrame frame;
+		for ( int i = 0; i < scene.Labels.GetSizeI(); i++ )
+		{
+			ovrBenchLabel & label = scene.Labels[i];
+			const uint32_t event = Random( seed ) % 100;
+			if ( label.Parms.Billboard )
+			{
+				label.Text = String::Format( "%s %d.%d s", MenuWords[i % NUM_MENU_WORDS], f / 10, f % 10 );
+			}
+			else if ( event < 2 )
+			{
+				continue;	// hidden for a frame
+			}
+			else if ( event < 4 )
+			{
+				label.Position += Vector3f( 0.0f, 0.05f, 0.0f );
+			}
+			else if ( event < 6 )
+			{
+				label.Text += MenuWords[Random( seed ) % NUM_MENU_WORDS];
+			}
+			else if ( event < 7 )
+			{
+				frame.Drawn.PushBack( i );
+				frame.Positions.PushBack( label.Position + Vector3f( 0.0f, -0.1f, 0.0f ) );
+			}
+			frame.Drawn.PushBack( i );
+			frame.Positions.PushBack( label.Position );
+		}
+
+		if ( f % 16 == 15 )
+		{
+			const int budget = ( f / 16 ) % 3;
+			surface->SetLayoutCacheBudget( budget == 0 ? 64 : ( budget == 1 ? 0 : 1024 ), budget == 0 ? 4096 : 64 * 1024 );
+		}
+
+		const Matrix4f viewMatrix = FinishViewMatrix( f );
+		DrawFinishFrame( *surface, font, scene, frame );
+		surface->Finish( viewMatrix );
+
+		BitmapFontSurface * fresh = BitmapFontSurface::Create();
+		fresh->Init( MAX_SURFACE_VERTICES );
+		DrawFinishFrame( *fresh, font, scene, frame );
+		fresh->Finish( viewMatrix );
+
+		const bool resolved = ResolveDrawnVertices( *surface, font, drawn ) && ResolveDrawnVertices( *fresh, font, reference );
+		numDiffer += !resolved || drawn.GetSizeI() == 0 || drawn.GetSizeI() != reference.GetSizeI() ||
+				memcmp( drawn.GetDataPtr(), reference.GetDataPtr(), drawn.GetSizeI() ) != 0;
+		numOutOfOrder += !CheckDrawOrder( drawn, frame, viewMatrix.Inverted().GetTranslation() );
+		BitmapFontSurface::Free( fresh );
+
+		// a surface that is too small drops labels, but never draws outside its vertices
+		DrawFinishFrame( *undersized, font, scene, frame );
+		undersized->Finish( viewMatrix );
+		numUndersizedBad += !ResolveDrawnVertices( *undersized, font, drawn ) ||
+				drawn.GetSizeI() > ( UNDERSIZED_VERTICES / 4 ) * 6 * FONT_VERTEX_SIZE ||
+				!CheckDrawOrder( drawn, frame, viewMatrix.Inverted().GetTranslation() );
+	}
+
+	printf( "%d random frames: %d differ from a new surface, %d out of order, %d bad with %d vertices\n",
+			NUM_CHECK_FRAMES, numDiffer, numOutOfOrder, numUndersizedBad, UNDERSIZED_VERTICES );
+
+	BitmapFontSurface::Free( surface );
+	BitmapFontSurface::Free( undersized );
+	return numDiffer == 0 && numOutOfOrder == 0 && numUndersizedBad == 0;
+}
+
+// Times Finish and counts the uploaded bytes per frame. Uploads are only counted, not
+// recorded, so the time is the CPU work of Finish.
+static void BenchmarkFinish( const ovrBenchOptions & options, const BitmapFont & font, const ovrBenchScene & baseScene,
+		const char * name, const bool allBillboarded, const bool cacheOff )
+{
+	ovrBenchScene scene = baseScene;
+	ovrFinishFrame frame;
+	for ( int i = 0; i < scene.Labels.GetSizeI(); i++ )
+	{
+		scene.Labels[i].Parms.Billboard |= allBillboarded;
+		frame.Drawn.PushBack( i );
+		frame.Positions.PushBack( scene.Labels[i].Position );
+	}
+
+	BitmapFontSurface * surface = BitmapFontSurface::Create();
+	surface->Init( MAX_SURFACE_VERTICES );
+	if ( cacheOff )
+	{
+		surface->SetLayoutCacheBudget( 0, 0 );
+	}
+
+	ShadowCountOnly = true;
+	static const int NUM_WARMUP_FRAMES = 2;
+	double seconds = 0.0;
+	int uploadBytes[2] = { 0, 0 };
+	int numQuads = 0;
+	for ( int f = 0; f < NUM_WARMUP_FRAMES + options.NumFrames; f++ )
+	{
+		for ( int i = 240; i < scene.Labels.GetSizeI(); i++ )
+		{
+			scene.Labels[i].Text = String::Format( "%s %d.%d s", MenuWords[i % NUM_MENU_WORDS], f / 10, f % 10 );
+		}
+		DrawFinishFrame( *surface, font, scene, frame );
+
+		ShadowUploadBytes[0] = ShadowUploadBytes[1] = 0;
+		const double start = GetSeconds();
+		surface->Finish( FinishViewMatrix( f ) );
+		if ( f >= NUM_WARMUP_FRAMES )
+		{
+			seconds += GetSeconds() - start;
+			uploadBytes[0] += ShadowUploadBytes[0];
+			uploadBytes[1] += ShadowUploadBytes[1];
+		}
+
+		Array< ovrDrawSurface > surfaceList;
+		surface->AppendSurfaceList( font, surfaceList );
+		numQuads = surfaceList.GetSizeI() > 0 ? surfaceList[0].surface->geo.indexCount / 6 : 0;
+	}
+	ShadowCountOnly = false;
+
+	printf( "%-36s %5d quads: Finish %6.1f us, uploaded %6.1f KB vertices + %5.1f KB indices per frame\n", name, numQuads,
+			seconds * 1e6 / options.NumFrames, uploadBytes[0] / 1024.0 / options.NumFrames, uploadBytes[1] / 1024.0 / options.NumFrames );
+
+	BitmapFontSurface::Free( surface );
+}
+
+static int RunTest( const ovrBenchOptions & options )
+{
+	ovrGlRecorder recorder;
+	recorder.Install();
+	InstallShadowBuffers();
+
+	ovrBenchFileSys fileSys;
+	fileSys.GetMountTable().MountFolder( "res/raw", options.FontFolder, false );
+
+	BitmapFont * font = BitmapFont::Create();
+	if ( !font->Load( fileSys, "apk:///res/raw/efigs.fnt" ) )
+	{
+		printf( "Failed to load efigs.fnt from '%s'\n", options.FontFolder );
+		BitmapFont::Free( font );
+		UninstallShadowBuffers();
+		recorder.Uninstall();
+		return 1;
+	}
+
+	// cjk.fnt comes without its atlas, the efigs one stands in since only the glyph metrics are used
+	MemBufferT< uint8_t > atlas;
+	fileSys.ReadFile( "apk:///res/raw/efigs_sdf.ktx", atlas );
+	const ovrMemoryFile cjkAtlas = { "cjk_sdf.ktx", (const uint8_t *)atlas, atlas.GetSize() };
+	fileSys.GetMountTable().MountFolder( "res/cjk", options.CjkFontFolder, false );
+	fileSys.GetMountTable().MountMemory( "res/cjk", &cjkAtlas, 1 );
+
+	BitmapFont * cjkFont = BitmapFont::Create();
+	if ( !cjkFont->Load( fileSys, "apk:///res/cjk/cjk.fnt" ) )
+	{
+		printf( "Failed to load cjk.fnt from '%s'\n", options.CjkFontFolder );
+		BitmapFont::Free( cjkFont );
+		BitmapFont::Free( font );
+		UninstallShadowBuffers();
+		recorder.Uninstall();
+		return 1;
+	}
+
+	bool ok = true;
+
+	printf( "layout cache off -> on:\n" );
+	ovrBenchScene scenes[3];
+	BuildHudScene( scenes[0] );
+	BuildBillboardScene( scenes[1] );
+	BuildOverBudgetScene( scenes[2] );
+	for ( int i = 0; i < 3; i++ )
+	{
+		ok &= TestLayoutCache( options, *font, scenes[i] );
+	}
+
+	printf( "word wrap:\n" );
+	ok &= TestWordWrap( options, *font );
+
+	printf( "word wrap against the old wrapper:\n" );
+	ok &= TestWrapGolden( options, *font, *cjkFont );
+
+	printf( "finish:\n" );
+	ovrBenchScene finishScene;
+	BuildFinishScene( finishScene );
+	ok &= TestFinish( *font, finishScene );
+	BenchmarkFinish( options, *font, finishScene, "240 static + 8 billboarded labels", false, false );
+	BenchmarkFinish( options, *font, finishScene, "same, layout cache off", false, true );
+	BenchmarkFinish( options, *font, finishScene, "all 248 labels billboarded", true, false );
+
+	BitmapFont::Free( cjkFont );
+	BitmapFont::Free( font );
+	UninstallShadowBuffers();
+	recorder.Uninstall();
+
+	printf( ok ? "PASSED\n" : "FAILED\n" );
+	return ok ? 0 : 1;
+}
+
+int main( int argc, char * argv[] )
+{
+	ovrBenchOptions options;
+	for ( int i = 1; i < argc; i++ )
+	{
+		const bool hasValue = ( i + 1 < argc );
+		if ( strcmp( argv[i], "-fonts" ) == 0 && hasValue )
+		{
+			options.FontFolder = argv[++i];
+		}
+		else if ( strcmp( argv[i], "-cjk" ) == 0 && hasValue )
+		{
+			options.CjkFontFolder = argv[++i];
+		}
+		else if ( strcmp( argv[i], "-golden" ) == 0 && hasValue )
+		{
+			options.GoldenFile = argv[++i];
+		}
+		else if ( strcmp( argv[i], "-frames" ) == 0 && hasValue )
+		{
+			options.NumFrames = Alg::Max( atoi( argv[++i] ), 1 );
+		}
+		else if ( strcmp( argv[i], "-wrap" ) == 0 && hasValue )
+		{
+			options.WrapBytes = Alg::Max( atoi( argv[++i] ), 1 ) * 1024;
+		}
+		else if ( strcmp( argv[i], "-edits" ) == 0 && hasValue )
+		{
+			options.NumEdits = Alg::Max( atoi( argv[++i] ), 0 );
+		}
+		else
+		{
+			printf( "USAGE: BitmapFontBench [options]\n" );
+			printf( "options:\n" );
+			printf( "-fonts <folder> : Folder with efigs.fnt (default ../../VrAppFramework/res/raw).\n" );
+			printf( "-cjk <folder>   : Folder with cjk.fnt (default ../fontue/data/CJK_notosans).\n" );
+			printf( "-golden <file>  : Word wrap results of the old wrapper (default wordwrap_golden.txt).\n" );
+			printf( "-frames <n>     : Number of frames timed per scene (default 200).\n" );
+			printf( "-wrap <KB>      : Size of the word wrapped text (default 100).\n" );
+			printf( "-edits <n>      : Number of single character edits re-wrapped (default 400).\n" );
+			return 1;
+		}
+	}
+
+	System::Init( Log::ConfigureDefaultLog( LogMask_None ) );
+	const int result = RunTest( options );
+	System::Destroy();
+
+	return result;
+}
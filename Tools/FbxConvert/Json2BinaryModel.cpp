@@ -0,0 +1,555 @@
+/************************************************************************************
+
+Filename    :   Json2BinaryModel.cpp
+Content     :   Binary model container builder.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+#include <stdint.h>
+
+#define FBX_TOOL
+#include "../../LibOVRKernel/Src/Kernel/OVR_Hash.h"
+#include "../../LibOVRKernel/Src/Kernel/OVR_String_Utils.h"
+#include "../../LibOVRKernel/Src/Kernel/OVR_JSON.h"
+
+using namespace OVR;
+
+#include "../../VrAppSupport/VrModel/Src/ModelTrace.h"
+#include "../../VrAppSupport/VrModel/Src/ModelBinary.h"
+
+#include "Json2BinaryModel.h"
+
+/*
+
+The container is built from the converter output instead of from the raw models,
+so the render, collision, ground collision and ray-trace models all end up in one
+file, and existing models.json + models.bin pairs can be converted as well.
+
+The JSON is walked in the same order as LoadModelFileJson() walks it, reading the
+arrays from the binary data in sequence, or from the JSON text if the converter
+wrote the arrays as text.
+
+*/
+
+typedef unsigned short TriangleIndex;
+
+static const int MAX_GEOMETRY_VERTICES = 1 << ( sizeof( TriangleIndex ) * 8 );
+
+class BinaryModelInput
+{
+public:
+	BinaryModelInput( const uint8_t * data, const int size ) :
+		Data( data ),
+		Size( size ),
+		Offset( 0 ) {}
+
+	template< typename _type_ >
+	bool ReadArray( Array< _type_ > & out, const int numElements )
+	{
+		const int bytes = numElements * sizeof( out[0] );
+		if ( Data == NULL || bytes > Size - Offset )
+		{
+			out.Resize( 0 );
+			return false;
+		}
+		out.Resize( numElements );
+		memcpy( &out[0], &Data[Offset], bytes );
+		Offset += bytes;
+		return true;
+	}
+
+	bool IsAtEnd() const { return Offset == Size; }
+
+private:
+	const uint8_t *	Data;
+	int				Size;
+	int				Offset;
+};
+
+template< typename _type_ >
+static void ReadModelArray( Array< _type_ > & out, const char * string, BinaryModelInput & bin, const int numElements )
+{
+	if ( string != NULL && string[0] != '\0' && numElements > 0 )
+	{
+		if ( !bin.ReadArray( out, numElements ) )
+		{
+			StringUtils::StringTo( out, string );
+		}
+	}
+}
+
+class BinaryModelBuilder
+{
+public:
+	BinaryModelBuilder()
+	{
+		Strings.PushBack( '\0' );	// offset 0 is the empty string
+	}
+
+	uint32_t AddString( const char * string )
+	{
+		uint32_t offset = 0;
+		if ( string[0] != '\0' && !StringOffsets.Get( String( string ), &offset ) )
+		{
+			offset = Strings.GetSizeI();
+			Strings.Append( string, strlen( string ) + 1 );
+			StringOffsets.Add( String( string ), offset );
+		}
+		return offset;
+	}
+
+	template< typename _type_ >
+	void AddChunk( const uint32_t id, const Array< _type_ > & records )
+	{
+		AddChunk( id, records.GetDataPtr(), records.GetSizeI() * sizeof( _type_ ), records.GetSizeI() );
+	}
+
+	void AddChunk( const uint32_t id, const void * data, const int size, const int count )
+	{
+		Chunk & chunk = Chunks.PushDefault();
+		chunk.id = id;
+		chunk.count = count;
+		chunk.data.Resize( size );
+		if ( size > 0 )
+		{
+			memcpy( chunk.data.GetDataPtr(), data, size );
+		}
+	}
+
+	void Write( Array< uint8_t > & out )
+	{
+		AddChunk( MODEL_BINARY_CHUNK_STRINGS, Strings );
+
+		uint32_t offset = sizeof( model_binary_header_t ) + Chunks.GetSizeI() * sizeof( model_binary_chunk_t );
+		Array< model_binary_chunk_t > directory;
+		for ( int i = 0; i < Chunks.GetSizeI(); i++ )
+		{
+			offset = ( offset + MODEL_BINARY_ALIGNMENT - 1 ) & ~( MODEL_BINARY_ALIGNMENT - 1 );
+			model_binary_chunk_t & entry = directory.PushDefault();
+			entry.id = Chunks[i].id;
+			entry.offset = offset;
+			entry.size = Chunks[i].data.GetSizeI();
+			entry.count = Chunks[i].count;
+			offset += entry.size;
+		}
+
+		out.Resize( offset );
+		memset( out.GetDataPtr(), 0, offset );
+
+		model_binary_header_t * header = (model_binary_header_t *)out.GetDataPtr();
+		header->magic = MODEL_BINARY_MAGIC;
+		header->version = MODEL_BINARY_VERSION;
+		header->fileSize = offset;
+		header->numChunks = directory.GetSizeI();
+		memcpy( header + 1, directory.GetDataPtr(), directory.GetSizeI() * sizeof( model_binary_chunk_t ) );
+
+		for ( int i = 0; i < Chunks.GetSizeI(); i++ )
+		{
+			if ( directory[i].size > 0 )
+			{
+				memcpy( &out[directory[i].offset], Chunks[i].data.GetDataPtr(), directory[i].size );
+			}
+		}
+	}
+
+private:
+	struct Chunk
+	{
+		uint32_t			id;
+		uint32_t			count;
+		Array< uint8_t >	data;
+	};
+
+	Array< char >									Strings;
+	Hash< String, uint32_t, String::HashFunctor >	StringOffsets;
+	Array< Chunk >									Chunks;
+};
+
+template< typename _type_ >
+static void AppendVertexAttribute( Array< uint8_t > & vertices, uint32_t & attribs, const uint32_t bit,
+									const Array< _type_ > & attrib, const int vertexCount )
+{
+	if ( attrib.GetSizeI() == vertexCount && vertexCount > 0 )
+	{
+		const int size = vertices.GetSizeI();
+		vertices.Resize( size + vertexCount * sizeof( _type_ ) );
+		memcpy( &vertices[size], attrib.GetDataPtr(), vertexCount * sizeof( _type_ ) );
+		attribs |= bit;
+	}
+}
+
+static void SetBounds( float out[2][3], const Bounds3f & bounds )
+{
+	for ( int i = 0; i < 2; i++ )
+	{
+		out[i][0] = bounds.b[i].x;
+		out[i][1] = bounds.b[i].y;
+		out[i][2] = bounds.b[i].z;
+	}
+}
+
+static void AddRenderModel( BinaryModelBuilder & builder, const JsonReader & render_model, BinaryModelInput & bin )
+{
+	// textures
+
+	Array< model_binary_texture_t > textures;
+
+	const JsonReader texture_array( render_model.GetChildByName( "textures" ) );
+	if ( texture_array.IsArray() )
+	{
+		while ( !texture_array.IsEndOfArray() )
+		{
+			const JsonReader texture( texture_array.GetNextArrayElement() );
+			if ( texture.IsObject() )
+			{
+				model_binary_texture_t & record = textures.PushDefault();
+				record.name = builder.AddString( texture.GetChildStringByName( "name" ).ToCStr() );
+
+				const String usage = texture.GetChildStringByName( "usage" );
+				record.usage = MODEL_BINARY_USAGE_COUNT;
+				if ( usage == "diffuse" )			{ record.usage = MODEL_BINARY_USAGE_DIFFUSE; }
+				else if ( usage == "normal" )		{ record.usage = MODEL_BINARY_USAGE_NORMAL; }
+				else if ( usage == "specular" )		{ record.usage = MODEL_BINARY_USAGE_SPECULAR; }
+				else if ( usage == "emissive" )		{ record.usage = MODEL_BINARY_USAGE_EMISSIVE; }
+				else if ( usage == "reflection" )	{ record.usage = MODEL_BINARY_USAGE_REFLECTION; }
+
+				const String occlusion = texture.GetChildStringByName( "occlusion" );
+				record.occlusion = MODEL_BINARY_OCCLUSION_OPAQUE;
+				if ( occlusion == "perforated" )		{ record.occlusion = MODEL_BINARY_OCCLUSION_PERFORATED; }
+				else if ( occlusion == "transparent" )	{ record.occlusion = MODEL_BINARY_OCCLUSION_TRANSPARENT; }
+			}
+		}
+	}
+	builder.AddChunk( MODEL_BINARY_CHUNK_TEXTURES, textures );
+
+	// joints
+
+	Array< model_binary_joint_t > joints;
+
+	const JsonReader joint_array( render_model.GetChildByName( "joints" ) );
+	if ( joint_array.IsArray() )
+	{
+		while ( !joint_array.IsEndOfArray() )
+		{
+			const JsonReader joint( joint_array.GetNextArrayElement() );
+			if ( joint.IsObject() )
+			{
+				model_binary_joint_t & record = joints.PushDefault();
+				record.name = builder.AddString( joint.GetChildStringByName( "name" ).ToCStr() );
+				StringUtils::StringTo( &record.transform[0][0], 16, joint.GetChildStringByName( "transform" ).ToCStr() );
+				const String animation = joint.GetChildStringByName( "animation" );
+				record.animation = 0;
+				if ( animation == "rotate" )		{ record.animation = 1; }
+				else if ( animation == "sway" )		{ record.animation = 2; }
+				else if ( animation == "bob" )		{ record.animation = 3; }
+				record.parameters[0] = joint.GetChildFloatByName( "parmX" );
+				record.parameters[1] = joint.GetChildFloatByName( "parmY" );
+				record.parameters[2] = joint.GetChildFloatByName( "parmZ" );
+				record.timeOffset = joint.GetChildFloatByName( "timeOffset" );
+				record.timeScale = joint.GetChildFloatByName( "timeScale" );
+			}
+		}
+	}
+	builder.AddChunk( MODEL_BINARY_CHUNK_JOINTS, joints );
+
+	// tags
+
+	Array< model_binary_tag_t > tags;
+
+	const JsonReader tag_array( render_model.GetChildByName( "tags" ) );
+	if ( tag_array.IsArray() )
+	{
+		while ( !tag_array.IsEndOfArray() )
+		{
+			const JsonReader tag( tag_array.GetNextArrayElement() );
+			if ( tag.IsObject() )
+			{
+				model_binary_tag_t & record = tags.PushDefault();
+				record.name = builder.AddString( tag.GetChildStringByName( "name" ).ToCStr() );
+				StringUtils::StringTo( &record.matrix[0][0], 16, tag.GetChildStringByName( "matrix" ).ToCStr() );
+				StringUtils::StringTo( record.jointIndices, 4, tag.GetChildStringByName( "jointIndices" ).ToCStr() );
+				StringUtils::StringTo( record.jointWeights, 4, tag.GetChildStringByName( "jointWeights" ).ToCStr() );
+			}
+		}
+	}
+	builder.AddChunk( MODEL_BINARY_CHUNK_TAGS, tags );
+
+	// surfaces
+
+	Array< model_binary_surface_t > surfaces;
+	Array< uint8_t > vertices;
+	Array< TriangleIndex > indices;
+
+	const JsonReader surface_array( render_model.GetChildByName( "surfaces" ) );
+	if ( surface_array.IsArray() )
+	{
+		while ( !surface_array.IsEndOfArray() )
+		{
+			const JsonReader surface( surface_array.GetNextArrayElement() );
+			if ( !surface.IsObject() )
+			{
+				continue;
+			}
+
+			model_binary_surface_t & record = surfaces.PushDefault();
+
+			String surfaceName;
+			const JsonReader source( surface.GetChildByName( "source" ) );
+			if ( source.IsArray() )
+			{
+				while ( !source.IsEndOfArray() )
+				{
+					if ( surfaceName.GetLength() )
+					{
+						surfaceName += ";";
+					}
+					surfaceName += source.GetNextArrayString();
+				}
+			}
+			record.name = builder.AddString( surfaceName.ToCStr() );
+
+			record.material = MODEL_BINARY_MATERIAL_OPAQUE;
+			for ( int i = 0; i < MODEL_BINARY_USAGE_COUNT; i++ )
+			{
+				record.textures[i] = -1;
+			}
+
+			const JsonReader material( surface.GetChildByName( "material" ) );
+			if ( material.IsObject() )
+			{
+				const String type = material.GetChildStringByName( "type" );
+				if ( type == "perforated" )			{ record.material = MODEL_BINARY_MATERIAL_PERFORATED; }
+				else if ( type == "transparent" )	{ record.material = MODEL_BINARY_MATERIAL_TRANSPARENT; }
+				else if ( type == "additive" )		{ record.material = MODEL_BINARY_MATERIAL_ADDITIVE; }
+
+				record.textures[MODEL_BINARY_USAGE_DIFFUSE]		= material.GetChildInt32ByName( "diffuse", -1 );
+				record.textures[MODEL_BINARY_USAGE_NORMAL]		= material.GetChildInt32ByName( "normal", -1 );
+				record.textures[MODEL_BINARY_USAGE_SPECULAR]	= material.GetChildInt32ByName( "specular", -1 );
+				record.textures[MODEL_BINARY_USAGE_EMISSIVE]	= material.GetChildInt32ByName( "emissive", -1 );
+				record.textures[MODEL_BINARY_USAGE_REFLECTION]	= material.GetChildInt32ByName( "reflection", -1 );
+			}
+
+			Array< Vector3f > position;
+			Array< Vector3f > normal;
+			Array< Vector3f > tangent;
+			Array< Vector3f > binormal;
+			Array< Vector4f > color;
+			Array< Vector2f > uv0;
+			Array< Vector2f > uv1;
+			Array< Vector4i > jointIndices;
+			Array< Vector4f > jointWeights;
+
+			int vertexCount = 0;
+			const JsonReader vertex_data( surface.GetChildByName( "vertices" ) );
+			if ( vertex_data.IsObject() )
+			{
+				vertexCount = Alg::Min( vertex_data.GetChildInt32ByName( "vertexCount" ), MAX_GEOMETRY_VERTICES );
+
+				ReadModelArray( position,     vertex_data.GetChildStringByName( "position" ).ToCStr(),		bin, vertexCount );
+				ReadModelArray( normal,       vertex_data.GetChildStringByName( "normal" ).ToCStr(),		bin, vertexCount );
+				ReadModelArray( tangent,      vertex_data.GetChildStringByName( "tangent" ).ToCStr(),		bin, vertexCount );
+				ReadModelArray( binormal,     vertex_data.GetChildStringByName( "binormal" ).ToCStr(),		bin, vertexCount );
+				ReadModelArray( color,        vertex_data.GetChildStringByName( "color" ).ToCStr(),			bin, vertexCount );
+				ReadModelArray( uv0,          vertex_data.GetChildStringByName( "uv0" ).ToCStr(),			bin, vertexCount );
+				ReadModelArray( uv1,          vertex_data.GetChildStringByName( "uv1" ).ToCStr(),			bin, vertexCount );
+				ReadModelArray( jointIndices, vertex_data.GetChildStringByName( "jointIndices" ).ToCStr(),	bin, vertexCount );
+				ReadModelArray( jointWeights, vertex_data.GetChildStringByName( "jointWeights" ).ToCStr(),	bin, vertexCount );
+			}
+
+			// the loader always computed the bounds from the positions
+			Bounds3f bounds;
+			bounds.Clear();
+			for ( int i = 0; i < position.GetSizeI(); i++ )
+			{
+				bounds.AddPoint( position[i] );
+			}
+			SetBounds( record.bounds, bounds );
+
+			record.vertexAttribs = 0;
+			record.vertexCount = position.GetSizeI();
+			record.vertexOffset = vertices.GetSizeI();
+			AppendVertexAttribute( vertices, record.vertexAttribs, MODEL_BINARY_ATTRIBUTE_POSITION,		position,		position.GetSizeI() );
+			AppendVertexAttribute( vertices, record.vertexAttribs, MODEL_BINARY_ATTRIBUTE_NORMAL,		normal,			position.GetSizeI() );
+			AppendVertexAttribute( vertices, record.vertexAttribs, MODEL_BINARY_ATTRIBUTE_TANGENT,		tangent,		position.GetSizeI() );
+			AppendVertexAttribute( vertices, record.vertexAttribs, MODEL_BINARY_ATTRIBUTE_BINORMAL,		binormal,		position.GetSizeI() );
+			AppendVertexAttribute( vertices, record.vertexAttribs, MODEL_BINARY_ATTRIBUTE_COLOR,		color,			position.GetSizeI() );
+			AppendVertexAttribute( vertices, record.vertexAttribs, MODEL_BINARY_ATTRIBUTE_UV0,			uv0,			position.GetSizeI() );
+			AppendVertexAttribute( vertices, record.vertexAttribs, MODEL_BINARY_ATTRIBUTE_UV1,			uv1,			position.GetSizeI() );
+			AppendVertexAttribute( vertices, record.vertexAttribs, MODEL_BINARY_ATTRIBUTE_JOINT_INDICES,	jointIndices,	position.GetSizeI() );
+			AppendVertexAttribute( vertices, record.vertexAttribs, MODEL_BINARY_ATTRIBUTE_JOINT_WEIGHTS,	jointWeights,	position.GetSizeI() );
+
+			Array< TriangleIndex > surfaceIndices;
+			const JsonReader triangles( surface.GetChildByName( "triangles" ) );
+			if ( triangles.IsObject() )
+			{
+				const int indexCount = triangles.GetChildInt32ByName( "indexCount" );
+				ReadModelArray( surfaceIndices, triangles.GetChildStringByName( "indices" ).ToCStr(), bin, indexCount );
+			}
+
+			record.indexCount = surfaceIndices.GetSizeI();
+			record.indexOffset = indices.GetSizeI() * sizeof( TriangleIndex );
+			indices.Append( surfaceIndices.GetDataPtr(), surfaceIndices.GetSize() );
+		}
+	}
+	builder.AddChunk( MODEL_BINARY_CHUNK_SURFACES, surfaces );
+	builder.AddChunk( MODEL_BINARY_CHUNK_VERTICES, vertices.GetDataPtr(), vertices.GetSizeI(), vertices.GetSizeI() );
+	builder.AddChunk( MODEL_BINARY_CHUNK_INDICES, indices );
+}
+
+static void AddCollisionModel( BinaryModelBuilder & builder, const JsonReader & collision_model, Array< Planef > & planes, const uint32_t id )
+{
+	Array< model_binary_polytope_t > polytopes;
+
+	while ( !collision_model.IsEndOfArray() )
+	{
+		const JsonReader polytope( collision_model.GetNextArrayElement() );
+
+		// the loader adds a polytope for every element
+		model_binary_polytope_t & record = polytopes.PushDefault();
+		record.name = 0;
+		record.firstPlane = planes.GetSizeI();
+		record.numPlanes = 0;
+
+		if ( polytope.IsObject() )
+		{
+			record.name = builder.AddString( polytope.GetChildStringByName( "name" ).ToCStr() );
+			Array< Planef > polytopePlanes;
+			StringUtils::StringTo( polytopePlanes, polytope.GetChildStringByName( "planes" ).ToCStr() );
+			planes.Append( polytopePlanes.GetDataPtr(), polytopePlanes.GetSize() );
+			record.numPlanes = polytopePlanes.GetSizeI();
+		}
+	}
+
+	builder.AddChunk( id, polytopes );
+}
+
+static void AddRayTraceModel( BinaryModelBuilder & builder, const JsonReader & raytrace_model, BinaryModelInput & bin )
+{
+	ModelTrace traceModel;
+
+	traceModel.header.numVertices	= raytrace_model.GetChildInt32ByName( "numVertices" );
+	traceModel.header.numUvs		= raytrace_model.GetChildInt32ByName( "numUvs" );
+	traceModel.header.numIndices	= raytrace_model.GetChildInt32ByName( "numIndices" );
+	traceModel.header.numNodes		= raytrace_model.GetChildInt32ByName( "numNodes" );
+	traceModel.header.numLeafs		= raytrace_model.GetChildInt32ByName( "numLeafs" );
+	traceModel.header.numOverflow	= raytrace_model.GetChildInt32ByName( "numOverflow" );
+	StringUtils::StringTo( traceModel.header.bounds, raytrace_model.GetChildStringByName( "bounds" ).ToCStr() );
+
+	ReadModelArray( traceModel.vertices, raytrace_model.GetChildStringByName( "vertices" ).ToCStr(), bin, traceModel.header.numVertices );
+	ReadModelArray( traceModel.uvs, raytrace_model.GetChildStringByName( "uvs" ).ToCStr(), bin, traceModel.header.numUvs );
+	ReadModelArray( traceModel.indices, raytrace_model.GetChildStringByName( "indices" ).ToCStr(), bin, traceModel.header.numIndices );
+
+	if ( !bin.ReadArray( traceModel.nodes, traceModel.header.numNodes ) )
+	{
+		const JsonReader nodes_array( raytrace_model.GetChildByName( "nodes" ) );
+		if ( nodes_array.IsArray() )
+		{
+			while ( !nodes_array.IsEndOfArray() )
+			{
+				kdtree_node_t & node = traceModel.nodes.PushDefault();
+				const JsonReader nodeReader( nodes_array.GetNextArrayElement() );
+				if ( nodeReader.IsObject() )
+				{
+					node.data = (uint32_t) nodeReader.GetChildInt64ByName( "data" );
+					node.dist = nodeReader.GetChildFloatByName( "dist" );
+				}
+			}
+		}
+	}
+
+	if ( !bin.ReadArray( traceModel.leafs, traceModel.header.numLeafs ) )
+	{
+		const JsonReader leafs_array( raytrace_model.GetChildByName( "leafs" ) );
+		if ( leafs_array.IsArray() )
+		{
+			while ( !leafs_array.IsEndOfArray() )
+			{
+				kdtree_leaf_t & leaf = traceModel.leafs.PushDefault();
+				const JsonReader leafReader( leafs_array.GetNextArrayElement() );
+				if ( leafReader.IsObject() )
+				{
+					StringUtils::StringTo( leaf.triangles, RT_KDTREE_MAX_LEAF_TRIANGLES, leafReader.GetChildStringByName( "triangles" ).ToCStr() );
+					StringUtils::StringTo( leaf.ropes, 6, leafReader.GetChildStringByName( "ropes" ).ToCStr() );
+					StringUtils::StringTo( leaf.bounds, leafReader.GetChildStringByName( "bounds" ).ToCStr() );
+				}
+			}
+		}
+	}
+
+	ReadModelArray( traceModel.overflow, raytrace_model.GetChildStringByName( "overflow" ).ToCStr(), bin, traceModel.header.numOverflow );
+
+	// the header always matches the arrays in the container
+	Array< model_binary_trace_t > header;
+	model_binary_trace_t & record = header.PushDefault();
+	record.numVertices	= traceModel.vertices.GetSizeI();
+	record.numUvs		= traceModel.uvs.GetSizeI();
+	record.numIndices	= traceModel.indices.GetSizeI();
+	record.numNodes		= traceModel.nodes.GetSizeI();
+	record.numLeafs		= traceModel.leafs.GetSizeI();
+	record.numOverflow	= traceModel.overflow.GetSizeI();
+	SetBounds( record.bounds, traceModel.header.bounds );
+
+	builder.AddChunk( MODEL_BINARY_CHUNK_TRACE, header );
+	builder.AddChunk( MODEL_BINARY_CHUNK_TRACE_VERTICES, traceModel.vertices );
+	builder.AddChunk( MODEL_BINARY_CHUNK_TRACE_UVS, traceModel.uvs );
+	builder.AddChunk( MODEL_BINARY_CHUNK_TRACE_INDICES, traceModel.indices );
+	builder.AddChunk( MODEL_BINARY_CHUNK_TRACE_NODES, traceModel.nodes );
+	builder.AddChunk( MODEL_BINARY_CHUNK_TRACE_LEAFS, traceModel.leafs );
+	builder.AddChunk( MODEL_BINARY_CHUNK_TRACE_OVERFLOW, traceModel.overflow );
+}
+
+bool Json2BinaryModel( const JSON * scene, const uint8_t * binary, const int binarySize, Array< uint8_t > & out )
+{
+	// skip the models.bin header
+	const uint32_t binaryHeader = 0x6272766F;	// little endian "ovrb"
+	if ( binary != NULL && ( binarySize < 4 || memcmp( binary, &binaryHeader, 4 ) != 0 ) )
+	{
+		return false;
+	}
+	BinaryModelInput bin( binary != NULL ? binary + 4 : NULL, binary != NULL ? binarySize - 4 : 0 );
+
+	BinaryModelBuilder builder;
+
+	const JsonReader models( scene );
+	if ( models.IsObject() )
+	{
+		const JsonReader render_model( models.GetChildByName( "render_model" ) );
+		if ( render_model.IsObject() )
+		{
+			AddRenderModel( builder, render_model, bin );
+		}
+
+		Array< Planef > planes;
+
+		const JsonReader collision_model( models.GetChildByName( "collision_model" ) );
+		if ( collision_model.IsArray() )
+		{
+			AddCollisionModel( builder, collision_model, planes, MODEL_BINARY_CHUNK_COLLISION );
+		}
+
+		const JsonReader ground_collision_model( models.GetChildByName( "ground_collision_model" ) );
+		if ( ground_collision_model.IsArray() )
+		{
+			AddCollisionModel( builder, ground_collision_model, planes, MODEL_BINARY_CHUNK_GROUND_COLLISION );
+		}
+
+		builder.AddChunk( MODEL_BINARY_CHUNK_PLANES, planes );
+
+		const JsonReader raytrace_model( models.GetChildByName( "raytrace_model" ) );
+		if ( raytrace_model.IsObject() )
+		{
+			AddRayTraceModel( builder, raytrace_model, bin );
+		}
+	}
+
+	if ( !bin.IsAtEnd() )
+	{
+		return false;
+	}
+
+	builder.Write( out );
+	return true;
+}
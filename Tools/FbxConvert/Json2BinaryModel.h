@@ -0,0 +1,19 @@
+/************************************************************************************
+
+Filename    :   Json2BinaryModel.h
+Content     :   Binary model container builder.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+#ifndef __JSON2BINARYMODEL_H__
+#define __JSON2BINARYMODEL_H__
+
+// Builds a models.ovrm container from the scene JSON and the binary data that are
+// otherwise written as models.json and models.bin. The binary data starts with the
+// models.bin header. Returns false if the binary data does not match the JSON.
+bool Json2BinaryModel( const JSON * scene, const uint8_t * binary, const int binarySize, Array< uint8_t > & out );
+
+#endif // !__JSON2BINARYMODEL_H__
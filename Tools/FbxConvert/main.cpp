@@ -35,6 +35,7 @@ using namespace OVR;
 #include "Raw2RenderModel.h"
 #include "Raw2CollisionModel.h"
 #include "Raw2RayTraceModel.h"
+#include "Json2BinaryModel.h"
 
 void ParseModelsJsonTest( const char * jsonFileName, const char * binFileName );
 
@@ -58,6 +59,7 @@ const char pathSeparator = '\\';
 #endif
 const char * jsonFileName = "models.json";
 const char * binaryFileName = "models.bin";
+const char * binaryModelFileName = "models.ovrm";
 
 enum TextureFormat
 {
@@ -109,6 +111,7 @@ struct options_t
 		texLodAniso( 0.0f ),
 
 		renderOrder( false ),
+		ovrm( false ),
 		outputToStdOut( false )
 	{
 	}
@@ -138,6 +141,7 @@ struct options_t
 	float				texLodAniso;
 
 	bool				renderOrder;
+	bool				ovrm;				// pack models.ovrm instead of models.json + models.bin
 
 	bool				fbxUtil;			// If set, don't pause on exit in debug mode
 	bool				outputToStdOut;		// Used by FBXUtil.exe to obtain surface information
@@ -276,6 +280,7 @@ static void ShowHelp()
 	printf( "-pack                           : Automatically run <output>_pack.bat file.\n" );
 	printf( "-zip <x>                        : 7-Zip compression level (0=none, 9=ultra).\n" );
 	printf( "-fullText                       : Store binary data as text in JSON file.\n" );
+	printf( "-ovrm                           : Pack models.ovrm instead of models.json + models.bin.\n" );
 	printf( "-noPush                         : Do not push to device in batch file.\n" );
 	printf( "-noTest                         : Do not run a test scene from batch file.\n" );
 	printf( "-cinema                         : Launch VrCinema instead of VrScene.\n" );
@@ -568,6 +573,46 @@ bool WriteBinary( const char * binaryPath,
 	return true;
 }
 
+bool WriteBinaryModel( const char * binaryModelPath,
+						const JSON * JSON_scene,
+						const ModelData * data_render_model,
+						const ModelData * data_collision_model,
+						const ModelData * data_ground_collision_model,
+						const ModelData * data_raytrace_model )
+{
+	// the same data that is written to models.bin
+	Array< uint8_t > binary;
+	const unsigned int header = 0x6272766F;	// little endian "ovrb"
+	binary.Append( (const uint8_t *)&header, sizeof( header ) );
+	const ModelData * data[] = { data_render_model, data_collision_model, data_ground_collision_model, data_raytrace_model };
+	for ( int i = 0; i < 4; i++ )
+	{
+		if ( data[i] != NULL )
+		{
+			binary.Append( data[i]->binary.GetDataPtr(), data[i]->binary.GetSize() );
+		}
+	}
+
+	Array< uint8_t > binaryModel;
+	if ( !Json2BinaryModel( JSON_scene, binary.GetDataPtr(), binary.GetSizeI(), binaryModel ) )
+	{
+		return false;
+	}
+
+	FILE * fp = fopen( binaryModelPath, "wb" );
+	if ( fp == NULL )
+	{
+		return false;
+	}
+	if ( fwrite( binaryModel.GetDataPtr(), binaryModel.GetSize(), 1, fp ) != 1 )
+	{
+		fclose( fp );
+		return false;
+	}
+	fclose( fp );
+	return true;
+}
+
 void RotateImage( const char * texturePath, const char * rotatedTexturePath, const int rotateDegrees )
 {
 	int angle = rotateDegrees;
@@ -703,8 +748,15 @@ bool CreateBatchFile( const char * batchFilePath, const char * exePath, const ch
 		fprintf( f, "rm -rf \"%s\"\n", pckFolder.ToCStr() );
 	}
 	fprintf( f, "mkdir \"%s\"\n", pckFolder.ToCStr() );
-	fprintf( f, "cp -r \"%s%s\" \"%s\"\n", tmpFolder.ToCStr(), jsonFileName, pckFolder.ToCStr() );
-	fprintf( f, "cp -r \"%s%s\" \"%s\"\n", tmpFolder.ToCStr(), binaryFileName, pckFolder.ToCStr() );
+	if ( options.ovrm )
+	{
+		fprintf( f, "cp -r \"%s%s\" \"%s\"\n", tmpFolder.ToCStr(), binaryModelFileName, pckFolder.ToCStr() );
+	}
+	else
+	{
+		fprintf( f, "cp -r \"%s%s\" \"%s\"\n", tmpFolder.ToCStr(), jsonFileName, pckFolder.ToCStr() );
+		fprintf( f, "cp -r \"%s%s\" \"%s\"\n", tmpFolder.ToCStr(), binaryFileName, pckFolder.ToCStr() );
+	}
 #else
 	fprintf( f, "rem Generated by FbxConvert\n" );
 	if ( options.clean )
@@ -712,8 +764,15 @@ bool CreateBatchFile( const char * batchFilePath, const char * exePath, const ch
 		fprintf( f, "rmdir /s /q \"%s\"\n", pckFolder.ToCStr() );
 	}
 	fprintf( f, "mkdir \"%s\"\n", pckFolder.ToCStr() );
-	fprintf( f, "copy /Y \"%s%s\" \"%s\"\n", tmpFolder.ToCStr(), jsonFileName, pckFolder.ToCStr() );
-	fprintf( f, "copy /Y \"%s%s\" \"%s\"\n", tmpFolder.ToCStr(), binaryFileName, pckFolder.ToCStr() );
+	if ( options.ovrm )
+	{
+		fprintf( f, "copy /Y \"%s%s\" \"%s\"\n", tmpFolder.ToCStr(), binaryModelFileName, pckFolder.ToCStr() );
+	}
+	else
+	{
+		fprintf( f, "copy /Y \"%s%s\" \"%s\"\n", tmpFolder.ToCStr(), jsonFileName, pckFolder.ToCStr() );
+		fprintf( f, "copy /Y \"%s%s\" \"%s\"\n", tmpFolder.ToCStr(), binaryFileName, pckFolder.ToCStr() );
+	}
 #endif
 
 	for ( int i = 0; i < raw.GetTextureCount(); i++ )
@@ -1329,6 +1388,10 @@ int main( int argc, char * argv[] )
 		{
 			options.fullText = true;
 		}
+		else if ( _stricmp( s, "ovrm" ) == 0 )
+		{
+			options.ovrm = true;
+		}
 		else if ( _stricmp( s, "noPush" ) == 0 )
 		{
 			options.pushToDevice = false;
@@ -1564,6 +1627,7 @@ int main( int argc, char * argv[] )
 
 	const String jsonPath = tempFolder + jsonFileName;	
 	const String binaryPath = tempFolder + binaryFileName;
+	const String binaryModelPath = tempFolder + binaryModelFileName;
 
 	if ( options.outputToStdOut )
 	{
@@ -1587,6 +1651,17 @@ int main( int argc, char * argv[] )
 			Error( "failed to write '%s'\n", jsonPath.ToCStr() );
 		}
 
+		printf( "writing %s\n", binaryModelPath.ToCStr() );
+		if ( !WriteBinaryModel( binaryModelPath.ToCStr(),
+								JSON_scene,
+								data_render_model,
+								data_collision_model,
+								data_ground_collision_model,
+								data_raytrace_model ) )
+		{
+			Error( "failed to write '%s'\n", binaryModelPath.ToCStr() );
+		}
+
 		JSON_scene->Release();
 
 		printf( "writing %s\n", binaryPath.ToCStr() );
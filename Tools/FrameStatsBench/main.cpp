@@ -0,0 +1,316 @@
+/************************************************************************************
+
+Filename    :   main.cpp
+Content     :   Drives ovrFrameStats with a simulated VR thread loop on a fake clock,
+				checks the statistics against a reference and times the recording.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "Kernel/OVR_System.h"
+#include "Kernel/OVR_Alg.h"
+
+#include "OVR_FrameStats.h"
+
+using namespace OVR;
+
+// The fake clock counts whole microseconds, so every run sees the same times.
+static long long FakeMicroseconds;
+
+static double FakeClock()
+{
+	return FakeMicroseconds * 1e-6;
+}
+
+static const long long VSYNC_MICROSECONDS = 16667;
+static const int NUM_FRAMES = 2000;				// wraps the ring a few times
+static const int PAUSE_FRAME = 1500;			// leaves VR mode for 5 seconds before this frame
+static const long long PAUSE_MICROSECONDS = 5000000;
+
+static const long long ADVANCE_MICROSECONDS = 1000;
+static const long long DRAW_MICROSECONDS = 1500;	// before the wait for the next vsync
+
+// Time in VrAppInterface::Frame: mostly 5 ms, with a slow frame every 7 frames that
+// still fits and a one, two and four refresh hitch every 20, 50 and 100 frames.
+static long long AppFrameMicroseconds( const int frame )
+{
+	if ( frame % 100 == 0 )
+	{
+		return 70000;
+	}
+	if ( frame % 50 == 0 )
+	{
+		return 40000;
+	}
+	if ( frame % 20 == 0 )
+	{
+		return 25000;
+	}
+	if ( frame % 7 == 0 )
+	{
+		return 12000;
+	}
+	return 5000;
+}
+
+// Wake up latency after the vsync, 0 to 399 us.
+static long long WakeUpMicroseconds( const int frame )
+{
+	return ( ( frame * 2654435761u ) >> 7 ) % 400;
+}
+
+static long long NextVsync( const long long time )
+{
+	return ( time / VSYNC_MICROSECONDS + 1 ) * VSYNC_MICROSECONDS;
+}
+
+struct ovrReferenceFrame
+{
+	long long	Interval;
+	long long	Phases[FRAME_PHASE_MAX];
+};
+
+// Runs the loop the way AppLocal::VrThreadFunction drives the stats and writes
+// down the interval and phase times each frame should get.
+static void SimulateLoop( ovrFrameStats & stats, ovrReferenceFrame * reference, int & numReference )
+{
+	FakeMicroseconds = 0;
+	stats.SetClock( FakeClock );
+	stats.SetFramePeriod( VSYNC_MICROSECONDS * 1e-6 );
+
+	numReference = 0;
+	long long frameStart = -1;
+	long long phases[FRAME_PHASE_MAX] = {};
+
+	for ( int frame = 1; frame <= NUM_FRAMES; frame++ )
+	{
+		if ( frame == PAUSE_FRAME )
+		{
+			stats.DiscardFrame();
+			FakeMicroseconds += PAUSE_MICROSECONDS;
+			FakeMicroseconds = NextVsync( FakeMicroseconds );
+			frameStart = -1;
+		}
+
+		// message processing before the frame starts
+		FakeMicroseconds += WakeUpMicroseconds( frame );
+
+		if ( frameStart >= 0 )
+		{
+			ovrReferenceFrame & ref = reference[numReference++];
+			ref.Interval = FakeMicroseconds - frameStart;
+			for ( int i = 0; i < FRAME_PHASE_MAX; i++ )
+			{
+				ref.Phases[i] = phases[i];
+			}
+		}
+		frameStart = FakeMicroseconds;
+
+		stats.BeginFrame();
+		stats.BeginPhase( FRAME_PHASE_ADVANCE );
+		FakeMicroseconds += ADVANCE_MICROSECONDS;
+		phases[FRAME_PHASE_ADVANCE] = ADVANCE_MICROSECONDS;
+
+		stats.BeginPhase( FRAME_PHASE_FRAME );
+		FakeMicroseconds += AppFrameMicroseconds( frame );
+		phases[FRAME_PHASE_FRAME] = AppFrameMicroseconds( frame );
+
+		stats.BeginPhase( FRAME_PHASE_DRAW );
+		const long long drawStart = FakeMicroseconds;
+		FakeMicroseconds = NextVsync( FakeMicroseconds + DRAW_MICROSECONDS );
+		phases[FRAME_PHASE_DRAW] = FakeMicroseconds - drawStart;
+		stats.EndPhase();
+
+		stats.LogIfDue();
+	}
+}
+
+static double ReferencePercentile( const double * sorted, const int count, const double fraction )
+{
+	const int rank = Alg::Clamp( (int)ceil( fraction * count ) - 1, 0, count - 1 );
+	return sorted[rank];
+}
+
+static bool Near( const double a, const double b )
+{
+	return fabs( a - b ) <= 1e-6 * Alg::Max( 1.0, fabs( b ) );
+}
+
+static bool Check( const char * name, const double value, const double expected )
+{
+	const bool ok = Near( value, expected );
+	printf( "%-22s %12.6f expected %12.6f %s\n", name, value, expected, ok ? "ok" : "WRONG" );
+	return ok;
+}
+
+// Recomputes the summary from the reference frames with plain code.
+static bool CheckSummary( const ovrFrameStatsSummary & summary, const ovrReferenceFrame * reference, const int numReference )
+{
+	const double period = VSYNC_MICROSECONDS * 1e-6;
+	const int first = Alg::Max( 0, numReference - ovrFrameStats::MAX_FRAMES );
+	const int count = numReference - first;
+
+	double intervals[ovrFrameStats::MAX_FRAMES];
+	double mean = 0.0;
+	double phaseMean[FRAME_PHASE_MAX] = {};
+	double phaseMax[FRAME_PHASE_MAX] = {};
+	int hitches[NUM_HITCH_THRESHOLDS] = {};
+	long long totalHitches[NUM_HITCH_THRESHOLDS] = {};
+	int missed = 0;
+	long long totalMissed = 0;
+	for ( int i = 0; i < numReference; i++ )
+	{
+		const double interval = reference[i].Interval * 1e-6;
+		const int refreshes = (int)( reference[i].Interval + VSYNC_MICROSECONDS / 2 ) / (int)VSYNC_MICROSECONDS;
+		totalMissed += refreshes - 1;
+		for ( int j = 0; j < NUM_HITCH_THRESHOLDS; j++ )
+		{
+			totalHitches[j] += ( interval > ovrFrameStats::HitchThresholds[j] * period );
+		}
+		if ( i < first )
+		{
+			continue;
+		}
+		intervals[i - first] = interval;
+		mean += interval / count;
+		missed += refreshes - 1;
+		for ( int j = 0; j < NUM_HITCH_THRESHOLDS; j++ )
+		{
+			hitches[j] += ( interval > ovrFrameStats::HitchThresholds[j] * period );
+		}
+		for ( int j = 0; j < FRAME_PHASE_MAX; j++ )
+		{
+			phaseMean[j] += reference[i].Phases[j] * 1e-6 / count;
+			phaseMax[j] = Alg::Max( phaseMax[j], reference[i].Phases[j] * 1e-6 );
+		}
+	}
+	double variance = 0.0;
+	for ( int i = 0; i < count; i++ )
+	{
+		variance += ( intervals[i] - mean ) * ( intervals[i] - mean ) / count;
+	}
+	Alg::QuickSortSliced( intervals, 0, count, Alg::OperatorLess< double >::Compare );
+
+	bool ok = true;
+	ok &= Check( "frames", summary.NumFrames, count );
+	ok &= Check( "total frames", (double)summary.TotalFrames, numReference );
+	ok &= Check( "mean interval", summary.MeanInterval, mean );
+	ok &= Check( "p50 interval", summary.MedianInterval, ReferencePercentile( intervals, count, 0.5 ) );
+	ok &= Check( "p90 interval", summary.Percentile90Interval, ReferencePercentile( intervals, count, 0.9 ) );
+	ok &= Check( "p99 interval", summary.Percentile99Interval, ReferencePercentile( intervals, count, 0.99 ) );
+	ok &= Check( "max interval", summary.MaxInterval, intervals[count - 1] );
+	ok &= Check( "jitter", summary.Jitter, sqrt( variance ) );
+	for ( int j = 0; j < NUM_HITCH_THRESHOLDS; j++ )
+	{
+		char name[64];
+		snprintf( name, sizeof( name ), "hitches > %.1fx", ovrFrameStats::HitchThresholds[j] );
+		ok &= Check( name, summary.Hitches[j], hitches[j] );
+		snprintf( name, sizeof( name ), "total hitches > %.1fx", ovrFrameStats::HitchThresholds[j] );
+		ok &= Check( name, (double)summary.TotalHitches[j], (double)totalHitches[j] );
+	}
+	ok &= Check( "missed refreshes", summary.MissedRefreshes, missed );
+	ok &= Check( "total missed", (double)summary.TotalMissedRefreshes, (double)totalMissed );
+	for ( int j = 0; j < FRAME_PHASE_MAX; j++ )
+	{
+		char name[64];
+		snprintf( name, sizeof( name ), "phase %d mean", j );
+		ok &= Check( name, summary.PhaseMean[j], phaseMean[j] );
+		snprintf( name, sizeof( name ), "phase %d max", j );
+		ok &= Check( name, summary.PhaseMax[j], phaseMax[j] );
+	}
+
+	// The pause must not show up as a frame.
+	ok &= ( summary.MaxInterval < 1.0 );
+	return ok;
+}
+
+static const int NUM_TIMED_FRAMES = 2000000;
+
+// Cost of the calls the VR thread makes every frame, with the real clock.
+static double TimeRecording()
+{
+	ovrFrameStats stats;
+	stats.SetLogPeriod( 0.0 );
+	const double start = ovrFrameStats::GetMonotonicSeconds();
+	for ( int i = 0; i < NUM_TIMED_FRAMES; i++ )
+	{
+		stats.SetFramePeriod( 1.0 / 60.0 );
+		stats.BeginFrame();
+		stats.BeginPhase( FRAME_PHASE_ADVANCE );
+		stats.BeginPhase( FRAME_PHASE_FRAME );
+		stats.BeginPhase( FRAME_PHASE_DRAW );
+		stats.EndPhase();
+		stats.LogIfDue();
+	}
+	return ( ovrFrameStats::GetMonotonicSeconds() - start ) * 1e9 / NUM_TIMED_FRAMES;
+}
+
+static double TimeSummary( const ovrFrameStats & stats )
+{
+	const int count = 2000;
+	ovrFrameStatsSummary summary;
+	const double start = ovrFrameStats::GetMonotonicSeconds();
+	for ( int i = 0; i < count; i++ )
+	{
+		stats.GetSummary( summary );
+	}
+	return ( ovrFrameStats::GetMonotonicSeconds() - start ) * 1e6 / count;
+}
+
+static int RunBenchmark()
+{
+	static ovrReferenceFrame reference[NUM_FRAMES];
+	int numReference = 0;
+
+	// Two runs on fresh objects must agree to the bit.
+	ovrFrameStats * stats = new ovrFrameStats();
+	stats->SetLogPeriod( 10.0 );
+	SimulateLoop( *stats, reference, numReference );
+	ovrFrameStatsSummary summary;
+	stats->GetSummary( summary );
+
+	ovrFrameStats * stats2 = new ovrFrameStats();
+	SimulateLoop( *stats2, reference, numReference );
+	ovrFrameStatsSummary summary2;
+	stats2->GetSummary( summary2 );
+	delete stats2;
+
+	const bool deterministic = memcmp( &summary, &summary2, sizeof( summary ) ) == 0;
+	printf( "deterministic          %s\n", deterministic ? "ok" : "WRONG" );
+	const bool summaryOk = CheckSummary( summary, reference, numReference );
+
+	StringBuffer text;
+	stats->DumpText( text );
+	printf( "%s", text.ToCStr() );
+
+	printf( "recording              %6.1f ns per frame\n", TimeRecording() );
+	printf( "summary                %6.1f us\n", TimeSummary( *stats ) );
+	delete stats;
+
+	const bool ok = deterministic && summaryOk;
+	printf( "%s\n", ok ? "PASSED" : "FAILED" );
+	return ok ? 0 : 1;
+}
+
+int main( int const argc, char const * argv[] )
+{
+	if ( argc > 1 )
+	{
+		printf( "USAGE: FrameStatsBench\n" );
+		return 1;
+	}
+
+	System::Init( Log::ConfigureDefaultLog( LogMask_None ) );
+	const int result = RunBenchmark();
+	System::Destroy();
+
+	return result;
+}
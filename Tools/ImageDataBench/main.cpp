@@ -0,0 +1,1263 @@
+/************************************************************************************
+
+Filename    :   main.cpp
+Content     :   Checks the ImageData mip chain and resampler against the versions
+				they replaced, measures the quality of the ETC2 encoder, and
+				benchmarks all of them.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "Kernel/OVR_System.h"
+#include "Kernel/OVR_Alg.h"
+#include "ImageData.h"
+#include "BenchCommon.h"
+
+using namespace OVR;
+
+struct ovrBenchOptions
+{
+	ovrBenchOptions() :
+		MipWidth( 4096 ),
+		MipHeight( 2048 ),
+		ScaleWidth( 8192 ),
+		ScaleHeight( 4096 ),
+		ScaledWidth( 256 ),
+		ScaledHeight( 128 ),
+		EncodeSize( 1024 ),
+		NumThreads( 4 ),
+		NumIterations( 5 ) {}
+
+	int		MipWidth;
+	int		MipHeight;
+	int		ScaleWidth;
+	int		ScaleHeight;
+	int		ScaledWidth;
+	int		ScaledHeight;
+	int		EncodeSize;
+	int		NumThreads;
+	int		NumIterations;
+};
+
+// Every byte random, so the sRGB averages cover as much of the curve as possible.
+static unsigned char * BuildNoiseImage( const int width, const int height, uint32_t seed )
+{
+	unsigned char * image = (unsigned char *)malloc( width * height * 4 );
+	for ( int i = 0; i < width * height * 4; i++ )
+	{
+		image[i] = (unsigned char)Random( seed );
+	}
+	return image;
+}
+
+// Smooth gradients with a little noise and an alpha ramp, like a photo or a poster.
+static unsigned char * BuildPhotoImage( const int width, const int height, uint32_t seed )
+{
+	unsigned char * image = (unsigned char *)malloc( width * height * 4 );
+	for ( int y = 0; y < height; y++ )
+	{
+		for ( int x = 0; x < width; x++ )
+		{
+			unsigned char * p = &image[( y * width + x ) * 4];
+			const int noise = Random( seed ) & 7;
+			p[0] = (unsigned char)Alg::Min( 255, x * 255 / width + noise );
+			p[1] = (unsigned char)Alg::Min( 255, y * 255 / height + noise );
+			p[2] = (unsigned char)( 128 + 127 * sinf( x * 0.01f ) * cosf( y * 0.013f ) );
+			p[3] = (unsigned char)( ( x + y ) * 255 / ( width + height ) );
+		}
+	}
+	return image;
+}
+
+// A zone plate: rings that get finer towards the edges, so every scale factor
+// has detail above its Nyquist limit that a point sampled shrink aliases.
+static unsigned char * BuildZonePlateImage( const int width, const int height )
+{
+	unsigned char * image = (unsigned char *)malloc( width * height * 4 );
+	const float k = 3.14159265f / Alg::Max( width, height );
+	for ( int y = 0; y < height; y++ )
+	{
+		for ( int x = 0; x < width; x++ )
+		{
+			unsigned char * p = &image[( y * width + x ) * 4];
+			const float dx = x - width * 0.5f;
+			const float dy = y - height * 0.5f;
+			const float r2 = dx * dx + dy * dy;
+			p[0] = (unsigned char)( 127.5f + 127.5f * cosf( k * r2 ) );
+			p[1] = (unsigned char)( 127.5f + 127.5f * cosf( k * r2 * 0.5f ) );
+			p[2] = (unsigned char)( 127.5f + 127.5f * cosf( k * dx * dx ) );
+			p[3] = (unsigned char)( y * 255 / height );
+		}
+	}
+	return image;
+}
+
+// PSNR over all four channels, 99 dB for identical images.
+static double ImagePSNR( const unsigned char * a, const unsigned char * b, const int width, const int height )
+{
+	double sum = 0.0;
+	for ( int i = 0; i < width * height * 4; i++ )
+	{
+		const double d = (double)a[i] - (double)b[i];
+		sum += d * d;
+	}
+	if ( sum == 0.0 )
+	{
+		return 99.0;
+	}
+	return 10.0 * log10( 255.0 * 255.0 / ( sum / ( width * height * 4 ) ) );
+}
+
+//==============================================================
+// The versions ImageData replaced
+//==============================================================
+
+inline int ReferenceAbsInt( const int x )
+{
+	const int mask = x >> ( sizeof( int )* 8 - 1 );
+	return ( x + mask ) ^ mask;
+}
+
+inline int ReferenceClampInt( const int x, const int min, const int max )
+{
+	return min + ( ( ReferenceAbsInt( x - min ) - ReferenceAbsInt( x - min - max ) + max ) >> 1 );
+}
+
+static float ReferenceSRGBToLinear( float c )
+{
+	const float a = 0.055f;
+	if ( c <= 0.04045f )
+	{
+		return c * ( 1.0f / 12.92f );
+	}
+	else
+	{
+		return powf( ( ( c + a ) * ( 1.0f / ( 1.0f + a ) ) ), 2.4f );
+	}
+}
+
+static float ReferenceLinearToSRGB( float c )
+{
+	const float a = 0.055f;
+	if ( c <= 0.0031308f )
+	{
+		return c * 12.92f;
+	}
+	else
+	{
+		return ( 1.0f + a ) * powf( c, ( 1.0f / 2.4f ) ) - a;
+	}
+}
+
+// QuarterImageSize as it was: powf per channel, and a new table every call.
+static unsigned char * ReferenceQuarterImageSize( const unsigned char * src, const int width, const int height, const bool srgb )
+{
+	float table[256];
+	if ( srgb )
+	{
+		for ( int i = 0; i < 256; i++ )
+		{
+			table[ i ] = ReferenceSRGBToLinear( i * ( 1.0f / 255.0f ) );
+		}
+	}
+
+	const int newWidth = OVR::Alg::Max( 1, width >> 1 );
+	const int newHeight = OVR::Alg::Max( 1, height >> 1 );
+	unsigned char * out = (unsigned char *)malloc( newWidth * newHeight * 4 );
+	unsigned char * out_p = out;
+	for ( int y = 0; y < newHeight; y++ )
+	{
+		const unsigned char * in_p = src + y * 2 * width * 4;
+		for ( int x = 0; x < newWidth; x++ )
+		{
+			for ( int i = 0; i < 4; i++ )
+			{
+				if ( srgb )
+				{
+					const float linear = ( table[ in_p[ i ] ] +
+						table[ in_p[ 4 + i ] ] +
+						table[ in_p[ width * 4 + i ] ] +
+						table[ in_p[ width * 4 + 4 + i ] ] ) * 0.25f;
+					const float gamma = ReferenceLinearToSRGB( linear );
+					out_p[ i ] = ( unsigned char )ReferenceClampInt( ( int )( gamma * 255.0f + 0.5f ), 0, 255 );
+				}
+				else
+				{
+					out_p[ i ] = ( in_p[ i ] +
+						in_p[ 4 + i ] +
+						in_p[ width * 4 + i ] +
+						in_p[ width * 4 + 4 + i ] ) >> 2;
+				}
+			}
+			out_p += 4;
+			in_p += 8;
+		}
+	}
+	return out;
+}
+
+inline float ReferenceFracFloat( const float x )
+{
+	return x - floorf( x );
+}
+
+static const float REFERENCE_BICUBIC_SHARPEN = 0.75f;	// same as default PhotoShop bicubic filter
+
+static void ReferenceFilterWeights( const float s, const int filter, float weights[ 4 ] )
+{
+	switch ( filter )
+	{
+	case IMAGE_FILTER_NEAREST:
+	{
+				weights[ 0 ] = 1.0f;
+				break;
+	}
+	case IMAGE_FILTER_LINEAR:
+	{
+				weights[ 0 ] = 1.0f - s;
+				weights[ 1 ] = s;
+				break;
+	}
+	case IMAGE_FILTER_CUBIC:
+	{
+				weights[ 0 ] = ( ( ( ( +0.0f - REFERENCE_BICUBIC_SHARPEN ) * s + ( +0.0f + 2.0f * REFERENCE_BICUBIC_SHARPEN ) ) * s + ( -REFERENCE_BICUBIC_SHARPEN ) ) * s + ( 0.0f ) );
+				weights[ 1 ] = ( ( ( ( +2.0f - REFERENCE_BICUBIC_SHARPEN ) * s + ( -3.0f + 1.0f * REFERENCE_BICUBIC_SHARPEN ) ) * s + ( 0.0f ) ) * s + ( 1.0f ) );
+				weights[ 2 ] = ( ( ( ( -2.0f + REFERENCE_BICUBIC_SHARPEN ) * s + ( +3.0f - 2.0f * REFERENCE_BICUBIC_SHARPEN ) ) * s + ( REFERENCE_BICUBIC_SHARPEN ) ) * s + ( 0.0f ) );
+				weights[ 3 ] = ( ( ( ( +0.0f + REFERENCE_BICUBIC_SHARPEN ) * s + ( +0.0f - 1.0f * REFERENCE_BICUBIC_SHARPEN ) ) * s + ( 0.0f ) ) * s + ( 0.0f ) );
+				break;
+	}
+	}
+}
+
+// ScaleImageRGBA as it was, linear path only, which is what the callers use: a
+// fixed footprint of up to 4x4 source pixels per output whatever the scale, and
+// a float copy of the whole source.
+static unsigned char * ReferenceScaleImageRGBA( const unsigned char * src, const int width, const int height,
+		const int newWidth, const int newHeight, const ImageFilter filter )
+{
+	if ( src == NULL || width * height <= 0 )
+	{
+		return NULL;
+	}
+
+	int footprintMin = 0;
+	int footprintMax = 0;
+	int offsetX = 0;
+	int offsetY = 0;
+	switch ( filter )
+	{
+	case IMAGE_FILTER_NEAREST:
+	{
+				footprintMin = 0;
+				footprintMax = 0;
+				offsetX = width;
+				offsetY = height;
+				break;
+	}
+	case IMAGE_FILTER_LINEAR:
+	{
+				footprintMin = 0;
+				footprintMax = 1;
+				offsetX = width - newWidth;
+				offsetY = height - newHeight;
+				break;
+	}
+	case IMAGE_FILTER_CUBIC:
+	{
+				footprintMin = -1;
+				footprintMax = 2;
+				offsetX = width - newWidth;
+				offsetY = height - newHeight;
+				break;
+	}
+	default:
+		return NULL;
+	}
+
+	unsigned char * scaled = ( unsigned char * )malloc( newWidth * newHeight * 4 * sizeof( unsigned char ) );
+
+	float * srcLinear = ( float * )malloc( (size_t)width * height * 4 * sizeof( float ) );
+	float * scaledLinear = ( float * )malloc( newWidth * newHeight * 4 * sizeof( float ) );
+
+	float table[ 256 ];
+	for ( int i = 0; i < 256; i++ )
+	{
+		table[ i ] = ReferenceSRGBToLinear( i * ( 1.0f / 255.0f ) );
+	}
+
+	for ( int y = 0; y < height; y++ )
+	{
+		for ( int x = 0; x < width; x++ )
+		{
+			for ( int c = 0; c < 4; c++ )
+			{
+				srcLinear[ ( (size_t)y * width + x ) * 4 + c ] = table[ src[ ( (size_t)y * width + x ) * 4 + c ] ];
+			}
+		}
+	}
+
+	for ( int y = 0; y < newHeight; y++ )
+	{
+		const int srcY = ( y * height * 2 + offsetY ) / ( newHeight * 2 );
+		const float fracY = ReferenceFracFloat( ( ( float )y * height * 2.0f + offsetY ) / ( newHeight * 2.0f ) );
+
+		float weightsY[ 4 ] = { 0 };
+		ReferenceFilterWeights( fracY, filter, weightsY );
+
+		for ( int x = 0; x < newWidth; x++ )
+		{
+			const int srcX = ( x * width * 2 + offsetX ) / ( newWidth * 2 );
+			const float fracX = ReferenceFracFloat( ( ( float )x * width * 2.0f + offsetX ) / ( newWidth * 2.0f ) );
+
+			float weightsX[ 4 ] = { 0 };
+			ReferenceFilterWeights( fracX, filter, weightsX );
+
+			float fR = 0.0f;
+			float fG = 0.0f;
+			float fB = 0.0f;
+			float fA = 0.0f;
+
+			for ( int fpY = footprintMin; fpY <= footprintMax; fpY++ )
+			{
+				const float wY = weightsY[ fpY - footprintMin ];
+
+				for ( int fpX = footprintMin; fpX <= footprintMax; fpX++ )
+				{
+					const float wX = weightsX[ fpX - footprintMin ];
+					const float wXY = wX * wY;
+
+					const int cx = ReferenceClampInt( srcX + fpX, 0, width - 1 );
+					const int cy = ReferenceClampInt( srcY + fpY, 0, height - 1 );
+					fR += srcLinear[ ( (size_t)cy * width + cx ) * 4 + 0 ] * wXY;
+					fG += srcLinear[ ( (size_t)cy * width + cx ) * 4 + 1 ] * wXY;
+					fB += srcLinear[ ( (size_t)cy * width + cx ) * 4 + 2 ] * wXY;
+					fA += srcLinear[ ( (size_t)cy * width + cx ) * 4 + 3 ] * wXY;
+				}
+			}
+
+			scaledLinear[ ( y * newWidth + x ) * 4 + 0 ] = fR;
+			scaledLinear[ ( y * newWidth + x ) * 4 + 1 ] = fG;
+			scaledLinear[ ( y * newWidth + x ) * 4 + 2 ] = fB;
+			scaledLinear[ ( y * newWidth + x ) * 4 + 3 ] = fA;
+		}
+	}
+
+	for ( int y = 0; y < newHeight; y++ )
+	{
+		for ( int x = 0; x < newWidth; x++ )
+		{
+			for ( int c = 0; c < 4; c++ )
+			{
+				const float gamma = ReferenceLinearToSRGB( scaledLinear[ ( y * newWidth + x ) * 4 + c ] );
+				scaled[ ( y * newWidth + x ) * 4 + c ] = ( unsigned char )ReferenceClampInt( ( int )( gamma * 255.0f + 0.5f ), 0, 255 );
+			}
+		}
+	}
+
+	free( scaledLinear );
+	free( srcLinear );
+
+	return scaled;
+}
+
+// The ideal shrink by an integer factor: the average of each block in linear space.
+static unsigned char * BoxShrinkImage( const unsigned char * src, const int width, const int height, const int factor )
+{
+	float table[256];
+	for ( int i = 0; i < 256; i++ )
+	{
+		table[i] = ReferenceSRGBToLinear( i * ( 1.0f / 255.0f ) );
+	}
+	const int newWidth = width / factor;
+	const int newHeight = height / factor;
+	unsigned char * out = (unsigned char *)malloc( newWidth * newHeight * 4 );
+	for ( int y = 0; y < newHeight; y++ )
+	{
+		for ( int x = 0; x < newWidth; x++ )
+		{
+			double sum[4] = {};
+			for ( int by = 0; by < factor; by++ )
+			{
+				const unsigned char * p = &src[( ( y * factor + by ) * width + x * factor ) * 4];
+				for ( int bx = 0; bx < factor * 4; bx++ )
+				{
+					sum[bx & 3] += table[p[bx]];
+				}
+			}
+			for ( int c = 0; c < 4; c++ )
+			{
+				const float linear = (float)( sum[c] / ( factor * factor ) );
+				out[( y * newWidth + x ) * 4 + c] = (unsigned char)ReferenceClampInt( (int)( ReferenceLinearToSRGB( linear ) * 255.0f + 0.5f ), 0, 255 );
+			}
+		}
+	}
+	return out;
+}
+
+// The old QuarterImageSize read past a source that is one pixel wide or high. The
+// new one repeats that pixel, so the reference gets a copy with it repeated.
+static unsigned char * ReferenceQuarterLevel( const unsigned char * src, const int width, const int height, const bool srgb )
+{
+	if ( width > 1 && height > 1 )
+	{
+		return ReferenceQuarterImageSize( src, width, height, srgb );
+	}
+	const int paddedWidth = Alg::Max( width, 2 );
+	const int paddedHeight = Alg::Max( height, 2 );
+	unsigned char * padded = (unsigned char *)malloc( paddedWidth * paddedHeight * 4 );
+	for ( int y = 0; y < paddedHeight; y++ )
+	{
+		for ( int x = 0; x < paddedWidth; x++ )
+		{
+			memcpy( &padded[( y * paddedWidth + x ) * 4], &src[( Alg::Min( y, height - 1 ) * width + Alg::Min( x, width - 1 ) ) * 4], 4 );
+		}
+	}
+	unsigned char * out = ReferenceQuarterImageSize( padded, paddedWidth, paddedHeight, srgb );
+	free( padded );
+	return out;
+}
+
+// A mip chain the way the texture code built it before BuildMipChainRGBA: one
+// QuarterImageSize per level.
+static unsigned char * ReferenceMipChain( const unsigned char * src, const int width, const int height, const bool srgb,
+		int & outNumLevels, size_t & outSize )
+{
+	size_t size = 0;
+	int numLevels = 0;
+	for ( int w = width, h = height; ; w = Alg::Max( 1, w >> 1 ), h = Alg::Max( 1, h >> 1 ) )
+	{
+		size += w * h * 4;
+		numLevels++;
+		if ( w == 1 && h == 1 )
+		{
+			break;
+		}
+	}
+
+	unsigned char * chain = (unsigned char *)malloc( size );
+	memcpy( chain, src, width * height * 4 );
+	unsigned char * level = chain;
+	for ( int w = width, h = height; w > 1 || h > 1; w = Alg::Max( 1, w >> 1 ), h = Alg::Max( 1, h >> 1 ) )
+	{
+		unsigned char * next = ReferenceQuarterLevel( level, w, h, srgb );
+		level += w * h * 4;
+		memcpy( level, next, Alg::Max( 1, w >> 1 ) * Alg::Max( 1, h >> 1 ) * 4 );
+		free( next );
+	}
+
+	outNumLevels = numLevels;
+	outSize = size;
+	return chain;
+}
+
+//==============================================================
+// Mip chains
+//==============================================================
+
+// Compares the new mip chain with the reference for odd, thin and power of two
+// sizes. Both directions of the sRGB conversion are table driven now and must
+// give exactly the bytes powf gave.
+static bool CheckMipChains()
+{
+	struct ovrImageSize { int Width; int Height; };
+	static const ovrImageSize sizes[] = { { 256, 256 }, { 255, 129 }, { 1000, 600 }, { 37, 5 }, { 1, 64 }, { 64, 1 }, { 1, 1 } };
+	static const int threadCounts[] = { 1, 3 };
+
+	bool ok = true;
+	int numBytes = 0;
+	for ( int s = 0; s < (int)( sizeof( sizes ) / sizeof( sizes[0] ) ); s++ )
+	{
+		const int width = sizes[s].Width;
+		const int height = sizes[s].Height;
+		unsigned char * image = BuildNoiseImage( width, height, s + 1 );
+
+		for ( int srgb = 0; srgb < 2; srgb++ )
+		{
+			int refLevels = 0;
+			size_t refSize = 0;
+			unsigned char * reference = ReferenceMipChain( image, width, height, srgb != 0, refLevels, refSize );
+
+			// one level at a time
+			if ( width > 1 && height > 1 )
+			{
+				unsigned char * quarter = QuarterImageSize( image, width, height, srgb != 0 );
+				if ( memcmp( quarter, reference + width * height * 4, ( width >> 1 ) * ( height >> 1 ) * 4 ) != 0 )
+				{
+					printf( "FAILED: QuarterImageSize %dx%d %s differs\n", width, height, srgb ? "srgb" : "linear" );
+					ok = false;
+				}
+				free( quarter );
+			}
+
+			for ( int t = 0; t < (int)( sizeof( threadCounts ) / sizeof( threadCounts[0] ) ); t++ )
+			{
+				int numLevels = 0;
+				size_t size = 0;
+				unsigned char * chain = BuildMipChainRGBA( image, width, height, srgb != 0, threadCounts[t], numLevels, size );
+				if ( numLevels != refLevels || size != refSize )
+				{
+					printf( "FAILED: BuildMipChainRGBA %dx%d has %d levels in %d bytes, expected %d in %d\n",
+							width, height, numLevels, (int)size, refLevels, (int)refSize );
+					ok = false;
+				}
+				else
+				{
+					int numDiffs = 0;
+					int maxDiff = 0;
+					for ( size_t i = 0; i < size; i++ )
+					{
+						const int diff = abs( chain[i] - reference[i] );
+						numDiffs += ( diff != 0 );
+						maxDiff = Alg::Max( maxDiff, diff );
+					}
+					if ( numDiffs != 0 )
+					{
+						printf( "FAILED: BuildMipChainRGBA %dx%d %s, %d threads: %d bytes differ, by up to %d\n",
+								width, height, srgb ? "srgb" : "linear", threadCounts[t], numDiffs, maxDiff );
+						ok = false;
+					}
+					numBytes += (int)size;
+				}
+				free( chain );
+			}
+			free( reference );
+		}
+		free( image );
+	}
+	printf( "mip chains: %d bytes compared with the powf version, %s\n", numBytes, ok ? "bit exact" : "DIFFERENT" );
+	return ok;
+}
+
+static void BenchmarkMipChains( const ovrBenchOptions & options )
+{
+	const int width = options.MipWidth;
+	const int height = options.MipHeight;
+	unsigned char * image = BuildPhotoImage( width, height, 1 );
+
+	printf( "%dx%d mip chain:\n", width, height );
+	for ( int srgb = 1; srgb >= 0; srgb-- )
+	{
+		double copySeconds = 1e9;
+		double referenceSeconds = 1e9;
+		double quarterSeconds = 1e9;
+		double chainSeconds = 1e9;
+		double parallelSeconds = 1e9;
+		for ( int i = 0; i < options.NumIterations; i++ )
+		{
+			int numLevels = 0;
+			size_t size = 0;
+
+			// both chains start with a copy of level 0 into a new buffer
+			double start = GetSeconds();
+			unsigned char * copy = (unsigned char *)malloc( (size_t)width * height * 4 * 4 / 3 + 64 );
+			memcpy( copy, image, (size_t)width * height * 4 );
+			copySeconds = Alg::Min( copySeconds, GetSeconds() - start );
+			if ( copy[width * height * 2] != image[width * height * 2] )
+			{
+				printf( "copy failed\n" );
+			}
+			free( copy );
+
+			start = GetSeconds();
+			free( ReferenceMipChain( image, width, height, srgb != 0, numLevels, size ) );
+			referenceSeconds = Alg::Min( referenceSeconds, GetSeconds() - start );
+
+			// QuarterImageSize per level without keeping the levels, so without the copy
+			start = GetSeconds();
+			unsigned char * level = image;
+			for ( int w = width, h = height; w > 1 || h > 1; w = Alg::Max( 1, w >> 1 ), h = Alg::Max( 1, h >> 1 ) )
+			{
+				unsigned char * next = QuarterImageSize( level, w, h, srgb != 0 );
+				if ( level != image )
+				{
+					free( level );
+				}
+				level = next;
+			}
+			free( level );
+			quarterSeconds = Alg::Min( quarterSeconds, GetSeconds() - start );
+
+			start = GetSeconds();
+			free( BuildMipChainRGBA( image, width, height, srgb != 0, 1, numLevels, size ) );
+			chainSeconds = Alg::Min( chainSeconds, GetSeconds() - start );
+
+			start = GetSeconds();
+			free( BuildMipChainRGBA( image, width, height, srgb != 0, options.NumThreads, numLevels, size ) );
+			parallelSeconds = Alg::Min( parallelSeconds, GetSeconds() - start );
+		}
+		printf( "  %s:\n", srgb ? "srgb" : "linear" );
+		printf( "    level 0 copy %8.2f ms\n", copySeconds * 1e3 );
+		printf( "    reference    %8.2f ms\n", referenceSeconds * 1e3 );
+		printf( "    quarter      %8.2f ms (%.2fx)\n", quarterSeconds * 1e3, referenceSeconds / quarterSeconds );
+		printf( "    chain        %8.2f ms (%.2fx)\n", chainSeconds * 1e3, referenceSeconds / chainSeconds );
+		printf( "    %d threads    %8.2f ms (%.2fx)\n", options.NumThreads, parallelSeconds * 1e3, referenceSeconds / parallelSeconds );
+	}
+	free( image );
+}
+
+//==============================================================
+// Resampling
+//==============================================================
+
+static const char * FilterName( const ImageFilter filter )
+{
+	switch ( filter )
+	{
+		case IMAGE_FILTER_NEAREST:	return "nearest";
+		case IMAGE_FILTER_LINEAR:	return "linear";
+		case IMAGE_FILTER_CUBIC:	return "cubic";
+		case IMAGE_FILTER_BOX:		return "box";
+		case IMAGE_FILTER_LANCZOS:	return "lanczos";
+	}
+	return "?";
+}
+
+// When enlarging, the kernel isn't stretched, so the new resampler has to give the
+// old result up to float rounding. When shrinking, the old one skipped most of the
+// source: both are compared with the ideal box filtered result, and the new one has
+// to be closer to it. A zone plate shrunk by any filter other than a box stays far
+// from the box result, so it only has to gain more.
+static bool CheckResampler()
+{
+	static const double MIN_ENLARGE_PSNR = 45.0;
+
+	bool ok = true;
+
+	{
+		unsigned char * image = BuildPhotoImage( 300, 200, 2 );
+		struct ovrScaleSize { int Width; int Height; };
+		static const ovrScaleSize sizes[] = { { 450, 300 }, { 517, 371 }, { 300, 401 } };
+		static const ImageFilter filters[] = { IMAGE_FILTER_LINEAR, IMAGE_FILTER_CUBIC };
+		for ( int s = 0; s < (int)( sizeof( sizes ) / sizeof( sizes[0] ) ); s++ )
+		{
+			for ( int f = 0; f < (int)( sizeof( filters ) / sizeof( filters[0] ) ); f++ )
+			{
+				const int w = sizes[s].Width;
+				const int h = sizes[s].Height;
+				unsigned char * reference = ReferenceScaleImageRGBA( image, 300, 200, w, h, filters[f] );
+				unsigned char * scaled = ScaleImageRGBA( image, 300, 200, w, h, filters[f], true, 1 );
+				unsigned char * parallel = ScaleImageRGBA( image, 300, 200, w, h, filters[f], true, 3 );
+				const double psnr = ImagePSNR( scaled, reference, w, h );
+				printf( "enlarge 300x200 to %dx%d %-7s %5.1f dB from the old version\n", w, h, FilterName( filters[f] ), psnr );
+				if ( psnr < MIN_ENLARGE_PSNR )
+				{
+					printf( "FAILED: below %.0f dB\n", MIN_ENLARGE_PSNR );
+					ok = false;
+				}
+				if ( memcmp( scaled, parallel, w * h * 4 ) != 0 )
+				{
+					printf( "FAILED: 3 threads give a different result\n" );
+					ok = false;
+				}
+				free( reference );
+				free( scaled );
+				free( parallel );
+			}
+		}
+		free( image );
+	}
+
+	{
+		static const int width = 2048;
+		static const int height = 1024;
+		unsigned char * images[2] = { BuildPhotoImage( width, height, 3 ), BuildZonePlateImage( width, height ) };
+		static const char * imageNames[2] = { "photo", "zone plate" };
+		static const double minPsnr[2] = { 40.0, 15.0 };
+		static const double minGain[2] = { 1.0, 5.0 };	// dB over the old version
+		static const int factors[] = { 3, 8, 32 };
+		for ( int i = 0; i < 2; i++ )
+		{
+			for ( int f = 0; f < (int)( sizeof( factors ) / sizeof( factors[0] ) ); f++ )
+			{
+				const int w = width / factors[f];
+				const int h = height / factors[f];
+				unsigned char * ideal = BoxShrinkImage( images[i], width, height, factors[f] );
+				unsigned char * reference = ReferenceScaleImageRGBA( images[i], width, height, w, h, IMAGE_FILTER_CUBIC );
+				unsigned char * cubic = ScaleImageRGBA( images[i], width, height, w, h, IMAGE_FILTER_CUBIC, true, 1 );
+				unsigned char * box = ScaleImageRGBA( images[i], width, height, w, h, IMAGE_FILTER_BOX, true, 1 );
+				const double referencePsnr = ImagePSNR( reference, ideal, w, h );
+				const double cubicPsnr = ImagePSNR( cubic, ideal, w, h );
+				const double boxPsnr = ImagePSNR( box, ideal, w, h );
+				printf( "shrink %-10s 1/%-2d to the ideal: old cubic %5.1f dB, cubic %5.1f dB, box %5.1f dB\n",
+						imageNames[i], factors[f], referencePsnr, cubicPsnr, boxPsnr );
+				if ( cubicPsnr < minPsnr[i] || cubicPsnr < referencePsnr + minGain[i] )
+				{
+					printf( "FAILED: cubic below %.0f dB or less than %.0f dB better than the old version\n", minPsnr[i], minGain[i] );
+					ok = false;
+				}
+				free( ideal );
+				free( reference );
+				free( cubic );
+				free( box );
+			}
+			free( images[i] );
+		}
+	}
+	return ok;
+}
+
+static void BenchmarkResampler( const ovrBenchOptions & options )
+{
+	const int width = options.ScaleWidth;
+	const int height = options.ScaleHeight;
+	const int newWidth = options.ScaledWidth;
+	const int newHeight = options.ScaledHeight;
+	unsigned char * image = BuildPhotoImage( width, height, 4 );
+
+	double referenceSeconds = 1e9;
+	double scaleSeconds = 1e9;
+	double parallelSeconds = 1e9;
+	for ( int i = 0; i < options.NumIterations; i++ )
+	{
+		double start = GetSeconds();
+		free( ReferenceScaleImageRGBA( image, width, height, newWidth, newHeight, IMAGE_FILTER_CUBIC ) );
+		referenceSeconds = Alg::Min( referenceSeconds, GetSeconds() - start );
+
+		start = GetSeconds();
+		free( ScaleImageRGBA( image, width, height, newWidth, newHeight, IMAGE_FILTER_CUBIC, true, 1 ) );
+		scaleSeconds = Alg::Min( scaleSeconds, GetSeconds() - start );
+
+		start = GetSeconds();
+		free( ScaleImageRGBA( image, width, height, newWidth, newHeight, IMAGE_FILTER_CUBIC, true, options.NumThreads ) );
+		parallelSeconds = Alg::Min( parallelSeconds, GetSeconds() - start );
+	}
+	const double megaPixels = (double)width * height * 1e-6;
+	printf( "%dx%d to %dx%d cubic:\n", width, height, newWidth, newHeight );
+	printf( "    reference    %8.2f ms (%.0f Mpixel/s)\n", referenceSeconds * 1e3, megaPixels / referenceSeconds );
+	printf( "    separable    %8.2f ms (%.0f Mpixel/s, %.2fx)\n", scaleSeconds * 1e3, megaPixels / scaleSeconds, referenceSeconds / scaleSeconds );
+	printf( "    %d threads    %8.2f ms (%.0f Mpixel/s, %.2fx)\n", options.NumThreads, parallelSeconds * 1e3, megaPixels / parallelSeconds,
+			referenceSeconds / parallelSeconds );
+	free( image );
+}
+
+//==============================================================
+// ETC2 compression
+//==============================================================
+
+// A decoder written from the ETC2 / EAC specification, including the T and H
+// modes the encoder doesn't use. It gives the same bytes as Mesa's. Pixels are
+// numbered p = x * 4 + y.
+
+static const int EtcDecodeModifiers[8][2] =
+{
+	{ 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+};
+
+static const int EtcDecodeDistances[8] = { 3, 6, 11, 16, 23, 32, 41, 64 };
+
+static const int EacDecodeModifiers[16][8] =
+{
+	{ -3, -6,  -9, -15, 2, 5, 8, 14 },
+	{ -3, -7, -10, -13, 2, 6, 9, 12 },
+	{ -2, -5,  -8, -13, 1, 4, 7, 12 },
+	{ -2, -4,  -6, -13, 1, 3, 5, 12 },
+	{ -3, -6,  -8, -12, 2, 5, 7, 11 },
+	{ -3, -7,  -9, -11, 2, 6, 8, 10 },
+	{ -4, -7,  -8, -11, 3, 6, 7, 10 },
+	{ -3, -5,  -8, -11, 2, 4, 7, 10 },
+	{ -2, -6,  -8, -10, 1, 5, 7,  9 },
+	{ -2, -5,  -8, -10, 1, 4, 7,  9 },
+	{ -2, -4,  -8, -10, 1, 3, 7,  9 },
+	{ -2, -5,  -7, -10, 1, 4, 6,  9 },
+	{ -3, -4,  -7, -10, 2, 3, 6,  9 },
+	{ -1, -2,  -3, -10, 0, 1, 2,  9 },
+	{ -4, -6,  -8,  -9, 3, 5, 7,  8 },
+	{ -3, -5,  -7,  -9, 2, 4, 6,  8 }
+};
+
+static int DecodeClamp( const int x )
+{
+	return ( x < 0 ) ? 0 : ( ( x > 255 ) ? 255 : x );
+}
+
+static uint64_t LoadBigEndian64( const unsigned char * block )
+{
+	uint64_t bits = 0;
+	for ( int i = 0; i < 8; i++ )
+	{
+		bits = ( bits << 8 ) | block[i];
+	}
+	return bits;
+}
+
+static int DecodeBits( const uint64_t bits, const int high, const int low )
+{
+	return (int)( ( bits >> low ) & ( ( 1u << ( high - low + 1 ) ) - 1 ) );
+}
+
+static void DecodeEtc2RgbBlock( const unsigned char * block, unsigned char out[16][4] )
+{
+	const uint64_t bits = LoadBigEndian64( block );
+	const int diff = DecodeBits( bits, 33, 33 );
+
+	int base[2][3];
+	bool delta = false;
+	if ( diff == 0 )
+	{
+		for ( int c = 0; c < 3; c++ )
+		{
+			base[0][c] = DecodeBits( bits, 63 - c * 8, 60 - c * 8 ) * 17;
+			base[1][c] = DecodeBits( bits, 59 - c * 8, 56 - c * 8 ) * 17;
+		}
+	}
+	else
+	{
+		int base5[3];
+		int sum5[3];
+		for ( int c = 0; c < 3; c++ )
+		{
+			base5[c] = DecodeBits( bits, 63 - c * 8, 59 - c * 8 );
+			const int d = DecodeBits( bits, 58 - c * 8, 56 - c * 8 );
+			sum5[c] = base5[c] + ( ( d ^ 4 ) - 4 );
+		}
+
+		int paint[4][3];
+		if ( sum5[0] < 0 || sum5[0] > 31 )
+		{
+			// T mode
+			const int c1[3] = { ( DecodeBits( bits, 60, 59 ) << 2 ) | DecodeBits( bits, 57, 56 ), DecodeBits( bits, 55, 52 ), DecodeBits( bits, 51, 48 ) };
+			const int c2[3] = { DecodeBits( bits, 47, 44 ), DecodeBits( bits, 43, 40 ), DecodeBits( bits, 39, 36 ) };
+			const int d = EtcDecodeDistances[( DecodeBits( bits, 35, 34 ) << 1 ) | DecodeBits( bits, 32, 32 )];
+			for ( int c = 0; c < 3; c++ )
+			{
+				paint[0][c] = c1[c] * 17;
+				paint[1][c] = DecodeClamp( c2[c] * 17 + d );
+				paint[2][c] = c2[c] * 17;
+				paint[3][c] = DecodeClamp( c2[c] * 17 - d );
+			}
+		}
+		else if ( sum5[1] < 0 || sum5[1] > 31 )
+		{
+			// H mode
+			const int c1[3] = { DecodeBits( bits, 62, 59 ), ( DecodeBits( bits, 58, 56 ) << 1 ) | DecodeBits( bits, 52, 52 ),
+								( DecodeBits( bits, 51, 51 ) << 3 ) | DecodeBits( bits, 49, 47 ) };
+			const int c2[3] = { DecodeBits( bits, 46, 43 ), DecodeBits( bits, 42, 39 ), DecodeBits( bits, 38, 35 ) };
+			const int v1 = ( c1[0] << 8 ) | ( c1[1] << 4 ) | c1[2];
+			const int v2 = ( c2[0] << 8 ) | ( c2[1] << 4 ) | c2[2];
+			const int d = EtcDecodeDistances[( DecodeBits( bits, 34, 34 ) << 2 ) | ( DecodeBits( bits, 32, 32 ) << 1 ) | ( v1 >= v2 ? 1 : 0 )];
+			for ( int c = 0; c < 3; c++ )
+			{
+				paint[0][c] = DecodeClamp( c1[c] * 17 + d );
+				paint[1][c] = DecodeClamp( c1[c] * 17 - d );
+				paint[2][c] = DecodeClamp( c2[c] * 17 + d );
+				paint[3][c] = DecodeClamp( c2[c] * 17 - d );
+			}
+		}
+		else if ( sum5[2] < 0 || sum5[2] > 31 )
+		{
+			// planar mode
+			const int o[3] = { DecodeBits( bits, 62, 57 ),
+							( DecodeBits( bits, 56, 56 ) << 6 ) | DecodeBits( bits, 54, 49 ),
+							( DecodeBits( bits, 48, 48 ) << 5 ) | ( DecodeBits( bits, 44, 43 ) << 3 ) | DecodeBits( bits, 41, 39 ) };
+			const int h[3] = { ( DecodeBits( bits, 38, 34 ) << 1 ) | DecodeBits( bits, 32, 32 ), DecodeBits( bits, 31, 25 ), DecodeBits( bits, 24, 19 ) };
+			const int v[3] = { DecodeBits( bits, 18, 13 ), DecodeBits( bits, 12, 6 ), DecodeBits( bits, 5, 0 ) };
+			for ( int c = 0; c < 3; c++ )
+			{
+				const int shift = ( c == 1 ) ? 1 : 2;
+				const int top = ( c == 1 ) ? 6 : 4;
+				const int eo = ( o[c] << shift ) | ( o[c] >> top );
+				const int eh = ( h[c] << shift ) | ( h[c] >> top );
+				const int ev = ( v[c] << shift ) | ( v[c] >> top );
+				for ( int p = 0; p < 16; p++ )
+				{
+					const int x = p >> 2;
+					const int y = p & 3;
+					out[p][c] = (unsigned char)DecodeClamp( ( x * ( eh - eo ) + y * ( ev - eo ) + 4 * eo + 2 ) >> 2 );
+				}
+			}
+			return;
+		}
+		else
+		{
+			for ( int c = 0; c < 3; c++ )
+			{
+				base[0][c] = ( base5[c] << 3 ) | ( base5[c] >> 2 );
+				base[1][c] = ( sum5[c] << 3 ) | ( sum5[c] >> 2 );
+			}
+			delta = true;
+		}
+
+		if ( !delta )
+		{
+			for ( int p = 0; p < 16; p++ )
+			{
+				const int index = ( DecodeBits( bits, 16 + p, 16 + p ) << 1 ) | DecodeBits( bits, p, p );
+				for ( int c = 0; c < 3; c++ )
+				{
+					out[p][c] = (unsigned char)paint[index][c];
+				}
+			}
+			return;
+		}
+	}
+
+	// individual and differential modes
+	const int tables[2] = { DecodeBits( bits, 39, 37 ), DecodeBits( bits, 36, 34 ) };
+	const int flip = DecodeBits( bits, 32, 32 );
+	for ( int p = 0; p < 16; p++ )
+	{
+		const int x = p >> 2;
+		const int y = p & 3;
+		const int s = flip ? ( y >= 2 ) : ( x >= 2 );
+		const int msb = DecodeBits( bits, 16 + p, 16 + p );
+		const int lsb = DecodeBits( bits, p, p );
+		const int magnitude = EtcDecodeModifiers[tables[s]][lsb];
+		const int modifier = msb ? -magnitude : magnitude;
+		for ( int c = 0; c < 3; c++ )
+		{
+			out[p][c] = (unsigned char)DecodeClamp( base[s][c] + modifier );
+		}
+	}
+}
+
+static void DecodeEacAlphaBlock( const unsigned char * block, unsigned char out[16][4] )
+{
+	const uint64_t bits = LoadBigEndian64( block );
+	const int base = DecodeBits( bits, 63, 56 );
+	const int multiplier = DecodeBits( bits, 55, 52 );
+	const int * modifiers = EacDecodeModifiers[DecodeBits( bits, 51, 48 )];
+	for ( int p = 0; p < 16; p++ )
+	{
+		const int index = DecodeBits( bits, 47 - p * 3, 45 - p * 3 );
+		out[p][3] = (unsigned char)DecodeClamp( base + modifiers[index] * multiplier );
+	}
+}
+
+// Decodes the output of CompressImageETC2 back to RGBA.
+static void DecodeImageETC2( const unsigned char * data, const int width, const int height, const bool alpha, unsigned char * rgba )
+{
+	const unsigned char * block = data;
+	for ( int by = 0; by < height; by += 4 )
+	{
+		for ( int bx = 0; bx < width; bx += 4 )
+		{
+			unsigned char pixels[16][4];
+			for ( int p = 0; p < 16; p++ )
+			{
+				pixels[p][3] = 255;
+			}
+			if ( alpha )
+			{
+				DecodeEacAlphaBlock( block, pixels );
+				block += 8;
+			}
+			DecodeEtc2RgbBlock( block, pixels );
+			block += 8;
+
+			for ( int p = 0; p < 16; p++ )
+			{
+				const int x = bx + ( p >> 2 );
+				const int y = by + ( p & 3 );
+				if ( x < width && y < height )
+				{
+					memcpy( &rgba[( y * width + x ) * 4], pixels[p], 4 );
+				}
+			}
+		}
+	}
+}
+
+// PSNR of channels [firstChannel, firstChannel + numChannels).
+static double ChannelPSNR( const unsigned char * a, const unsigned char * b, const int width, const int height,
+		const int firstChannel, const int numChannels )
+{
+	double sum = 0.0;
+	for ( int i = 0; i < width * height; i++ )
+	{
+		for ( int c = firstChannel; c < firstChannel + numChannels; c++ )
+		{
+			const double d = (double)a[i * 4 + c] - (double)b[i * 4 + c];
+			sum += d * d;
+		}
+	}
+	if ( sum == 0.0 )
+	{
+		return 99.0;
+	}
+	return 10.0 * log10( 255.0 * 255.0 / ( sum / ( width * height * numChannels ) ) );
+}
+
+// A smooth gradient in every channel, which planar mode encodes almost exactly.
+static unsigned char * BuildGradientImage( const int width, const int height )
+{
+	unsigned char * image = (unsigned char *)malloc( width * height * 4 );
+	for ( int y = 0; y < height; y++ )
+	{
+		for ( int x = 0; x < width; x++ )
+		{
+			unsigned char * p = &image[( y * width + x ) * 4];
+			p[0] = (unsigned char)( x * 255 / Alg::Max( 1, width - 1 ) );
+			p[1] = (unsigned char)( ( x + y ) * 255 / Alg::Max( 1, width + height - 2 ) );
+			p[2] = (unsigned char)( 255 - y * 255 / Alg::Max( 1, height - 1 ) );
+			p[3] = (unsigned char)( y * 255 / Alg::Max( 1, height - 1 ) );
+		}
+	}
+	return image;
+}
+
+// Flat colors with hard edges, like UI or text on a thumbnail: 8 pixel squares in
+// two saturated colors, a dark line every 16 pixels and an alpha cutout.
+static unsigned char * BuildEdgeImage( const int width, const int height )
+{
+	unsigned char * image = (unsigned char *)malloc( width * height * 4 );
+	for ( int y = 0; y < height; y++ )
+	{
+		for ( int x = 0; x < width; x++ )
+		{
+			unsigned char * p = &image[( y * width + x ) * 4];
+			const bool square = ( ( x >> 3 ) + ( y >> 3 ) ) & 1;
+			const bool line = ( x & 15 ) == 0 || ( y & 15 ) == 0;
+			p[0] = line ? 16 : ( square ? 230 : 30 );
+			p[1] = line ? 16 : ( square ? 60 : 140 );
+			p[2] = line ? 16 : ( square ? 20 : 220 );
+			const int dx = x - width / 2;
+			const int dy = y - height / 2;
+			p[3] = ( dx * dx + dy * dy < width * height / 16 ) ? 0 : 255;
+		}
+	}
+	return image;
+}
+
+// The top left corner of an image.
+static unsigned char * CropImage( const unsigned char * image, const int width, const int cropWidth, const int cropHeight )
+{
+	unsigned char * crop = (unsigned char *)malloc( cropWidth * cropHeight * 4 );
+	for ( int y = 0; y < cropHeight; y++ )
+	{
+		memcpy( &crop[y * cropWidth * 4], &image[y * width * 4], cropWidth * 4 );
+	}
+	return crop;
+}
+
+// Compresses and decodes test images and checks the PSNR of color and alpha. The
+// odd sizes are crops, so partial edge blocks must decode to the image whatever
+// the encoder put in the padding. Thread counts and CompressMipChainETC2 must not
+// change the blocks.
+static bool CheckETC2()
+{
+	static const int SOURCE_SIZE = 256;
+	struct ovrEtcTest
+	{
+		const char *	Name;
+		int				Width;
+		int				Height;
+		int				Kind;		// 0 photo, 1 gradient, 2 edges
+		double			MinRgbPsnr;
+		double			MinAlphaPsnr;
+	};
+	static const ovrEtcTest tests[] =
+	{
+		{ "photo",		256, 256, 0, 40.0, 60.0 },
+		{ "photo",		 13,   7, 0, 40.0, 60.0 },
+		{ "photo",		  3,   5, 0, 40.0, 60.0 },
+		{ "photo",		  1,   1, 0, 40.0, 60.0 },
+		{ "gradient",	256, 256, 1, 44.0, 60.0 },
+		{ "gradient",	 13,   7, 1, 44.0, 60.0 },
+		{ "edges",		256, 256, 2, 20.0, 60.0 },	// three colors in a block need the T and H modes
+		{ "edges",		 13,   7, 2, 20.0, 60.0 }
+	};
+
+	bool ok = true;
+	for ( int t = 0; t < (int)( sizeof( tests ) / sizeof( tests[0] ) ); t++ )
+	{
+		const ovrEtcTest & test = tests[t];
+		const int w = test.Width;
+		const int h = test.Height;
+		unsigned char * source = ( test.Kind == 0 ) ? BuildPhotoImage( SOURCE_SIZE, SOURCE_SIZE, 5 ) :
+								( test.Kind == 1 ) ? BuildGradientImage( SOURCE_SIZE, SOURCE_SIZE ) : BuildEdgeImage( SOURCE_SIZE, SOURCE_SIZE );
+		unsigned char * image = CropImage( source, SOURCE_SIZE, w, h );
+		free( source );
+		unsigned char * decoded = (unsigned char *)malloc( w * h * 4 );
+
+		for ( int alpha = 0; alpha < 2; alpha++ )
+		{
+			const size_t size = GetETC2Size( w, h, alpha != 0 );
+			unsigned char * blocks = (unsigned char *)malloc( size );
+			unsigned char * parallel = (unsigned char *)malloc( size );
+			CompressImageETC2( image, w, h, alpha != 0, blocks, 1 );
+			CompressImageETC2( image, w, h, alpha != 0, parallel, 3 );
+			if ( memcmp( blocks, parallel, size ) != 0 )
+			{
+				printf( "FAILED: ETC2 %s %dx%d: 3 threads give different blocks\n", test.Name, w, h );
+				ok = false;
+			}
+
+			DecodeImageETC2( blocks, w, h, alpha != 0, decoded );
+			const double rgbPsnr = ChannelPSNR( image, decoded, w, h, 0, 3 );
+			bool opaque = true;
+			for ( int i = 0; i < w * h; i++ )
+			{
+				opaque = opaque && ( decoded[i * 4 + 3] == 255 );
+			}
+			if ( alpha )
+			{
+				const double alphaPsnr = ChannelPSNR( image, decoded, w, h, 3, 1 );
+				printf( "ETC2 RGBA %-10s %3dx%-3d rgb %5.1f dB, alpha %5.1f dB\n", test.Name, w, h, rgbPsnr, alphaPsnr );
+				if ( rgbPsnr < test.MinRgbPsnr || alphaPsnr < test.MinAlphaPsnr )
+				{
+					printf( "FAILED: below %.0f dB rgb or %.0f dB alpha\n", test.MinRgbPsnr, test.MinAlphaPsnr );
+					ok = false;
+				}
+			}
+			else
+			{
+				printf( "ETC2 RGB  %-10s %3dx%-3d rgb %5.1f dB\n", test.Name, w, h, rgbPsnr );
+				if ( rgbPsnr < test.MinRgbPsnr || !opaque )
+				{
+					printf( "FAILED: below %.0f dB or not opaque\n", test.MinRgbPsnr );
+					ok = false;
+				}
+			}
+			free( blocks );
+			free( parallel );
+		}
+
+		// the compressed chain is every level of BuildMipChainRGBA compressed on its own
+		for ( int srgb = 0; srgb < 2; srgb++ )
+		{
+			int numLevels = 0;
+			size_t chainSize = 0;
+			unsigned char * chain = BuildMipChainRGBA( image, w, h, srgb != 0, 1, numLevels, chainSize );
+			int numEtcLevels = 0;
+			size_t etcSize = 0;
+			unsigned char * etcChain = CompressMipChainETC2( image, w, h, srgb != 0, true, 3, numEtcLevels, etcSize );
+			const unsigned char * level = chain;
+			size_t offset = 0;
+			bool same = ( numEtcLevels == numLevels );
+			for ( int l = 0, lw = w, lh = h; same && l < numLevels; l++, lw = Alg::Max( 1, lw >> 1 ), lh = Alg::Max( 1, lh >> 1 ) )
+			{
+				const size_t levelSize = GetETC2Size( lw, lh, true );
+				unsigned char * blocks = (unsigned char *)malloc( levelSize );
+				CompressImageETC2( level, lw, lh, true, blocks, 1 );
+				same = ( offset + levelSize <= etcSize ) && memcmp( blocks, etcChain + offset, levelSize ) == 0;
+				free( blocks );
+				level += lw * lh * 4;
+				offset += levelSize;
+			}
+			if ( !same || offset != etcSize )
+			{
+				printf( "FAILED: CompressMipChainETC2 %s %dx%d %s differs from compressing each level\n", test.Name, w, h, srgb ? "srgb" : "linear" );
+				ok = false;
+			}
+			free( chain );
+			free( etcChain );
+		}
+
+		free( decoded );
+		free( image );
+	}
+	return ok;
+}
+
+static void BenchmarkETC2( const ovrBenchOptions & options )
+{
+	const int size = options.EncodeSize;
+	unsigned char * image = BuildPhotoImage( size, size, 6 );
+	const double megaPixels = (double)size * size * 1e-6;
+
+	printf( "%dx%d ETC2 encode:\n", size, size );
+	for ( int alpha = 0; alpha < 2; alpha++ )
+	{
+		unsigned char * blocks = (unsigned char *)malloc( GetETC2Size( size, size, alpha != 0 ) );
+		double encodeSeconds = 1e9;
+		double parallelSeconds = 1e9;
+		for ( int i = 0; i < options.NumIterations; i++ )
+		{
+			double start = GetSeconds();
+			CompressImageETC2( image, size, size, alpha != 0, blocks, 1 );
+			encodeSeconds = Alg::Min( encodeSeconds, GetSeconds() - start );
+
+			start = GetSeconds();
+			CompressImageETC2( image, size, size, alpha != 0, blocks, options.NumThreads );
+			parallelSeconds = Alg::Min( parallelSeconds, GetSeconds() - start );
+		}
+		printf( "    %-4s         %8.2f ms (%.2f Mpixel/s)\n", alpha ? "rgba" : "rgb", encodeSeconds * 1e3, megaPixels / encodeSeconds );
+		printf( "    %d threads    %8.2f ms (%.2f Mpixel/s)\n", options.NumThreads, parallelSeconds * 1e3, megaPixels / parallelSeconds );
+		free( blocks );
+	}
+
+	// a folder browser thumbnail: the sRGB chain of a 256x256 image, with alpha
+	unsigned char * thumb = BuildPhotoImage( 256, 256, 7 );
+	double thumbSeconds = 1e9;
+	for ( int i = 0; i < options.NumIterations; i++ )
+	{
+		int numLevels = 0;
+		size_t chainSize = 0;
+		const double start = GetSeconds();
+		free( CompressMipChainETC2( thumb, 256, 256, true, true, 1, numLevels, chainSize ) );
+		thumbSeconds = Alg::Min( thumbSeconds, GetSeconds() - start );
+	}
+	printf( "    256x256 thumbnail chain %.2f ms\n", thumbSeconds * 1e3 );
+
+	free( thumb );
+	free( image );
+}
+
+static int RunBenchmark( const ovrBenchOptions & options )
+{
+	bool ok = true;
+	ok = CheckMipChains() && ok;
+	ok = CheckResampler() && ok;
+	ok = CheckETC2() && ok;
+
+	BenchmarkMipChains( options );
+	BenchmarkResampler( options );
+	BenchmarkETC2( options );
+
+	printf( "%s\n", ok ? "PASSED" : "FAILED" );
+	return ok ? 0 : 1;
+}
+
+int main( int const argc, char const * argv[] )
+{
+	ovrBenchOptions options;
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		const bool hasValue = ( i + 1 < argc );
+		if ( strcmp( argv[i], "-size" ) == 0 && i + 2 < argc )
+		{
+			options.MipWidth = Alg::Max( 1, atoi( argv[++i] ) );
+			options.MipHeight = Alg::Max( 1, atoi( argv[++i] ) );
+		}
+		else if ( strcmp( argv[i], "-scale" ) == 0 && i + 4 < argc )
+		{
+			options.ScaleWidth = Alg::Max( 1, atoi( argv[++i] ) );
+			options.ScaleHeight = Alg::Max( 1, atoi( argv[++i] ) );
+			options.ScaledWidth = Alg::Max( 1, atoi( argv[++i] ) );
+			options.ScaledHeight = Alg::Max( 1, atoi( argv[++i] ) );
+		}
+		else if ( strcmp( argv[i], "-encode" ) == 0 && hasValue )
+		{
+			options.EncodeSize = Alg::Max( 1, atoi( argv[++i] ) );
+		}
+		else if ( strcmp( argv[i], "-threads" ) == 0 && hasValue )
+		{
+			options.NumThreads = Alg::Max( 1, atoi( argv[++i] ) );
+		}
+		else if ( strcmp( argv[i], "-iterations" ) == 0 && hasValue )
+		{
+			options.NumIterations = Alg::Max( 1, atoi( argv[++i] ) );
+		}
+		else
+		{
+			printf( "USAGE: ImageDataBench [-size <width> <height>] [-scale <width> <height> <new width> <new height>]\n"
+					"                      [-encode <size>] [-threads <n>] [-iterations <n>]\n" );
+			return 1;
+		}
+	}
+
+	System::Init( Log::ConfigureDefaultLog( LogMask_None ) );
+	const int result = RunBenchmark( options );
+	System::Destroy();
+
+	return result;
+}
@@ -0,0 +1,326 @@
+/************************************************************************************
+
+Filename    :   main.cpp
+Content     :   Checks the batched joint animation against the per joint matrix
+				version it replaced, and benchmarks both.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "Kernel/OVR_System.h"
+#include "Kernel/OVR_Alg.h"
+#include "ModelAnimation.h"
+#include "BenchCommon.h"
+
+using namespace OVR;
+
+struct ovrBenchOptions
+{
+	ovrBenchOptions() :
+		NumModels( 1000 ),
+		NumJoints( 16 ),
+		NumFrames( 50 ) {}
+
+	int		NumModels;
+	int		NumJoints;
+	int		NumFrames;
+};
+
+struct ovrBenchModel
+{
+	Array< ModelJoint >		ModelJoints;
+	Array< Matrix4f >		Joints;
+};
+
+// Each model has its own joints, as if every model came from a different file.
+// One joint in eight is not animated, the others rotate, sway or bob.
+static void BuildModels( const ovrBenchOptions & options, Array< ovrBenchModel > & models )
+{
+	uint32_t seed = 1;
+	models.Resize( options.NumModels );
+	for ( int m = 0; m < options.NumModels; m++ )
+	{
+		ovrBenchModel & model = models[m];
+		model.ModelJoints.Resize( options.NumJoints );
+		model.Joints.Resize( options.NumJoints );
+		for ( int j = 0; j < options.NumJoints; j++ )
+		{
+			ModelJoint & joint = model.ModelJoints[j];
+			joint.index = j;
+			joint.transform = Matrix4f::Translation( RandomFloat( seed, -2.0f, 2.0f ), RandomFloat( seed, -2.0f, 2.0f ), RandomFloat( seed, -2.0f, 2.0f ) ) *
+					Matrix4f::RotationY( RandomFloat( seed, -3.0f, 3.0f ) ) * Matrix4f::RotationX( RandomFloat( seed, -3.0f, 3.0f ) ) *
+					Matrix4f::Scaling( RandomFloat( seed, 0.5f, 2.0f ) );
+			joint.inverseTransform = joint.transform.Inverted();
+			const uint32_t type = Random( seed ) % 8;
+			joint.animation = ( type == 0 ) ? MODEL_JOINT_ANIMATION_NONE :
+							( type < 4 ) ? MODEL_JOINT_ANIMATION_ROTATE :
+							( type < 6 ) ? MODEL_JOINT_ANIMATION_SWAY : MODEL_JOINT_ANIMATION_BOB;
+			// degrees per second for rotations, a distance for bobbing
+			const float range = ( joint.animation == MODEL_JOINT_ANIMATION_BOB ) ? 0.5f : 90.0f;
+			joint.parameters = Vector3f( RandomFloat( seed, -range, range ), RandomFloat( seed, -range, range ), RandomFloat( seed, -range, range ) );
+			joint.timeOffset = RandomFloat( seed, 0.0f, 10.0f );
+			joint.timeScale = RandomFloat( seed, 0.1f, 2.0f );
+		}
+	}
+}
+
+// ModelInScene::AnimateJoints as it was: a full matrix product and inverse per joint.
+static void ReferenceAnimateJoints( const Array< ModelJoint > & modelJoints, Array< Matrix4f > & joints, const double timeInSeconds )
+{
+	for ( int i = 0; i < modelJoints.GetSizeI(); i++ )
+	{
+		const ModelJoint * joint = &modelJoints[i];
+		if ( joint->animation == MODEL_JOINT_ANIMATION_NONE )
+		{
+			continue;
+		}
+
+		double time = ( timeInSeconds + joint->timeOffset ) * joint->timeScale;
+
+		switch( joint->animation )
+		{
+			case MODEL_JOINT_ANIMATION_SWAY:
+			{
+				time = sin( time * Math<double>::Pi );
+				// NOTE: fall through
+			}
+			case MODEL_JOINT_ANIMATION_ROTATE:
+			{
+				const Vector3d angles = Vector3d(joint->parameters) * ( Math<double>::DegreeToRadFactor * time );
+				const Matrix4f matrix = joint->transform *
+										Matrix4f::RotationY( static_cast<float>( fmod( angles.y, 2.0 * Math<double>::Pi ) ) ) *
+										Matrix4f::RotationX( static_cast<float>( fmod( angles.x, 2.0 * Math<double>::Pi ) ) ) *
+										Matrix4f::RotationZ( static_cast<float>( fmod( angles.z, 2.0 * Math<double>::Pi ) ) ) *
+										joint->transform.Inverted();
+				joints[i] = matrix;
+				break;
+			}
+			case MODEL_JOINT_ANIMATION_BOB:
+			{
+				const float frac = static_cast<float>( sin( time * Math<double>::Pi ) );
+				const Vector3f offset = joint->parameters * frac;
+				const Matrix4f matrix = joint->transform *
+										Matrix4f::Translation( offset ) *
+										joint->transform.Inverted();
+				joints[i] = matrix;
+				break;
+			}
+			case MODEL_JOINT_ANIMATION_NONE:
+				break;
+		}
+	}
+}
+
+// A marker value for the joints that must not be written.
+static Matrix4f UnwrittenJoint()
+{
+	return Matrix4f( 7.0f, 7.0f, 7.0f, 7.0f, 7.0f, 7.0f, 7.0f, 7.0f, 7.0f );
+}
+
+static void ResetJoints( Array< ovrBenchModel > & models )
+{
+	for ( int m = 0; m < models.GetSizeI(); m++ )
+	{
+		for ( int j = 0; j < models[m].Joints.GetSizeI(); j++ )
+		{
+			models[m].Joints[j] = UnwrittenJoint();
+		}
+	}
+}
+
+// Returns the largest difference of any joint from the reference, relative to
+// the largest element of the reference matrix.
+static float MaxJointError( const Array< ovrBenchModel > & models, const Array< Array< Matrix4f > > & reference )
+{
+	float maxError = 0.0f;
+	for ( int m = 0; m < models.GetSizeI(); m++ )
+	{
+		for ( int j = 0; j < models[m].Joints.GetSizeI(); j++ )
+		{
+			const Matrix4f & a = models[m].Joints[j];
+			const Matrix4f & b = reference[m][j];
+			float scale = 1.0f;
+			for ( int e = 0; e < 16; e++ )
+			{
+				scale = Alg::Max( scale, fabsf( ( &b.M[0][0] )[e] ) );
+			}
+			for ( int e = 0; e < 16; e++ )
+			{
+				maxError = Alg::Max( maxError, fabsf( ( &a.M[0][0] )[e] - ( &b.M[0][0] )[e] ) / scale );
+			}
+		}
+	}
+	return maxError;
+}
+
+static void AnimateBatch( ovrJointAnimationBatch & batch, Array< ovrBenchModel > & models, const double timeInSeconds, ovrWorkerPool * workers )
+{
+	batch.Clear();
+	for ( int m = 0; m < models.GetSizeI(); m++ )
+	{
+		batch.AddModel( models[m].ModelJoints, models[m].Joints );
+	}
+	batch.Animate( timeInSeconds, workers );
+}
+
+// Animates at a number of times with each version and compares the joints,
+// including the unanimated ones, which must keep their value.
+static bool CheckModels( Array< ovrBenchModel > & models )
+{
+	static const int workerCounts[] = { -1, 0, 1, 3 };	// -1 is AnimateModelJoints per model
+	static const float MAX_ERROR = 1e-5f;
+
+	bool ok = true;
+	float maxError = 0.0f;
+	ovrJointAnimationBatch batch;
+	Array< Array< Matrix4f > > reference;
+	reference.Resize( models.GetSizeI() );
+	for ( int step = 0; step < 16; step++ )
+	{
+		const double timeInSeconds = 1000.0 + step * 0.37;
+
+		ResetJoints( models );
+		for ( int m = 0; m < models.GetSizeI(); m++ )
+		{
+			ReferenceAnimateJoints( models[m].ModelJoints, models[m].Joints, timeInSeconds );
+			reference[m] = models[m].Joints;
+		}
+
+		for ( int w = 0; w < (int)( sizeof( workerCounts ) / sizeof( workerCounts[0] ) ); w++ )
+		{
+			ResetJoints( models );
+			if ( workerCounts[w] < 0 )
+			{
+				for ( int m = 0; m < models.GetSizeI(); m++ )
+				{
+					AnimateModelJoints( models[m].ModelJoints, models[m].Joints, timeInSeconds );
+				}
+			}
+			else
+			{
+				ovrWorkerPool workers;
+				workers.Init( workerCounts[w] );
+				AnimateBatch( batch, models, timeInSeconds, &workers );
+			}
+			const float error = MaxJointError( models, reference );
+			maxError = Alg::Max( maxError, error );
+			if ( !( error <= MAX_ERROR ) )
+			{
+				printf( "FAILED: time %.2f, %d workers: joint error %g\n", timeInSeconds, workerCounts[w], error );
+				ok = false;
+			}
+		}
+	}
+	printf( "%d models: largest relative joint error %g\n", models.GetSizeI(), maxError );
+	return ok;
+}
+
+static int RunBenchmark( const ovrBenchOptions & options )
+{
+	Array< ovrBenchModel > models;
+	BuildModels( options, models );
+
+	const bool ok = CheckModels( models );
+
+	int numAnimated = 0;
+	for ( int m = 0; m < models.GetSizeI(); m++ )
+	{
+		for ( int j = 0; j < models[m].ModelJoints.GetSizeI(); j++ )
+		{
+			numAnimated += ( models[m].ModelJoints[j].animation != MODEL_JOINT_ANIMATION_NONE );
+		}
+	}
+
+	double referenceSeconds = 1e9;
+	double perModelSeconds = 1e9;
+	double batchSeconds = 1e9;
+	for ( int frame = 0; frame < options.NumFrames; frame++ )
+	{
+		const double timeInSeconds = frame * ( 1.0 / 60.0 );
+		double start = GetSeconds();
+		for ( int m = 0; m < models.GetSizeI(); m++ )
+		{
+			ReferenceAnimateJoints( models[m].ModelJoints, models[m].Joints, timeInSeconds );
+		}
+		referenceSeconds = Alg::Min( referenceSeconds, GetSeconds() - start );
+
+		start = GetSeconds();
+		for ( int m = 0; m < models.GetSizeI(); m++ )
+		{
+			AnimateModelJoints( models[m].ModelJoints, models[m].Joints, timeInSeconds );
+		}
+		perModelSeconds = Alg::Min( perModelSeconds, GetSeconds() - start );
+	}
+
+	ovrJointAnimationBatch batch;
+	for ( int frame = 0; frame < options.NumFrames; frame++ )
+	{
+		const double start = GetSeconds();
+		AnimateBatch( batch, models, frame * ( 1.0 / 60.0 ), NULL );
+		batchSeconds = Alg::Min( batchSeconds, GetSeconds() - start );
+	}
+
+	printf( "%d models, %d animated joints:\n", options.NumModels, numAnimated );
+	printf( "    reference    %.3f ms\n", referenceSeconds * 1e3 );
+	printf( "    per model    %.3f ms (%.2fx)\n", perModelSeconds * 1e3, referenceSeconds / perModelSeconds );
+	printf( "    batch        %.3f ms (%.2fx)\n", batchSeconds * 1e3, referenceSeconds / batchSeconds );
+
+	static const int workerCounts[] = { 1, 3 };
+	for ( int w = 0; w < (int)( sizeof( workerCounts ) / sizeof( workerCounts[0] ) ); w++ )
+	{
+		ovrWorkerPool workers;
+		workers.Init( workerCounts[w] );
+		double parallelSeconds = 1e9;
+		for ( int frame = 0; frame < options.NumFrames; frame++ )
+		{
+			const double start = GetSeconds();
+			AnimateBatch( batch, models, frame * ( 1.0 / 60.0 ), &workers );
+			parallelSeconds = Alg::Min( parallelSeconds, GetSeconds() - start );
+		}
+		printf( "    %d threads    %.3f ms (%.2fx)\n", workers.GetNumThreads(), parallelSeconds * 1e3, referenceSeconds / parallelSeconds );
+	}
+
+	printf( "%s\n", ok ? "PASSED" : "FAILED" );
+	return ok ? 0 : 1;
+}
+
+int main( int const argc, char const * argv[] )
+{
+	ovrBenchOptions options;
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		const bool hasValue = ( i + 1 < argc );
+		if ( strcmp( argv[i], "-models" ) == 0 && hasValue )
+		{
+			options.NumModels = Alg::Max( 1, atoi( argv[++i] ) );
+		}
+		else if ( strcmp( argv[i], "-joints" ) == 0 && hasValue )
+		{
+			options.NumJoints = Alg::Max( 1, atoi( argv[++i] ) );
+		}
+		else if ( strcmp( argv[i], "-frames" ) == 0 && hasValue )
+		{
+			options.NumFrames = Alg::Max( 1, atoi( argv[++i] ) );
+		}
+		else
+		{
+			printf( "USAGE: JointAnimationBench [-models <n>] [-joints <n>] [-frames <n>]\n" );
+			return 1;
+		}
+	}
+
+	System::Init( Log::ConfigureDefaultLog( LogMask_None ) );
+	const int result = RunBenchmark( options );
+	System::Destroy();
+
+	return result;
+}
@@ -0,0 +1,570 @@
+/************************************************************************************
+
+Filename    :   main.cpp
+Content     :   Host test of the model asset cache on the GL recorder: loads several
+				scenes that share textures and meshes with and without sharing, and
+				compares the decodes, uploads and GPU memory.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Kernel/OVR_System.h"
+#include "Kernel/OVR_Alg.h"
+#include "Kernel/OVR_Hash.h"
+#include "Kernel/OVR_JSON.h"
+#include "Kernel/OVR_String_Utils.h"
+#include "Kernel/OVR_MemBuffer.h"
+#include "ModelFile.h"
+#include "ModelBinary.h"
+#include "GlRecorder.h"
+
+#include "zip.h"
+#include "zlib.h"
+
+using namespace OVR;
+
+#include "../FbxConvert/Json2BinaryModel.h"
+#include "BenchCommon.h"
+
+static const char * VertexShaderSrc =
+	"in vec3 Position;\n"
+	"in vec2 TexCoord;\n"
+	"out highp vec2 oTexCoord;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_Position = TransformVertex( vec4( Position, 1.0 ) );\n"
+	"	oTexCoord = TexCoord;\n"
+	"}\n";
+
+static const char * FragmentShaderSrc =
+	"uniform sampler2D Texture0;\n"
+	"in highp vec2 oTexCoord;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_FragColor = texture2D( Texture0, oTexCoord );\n"
+	"}\n";
+
+struct ovrBenchOptions
+{
+	ovrBenchOptions() :
+		NumScenes( 4 ),
+		SharedSurfaces( 24 ),
+		UniqueSurfaces( 8 ),
+		TextureSize( 256 ),
+		VerticesPerSurface( 2048 ) {}
+
+	int		NumScenes;
+	int		SharedSurfaces;		// the same texture and mesh in every scene, half of the textures renamed
+	int		UniqueSurfaces;		// a texture and mesh of each scene's own
+	int		TextureSize;
+	int		VerticesPerSurface;
+};
+
+static const char * TextureTempName = "/tmp/ModelAssetCacheBench.ktx";
+
+static String GetPackageName( const int scene, const bool binary )
+{
+	return String::Format( "/tmp/ModelAssetCacheBench%d%s.ovrscene", scene, binary ? "_ovrm" : "" );
+}
+
+// An ETC2 texture with a full mip chain and noise in the modifier bits.
+static void BuildTextureKTX( const int size, uint32_t seed, MemBufferT< uint8_t > & ktx )
+{
+	size_t dataSize = 0;
+	int mipCount = 0;
+	for ( int w = size; ; w >>= 1 )
+	{
+		dataSize += GetOvrTextureSize( Texture_ETC2_RGB, w, w );
+		mipCount++;
+		if ( w == 1 )
+		{
+			break;
+		}
+	}
+
+	ovrTextureImage image;
+	image.Format = Texture_ETC2_RGB;
+	image.Width = size;
+	image.Height = size;
+	image.MipCount = mipCount;
+	image.NumFaces = 1;
+	image.OwnedData = (uint8_t *)malloc( dataSize );
+	image.Data = image.OwnedData;
+	image.DataSize = dataSize;
+
+	const uint32_t hue = Random( seed );
+	for ( size_t i = 0; i < dataSize; i += 8 )
+	{
+		uint8_t * block = image.OwnedData + i;
+		const uint32_t gradient = hue + (uint32_t)( i >> 9 );
+		block[0] = (uint8_t)( gradient );
+		block[1] = (uint8_t)( gradient >> 3 );
+		block[2] = (uint8_t)( gradient >> 6 );
+		block[3] = 0x02;
+		const uint32_t noise = Random( seed );
+		block[4] = (uint8_t)( noise );
+		block[5] = (uint8_t)( noise >> 8 );
+		block[6] = (uint8_t)( noise & 0xF0 );
+		block[7] = 0;
+	}
+
+	if ( !WriteTextureKTX( TextureTempName, image ) )
+	{
+		printf( "failed to write %s\n", TextureTempName );
+		exit( 1 );
+	}
+	MemBufferFile file( TextureTempName );
+	ktx.Realloc( file.Length );
+	memcpy( ktx, file.Buffer, file.Length );
+	remove( TextureTempName );
+}
+
+static void AddZipEntry( zipFile zf, const char * name, const void * data, const size_t size, const int method )
+{
+	zip_fileinfo info;
+	memset( &info, 0, sizeof( info ) );
+	if ( zipOpenNewFileInZip( zf, name, &info, NULL, 0, NULL, 0, NULL, method, method != 0 ? Z_DEFAULT_COMPRESSION : 0 ) != ZIP_OK ||
+			zipWriteInFileInZip( zf, data, (unsigned)size ) != ZIP_OK ||
+			zipCloseFileInZip( zf ) != ZIP_OK )
+	{
+		printf( "failed to add %s\n", name );
+		exit( 1 );
+	}
+}
+
+template< typename _type_ >
+static void AppendBinary( Array< uint8_t > & bin, const _type_ * data, const int count )
+{
+	const size_t offset = bin.GetSize();
+	bin.Resize( offset + count * sizeof( _type_ ) );
+	memcpy( &bin[offset], data, count * sizeof( _type_ ) );
+}
+
+// The name of a texture in a scene. Half of the shared textures have a different
+// name in every scene, the way exporters name the same file after the scene.
+static String GetTextureName( const ovrBenchOptions & options, const int scene, const int surface )
+{
+	if ( surface >= options.SharedSurfaces )
+	{
+		return String::Format( "scene%d_texture%03d", scene, surface );
+	}
+	if ( ( surface & 1 ) != 0 )
+	{
+		return String::Format( "scene%d_shared%03d", scene, surface );
+	}
+	return String::Format( "shared%03d", surface );
+}
+
+// Content of a surface: the shared surfaces are the same in every scene.
+static int GetContentIndex( const ovrBenchOptions & options, const int scene, const int surface )
+{
+	return ( surface < options.SharedSurfaces ) ? surface : surface + scene * options.UniqueSurfaces;
+}
+
+// Writes a package with models.json and models.bin, and one with models.ovrm.
+static void WritePackages( const ovrBenchOptions & options, const int scene )
+{
+	const int numSurfaces = options.SharedSurfaces + options.UniqueSurfaces;
+	const int numVertices = options.VerticesPerSurface;
+	const int numIndices = ( numVertices - 2 ) * 3;
+
+	Array< uint8_t > bin;
+	const uint32_t header = 0x6272766F;	// little endian "ovrb"
+	AppendBinary( bin, &header, 1 );
+
+	StringBuffer json;
+	json.AppendFormat( "{\n\"render_model\" : {\n\"textures\" : [\n" );
+	for ( int i = 0; i < numSurfaces; i++ )
+	{
+		json.AppendFormat( "{ \"name\" : \"%s\", \"usage\" : \"diffuse\", \"occlusion\" : \"opaque\" }%s\n",
+				GetTextureName( options, scene, i ).ToCStr(), ( i < numSurfaces - 1 ) ? "," : "" );
+	}
+	json.AppendFormat( "],\n\"surfaces\" : [\n" );
+
+	Array< Vector3f > positions;
+	Array< Vector3f > normals;
+	Array< Vector2f > uvs;
+	Array< TriangleIndex > indices;
+	positions.Resize( numVertices );
+	normals.Resize( numVertices );
+	uvs.Resize( numVertices );
+	indices.Resize( numIndices );
+	for ( int i = 0; i < numSurfaces; i++ )
+	{
+		const int content = GetContentIndex( options, scene, i );
+		Bounds3f bounds( Bounds3f::Init );
+		for ( int v = 0; v < numVertices; v++ )
+		{
+			const float x = (float)( v >> 1 );
+			const float y = (float)( v & 1 );
+			positions[v] = Vector3f( (float)content + x * 0.01f, y, 0.0f );
+			normals[v] = Vector3f( 0.0f, 0.0f, 1.0f );
+			uvs[v] = Vector2f( x / numVertices, y );
+			bounds.AddPoint( positions[v] );
+		}
+		for ( int t = 0; t < numVertices - 2; t++ )
+		{
+			indices[t * 3 + 0] = (TriangleIndex)( t );
+			indices[t * 3 + 1] = (TriangleIndex)( t + 1 + ( t & 1 ) );
+			indices[t * 3 + 2] = (TriangleIndex)( t + 2 - ( t & 1 ) );
+		}
+		AppendBinary( bin, positions.GetDataPtr(), numVertices );
+		AppendBinary( bin, normals.GetDataPtr(), numVertices );
+		AppendBinary( bin, uvs.GetDataPtr(), numVertices );
+		AppendBinary( bin, indices.GetDataPtr(), numIndices );
+
+		json.AppendFormat( "{\n\"source\" : [ \"surface%03d\" ],\n", i );
+		json.AppendFormat( "\"material\" : { \"type\" : \"opaque\", \"diffuse\" : %d },\n", i );
+		json.AppendFormat( "\"bounds\" : \"%s\",\n", StringUtils::ToString( bounds ).ToCStr() );
+		json.AppendFormat( "\"vertices\" : { \"vertexCount\" : %d, \"position\" : \"bin\", \"normal\" : \"bin\", \"uv0\" : \"bin\" },\n", numVertices );
+		json.AppendFormat( "\"triangles\" : { \"indexCount\" : %d, \"indices\" : \"bin\" }\n", numIndices );
+		json.AppendFormat( "}%s\n", ( i < numSurfaces - 1 ) ? "," : "" );
+	}
+	json.AppendFormat( "]\n}\n}\n" );
+
+	JSON * sceneJson = JSON::Parse( json.ToCStr() );
+	Array< uint8_t > ovrm;
+	if ( sceneJson == NULL || !Json2BinaryModel( sceneJson, bin.GetDataPtr(), bin.GetSizeI(), ovrm ) )
+	{
+		printf( "failed to build %s\n", MODEL_BINARY_FILE_NAME );
+		exit( 1 );
+	}
+	sceneJson->Release();
+
+	for ( int binary = 0; binary < 2; binary++ )
+	{
+		zipFile zf = zipOpen( GetPackageName( scene, binary != 0 ).ToCStr(), APPEND_STATUS_CREATE );
+		if ( zf == NULL )
+		{
+			printf( "failed to create %s\n", GetPackageName( scene, binary != 0 ).ToCStr() );
+			exit( 1 );
+		}
+		for ( int i = 0; i < numSurfaces; i++ )
+		{
+			MemBufferT< uint8_t > ktx;
+			BuildTextureKTX( options.TextureSize, 1 + GetContentIndex( options, scene, i ), ktx );
+			AddZipEntry( zf, ( GetTextureName( options, scene, i ) + ".ktx" ).ToCStr(), ktx, ktx.GetSize(), Z_DEFLATED );
+		}
+		if ( binary != 0 )
+		{
+			AddZipEntry( zf, MODEL_BINARY_FILE_NAME, ovrm.GetDataPtr(), ovrm.GetSize(), 0 );
+		}
+		else
+		{
+			AddZipEntry( zf, "models.json", json.ToCStr(), json.GetSize(), Z_DEFLATED );
+			AddZipEntry( zf, "models.bin", bin.GetDataPtr(), bin.GetSize(), Z_DEFLATED );
+		}
+		zipClose( zf, NULL );
+	}
+}
+
+// What the recorded GL stream shows of the loads.
+struct ovrUploadStats
+{
+	ovrUploadStats() :
+		NumTextureUploads( 0 ),
+		TextureBytes( 0 ),
+		NumBufferUploads( 0 ),
+		BufferBytes( 0 ) {}
+
+	int		NumTextureUploads;	// level 0 of a texture, one per decoded texture
+	size_t	TextureBytes;
+	int		NumBufferUploads;
+	size_t	BufferBytes;
+};
+
+static void GetUploadStats( const ovrGlRecorder & recorder, ovrUploadStats & stats )
+{
+	const ovrGlRecorder::StreamArray & stream = recorder.GetStream();
+	for ( UPInt i = 0; i < stream.GetSize(); )
+	{
+		const ovrGlCommand cmd = (ovrGlCommand)( stream[i] >> 16 );
+		const int numWords = stream[i] & 0xFFFF;
+		const uint32_t * args = &stream[i + 1];
+		if ( cmd == GL_CMD_COMPRESSED_TEX_IMAGE_2D )
+		{
+			stats.NumTextureUploads += ( args[1] == 0 );
+			stats.TextureBytes += args[6];
+		}
+		else if ( cmd == GL_CMD_BUFFER_DATA && args[0] != GL_UNIFORM_BUFFER )
+		{
+			stats.NumBufferUploads++;
+			stats.BufferBytes += args[1];
+		}
+		i += 1 + numWords;
+	}
+}
+
+// Adds the object names created or deleted by the recorded stream.
+static void GetObjectNames( const ovrGlRecorder & recorder, const ovrGlCommand cmd, Array< uint32_t > & names )
+{
+	const ovrGlRecorder::StreamArray & stream = recorder.GetStream();
+	for ( UPInt i = 0; i < stream.GetSize(); )
+	{
+		const int numWords = stream[i] & 0xFFFF;
+		if ( (ovrGlCommand)( stream[i] >> 16 ) == cmd )
+		{
+			const int n = stream[i + 1];
+			for ( int j = 0; j < n; j++ )
+			{
+				names.PushBack( stream[i + 2 + j] );
+			}
+		}
+		i += 1 + numWords;
+	}
+}
+
+static bool IsObjectUsed( const ModelFile & model, const uint32_t name )
+{
+	for ( int i = 0; i < model.Textures.GetSizeI(); i++ )
+	{
+		if ( model.Textures[i].texid.texture == name )
+		{
+			return true;
+		}
+	}
+	for ( int i = 0; i < model.Def.surfaces.GetSizeI(); i++ )
+	{
+		const GlGeometry & geo = model.Def.surfaces[i].geo;
+		if ( geo.vertexBuffer == name || geo.indexBuffer == name || geo.vertexArrayObject == name )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Every surface must refer to its own texture, shared or not, and a shared model
+// must use the same textures and meshes as the first scene for the shared surfaces.
+static bool CheckModel( const ovrBenchOptions & options, const int scene, const ModelFile & model, const ModelFile & first, const bool share )
+{
+	const int numSurfaces = options.SharedSurfaces + options.UniqueSurfaces;
+	if ( model.Textures.GetSizeI() != numSurfaces || model.Def.surfaces.GetSizeI() != numSurfaces )
+	{
+		printf( "scene %d: loaded %d textures and %d surfaces, expected %d\n", scene, model.Textures.GetSizeI(), model.Def.surfaces.GetSizeI(), numSurfaces );
+		return false;
+	}
+	for ( int i = 0; i < numSurfaces; i++ )
+	{
+		const ModelTexture & tex = model.Textures[i];
+		const ovrSurfaceDef & surface = model.Def.surfaces[i];
+		if ( tex.name != GetTextureName( options, scene, i ) || tex.texid.Width != options.TextureSize ||
+				surface.graphicsCommand.uniformTextures[0].texture != tex.texid.texture )
+		{
+			printf( "scene %d: surface %d doesn't use texture %s\n", scene, i, GetTextureName( options, scene, i ).ToCStr() );
+			return false;
+		}
+		if ( surface.geo.indexCount != ( options.VerticesPerSurface - 2 ) * 3 ||
+				surface.geo.localBounds.GetMins().x != (float)GetContentIndex( options, scene, i ) )
+		{
+			printf( "scene %d: surface %d has the wrong geometry\n", scene, i );
+			return false;
+		}
+		const bool shared = ( i < options.SharedSurfaces && share && &model != &first );
+		const bool sameTexture = ( tex.texid.texture == first.Textures[i].texid.texture );
+		const bool sameGeometry = ( surface.geo.vertexBuffer == first.Def.surfaces[i].geo.vertexBuffer );
+		if ( &model != &first && ( sameTexture != shared || sameGeometry != shared ) )
+		{
+			printf( "scene %d: surface %d is %sshared\n", scene, i, shared ? "not " : "" );
+			return false;
+		}
+	}
+	return true;
+}
+
+// Loads all scenes, checks them, and deletes them one at a time. Returns false if a
+// model was wrong, or an object was deleted while still used, deleted twice or leaked.
+static bool RunLoad( const ovrBenchOptions & options, ovrGlRecorder & recorder, const ModelGlPrograms & programs,
+					const bool binary, const bool share, const bool deferred, ovrUploadStats & stats, double & seconds )
+{
+	bool ok = true;
+
+	recorder.Clear();
+	Array< ModelFile * > models;
+	const double start = GetSeconds();
+	for ( int scene = 0; scene < options.NumScenes; scene++ )
+	{
+		MaterialParms materialParms;
+		materialParms.ShareAssets = share;
+		materialParms.DeferTextureLoads = deferred;
+		models.PushBack( LoadModelFile( GetPackageName( scene, binary ).ToCStr(), programs, materialParms ) );
+	}
+	for ( int scene = 0; scene < options.NumScenes; scene++ )
+	{
+		models[scene]->LoadDeferredTextures( NULL );
+	}
+	seconds = GetSeconds() - start;
+	GetUploadStats( recorder, stats );
+
+	for ( int scene = 0; scene < options.NumScenes; scene++ )
+	{
+		ok = CheckModel( options, scene, *models[scene], *models[0], share ) && ok;
+	}
+
+	static const ovrGlCommand genCommands[] = { GL_CMD_GEN_TEXTURES, GL_CMD_GEN_BUFFERS, GL_CMD_GEN_VERTEX_ARRAYS };
+	static const ovrGlCommand deleteCommands[] = { GL_CMD_DELETE_TEXTURES, GL_CMD_DELETE_BUFFERS, GL_CMD_DELETE_VERTEX_ARRAYS };
+	Array< uint32_t > created[3];
+	Hash< uint32_t, int > deletedCount[3];
+	for ( int type = 0; type < 3; type++ )
+	{
+		GetObjectNames( recorder, genCommands[type], created[type] );
+
+		// the placeholders and the copies that lost a race are deleted by the load
+		Array< uint32_t > deleted;
+		GetObjectNames( recorder, deleteCommands[type], deleted );
+		for ( int i = 0; i < deleted.GetSizeI(); i++ )
+		{
+			const int * count = deletedCount[type].Get( deleted[i] );
+			deletedCount[type].Set( deleted[i], ( count != NULL ) ? *count + 1 : 1 );
+		}
+	}
+
+	// Objects released by the first models must stay alive for the later ones.
+	for ( int scene = 0; scene < options.NumScenes; scene++ )
+	{
+		recorder.Clear();
+		delete models[scene];
+		for ( int type = 0; type < 3; type++ )
+		{
+			Array< uint32_t > deleted;
+			GetObjectNames( recorder, deleteCommands[type], deleted );
+			for ( int i = 0; i < deleted.GetSizeI(); i++ )
+			{
+				if ( deleted[i] == 0 )
+				{
+					continue;
+				}
+				for ( int later = scene + 1; later < options.NumScenes; later++ )
+				{
+					if ( IsObjectUsed( *models[later], deleted[i] ) )
+					{
+						printf( "object %u deleted with scene %d while scene %d uses it\n", deleted[i], scene, later );
+						ok = false;
+					}
+				}
+				const int * count = deletedCount[type].Get( deleted[i] );
+				deletedCount[type].Set( deleted[i], ( count != NULL ) ? *count + 1 : 1 );
+			}
+		}
+	}
+	for ( int type = 0; type < 3; type++ )
+	{
+		for ( int i = 0; i < created[type].GetSizeI(); i++ )
+		{
+			const int * count = deletedCount[type].Get( created[type][i] );
+			if ( count == NULL || *count != 1 )
+			{
+				printf( "object %u deleted %d times\n", created[type][i], ( count != NULL ) ? *count : 0 );
+				ok = false;
+			}
+		}
+	}
+
+	const ModelAssetCache & cache = ModelAssetCache::Get();
+	if ( cache.Textures.GetNumEntries() != 0 || cache.Geometry.GetNumEntries() != 0 ||
+			cache.Textures.GetResidentBytes() != 0 || cache.Geometry.GetResidentBytes() != 0 )
+	{
+		printf( "the cache still holds %d textures and %d meshes\n", cache.Textures.GetNumEntries(), cache.Geometry.GetNumEntries() );
+		ok = false;
+	}
+	return ok;
+}
+
+static int RunTest( const ovrBenchOptions & options )
+{
+	for ( int scene = 0; scene < options.NumScenes; scene++ )
+	{
+		WritePackages( options, scene );
+	}
+	printf( "%d scenes, each with %d shared and %d own surfaces, %dx%d ETC2 textures, %d vertices per surface\n",
+			options.NumScenes, options.SharedSurfaces, options.UniqueSurfaces, options.TextureSize, options.TextureSize,
+			options.VerticesPerSurface );
+
+	ovrGlRecorder recorder;
+	recorder.Install();
+
+	static ovrProgramParm parms[] =
+	{
+		{ "Texture0",	ovrProgramParmType::TEXTURE_SAMPLED },
+	};
+	GlProgram program = GlProgram::Build( VertexShaderSrc, FragmentShaderSrc, parms, 1 );
+	const ModelGlPrograms programs( &program );
+
+	int result = 0;
+	for ( int binary = 0; binary < 2; binary++ )
+	{
+		for ( int deferred = 0; deferred < 2; deferred++ )
+		{
+			printf( "\n%s, %s texture loads:\n", binary ? MODEL_BINARY_FILE_NAME : "models.json", deferred ? "deferred" : "eager" );
+			for ( int share = 0; share < 2; share++ )
+			{
+				ovrUploadStats stats;
+				double seconds = 0.0;
+				if ( !RunLoad( options, recorder, programs, binary != 0, share != 0, deferred != 0, stats, seconds ) )
+				{
+					result = 1;
+				}
+				printf( "  %-8s %7.2f ms, %4d texture uploads, %6.2f MB textures, %4d buffer uploads, %6.2f MB buffers\n",
+						share ? "shared" : "separate", seconds * 1e3, stats.NumTextureUploads, stats.TextureBytes / ( 1024.0 * 1024.0 ),
+						stats.NumBufferUploads, stats.BufferBytes / ( 1024.0 * 1024.0 ) );
+			}
+		}
+	}
+
+	const ModelAssetCache & cache = ModelAssetCache::Get();
+	printf( "\ncache totals: %d texture hits, %d textures added, %d mesh hits, %d meshes added\n",
+			cache.Textures.GetNumHits(), cache.Textures.GetNumAdds(), cache.Geometry.GetNumHits(), cache.Geometry.GetNumAdds() );
+	printf( result == 0 ? "OK\n" : "FAILED\n" );
+
+	GlProgram::Free( program );
+	recorder.Uninstall();
+	for ( int scene = 0; scene < options.NumScenes; scene++ )
+	{
+		remove( GetPackageName( scene, false ).ToCStr() );
+		remove( GetPackageName( scene, true ).ToCStr() );
+	}
+	return result;
+}
+
+int main( int argc, char * argv[] )
+{
+	ovrBenchOptions options;
+	for ( int i = 1; i < argc; i++ )
+	{
+		const bool hasValue = ( i + 1 < argc );
+		if ( strcmp( argv[i], "-scenes" ) == 0 && hasValue )
+		{
+			options.NumScenes = Alg::Clamp( atoi( argv[++i] ), 1, 16 );
+		}
+		else if ( strcmp( argv[i], "-shared" ) == 0 && hasValue )
+		{
+			options.SharedSurfaces = Alg::Clamp( atoi( argv[++i] ), 0, 200 );
+		}
+		else if ( strcmp( argv[i], "-unique" ) == 0 && hasValue )
+		{
+			options.UniqueSurfaces = Alg::Clamp( atoi( argv[++i] ), 1, 200 );
+		}
+		else if ( strcmp( argv[i], "-size" ) == 0 && hasValue )
+		{
+			options.TextureSize = Alg::Clamp( atoi( argv[++i] ), 4, 4096 );
+		}
+		else
+		{
+			printf( "USAGE: ModelAssetCacheBench [-scenes <n>] [-shared <n>] [-unique <n>] [-size <n>]\n" );
+			return 1;
+		}
+	}
+
+	System::Init( Log::ConfigureDefaultLog( LogMask_None ) );
+	const int result = RunTest( options );
+	System::Destroy();
+
+	return result;
+}
@@ -0,0 +1,347 @@
+/************************************************************************************
+
+Filename    :   main.cpp
+Content     :   Checks the collision queries with the polytope hierarchy against the
+				exhaustive queries, and benchmarks the queries per second of both.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "Kernel/OVR_System.h"
+#include "Kernel/OVR_Alg.h"
+#include "ModelCollision.h"
+#include "BenchCommon.h"
+
+using namespace OVR;
+
+static float RandomRange( uint32_t & seed, const float mins, const float maxs )
+{
+	return mins + ( maxs - mins ) * RandomFloat( seed );
+}
+
+struct ovrBenchOptions
+{
+	ovrBenchOptions() :
+		NumPolytopes( 2000 ),
+		SceneSize( 200.0f ),
+		NumQueries( 20000 ),
+		NumRuns( 5 ) {}
+
+	int		NumPolytopes;
+	float	SceneSize;
+	int		NumQueries;
+	int		NumRuns;
+};
+
+// Adds a box rotated around the vertical axis and tilted, optionally with the corners
+// cut off and the plane normals scaled.
+static void AddBox( ModelCollision & model, uint32_t & seed, const Vector3f & center, const Vector3f & halfSize )
+{
+	const Matrix4f rotation = Matrix4f::RotationY( RandomRange( seed, 0.0f, MATH_FLOAT_TWOPI ) ) *
+								Matrix4f::RotationX( ( Random( seed ) % 4 ) == 0 ? RandomRange( seed, -0.5f, 0.5f ) : 0.0f );
+	const bool cutCorners = ( Random( seed ) % 4 ) == 0;
+	const float normalScale = ( Random( seed ) % 8 ) == 0 ? RandomRange( seed, 0.5f, 2.0f ) : 1.0f;
+
+	CollisionPolytope polytope;
+	polytope.Name = "box";
+	for ( int i = 0; i < 6; i++ )
+	{
+		Vector3f normal( 0.0f );
+		normal[i >> 1] = ( i & 1 ) ? -1.0f : 1.0f;
+		const float distance = halfSize[i >> 1];
+		normal = rotation.Transform( normal );
+		polytope.Add( Planef( normal * normalScale, -( normal.Dot( center ) + distance ) * normalScale ) );
+	}
+	if ( cutCorners )
+	{
+		for ( int i = 0; i < 4; i++ )
+		{
+			const Vector3f local( ( i & 1 ) ? 1.0f : -1.0f, 0.0f, ( i & 2 ) ? 1.0f : -1.0f );
+			const Vector3f normal = rotation.Transform( local.Normalized() );
+			const float distance = 0.8f * ( fabsf( local.x ) * halfSize.x + fabsf( local.z ) * halfSize.z ) / local.Length();
+			polytope.Add( Planef( normal, -( normal.Dot( center ) + distance ) ) );
+		}
+	}
+	model.Polytopes.PushBack( polytope );
+}
+
+// Adds polytopes that are not bounded: a wall and a slab.
+static void AddUnbounded( ModelCollision & model, uint32_t & seed, const float sceneSize )
+{
+	CollisionPolytope wall;
+	wall.Name = "wall";
+	wall.Add( Planef( Vector3f( -1.0f, 0.0f, 0.0f ), -sceneSize ) );
+	model.Polytopes.PushBack( wall );
+
+	CollisionPolytope slab;
+	slab.Name = "slab";
+	const float height = RandomRange( seed, 5.0f, 10.0f );
+	slab.Add( Planef( Vector3f( 0.0f, 1.0f, 0.0f ), -( height + 0.5f ) ) );
+	slab.Add( Planef( Vector3f( 0.0f, -1.0f, 0.0f ), height - 0.5f ) );
+	slab.Add( Planef( Vector3f( 0.0f, 0.0f, 1.0f ), -sceneSize * 0.5f ) );
+	model.Polytopes.PushBack( slab );
+}
+
+static void BuildScene( const ovrBenchOptions & options, ModelCollision & collisions, ModelCollision & groundCollisions )
+{
+	uint32_t seed = 12345;
+	const float half = options.SceneSize * 0.5f;
+	for ( int i = 0; i < options.NumPolytopes; i++ )
+	{
+		if ( i == options.NumPolytopes / 2 )
+		{
+			AddUnbounded( collisions, seed, half );
+		}
+		const Vector3f center( RandomRange( seed, -half, half ), RandomRange( seed, 0.0f, 4.0f ), RandomRange( seed, -half, half ) );
+		const Vector3f halfSize( RandomRange( seed, 0.2f, 3.0f ), RandomRange( seed, 0.2f, 2.0f ), RandomRange( seed, 0.2f, 3.0f ) );
+		AddBox( collisions, seed, center, halfSize );
+	}
+
+	// Ground tiles.
+	const int tiles = 32;
+	const float tileSize = options.SceneSize / tiles;
+	for ( int z = 0; z < tiles; z++ )
+	{
+		for ( int x = 0; x < tiles; x++ )
+		{
+			const Vector3f center( -half + ( x + 0.5f ) * tileSize, RandomRange( seed, -0.6f, -0.4f ), -half + ( z + 0.5f ) * tileSize );
+			CollisionPolytope tile;
+			tile.Name = "tile";
+			for ( int i = 0; i < 6; i++ )
+			{
+				Vector3f normal( 0.0f );
+				normal[i >> 1] = ( i & 1 ) ? -1.0f : 1.0f;
+				const float distance = ( i >> 1 ) == 1 ? 0.5f : tileSize * 0.5f;
+				tile.Add( Planef( normal, -( normal.Dot( center ) + distance ) ) );
+			}
+			groundCollisions.Polytopes.PushBack( tile );
+		}
+	}
+}
+
+struct ovrQuery
+{
+	Vector3f	Start;
+	Vector3f	Dir;
+	float		Length;
+};
+
+static void BuildQueries( const ovrBenchOptions & options, Array< ovrQuery > & queries )
+{
+	static const float lengths[] = { 0.05f, 0.5f, 2.0f, 10.0f, 100.0f };
+	uint32_t seed = 54321;
+	const float half = options.SceneSize * 0.5f;
+	queries.Resize( options.NumQueries );
+	for ( int i = 0; i < options.NumQueries; i++ )
+	{
+		ovrQuery & query = queries[i];
+		query.Start = Vector3f( RandomRange( seed, -half, half ), RandomRange( seed, -1.0f, 6.0f ), RandomRange( seed, -half, half ) );
+		query.Dir = Vector3f( RandomRange( seed, -1.0f, 1.0f ), RandomRange( seed, -0.3f, 0.3f ), RandomRange( seed, -1.0f, 1.0f ) );
+		switch ( Random( seed ) % 8 )
+		{
+			case 0: query.Dir.x = 0.0f; break;
+			case 1: query.Dir.y = 0.0f; break;
+			case 2: query.Dir *= 3.0f; break;
+			default: query.Dir.Normalize(); break;
+		}
+		query.Length = lengths[Random( seed ) % ( sizeof( lengths ) / sizeof( lengths[0] ) )];
+	}
+}
+
+static bool SameFloat( const float a, const float b )
+{
+	return memcmp( &a, &b, sizeof( float ) ) == 0;
+}
+
+static bool SameVector( const Vector3f & a, const Vector3f & b )
+{
+	return SameFloat( a.x, b.x ) && SameFloat( a.y, b.y ) && SameFloat( a.z, b.z );
+}
+
+static bool SamePlane( const Planef & a, const Planef & b )
+{
+	return SameVector( a.N, b.N ) && SameFloat( a.D, b.D );
+}
+
+// Returns the number of queries that differ from the exhaustive queries.
+static int CheckQueries( const ModelCollision & hierarchy, const ModelCollision & exhaustive,
+						const ModelCollision & groundHierarchy, const ModelCollision & groundExhaustive,
+						const Array< ovrQuery > & queries, int & numHits )
+{
+	int errors = 0;
+	numHits = 0;
+	for ( int i = 0; i < queries.GetSizeI(); i++ )
+	{
+		const ovrQuery & query = queries[i];
+
+		if ( hierarchy.TestPoint( query.Start ) != exhaustive.TestPoint_Exhaustive( query.Start ) )
+		{
+			errors++;
+		}
+
+		float length0 = query.Length;
+		float length1 = query.Length;
+		Planef plane0( Vector3f( 0.0f ), 0.0f );
+		Planef plane1( Vector3f( 0.0f ), 0.0f );
+		const bool hit0 = hierarchy.TestRay( query.Start, query.Dir, length0, &plane0 );
+		const bool hit1 = exhaustive.TestRay_Exhaustive( query.Start, query.Dir, length1, &plane1 );
+		numHits += hit1;
+		if ( hit0 != hit1 || !SameFloat( length0, length1 ) || !SamePlane( plane0, plane1 ) )
+		{
+			errors++;
+		}
+
+		Vector3f p0 = query.Start;
+		Vector3f p1 = query.Start;
+		if ( hierarchy.PopOut( p0 ) != exhaustive.PopOut_Exhaustive( p1 ) || !SameVector( p0, p1 ) )
+		{
+			errors++;
+		}
+
+		const Vector3f foot0 = SlideMove( query.Start, 1.6f, query.Dir, query.Length, hierarchy, groundHierarchy );
+		const Vector3f foot1 = SlideMove( query.Start, 1.6f, query.Dir, query.Length, exhaustive, groundExhaustive );
+		if ( !SameVector( foot0, foot1 ) )
+		{
+			errors++;
+		}
+	}
+	return errors;
+}
+
+enum ovrQueryType
+{
+	QUERY_POINT,
+	QUERY_RAY,
+	QUERY_POP_OUT,
+	QUERY_SLIDE_MOVE,
+	QUERY_MAX
+};
+
+static const char * QueryNames[QUERY_MAX] = { "TestPoint", "TestRay", "PopOut", "SlideMove" };
+
+static double TimeQueries( const ovrQueryType type, const ModelCollision & model, const ModelCollision & groundModel,
+							const Array< ovrQuery > & queries, const int numRuns, int & checksum )
+{
+	double best = 1e10;
+	for ( int run = 0; run < numRuns; run++ )
+	{
+		const double start = GetSeconds();
+		for ( int i = 0; i < queries.GetSizeI(); i++ )
+		{
+			const ovrQuery & query = queries[i];
+			switch ( type )
+			{
+				case QUERY_POINT:
+					checksum += model.TestPoint( query.Start );
+					break;
+				case QUERY_RAY:
+				{
+					float length = query.Length;
+					checksum += model.TestRay( query.Start, query.Dir, length, NULL );
+					break;
+				}
+				case QUERY_POP_OUT:
+				{
+					Vector3f p = query.Start;
+					checksum += model.PopOut( p );
+					break;
+				}
+				case QUERY_SLIDE_MOVE:
+				{
+					const Vector3f foot = SlideMove( query.Start, 1.6f, query.Dir, query.Length, model, groundModel );
+					checksum += ( foot.x > query.Start.x );
+					break;
+				}
+				default:
+					break;
+			}
+		}
+		best = Alg::Min( best, GetSeconds() - start );
+	}
+	return best;
+}
+
+int main( int argc, char * argv[] )
+{
+	ovrBenchOptions options;
+	for ( int i = 1; i < argc; i++ )
+	{
+		if ( strcmp( argv[i], "-polytopes" ) == 0 && i + 1 < argc )
+		{
+			options.NumPolytopes = atoi( argv[++i] );
+		}
+		else if ( strcmp( argv[i], "-queries" ) == 0 && i + 1 < argc )
+		{
+			options.NumQueries = atoi( argv[++i] );
+		}
+		else if ( strcmp( argv[i], "-runs" ) == 0 && i + 1 < argc )
+		{
+			options.NumRuns = atoi( argv[++i] );
+		}
+		else
+		{
+			printf( "Usage: ModelCollisionBench [-polytopes <n>] [-queries <n>] [-runs <n>]\n" );
+			return 1;
+		}
+	}
+
+	OVR::System::Init();
+
+	int result = 0;
+	{
+		ModelCollision exhaustive;
+		ModelCollision groundExhaustive;
+		BuildScene( options, exhaustive, groundExhaustive );
+
+		ModelCollision hierarchy;
+		ModelCollision groundHierarchy;
+		hierarchy.Polytopes = exhaustive.Polytopes;
+		groundHierarchy.Polytopes = groundExhaustive.Polytopes;
+
+		const double buildStart = GetSeconds();
+		hierarchy.BuildHierarchy();
+		groundHierarchy.BuildHierarchy();
+		const double buildTime = GetSeconds() - buildStart;
+
+		printf( "%d polytopes, %d ground polytopes, %d nodes, %d unbounded, built in %.2f ms\n",
+				hierarchy.Polytopes.GetSizeI(), groundHierarchy.Polytopes.GetSizeI(),
+				hierarchy.Nodes.GetSizeI(), hierarchy.UnboundedPolytopes.GetSizeI(), buildTime * 1e3 );
+
+		Array< ovrQuery > queries;
+		BuildQueries( options, queries );
+
+		int numHits = 0;
+		const int errors = CheckQueries( hierarchy, exhaustive, groundHierarchy, groundExhaustive, queries, numHits );
+		printf( "%d queries, %d rays hit, %d differences\n", queries.GetSizeI(), numHits, errors );
+		if ( errors != 0 )
+		{
+			result = 1;
+		}
+
+		for ( int type = 0; type < QUERY_MAX; type++ )
+		{
+			int checksum0 = 0;
+			int checksum1 = 0;
+			const double time0 = TimeQueries( (ovrQueryType)type, exhaustive, groundExhaustive, queries, options.NumRuns, checksum0 );
+			const double time1 = TimeQueries( (ovrQueryType)type, hierarchy, groundHierarchy, queries, options.NumRuns, checksum1 );
+			printf( "%-10s exhaustive %10.0f/s  hierarchy %10.0f/s  %6.1fx%s\n", QueryNames[type],
+					queries.GetSizeI() / time0, queries.GetSizeI() / time1, time0 / time1,
+					checksum0 != checksum1 ? "  MISMATCH" : "" );
+			if ( checksum0 != checksum1 )
+			{
+				result = 1;
+			}
+		}
+	}
+
+	OVR::System::Destroy();
+	return result;
+}
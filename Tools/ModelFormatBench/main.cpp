@@ -0,0 +1,599 @@
+/************************************************************************************
+
+Filename    :   main.cpp
+Content     :   Host benchmark of loading a scene from models.ovrm compared to
+				models.json + models.bin, on the GL recorder.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "Kernel/OVR_System.h"
+#include "Kernel/OVR_Alg.h"
+#include "Kernel/OVR_JSON.h"
+#include "Kernel/OVR_String_Utils.h"
+#include "ModelFile.h"
+#include "ModelBinary.h"
+#include "GlRecorder.h"
+
+#include "zip.h"
+#include "unzip.h"
+#include "zlib.h"
+
+using namespace OVR;
+
+#include "../FbxConvert/Json2BinaryModel.h"
+#include "BenchCommon.h"
+
+static const char * VertexShaderSrc =
+	"in vec3 Position;\n"
+	"in vec4 VertexColor;\n"
+	"out lowp vec4 oColor;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_Position = TransformVertex( vec4( Position, 1.0 ) );\n"
+	"	oColor = VertexColor;\n"
+	"}\n";
+
+static const char * FragmentShaderSrc =
+	"in lowp vec4 oColor;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_FragColor = oColor;\n"
+	"}\n";
+
+struct ovrBenchOptions
+{
+	ovrBenchOptions() :
+		NumSurfaces( 400 ),
+		VerticesPerSurface( 2048 ),
+		NumPolytopes( 1000 ),
+		TraceGridSize( 96 ),
+		NumRuns( 5 ) {}
+
+	int		NumSurfaces;
+	int		VerticesPerSurface;
+	int		NumPolytopes;		// of the collision model, the ground collision model has a quarter
+	int		TraceGridSize;		// quads per side of the ray-trace model
+	int		NumRuns;
+};
+
+static const char * JsonPackageName = "/tmp/ModelFormatBench_json.ovrscene";
+static const char * BinaryPackageName = "/tmp/ModelFormatBench_ovrm.ovrscene";
+static const char * FallbackPackageName = "/tmp/ModelFormatBench_fallback.ovrscene";
+
+template< typename _type_ >
+static void AppendBinary( Array< uint8_t > & bin, const _type_ * data, const int count )
+{
+	const size_t offset = bin.GetSize();
+	bin.Resize( offset + count * sizeof( _type_ ) );
+	memcpy( &bin[offset], data, count * sizeof( _type_ ) );
+}
+
+static void AppendPolytopes( StringBuffer & json, const char * name, const int numPolytopes, uint32_t & seed )
+{
+	json.AppendFormat( "\"%s\" : [\n", name );
+	for ( int i = 0; i < numPolytopes; i++ )
+	{
+		// a box with a random center
+		const Vector3f center( RandomFloat( seed ) * 100.0f, RandomFloat( seed ) * 4.0f, RandomFloat( seed ) * 100.0f );
+		Array< Planef > planes;
+		for ( int axis = 0; axis < 3; axis++ )
+		{
+			Vector3f normal( 0.0f );
+			normal[axis] = 1.0f;
+			planes.PushBack( Planef( normal, -( center[axis] + 0.5f ) ) );
+			planes.PushBack( Planef( -normal, center[axis] - 0.5f ) );
+		}
+		json.AppendFormat( "{ \"name\" : \"%s%04d\", \"planes\" : \"%s\" }%s\n", name, i,
+				StringUtils::ToString( planes ).ToCStr(), ( i < numPolytopes - 1 ) ? "," : "" );
+	}
+	json.AppendFormat( "],\n" );
+}
+
+// The scene in the form the converter writes it: the structure as JSON, the large
+// arrays in the binary data that follows the models.bin header.
+static void BuildScene( const ovrBenchOptions & options, StringBuffer & json, Array< uint8_t > & bin )
+{
+	uint32_t seed = 1;
+
+	const uint32_t header = 0x6272766F;	// little endian "ovrb"
+	AppendBinary( bin, &header, 1 );
+
+	json.AppendFormat( "{\n\"render_model\" : {\n\"textures\" : [],\n\"joints\" : [\n" );
+	const int numJoints = 16;
+	for ( int i = 0; i < numJoints; i++ )
+	{
+		const Matrix4f transform = Matrix4f::Translation( (float)i, 0.0f, 0.0f );
+		json.AppendFormat( "{ \"name\" : \"joint%02d\", \"transform\" : \"%s\", \"animation\" : \"rotate\", \"parmX\" : 0, \"parmY\" : %d, \"parmZ\" : 0, \"timeOffset\" : 0, \"timeScale\" : 1 }%s\n",
+				i, StringUtils::ToString( transform ).ToCStr(), 10 + i, ( i < numJoints - 1 ) ? "," : "" );
+	}
+	json.AppendFormat( "],\n\"tags\" : [\n" );
+	const int numTags = 4;
+	for ( int i = 0; i < numTags; i++ )
+	{
+		json.AppendFormat( "{ \"name\" : \"tag%d\", \"matrix\" : \"%s\", \"jointIndices\" : \"%s\", \"jointWeights\" : \"%s\" }%s\n",
+				i, StringUtils::ToString( Matrix4f::Translation( 0.0f, (float)i, 0.0f ) ).ToCStr(),
+				StringUtils::ToString( Vector4i( i, 0, 0, 0 ) ).ToCStr(),
+				StringUtils::ToString( Vector4f( 1.0f, 0.0f, 0.0f, 0.0f ) ).ToCStr(), ( i < numTags - 1 ) ? "," : "" );
+	}
+	json.AppendFormat( "],\n\"surfaces\" : [\n" );
+
+	const int numVertices = options.VerticesPerSurface;
+	const int numIndices = ( numVertices - 2 ) * 3;
+
+	Array< Vector3f > positions;
+	Array< Vector3f > normals;
+	Array< Vector4f > colors;
+	Array< Vector2f > uvs;
+	Array< TriangleIndex > indices;
+	positions.Resize( numVertices );
+	normals.Resize( numVertices );
+	colors.Resize( numVertices );
+	uvs.Resize( numVertices );
+	indices.Resize( numIndices );
+	for ( int i = 0; i < options.NumSurfaces; i++ )
+	{
+		Bounds3f bounds( Bounds3f::Init );
+		for ( int v = 0; v < numVertices; v++ )
+		{
+			const float x = (float)( v >> 1 );
+			const float y = (float)( v & 1 );
+			positions[v] = Vector3f( (float)i + x * 0.01f, y, RandomFloat( seed ) * 0.1f );
+			normals[v] = Vector3f( 0.0f, 0.0f, 1.0f );
+			colors[v] = Vector4f( RandomFloat( seed ), RandomFloat( seed ), RandomFloat( seed ), 1.0f );
+			uvs[v] = Vector2f( x / numVertices, y );
+			bounds.AddPoint( positions[v] );
+		}
+		for ( int t = 0; t < numVertices - 2; t++ )
+		{
+			indices[t * 3 + 0] = (TriangleIndex)( t );
+			indices[t * 3 + 1] = (TriangleIndex)( t + 1 + ( t & 1 ) );
+			indices[t * 3 + 2] = (TriangleIndex)( t + 2 - ( t & 1 ) );
+		}
+		AppendBinary( bin, positions.GetDataPtr(), numVertices );
+		AppendBinary( bin, normals.GetDataPtr(), numVertices );
+		AppendBinary( bin, colors.GetDataPtr(), numVertices );
+		AppendBinary( bin, uvs.GetDataPtr(), numVertices );
+		AppendBinary( bin, indices.GetDataPtr(), numIndices );
+
+		json.AppendFormat( "{\n\"source\" : [ \"surface%03d\" ],\n", i );
+		json.AppendFormat( "\"material\" : { \"type\" : \"%s\" },\n", ( i & 7 ) == 7 ? "transparent" : "opaque" );
+		json.AppendFormat( "\"bounds\" : \"%s\",\n", StringUtils::ToString( bounds ).ToCStr() );
+		json.AppendFormat( "\"vertices\" : { \"vertexCount\" : %d, \"position\" : \"bin\", \"normal\" : \"bin\", \"color\" : \"bin\", \"uv0\" : \"bin\" },\n", numVertices );
+		json.AppendFormat( "\"triangles\" : { \"indexCount\" : %d, \"indices\" : \"bin\" }\n", numIndices );
+		json.AppendFormat( "}%s\n", ( i < options.NumSurfaces - 1 ) ? "," : "" );
+	}
+	json.AppendFormat( "]\n},\n" );
+
+	// the converter writes the planes as text
+	AppendPolytopes( json, "collision_model", options.NumPolytopes, seed );
+	AppendPolytopes( json, "ground_collision_model", Alg::Max( 1, options.NumPolytopes / 4 ), seed );
+
+	// A height field with a single leaf kd-tree that keeps all triangles in the
+	// overflow list. The tree quality doesn't matter for loading.
+	const int gridSize = options.TraceGridSize;
+	Array< Vector3f > traceVertices;
+	Array< Vector2f > traceUvs;
+	Array< int > traceIndices;
+	Bounds3f traceBounds( Bounds3f::Init );
+	for ( int z = 0; z <= gridSize; z++ )
+	{
+		for ( int x = 0; x <= gridSize; x++ )
+		{
+			const Vector3f vertex( (float)x, RandomFloat( seed ), (float)z );
+			traceVertices.PushBack( vertex );
+			traceUvs.PushBack( Vector2f( (float)x / gridSize, (float)z / gridSize ) );
+			traceBounds.AddPoint( vertex );
+		}
+	}
+	for ( int z = 0; z < gridSize; z++ )
+	{
+		for ( int x = 0; x < gridSize; x++ )
+		{
+			const int v = z * ( gridSize + 1 ) + x;
+			traceIndices.PushBack( v );
+			traceIndices.PushBack( v + gridSize + 1 );
+			traceIndices.PushBack( v + 1 );
+			traceIndices.PushBack( v + 1 );
+			traceIndices.PushBack( v + gridSize + 1 );
+			traceIndices.PushBack( v + gridSize + 2 );
+		}
+	}
+	kdtree_node_t node;
+	node.data = 1;
+	node.dist = 0.0f;
+	kdtree_leaf_t leaf;
+	leaf.triangles[0] = (int)0x80000000;
+	for ( int i = 1; i < RT_KDTREE_MAX_LEAF_TRIANGLES; i++ )
+	{
+		leaf.triangles[i] = -1;
+	}
+	for ( int i = 0; i < 6; i++ )
+	{
+		leaf.ropes[i] = -1;
+	}
+	leaf.bounds = traceBounds;
+	Array< int > traceOverflow;
+	for ( int i = 0; i < traceIndices.GetSizeI() / 3; i++ )
+	{
+		traceOverflow.PushBack( i );
+	}
+	AppendBinary( bin, traceVertices.GetDataPtr(), traceVertices.GetSizeI() );
+	AppendBinary( bin, traceUvs.GetDataPtr(), traceUvs.GetSizeI() );
+	AppendBinary( bin, traceIndices.GetDataPtr(), traceIndices.GetSizeI() );
+	AppendBinary( bin, &node, 1 );
+	AppendBinary( bin, &leaf, 1 );
+	AppendBinary( bin, traceOverflow.GetDataPtr(), traceOverflow.GetSizeI() );
+
+	json.AppendFormat( "\"raytrace_model\" : {\n" );
+	json.AppendFormat( "\"numVertices\" : %d, \"numUvs\" : %d, \"numIndices\" : %d, \"numNodes\" : 1, \"numLeafs\" : 1, \"numOverflow\" : %d,\n",
+			traceVertices.GetSizeI(), traceUvs.GetSizeI(), traceIndices.GetSizeI(), traceOverflow.GetSizeI() );
+	json.AppendFormat( "\"bounds\" : \"%s\",\n", StringUtils::ToString( traceBounds ).ToCStr() );
+	json.AppendFormat( "\"vertices\" : \"bin\", \"uvs\" : \"bin\", \"indices\" : \"bin\", \"nodes\" : \"bin\", \"leafs\" : \"bin\", \"overflow\" : \"bin\"\n" );
+	json.AppendFormat( "}\n}\n" );
+}
+
+// Stored entries, so both loaders can use the package data in place.
+static void AddZipEntry( zipFile zf, const char * packageName, const char * name, const void * data, const size_t size,
+		const void * extraField, const int extraFieldSize )
+{
+	zip_fileinfo info;
+	memset( &info, 0, sizeof( info ) );
+	if ( zipOpenNewFileInZip( zf, name, &info, extraField, extraFieldSize, NULL, 0, NULL, 0, 0 ) != ZIP_OK ||
+			zipWriteInFileInZip( zf, data, (unsigned)size ) != ZIP_OK ||
+			zipCloseFileInZip( zf ) != ZIP_OK )
+	{
+		printf( "failed to add %s to %s\n", name, packageName );
+		exit( 1 );
+	}
+}
+
+static void WritePackages( const ovrBenchOptions & options, size_t & jsonSize, size_t & binSize, size_t & ovrmSize )
+{
+	StringBuffer json;
+	Array< uint8_t > bin;
+	BuildScene( options, json, bin );
+
+	JSON * scene = JSON::Parse( json.ToCStr() );
+	Array< uint8_t > ovrm;
+	if ( scene == NULL || !Json2BinaryModel( scene, bin.GetDataPtr(), bin.GetSizeI(), ovrm ) )
+	{
+		printf( "failed to build %s\n", MODEL_BINARY_FILE_NAME );
+		exit( 1 );
+	}
+	scene->Release();
+
+	zipFile zf = zipOpen( JsonPackageName, APPEND_STATUS_CREATE );
+	AddZipEntry( zf, JsonPackageName, "models.json", json.ToCStr(), json.GetSize(), NULL, 0 );
+	AddZipEntry( zf, JsonPackageName, "models.bin", bin.GetDataPtr(), bin.GetSize(), NULL, 0 );
+	zipClose( zf, NULL );
+
+	// The first local header is 30 bytes plus the name, pad it with an extra field
+	// so the data is aligned, the way zipalign does for Android packages.
+	const int headerSize = 30 + (int)strlen( MODEL_BINARY_FILE_NAME );
+	uint8_t extraField[4 + MODEL_BINARY_ALIGNMENT] = { 0x35, 0xD9 };
+	const int extraFieldSize = 4 + ( ( MODEL_BINARY_ALIGNMENT - ( ( headerSize + 4 ) % MODEL_BINARY_ALIGNMENT ) ) % MODEL_BINARY_ALIGNMENT );
+	extraField[2] = (uint8_t)( extraFieldSize - 4 );
+	zf = zipOpen( BinaryPackageName, APPEND_STATUS_CREATE );
+	AddZipEntry( zf, BinaryPackageName, MODEL_BINARY_FILE_NAME, ovrm.GetDataPtr(), ovrm.GetSize(), extraField, extraFieldSize );
+	zipClose( zf, NULL );
+
+	// A ray-trace leaf with a triangle out of range, which only ModelTrace::Validate
+	// finds, next to a good models.json that has to be loaded instead.
+	const model_binary_header_t * header = (const model_binary_header_t *)ovrm.GetDataPtr();
+	const model_binary_chunk_t * chunks = (const model_binary_chunk_t *)( header + 1 );
+	for ( uint32_t i = 0; i < header->numChunks; i++ )
+	{
+		if ( chunks[i].id == MODEL_BINARY_CHUNK_TRACE_LEAFS && chunks[i].count > 0 )
+		{
+			kdtree_leaf_t * leaf = (kdtree_leaf_t *)( ovrm.GetDataPtr() + chunks[i].offset );
+			leaf->triangles[0] = 0x7FFFFFFF;
+		}
+	}
+	zf = zipOpen( FallbackPackageName, APPEND_STATUS_CREATE );
+	AddZipEntry( zf, FallbackPackageName, MODEL_BINARY_FILE_NAME, ovrm.GetDataPtr(), ovrm.GetSize(), extraField, extraFieldSize );
+	AddZipEntry( zf, FallbackPackageName, "models.json", json.ToCStr(), json.GetSize(), NULL, 0 );
+	AddZipEntry( zf, FallbackPackageName, "models.bin", bin.GetDataPtr(), bin.GetSize(), NULL, 0 );
+	zipClose( zf, NULL );
+
+	jsonSize = json.GetSize();
+	binSize = bin.GetSize();
+	ovrmSize = ovrm.GetSize();
+}
+
+static bool IsEntryAligned( const char * packageName, const char * entryName )
+{
+	unzFile zfp = unzOpen( packageName );
+	bool aligned = false;
+	if ( zfp != NULL && unzLocateFile( zfp, entryName, 0 ) == UNZ_OK && unzOpenCurrentFile( zfp ) == UNZ_OK )
+	{
+		aligned = ( unzGetCurrentFileZStreamPos64( zfp ) % MODEL_BINARY_ALIGNMENT ) == 0;
+		unzCloseCurrentFile( zfp );
+	}
+	unzClose( zfp );
+	return aligned;
+}
+
+// Hash of the buffer uploads in the order they were made, without object names.
+static uint32_t GetUploadHash( const ovrGlRecorder & recorder )
+{
+	const ovrGlRecorder::StreamArray & stream = recorder.GetStream();
+	uint32_t hash = 2166136261u;
+	for ( UPInt i = 0; i < stream.GetSize(); )
+	{
+		const ovrGlCommand cmd = (ovrGlCommand)( stream[i] >> 16 );
+		const int numWords = stream[i] & 0xFFFF;
+		if ( cmd == GL_CMD_BUFFER_DATA || cmd == GL_CMD_VERTEX_ATTRIB_POINTER )
+		{
+			for ( int j = 0; j <= numWords; j++ )
+			{
+				hash = ( hash ^ stream[i + j] ) * 16777619u;
+			}
+		}
+		i += 1 + numWords;
+	}
+	return hash;
+}
+
+template< typename _type_ >
+static bool SameArray( const Array< _type_ > & a, const Array< _type_ > & b )
+{
+	return a.GetSize() == b.GetSize() && ( a.GetSize() == 0 || memcmp( &a[0], &b[0], a.GetSize() * sizeof( a[0] ) ) == 0 );
+}
+
+static bool SameCollision( const ModelCollision & a, const ModelCollision & b )
+{
+	if ( a.Polytopes.GetSize() != b.Polytopes.GetSize() )
+	{
+		return false;
+	}
+	for ( int i = 0; i < a.Polytopes.GetSizeI(); i++ )
+	{
+		if ( a.Polytopes[i].Name != b.Polytopes[i].Name || !SameArray( a.Polytopes[i].Planes, b.Polytopes[i].Planes ) )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Both loaders must produce the same model.
+static bool CompareModels( const ModelFile & a, const ModelFile & b )
+{
+	if ( a.Def.surfaces.GetSize() != b.Def.surfaces.GetSize() )
+	{
+		printf( "surface count %d != %d\n", a.Def.surfaces.GetSizeI(), b.Def.surfaces.GetSizeI() );
+		return false;
+	}
+	for ( int i = 0; i < a.Def.surfaces.GetSizeI(); i++ )
+	{
+		const ovrSurfaceDef & sa = a.Def.surfaces[i];
+		const ovrSurfaceDef & sb = b.Def.surfaces[i];
+		if ( sa.surfaceName != sb.surfaceName ||
+				sa.geo.vertexCount != sb.geo.vertexCount ||
+				sa.geo.indexCount != sb.geo.indexCount ||
+				memcmp( &sa.geo.localBounds, &sb.geo.localBounds, sizeof( Bounds3f ) ) != 0 ||
+				sa.graphicsCommand.GpuState.blendEnable != sb.graphicsCommand.GpuState.blendEnable ||
+				sa.graphicsCommand.Program.Program != sb.graphicsCommand.Program.Program )
+		{
+			printf( "surface %d differs\n", i );
+			return false;
+		}
+	}
+	if ( a.Joints.GetSize() != b.Joints.GetSize() || a.Tags.GetSize() != b.Tags.GetSize() )
+	{
+		printf( "joints or tags differ\n" );
+		return false;
+	}
+	for ( int i = 0; i < a.Joints.GetSizeI(); i++ )
+	{
+		if ( a.Joints[i].name != b.Joints[i].name || !( a.Joints[i].transform == b.Joints[i].transform ) ||
+				a.Joints[i].animation != b.Joints[i].animation || !( a.Joints[i].parameters == b.Joints[i].parameters ) )
+		{
+			printf( "joint %d differs\n", i );
+			return false;
+		}
+	}
+	for ( int i = 0; i < a.Tags.GetSizeI(); i++ )
+	{
+		if ( a.Tags[i].name != b.Tags[i].name || !( a.Tags[i].matrix == b.Tags[i].matrix ) ||
+				!( a.Tags[i].jointIndices == b.Tags[i].jointIndices ) || !( a.Tags[i].jointWeights == b.Tags[i].jointWeights ) )
+		{
+			printf( "tag %d differs\n", i );
+			return false;
+		}
+	}
+	if ( !SameCollision( a.Collisions, b.Collisions ) || !SameCollision( a.GroundCollisions, b.GroundCollisions ) )
+	{
+		printf( "collision models differ\n" );
+		return false;
+	}
+	const ModelTrace & ta = a.TraceModel;
+	const ModelTrace & tb = b.TraceModel;
+	if ( memcmp( &ta.header, &tb.header, sizeof( ta.header ) ) != 0 ||
+			!SameArray( ta.vertices, tb.vertices ) || !SameArray( ta.uvs, tb.uvs ) || !SameArray( ta.indices, tb.indices ) ||
+			!SameArray( ta.nodes, tb.nodes ) || !SameArray( ta.leafs, tb.leafs ) || !SameArray( ta.overflow, tb.overflow ) )
+	{
+		printf( "ray-trace models differ\n" );
+		return false;
+	}
+	return true;
+}
+
+// Loads a package in a process of its own and returns the peak resident size in kB.
+static long MeasurePeakMemory( const char * self, const char * packageName )
+{
+	fflush( stdout );
+	const pid_t pid = fork();
+	if ( pid == 0 )
+	{
+		execl( self, self, "-load", packageName, (char *)NULL );
+		_exit( 1 );
+	}
+	int status = 0;
+	struct rusage usage;
+	if ( pid < 0 || wait4( pid, &status, 0, &usage ) != pid || !WIFEXITED( status ) || WEXITSTATUS( status ) != 0 )
+	{
+		return -1;
+	}
+	return usage.ru_maxrss;
+}
+
+// The child process of MeasurePeakMemory. "none" only sets up the recorder and the
+// program, which is the baseline for both packages.
+static int LoadOnce( const char * packageName )
+{
+	ovrGlRecorder recorder;
+	recorder.Install();
+	GlProgram program = GlProgram::Build( VertexShaderSrc, FragmentShaderSrc, NULL, 0 );
+	const ModelGlPrograms programs( &program );
+	int result = 0;
+	if ( strcmp( packageName, "none" ) != 0 )
+	{
+		MaterialParms materialParms;
+		ModelFile * model = LoadModelFile( packageName, programs, materialParms );
+		result = ( model->Def.surfaces.GetSizeI() > 0 ) ? 0 : 1;
+		delete model;
+	}
+	GlProgram::Free( program );
+	recorder.Uninstall();
+	return result;
+}
+
+static int RunBenchmark( const char * self, const ovrBenchOptions & options )
+{
+	size_t jsonSize = 0;
+	size_t binSize = 0;
+	size_t ovrmSize = 0;
+	WritePackages( options, jsonSize, binSize, ovrmSize );
+	printf( "scene: %d surfaces of %d vertices, %d + %d polytopes, %d ray-trace triangles\n",
+			options.NumSurfaces, options.VerticesPerSurface, options.NumPolytopes, Alg::Max( 1, options.NumPolytopes / 4 ),
+			options.TraceGridSize * options.TraceGridSize * 2 );
+	printf( "models.json %.2f MB + models.bin %.2f MB, %s %.2f MB%s\n",
+			jsonSize / ( 1024.0 * 1024.0 ), binSize / ( 1024.0 * 1024.0 ), MODEL_BINARY_FILE_NAME, ovrmSize / ( 1024.0 * 1024.0 ),
+			IsEntryAligned( BinaryPackageName, MODEL_BINARY_FILE_NAME ) ? ", aligned in the package" : "" );
+
+	ovrGlRecorder recorder;
+	recorder.Install();
+	GlProgram program = GlProgram::Build( VertexShaderSrc, FragmentShaderSrc, NULL, 0 );
+	const ModelGlPrograms programs( &program );
+
+	int result = 0;
+
+	const char * packages[2] = { JsonPackageName, BinaryPackageName };
+	double seconds[2] = { 1e10, 1e10 };
+	uint32_t uploadHash[2] = { 0, 0 };
+	ModelFile * models[2] = { NULL, NULL };
+	for ( int p = 0; p < 2; p++ )
+	{
+		for ( int run = 0; run < options.NumRuns; run++ )
+		{
+			recorder.Clear();
+			MaterialParms materialParms;
+			const double start = GetSeconds();
+			ModelFile * model = LoadModelFile( packages[p], programs, materialParms );
+			seconds[p] = Alg::Min( seconds[p], GetSeconds() - start );
+			uploadHash[p] = GetUploadHash( recorder );
+			delete models[p];
+			models[p] = model;
+		}
+	}
+
+	if ( models[0]->Def.surfaces.GetSizeI() != options.NumSurfaces || !CompareModels( *models[0], *models[1] ) )
+	{
+		result = 1;
+	}
+	if ( uploadHash[0] != uploadHash[1] )
+	{
+		printf( "the loaders uploaded different vertex data\n" );
+		result = 1;
+	}
+
+	// A bad models.ovrm is skipped without creating anything.
+	recorder.Clear();
+	MaterialParms materialParms;
+	ModelFile * fallback = LoadModelFile( FallbackPackageName, programs, materialParms );
+	if ( !CompareModels( *models[0], *fallback ) || GetUploadHash( recorder ) != uploadHash[0] )
+	{
+		printf( "the load with a bad %s didn't fall back to models.json\n", MODEL_BINARY_FILE_NAME );
+		result = 1;
+	}
+	delete fallback;
+	delete models[0];
+	delete models[1];
+
+	GlProgram::Free( program );
+	recorder.Uninstall();
+
+	const long baseKB = MeasurePeakMemory( self, "none" );
+	const long jsonKB = MeasurePeakMemory( self, JsonPackageName );
+	const long ovrmKB = MeasurePeakMemory( self, BinaryPackageName );
+
+	printf( "json + bin load:  %7.2f ms, peak memory +%.1f MB\n", seconds[0] * 1e3, ( jsonKB - baseKB ) / 1024.0 );
+	printf( "ovrm load:        %7.2f ms, peak memory +%.1f MB\n", seconds[1] * 1e3, ( ovrmKB - baseKB ) / 1024.0 );
+	printf( "speedup:          %7.2fx  (uploads %08x)\n", seconds[0] / seconds[1], uploadHash[1] );
+
+	if ( baseKB < 0 || jsonKB < 0 || ovrmKB < 0 )
+	{
+		printf( "failed to measure the peak memory\n" );
+		result = 1;
+	}
+	printf( result == 0 ? "OK\n" : "FAILED\n" );
+
+	remove( JsonPackageName );
+	remove( BinaryPackageName );
+	remove( FallbackPackageName );
+
+	return result;
+}
+
+int main( int argc, char * argv[] )
+{
+	ovrBenchOptions options;
+	const char * loadPackage = NULL;
+	for ( int i = 1; i < argc; i++ )
+	{
+		const bool hasValue = ( i + 1 < argc );
+		if ( strcmp( argv[i], "-surfaces" ) == 0 && hasValue )
+		{
+			options.NumSurfaces = Alg::Clamp( atoi( argv[++i] ), 1, 10000 );
+		}
+		else if ( strcmp( argv[i], "-vertices" ) == 0 && hasValue )
+		{
+			options.VerticesPerSurface = Alg::Clamp( atoi( argv[++i] ), 3, 65536 );
+		}
+		else if ( strcmp( argv[i], "-polytopes" ) == 0 && hasValue )
+		{
+			options.NumPolytopes = Alg::Clamp( atoi( argv[++i] ), 1, 100000 );
+		}
+		else if ( strcmp( argv[i], "-runs" ) == 0 && hasValue )
+		{
+			options.NumRuns = Alg::Max( 1, atoi( argv[++i] ) );
+		}
+		else if ( strcmp( argv[i], "-load" ) == 0 && hasValue )
+		{
+			loadPackage = argv[++i];
+		}
+		else
+		{
+			printf( "USAGE: ModelFormatBench [-surfaces <n>] [-vertices <n>] [-polytopes <n>] [-runs <n>]\n" );
+			return 1;
+		}
+	}
+
+	System::Init( Log::ConfigureDefaultLog( LogMask_None ) );
+	const int result = ( loadPackage != NULL ) ? LoadOnce( loadPackage ) : RunBenchmark( argv[0], options );
+	System::Destroy();
+
+	return result;
+}
@@ -0,0 +1,471 @@
+/************************************************************************************
+
+Filename    :   main.cpp
+Content     :   Host benchmark of model package loading on the GL recorder, with
+				the textures decoded while the geometry is parsed or deferred.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "Kernel/OVR_System.h"
+#include "Kernel/OVR_Alg.h"
+#include "Kernel/OVR_MemBuffer.h"
+#include "Kernel/OVR_Threads.h"
+#include "ModelFile.h"
+#include "GlRecorder.h"
+#include "OVR_WorkerPool.h"
+#include "OVR_TextureLoader.h"
+
+#include "zip.h"
+#include "zlib.h"
+#include "BenchCommon.h"
+
+using namespace OVR;
+
+// The texture loader times its uploads with the VrApi clock.
+extern "C" double vrapi_GetTimeInSeconds()
+{
+	return GetSeconds();
+}
+
+static const char * VertexShaderSrc =
+	"in vec3 Position;\n"
+	"in vec2 TexCoord;\n"
+	"out highp vec2 oTexCoord;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_Position = TransformVertex( vec4( Position, 1.0 ) );\n"
+	"	oTexCoord = TexCoord;\n"
+	"}\n";
+
+static const char * FragmentShaderSrc =
+	"uniform sampler2D Texture0;\n"
+	"in highp vec2 oTexCoord;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_FragColor = texture2D( Texture0, oTexCoord );\n"
+	"}\n";
+
+struct ovrBenchOptions
+{
+	ovrBenchOptions() :
+		NumTextures( 200 ),
+		TextureSize( 512 ),
+		VerticesPerSurface( 2048 ),
+		NumRuns( 5 ) {}
+
+	int		NumTextures;		// one surface per texture
+	int		TextureSize;
+	int		VerticesPerSurface;
+	int		NumRuns;
+};
+
+static const char * PackageName = "/tmp/ModelLoadBench.ovrscene";
+
+// The same upload budget as the App, at 60 Hz.
+static const double TEXTURE_UPLOAD_BUDGET_SECONDS = 0.002;
+static const int FRAME_MICROSECONDS = 16667;
+static const char * TextureTempName = "/tmp/ModelLoadBench.ktx";
+
+// An ETC2 texture with a full mip chain. The block colors follow a gradient and the
+// modifier bits are noise, so it deflates about as well as real content.
+static void BuildTextureKTX( const int size, uint32_t & seed, MemBufferT< uint8_t > & ktx )
+{
+	size_t dataSize = 0;
+	int mipCount = 0;
+	for ( int w = size; ; w >>= 1 )
+	{
+		dataSize += GetOvrTextureSize( Texture_ETC2_RGB, w, w );
+		mipCount++;
+		if ( w == 1 )
+		{
+			break;
+		}
+	}
+
+	ovrTextureImage image;
+	image.Format = Texture_ETC2_RGB;
+	image.Width = size;
+	image.Height = size;
+	image.MipCount = mipCount;
+	image.NumFaces = 1;
+	image.OwnedData = (uint8_t *)malloc( dataSize );
+	image.Data = image.OwnedData;
+	image.DataSize = dataSize;
+
+	const uint32_t hue = Random( seed );
+	for ( size_t i = 0; i < dataSize; i += 8 )
+	{
+		uint8_t * block = image.OwnedData + i;
+		const uint32_t gradient = hue + (uint32_t)( i >> 9 );
+		block[0] = (uint8_t)( gradient );
+		block[1] = (uint8_t)( gradient >> 3 );
+		block[2] = (uint8_t)( gradient >> 6 );
+		block[3] = 0x02;
+		const uint32_t noise = Random( seed );
+		block[4] = (uint8_t)( noise );
+		block[5] = (uint8_t)( noise >> 8 );
+		block[6] = (uint8_t)( noise & 0xF0 );
+		block[7] = 0;
+	}
+
+	if ( !WriteTextureKTX( TextureTempName, image ) )
+	{
+		printf( "failed to write %s\n", TextureTempName );
+		exit( 1 );
+	}
+	MemBufferFile file( TextureTempName );
+	ktx.Realloc( file.Length );
+	memcpy( ktx, file.Buffer, file.Length );
+	remove( TextureTempName );
+}
+
+static void AddZipEntry( zipFile zf, const char * name, const void * data, const size_t size )
+{
+	zip_fileinfo info;
+	memset( &info, 0, sizeof( info ) );
+	if ( zipOpenNewFileInZip( zf, name, &info, NULL, 0, NULL, 0, NULL, Z_DEFLATED, Z_DEFAULT_COMPRESSION ) != ZIP_OK ||
+			zipWriteInFileInZip( zf, data, (unsigned)size ) != ZIP_OK ||
+			zipCloseFileInZip( zf ) != ZIP_OK )
+	{
+		printf( "failed to add %s to %s\n", name, PackageName );
+		exit( 1 );
+	}
+}
+
+template< typename _type_ >
+static void AppendBinary( Array< uint8_t > & bin, const _type_ * data, const int count )
+{
+	const size_t offset = bin.GetSize();
+	bin.Resize( offset + count * sizeof( _type_ ) );
+	memcpy( &bin[offset], data, count * sizeof( _type_ ) );
+}
+
+// A texture file of the package, deflated as in the zip.
+struct ovrBenchTexture
+{
+	MemBufferT< uint8_t >	Deflated;
+	size_t					DeflatedSize;
+	size_t					Size;
+};
+
+// Writes a package with one surface per texture, the textures first as exported
+// packages have them.
+static void WritePackage( const ovrBenchOptions & options, Array< ovrBenchTexture * > & textures )
+{
+	zipFile zf = zipOpen( PackageName, APPEND_STATUS_CREATE );
+	if ( zf == NULL )
+	{
+		printf( "failed to create %s\n", PackageName );
+		exit( 1 );
+	}
+
+	uint32_t seed = 1;
+	for ( int i = 0; i < options.NumTextures; i++ )
+	{
+		MemBufferT< uint8_t > ktx;
+		BuildTextureKTX( options.TextureSize, seed, ktx );
+		AddZipEntry( zf, String::Format( "texture%03d.ktx", i ).ToCStr(), ktx, ktx.GetSize() );
+
+		ovrBenchTexture * texture = new ovrBenchTexture;
+		uLongf deflatedSize = compressBound( ktx.GetSize() );
+		texture->Deflated.Realloc( deflatedSize );
+		compress2( texture->Deflated, &deflatedSize, ktx, ktx.GetSize(), Z_DEFAULT_COMPRESSION );
+		texture->DeflatedSize = deflatedSize;
+		texture->Size = ktx.GetSize();
+		textures.PushBack( texture );
+	}
+
+	const int numVertices = options.VerticesPerSurface;
+	const int numIndices = ( numVertices - 2 ) * 3;
+
+	Array< uint8_t > bin;
+	const uint32_t header = 0x6272766F;	// little endian "ovrb"
+	AppendBinary( bin, &header, 1 );
+
+	StringBuffer json;
+	json.AppendFormat( "{\n\"render_model\" : {\n\"textures\" : [\n" );
+	for ( int i = 0; i < options.NumTextures; i++ )
+	{
+		json.AppendFormat( "{ \"name\" : \"texture%03d\", \"usage\" : \"diffuse\", \"occlusion\" : \"opaque\" }%s\n",
+				i, ( i < options.NumTextures - 1 ) ? "," : "" );
+	}
+	json.AppendFormat( "],\n\"surfaces\" : [\n" );
+
+	Array< Vector3f > positions;
+	Array< Vector3f > normals;
+	Array< Vector2f > uvs;
+	Array< TriangleIndex > indices;
+	positions.Resize( numVertices );
+	normals.Resize( numVertices );
+	uvs.Resize( numVertices );
+	indices.Resize( numIndices );
+	for ( int i = 0; i < options.NumTextures; i++ )
+	{
+		for ( int v = 0; v < numVertices; v++ )
+		{
+			const float x = (float)( v >> 1 );
+			const float y = (float)( v & 1 );
+			positions[v] = Vector3f( (float)i + x * 0.01f, y, 0.0f );
+			normals[v] = Vector3f( 0.0f, 0.0f, 1.0f );
+			uvs[v] = Vector2f( x / numVertices, y );
+		}
+		for ( int t = 0; t < numVertices - 2; t++ )
+		{
+			indices[t * 3 + 0] = (TriangleIndex)( t );
+			indices[t * 3 + 1] = (TriangleIndex)( t + 1 + ( t & 1 ) );
+			indices[t * 3 + 2] = (TriangleIndex)( t + 2 - ( t & 1 ) );
+		}
+		AppendBinary( bin, positions.GetDataPtr(), numVertices );
+		AppendBinary( bin, normals.GetDataPtr(), numVertices );
+		AppendBinary( bin, uvs.GetDataPtr(), numVertices );
+		AppendBinary( bin, indices.GetDataPtr(), numIndices );
+
+		json.AppendFormat( "{\n\"source\" : [ \"surface%03d\" ],\n", i );
+		json.AppendFormat( "\"material\" : { \"type\" : \"opaque\", \"diffuse\" : %d },\n", i );
+		json.AppendFormat( "\"bounds\" : \"%f 0 0 %f 1 0\",\n", (float)i, (float)i + numVertices * 0.005f );
+		json.AppendFormat( "\"vertices\" : { \"vertexCount\" : %d, \"position\" : \"bin\", \"normal\" : \"bin\", \"uv0\" : \"bin\" },\n", numVertices );
+		json.AppendFormat( "\"triangles\" : { \"indexCount\" : %d, \"indices\" : \"bin\" }\n", numIndices );
+		json.AppendFormat( "}%s\n", ( i < options.NumTextures - 1 ) ? "," : "" );
+	}
+	json.AppendFormat( "]\n}\n}\n" );
+
+	AddZipEntry( zf, "models.json", json.ToCStr(), json.GetSize() );
+	AddZipEntry( zf, "models.bin", bin.GetDataPtr(), bin.GetSize() );
+	zipClose( zf, NULL );
+}
+
+// Hash of the texture uploads in the order they were made. Object names are left
+// out, so loads that create different placeholders still compare equal.
+// The texture loader uploads in the order the decodes finish, so the hash of each
+// upload is summed, which doesn't depend on the order.
+static uint32_t GetUploadHash( const ovrGlRecorder & recorder )
+{
+	const ovrGlRecorder::StreamArray & stream = recorder.GetStream();
+	uint32_t sum = 0;
+	for ( UPInt i = 0; i < stream.GetSize(); )
+	{
+		const ovrGlCommand cmd = (ovrGlCommand)( stream[i] >> 16 );
+		const int numWords = stream[i] & 0xFFFF;
+		if ( cmd == GL_CMD_COMPRESSED_TEX_IMAGE_2D || cmd == GL_CMD_TEX_IMAGE_2D )
+		{
+			uint32_t hash = 2166136261u;
+			for ( int j = 0; j <= numWords; j++ )
+			{
+				hash = ( hash ^ stream[i + j] ) * 16777619u;
+			}
+			sum += hash;
+		}
+		i += 1 + numWords;
+	}
+	return sum;
+}
+
+// Every surface must refer to the texture its material names, not a placeholder.
+static bool CheckModel( const ovrBenchOptions & options, const ModelFile & model )
+{
+	if ( model.Textures.GetSizeI() != options.NumTextures || model.Def.surfaces.GetSizeI() != options.NumTextures )
+	{
+		printf( "loaded %d textures and %d surfaces, expected %d\n", model.Textures.GetSizeI(), model.Def.surfaces.GetSizeI(), options.NumTextures );
+		return false;
+	}
+	for ( int i = 0; i < options.NumTextures; i++ )
+	{
+		const ModelTexture & tex = model.Textures[i];
+		if ( tex.name != String::Format( "texture%03d", i ) || tex.texid.Width != options.TextureSize )
+		{
+			printf( "texture %d is %s, %d wide\n", i, tex.name.ToCStr(), tex.texid.Width );
+			return false;
+		}
+		if ( model.Def.surfaces[i].graphicsCommand.uniformTextures[0].texture != tex.texid.texture )
+		{
+			printf( "surface %d doesn't use texture %d\n", i, i );
+			return false;
+		}
+	}
+	return true;
+}
+
+static int RunBenchmark( const ovrBenchOptions & options )
+{
+	Array< ovrBenchTexture * > textures;
+	WritePackage( options, textures );
+
+	size_t textureBytes = 0;
+	size_t compressedBytes = 0;
+	for ( int i = 0; i < textures.GetSizeI(); i++ )
+	{
+		textureBytes += textures[i]->Size;
+		compressedBytes += textures[i]->DeflatedSize;
+	}
+	printf( "package: %d textures of %dx%d ETC2, %.1f MB, %.1f MB deflated, %d vertices per surface\n",
+			options.NumTextures, options.TextureSize, options.TextureSize,
+			textureBytes / ( 1024.0 * 1024.0 ), compressedBytes / ( 1024.0 * 1024.0 ), options.VerticesPerSurface );
+
+	ovrGlRecorder recorder;
+	recorder.Install();
+
+	static ovrProgramParm parms[] =
+	{
+		{ "Texture0",	ovrProgramParmType::TEXTURE_SAMPLED },
+	};
+	GlProgram program = GlProgram::Build( VertexShaderSrc, FragmentShaderSrc, parms, 1 );
+	const ModelGlPrograms programs( &program );
+
+	ovrWorkerPool workers;
+	workers.Init( Alg::Clamp( Thread::GetCPUCount() - 1, 0, 3 ) );
+	printf( "%d threads\n", workers.GetNumThreads() );
+
+	int result = 0;
+
+	// Textures decoded on the loading thread after the geometry is parsed,
+	// and on the given workers while it is parsed.
+	double eagerSeconds[2] = { 1e10, 1e10 };
+	uint32_t eagerHash[2] = { 0, 0 };
+	for ( int parallel = 0; parallel < 2; parallel++ )
+	{
+		for ( int run = 0; run < options.NumRuns; run++ )
+		{
+			recorder.Clear();
+			MaterialParms materialParms;
+			materialParms.Workers = parallel ? &workers : NULL;
+			const double start = GetSeconds();
+			ModelFile * model = LoadModelFile( PackageName, programs, materialParms );
+			eagerSeconds[parallel] = Alg::Min( eagerSeconds[parallel], GetSeconds() - start );
+			eagerHash[parallel] = GetUploadHash( recorder );
+			if ( !CheckModel( options, *model ) || model->HasDeferredTextures() )
+			{
+				result = 1;
+			}
+			delete model;
+		}
+	}
+
+	// Textures deferred until the model is in a scene, which hands them to the
+	// texture loader and replaces the placeholders across frames.
+	ovrTextureLoader * loader = ovrTextureLoader::Create( workers.GetNumThreads() - 1 );
+	double deferredSeconds = 1e10;
+	double maxFrameSeconds = 0.0;
+	double totalFrameSeconds = 0.0;
+	int numFrames = 0;
+	uint32_t deferredHash = 0;
+	for ( int run = 0; run < options.NumRuns; run++ )
+	{
+		recorder.Clear();
+		MaterialParms materialParms;
+		materialParms.DeferTextureLoads = true;
+		const double start = GetSeconds();
+		const ModelFile * model = LoadModelFile( PackageName, programs, materialParms );
+		deferredSeconds = Alg::Min( deferredSeconds, GetSeconds() - start );
+		if ( !model->HasDeferredTextures() )
+		{
+			result = 1;
+		}
+		recorder.Clear();
+		totalFrameSeconds = 0.0;
+		for ( numFrames = 1; ; numFrames++ )
+		{
+			const double frameStart = GetSeconds();
+			loader->Update( TEXTURE_UPLOAD_BUDGET_SECONDS );
+			const bool replaced = model->UpdateDeferredTextures( *loader );
+			const double frameSeconds = GetSeconds() - frameStart;
+			maxFrameSeconds = Alg::Max( maxFrameSeconds, frameSeconds );
+			totalFrameSeconds += frameSeconds;
+			if ( replaced )
+			{
+				break;
+			}
+			// the rest of the frame
+			usleep( FRAME_MICROSECONDS );
+		}
+		deferredHash = GetUploadHash( recorder );
+		if ( !CheckModel( options, *model ) || model->HasDeferredTextures() || loader->GetNumPending() != 0 )
+		{
+			result = 1;
+		}
+		delete model;
+	}
+	ovrTextureLoader::Destroy( loader );
+
+	// The CPU side of the texture loads on its own: inflate and parse.
+	double decodeSeconds = 1e10;
+	for ( int run = 0; run < options.NumRuns; run++ )
+	{
+		const double start = GetSeconds();
+		for ( int i = 0; i < options.NumTextures; i++ )
+		{
+			const ovrBenchTexture & texture = *textures[i];
+			MemBufferT< uint8_t > file( texture.Size );
+			uLongf size = texture.Size;
+			uncompress( file, &size, texture.Deflated, texture.DeflatedSize );
+			ovrTextureImage image;
+			DecodeTextureBuffer( "texture.ktx", MemBuffer( file, (int)size ), TextureFlags_t(), false, image );
+		}
+		decodeSeconds = Alg::Min( decodeSeconds, GetSeconds() - start );
+	}
+	for ( int i = 0; i < textures.GetSizeI(); i++ )
+	{
+		delete textures[i];
+	}
+
+	printf( "load, decode after parse:  %7.2f ms  (uploads %08x)\n", eagerSeconds[0] * 1e3, eagerHash[0] );
+	printf( "load, decode while parsing:%7.2f ms  (uploads %08x)\n", eagerSeconds[1] * 1e3, eagerHash[1] );
+	printf( "deferred load:             %7.2f ms\n", deferredSeconds * 1e3 );
+	printf( "deferred textures:         %d frames, %.2f ms per frame, at most %.2f ms  (uploads %08x)\n",
+			numFrames, totalFrameSeconds / numFrames * 1e3, maxFrameSeconds * 1e3, deferredHash );
+	printf( "texture inflate+parse:     %7.2f ms, the part the workers take off the loading thread\n", decodeSeconds * 1e3 );
+
+	if ( eagerHash[1] != eagerHash[0] || deferredHash != eagerHash[0] )
+	{
+		printf( "FAILED: the loads uploaded different textures\n" );
+		result = 1;
+	}
+	printf( result == 0 ? "OK\n" : "FAILED\n" );
+
+	GlProgram::Free( program );
+	recorder.Uninstall();
+	workers.Shutdown();
+	remove( PackageName );
+
+	return result;
+}
+
+int main( int argc, char * argv[] )
+{
+	ovrBenchOptions options;
+	for ( int i = 1; i < argc; i++ )
+	{
+		const bool hasValue = ( i + 1 < argc );
+		if ( strcmp( argv[i], "-textures" ) == 0 && hasValue )
+		{
+			options.NumTextures = Alg::Clamp( atoi( argv[++i] ), 1, 1000 );
+		}
+		else if ( strcmp( argv[i], "-size" ) == 0 && hasValue )
+		{
+			options.TextureSize = Alg::Clamp( atoi( argv[++i] ), 4, 4096 );
+		}
+		else if ( strcmp( argv[i], "-runs" ) == 0 && hasValue )
+		{
+			options.NumRuns = Alg::Max( 1, atoi( argv[++i] ) );
+		}
+		else
+		{
+			printf( "USAGE: ModelLoadBench [-textures <n>] [-size <n>] [-runs <n>]\n" );
+			return 1;
+		}
+	}
+
+	System::Init( Log::ConfigureDefaultLog( LogMask_None ) );
+	const int result = RunBenchmark( options );
+	System::Destroy();
+
+	return result;
+}
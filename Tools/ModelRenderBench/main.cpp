@@ -0,0 +1,505 @@
+/************************************************************************************
+
+Filename    :   main.cpp
+Content     :   Host benchmark of BuildModelSurfaceList on the GL recorder, and
+				checks that the parallel version builds the same surface list.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Kernel/OVR_System.h"
+#include "Kernel/OVR_Alg.h"
+#include "ModelRender.h"
+#include "GlRecorder.h"
+#include "BenchCommon.h"
+
+using namespace OVR;
+
+static const char * VertexShaderSrc =
+	"in vec3 Position;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_Position = TransformVertex( vec4( Position, 1.0 ) );\n"
+	"}\n";
+
+static const char * FragmentShaderSrc =
+	"uniform lowp vec4 UniformColor;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_FragColor = UniformColor;\n"
+	"}\n";
+
+struct ovrBenchOptions
+{
+	ovrBenchOptions() :
+		NumModels( 10000 ),
+		NumModelDefs( 64 ),
+		NumEmitSurfaces( 64 ),
+		NumFrames( 50 ) {}
+
+	int		NumModels;
+	int		NumModelDefs;
+	int		NumEmitSurfaces;
+	int		NumFrames;
+};
+
+struct ovrBenchScene
+{
+	Array< GlProgram >		Programs;
+	Array< ModelDef >		ModelDefs;
+	Array< ModelState >		Models;
+	Array< ModelState * >	EmitModels;
+	Array< ovrSurfaceDef >	EmitSurfaceDefs;
+	Array< ovrDrawSurface >	EmitSurfaces;
+};
+
+// Model definitions of one to four surfaces, a quarter of them skinned and an
+// eighth blended. Instances are scattered all around the viewer, so about a
+// quarter of them are in the view. In a skinned scene, every model has four
+// skinned surfaces that share one joint buffer, as ModelFile sets them up.
+static void BuildScene( const ovrBenchOptions & options, const int numModels, const bool skinnedScene, ovrBenchScene & scene )
+{
+	static ovrProgramParm parms[] =
+	{
+		{ "UniformColor",	ovrProgramParmType::FLOAT_VECTOR4 },
+	};
+
+	uint32_t seed = 1;
+	scene.Programs.Resize( 8 );
+	for ( int i = 0; i < scene.Programs.GetSizeI(); i++ )
+	{
+		scene.Programs[i] = GlProgram::Build( VertexShaderSrc, FragmentShaderSrc, parms, 1 );
+	}
+
+	scene.ModelDefs.Resize( options.NumModelDefs );
+	for ( int i = 0; i < options.NumModelDefs; i++ )
+	{
+		ModelDef & def = scene.ModelDefs[i];
+		const bool skinned = skinnedScene || ( i % 4 ) == 0;
+		def.surfaces.Resize( skinnedScene ? 4 : 1 + Random( seed ) % 4 );
+		for ( int s = 0; s < def.surfaces.GetSizeI(); s++ )
+		{
+			ovrSurfaceDef & surface = def.surfaces[s];
+			surface.surfaceName = String::Format( "model%d_surface%d", i, s );
+			const Vector3f center( RandomFloat( seed, -1.0f, 1.0f ), RandomFloat( seed, -1.0f, 1.0f ), RandomFloat( seed, -1.0f, 1.0f ) );
+			const Vector3f extent( RandomFloat( seed, 0.1f, 1.0f ), RandomFloat( seed, 0.1f, 1.0f ), RandomFloat( seed, 0.1f, 1.0f ) );
+			surface.geo.localBounds = Bounds3f( center - extent, center + extent );
+			if ( Random( seed ) % 32 == 0 )
+			{
+				// empty bounds disable a surface
+				surface.geo.localBounds = Bounds3f( center, center );
+			}
+			ovrGraphicsCommand & cmd = surface.graphicsCommand;
+			cmd.Program = scene.Programs[Random( seed ) % scene.Programs.GetSizeI()];
+			if ( Random( seed ) % 8 == 0 )
+			{
+				cmd.GpuState.blendEnable = ovrGpuState::BLEND_ENABLE;
+			}
+			if ( skinnedScene && s > 0 )
+			{
+				cmd.uniformJoints = def.surfaces[0].graphicsCommand.uniformJoints;
+			}
+			else if ( skinned )
+			{
+				cmd.uniformJoints.Create( GLBUFFER_TYPE_UNIFORM, MAX_JOINTS * sizeof( Matrix4f ), NULL );
+			}
+		}
+	}
+
+	scene.Models.Resize( numModels );
+	for ( int i = 0; i < numModels; i++ )
+	{
+		const int defIndex = Random( seed ) % options.NumModelDefs;
+		ModelState & model = scene.Models[i];
+		model = ModelState( scene.ModelDefs[defIndex] );
+		const Vector3f position( RandomFloat( seed, -100.0f, 100.0f ), RandomFloat( seed, -20.0f, 20.0f ), RandomFloat( seed, -100.0f, 100.0f ) );
+		model.modelMatrix = Matrix4f::Translation( position ) * Matrix4f::RotationY( RandomFloat( seed, 0.0f, 6.28f ) ) *
+				Matrix4f::Scaling( RandomFloat( seed, 0.5f, 2.0f ) );
+		if ( scene.ModelDefs[defIndex].surfaces[0].graphicsCommand.uniformJoints.GetBuffer() != 0 )
+		{
+			model.Joints.Resize( MAX_JOINTS );
+			for ( int j = 0; j < MAX_JOINTS; j++ )
+			{
+				model.Joints[j] = Matrix4f::RotationX( RandomFloat( seed, -1.0f, 1.0f ) );
+			}
+		}
+		// some models are hidden from the client
+		model.DontRenderForClientUid = ( Random( seed ) % 64 == 0 ) ? 7 : 0;
+		scene.EmitModels.PushBack( &model );
+	}
+
+	scene.EmitSurfaceDefs.Resize( options.NumEmitSurfaces );
+	scene.EmitSurfaces.Resize( options.NumEmitSurfaces );
+	for ( int i = 0; i < options.NumEmitSurfaces; i++ )
+	{
+		ovrSurfaceDef & surface = scene.EmitSurfaceDefs[i];
+		surface.surfaceName = String::Format( "emit%d", i );
+		surface.geo.localBounds = Bounds3f( Vector3f( -0.5f ), Vector3f( 0.5f ) );
+		surface.graphicsCommand.Program = scene.Programs[i % scene.Programs.GetSizeI()];
+		scene.EmitSurfaces[i].surface = &surface;
+		scene.EmitSurfaces[i].modelMatrix = Matrix4f::Translation( RandomFloat( seed, -20.0f, 20.0f ), 0.0f, RandomFloat( seed, -20.0f, 20.0f ) );
+	}
+}
+
+//==============================================================
+// The surface list as it was built before it was unbounded: at most 1024
+// surfaces, and the joints are transposed and uploaded for every surface.
+
+static const int REFERENCE_MAX_DRAW_SURFACES = 1024;
+
+static float ReferenceBoundsSortCullKey( const Bounds3f & bounds, const Matrix4f & mvp )
+{
+	if ( bounds.b[1].x == bounds.b[0].x &&  bounds.b[1].y == bounds.b[0].y )
+	{
+		return 0;
+	}
+
+	Vector4f c[8];
+	for ( int i = 0; i < 8; i++ )
+	{
+		Vector4f world;
+		world.x = bounds.b[(i&1)].x;
+		world.y = bounds.b[(i&2)>>1].y;
+		world.z = bounds.b[(i&4)>>2].z;
+		world.w = 1.0f;
+
+		c[i] = mvp.Transform( world );
+	}
+
+	for ( int axis = 0; axis < 3; axis++ )
+	{
+		bool inside = false;
+		for ( int i = 0; i < 8 && !inside; i++ )
+		{
+			inside = ( &c[i].x )[axis] > -c[i].w;
+		}
+		if ( !inside )
+		{
+			return 0;
+		}
+		inside = false;
+		for ( int i = 0; i < 8 && !inside; i++ )
+		{
+			inside = ( &c[i].x )[axis] < c[i].w;
+		}
+		if ( !inside )
+		{
+			return 0;
+		}
+	}
+
+	float maxW = 0;
+	for ( int i = 0; i < 8; i++ )
+	{
+		maxW = Alg::Max( maxW, c[i].w );
+	}
+	return maxW;
+}
+
+static void ReferenceBuildModelSurfaceList( Array<ovrDrawSurface> & surfaceList, const long long suppressModelsWithClientId,
+		const Array<ModelState *> & emitModels, const Array<ovrDrawSurface> & emitSurfaces,
+		const Matrix4f & viewMatrix, const Matrix4f & projectionMatrix )
+{
+	uint64_t sortKeys[REFERENCE_MAX_DRAW_SURFACES];
+	surfaceList.Resize( REFERENCE_MAX_DRAW_SURFACES );
+
+	const Matrix4f vpMatrix = projectionMatrix * viewMatrix;
+	int numSurfaces = 0;
+
+	for ( int modelNum = 0; modelNum < emitModels.GetSizeI(); modelNum++ )
+	{
+		const ModelState & modelState = *emitModels[modelNum];
+		if ( modelState.DontRenderForClientUid == suppressModelsWithClientId )
+		{
+			continue;
+		}
+
+		const ModelDef & modelDef = *modelState.modelDef;
+		for ( int surfaceNum = 0; surfaceNum < modelDef.surfaces.GetSizeI(); surfaceNum++ )
+		{
+			const ovrSurfaceDef & surfaceDef = modelDef.surfaces[surfaceNum];
+			const float sort = ReferenceBoundsSortCullKey( surfaceDef.geo.localBounds, vpMatrix * modelState.modelMatrix );
+			if ( sort == 0 )
+			{
+				continue;
+			}
+			if ( numSurfaces == REFERENCE_MAX_DRAW_SURFACES )
+			{
+				break;
+			}
+			if ( modelState.Joints.GetSize() > 0 )
+			{
+				static Matrix4f transposedJoints[MAX_JOINTS];
+				const int numJoints = Alg::Min( modelState.Joints.GetSizeI(), MAX_JOINTS );
+				for ( int j = 0; j < numJoints; j++ )
+				{
+					transposedJoints[j] = modelState.Joints[j].Transposed();
+				}
+				surfaceDef.graphicsCommand.uniformJoints.Update( numJoints * sizeof( Matrix4f ), &transposedJoints[0] );
+			}
+			surfaceList[numSurfaces].modelMatrix = modelState.modelMatrix;
+			surfaceList[numSurfaces].surface = &surfaceDef;
+			sortKeys[numSurfaces] = DrawSortKey( surfaceDef, sort );
+			numSurfaces++;
+		}
+	}
+
+	for ( int i = 0; i < emitSurfaces.GetSizeI(); i++ )
+	{
+		const ovrDrawSurface & drawSurf = emitSurfaces[i];
+		const ovrSurfaceDef & surfaceDef = *drawSurf.surface;
+		const float sort = ReferenceBoundsSortCullKey( surfaceDef.geo.localBounds, vpMatrix * drawSurf.modelMatrix );
+		if ( sort == 0 )
+		{
+			continue;
+		}
+		if ( numSurfaces == REFERENCE_MAX_DRAW_SURFACES )
+		{
+			break;
+		}
+		surfaceList[numSurfaces].modelMatrix = drawSurf.modelMatrix;
+		surfaceList[numSurfaces].surface = &surfaceDef;
+		sortKeys[numSurfaces] = DrawSortKey( surfaceDef, sort );
+		numSurfaces++;
+	}
+
+	surfaceList.Resize( numSurfaces );
+	ovrSurfaceSortBuffers sortBuffers;
+	SortSurfaceList( surfaceList, sortKeys, sortBuffers );
+}
+
+//==============================================================
+
+static bool SameSurfaceList( const Array< ovrDrawSurface > & a, const Array< ovrDrawSurface > & b )
+{
+	if ( a.GetSizeI() != b.GetSizeI() )
+	{
+		return false;
+	}
+	for ( int i = 0; i < a.GetSizeI(); i++ )
+	{
+		if ( a[i].surface != b[i].surface || memcmp( &a[i].modelMatrix, &b[i].modelMatrix, sizeof( Matrix4f ) ) != 0 )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Builds the list serially and with each worker count from the same views, and
+// compares the lists and the GL calls of the joint uniform updates. Lists that
+// fit in the old limit must also match the reference.
+static bool CheckScene( ovrGlRecorder & recorder, const ovrBenchOptions & options, const int numModels )
+{
+	ovrBenchScene scene;
+	BuildScene( options, numModels, false, scene );
+
+	const Matrix4f projectionMatrix = Matrix4f::PerspectiveRH( DegreeToRad( 90.0f ), 1.0f, 0.1f, 100.0f );
+	static const int workerCounts[] = { 0, 1, 3, 7 };
+
+	bool ok = true;
+	int maxSurfaces = 0;
+	for ( int view = 0; view < 16; view++ )
+	{
+		const Matrix4f viewMatrix = Matrix4f::RotationY( view * 0.4f );
+
+		recorder.Clear();
+		Array< ovrDrawSurface > serialList;
+		BuildModelSurfaceList( serialList, 7, scene.EmitModels, scene.EmitSurfaces, viewMatrix, projectionMatrix );
+		const uint32_t serialHash = recorder.GetStreamHash();
+		maxSurfaces = Alg::Max( maxSurfaces, serialList.GetSizeI() );
+
+		// the same list as before, as long as it fit
+		Array< ovrDrawSurface > referenceList;
+		ReferenceBuildModelSurfaceList( referenceList, 7, scene.EmitModels, scene.EmitSurfaces, viewMatrix, projectionMatrix );
+		if ( serialList.GetSizeI() < REFERENCE_MAX_DRAW_SURFACES ? !SameSurfaceList( serialList, referenceList )
+				: referenceList.GetSizeI() != REFERENCE_MAX_DRAW_SURFACES )
+		{
+			printf( "FAILED: %d models, view %d: the surface list differs from the reference\n", numModels, view );
+			ok = false;
+		}
+
+		for ( int w = 0; w < (int)( sizeof( workerCounts ) / sizeof( workerCounts[0] ) ); w++ )
+		{
+			ovrWorkerPool workers;
+			workers.Init( workerCounts[w] );
+			ovrSurfaceListBuffers buffers;
+			recorder.Clear();
+			Array< ovrDrawSurface > parallelList;
+			BuildModelSurfaceListParallel( workers, buffers, parallelList, 7, scene.EmitModels, scene.EmitSurfaces, viewMatrix, projectionMatrix );
+			if ( !SameSurfaceList( serialList, parallelList ) || recorder.GetStreamHash() != serialHash )
+			{
+				printf( "FAILED: %d models, view %d, %d workers: the surface list differs\n", numModels, view, workerCounts[w] );
+				ok = false;
+			}
+
+			// limited to the old maximum, the list is the reference list, whether it fits or not
+			buffers.MaxSurfaces = REFERENCE_MAX_DRAW_SURFACES;
+			Array< ovrDrawSurface > cappedList;
+			if ( w == 0 )
+			{
+				BuildModelSurfaceList( buffers, cappedList, 7, scene.EmitModels, scene.EmitSurfaces, viewMatrix, projectionMatrix );
+				if ( !SameSurfaceList( cappedList, referenceList ) )
+				{
+					printf( "FAILED: %d models, view %d: the limited serial list differs from the reference\n", numModels, view );
+					ok = false;
+				}
+			}
+			BuildModelSurfaceListParallel( workers, buffers, cappedList, 7, scene.EmitModels, scene.EmitSurfaces, viewMatrix, projectionMatrix );
+			if ( !SameSurfaceList( cappedList, referenceList ) )
+			{
+				printf( "FAILED: %d models, view %d, %d workers: the limited list differs from the reference\n", numModels, view, workerCounts[w] );
+				ok = false;
+			}
+		}
+	}
+	printf( "%d models: up to %d surfaces, serial and parallel lists %s\n", numModels, maxSurfaces, ok ? "identical" : "differ" );
+	return ok;
+}
+
+enum ovrBuildMode
+{
+	BUILD_REFERENCE,
+	BUILD_SERIAL,
+	BUILD_PARALLEL
+};
+
+// Returns the best time of building the surface list for a turning view. With
+// outOfView, the view is moved far above the scene so everything is culled,
+// which times only the culling.
+static double TimeBuild( ovrGlRecorder & recorder, const ovrBenchOptions & options, const ovrBenchScene & scene,
+		const ovrBuildMode mode, ovrWorkerPool * workers, const bool outOfView, const int maxSurfaces,
+		int & numSurfaces, int & numUploads )
+{
+	const Matrix4f projectionMatrix = Matrix4f::PerspectiveRH( DegreeToRad( 90.0f ), 1.0f, 0.1f, 100.0f );
+	ovrSurfaceListBuffers buffers;
+	buffers.MaxSurfaces = maxSurfaces;
+	Array< ovrDrawSurface > surfaceList;
+	double bestSeconds = 1e9;
+	for ( int frame = 0; frame < options.NumFrames; frame++ )
+	{
+		const Matrix4f viewMatrix = Matrix4f::Translation( 0.0f, outOfView ? -1000.0f : 0.0f, 0.0f ) * Matrix4f::RotationY( frame * 0.1f );
+		recorder.Clear();
+		const double start = GetSeconds();
+		switch ( mode )
+		{
+			case BUILD_REFERENCE:
+				ReferenceBuildModelSurfaceList( surfaceList, 7, scene.EmitModels, scene.EmitSurfaces, viewMatrix, projectionMatrix );
+				break;
+			case BUILD_SERIAL:
+				BuildModelSurfaceList( buffers, surfaceList, 7, scene.EmitModels, scene.EmitSurfaces, viewMatrix, projectionMatrix );
+				break;
+			case BUILD_PARALLEL:
+				BuildModelSurfaceListParallel( *workers, buffers, surfaceList, 7, scene.EmitModels, scene.EmitSurfaces, viewMatrix, projectionMatrix );
+				break;
+		}
+		bestSeconds = Alg::Min( bestSeconds, GetSeconds() - start );
+	}
+	numSurfaces = surfaceList.GetSizeI();
+	numUploads = recorder.GetCommandCount( GL_CMD_BUFFER_SUB_DATA );
+	return bestSeconds;
+}
+
+// Times the list of many skinned models with four surfaces each, before and now.
+static void TimeSkinnedScene( ovrGlRecorder & recorder, const ovrBenchOptions & options, const int numModels )
+{
+	ovrBenchScene scene;
+	BuildScene( options, numModels, true, scene );
+
+	int numSurfaces = 0;
+	int numUploads = 0;
+	const double referenceSeconds = TimeBuild( recorder, options, scene, BUILD_REFERENCE, NULL, false, 0, numSurfaces, numUploads );
+	printf( "%d skinned models: reference %.3f ms, %d surfaces, %d joint uploads\n", numModels,
+			referenceSeconds * 1e3, numSurfaces, numUploads );
+	ovrWorkerPool workers;
+	workers.Init( 3 );
+	// without a limit and with the old one
+	for ( int capped = 0; capped < 2; capped++ )
+	{
+		const int maxSurfaces = capped ? REFERENCE_MAX_DRAW_SURFACES : 0;
+		const double serialSeconds = TimeBuild( recorder, options, scene, BUILD_SERIAL, NULL, false, maxSurfaces, numSurfaces, numUploads );
+		printf( "    %s serial %.3f ms (%.2fx), %d surfaces, %d joint uploads\n", capped ? "limited:  " : "unlimited:",
+				serialSeconds * 1e3, referenceSeconds / serialSeconds, numSurfaces, numUploads );
+		const double parallelSeconds = TimeBuild( recorder, options, scene, BUILD_PARALLEL, &workers, false, maxSurfaces, numSurfaces, numUploads );
+		printf( "    %s %d threads: parallel %.3f ms (%.2fx), %d surfaces, %d joint uploads\n", capped ? "limited:  " : "unlimited:",
+				workers.GetNumThreads(), parallelSeconds * 1e3, referenceSeconds / parallelSeconds, numSurfaces, numUploads );
+	}
+}
+
+static int RunBenchmark( const ovrBenchOptions & options )
+{
+	ovrGlRecorder recorder;
+	recorder.Install();
+
+	bool ok = true;
+	// below and above the draw surface limit
+	ok &= CheckScene( recorder, options, 500 );
+	ok &= CheckScene( recorder, options, options.NumModels );
+
+	ovrBenchScene scene;
+	BuildScene( options, options.NumModels, false, scene );
+
+	for ( int outOfView = 0; outOfView < 2; outOfView++ )
+	{
+		int numSurfaces = 0;
+		int numUploads = 0;
+		const double serialSeconds = TimeBuild( recorder, options, scene, BUILD_SERIAL, NULL, outOfView != 0, 0, numSurfaces, numUploads );
+		printf( "%d models, %s (%d surfaces): serial %.3f ms\n", options.NumModels,
+				outOfView ? "all culled" : "in view", numSurfaces, serialSeconds * 1e3 );
+
+		static const int workerCounts[] = { 0, 1, 3, 7 };
+		for ( int w = 0; w < (int)( sizeof( workerCounts ) / sizeof( workerCounts[0] ) ); w++ )
+		{
+			ovrWorkerPool workers;
+			workers.Init( workerCounts[w] );
+			const double parallelSeconds = TimeBuild( recorder, options, scene, BUILD_PARALLEL, &workers, outOfView != 0, 0, numSurfaces, numUploads );
+			printf( "    %d threads: parallel %.3f ms (%.2fx)\n", workers.GetNumThreads(),
+					parallelSeconds * 1e3, serialSeconds / parallelSeconds );
+		}
+	}
+
+	// below and above the old draw surface limit
+	TimeSkinnedScene( recorder, options, 800 );
+	TimeSkinnedScene( recorder, options, options.NumModels );
+
+	recorder.Uninstall();
+
+	printf( "%s\n", ok ? "PASSED" : "FAILED" );
+	return ok ? 0 : 1;
+}
+
+int main( int const argc, char const * argv[] )
+{
+	ovrBenchOptions options;
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		const bool hasValue = ( i + 1 < argc );
+		if ( strcmp( argv[i], "-models" ) == 0 && hasValue )
+		{
+			options.NumModels = Alg::Max( 1, atoi( argv[++i] ) );
+		}
+		else if ( strcmp( argv[i], "-frames" ) == 0 && hasValue )
+		{
+			options.NumFrames = Alg::Max( 1, atoi( argv[++i] ) );
+		}
+		else
+		{
+			printf( "USAGE: ModelRenderBench [-models <n>] [-frames <n>]\n" );
+			return 1;
+		}
+	}
+
+	System::Init( Log::ConfigureDefaultLog( LogMask_None ) );
+	const int result = RunBenchmark( options );
+	System::Destroy();
+
+	return result;
+}
@@ -0,0 +1,645 @@
+/************************************************************************************
+
+Filename    :   main.cpp
+Content     :   Checks the packet traversal of the ray-trace kd-tree and the BVH against
+				single rays and the exhaustive trace, and benchmarks the memory, build
+				time and rays per second of both.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <zlib.h>
+
+#include "Kernel/OVR_System.h"
+#include "Kernel/OVR_Alg.h"
+#include "Kernel/OVR_Hash.h"
+#include "Kernel/OVR_JSON.h"
+#include "Kernel/OVR_String_Utils.h"
+#include "ModelTrace.h"
+
+using namespace OVR;
+
+#include "../FbxConvert/RawModel.h"
+#include "../FbxConvert/ModelData.h"
+#include "../FbxConvert/Raw2RayTraceModel.h"
+#include "BenchCommon.h"
+
+// Used by the converter sources.
+void Warning( const char * format, ... )
+{
+	va_list args;
+	va_start( args, format );
+	vprintf( format, args );
+	va_end( args );
+}
+
+void Error( const char * format, ... )
+{
+	va_list args;
+	va_start( args, format );
+	vprintf( format, args );
+	va_end( args );
+	exit( 1 );
+}
+
+struct ovrBenchOptions
+{
+	ovrBenchOptions() :
+		GridSize( 128 ),
+		NumBoxes( 400 ),
+		ImageSize( 256 ),
+		NumRuns( 5 ),
+		FbxFile( "../../SourceAssets/scenes/home_theater/home_theater.fbx" ) {}
+
+	int				GridSize;		// quads per side of the terrain
+	int				NumBoxes;
+	int				ImageSize;		// pixels per side of the coherent rays
+	int				NumRuns;
+	const char *	FbxFile;		// real scene meshes, skipped if the file is not found
+};
+
+static void AddQuad( RawModel & raw, const Vector3f & p0, const Vector3f & p1, const Vector3f & p2, const Vector3f & p3 )
+{
+	const Vector3f corners[4] = { p0, p1, p2, p3 };
+	int verts[4];
+	for ( int i = 0; i < 4; i++ )
+	{
+		RawVertex vertex;
+		vertex.position = corners[i];
+		vertex.uv0 = Vector2f( (float)( i & 1 ), (float)( i >> 1 ) );
+		verts[i] = raw.AddVertex( vertex );
+	}
+	raw.AddTriangle( verts[0], verts[1], verts[2], 0, 0 );
+	raw.AddTriangle( verts[2], verts[1], verts[3], 0, 0 );
+}
+
+// A rolling terrain of GridSize x GridSize units with boxes standing on it.
+static void BuildScene( const ovrBenchOptions & options, RawModel & raw )
+{
+	uint32_t seed = 1;
+	const int n = options.GridSize;
+	Array< float > heights;
+	heights.Resize( ( n + 1 ) * ( n + 1 ) );
+	for ( int z = 0; z <= n; z++ )
+	{
+		for ( int x = 0; x <= n; x++ )
+		{
+			heights[z * ( n + 1 ) + x] = 2.0f * sinf( x * 0.15f ) * cosf( z * 0.11f ) + RandomFloat( seed ) * 0.2f;
+		}
+	}
+	for ( int z = 0; z < n; z++ )
+	{
+		for ( int x = 0; x < n; x++ )
+		{
+			AddQuad( raw, Vector3f( (float)x, heights[z * ( n + 1 ) + x], (float)z ),
+						Vector3f( (float)x, heights[( z + 1 ) * ( n + 1 ) + x], (float)( z + 1 ) ),
+						Vector3f( (float)( x + 1 ), heights[z * ( n + 1 ) + x + 1], (float)z ),
+						Vector3f( (float)( x + 1 ), heights[( z + 1 ) * ( n + 1 ) + x + 1], (float)( z + 1 ) ) );
+		}
+	}
+	for ( int i = 0; i < options.NumBoxes; i++ )
+	{
+		const Vector3f mins( RandomFloat( seed ) * ( n - 4 ), -2.0f, RandomFloat( seed ) * ( n - 4 ) );
+		const Vector3f maxs = mins + Vector3f( 0.5f + RandomFloat( seed ) * 3.0f, 3.0f + RandomFloat( seed ) * 6.0f, 0.5f + RandomFloat( seed ) * 3.0f );
+		Vector3f c[8];
+		for ( int j = 0; j < 8; j++ )
+		{
+			c[j] = Vector3f( ( j & 1 ) ? maxs.x : mins.x, ( j & 2 ) ? maxs.y : mins.y, ( j & 4 ) ? maxs.z : mins.z );
+		}
+		AddQuad( raw, c[0], c[2], c[1], c[3] );	// -Z
+		AddQuad( raw, c[5], c[7], c[4], c[6] );	// +Z
+		AddQuad( raw, c[4], c[6], c[0], c[2] );	// -X
+		AddQuad( raw, c[1], c[3], c[5], c[7] );	// +X
+		AddQuad( raw, c[2], c[6], c[3], c[7] );	// +Y
+	}
+}
+
+//==============================================================
+// Binary FBX meshes
+
+/*
+
+Just enough of the binary FBX format to get the triangles of the meshes in a scene
+without the FBX SDK. Each node record is:
+
+	end offset, number of properties, property list length	(32 bits, 64 bits from version 7500)
+	name length (8 bits), name
+	properties
+	nested records, terminated by an empty record
+
+Array properties may be zlib compressed. Node transforms are ignored.
+
+*/
+
+struct ovrFbxReader
+{
+	const uint8_t *		Data;
+	size_t				Size;
+	bool				Wide;		// 64 bit record header
+};
+
+struct ovrFbxMesh
+{
+	Array< double >		Vertices;
+	Array< int >		PolygonVertexIndex;
+};
+
+static uint64_t ReadFbxUInt( const ovrFbxReader & fbx, const size_t offset, const int bytes )
+{
+	uint64_t value = 0;
+	memcpy( &value, fbx.Data + offset, bytes );
+	return value;
+}
+
+// Decodes the array property at 'offset' to 'out'.
+template< typename _type_ >
+static bool ReadFbxArray( const ovrFbxReader & fbx, const size_t offset, Array< _type_ > & out )
+{
+	const uint32_t count = (uint32_t)ReadFbxUInt( fbx, offset + 1, 4 );
+	const uint32_t encoding = (uint32_t)ReadFbxUInt( fbx, offset + 5, 4 );
+	const uint32_t compressedSize = (uint32_t)ReadFbxUInt( fbx, offset + 9, 4 );
+	out.Resize( count );
+	if ( count == 0 )
+	{
+		return true;
+	}
+	if ( encoding == 0 )
+	{
+		if ( compressedSize != count * sizeof( _type_ ) )
+		{
+			return false;
+		}
+		memcpy( &out[0], fbx.Data + offset + 13, compressedSize );
+		return true;
+	}
+	uLongf size = count * sizeof( _type_ );
+	return uncompress( (Bytef *)&out[0], &size, fbx.Data + offset + 13, compressedSize ) == Z_OK && size == count * sizeof( _type_ );
+}
+
+// Returns the offset past the record, or 0 for the empty record that ends a list.
+static size_t ReadFbxRecord( const ovrFbxReader & fbx, const size_t offset, ovrFbxMesh * mesh, Array< ovrFbxMesh > & meshes )
+{
+	const int bytes = fbx.Wide ? 8 : 4;
+	if ( offset + 3 * bytes + 1 > fbx.Size )
+	{
+		return 0;
+	}
+	const size_t end = (size_t)ReadFbxUInt( fbx, offset, bytes );
+	const size_t numProperties = (size_t)ReadFbxUInt( fbx, offset + bytes, bytes );
+	const size_t propertiesSize = (size_t)ReadFbxUInt( fbx, offset + 2 * bytes, bytes );
+	const int nameLength = fbx.Data[offset + 3 * bytes];
+	if ( end == 0 || end > fbx.Size )
+	{
+		return 0;
+	}
+	const String name( (const char *)fbx.Data + offset + 3 * bytes + 1, nameLength );
+	size_t p = offset + 3 * bytes + 1 + nameLength;
+
+	if ( name == "Geometry" )
+	{
+		meshes.PushBack( ovrFbxMesh() );
+		mesh = &meshes.Back();
+	}
+
+	for ( size_t i = 0; i < numProperties && p < end; i++ )
+	{
+		const char type = fbx.Data[p];
+		switch ( type )
+		{
+			case 'Y': p += 1 + 2; break;
+			case 'C': p += 1 + 1; break;
+			case 'I': case 'F': p += 1 + 4; break;
+			case 'D': case 'L': p += 1 + 8; break;
+			case 'S': case 'R': p += 1 + 4 + (size_t)ReadFbxUInt( fbx, p + 1, 4 ); break;
+			case 'f': case 'd': case 'l': case 'i': case 'b':
+				if ( mesh != NULL && i == 0 && name == "Vertices" && type == 'd' )
+				{
+					ReadFbxArray( fbx, p, mesh->Vertices );
+				}
+				else if ( mesh != NULL && i == 0 && name == "PolygonVertexIndex" && type == 'i' )
+				{
+					ReadFbxArray( fbx, p, mesh->PolygonVertexIndex );
+				}
+				p += 1 + 12 + (size_t)ReadFbxUInt( fbx, p + 9, 4 );
+				break;
+			default: return 0;
+		}
+	}
+
+	// Nested records, a Geometry node pointer remains valid since the meshes are not added to below it.
+	p = offset + 3 * bytes + 1 + nameLength + propertiesSize;
+	while ( p < end )
+	{
+		const size_t next = ReadFbxRecord( fbx, p, mesh, meshes );
+		if ( next == 0 )
+		{
+			break;
+		}
+		p = next;
+	}
+	return end;
+}
+
+// Adds the triangles of all meshes in a binary FBX file. Returns false if the file
+// can't be read.
+static bool LoadFbxMeshes( const char * fileName, RawModel & raw )
+{
+	FILE * file = fopen( fileName, "rb" );
+	if ( file == NULL )
+	{
+		return false;
+	}
+	Array< uint8_t > data;
+	fseek( file, 0, SEEK_END );
+	data.Resize( ftell( file ) );
+	fseek( file, 0, SEEK_SET );
+	const bool read = data.GetSizeI() > 27 && fread( &data[0], 1, data.GetSize(), file ) == data.GetSize();
+	fclose( file );
+	if ( !read || memcmp( &data[0], "Kaydara FBX Binary", 18 ) != 0 )
+	{
+		return false;
+	}
+
+	ovrFbxReader fbx;
+	fbx.Data = &data[0];
+	fbx.Size = data.GetSize();
+	fbx.Wide = ReadFbxUInt( fbx, 23, 4 ) >= 7500;
+
+	Array< ovrFbxMesh > meshes;
+	meshes.Reserve( 256 );
+	for ( size_t offset = 27; offset != 0 && offset < fbx.Size; )
+	{
+		offset = ReadFbxRecord( fbx, offset, NULL, meshes );
+	}
+
+	for ( int m = 0; m < meshes.GetSizeI(); m++ )
+	{
+		const ovrFbxMesh & mesh = meshes[m];
+		const int numVertices = mesh.Vertices.GetSizeI() / 3;
+		Array< int > verts;
+		verts.Resize( numVertices );
+		for ( int i = 0; i < numVertices; i++ )
+		{
+			RawVertex vertex;
+			vertex.position = Vector3f( (float)mesh.Vertices[i * 3 + 0], (float)mesh.Vertices[i * 3 + 1], (float)mesh.Vertices[i * 3 + 2] );
+			verts[i] = raw.AddVertex( vertex );
+		}
+		// Polygons end with a negated index, ~index, and are triangulated as fans.
+		int polygonStart = 0;
+		for ( int i = 0; i < mesh.PolygonVertexIndex.GetSizeI(); i++ )
+		{
+			if ( mesh.PolygonVertexIndex[i] >= 0 )
+			{
+				continue;
+			}
+			for ( int j = polygonStart + 2; j <= i; j++ )
+			{
+				const int a = mesh.PolygonVertexIndex[polygonStart];
+				const int b = mesh.PolygonVertexIndex[j - 1];
+				const int c = ( j == i ) ? ~mesh.PolygonVertexIndex[j] : mesh.PolygonVertexIndex[j];
+				if ( a >= 0 && a < numVertices && b >= 0 && b < numVertices && c >= 0 && c < numVertices )
+				{
+					raw.AddTriangle( verts[a], verts[b], verts[c], 0, 0 );
+				}
+			}
+			polygonStart = i + 1;
+		}
+	}
+	return raw.GetTriangleCount() > 0;
+}
+
+template< typename _type_ >
+static void ReadArray( Array< _type_ > & out, const int count, const Array< uint8_t > & binary, size_t & offset )
+{
+	out.Resize( count );
+	if ( count > 0 )
+	{
+		memcpy( &out[0], &binary[offset], count * sizeof( _type_ ) );
+	}
+	offset += count * sizeof( _type_ );
+}
+
+// Builds the kd-tree the way the converter does and reads it back the way the
+// model loader does. Returns the seconds spent in the converter.
+static double BuildTraceModel( const RawModel & raw, ModelTrace & trace )
+{
+	const double start = GetSeconds();
+	ModelData * data = Raw2RayTraceModel( raw, false );
+	const double seconds = GetSeconds() - start;
+
+	trace.header.numVertices = data->json->GetItemByName( "numVertices" )->GetInt32Value();
+	trace.header.numUvs = data->json->GetItemByName( "numUvs" )->GetInt32Value();
+	trace.header.numIndices = data->json->GetItemByName( "numIndices" )->GetInt32Value();
+	trace.header.numNodes = data->json->GetItemByName( "numNodes" )->GetInt32Value();
+	trace.header.numLeafs = data->json->GetItemByName( "numLeafs" )->GetInt32Value();
+	trace.header.numOverflow = data->json->GetItemByName( "numOverflow" )->GetInt32Value();
+	StringUtils::StringTo( trace.header.bounds, data->json->GetItemByName( "bounds" )->GetStringValue().ToCStr() );
+
+	size_t offset = 0;
+	ReadArray( trace.vertices, trace.header.numVertices, data->binary, offset );
+	ReadArray( trace.uvs, trace.header.numUvs, data->binary, offset );
+	ReadArray( trace.indices, trace.header.numIndices, data->binary, offset );
+	ReadArray( trace.nodes, trace.header.numNodes, data->binary, offset );
+	ReadArray( trace.leafs, trace.header.numLeafs, data->binary, offset );
+	ReadArray( trace.overflow, trace.header.numOverflow, data->binary, offset );
+
+	data->json->Release();
+	delete data;
+
+	if ( !trace.Validate( true ) )
+	{
+		printf( "invalid kd-tree\n" );
+		exit( 1 );
+	}
+	return seconds;
+}
+
+static size_t KdTreeBytes( const ModelTrace & trace )
+{
+	return trace.nodes.GetSize() * sizeof( kdtree_node_t ) + trace.leafs.GetSize() * sizeof( kdtree_leaf_t ) + trace.overflow.GetSize() * sizeof( int );
+}
+
+static size_t BvhBytes( const ModelTrace & trace )
+{
+	return trace.bvhNodes.GetSize() * sizeof( bvh_node_t ) + trace.bvhTriangles.GetSize() * sizeof( int );
+}
+
+// Builds the BVH at load time from a copy of the kd-tree model. Returns the
+// fastest build of the runs.
+static double BuildBvhModel( const ovrBenchOptions & options, const ModelTrace & kdTree, ModelTrace & bvh )
+{
+	double seconds = 1e10;
+	for ( int run = 0; run < options.NumRuns; run++ )
+	{
+		bvh = kdTree;
+		const double start = GetSeconds();
+		const bool built = bvh.BuildBvh();
+		seconds = Alg::Min( seconds, GetSeconds() - start );
+		if ( !built || !bvh.Validate( true ) )
+		{
+			printf( "invalid BVH\n" );
+			exit( 1 );
+		}
+	}
+	return seconds;
+}
+
+// Primary rays of a camera, ordered in 4x2 pixel tiles so that every 4 or 8
+// consecutive rays form a packet.
+static void BuildCameraRays( const ovrBenchOptions & options, const Vector3f & eye, const Vector3f & target, const float range,
+							Array< Vector3f > & starts, Array< Vector3f > & ends )
+{
+	const int size = options.ImageSize & ~3;
+	const Vector3f forward = ( target - eye ).Normalized();
+	const Vector3f right = forward.Cross( Vector3f( 0.0f, 1.0f, 0.0f ) ).Normalized();
+	const Vector3f up = right.Cross( forward );
+	for ( int ty = 0; ty < size; ty += 2 )
+	{
+		for ( int tx = 0; tx < size; tx += 4 )
+		{
+			for ( int i = 0; i < 8; i++ )
+			{
+				const float x = ( tx + ( i & 1 ) + ( ( i >> 2 ) << 1 ) + 0.5f ) / size * 2.0f - 1.0f;
+				const float y = ( ty + ( ( i >> 1 ) & 1 ) + 0.5f ) / size * 2.0f - 1.0f;
+				const Vector3f dir = ( forward + right * x + up * y ).Normalized();
+				starts.PushBack( eye );
+				ends.PushBack( eye + dir * range );
+			}
+		}
+	}
+}
+
+// Rays between random points of the scene bounds.
+static void BuildRandomRays( const int count, const Bounds3f & bounds, Array< Vector3f > & starts, Array< Vector3f > & ends )
+{
+	uint32_t seed = 7;
+	const Vector3f size = bounds.GetSize();
+	for ( int i = 0; i < count; i++ )
+	{
+		starts.PushBack( bounds.GetMins() + Vector3f( RandomFloat( seed ) * size.x, RandomFloat( seed ) * size.y, RandomFloat( seed ) * size.z ) );
+		ends.PushBack( bounds.GetMins() + Vector3f( RandomFloat( seed ) * size.x, RandomFloat( seed ) * size.y, RandomFloat( seed ) * size.z ) );
+	}
+}
+
+static bool SameResult( const traceResult_t & a, const traceResult_t & b )
+{
+	return a.triangleIndex == b.triangleIndex &&
+			memcmp( &a.fraction, &b.fraction, sizeof( a.fraction ) ) == 0 &&
+			memcmp( &a.uv, &b.uv, sizeof( a.uv ) ) == 0 &&
+			memcmp( &a.normal, &b.normal, sizeof( a.normal ) ) == 0;
+}
+
+// Two results are the same hit if they are the same, or if they are different
+// triangles that touch at the hit point.
+static bool SameHit( const traceResult_t & a, const traceResult_t & b )
+{
+	if ( a.triangleIndex == b.triangleIndex )
+	{
+		return a.triangleIndex < 0 || SameResult( a, b );
+	}
+	return a.triangleIndex >= 0 && b.triangleIndex >= 0 && fabsf( a.fraction - b.fraction ) <= 1e-5f;
+}
+
+// Runs the rays in all modes, checks the results and prints the rays per second.
+static bool RunRays( const char * name, const ovrBenchOptions & options, const ModelTrace & trace, const ModelTrace & bvh,
+					const Array< Vector3f > & starts, const Array< Vector3f > & ends )
+{
+	const int count = starts.GetSizeI();
+	bool ok = true;
+
+	// Trace() one ray at a time, the reference.
+	Array< traceResult_t > reference;
+	reference.Resize( count );
+	double singleSeconds = 1e10;
+	for ( int run = 0; run < options.NumRuns; run++ )
+	{
+		const double start = GetSeconds();
+		for ( int i = 0; i < count; i++ )
+		{
+			reference[i] = trace.Trace( starts[i], ends[i] );
+		}
+		singleSeconds = Alg::Min( singleSeconds, GetSeconds() - start );
+	}
+
+	int hits = 0;
+	for ( int i = 0; i < count; i++ )
+	{
+		hits += ( reference[i].triangleIndex >= 0 );
+	}
+	printf( "%s: %d rays, %d%% hit\n", name, count, hits * 100 / Alg::Max( count, 1 ) );
+	printf( "  Trace            %7.2f Mrays/s\n", count / singleSeconds * 1e-6 );
+
+	const int packetSizes[3] = { 1, 4, 8 };
+	Array< traceResult_t > results;
+	results.Resize( count );
+	for ( int p = 0; p < 3; p++ )
+	{
+		double seconds = 1e10;
+		for ( int run = 0; run < options.NumRuns; run++ )
+		{
+			memset( results.GetDataPtr(), 0xFF, count * sizeof( traceResult_t ) );
+			const double start = GetSeconds();
+			trace.TraceBatch( starts.GetDataPtr(), ends.GetDataPtr(), count, results.GetDataPtr(), packetSizes[p] );
+			seconds = Alg::Min( seconds, GetSeconds() - start );
+		}
+		int mismatches = 0;
+		for ( int i = 0; i < count; i++ )
+		{
+			mismatches += !SameResult( results[i], reference[i] );
+		}
+		printf( "  TraceBatch( %d )  %7.2f Mrays/s  %5.2fx%s\n", packetSizes[p], count / seconds * 1e-6, singleSeconds / seconds,
+				mismatches ? String::Format( "  %d results differ from Trace", mismatches ).ToCStr() : "" );
+		ok &= ( mismatches == 0 );
+	}
+
+	// The BVH visits the triangles in a different order, so it may pick another
+	// triangle where two touch at the hit point. Where it finds another hit than
+	// the kd-tree it has to find the hit of the exhaustive trace.
+	{
+		double seconds = 1e10;
+		for ( int run = 0; run < options.NumRuns; run++ )
+		{
+			const double start = GetSeconds();
+			for ( int i = 0; i < count; i++ )
+			{
+				results[i] = bvh.Trace( starts[i], ends[i] );
+			}
+			seconds = Alg::Min( seconds, GetSeconds() - start );
+		}
+		int mismatches = 0;
+		int wrong = 0;
+		for ( int i = 0; i < count; i++ )
+		{
+			if ( !SameHit( results[i], reference[i] ) )
+			{
+				mismatches++;
+				wrong += !SameHit( results[i], trace.Trace_Exhaustive( starts[i], ends[i] ) );
+			}
+		}
+		printf( "  Trace BVH         %7.2f Mrays/s  %5.2fx%s\n", count / seconds * 1e-6, singleSeconds / seconds,
+				mismatches ? String::Format( "  %d hits differ from the kd-tree, %d from Trace_Exhaustive", mismatches, wrong ).ToCStr() : "" );
+		ok &= ( wrong == 0 );
+	}
+
+	// The exhaustive trace tests every triangle, so only a subset of the rays is
+	// checked. The kd-tree from the converter misses some triangles of the real
+	// scene meshes, so it is only reported for the kd-tree.
+	int checked = 0;
+	int kdTreeDiffers = 0;
+	int bvhDiffers = 0;
+	for ( int i = 0; i < count; i += 61 )
+	{
+		const traceResult_t exhaustive = trace.Trace_Exhaustive( starts[i], ends[i] );
+		checked++;
+		kdTreeDiffers += !SameHit( exhaustive, reference[i] );
+		bvhDiffers += !SameHit( exhaustive, bvh.Trace( starts[i], ends[i] ) );
+	}
+	printf( "  Trace_Exhaustive agrees on %d of %d rays with the kd-tree, %d with the BVH\n", checked - kdTreeDiffers, checked, checked - bvhDiffers );
+	ok &= ( bvhDiffers == 0 );
+
+	return ok;
+}
+
+static bool RunScene( const char * name, const ovrBenchOptions & options, const RawModel & raw, const Vector3f & eye, const Vector3f & target )
+{
+	ModelTrace trace;
+	const double kdTreeSeconds = BuildTraceModel( raw, trace );
+	ModelTrace bvh;
+	const double bvhSeconds = BuildBvhModel( options, trace, bvh );
+
+	printf( "%s: %d triangles\n", name, trace.header.numIndices / 3 );
+	printf( "  kd-tree  %7.1f ms build %7.1f KB\n", kdTreeSeconds * 1e3, KdTreeBytes( trace ) / 1024.0 );
+	printf( "  BVH      %7.1f ms build %7.1f KB\n", bvhSeconds * 1e3, BvhBytes( bvh ) / 1024.0 );
+
+	bool ok = true;
+
+	Array< Vector3f > starts;
+	Array< Vector3f > ends;
+	const float range = trace.header.bounds.GetSize().Length();
+	BuildCameraRays( options, eye, target, range, starts, ends );
+	ok &= RunRays( "camera rays", options, trace, bvh, starts, ends );
+
+	const int numCameraRays = starts.GetSizeI();
+	starts.Clear();
+	ends.Clear();
+	BuildRandomRays( numCameraRays, trace.header.bounds, starts, ends );
+	ok &= RunRays( "random rays", options, trace, bvh, starts, ends );
+
+	return ok;
+}
+
+int main( int argc, char * argv[] )
+{
+	ovrBenchOptions options;
+	for ( int i = 1; i < argc; i++ )
+	{
+		const bool hasValue = ( i + 1 < argc );
+		if ( strcmp( argv[i], "-grid" ) == 0 && hasValue )
+		{
+			options.GridSize = Alg::Clamp( atoi( argv[++i] ), 8, 1024 );
+		}
+		else if ( strcmp( argv[i], "-boxes" ) == 0 && hasValue )
+		{
+			options.NumBoxes = Alg::Clamp( atoi( argv[++i] ), 0, 100000 );
+		}
+		else if ( strcmp( argv[i], "-image" ) == 0 && hasValue )
+		{
+			options.ImageSize = Alg::Clamp( atoi( argv[++i] ), 4, 4096 );
+		}
+		else if ( strcmp( argv[i], "-runs" ) == 0 && hasValue )
+		{
+			options.NumRuns = Alg::Max( 1, atoi( argv[++i] ) );
+		}
+		else if ( strcmp( argv[i], "-fbx" ) == 0 && hasValue )
+		{
+			options.FbxFile = argv[++i];
+		}
+		else
+		{
+			printf( "USAGE: ModelTraceBench [-grid <n>] [-boxes <n>] [-image <n>] [-runs <n>] [-fbx <file>]\n" );
+			return 1;
+		}
+	}
+
+	System::Init( Log::ConfigureDefaultLog( LogMask_None ) );
+
+	bool ok = true;
+	{
+		RawModel raw;
+		BuildScene( options, raw );
+		const float n = (float)options.GridSize;
+		ok &= RunScene( "terrain", options, raw, Vector3f( n * 0.5f, 20.0f, -10.0f ), Vector3f( n * 0.5f, 0.0f, n * 0.5f ) );
+	}
+	{
+		RawModel raw;
+		if ( LoadFbxMeshes( options.FbxFile, raw ) )
+		{
+			// Look around the room from its center.
+			Bounds3f bounds( Bounds3f::Init );
+			for ( int i = 0; i < raw.GetVertexCount(); i++ )
+			{
+				bounds.AddPoint( raw.GetVertex( i ).position );
+			}
+			const Vector3f center = ( bounds.GetMins() + bounds.GetMaxs() ) * 0.5f;
+			ok &= RunScene( "fbx", options, raw, center, center + Vector3f( 0.0f, 0.0f, -1.0f ) );
+		}
+		else
+		{
+			printf( "%s not found, skipped\n", options.FbxFile );
+		}
+	}
+
+	printf( ok ? "OK\n" : "FAILED\n" );
+
+	System::Destroy();
+
+	return ok ? 0 : 1;
+}
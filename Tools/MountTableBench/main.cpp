@@ -0,0 +1,642 @@
+/************************************************************************************
+
+Filename    :   main.cpp
+Content     :   Host benchmark of folder listing, existence and glob queries through
+				ovrMountTable against the VrCommon listing functions on 100K files,
+				and checks of the incremental refresh and the mount order.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <fnmatch.h>
+#include <ftw.h>
+#include <sys/stat.h>
+
+#include "Kernel/OVR_System.h"
+#include "Kernel/OVR_Std.h"
+#include "Kernel/OVR_Alg.h"
+#include "Kernel/OVR_StringHash.h"
+
+#include "OVR_MountTable.h"
+#include "PackageFiles.h"
+#include "zip.h"
+#include "BenchCommon.h"
+
+using namespace OVR;
+
+// 10 x 10 leaf folders of 1000 files each.
+static const int NUM_TOP_FOLDERS = 10;
+static const int NUM_SUB_FOLDERS = 10;
+static const int NUM_FILES_PER_FOLDER = 1000;
+static const int NUM_EXISTS_QUERIES = 100000;
+static const int NUM_PACKAGE_FILES = 2000;
+
+static void WriteFile( const char * path, const char * text )
+{
+	const int fd = open( path, O_CREAT | O_WRONLY | O_TRUNC, 0644 );
+	if ( fd >= 0 )
+	{
+		if ( text != NULL && write( fd, text, strlen( text ) ) < 0 )
+		{
+			printf( "write failed for %s\n", path );
+		}
+		close( fd );
+	}
+}
+
+static String LeafFolder( const int top, const int sub )
+{
+	char s[64];
+	snprintf( s, sizeof( s ), "d%d/s%d", top, sub );
+	return String( s );
+}
+
+static String FileName( const int i )
+{
+	char s[64];
+	snprintf( s, sizeof( s ), "f%04d.%s", i, ( i % 4 == 0 ) ? "ktx" : "dat" );
+	return String( s );
+}
+
+static void CreateTree( const char * root )
+{
+	char path[1024];
+	for ( int t = 0; t < NUM_TOP_FOLDERS; t++ )
+	{
+		snprintf( path, sizeof( path ), "%s/d%d", root, t );
+		mkdir( path, 0755 );
+		for ( int s = 0; s < NUM_SUB_FOLDERS; s++ )
+		{
+			snprintf( path, sizeof( path ), "%s/d%d/s%d", root, t, s );
+			mkdir( path, 0755 );
+			for ( int i = 0; i < NUM_FILES_PER_FOLDER; i++ )
+			{
+				snprintf( path, sizeof( path ), "%s/d%d/s%d/%s", root, t, s, FileName( i ).ToCStr() );
+				WriteFile( path, NULL );
+			}
+		}
+	}
+}
+
+static int RemoveEntry( const char * path, const struct stat * st, int type, struct FTW * ftw )
+{
+	OVR_UNUSED( st );
+	OVR_UNUSED( type );
+	OVR_UNUSED( ftw );
+	return remove( path );
+}
+
+static void RemoveTree( const char * root )
+{
+	nftw( root, RemoveEntry, 64, FTW_DEPTH | FTW_PHYS );
+}
+
+//==============================================================
+// The current listing functions from VrCommon.cpp, POSIX branch. VrCommon.cpp
+// itself does not build on the host.
+
+static int StringCompareNoCase( const void *a, const void * b )
+{
+	const String *sa = ( String * )a;
+	const String *sb = ( String * )b;
+	return sa->CompareNoCase( *sb );
+}
+
+static void SortStringArray( Array<String> & strings )
+{
+	if ( strings.GetSize() > 1 )
+	{
+		qsort( ( void * )&strings[ 0 ], strings.GetSize(), sizeof( String ), StringCompareNoCase );
+	}
+}
+
+static StringHash< String > RelativeDirectoryFileList( const Array< String > & searchPaths, const char * RelativeDirPath )
+{
+	StringHash< String >	uniqueStrings;
+
+	const int numSearchPaths = searchPaths.GetSizeI();
+	for ( int index = 0; index < numSearchPaths; ++index )
+	{
+		const String fullPath = searchPaths[index] + String( RelativeDirPath );
+		DIR * dir = opendir( fullPath.ToCStr() );
+		if ( dir != NULL )
+		{
+			struct dirent * entry;
+			while ( ( entry = readdir( dir ) ) != NULL )
+			{
+				if ( entry->d_name[ 0 ] == '.' )
+				{
+					continue;
+				}
+				if ( entry->d_type == DT_DIR )
+				{
+					String s( RelativeDirPath );
+					s += entry->d_name;
+					s += "/";
+					uniqueStrings.SetCaseInsensitive( s, s );
+				}
+				else if ( entry->d_type == DT_REG )
+				{
+					String s( RelativeDirPath );
+					s += entry->d_name;
+					uniqueStrings.SetCaseInsensitive( s, s );
+				}
+			}
+			closedir( dir );
+		}
+	}
+
+	return uniqueStrings;
+}
+
+static Array<String> DirectoryFileList( const char * dirPath )
+{
+	Array<String>	strings;
+	DIR * dir = opendir( dirPath );
+	if ( dir != NULL )
+	{
+		struct dirent * entry;
+		while ( ( entry = readdir( dir ) ) != NULL )
+		{
+			if ( entry->d_name[ 0 ] == '.' )
+			{
+				continue;
+			}
+			if ( entry->d_type == DT_DIR )
+			{
+				String s( dirPath );
+				s += entry->d_name;
+				s += "/";
+				strings.PushBack( s );
+			}
+			else if ( entry->d_type == DT_REG )
+			{
+				String s( dirPath );
+				s += entry->d_name;
+				strings.PushBack( s );
+			}
+		}
+		closedir( dir );
+	}
+
+	SortStringArray( strings );
+
+	return strings;
+}
+
+//==============================================================
+
+static bool StringLess( const String & a, const String & b )
+{
+	return strcmp( a.ToCStr(), b.ToCStr() ) < 0;
+}
+
+static void SortBytes( Array< String > & strings )
+{
+	Alg::QuickSortSliced( strings, 0, strings.GetSize(), StringLess );
+}
+
+static bool SameStrings( Array< String > a, Array< String > b )
+{
+	if ( a.GetSize() != b.GetSize() )
+	{
+		return false;
+	}
+	SortBytes( a );
+	SortBytes( b );
+	for ( int i = 0; i < a.GetSizeI(); i++ )
+	{
+		if ( strcmp( a[i].ToCStr(), b[i].ToCStr() ) != 0 )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Every path in the table, found by listing from the root.
+static void ListAll( const ovrMountTable & table, const char * folder, Array< String > & out )
+{
+	Array< String > items;
+	table.ListFolder( folder, items );
+	for ( int i = 0; i < items.GetSizeI(); i++ )
+	{
+		out.PushBack( items[i] );
+		const int length = items[i].GetLengthI();
+		if ( length > 0 && items[i].ToCStr()[length - 1] == '/' )
+		{
+			ListAll( table, items[i].ToCStr(), out );
+		}
+	}
+}
+
+static bool Expect( const char * what, const bool ok )
+{
+	printf( "%-44s %s\n", what, ok ? "ok" : "WRONG" );
+	return ok;
+}
+
+static void Report( const char * name, const double seconds, const int count, const char * unit )
+{
+	printf( "%-28s %9.2f ms %10.0f ns/%s\n", name, seconds * 1e3, seconds * 1e9 / count, unit );
+}
+
+static bool RunListing( const ovrMountTable & table, const char * root )
+{
+	bool ok = true;
+
+	// DirectoryFileList over every leaf folder
+	Array< Array< String > > reference;
+	reference.Resize( NUM_TOP_FOLDERS * NUM_SUB_FOLDERS );
+	double start = GetSeconds();
+	for ( int t = 0; t < NUM_TOP_FOLDERS; t++ )
+	{
+		for ( int s = 0; s < NUM_SUB_FOLDERS; s++ )
+		{
+			String dir( root );
+			dir += "/";
+			dir += LeafFolder( t, s );
+			dir += "/";
+			reference[t * NUM_SUB_FOLDERS + s] = DirectoryFileList( dir.ToCStr() );
+		}
+	}
+	const double listTime = GetSeconds() - start;
+
+	Array< Array< String > > listed;
+	listed.Resize( NUM_TOP_FOLDERS * NUM_SUB_FOLDERS );
+	start = GetSeconds();
+	for ( int t = 0; t < NUM_TOP_FOLDERS; t++ )
+	{
+		for ( int s = 0; s < NUM_SUB_FOLDERS; s++ )
+		{
+			table.ListFolder( LeafFolder( t, s ).ToCStr(), listed[t * NUM_SUB_FOLDERS + s] );
+		}
+	}
+	const double indexTime = GetSeconds() - start;
+
+	const int numFiles = NUM_TOP_FOLDERS * NUM_SUB_FOLDERS * NUM_FILES_PER_FOLDER;
+	Report( "DirectoryFileList", listTime, numFiles, "file" );
+	Report( "ListFolder", indexTime, numFiles, "file" );
+
+	bool same = true;
+	const int rootLength = (int)strlen( root ) + 1;
+	for ( int i = 0; i < reference.GetSizeI(); i++ )
+	{
+		Array< String > relative;
+		for ( int j = 0; j < reference[i].GetSizeI(); j++ )
+		{
+			relative.PushBack( String( reference[i][j].ToCStr() + rootLength ) );
+		}
+		same &= SameStrings( relative, listed[i] );
+	}
+	ok &= Expect( "listings match DirectoryFileList", same );
+	return ok;
+}
+
+static bool RunSearchPathListing( const char * root, const char * overlay )
+{
+	ovrMountTable table;
+	table.MountFolder( "", overlay, false );
+	table.MountFolder( "", root, false );
+
+	Array< String > searchPaths;
+	searchPaths.PushBack( String( overlay ) + "/" );
+	searchPaths.PushBack( String( root ) + "/" );
+
+	const int folders = NUM_TOP_FOLDERS * NUM_SUB_FOLDERS;
+	int numFiles = 0;
+	bool same = true;
+	double referenceTime = 0.0;
+	double indexTime = 0.0;
+	for ( int t = 0; t < NUM_TOP_FOLDERS; t++ )
+	{
+		for ( int s = 0; s < NUM_SUB_FOLDERS; s++ )
+		{
+			const String folder = LeafFolder( t, s ) + "/";
+			double start = GetSeconds();
+			StringHash< String > unique = RelativeDirectoryFileList( searchPaths, folder.ToCStr() );
+			referenceTime += GetSeconds() - start;
+
+			start = GetSeconds();
+			Array< String > listed;
+			table.ListFolder( folder.ToCStr(), listed );
+			indexTime += GetSeconds() - start;
+
+			Array< String > reference;
+			for ( StringHash< String >::ConstIterator it = unique.Begin(); it != unique.End(); ++it )
+			{
+				reference.PushBack( it->Second );
+			}
+			same &= SameStrings( reference, listed );
+			numFiles += listed.GetSizeI();
+		}
+	}
+	OVR_UNUSED( folders );
+	Report( "RelativeDirectoryFileList", referenceTime, numFiles, "file" );
+	Report( "ListFolder, 2 mounts", indexTime, numFiles, "file" );
+	return Expect( "listings match RelativeDirectoryFileList", same );
+}
+
+static bool RunExists( const ovrMountTable & table, const char * root )
+{
+	// half the queries are for names that do not exist
+	Array< String > paths;
+	for ( int i = 0; i < NUM_EXISTS_QUERIES; i++ )
+	{
+		const unsigned h = ( i * 2654435761u ) >> 4;
+		const int t = h % NUM_TOP_FOLDERS;
+		const int s = ( h / NUM_TOP_FOLDERS ) % NUM_SUB_FOLDERS;
+		const int f = ( h / 100 ) % ( NUM_FILES_PER_FOLDER * 2 );
+		paths.PushBack( LeafFolder( t, s ) + "/" + FileName( f ) );
+	}
+
+	int statFound = 0;
+	double start = GetSeconds();
+	for ( int i = 0; i < paths.GetSizeI(); i++ )
+	{
+		String local( root );
+		local += "/";
+		local += paths[i];
+		struct stat st;
+		statFound += ( stat( local.ToCStr(), &st ) == 0 );
+	}
+	const double statTime = GetSeconds() - start;
+
+	int indexFound = 0;
+	start = GetSeconds();
+	for ( int i = 0; i < paths.GetSizeI(); i++ )
+	{
+		indexFound += table.FileExists( paths[i].ToCStr() );
+	}
+	const double indexTime = GetSeconds() - start;
+
+	Report( "stat", statTime, NUM_EXISTS_QUERIES, "query" );
+	Report( "FileExists", indexTime, NUM_EXISTS_QUERIES, "query" );
+	return Expect( "FileExists agrees with stat", statFound == indexFound && statFound > 0 && statFound < NUM_EXISTS_QUERIES );
+}
+
+static bool RunGlob( const ovrMountTable & table, const char * root, const char * pattern )
+{
+	// the current way: list every folder and match the names
+	double start = GetSeconds();
+	Array< String > reference;
+	const int rootLength = (int)strlen( root ) + 1;
+	for ( int t = 0; t < NUM_TOP_FOLDERS; t++ )
+	{
+		for ( int s = 0; s < NUM_SUB_FOLDERS; s++ )
+		{
+			String dir( root );
+			dir += "/";
+			dir += LeafFolder( t, s );
+			dir += "/";
+			Array< String > files = DirectoryFileList( dir.ToCStr() );
+			for ( int i = 0; i < files.GetSizeI(); i++ )
+			{
+				if ( fnmatch( pattern, files[i].ToCStr() + rootLength, FNM_PATHNAME ) == 0 )
+				{
+					reference.PushBack( String( files[i].ToCStr() + rootLength ) );
+				}
+			}
+		}
+	}
+	const double listTime = GetSeconds() - start;
+
+	start = GetSeconds();
+	Array< String > matches;
+	table.Glob( pattern, matches );
+	const double indexTime = GetSeconds() - start;
+
+	char name[128];
+	snprintf( name, sizeof( name ), "list + fnmatch %s", pattern );
+	Report( name, listTime, Alg::Max( 1, reference.GetSizeI() ), "match" );
+	snprintf( name, sizeof( name ), "Glob %s", pattern );
+	Report( name, indexTime, Alg::Max( 1, matches.GetSizeI() ), "match" );
+	snprintf( name, sizeof( name ), "Glob %s (%d)", pattern, matches.GetSizeI() );
+	return Expect( name, reference.GetSizeI() > 0 && SameStrings( reference, matches ) );
+}
+
+static bool RunRefresh( ovrMountTable & table, const char * root )
+{
+	bool ok = true;
+	char path[1024];
+
+	double start = GetSeconds();
+	const bool idleChanged = table.Refresh();
+	const double idleTime = GetSeconds() - start;
+	ok &= Expect( "refresh without changes", !idleChanged );
+
+	// new files, removed files, a new folder with files, a removed folder, a rename
+	for ( int i = 0; i < 50; i++ )
+	{
+		snprintf( path, sizeof( path ), "%s/d1/s1/new%02d.dat", root, i );
+		WriteFile( path, NULL );
+		snprintf( path, sizeof( path ), "%s/d2/s2/%s", root, FileName( i * 3 ).ToCStr() );
+		unlink( path );
+	}
+	snprintf( path, sizeof( path ), "%s/d3/new", root );
+	mkdir( path, 0755 );
+	for ( int i = 0; i < 100; i++ )
+	{
+		snprintf( path, sizeof( path ), "%s/d3/new/n%03d.ktx", root, i );
+		WriteFile( path, NULL );
+	}
+	snprintf( path, sizeof( path ), "%s/d4/s4", root );
+	RemoveTree( path );
+	char from[1024];
+	snprintf( from, sizeof( from ), "%s/d5/s5/f0001.dat", root );
+	snprintf( path, sizeof( path ), "%s/d5/s5/renamed.dat", root );
+	rename( from, path );
+
+	start = GetSeconds();
+	const bool changed = table.Refresh();
+	const double refreshTime = GetSeconds() - start;
+	ok &= Expect( "refresh after changes", changed );
+
+	ovrMountTable fresh;
+	start = GetSeconds();
+	fresh.MountFolder( "", root, false );
+	const double rebuildTime = GetSeconds() - start;
+
+	Array< String > refreshed;
+	Array< String > rebuilt;
+	ListAll( table, "", refreshed );
+	ListAll( fresh, "", rebuilt );
+	ok &= Expect( "refreshed index matches a new index", SameStrings( refreshed, rebuilt ) );
+	ok &= Expect( "new folder is listed", table.FileExists( "d3/new/n042.ktx" ) );
+	ok &= Expect( "removed folder is gone", !table.FolderExists( "d4/s4" ) && !table.FileExists( "d4/s4/f0000.ktx" ) );
+	ok &= Expect( "renamed file is moved", table.FileExists( "d5/s5/renamed.dat" ) && !table.FileExists( "d5/s5/f0001.dat" ) );
+
+	// a removed folder created again must be watched again
+	snprintf( path, sizeof( path ), "%s/d4/s4", root );
+	mkdir( path, 0755 );
+	table.Refresh();
+	snprintf( path, sizeof( path ), "%s/d4/s4/again.dat", root );
+	WriteFile( path, NULL );
+	table.Refresh();
+	ok &= Expect( "recreated folder is watched", table.FileExists( "d4/s4/again.dat" ) );
+
+	printf( "%-28s %9.3f ms\n", "refresh, idle", idleTime * 1e3 );
+	printf( "%-28s %9.3f ms\n", "refresh after changes", refreshTime * 1e3 );
+	printf( "%-28s %9.3f ms\n", "full rescan", rebuildTime * 1e3 );
+	return ok;
+}
+
+static bool RunPackageAndMemory( const char * root )
+{
+	bool ok = true;
+
+	// a package with nested folders
+	String zipPath( root );
+	zipPath += "/test.pak";
+	zipFile zip = zipOpen( zipPath.ToCStr(), APPEND_STATUS_CREATE );
+	for ( int i = 0; i < NUM_PACKAGE_FILES; i++ )
+	{
+		char name[128];
+		snprintf( name, sizeof( name ), "assets/p%d/q%d/file%04d.txt", i % 7, i % 3, i );
+		zipOpenNewFileInZip( zip, name, NULL, NULL, 0, NULL, 0, NULL, Z_DEFLATED, Z_DEFAULT_COMPRESSION );
+		zipWriteInFileInZip( zip, name, (unsigned)strlen( name ) );
+		zipCloseFileInZip( zip );
+	}
+	zipClose( zip, NULL );
+
+	static const char * memoryText = "from memory";
+	ovrMemoryFile memoryFiles[2] =
+	{
+		{ "d0/s0/f0001.dat", memoryText, strlen( memoryText ) },
+		{ "extra/a.txt", memoryText, strlen( memoryText ) }
+	};
+
+	String diskText;
+	{
+		char path[1024];
+		snprintf( path, sizeof( path ), "%s/d0/s0/f0001.dat", root );
+		WriteFile( path, "from disk" );
+	}
+
+	void * package = ovr_OpenOtherApplicationPackage( zipPath.ToCStr() );
+	ovrMountTable table;
+	const int memoryId = table.MountMemory( "", memoryFiles, 2 );
+	const double start = GetSeconds();
+	table.MountPackage( "pak", package );
+	const double packageTime = GetSeconds() - start;
+	table.MountFolder( "", root, false );
+
+	MemBufferT< uint8_t > buffer;
+	ok &= Expect( "earlier mount hides a later one", table.ReadFile( "d0/s0/f0001.dat", buffer ) &&
+			buffer.GetSize() == strlen( memoryText ) && memcmp( buffer, memoryText, buffer.GetSize() ) == 0 );
+	ok &= Expect( "folders of all mounts are merged", table.FileExists( "extra/a.txt" ) && table.FileExists( "d0/s0/f0002.dat" ) );
+
+	table.Unmount( memoryId );
+	ok &= Expect( "unmount uncovers the later mount", table.ReadFile( "d0/s0/f0001.dat", buffer ) &&
+			buffer.GetSize() == 9 && memcmp( buffer, "from disk", 9 ) == 0 );
+	ok &= Expect( "unmount removes its names", !table.FileExists( "extra/a.txt" ) && !table.FolderExists( "extra" ) );
+
+	Array< String > listed;
+	table.ListFolder( "pak/assets/p3/q1", listed );
+	int expected = 0;
+	for ( int i = 0; i < NUM_PACKAGE_FILES; i++ )
+	{
+		expected += ( i % 7 == 3 && i % 3 == 1 );
+	}
+	ok &= Expect( "package folder listing", listed.GetSizeI() == expected );
+	ok &= Expect( "package mount point folders", table.FolderExists( "pak" ) && table.FolderExists( "pak/assets/p6" ) );
+	ok &= Expect( "package read", table.ReadFile( "pak/assets/p1/q2/file0008.txt", buffer ) &&
+			buffer.GetSize() == strlen( "assets/p1/q2/file0008.txt" ) &&
+			memcmp( buffer, "assets/p1/q2/file0008.txt", buffer.GetSize() ) == 0 );
+	Array< String > matches;
+	table.Glob( "pak/assets/p?/q0/file00*.txt", matches );
+	int expectedMatches = 0;
+	for ( int i = 0; i < 100; i++ )
+	{
+		expectedMatches += ( i % 3 == 0 );
+	}
+	ok &= Expect( "package glob", matches.GetSizeI() == expectedMatches );
+
+	String localPath;
+	ok &= Expect( "local path of a folder mount file", table.GetLocalPath( "d0/s0/f0001.dat", localPath ) &&
+			localPath == String( root ) + "/d0/s0/f0001.dat" );
+	ok &= Expect( "no local path in a package", !table.GetLocalPath( "pak/assets/p1/q2/file0008.txt", localPath ) );
+
+	ovr_CloseOtherApplicationPackage( package );
+	unlink( zipPath.ToCStr() );
+	printf( "%-28s %9.3f ms for %d files\n", "package index", packageTime * 1e3, NUM_PACKAGE_FILES );
+	return ok;
+}
+
+static int RunBenchmark()
+{
+	char root[] = "/tmp/MountTableBenchXXXXXX";
+	if ( mkdtemp( root ) == NULL )
+	{
+		printf( "can not create a temp folder\n" );
+		return 1;
+	}
+	String tree( root );
+	tree += "/tree";
+	mkdir( tree.ToCStr(), 0755 );
+	String overlay( root );
+	overlay += "/overlay";
+	mkdir( overlay.ToCStr(), 0755 );
+
+	double start = GetSeconds();
+	CreateTree( tree.ToCStr() );
+	printf( "created %d files in %.1f s\n", NUM_TOP_FOLDERS * NUM_SUB_FOLDERS * NUM_FILES_PER_FOLDER, GetSeconds() - start );
+
+	// the overlay shadows a few names and adds a few
+	char path[1024];
+	snprintf( path, sizeof( path ), "%s/d7", overlay.ToCStr() );
+	mkdir( path, 0755 );
+	snprintf( path, sizeof( path ), "%s/d7/s7", overlay.ToCStr() );
+	mkdir( path, 0755 );
+	for ( int i = 0; i < 20; i++ )
+	{
+		snprintf( path, sizeof( path ), "%s/d7/s7/%s", overlay.ToCStr(), FileName( i * 90 ).ToCStr() );
+		WriteFile( path, NULL );
+	}
+
+	bool ok = true;
+	{
+		ovrMountTable table;
+		start = GetSeconds();
+		table.MountFolder( "", tree.ToCStr(), true );
+		const double mountTime = GetSeconds() - start;
+		printf( "%-28s %9.2f ms for %d entries\n", "mount with watches", mountTime * 1e3, table.GetNumEntries() );
+
+		ok &= RunListing( table, tree.ToCStr() );
+		ok &= RunSearchPathListing( tree.ToCStr(), overlay.ToCStr() );
+		ok &= RunExists( table, tree.ToCStr() );
+		ok &= RunGlob( table, tree.ToCStr(), "d3/s4/f00*.ktx" );
+		ok &= RunGlob( table, tree.ToCStr(), "d*/s?/f09?2.dat" );
+		ok &= RunRefresh( table, tree.ToCStr() );
+	}
+	ok &= RunPackageAndMemory( tree.ToCStr() );
+
+	RemoveTree( root );
+
+	printf( "%s\n", ok ? "PASSED" : "FAILED" );
+	return ok ? 0 : 1;
+}
+
+int main( int const argc, char const * argv[] )
+{
+	if ( argc > 1 )
+	{
+		printf( "USAGE: MountTableBench\n" );
+		return 1;
+	}
+
+	System::Init( Log::ConfigureDefaultLog( LogMask_None ) );
+	const int result = RunBenchmark();
+	System::Destroy();
+
+	return result;
+}
@@ -0,0 +1,485 @@
+/************************************************************************************
+
+Filename    :   main.cpp
+Content     :   Host test of the package extraction cache: churns reads of a synthetic
+				package against a tiny budget over several launches, and checks the
+				cache files and the manifest after every launch.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "Kernel/OVR_System.h"
+#include "Kernel/OVR_Std.h"
+#include "Kernel/OVR_Hash.h"
+
+#include "PackageFiles.h"
+
+#include "zip.h"
+#include "zlib.h"
+#include "BenchCommon.h"
+
+using namespace OVR;
+
+static const char * PackageName = "/tmp/PackageCacheBench.apk";
+static const char * CacheFolder = "/tmp/PackageCacheBench_cache";
+
+struct ovrBenchOptions
+{
+	ovrBenchOptions() :
+		NumFiles( 64 ),
+		NumLaunches( 6 ),
+		ReadsPerLaunch( 4000 ),
+		BudgetBytes( 256 * 1024 ) {}
+
+	int		NumFiles;
+	int		NumLaunches;
+	int		ReadsPerLaunch;
+	size_t	BudgetBytes;
+};
+
+struct ovrPackageFile
+{
+	String				Name;
+	Array< uint8_t >	Data;
+	uint32_t			Crc;
+	bool				Compressed;
+};
+
+// Compressible data from 2 to 64 KB, every eighth file stored, and one file that
+// never fits in the budget.
+static void BuildFiles( const ovrBenchOptions & options, Array< ovrPackageFile > & files )
+{
+	files.Resize( options.NumFiles );
+	for ( int i = 0; i < options.NumFiles; i++ )
+	{
+		ovrPackageFile & file = files[i];
+		char name[64];
+		OVR_sprintf( name, sizeof( name ), "assets/file%03d.dat", i );
+		file.Name = name;
+		file.Compressed = ( i % 8 ) != 7;
+
+		uint32_t seed = i + 1;
+		const int size = ( i == options.NumFiles - 1 ) ? (int)options.BudgetBytes + 4096 : 2048 + ( i * 7919 ) % ( 62 * 1024 );
+		file.Data.Resize( size );
+		for ( int j = 0; j < size; j++ )
+		{
+			file.Data[j] = (uint8_t)( 'a' + ( ( j & 7 ) == 0 ? Random( seed ) % 26 : ( j >> 4 ) % 26 ) );
+		}
+		file.Crc = (uint32_t)crc32( 0, file.Data.GetDataPtr(), size );
+	}
+}
+
+static void WritePackage( const Array< ovrPackageFile > & files )
+{
+	zipFile zf = zipOpen( PackageName, APPEND_STATUS_CREATE );
+	if ( zf == NULL )
+	{
+		printf( "failed to create %s\n", PackageName );
+		exit( 1 );
+	}
+	for ( int i = 0; i < files.GetSizeI(); i++ )
+	{
+		const int method = files[i].Compressed ? Z_DEFLATED : 0;
+		zip_fileinfo info;
+		memset( &info, 0, sizeof( info ) );
+		if ( zipOpenNewFileInZip( zf, files[i].Name.ToCStr(), &info, NULL, 0, NULL, 0, NULL, method, method != 0 ? Z_DEFAULT_COMPRESSION : 0 ) != ZIP_OK ||
+				zipWriteInFileInZip( zf, files[i].Data.GetDataPtr(), files[i].Data.GetSizeI() ) != ZIP_OK ||
+				zipCloseFileInZip( zf ) != ZIP_OK )
+		{
+			printf( "failed to add %s\n", files[i].Name.ToCStr() );
+			exit( 1 );
+		}
+	}
+	zipClose( zf, NULL );
+}
+
+static String GetCacheFileName( const uint32_t crc, const char * extension )
+{
+	char name[1024];
+	OVR_sprintf( name, sizeof( name ), "%s/%08x.%s", CacheFolder, crc, extension );
+	return String( name );
+}
+
+// The extracted files in the cache folder by crc, with their size. Returns false
+// if a temp file was left behind.
+static bool ListCacheFiles( Hash< uint32_t, size_t > & cached )
+{
+	bool ok = true;
+	DIR * dir = opendir( CacheFolder );
+	if ( dir == NULL )
+	{
+		return false;
+	}
+	struct dirent * entry;
+	while ( ( entry = readdir( dir ) ) != NULL )
+	{
+		unsigned crc = 0;
+		char extension[4] = {};
+		if ( sscanf( entry->d_name, "%08x.%3s", &crc, extension ) != 2 || OVR_strlen( entry->d_name ) != 12 )
+		{
+			continue;
+		}
+		if ( OVR_strcmp( extension, "tmp" ) == 0 )
+		{
+			printf( "temp file %s left behind\n", entry->d_name );
+			ok = false;
+		}
+		else if ( OVR_strcmp( extension, "bin" ) == 0 )
+		{
+			struct stat s = {};
+			stat( GetCacheFileName( crc, "bin" ).ToCStr(), &s );
+			cached.Set( crc, (size_t)s.st_size );
+		}
+	}
+	closedir( dir );
+	return ok;
+}
+
+static size_t GetTotalSize( const Hash< uint32_t, size_t > & cached )
+{
+	size_t total = 0;
+	for ( Hash< uint32_t, size_t >::ConstIterator it = cached.Begin(); it != cached.End(); ++it )
+	{
+		total += it->Second;
+	}
+	return total;
+}
+
+static bool SameCacheFiles( const Hash< uint32_t, size_t > & a, const Hash< uint32_t, size_t > & b )
+{
+	if ( a.GetSize() != b.GetSize() )
+	{
+		return false;
+	}
+	for ( Hash< uint32_t, size_t >::ConstIterator it = a.Begin(); it != a.End(); ++it )
+	{
+		const size_t * size = b.Get( it->First );
+		if ( size == NULL || *size != it->Second )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// The cache files must add up to the size the cache reports, and stay in the budget.
+static bool CheckCacheFiles( const ovrBenchOptions & options, const char * when )
+{
+	Hash< uint32_t, size_t > cached;
+	bool ok = ListCacheFiles( cached );
+	const size_t total = GetTotalSize( cached );
+	if ( total != ovr_GetApplicationPackageCacheSize() || total > options.BudgetBytes )
+	{
+		printf( "%s: %zu bytes of cache files, the cache counts %zu, budget %zu\n", when, total,
+				ovr_GetApplicationPackageCacheSize(), options.BudgetBytes );
+		ok = false;
+	}
+	return ok;
+}
+
+static const ovrPackageFile * FindFileByCrc( const Array< ovrPackageFile > & files, const uint32_t crc )
+{
+	for ( int i = 0; i < files.GetSizeI(); i++ )
+	{
+		if ( files[i].Crc == crc )
+		{
+			return &files[i];
+		}
+	}
+	return NULL;
+}
+
+static bool ReadAndCheck( const ovrPackageFile & file )
+{
+	MemBufferFile buffer( MemBufferFile::NoInit );
+	if ( !ovr_ReadFileFromApplicationPackage( file.Name.ToCStr(), buffer ) ||
+			buffer.Length != file.Data.GetSizeI() || memcmp( buffer.Buffer, file.Data.GetDataPtr(), buffer.Length ) != 0 )
+	{
+		printf( "wrong data for %s\n", file.Name.ToCStr() );
+		return false;
+	}
+	return true;
+}
+
+// One launch of the app: the package and the cache are opened once per process.
+static bool RunLaunch( const ovrBenchOptions & options, const Array< ovrPackageFile > & files, const int launch )
+{
+	bool ok = true;
+
+	ovr_OpenApplicationPackage( PackageName, CacheFolder );
+	// the last launch shrinks the budget, which must evict right away
+	const size_t budget = ( launch == options.NumLaunches - 1 ) ? options.BudgetBytes / 2 : options.BudgetBytes;
+	ovrBenchOptions launchOptions = options;
+	launchOptions.BudgetBytes = budget;
+	ovr_SetApplicationPackageCacheBudget( budget );
+	ok = CheckCacheFiles( launchOptions, "after open" ) && ok;
+
+	// Skewed towards the low file indices, so some files stay hot and the rest churn.
+	uint32_t seed = 12345 + launch;
+	int hits = 0;
+	int misses = 0;
+	double hitSeconds = 0.0;
+	double missSeconds = 0.0;
+	for ( int r = 0; r < options.ReadsPerLaunch; r++ )
+	{
+		const int index = (int)( ( Random( seed ) % options.NumFiles ) * ( Random( seed ) % options.NumFiles ) / options.NumFiles );
+		const ovrPackageFile & file = files[index];
+		struct stat s;
+		const bool wasCached = ( stat( GetCacheFileName( file.Crc, "bin" ).ToCStr(), &s ) == 0 );
+
+		const double start = GetSeconds();
+		ok = ReadAndCheck( file ) && ok;
+		const double seconds = GetSeconds() - start;
+		if ( wasCached )
+		{
+			hits++;
+			hitSeconds += seconds;
+		}
+		else
+		{
+			misses++;
+			missSeconds += seconds;
+		}
+
+		const bool isCached = ( stat( GetCacheFileName( file.Crc, "bin" ).ToCStr(), &s ) == 0 );
+		const bool shouldCache = file.Compressed && file.Data.GetSize() <= budget;
+		if ( isCached != shouldCache )
+		{
+			printf( "%s is %scached after a read\n", file.Name.ToCStr(), isCached ? "" : "not " );
+			ok = false;
+		}
+		if ( ( r & 63 ) == 0 )
+		{
+			ok = CheckCacheFiles( launchOptions, "during churn" ) && ok;
+		}
+	}
+
+	// An extraction write that fails must not evict anything. A folder in the way
+	// of the temp file makes the write fail.
+	Hash< uint32_t, size_t > before;
+	ListCacheFiles( before );
+	const ovrPackageFile * failed = NULL;
+	for ( int i = 0; i < files.GetSizeI(); i++ )
+	{
+		if ( files[i].Compressed && files[i].Data.GetSize() <= budget && before.Get( files[i].Crc ) == NULL &&
+				( failed == NULL || files[i].Data.GetSize() > failed->Data.GetSize() ) )
+		{
+			failed = &files[i];
+		}
+	}
+	if ( failed != NULL )
+	{
+		const String tempName = GetCacheFileName( failed->Crc, "tmp" );
+		mkdir( tempName.ToCStr(), 0755 );
+		ok = ReadAndCheck( *failed ) && ok;
+		rmdir( tempName.ToCStr() );
+
+		Hash< uint32_t, size_t > after;
+		ListCacheFiles( after );
+		if ( !SameCacheFiles( before, after ) || GetTotalSize( after ) != ovr_GetApplicationPackageCacheSize() )
+		{
+			printf( "a failed write of %s changed the cache from %d to %d files\n", failed->Name.ToCStr(),
+					before.GetSizeI(), after.GetSizeI() );
+			ok = false;
+		}
+	}
+	ok = CheckCacheFiles( launchOptions, "at exit" ) && ok;
+
+	printf( "launch %d: budget %4zu KB, %5d hits %7.1f us, %5d misses %7.1f us, %2d files %4zu KB cached\n",
+			launch, budget / 1024, hits, hits > 0 ? hitSeconds * 1e6 / hits : 0.0, misses, misses > 0 ? missSeconds * 1e6 / misses : 0.0,
+			before.GetSizeI(), ovr_GetApplicationPackageCacheSize() / 1024 );
+	return ok;
+}
+
+// The manifest written by the last launch must list exactly the cache files, with
+// their sizes and the crc of their content, within the budget.
+static bool CheckManifest( const Array< ovrPackageFile > & files, const size_t budget )
+{
+	char manifestName[1024];
+	OVR_sprintf( manifestName, sizeof( manifestName ), "%s/cache_manifest.dat", CacheFolder );
+	FILE * f = fopen( manifestName, "rb" );
+	if ( f == NULL )
+	{
+		printf( "no manifest\n" );
+		return false;
+	}
+	uint32_t header[3] = {};
+	bool ok = ( fread( header, sizeof( header ), 1, f ) == 1 && header[0] == 0x4d43504f && header[1] == 1 );
+	Array< uint32_t > entries;
+	if ( ok )
+	{
+		entries.Resize( header[2] * 3 );
+		ok = ( header[2] == 0 || fread( entries.GetDataPtr(), sizeof( uint32_t ) * 3, header[2], f ) == header[2] );
+	}
+	fclose( f );
+	if ( !ok )
+	{
+		printf( "damaged manifest\n" );
+		return false;
+	}
+
+	Hash< uint32_t, size_t > cached;
+	ok = ListCacheFiles( cached );
+	Hash< uint32_t, size_t > listed;
+	size_t total = 0;
+	for ( int i = 0; i < (int)header[2]; i++ )
+	{
+		const uint32_t crc = entries[i * 3 + 0];
+		const uint32_t size = entries[i * 3 + 1];
+		const size_t * onDisk = cached.Get( crc );
+		const ovrPackageFile * file = FindFileByCrc( files, crc );
+		if ( listed.Get( crc ) != NULL || onDisk == NULL || *onDisk != size || file == NULL || file->Data.GetSize() != size )
+		{
+			printf( "manifest entry %08x doesn't match the cache files\n", crc );
+			ok = false;
+			continue;
+		}
+		listed.Set( crc, size );
+		total += size;
+
+		FILE * bin = fopen( GetCacheFileName( crc, "bin" ).ToCStr(), "rb" );
+		Array< uint8_t > data;
+		data.Resize( size );
+		const bool read = ( bin != NULL && fread( data.GetDataPtr(), 1, size, bin ) == size );
+		if ( bin != NULL )
+		{
+			fclose( bin );
+		}
+		if ( !read || (uint32_t)crc32( 0, data.GetDataPtr(), size ) != crc )
+		{
+			printf( "cache file %08x is damaged\n", crc );
+			ok = false;
+		}
+	}
+	if ( listed.GetSize() != cached.GetSize() )
+	{
+		printf( "%d cache files, %d in the manifest\n", cached.GetSizeI(), listed.GetSizeI() );
+		ok = false;
+	}
+	if ( total > budget )
+	{
+		printf( "manifest lists %zu bytes, budget %zu\n", total, budget );
+		ok = false;
+	}
+	return ok;
+}
+
+static int RunTest( const ovrBenchOptions & options )
+{
+	Array< ovrPackageFile > files;
+	BuildFiles( options, files );
+	WritePackage( files );
+
+	char command[1024];
+	OVR_sprintf( command, sizeof( command ), "rm -rf %s", CacheFolder );
+	if ( system( command ) != 0 || mkdir( CacheFolder, 0755 ) != 0 )
+	{
+		printf( "failed to create %s\n", CacheFolder );
+		return 1;
+	}
+
+	printf( "%d files, %d reads per launch, budget %zu KB\n", options.NumFiles, options.ReadsPerLaunch, options.BudgetBytes / 1024 );
+
+	bool ok = true;
+	for ( int launch = 0; launch < options.NumLaunches; launch++ )
+	{
+		fflush( stdout );
+		const pid_t pid = fork();
+		if ( pid == 0 )
+		{
+			const bool launchOk = RunLaunch( options, files, launch );
+			fflush( stdout );
+			_exit( launchOk ? 0 : 1 );
+		}
+		int status = 0;
+		if ( pid < 0 || waitpid( pid, &status, 0 ) != pid || !WIFEXITED( status ) || WEXITSTATUS( status ) != 0 )
+		{
+			printf( "launch %d failed\n", launch );
+			ok = false;
+		}
+		const size_t budget = ( launch == options.NumLaunches - 1 ) ? options.BudgetBytes / 2 : options.BudgetBytes;
+		ok = CheckManifest( files, budget ) && ok;
+	}
+
+	// A manifest that can't be read makes the next launch adopt the files.
+	char manifestName[1024];
+	OVR_sprintf( manifestName, sizeof( manifestName ), "%s/cache_manifest.dat", CacheFolder );
+	FILE * f = fopen( manifestName, "wb" );
+	if ( f != NULL )
+	{
+		fputs( "damaged", f );
+		fclose( f );
+	}
+	const pid_t pid = fork();
+	if ( pid == 0 )
+	{
+		ovr_OpenApplicationPackage( PackageName, CacheFolder );
+		_exit( CheckCacheFiles( options, "after adopting" ) ? 0 : 1 );
+	}
+	int status = 0;
+	if ( pid < 0 || waitpid( pid, &status, 0 ) != pid || !WIFEXITED( status ) || WEXITSTATUS( status ) != 0 )
+	{
+		printf( "adopting the cache files failed\n" );
+		ok = false;
+	}
+	ok = CheckManifest( files, options.BudgetBytes ) && ok;
+
+	OVR_sprintf( command, sizeof( command ), "rm -rf %s", CacheFolder );
+	if ( system( command ) != 0 )
+	{
+		printf( "failed to remove %s\n", CacheFolder );
+	}
+	remove( PackageName );
+
+	printf( ok ? "OK\n" : "FAILED\n" );
+	return ok ? 0 : 1;
+}
+
+int main( int argc, char * argv[] )
+{
+	ovrBenchOptions options;
+	for ( int i = 1; i < argc; i++ )
+	{
+		const bool hasValue = ( i + 1 < argc );
+		if ( strcmp( argv[i], "-files" ) == 0 && hasValue )
+		{
+			options.NumFiles = atoi( argv[++i] );
+			options.NumFiles = ( options.NumFiles < 2 ) ? 2 : options.NumFiles;
+		}
+		else if ( strcmp( argv[i], "-launches" ) == 0 && hasValue )
+		{
+			options.NumLaunches = atoi( argv[++i] );
+			options.NumLaunches = ( options.NumLaunches < 1 ) ? 1 : options.NumLaunches;
+		}
+		else if ( strcmp( argv[i], "-reads" ) == 0 && hasValue )
+		{
+			options.ReadsPerLaunch = atoi( argv[++i] );
+		}
+		else if ( strcmp( argv[i], "-budget" ) == 0 && hasValue )
+		{
+			options.BudgetBytes = (size_t)atoi( argv[++i] ) * 1024;
+		}
+		else
+		{
+			printf( "USAGE: PackageCacheBench [-files <n>] [-launches <n>] [-reads <n>] [-budget <KB>]\n" );
+			return 1;
+		}
+	}
+
+	System::Init( Log::ConfigureDefaultLog( LogMask_None ) );
+	const int result = RunTest( options );
+	System::Destroy();
+
+	return result;
+}
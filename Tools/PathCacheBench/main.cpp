@@ -0,0 +1,306 @@
+/************************************************************************************
+
+Filename    :   main.cpp
+Content     :   Host benchmark of resolving relative paths across search paths with
+				and without ovrPathCache, cold and warm, single and batched.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/stat.h>
+
+#include "Kernel/OVR_System.h"
+#include "Kernel/OVR_Std.h"
+
+#include "OVR_PathCache.h"
+#include "BenchCommon.h"
+
+using namespace OVR;
+
+static const int NUM_NAMES = 10000;
+static const int NUM_SEARCH_PATHS = 5;
+
+static void TouchFile( const char * path )
+{
+	const int fd = open( path, O_CREAT | O_WRONLY, 0644 );
+	if ( fd >= 0 )
+	{
+		close( fd );
+	}
+}
+
+// Moves the modification time of a folder into the past, so the cache trusts it.
+static void AgeFolder( const char * path, const int secondsAgo )
+{
+	struct utimbuf times;
+	times.actime = times.modtime = time( NULL ) - secondsAgo;
+	utime( path, &times );
+}
+
+// Name i is in search path i % 6, or in none of them when that is 5. Every
+// fourth name is in a "thumbs/" sub folder.
+static String NameForIndex( const int i )
+{
+	char name[64];
+	OVR_sprintf( name, sizeof( name ), "%simage_%05d.jpg", ( i % 4 == 3 ) ? "thumbs/" : "", i );
+	return String( name );
+}
+
+static void CreateTree( const char * root, Array< String > & searchPaths, Array< String > & names )
+{
+	for ( int p = 0; p < NUM_SEARCH_PATHS; p++ )
+	{
+		char path[256];
+		OVR_sprintf( path, sizeof( path ), "%s/search%d/", root, p );
+		mkdir( path, 0755 );
+		searchPaths.PushBack( String( path ) );
+		OVR_sprintf( path, sizeof( path ), "%s/search%d/thumbs/", root, p );
+		mkdir( path, 0755 );
+	}
+	for ( int i = 0; i < NUM_NAMES; i++ )
+	{
+		names.PushBack( NameForIndex( i ) );
+		const int p = i % ( NUM_SEARCH_PATHS + 1 );
+		if ( p < NUM_SEARCH_PATHS )
+		{
+			TouchFile( String( searchPaths[p] + names[i] ).ToCStr() );
+		}
+	}
+	for ( int p = 0; p < NUM_SEARCH_PATHS; p++ )
+	{
+		AgeFolder( searchPaths[p].ToCStr(), 60 );
+		AgeFolder( String( searchPaths[p] + "thumbs/" ).ToCStr(), 60 );
+	}
+	// The names are also looked up relative to the working folder.
+	AgeFolder( root, 60 );
+	if ( chdir( root ) != 0 )
+	{
+		printf( "Failed to enter '%s'\n", root );
+	}
+}
+
+static void RemoveTree( const char * root, const Array< String > & searchPaths, const Array< String > & names )
+{
+	for ( int i = 0; i < names.GetSizeI(); i++ )
+	{
+		for ( int p = 0; p < searchPaths.GetSizeI(); p++ )
+		{
+			unlink( String( searchPaths[p] + names[i] ).ToCStr() );
+		}
+	}
+	for ( int p = 0; p < searchPaths.GetSizeI(); p++ )
+	{
+		rmdir( String( searchPaths[p] + "thumbs/" ).ToCStr() );
+		rmdir( searchPaths[p].ToCStr() );
+	}
+	rmdir( root );
+}
+
+// What GetFullPath did before the cache: a stat per candidate, every time.
+static bool UncachedFullPath( const Array< String > & searchPaths, const char * relativePath, String & outPath )
+{
+	struct stat st;
+	if ( stat( relativePath, &st ) == 0 )
+	{
+		outPath = relativePath;
+		return true;
+	}
+	char fullPath[1024];
+	for ( int i = 0; i < searchPaths.GetSizeI(); i++ )
+	{
+		OVR_sprintf( fullPath, sizeof( fullPath ), "%s%s", searchPaths[i].ToCStr(), relativePath );
+		if ( stat( fullPath, &st ) == 0 )
+		{
+			outPath = fullPath;
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool SameResults( const Array< String > & a, const Array< String > & b )
+{
+	for ( int i = 0; i < a.GetSizeI(); i++ )
+	{
+		if ( a[i] != b[i] )
+		{
+			printf( "mismatch for %d: '%s' vs '%s'\n", i, a[i].ToCStr(), b[i].ToCStr() );
+			return false;
+		}
+	}
+	return true;
+}
+
+static void Report( const char * name, const double seconds, const int probes, const int found, const bool same )
+{
+	printf( "%-18s %8.1f ms %7.0f ns/path %6d probes %5d found %s\n", name, seconds * 1e3, seconds * 1e9 / NUM_NAMES,
+			probes, found, same ? "ok" : "WRONG" );
+}
+
+static bool TimeResolve( ovrPathCache & cache, const char * name, const Array< String > & searchPaths,
+						 const Array< String > & names, const Array< String > & reference )
+{
+	Array< String > results;
+	results.Resize( names.GetSizeI() );
+	const int probes = cache.GetNumProbes();
+	int found = 0;
+	const double start = GetSeconds();
+	for ( int i = 0; i < names.GetSizeI(); i++ )
+	{
+		found += cache.Resolve( searchPaths, names[i].ToCStr(), results[i] ) != ovrPathCache::NOT_FOUND;
+	}
+	const double seconds = GetSeconds() - start;
+	const bool same = SameResults( results, reference );
+	Report( name, seconds, cache.GetNumProbes() - probes, found, same );
+	return same;
+}
+
+static bool TimeResolveBatch( ovrPathCache & cache, const char * name, const Array< String > & searchPaths,
+							  const Array< String > & names, const Array< String > & reference )
+{
+	Array< String > results;
+	const int probes = cache.GetNumProbes();
+	const double start = GetSeconds();
+	const int found = cache.ResolveBatch( searchPaths, names, results );
+	const double seconds = GetSeconds() - start;
+	const bool same = SameResults( results, reference );
+	Report( name, seconds, cache.GetNumProbes() - probes, found, same );
+	return same;
+}
+
+static bool Expect( const char * what, const bool ok )
+{
+	printf( "%-58s %s\n", what, ok ? "ok" : "WRONG" );
+	return ok;
+}
+
+// Folder changes must show up, within the revalidate interval or after a flush.
+static bool CheckInvalidation( ovrPathCache & cache, const Array< String > & searchPaths )
+{
+	bool ok = true;
+	String path;
+	const String added = "added.jpg";
+	const String shadowed = NameForIndex( 3 );		// in search path 3
+
+	cache.SetRevalidateSeconds( 0.0 );
+	cache.Flush();
+	ok &= Expect( "missing file is not found", cache.Resolve( searchPaths, added.ToCStr(), path ) == ovrPathCache::NOT_FOUND );
+	ok &= Expect( "file is found in its search path", cache.Resolve( searchPaths, shadowed.ToCStr(), path ) == 3 );
+
+	// A just modified folder is racy, so this does not depend on the time resolution.
+	TouchFile( String( searchPaths[1] + added ).ToCStr() );
+	ok &= Expect( "added file is found", cache.Resolve( searchPaths, added.ToCStr(), path ) == 1 );
+	TouchFile( String( searchPaths[0] + shadowed ).ToCStr() );
+	ok &= Expect( "file added to an earlier search path shadows the old one", cache.Resolve( searchPaths, shadowed.ToCStr(), path ) == 0 );
+	unlink( String( searchPaths[0] + shadowed ).ToCStr() );
+	ok &= Expect( "removing it uncovers the old one", cache.Resolve( searchPaths, shadowed.ToCStr(), path ) == 3 );
+	unlink( String( searchPaths[1] + added ).ToCStr() );
+	ok &= Expect( "removed file is not found", cache.Resolve( searchPaths, added.ToCStr(), path ) == ovrPathCache::NOT_FOUND );
+
+	// Settled folders are trusted: a change with an old time shows up at the next
+	// check of the folder, and not before.
+	AgeFolder( searchPaths[1].ToCStr(), 60 );
+	cache.SetRevalidateSeconds( 1000.0 );
+	cache.Flush();
+	ok &= Expect( "missing file is cached as not found", cache.Resolve( searchPaths, added.ToCStr(), path ) == ovrPathCache::NOT_FOUND );
+	TouchFile( String( searchPaths[1] + added ).ToCStr() );
+	AgeFolder( searchPaths[1].ToCStr(), 30 );
+	ok &= Expect( "change is not seen before the folder is checked again", cache.Resolve( searchPaths, added.ToCStr(), path ) == ovrPathCache::NOT_FOUND );
+	cache.SetRevalidateSeconds( 0.0 );
+	ok &= Expect( "change is seen when the folder is checked again", cache.Resolve( searchPaths, added.ToCStr(), path ) == 1 );
+	cache.SetRevalidateSeconds( 1000.0 );
+	unlink( String( searchPaths[1] + added ).ToCStr() );
+	AgeFolder( searchPaths[1].ToCStr(), 20 );
+	ok &= Expect( "removal is not seen before the folder is checked again", cache.Resolve( searchPaths, added.ToCStr(), path ) == 1 );
+	cache.Flush();
+	ok &= Expect( "removal is seen after a flush", cache.Resolve( searchPaths, added.ToCStr(), path ) == ovrPathCache::NOT_FOUND );
+
+	// Names in a folder that does not exist yet.
+	const String inNewFolder = "new/added.jpg";
+	ok &= Expect( "file in a missing folder is not found", cache.Resolve( searchPaths, inNewFolder.ToCStr(), path ) == ovrPathCache::NOT_FOUND );
+	mkdir( String( searchPaths[2] + "new/" ).ToCStr(), 0755 );
+	TouchFile( String( searchPaths[2] + inNewFolder ).ToCStr() );
+	cache.SetRevalidateSeconds( 0.0 );
+	ok &= Expect( "file in a created folder is found", cache.Resolve( searchPaths, inNewFolder.ToCStr(), path ) == 2 );
+	unlink( String( searchPaths[2] + inNewFolder ).ToCStr() );
+	rmdir( String( searchPaths[2] + "new/" ).ToCStr() );
+	AgeFolder( searchPaths[2].ToCStr(), 60 );
+	AgeFolder( searchPaths[1].ToCStr(), 60 );
+
+	cache.SetRevalidateSeconds( 1.0 );
+	return ok;
+}
+
+static int RunBenchmark()
+{
+	char root[] = "/tmp/PathCacheBench.XXXXXX";
+	if ( mkdtemp( root ) == NULL )
+	{
+		printf( "Failed to create a temporary folder\n" );
+		return 1;
+	}
+
+	Array< String > searchPaths;
+	Array< String > names;
+	CreateTree( root, searchPaths, names );
+	printf( "%d names, %d search paths, %d%% not found\n", NUM_NAMES, NUM_SEARCH_PATHS, 100 / ( NUM_SEARCH_PATHS + 1 ) );
+
+	// Twice, the first pass also fills the kernel's folder entry cache.
+	Array< String > reference;
+	reference.Resize( names.GetSizeI() );
+	for ( int pass = 0; pass < 2; pass++ )
+	{
+		int found = 0;
+		const double start = GetSeconds();
+		for ( int i = 0; i < names.GetSizeI(); i++ )
+		{
+			found += UncachedFullPath( searchPaths, names[i].ToCStr(), reference[i] );
+		}
+		Report( pass == 0 ? "uncached, first" : "uncached", GetSeconds() - start, 0, found, true );
+	}
+
+	ovrPathCache cache;
+	bool ok = true;
+	ok &= TimeResolve( cache, "cached cold", searchPaths, names, reference );
+	ok &= TimeResolve( cache, "cached warm", searchPaths, names, reference );
+	cache.Flush();
+	ok &= TimeResolveBatch( cache, "batched cold", searchPaths, names, reference );
+	ok &= TimeResolveBatch( cache, "batched warm", searchPaths, names, reference );
+	ok &= TimeResolve( cache, "single after batch", searchPaths, names, reference );
+	cache.SetRevalidateSeconds( 0.0 );
+	ok &= TimeResolve( cache, "warm, revalidate 0", searchPaths, names, reference );
+	cache.SetRevalidateSeconds( 1.0 );
+
+	ok &= CheckInvalidation( cache, searchPaths );
+
+	RemoveTree( root, searchPaths, names );
+
+	printf( "%s\n", ok ? "PASSED" : "FAILED" );
+	return ok ? 0 : 1;
+}
+
+int main( int const argc, char const * argv[] )
+{
+	if ( argc > 1 )
+	{
+		printf( "USAGE: PathCacheBench\n" );
+		return 1;
+	}
+
+	System::Init( Log::ConfigureDefaultLog( LogMask_None ) );
+	const int result = RunBenchmark();
+	System::Destroy();
+
+	return result;
+}
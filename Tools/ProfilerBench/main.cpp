@@ -0,0 +1,294 @@
+/************************************************************************************
+
+Filename    :   main.cpp
+Content     :   Host benchmark of the overhead of ovrProfileZone and the accuracy
+				of ovrLatencyHistogram.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "Kernel/OVR_System.h"
+#include "Kernel/OVR_Alg.h"
+
+#define OVR_USE_PROFILER
+#include "OVR_Profiler.h"
+
+using namespace OVR;
+
+static const int NUM_ITERATIONS = 4000000;
+static const int UPDATE_INTERVAL = 4096;	// zones between ovrProfiler::Update calls
+static const int NUM_THREADS = 4;
+
+static volatile uint32_t Sink;
+
+static double NanosecondsPerIteration( const uint64_t start, const int iterations )
+{
+	return (double)( ovrProfileThread::GetNanoseconds() - start ) / iterations;
+}
+
+static double TimeEmptyLoop()
+{
+	const uint64_t start = ovrProfileThread::GetNanoseconds();
+	for ( int i = 0; i < NUM_ITERATIONS; i++ )
+	{
+		Sink = Sink + 1;
+	}
+	return NanosecondsPerIteration( start, NUM_ITERATIONS );
+}
+
+static double TimeClock()
+{
+	const uint64_t start = ovrProfileThread::GetNanoseconds();
+	for ( int i = 0; i < NUM_ITERATIONS; i++ )
+	{
+		Sink = Sink + (uint32_t)ovrProfileThread::GetNanoseconds();
+	}
+	return NanosecondsPerIteration( start, NUM_ITERATIONS );
+}
+
+static double TimeTicks()
+{
+	const uint64_t start = ovrProfileThread::GetNanoseconds();
+	for ( int i = 0; i < NUM_ITERATIONS; i++ )
+	{
+		Sink = Sink + (uint32_t)ovrProfileThread::GetTicks();
+	}
+	return NanosecondsPerIteration( start, NUM_ITERATIONS );
+}
+
+// One zone per iteration, including the amortized cost of draining it.
+static double TimeFlatZones()
+{
+	const uint64_t start = ovrProfileThread::GetNanoseconds();
+	for ( int i = 0; i < NUM_ITERATIONS; i++ )
+	{
+		OVR_PROFILE_ZONE( Flat );
+		Sink = Sink + 1;
+		if ( ( i & ( UPDATE_INTERVAL - 1 ) ) == 0 )
+		{
+			ovrProfiler::Update();
+		}
+	}
+	return NanosecondsPerIteration( start, NUM_ITERATIONS );
+}
+
+// Three nested zones per iteration, the middle one alternating between two
+// children, so the last child hint misses half of the time.
+static double TimeNestedZones()
+{
+	const uint64_t start = ovrProfileThread::GetNanoseconds();
+	for ( int i = 0; i < NUM_ITERATIONS; i++ )
+	{
+		OVR_PROFILE_ZONE( Outer );
+		if ( i & 1 )
+		{
+			OVR_PROFILE_ZONE( MiddleA );
+			OVR_PROFILE_ZONE( Inner );
+			Sink = Sink + 1;
+		}
+		else
+		{
+			OVR_PROFILE_ZONE( MiddleB );
+			OVR_PROFILE_ZONE( Inner );
+			Sink = Sink + 1;
+		}
+		if ( ( i & ( UPDATE_INTERVAL / 4 - 1 ) ) == 0 )
+		{
+			ovrProfiler::Update();
+		}
+	}
+	return NanosecondsPerIteration( start, NUM_ITERATIONS * 3 );
+}
+
+static const int NUM_JOBS = 400000;
+static const int JOB_WORK = 200;		// about a microsecond
+
+struct ovrWorkerResult
+{
+	bool		Profile;
+	double		NanosecondsPerJob;
+};
+
+static volatile int NumWorkersDone;
+
+// Thread CPU time, so the result doesn't depend on how many cores the threads share.
+static uint64_t GetThreadNanoseconds()
+{
+	struct timespec now;
+	clock_gettime( CLOCK_THREAD_CPUTIME_ID, &now );
+	return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+static void * WorkerThread( void * arg )
+{
+	ovrWorkerResult * result = static_cast< ovrWorkerResult * >( arg );
+	ovrProfiler::SetThreadName( "Worker" );
+
+	const uint64_t start = GetThreadNanoseconds();
+	for ( int i = 0; i < NUM_JOBS; i++ )
+	{
+		if ( result->Profile )
+		{
+			OVR_PROFILE_ZONE( Job );
+			for ( int j = 0; j < JOB_WORK; j++ )
+			{
+				Sink = Sink + j;
+			}
+		}
+		else
+		{
+			for ( int j = 0; j < JOB_WORK; j++ )
+			{
+				Sink = Sink + j;
+			}
+		}
+	}
+	result->NanosecondsPerJob = (double)( GetThreadNanoseconds() - start ) / NUM_JOBS;
+	__sync_fetch_and_add( &NumWorkersDone, 1 );
+	return nullptr;
+}
+
+// Workers record while this thread keeps draining, like the VR thread does every frame.
+// Returns the average time per job.
+static double RunThreads( const bool profile )
+{
+	NumWorkersDone = 0;
+	pthread_t threads[NUM_THREADS];
+	ovrWorkerResult results[NUM_THREADS];
+	for ( int i = 0; i < NUM_THREADS; i++ )
+	{
+		results[i].Profile = profile;
+		pthread_create( &threads[i], nullptr, WorkerThread, &results[i] );
+	}
+	while ( NumWorkersDone < NUM_THREADS )
+	{
+		ovrProfiler::Update();
+		usleep( 1000 );
+	}
+	for ( int i = 0; i < NUM_THREADS; i++ )
+	{
+		pthread_join( threads[i], nullptr );
+	}
+	ovrProfiler::Update();
+
+	double nanosecondsPerJob = 0.0;
+	for ( int i = 0; i < NUM_THREADS; i++ )
+	{
+		nanosecondsPerJob += results[i].NanosecondsPerJob / NUM_THREADS;
+	}
+	return nanosecondsPerJob;
+}
+
+// The reported percentiles must be within the bucket precision of the exact ones.
+static bool CheckHistogram()
+{
+	ovrLatencyHistogram histogram;
+	const uint32_t count = 1000000;
+	for ( uint32_t i = 1; i <= count; i++ )
+	{
+		// spread over six orders of magnitude
+		histogram.Add( ( i * 2654435761u ) % count + 1 );
+	}
+
+	const double fractions[] = { 0.5, 0.9, 0.99, 0.999 };
+	bool ok = ( histogram.GetMin() == 1 && histogram.GetMax() == count );
+	for ( int i = 0; i < (int)( sizeof( fractions ) / sizeof( fractions[0] ) ); i++ )
+	{
+		const double exact = fractions[i] * count;
+		const double reported = histogram.GetPercentile( fractions[i] );
+		const double error = fabs( reported - exact ) / exact;
+		printf( "p%-5g exact %9.0f reported %9.0f error %.2f%%\n", fractions[i] * 100.0, exact, reported, error * 100.0 );
+		ok &= ( error < 1.0 / ovrLatencyHistogram::SUB_BUCKETS );
+	}
+	return ok;
+}
+
+static bool WriteFile( const char * fileName, const StringBuffer & text )
+{
+	FILE * f = fopen( fileName, "wb" );
+	if ( f == NULL )
+	{
+		return false;
+	}
+	const bool ok = fwrite( text.ToCStr(), 1, text.GetSize(), f ) == text.GetSize();
+	fclose( f );
+	return ok;
+}
+
+static int RunBenchmark( const char * jsonFile )
+{
+	ovrProfiler::SetThreadName( "Main" );
+
+	// warm up, so the thread buffers are allocated and the zones exist
+	TimeFlatZones();
+	TimeNestedZones();
+	ovrProfiler::Reset();
+
+	const double empty = TimeEmptyLoop();
+	const double clock = TimeClock();
+	const double ticks = TimeTicks();
+	const double flat = TimeFlatZones();
+	const double nested = TimeNestedZones();
+	const double threadedBase = RunThreads( false );
+	const double threaded = RunThreads( true );
+	const uint32_t dropped = ovrProfiler::GetNumDroppedEvents();
+
+	printf( "clock_gettime        %6.1f ns\n", clock - empty );
+	printf( "counter              %6.1f ns\n", ticks - empty );
+	printf( "flat zone            %6.1f ns per zone\n", flat - empty );
+	printf( "nested zones         %6.1f ns per zone\n", nested - empty / 3.0 );
+	printf( "%d threads, 1 us jobs %6.1f ns per zone, %u events dropped\n", NUM_THREADS, threaded - threadedBase, dropped );
+
+	const bool histogramOk = CheckHistogram();
+	printf( "histogram %s\n", histogramOk ? "ok" : "WRONG" );
+
+	StringBuffer text;
+	ovrProfiler::DumpText( text );
+	printf( "%s", text.ToCStr() );
+
+	bool ok = histogramOk;
+	if ( jsonFile != NULL )
+	{
+		StringBuffer json;
+		ovrProfiler::DumpJson( json );
+		const bool written = WriteFile( jsonFile, json );
+		printf( "%s '%s'\n", written ? "Wrote" : "Failed to write", jsonFile );
+		ok &= written;
+	}
+	return ok ? 0 : 1;
+}
+
+int main( int const argc, char const * argv[] )
+{
+	const char * jsonFile = NULL;
+	for ( int i = 1; i < argc; i++ )
+	{
+		if ( strcmp( argv[i], "-json" ) == 0 && i + 1 < argc )
+		{
+			jsonFile = argv[++i];
+		}
+		else
+		{
+			printf( "USAGE: ProfilerBench [options]\n" );
+			printf( "options:\n" );
+			printf( "-json <file>  : Write the profile of the benchmark as JSON to file.\n" );
+			return 1;
+		}
+	}
+
+	System::Init( Log::ConfigureDefaultLog( LogMask_None ) );
+	const int result = RunBenchmark( jsonFile );
+	System::Destroy();
+
+	return result;
+}
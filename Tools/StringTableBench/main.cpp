@@ -0,0 +1,368 @@
+/************************************************************************************
+
+Filename    :   main.cpp
+Content     :   Host benchmark of loading and looking up strings in a compiled
+				ovrStringTable against the strings.xml path of ovrLocale, and checks
+				that both return the same strings.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Kernel/OVR_System.h"
+#include "Kernel/OVR_Std.h"
+#include "Kernel/OVR_Hash.h"
+
+#include "OVR_StringTable.h"
+#include "BenchCommon.h"
+
+using namespace OVR;
+
+static const int NUM_STRINGS = 20000;
+static const int NUM_LOAD_REPEATS = 10;
+static const int NUM_LOOKUPS = 1000000;
+
+static char const * PREFIX = "@string/";
+static const size_t PREFIX_LEN = 8;
+
+static bool ReadFile( char const * fileName, MemBufferT< uint8_t > & buffer )
+{
+	FILE * f = fopen( fileName, "rb" );
+	if ( f == NULL )
+	{
+		return false;
+	}
+	fseek( f, 0, SEEK_END );
+	const long size = ftell( f );
+	fseek( f, 0, SEEK_SET );
+	buffer.Realloc( size > 0 ? size : 0 );
+	const bool read = size <= 0 || fread( buffer, size, 1, f ) == 1;
+	fclose( f );
+	return read;
+}
+
+static bool WriteFile( char const * fileName, char const * text )
+{
+	FILE * f = fopen( fileName, "wb" );
+	if ( f == NULL )
+	{
+		return false;
+	}
+	const bool written = fwrite( text, strlen( text ), 1, f ) == 1;
+	fclose( f );
+	return written;
+}
+
+static String MakeKey( const int i )
+{
+	char s[64];
+	snprintf( s, sizeof( s ), "menu_item_%05d_label", i );
+	return String( s );
+}
+
+// Strings in the shape of the VrAppFramework strings.xml files: attributes, escapes,
+// xliff format arguments and doubled percent signs, and every 50th string a reference.
+static String MakeStringsXML( const int numStrings )
+{
+	StringBuffer xml;
+	xml.AppendString( "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+		"<resources xmlns:xliff=\"urn:oasis:names:tc:xliff:document:1.2\">\n" );
+	for ( int i = 0; i < numStrings; i++ )
+	{
+		if ( i % 50 == 49 )
+		{
+			xml.AppendFormat( "  <string name=\"%s\" project=\"vr-lib\">@string/%s</string>\n",
+					MakeKey( i ).ToCStr(), MakeKey( i / 2 ).ToCStr() );
+		}
+		else
+		{
+			xml.AppendFormat( "  <string name=\"%s\" project=\"vr-lib\" description=\"A label in a menu.\">"
+					"Item %d isn\\'t ready, <xliff:g id=\"percent\">%%1$s</xliff:g>%%%% done\\nPlease wait</string>\n",
+					MakeKey( i ).ToCStr(), i );
+		}
+	}
+	xml.AppendString( "</resources>\n" );
+	return String( xml.ToCStr() );
+}
+
+//==============================================================
+// The string path of ovrLocaleInternal in OVR_Locale.cpp, which does not build
+// on the host: the strings are decoded, inserted into a hash keyed by String
+// with the DJB2 hash, and GetString copies the key and the value into Strings.
+
+static unsigned long DJB2Hash( char const * str )
+{
+	unsigned long hash = 5381;
+	for ( int c = *str; c != 0; str++, c = *str )
+	{
+		hash = ( ( hash << 5 ) + hash ) + c;
+	}
+	return hash;
+}
+
+struct XMLHashFunctor
+{
+	UPInt operator()( const String & data ) const { return DJB2Hash( data.ToCStr() ); }
+};
+
+struct ovrXMLStrings
+{
+	Hash< String, int, XMLHashFunctor >	StringHash;
+	Array< String >						Strings;
+
+	bool Add( char const * name, MemBufferT< uint8_t > const & buffer )
+	{
+		Array< String > keys;
+		Array< String > values;
+		if ( !ovrStringTableBuilder::ParseAndroidFormatXML( name, reinterpret_cast< char const * >( static_cast< uint8_t const * >( buffer ) ),
+				buffer.GetSize(), keys, values ) )
+		{
+			return false;
+		}
+		for ( int i = 0; i < keys.GetSizeI(); i++ )
+		{
+			int index = -1;
+			if ( !StringHash.Get( keys[i], &index ) )
+			{
+				StringHash.Add( keys[i], Strings.GetSizeI() );
+				Strings.PushBack( values[i] );
+			}
+		}
+		return true;
+	}
+
+	bool GetString( char const * key, char const * defaultStr, String & out ) const
+	{
+		if ( strstr( key, PREFIX ) == key )
+		{
+			String realKey( key + PREFIX_LEN );
+			int index = -1;
+			if ( StringHash.Get( realKey, &index ) )
+			{
+				out = Strings[index];
+				return true;
+			}
+		}
+		out = defaultStr;
+		return false;
+	}
+};
+
+static bool Check( const bool condition, char const * what )
+{
+	if ( !condition )
+	{
+		printf( "FAILED: %s\n", what );
+	}
+	return condition;
+}
+
+// Every key of the XML must be found in the table with the same value, after
+// following whole value references.
+static bool CheckSame( char const * name, char const * xmlFile, char const * tableFile )
+{
+	MemBufferT< uint8_t > xml;
+	ovrXMLStrings strings;
+	ovrStringTable table;
+	if ( !ReadFile( xmlFile, xml ) || !strings.Add( xmlFile, xml ) || !table.Open( tableFile ) )
+	{
+		printf( "FAILED: %s could not be loaded\n", name );
+		return false;
+	}
+	bool ok = Check( table.GetNumStrings() == strings.Strings.GetSizeI(), "string count" );
+	for ( Hash< String, int, XMLHashFunctor >::ConstIterator it = strings.StringHash.Begin(); it != strings.StringHash.End(); ++it )
+	{
+		String const * expected = &strings.Strings[it->Second];
+		for ( int depth = 0; depth < 16 && strncmp( expected->ToCStr(), PREFIX, PREFIX_LEN ) == 0; depth++ )
+		{
+			int const * next = strings.StringHash.Get( String( expected->ToCStr() + PREFIX_LEN ) );
+			if ( next == NULL )
+			{
+				break;
+			}
+			expected = &strings.Strings[*next];
+		}
+		char const * value = table.Find( it->First.ToCStr() );
+		if ( value == NULL || strcmp( value, expected->ToCStr() ) != 0 )
+		{
+			printf( "FAILED: %s: '%s' is '%s', expected '%s'\n", name, it->First.ToCStr(), value != NULL ? value : "(null)", expected->ToCStr() );
+			return false;
+		}
+	}
+	return ok;
+}
+
+static int RunBenchmark()
+{
+	bool ok = true;
+
+	char const * xmlFile = "/tmp/StringTableBench_strings.xml";
+	char const * tableFile = "/tmp/StringTableBench_strings.bin";
+	const String xmlText = MakeStringsXML( NUM_STRINGS );
+	if ( !WriteFile( xmlFile, xmlText.ToCStr() ) )
+	{
+		printf( "Failed to write %s\n", xmlFile );
+		return 1;
+	}
+
+	// compile
+	double start = GetSeconds();
+	{
+		MemBufferT< uint8_t > xml;
+		ovrStringTableBuilder builder;
+		ok &= Check( ReadFile( xmlFile, xml ) && builder.AddAndroidFormatXML( xmlFile, reinterpret_cast< char const * >( static_cast< uint8_t * >( xml ) ), xml.GetSize() ), "parse" );
+		ok &= Check( builder.Write( tableFile ), "write" );
+	}
+	const double compileTime = GetSeconds() - start;
+
+	MemBufferT< uint8_t > fileBuffer;
+	ReadFile( tableFile, fileBuffer );
+	printf( "%d strings: strings.xml %d bytes, table %d bytes, compiled in %.1f ms\n", NUM_STRINGS,
+			(int)xmlText.GetSize(), (int)fileBuffer.GetSize(), compileTime * 1e3 );
+
+	ok &= CheckSame( "synthetic", xmlFile, tableFile );
+
+	// startup
+	double xmlLoad = 1e9;
+	double tableOpen = 1e9;
+	double tableRead = 1e9;
+	for ( int r = 0; r < NUM_LOAD_REPEATS; r++ )
+	{
+		start = GetSeconds();
+		{
+			MemBufferT< uint8_t > xml;
+			ovrXMLStrings strings;
+			ReadFile( xmlFile, xml );
+			strings.Add( xmlFile, xml );
+		}
+		xmlLoad = Alg::Min( xmlLoad, GetSeconds() - start );
+
+		start = GetSeconds();
+		{
+			ovrStringTable table;
+			table.Open( tableFile );
+		}
+		tableOpen = Alg::Min( tableOpen, GetSeconds() - start );
+
+		start = GetSeconds();
+		{
+			MemBufferT< uint8_t > buffer;
+			ovrStringTable table;
+			ReadFile( tableFile, buffer );
+			table.Load( tableFile, buffer );
+		}
+		tableRead = Alg::Min( tableRead, GetSeconds() - start );
+	}
+	printf( "Startup: strings.xml parse + hash %.2f ms, table mmap %.3f ms, table read %.3f ms\n",
+			xmlLoad * 1e3, tableOpen * 1e3, tableRead * 1e3 );
+
+	// lookups
+	MemBufferT< uint8_t > xml;
+	ReadFile( xmlFile, xml );
+	ovrXMLStrings strings;
+	strings.Add( xmlFile, xml );
+	ovrStringTable table;
+	ok &= Check( table.Open( tableFile ), "open" );
+
+	Array< String > keys;
+	keys.Resize( 4096 );
+	srand( 1 );
+	for ( int i = 0; i < keys.GetSizeI(); i++ )
+	{
+		// one key in eight is missing
+		const int index = rand() % NUM_STRINGS;
+		keys[i] = String( PREFIX ) + ( ( i % 8 ) == 7 ? MakeKey( index ) + "_missing" : MakeKey( index ) );
+	}
+
+	size_t check = 0;
+	start = GetSeconds();
+	for ( int i = 0; i < NUM_LOOKUPS; i++ )
+	{
+		String out;
+		strings.GetString( keys[i & 4095].ToCStr(), "", out );
+		check += out.GetSize();
+	}
+	const double xmlLookup = GetSeconds() - start;
+
+	size_t tableCheck = 0;
+	start = GetSeconds();
+	for ( int i = 0; i < NUM_LOOKUPS; i++ )
+	{
+		char const * value = table.Find( keys[i & 4095].ToCStr() + PREFIX_LEN );
+		tableCheck += value != NULL ? strlen( value ) : 0;
+	}
+	const double tableLookup = GetSeconds() - start;
+	printf( "Lookup: strings.xml GetString %.1f ns, table Find %.1f ns\n",
+			xmlLookup * 1e9 / NUM_LOOKUPS, tableLookup * 1e9 / NUM_LOOKUPS );
+	// the references resolve to longer values in the table
+	ok &= Check( tableCheck >= check, "lookup results" );
+
+	// edge cases
+	{
+		ovrStringTableBuilder builder;
+		builder.AddString( "a", "first" );
+		builder.AddString( "a", "second" );
+		builder.AddString( "b", "@string/a" );
+		builder.AddString( "c", "@string/d" );
+		builder.AddString( "d", "@string/c" );
+		builder.AddString( "e", "@string/missing" );
+		MemBufferT< uint8_t > buffer;
+		ok &= Check( builder.Build( buffer ), "build" );
+		MemBufferT< uint8_t > corrupt( buffer.GetSize() );
+		memcpy( corrupt, buffer, buffer.GetSize() );
+		ovrStringTable t;
+		ok &= Check( t.Load( "edge", buffer ), "load" );
+		ok &= Check( strcmp( t.Find( "a" ), "first" ) == 0, "first string wins" );
+		ok &= Check( strcmp( t.Find( "b" ), "first" ) == 0, "reference resolved" );
+		ok &= Check( strcmp( t.Find( "c" ), "@string/d" ) == 0, "circular reference left alone" );
+		ok &= Check( strcmp( t.Find( "e" ), "@string/missing" ) == 0, "missing reference left alone" );
+		ok &= Check( t.Find( "f" ) == NULL && t.Find( "" ) == NULL, "missing key" );
+
+		reinterpret_cast< ovrStringTableHeader * >( static_cast< uint8_t * >( corrupt ) )->CharSize += 64;
+		ok &= Check( !t.Load( "corrupt", corrupt ) && t.Find( "a" ) == NULL, "corrupt table rejected" );
+
+		ovrStringTableBuilder empty;
+		MemBufferT< uint8_t > emptyBuffer;
+		ok &= Check( empty.Build( emptyBuffer ) && t.Load( "empty", emptyBuffer ) && t.Find( "a" ) == NULL, "empty table" );
+	}
+
+	// the strings shipped with the framework
+	char const * frameworkXML = "../../VrAppFramework/res/values/strings.xml";
+	char const * frameworkTable = "/tmp/StringTableBench_framework.bin";
+	MemBufferT< uint8_t > frameworkBuffer;
+	if ( ReadFile( frameworkXML, frameworkBuffer ) )
+	{
+		ovrStringTableBuilder builder;
+		ok &= Check( builder.AddAndroidFormatXML( frameworkXML, reinterpret_cast< char const * >( static_cast< uint8_t * >( frameworkBuffer ) ),
+				frameworkBuffer.GetSize() ) && builder.Write( frameworkTable ), "compile framework strings" );
+		ok &= CheckSame( "framework", frameworkXML, frameworkTable );
+		remove( frameworkTable );
+	}
+
+	remove( xmlFile );
+	remove( tableFile );
+
+	printf( "%s\n", ok ? "PASSED" : "FAILED" );
+	return ok ? 0 : 1;
+}
+
+int main( int const argc, char const * argv[] )
+{
+	if ( argc > 1 )
+	{
+		printf( "USAGE: StringTableBench\n" );
+		return 1;
+	}
+
+	System::Init( Log::ConfigureDefaultLog( LogMask_None ) );
+	const int result = RunBenchmark();
+	System::Destroy();
+
+	return result;
+}
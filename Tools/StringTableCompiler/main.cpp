@@ -0,0 +1,96 @@
+/************************************************************************************
+
+Filename    :   main.cpp
+Content     :   Compiles Android strings.xml files into a string table for
+				ovrLocale::LoadStringTable.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include <stdio.h>
+
+#include "Kernel/OVR_System.h"
+#include "Kernel/OVR_Std.h"
+
+#include "OVR_StringTable.h"
+
+using namespace OVR;
+
+static bool ReadFile( char const * fileName, MemBufferT< uint8_t > & buffer )
+{
+	FILE * f = fopen( fileName, "rb" );
+	if ( f == NULL )
+	{
+		return false;
+	}
+	fseek( f, 0, SEEK_END );
+	const long size = ftell( f );
+	fseek( f, 0, SEEK_SET );
+	buffer.Realloc( size > 0 ? size : 0 );
+	const bool read = size <= 0 || fread( buffer, size, 1, f ) == 1;
+	fclose( f );
+	return read;
+}
+
+static int Compile( char const * outFile, int const numInputs, char const * const * inputs )
+{
+	// the first input has precedence, as with the locale folders passed to ovrLocale
+	ovrStringTableBuilder builder;
+	for ( int i = 0; i < numInputs; i++ )
+	{
+		MemBufferT< uint8_t > buffer;
+		if ( !ReadFile( inputs[i], buffer ) )
+		{
+			printf( "Failed to read '%s'\n", inputs[i] );
+			return 1;
+		}
+		if ( !builder.AddAndroidFormatXML( inputs[i], reinterpret_cast< char const * >( static_cast< uint8_t * >( buffer ) ), buffer.GetSize() ) )
+		{
+			printf( "Failed to parse '%s'\n", inputs[i] );
+			return 1;
+		}
+	}
+
+	if ( !builder.Write( outFile ) )
+	{
+		printf( "Failed to write '%s'\n", outFile );
+		return 1;
+	}
+
+	// load the result back and make sure every key is found
+	ovrStringTable table;
+	if ( !table.Open( outFile ) )
+	{
+		printf( "Failed to load '%s'\n", outFile );
+		return 1;
+	}
+	for ( int i = 0; i < table.GetNumStrings(); i++ )
+	{
+		if ( table.Find( table.GetKey( i ) ) != table.GetValue( i ) )
+		{
+			printf( "Key '%s' does not resolve in '%s'\n", table.GetKey( i ), outFile );
+			return 1;
+		}
+	}
+
+	printf( "Wrote %d strings to '%s'\n", table.GetNumStrings(), outFile );
+	return 0;
+}
+
+int main( int const argc, char const * argv[] )
+{
+	if ( argc < 3 )
+	{
+		printf( "USAGE: StringTableCompiler <out.bin> <strings.xml> [<strings.xml> ...]\n" );
+		return 1;
+	}
+
+	System::Init( Log::ConfigureDefaultLog( LogMask_Regular ) );
+	const int result = Compile( argv[1], argc - 2, argv + 2 );
+	System::Destroy();
+
+	return result;
+}
@@ -0,0 +1,668 @@
+/************************************************************************************
+
+Filename    :   main.cpp
+Content     :   Host benchmark of ovrSurfaceRender::RenderSurfaceList on the GL recorder.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Kernel/OVR_System.h"
+#include "Kernel/OVR_Alg.h"
+#include "SurfaceRender.h"
+#include "GlRecorder.h"
+#include "BenchCommon.h"
+
+using namespace OVR;
+
+static const char * VertexShaderSrc =
+	"in vec3 Position;\n"
+	"in vec2 TexCoord;\n"
+	"out highp vec2 oTexCoord;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_Position = TransformVertex( vec4( Position, 1.0 ) );\n"
+	"	oTexCoord = TexCoord;\n"
+	"}\n";
+
+static const char * FragmentShaderSrc =
+	"uniform sampler2D Texture0;\n"
+	"uniform lowp vec4 UniformColor;\n"
+	"uniform lowp float UniformFade;\n"
+	"in highp vec2 oTexCoord;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_FragColor = UniformColor * UniformFade * texture2D( Texture0, oTexCoord );\n"
+	"}\n";
+
+struct ovrBenchOptions
+{
+	ovrBenchOptions() :
+		NumSurfaces( 4000 ),
+		NumPrograms( 8 ),
+		NumTextures( 64 ),
+		NumGeometries( 256 ),
+		NumFrames( 200 ),
+		Sorted( false ),
+		DumpFile( NULL ),
+		GoldenFile( NULL ) {}
+
+	int				NumSurfaces;
+	int				NumPrograms;
+	int				NumTextures;
+	int				NumGeometries;
+	int				NumFrames;
+	bool			Sorted;			// sort the draw list with DrawSortKey every frame
+	const char *	DumpFile;		// write the call stream of the last frame here
+	const char *	GoldenFile;		// compare the call stream of the last frame to this file
+};
+
+struct ovrBenchSurface
+{
+	ovrSurfaceDef	SurfaceDef;
+	GlTexture		Texture;
+	Vector4f		Color;
+	float			Fade;
+};
+
+static bool WriteFile( const char * fileName, const StringBuffer & text )
+{
+	FILE * f = fopen( fileName, "wb" );
+	if ( f == NULL )
+	{
+		return false;
+	}
+	const bool ok = fwrite( text.ToCStr(), 1, text.GetSize(), f ) == text.GetSize();
+	fclose( f );
+	return ok;
+}
+
+static bool ReadFile( const char * fileName, String & text )
+{
+	FILE * f = fopen( fileName, "rb" );
+	if ( f == NULL )
+	{
+		return false;
+	}
+	StringBuffer buffer;
+	char block[4096];
+	size_t count;
+	while ( ( count = fread( block, 1, sizeof( block ), f ) ) > 0 )
+	{
+		buffer.AppendString( block, (intptr_t)count );
+	}
+	fclose( f );
+	text = buffer;
+	return true;
+}
+
+// Returns the 1-based number of the first line that differs, or 0 if the texts are equal.
+static int FirstDifferentLine( const char * a, const char * b, String & lineA, String & lineB )
+{
+	for ( int line = 1; ; line++ )
+	{
+		const char * endA = strchr( a, '\n' );
+		const char * endB = strchr( b, '\n' );
+		const size_t lengthA = endA != NULL ? (size_t)( endA - a ) : strlen( a );
+		const size_t lengthB = endB != NULL ? (size_t)( endB - b ) : strlen( b );
+		if ( lengthA != lengthB || memcmp( a, b, lengthA ) != 0 || ( endA == NULL ) != ( endB == NULL ) )
+		{
+			lineA = String( a, lengthA );
+			lineB = String( b, lengthB );
+			return line;
+		}
+		if ( endA == NULL )
+		{
+			return 0;
+		}
+		a = endA + 1;
+		b = endB + 1;
+	}
+}
+
+//==============================================================
+// Sort checks
+
+// Sorts random keys and checks that the keys come out in order, and that surfaces
+// with equal keys keep their input order. Each surface points at its own ovrSurfaceDef,
+// which gives its input index back. The buffers are reused between the sorts, like
+// they are between frames.
+static bool TestSortSurfaceList()
+{
+	static const int MAX_SURFACES = 5000;
+	Array< ovrSurfaceDef > defs;
+	defs.Resize( MAX_SURFACES );
+
+	Array< ovrDrawSurface > surfaces;
+	Array< uint64_t > keys;
+	ovrSurfaceSortBuffers buffers;
+
+	static const int counts[] = { 0, 1, 2, 3, 255, 256, 257, 4000, 5000, 100 };
+	uint32_t seed = 7;
+	bool ok = true;
+	for ( int test = 0; test < (int)( sizeof( counts ) / sizeof( counts[0] ) ) * 4; test++ )
+	{
+		const int count = counts[test / 4];
+		const int distribution = test % 4;
+
+		surfaces.Resize( count );
+		keys.Resize( count );
+		for ( int i = 0; i < count; i++ )
+		{
+			uint64_t key = 0;
+			switch ( distribution )
+			{
+				case 0:	// all bits random
+					key = ( (uint64_t)Random( seed ) << 40 ) ^ ( (uint64_t)Random( seed ) << 20 ) ^ Random( seed );
+					break;
+				case 1:	// few distinct keys, most sort as ties
+					key = (uint64_t)( Random( seed ) % 8 ) << 59;
+					break;
+				case 2:	// random digits spread over otherwise equal keys, most passes are skipped
+					key = 0x123456789ABCDEF0ull ^ ( (uint64_t)( Random( seed ) & 0xFF ) << ( ( Random( seed ) % 8 ) * 8 ) );
+					break;
+				case 3:	// all keys equal
+					key = 0xFEDCBA9876543210ull;
+					break;
+			}
+			keys[i] = key;
+			surfaces[i].surface = &defs[i];
+		}
+
+		SortSurfaceList( surfaces, keys.GetDataPtr(), buffers );
+
+		Array< bool > seen;
+		seen.Resize( count );
+		for ( int i = 0; i < count; i++ )
+		{
+			seen[i] = false;
+		}
+		for ( int i = 0; i < count && ok; i++ )
+		{
+			const int index = (int)( surfaces[i].surface - defs.GetDataPtr() );
+			if ( index < 0 || index >= count || seen[index] )
+			{
+				printf( "FAILED: SortSurfaceList %d keys, distribution %d: surface %d is not a permutation\n", count, distribution, i );
+				ok = false;
+				break;
+			}
+			seen[index] = true;
+			if ( i > 0 )
+			{
+				const int prevIndex = (int)( surfaces[i - 1].surface - defs.GetDataPtr() );
+				if ( keys[index] < keys[prevIndex] || ( keys[index] == keys[prevIndex] && index < prevIndex ) )
+				{
+					printf( "FAILED: SortSurfaceList %d keys, distribution %d: surface %d is %s\n", count, distribution, i,
+							keys[index] < keys[prevIndex] ? "out of order" : "not stable" );
+					ok = false;
+				}
+			}
+		}
+	}
+	if ( ok )
+	{
+		printf( "SortSurfaceList keeps random keys in order and ties stable\n" );
+	}
+	return ok;
+}
+
+// The keys of the sorted list must not decrease.
+static bool KeysInOrder( const Array< ovrDrawSurface > & drawSurfaces )
+{
+	uint64_t prevKey = 0;
+	for ( int i = 0; i < drawSurfaces.GetSizeI(); i++ )
+	{
+		const uint64_t key = DrawSortKey( *drawSurfaces[i].surface, -drawSurfaces[i].modelMatrix.M[2][3] );
+		if ( key < prevKey )
+		{
+			return false;
+		}
+		prevKey = key;
+	}
+	return true;
+}
+
+//==============================================================
+// Draw state checks
+
+static uint32_t HashWords( const uint32_t * words, const int numWords, uint32_t hash = 2166136261u )
+{
+	for ( int i = 0; i < numWords; i++ )
+	{
+		for ( int b = 0; b < 32; b += 8 )
+		{
+			hash = ( hash ^ ( ( words[i] >> b ) & 0xFF ) ) * 16777619u;
+		}
+	}
+	return hash;
+}
+
+// Replays a recorded frame and appends one hash per draw call of everything the draw
+// depends on: the draw arguments, the enabled caps, the fixed function state, the program
+// and the values of its uniforms, and the bound textures, uniform buffers and vertex array.
+// The blend function and equation only count while blending is enabled. The active texture
+// unit doesn't count, so a stream without redundant calls hashes the same as one that sets
+// everything again for every draw. Each frame is replayed from an empty state, so a draw
+// that relies on a value set by an earlier frame doesn't match either.
+static void HashDrawStates( const ovrGlRecorder::StreamArray & stream, Array< uint32_t > & drawHashes )
+{
+	static const int UNIFORM_GROUP = GL_CMD_MAX;
+
+	Hash< uint64_t, uint32_t > state;
+	uint32_t program = 0;
+	uint32_t textureUnit = 0;
+	drawHashes.Clear();
+
+	for ( UPInt i = 0; i < stream.GetSize(); )
+	{
+		const ovrGlCommand cmd = (ovrGlCommand)( stream[i] >> 16 );
+		const int numWords = stream[i] & 0xFFFF;
+		const uint32_t * words = &stream[i + 1];
+		i += 1 + numWords;
+
+		switch ( cmd )
+		{
+			case GL_CMD_ACTIVE_TEXTURE:
+				textureUnit = words[0] - GL_TEXTURE0;
+				break;
+			case GL_CMD_USE_PROGRAM:
+				program = words[0];
+				break;
+			case GL_CMD_BIND_TEXTURE:
+				state.Set( ovrGlRecorder::StateKey( cmd, textureUnit, words[0] ), words[1] );
+				break;
+			case GL_CMD_BIND_BUFFER_BASE:
+				state.Set( ovrGlRecorder::StateKey( cmd, words[0], words[1] ), words[2] );
+				break;
+			case GL_CMD_ENABLE:
+			case GL_CMD_DISABLE:
+				state.Set( ovrGlRecorder::StateKey( GL_CMD_ENABLE, words[0] ), cmd == GL_CMD_ENABLE ? 1 : 0 );
+				break;
+			// glBlendFunc( s, d ) sets the same state as glBlendFuncSeparate( s, d, s, d ), same for the equation
+			case GL_CMD_BLEND_FUNC:
+			{
+				const uint32_t separate[4] = { words[0], words[1], words[0], words[1] };
+				state.Set( ovrGlRecorder::StateKey( GL_CMD_BLEND_FUNC, 0 ), HashWords( separate, 4 ) );
+				break;
+			}
+			case GL_CMD_BLEND_FUNC_SEPARATE:
+				state.Set( ovrGlRecorder::StateKey( GL_CMD_BLEND_FUNC, 0 ), HashWords( words, 4 ) );
+				break;
+			case GL_CMD_BLEND_EQUATION:
+			{
+				const uint32_t separate[2] = { words[0], words[0] };
+				state.Set( ovrGlRecorder::StateKey( GL_CMD_BLEND_EQUATION, 0 ), HashWords( separate, 2 ) );
+				break;
+			}
+			case GL_CMD_BLEND_EQUATION_SEPARATE:
+				state.Set( ovrGlRecorder::StateKey( GL_CMD_BLEND_EQUATION, 0 ), HashWords( words, 2 ) );
+				break;
+			case GL_CMD_BIND_VERTEX_ARRAY:
+			case GL_CMD_COLOR_MASK:
+			case GL_CMD_CULL_FACE:
+			case GL_CMD_DEPTH_FUNC:
+			case GL_CMD_DEPTH_MASK:
+			case GL_CMD_DEPTH_RANGEF:
+			case GL_CMD_FRONT_FACE:
+			case GL_CMD_LINE_WIDTH:
+			case GL_CMD_POLYGON_OFFSET:
+				state.Set( ovrGlRecorder::StateKey( cmd, 0 ), HashWords( words, numWords ) );
+				break;
+			// Only the values are hashed, so glUniform1i( loc, v ) and glUniform1iv( loc, 1, &v ) set the same value.
+			case GL_CMD_UNIFORM_1F:
+			case GL_CMD_UNIFORM_1I:
+				if ( (GLint)words[0] >= 0 )
+				{
+					state.Set( ovrGlRecorder::StateKey( UNIFORM_GROUP, program, words[0] ), HashWords( words + 1, numWords - 1 ) );
+				}
+				break;
+			case GL_CMD_UNIFORM_FV:
+			case GL_CMD_UNIFORM_IV:
+				if ( (GLint)words[1] >= 0 )
+				{
+					state.Set( ovrGlRecorder::StateKey( UNIFORM_GROUP, program, words[1] ), HashWords( words + 3, numWords - 3 ) );
+				}
+				break;
+			case GL_CMD_UNIFORM_MATRIX_4FV:
+				if ( (GLint)words[0] >= 0 )
+				{
+					// hash the matrices the way the program sees them
+					const int numMatrices = ( numWords - 3 ) / 16;
+					uint32_t hash = HashWords( NULL, 0 );
+					for ( int m = 0; m < numMatrices; m++ )
+					{
+						uint32_t matrix[16];
+						for ( int e = 0; e < 16; e++ )
+						{
+							matrix[e] = words[3 + m * 16 + ( words[2] ? ( e % 4 ) * 4 + e / 4 : e )];
+						}
+						hash = HashWords( matrix, 16, hash );
+					}
+					state.Set( ovrGlRecorder::StateKey( UNIFORM_GROUP, program, words[0] ), hash );
+				}
+				break;
+			case GL_CMD_DRAW_ARRAYS:
+			case GL_CMD_DRAW_ELEMENTS:
+			case GL_CMD_DRAW_ELEMENTS_INSTANCED:
+			{
+				const uint32_t * blend = state.Get( ovrGlRecorder::StateKey( GL_CMD_ENABLE, GL_BLEND ) );
+				const bool blendEnabled = ( blend != NULL && *blend != 0 );
+				const uint32_t header[2] = { (uint32_t)cmd, program };
+				uint32_t hash = HashWords( words, numWords, HashWords( header, 2 ) );
+				for ( Hash< uint64_t, uint32_t >::ConstIterator it = state.Begin(); it != state.End(); ++it )
+				{
+					const int group = (int)( it->First >> 56 );
+					if ( group == UNIFORM_GROUP && (uint32_t)( ( it->First >> 32 ) & 0xFFFFFF ) != ( program & 0xFFFFFF ) )
+					{
+						continue;	// uniforms of other programs
+					}
+					if ( !blendEnabled && ( group == GL_CMD_BLEND_FUNC || group == GL_CMD_BLEND_EQUATION ) )
+					{
+						continue;
+					}
+					// the hash table order depends on the order the state was set, so the entries are added up
+					const uint32_t entry[3] = { (uint32_t)( it->First >> 32 ), (uint32_t)it->First, it->Second };
+					hash += HashWords( entry, 3 );
+				}
+				drawHashes.PushBack( hash );
+				break;
+			}
+			default:
+				break;
+		}
+	}
+}
+
+// Renders the surfaces with and without the redundant call filtering and checks
+// that every draw call sees the same state.
+static bool TestFilteredDraws( ovrGlRecorder & recorder, ovrSurfaceRender & surfaceRender, const Array< ovrDrawSurface > & drawSurfaces,
+		const Matrix4f & viewMatrix, const Matrix4f & projectionMatrix )
+{
+	// a frame with another view first, so the filtered frame can't use values from a previous frame by accident
+	surfaceRender.RenderSurfaceList( drawSurfaces, viewMatrix * Matrix4f::Translation( 1.0f, 0.0f, 0.0f ), projectionMatrix );
+
+	recorder.Clear();
+	surfaceRender.RenderSurfaceList( drawSurfaces, viewMatrix, projectionMatrix );
+	const int filteredCalls = recorder.GetNumCommands();
+	Array< uint32_t > filtered;
+	HashDrawStates( recorder.GetStream(), filtered );
+
+	recorder.Clear();
+	surfaceRender.SetFilterRedundantCalls( false );
+	const ovrDrawCounters counters = surfaceRender.RenderSurfaceList( drawSurfaces, viewMatrix, projectionMatrix );
+	surfaceRender.SetFilterRedundantCalls( true );
+	const int unfilteredCalls = recorder.GetNumCommands();
+	Array< uint32_t > unfiltered;
+	HashDrawStates( recorder.GetStream(), unfiltered );
+
+	if ( counters.numUniformsSkipped != 0 )
+	{
+		printf( "FAILED: %d uniforms skipped with the filtering off\n", counters.numUniformsSkipped );
+		return false;
+	}
+
+	if ( filtered.GetSizeI() != unfiltered.GetSizeI() || filtered.GetSizeI() != drawSurfaces.GetSizeI() )
+	{
+		printf( "FAILED: %d filtered and %d unfiltered draws for %d surfaces\n", filtered.GetSizeI(), unfiltered.GetSizeI(), drawSurfaces.GetSizeI() );
+		return false;
+	}
+	for ( int i = 0; i < filtered.GetSizeI(); i++ )
+	{
+		if ( filtered[i] != unfiltered[i] )
+		{
+			printf( "FAILED: filtered draw %d ('%s') sees a different GL state than unfiltered\n", i, drawSurfaces[i].surface->surfaceName.ToCStr() );
+			return false;
+		}
+	}
+	printf( "filtered draws match unfiltered, %d GL calls instead of %d\n", filteredCalls, unfilteredCalls );
+	return true;
+}
+
+static int RunBenchmark( const ovrBenchOptions & options )
+{
+	ovrGlRecorder recorder;
+	recorder.Install();
+
+	ovrSurfaceRender surfaceRender;
+	surfaceRender.Init();
+
+	static ovrProgramParm parms[] =
+	{
+		{ "Texture0",		ovrProgramParmType::TEXTURE_SAMPLED },
+		{ "UniformColor",	ovrProgramParmType::FLOAT_VECTOR4 },
+		{ "UniformFade",	ovrProgramParmType::FLOAT },
+	};
+
+	Array< GlProgram > programs;
+	programs.Resize( options.NumPrograms );
+	for ( int i = 0; i < options.NumPrograms; i++ )
+	{
+		programs[i] = GlProgram::Build( VertexShaderSrc, FragmentShaderSrc, parms, sizeof( parms ) / sizeof( parms[0] ) );
+	}
+
+	Array< GLuint > textures;
+	textures.Resize( options.NumTextures );
+	glGenTextures( options.NumTextures, textures.GetDataPtr() );
+
+	Array< GLuint > geometries;
+	geometries.Resize( options.NumGeometries );
+	glGenVertexArrays( options.NumGeometries, geometries.GetDataPtr() );
+
+	uint32_t seed = 1;
+	Array< ovrBenchSurface > surfaces;
+	surfaces.Resize( options.NumSurfaces );
+	Array< ovrDrawSurface > drawSurfaces;
+	drawSurfaces.Resize( options.NumSurfaces );
+	for ( int i = 0; i < options.NumSurfaces; i++ )
+	{
+		ovrBenchSurface & surface = surfaces[i];
+		surface.Texture = GlTexture( textures[Random( seed ) % options.NumTextures], GL_TEXTURE_2D, 256, 256 );
+		surface.Color = Vector4f( 1.0f, 1.0f, 1.0f, ( Random( seed ) % 4 ) * 0.25f + 0.25f );
+		surface.Fade = 1.0f;
+
+		ovrSurfaceDef & def = surface.SurfaceDef;
+		def.surfaceName = String::Format( "surface%d", i );
+		def.geo.vertexArrayObject = geometries[Random( seed ) % options.NumGeometries];
+		def.geo.indexCount = 6 * ( 1 + Random( seed ) % 64 );
+
+		ovrGraphicsCommand & cmd = def.graphicsCommand;
+		cmd.Program = programs[Random( seed ) % options.NumPrograms];
+		cmd.UniformData[0].Data = &surface.Texture;
+		cmd.UniformData[1].Data = &surface.Color;
+		cmd.UniformData[2].Data = &surface.Fade;
+		if ( surface.Color.w < 1.0f )
+		{
+			// additive, premultiplied and alpha blending, so the blend function changes too
+			cmd.GpuState.blendEnable = ovrGpuState::BLEND_ENABLE;
+			cmd.GpuState.blendSrc = ( surface.Color.w == 0.5f ) ? GL_ONE : GL_SRC_ALPHA;
+			cmd.GpuState.blendDst = ( surface.Color.w == 0.25f ) ? GL_ONE : GL_ONE_MINUS_SRC_ALPHA;
+			cmd.GpuState.depthMaskEnable = false;
+		}
+
+		// some noise in the depth so surfaces don't tie
+		const float viewDepth = 10.0f + ( Random( seed ) % 1024 ) * ( 1.0f / 256.0f );
+		drawSurfaces[i].modelMatrix = Matrix4f::Translation( (float)( i % 64 ), (float)( i / 64 ), -viewDepth );
+		drawSurfaces[i].surface = &def;
+	}
+
+	const Array< ovrDrawSurface > unsortedSurfaces = drawSurfaces;
+	Array< uint64_t > sortKeys;
+	sortKeys.Resize( options.NumSurfaces );
+	ovrSurfaceSortBuffers sortBuffers;
+
+	const Matrix4f viewMatrix = Matrix4f::LookAtRH( Vector3f( 0.0f, 0.0f, 0.0f ), Vector3f( 0.0f, 0.0f, -1.0f ), Vector3f( 0.0f, 1.0f, 0.0f ) );
+	const Matrix4f projectionMatrix = Matrix4f::PerspectiveRH( DegreeToRad( 90.0f ), 1.0f, 0.1f, 100.0f );
+
+	ovrDrawCounters counters;
+	double totalSeconds = 0.0;
+	double bestSeconds = 1e9;
+	double bestSortSeconds = 1e9;
+	bool sortedOk = true;
+	for ( int frame = 0; frame < options.NumFrames; frame++ )
+	{
+		if ( options.Sorted )
+		{
+			// sort the same input every frame, like BuildModelSurfaceList does
+			const double sortStart = GetSeconds();
+			drawSurfaces = unsortedSurfaces;
+			for ( int i = 0; i < options.NumSurfaces; i++ )
+			{
+				sortKeys[i] = DrawSortKey( *drawSurfaces[i].surface, -drawSurfaces[i].modelMatrix.M[2][3] );
+			}
+			SortSurfaceList( drawSurfaces, sortKeys.GetDataPtr(), sortBuffers );
+			bestSortSeconds = Alg::Min( bestSortSeconds, GetSeconds() - sortStart );
+
+			sortedOk &= KeysInOrder( drawSurfaces );
+		}
+
+		recorder.Clear();
+
+		// move the view a little every frame so the scene matrices are updated
+		const Matrix4f frameView = viewMatrix * Matrix4f::Translation( 0.0f, 0.0f, frame * 0.001f );
+
+		const double start = GetSeconds();
+		counters = surfaceRender.RenderSurfaceList( drawSurfaces, frameView, projectionMatrix );
+		const double seconds = GetSeconds() - start;
+
+		totalSeconds += seconds;
+		bestSeconds = Alg::Min( bestSeconds, seconds );
+	}
+
+	printf( "%d surfaces, %d programs, %d textures, %d frames%s\n", options.NumSurfaces, options.NumPrograms,
+			options.NumTextures, options.NumFrames, options.Sorted ? ", sorted" : "" );
+	if ( options.Sorted )
+	{
+		printf( "DrawSortKey + SortSurfaceList: %.3f ms best\n", bestSortSeconds * 1e3 );
+	}
+	printf( "RenderSurfaceList: %.3f ms average, %.3f ms best, %.1f ns per surface\n",
+			totalSeconds * 1e3 / options.NumFrames, bestSeconds * 1e3, bestSeconds * 1e9 / options.NumSurfaces );
+	printf( "draw calls %d, program binds %d, texture binds %d, buffer binds %d, parameter updates %d\n",
+			counters.numDrawCalls, counters.numProgramBinds, counters.numTextureBinds,
+			counters.numBufferBinds, counters.numParameterUpdates );
+	printf( "uniforms skipped %d, binds skipped %d\n", counters.numUniformsSkipped, counters.numBindsSkipped );
+	printf( "GL calls per frame %d, state changes %d, redundant %d, stream %d words, hash %08x\n",
+			recorder.GetNumCommands(), recorder.GetNumStateChanges(), recorder.GetNumRedundantCalls(),
+			recorder.GetStream().GetSizeI(), recorder.GetStreamHash() );
+
+	StringBuffer counts;
+	recorder.DumpCounts( counts );
+	printf( "%s", counts.ToCStr() );
+
+	bool ok = sortedOk;
+	if ( !sortedOk )
+	{
+		printf( "FAILED: the sorted surfaces are not in key order\n" );
+	}
+	if ( options.DumpFile != NULL )
+	{
+		StringBuffer dump;
+		recorder.DumpCommands( dump );
+		ok = WriteFile( options.DumpFile, dump );
+		printf( "%s '%s'\n", ok ? "Wrote" : "Failed to write", options.DumpFile );
+	}
+
+	if ( options.GoldenFile != NULL )
+	{
+		// Any change to the emitted calls, their order or their arguments shows up
+		// here. If the change is intended, regenerate the file with "make golden".
+		StringBuffer dump;
+		recorder.DumpCommands( dump );
+		String golden;
+		if ( !ReadFile( options.GoldenFile, golden ) )
+		{
+			printf( "Failed to read '%s'\n", options.GoldenFile );
+			ok = false;
+		}
+		else
+		{
+			String goldenLine;
+			String dumpLine;
+			const int line = FirstDifferentLine( golden.ToCStr(), dump.ToCStr(), goldenLine, dumpLine );
+			if ( line != 0 )
+			{
+				printf( "GL calls differ from '%s' at line %d:\n", options.GoldenFile, line );
+				printf( "  expected: %s\n", goldenLine.ToCStr() );
+				printf( "  recorded: %s\n", dumpLine.ToCStr() );
+				ok = false;
+			}
+		}
+	}
+
+	// after the golden comparison, these render more frames
+	ok &= TestFilteredDraws( recorder, surfaceRender, drawSurfaces, viewMatrix, projectionMatrix );
+	ok &= TestSortSurfaceList();
+
+	printf( "%s\n", ok ? "PASSED" : "FAILED" );
+
+	for ( int i = 0; i < programs.GetSizeI(); i++ )
+	{
+		GlProgram::Free( programs[i] );
+	}
+	surfaceRender.Shutdown();
+	recorder.Uninstall();
+
+	return ok ? 0 : 1;
+}
+
+int main( int const argc, char const * argv[] )
+{
+	ovrBenchOptions options;
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		const bool hasValue = ( i + 1 < argc );
+		if ( strcmp( argv[i], "-surfaces" ) == 0 && hasValue )
+		{
+			options.NumSurfaces = Alg::Max( 1, atoi( argv[++i] ) );
+		}
+		else if ( strcmp( argv[i], "-programs" ) == 0 && hasValue )
+		{
+			options.NumPrograms = Alg::Max( 1, atoi( argv[++i] ) );
+		}
+		else if ( strcmp( argv[i], "-textures" ) == 0 && hasValue )
+		{
+			options.NumTextures = Alg::Max( 1, atoi( argv[++i] ) );
+		}
+		else if ( strcmp( argv[i], "-frames" ) == 0 && hasValue )
+		{
+			options.NumFrames = Alg::Max( 1, atoi( argv[++i] ) );
+		}
+		else if ( strcmp( argv[i], "-sorted" ) == 0 )
+		{
+			options.Sorted = true;
+		}
+		else if ( strcmp( argv[i], "-dump" ) == 0 && hasValue )
+		{
+			options.DumpFile = argv[++i];
+		}
+		else if ( strcmp( argv[i], "-golden" ) == 0 && hasValue )
+		{
+			options.GoldenFile = argv[++i];
+		}
+		else
+		{
+			printf( "USAGE: SurfaceRenderBench [options]\n" );
+			printf( "options:\n" );
+			printf( "-surfaces <n> : Number of surfaces drawn per frame (default 4000).\n" );
+			printf( "-programs <n> : Number of distinct programs (default 8).\n" );
+			printf( "-textures <n> : Number of distinct textures (default 64).\n" );
+			printf( "-frames <n>   : Number of frames to time (default 200).\n" );
+			printf( "-sorted       : Sort the surfaces with DrawSortKey every frame.\n" );
+			printf( "-dump <file>  : Write the GL calls of the last frame to file, for diffing.\n" );
+			printf( "-golden <file>: Exit with an error if the GL calls of the last frame differ from file.\n" );
+			return 1;
+		}
+	}
+
+	System::Init( Log::ConfigureDefaultLog( LogMask_None ) );
+	const int result = RunBenchmark( options );
+	System::Destroy();
+
+	return result;
+}
@@ -0,0 +1,528 @@
+/************************************************************************************
+
+Filename    :   main.cpp
+Content     :   Host test of ovrTextureLoader on the GL recorder: decodes posters and
+				thumbnails on the worker pool, uploads them with a per-frame budget,
+				and compares the decode throughput with decoding on one thread.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "Kernel/OVR_System.h"
+#include "Kernel/OVR_Alg.h"
+#include "Kernel/OVR_Std.h"
+#include "Kernel/OVR_MemBuffer.h"
+#include "GlTexture.h"
+#include "GlRecorder.h"
+#include "OVR_TextureLoader.h"
+#include "stb_image_write.h"
+#include "BenchCommon.h"
+
+using namespace OVR;
+
+// The loader times its uploads with the VrApi clock.
+extern "C" double vrapi_GetTimeInSeconds()
+{
+	return GetSeconds();
+}
+
+struct ovrBenchOptions
+{
+	ovrBenchOptions() :
+		NumPosters( 200 ),
+		NumThumbnails( 200 ),
+		FrameSeconds( 1.0 / 60.0 ),
+		UploadBudgetSeconds( 0.002 ) {}
+
+	int		NumPosters;
+	int		NumThumbnails;
+	double	FrameSeconds;
+	double	UploadBudgetSeconds;
+};
+
+static const int POSTER_WIDTH = 228;
+static const int POSTER_HEIGHT = 344;
+static const int THUMB_SIZE = 256;
+
+static const char * TextureTempName = "/tmp/TextureLoaderBench.ktx";
+static const char * PosterTempName = "/tmp/TextureLoaderBench.png";
+
+static void AppendToArray( void * context, void * data, int size )
+{
+	Array< uint8_t > & out = *static_cast< Array< uint8_t > * >( context );
+	out.Append( static_cast< uint8_t * >( data ), size );
+}
+
+// A poster like the ones Cinema generates: a photo-like gradient with noise, so
+// the PNG doesn't compress to nothing.
+static void BuildPoster( const int index, const int width, const int height, Array< uint8_t > & png )
+{
+	uint32_t seed = index + 1;
+	Array< uint8_t > pixels;
+	pixels.Resize( width * height * 4 );
+	for ( int y = 0; y < height; y++ )
+	{
+		for ( int x = 0; x < width; x++ )
+		{
+			uint8_t * p = &pixels[( y * width + x ) * 4];
+			const int noise = Random( seed ) & 15;
+			p[0] = (uint8_t)( ( x * 255 / width + index * 7 + noise ) & 255 );
+			p[1] = (uint8_t)( ( y * 255 / height + noise ) & 255 );
+			p[2] = (uint8_t)( ( ( x + y ) * 3 + index * 13 ) & 255 );
+			p[3] = 255;
+		}
+	}
+	png.Resize( 0 );
+	stbi_write_png_to_func( AppendToArray, &png, width, height, 4, pixels.GetDataPtr(), width * 4 );
+}
+
+// A cached folder browser thumbnail: ETC2 RGBA with a full mip chain.
+static void BuildThumbnail( Array< uint8_t > & ktx )
+{
+	size_t dataSize = 0;
+	int mipCount = 0;
+	for ( int w = THUMB_SIZE; ; w >>= 1 )
+	{
+		dataSize += GetOvrTextureSize( Texture_ETC2_RGBA, w, w );
+		mipCount++;
+		if ( w == 1 )
+		{
+			break;
+		}
+	}
+
+	ovrTextureImage image;
+	image.Format = Texture_ETC2_RGBA;
+	image.Width = THUMB_SIZE;
+	image.Height = THUMB_SIZE;
+	image.MipCount = mipCount;
+	image.NumFaces = 1;
+	image.UseSrgbFormat = true;
+	image.OwnedData = (uint8_t *)calloc( dataSize, 1 );
+	image.Data = image.OwnedData;
+	image.DataSize = dataSize;
+	if ( !WriteTextureKTX( TextureTempName, image ) )
+	{
+		printf( "failed to write %s\n", TextureTempName );
+		exit( 1 );
+	}
+	MemBufferFile file( TextureTempName );
+	ktx.Resize( 0 );
+	ktx.Append( (const uint8_t *)file.Buffer, file.Length );
+	remove( TextureTempName );
+}
+
+struct ovrBenchSource
+{
+	String				Name;
+	Array< uint8_t >	File;
+	int					Width;
+	int					Height;
+};
+
+static void BuildSources( const ovrBenchOptions & options, Array< ovrBenchSource > & sources )
+{
+	Array< uint8_t > thumbnail;
+	BuildThumbnail( thumbnail );
+
+	// interleaved, like a folder of posters with cached thumbnails
+	for ( int i = 0; i < Alg::Max( options.NumPosters, options.NumThumbnails ); i++ )
+	{
+		char name[64];
+		if ( i < options.NumPosters )
+		{
+			ovrBenchSource & source = sources.PushDefault();
+			OVR_sprintf( name, sizeof( name ), "poster%04d.png", i );
+			source.Name = name;
+			BuildPoster( i, POSTER_WIDTH, POSTER_HEIGHT, source.File );
+			source.Width = POSTER_WIDTH;
+			source.Height = POSTER_HEIGHT;
+		}
+		if ( i < options.NumThumbnails )
+		{
+			ovrBenchSource & source = sources.PushDefault();
+			OVR_sprintf( name, sizeof( name ), "thumb%04d.ktx", i );
+			source.Name = name;
+			source.File = thumbnail;
+			source.Width = THUMB_SIZE;
+			source.Height = THUMB_SIZE;
+		}
+	}
+}
+
+static void CopyFile( const ovrBenchSource & source, MemBufferT< uint8_t > & out )
+{
+	MemBufferT< uint8_t > buffer( source.File.GetSize() );
+	memcpy( buffer, source.File.GetDataPtr(), source.File.GetSize() );
+	out = buffer;	// takes the allocation
+}
+
+static int CountCommands( const ovrGlRecorder & recorder, const ovrGlCommand cmd )
+{
+	int count = 0;
+	const ovrGlRecorder::StreamArray & stream = recorder.GetStream();
+	for ( UPInt i = 0; i < stream.GetSize(); i += 1 + ( stream[i] & 0xFFFF ) )
+	{
+		if ( (ovrGlCommand)( stream[i] >> 16 ) == cmd )
+		{
+			count++;
+		}
+	}
+	return count;
+}
+
+// Decodes everything on the calling thread, the way the callers did before.
+static double RunSerial( const Array< ovrBenchSource > & sources )
+{
+	const double start = GetSeconds();
+	for ( int i = 0; i < sources.GetSizeI(); i++ )
+	{
+		const MemBuffer buffer( sources[i].File.GetDataPtr(), sources[i].File.GetSizeI() );
+		ovrTextureImage image;
+		DecodeTextureBuffer( sources[i].Name.ToCStr(), buffer, TextureFlags_t( TEXTUREFLAG_NO_DEFAULT ), true, image );
+	}
+	return GetSeconds() - start;
+}
+
+struct ovrLoaderResult
+{
+	ovrLoaderResult() : Seconds( 0.0 ), MaxUpdateSeconds( 0.0 ), MaxUpdateCpuSeconds( 0.0 ), NumFrames( 0 ) {}
+
+	double	Seconds;
+	double	MaxUpdateSeconds;
+	double	MaxUpdateCpuSeconds;	// without the time the workers preempted it
+	int		NumFrames;
+};
+
+// Requests every texture at once and runs frames until all of them are uploaded.
+// Every other request is freed right away if cancelHalf is set.
+// With paced set every frame lasts options.FrameSeconds, otherwise the updates run back to back.
+static bool RunLoader( const ovrBenchOptions & options, ovrGlRecorder & recorder, const Array< ovrBenchSource > & sources,
+		const int numThreads, const bool paced, const bool cancelHalf, ovrLoaderResult & result )
+{
+	bool ok = true;
+
+	ovrTextureLoader * loader = ovrTextureLoader::Create( numThreads );
+
+	// copied up front so that only the loader is timed
+	MemBufferT< uint8_t > * buffers = new MemBufferT< uint8_t >[sources.GetSize()];
+	for ( int i = 0; i < sources.GetSizeI(); i++ )
+	{
+		CopyFile( sources[i], buffers[i] );
+	}
+
+	recorder.Clear();
+	const double start = GetSeconds();
+	Array< asyncTextureHandle_t > requests;
+	for ( int i = 0; i < sources.GetSizeI(); i++ )
+	{
+		requests.PushBack( loader->LoadTextureFromBuffer( sources[i].Name.ToCStr(), buffers[i], TextureFlags_t( TEXTUREFLAG_NO_DEFAULT ) ) );
+	}
+	// freed slots are reused by the next request, so free only after everything is queued
+	for ( int i = 1; cancelHalf && i < sources.GetSizeI(); i += 2 )
+	{
+		loader->FreeRequest( requests[i] );
+	}
+
+	while ( loader->GetNumPending() > 0 )
+	{
+		const double frameStart = GetSeconds();
+		const double cpuStart = GetThreadSeconds();
+		loader->Update( options.UploadBudgetSeconds );
+		result.MaxUpdateCpuSeconds = Alg::Max( result.MaxUpdateCpuSeconds, GetThreadSeconds() - cpuStart );
+		result.MaxUpdateSeconds = Alg::Max( result.MaxUpdateSeconds, GetSeconds() - frameStart );
+		result.NumFrames++;
+
+		// the rest of the frame is spent elsewhere
+		const double sleepSeconds = options.FrameSeconds - ( GetSeconds() - frameStart );
+		if ( paced && sleepSeconds > 0.0 )
+		{
+			usleep( (useconds_t)( sleepSeconds * 1e6 ) );
+		}
+		else if ( !paced )
+		{
+			usleep( 100 );	// don't keep a core away from the workers
+		}
+	}
+	result.Seconds = GetSeconds() - start;
+
+	int numReady = 0;
+	for ( int i = 0; i < sources.GetSizeI(); i++ )
+	{
+		if ( cancelHalf && ( i & 1 ) != 0 )
+		{
+			if ( loader->GetState( requests[i] ) != ASYNC_TEXTURE_INVALID )
+			{
+				printf( "%s was freed but is still valid\n", sources[i].Name.ToCStr() );
+				ok = false;
+			}
+			continue;
+		}
+		if ( loader->GetState( requests[i] ) != ASYNC_TEXTURE_READY )
+		{
+			printf( "%s did not load\n", sources[i].Name.ToCStr() );
+			ok = false;
+			continue;
+		}
+		GlTexture texture = loader->GetTexture( requests[i] );
+		if ( texture.Width != sources[i].Width || texture.Height != sources[i].Height )
+		{
+			printf( "%s is %dx%d, expected %dx%d\n", sources[i].Name.ToCStr(), texture.Width, texture.Height,
+					sources[i].Width, sources[i].Height );
+			ok = false;
+		}
+		numReady++;
+		DeleteTexture( texture );
+		loader->FreeRequest( requests[i] );
+	}
+
+	const int expected = cancelHalf ? ( sources.GetSizeI() + 1 ) / 2 : sources.GetSizeI();
+	const int numUploads = CountCommands( recorder, GL_CMD_GEN_TEXTURES ) - numReady;	// every texture was deleted once
+	if ( numReady != expected || CountCommands( recorder, GL_CMD_DELETE_TEXTURES ) != numReady || numUploads != 0 )
+	{
+		printf( "%d textures ready, %d uploads, expected %d\n", numReady, numReady + numUploads, expected );
+		ok = false;
+	}
+
+	ovrTextureLoader::Destroy( loader );
+	delete [] buffers;
+	return ok;
+}
+
+// The other ways in: a file path, an image decoded elsewhere and a file that doesn't decode.
+static bool RunRequestKinds( const ovrBenchOptions & options, const Array< ovrBenchSource > & sources )
+{
+	bool ok = true;
+
+	FILE * f = fopen( PosterTempName, "wb" );
+	if ( f == NULL || fwrite( sources[0].File.GetDataPtr(), 1, sources[0].File.GetSize(), f ) != sources[0].File.GetSize() )
+	{
+		printf( "failed to write %s\n", PosterTempName );
+		exit( 1 );
+	}
+	fclose( f );
+
+	ovrTextureLoader * loader = ovrTextureLoader::Create( 1 );
+
+	const asyncTextureHandle_t fromFile = loader->LoadTextureFromFile( PosterTempName, TextureFlags_t( TEXTUREFLAG_NO_DEFAULT ) );
+	const asyncTextureHandle_t missing = loader->LoadTextureFromFile( "/tmp/TextureLoaderBench.missing.png", TextureFlags_t( TEXTUREFLAG_NO_DEFAULT ) );
+
+	MemBufferT< uint8_t > corrupt( 64 );
+	memset( corrupt, 0x5A, 64 );
+	const asyncTextureHandle_t broken = loader->LoadTextureFromBuffer( "broken.png", corrupt, TextureFlags_t( TEXTUREFLAG_NO_DEFAULT ) );
+
+	ovrTextureImage image;
+	image.Format = Texture_RGBA;
+	image.Width = 64;
+	image.Height = 32;
+	image.MipCount = 1;
+	image.DataSize = 64 * 32 * 4;
+	image.OwnedData = (uint8_t *)calloc( image.DataSize, 1 );
+	image.Data = image.OwnedData;
+	const asyncTextureHandle_t fromImage = loader->LoadTextureFromImage( "image", image );
+	if ( image.OwnedData != NULL )
+	{
+		printf( "LoadTextureFromImage did not take the image data\n" );
+		ok = false;
+	}
+
+	// the decoded image needs no worker, so it is uploaded by the first update
+	loader->Update( options.UploadBudgetSeconds );
+	if ( loader->GetState( fromImage ) != ASYNC_TEXTURE_READY || loader->GetTexture( fromImage ).Width != 64 )
+	{
+		printf( "the decoded image was not uploaded by the first update\n" );
+		ok = false;
+	}
+	while ( loader->GetNumPending() > 0 )
+	{
+		usleep( 1000 );
+		loader->Update( options.UploadBudgetSeconds );
+	}
+
+	if ( loader->GetState( fromFile ) != ASYNC_TEXTURE_READY || loader->GetTexture( fromFile ).Width != POSTER_WIDTH )
+	{
+		printf( "%s did not load\n", PosterTempName );
+		ok = false;
+	}
+	if ( loader->GetState( missing ) != ASYNC_TEXTURE_FAILED || loader->GetState( broken ) != ASYNC_TEXTURE_FAILED )
+	{
+		printf( "a missing or corrupt file did not fail\n" );
+		ok = false;
+	}
+	if ( loader->GetTexture( broken ).texture != loader->GetTexture( missing ).texture )
+	{
+		printf( "failed loads don't share the placeholder\n" );
+		ok = false;
+	}
+
+	const asyncTextureHandle_t uploaded[2] = { fromFile, fromImage };
+	for ( int i = 0; i < 2; i++ )
+	{
+		GlTexture texture = loader->GetTexture( uploaded[i] );
+		DeleteTexture( texture );
+	}
+	ovrTextureLoader::Destroy( loader );
+	remove( PosterTempName );
+
+	printf( "requests: file, missing file, corrupt buffer and decoded image %s\n", ok ? "ok" : "FAILED" );
+	return ok;
+}
+
+// A request made while a worker is free starts right away instead of waiting for
+// the earlier ones, and a freed handle stays invalid after its slot is reused.
+static bool RunHandles( const ovrBenchOptions & options, const Array< ovrBenchSource > & sources )
+{
+	bool ok = true;
+
+	ovrTextureLoader * loader = ovrTextureLoader::Create( 2 );
+
+	const ovrBenchSource & small = sources.Back();
+	ovrBenchSource large;
+	large.Name = "large.png";
+	large.Width = 2048;
+	large.Height = 2048;
+	BuildPoster( 0, large.Width, large.Height, large.File );
+
+	MemBufferT< uint8_t > buffer;
+	CopyFile( large, buffer );
+	const asyncTextureHandle_t slow = loader->LoadTextureFromBuffer( large.Name.ToCStr(), buffer, TextureFlags_t( TEXTUREFLAG_NO_DEFAULT ) );
+	loader->Update( options.UploadBudgetSeconds );
+	CopyFile( small, buffer );
+	const asyncTextureHandle_t fast = loader->LoadTextureFromBuffer( small.Name.ToCStr(), buffer, TextureFlags_t( TEXTUREFLAG_NO_DEFAULT ) );
+	while ( loader->GetState( fast ) == ASYNC_TEXTURE_PENDING )
+	{
+		usleep( 1000 );
+		loader->Update( options.UploadBudgetSeconds );
+	}
+	if ( loader->GetState( fast ) != ASYNC_TEXTURE_READY || loader->GetState( slow ) != ASYNC_TEXTURE_PENDING )
+	{
+		printf( "%s waited for %s\n", small.Name.ToCStr(), large.Name.ToCStr() );
+		ok = false;
+	}
+	GlTexture texture = loader->GetTexture( fast );
+	DeleteTexture( texture );
+
+	// the new request takes the freed slot
+	loader->FreeRequest( fast );
+	CopyFile( small, buffer );
+	const asyncTextureHandle_t reused = loader->LoadTextureFromBuffer( small.Name.ToCStr(), buffer, TextureFlags_t( TEXTUREFLAG_NO_DEFAULT ) );
+	if ( reused.Get() == fast.Get() || loader->GetState( fast ) != ASYNC_TEXTURE_INVALID )
+	{
+		printf( "a freed handle refers to the next request\n" );
+		ok = false;
+	}
+	loader->FreeRequest( fast );
+	if ( loader->GetState( reused ) != ASYNC_TEXTURE_PENDING )
+	{
+		printf( "freeing a stale handle freed the next request\n" );
+		ok = false;
+	}
+
+	while ( loader->GetNumPending() > 0 )
+	{
+		usleep( 1000 );
+		loader->Update( options.UploadBudgetSeconds );
+	}
+	if ( loader->GetState( slow ) != ASYNC_TEXTURE_READY || loader->GetState( reused ) != ASYNC_TEXTURE_READY )
+	{
+		printf( "%s or the reused request did not load\n", large.Name.ToCStr() );
+		ok = false;
+	}
+	const asyncTextureHandle_t uploaded[2] = { slow, reused };
+	for ( int i = 0; i < 2; i++ )
+	{
+		texture = loader->GetTexture( uploaded[i] );
+		DeleteTexture( texture );
+	}
+	ovrTextureLoader::Destroy( loader );
+
+	printf( "handles: a request next to a long decode and a stale handle %s\n", ok ? "ok" : "FAILED" );
+	return ok;
+}
+
+static int RunTest( const ovrBenchOptions & options )
+{
+	ovrGlRecorder recorder;
+	recorder.Install();
+
+	Array< ovrBenchSource > sources;
+	BuildSources( options, sources );
+	size_t posterBytes = 0;
+	for ( int i = 0; i < sources.GetSizeI(); i += 2 )
+	{
+		posterBytes += sources[i].File.GetSize();
+	}
+	printf( "%d posters %dx%d png (%.1f KB average), %d thumbnails %dx%d ETC2 ktx\n",
+			options.NumPosters, POSTER_WIDTH, POSTER_HEIGHT, posterBytes / 1024.0 / Alg::Max( options.NumPosters, 1 ),
+			options.NumThumbnails, THUMB_SIZE, THUMB_SIZE );
+
+	const double serialSeconds = RunSerial( sources );
+	printf( "serial:    %7.1f textures/s\n", sources.GetSizeI() / serialSeconds );
+
+	bool ok = true;
+	const int threadCounts[] = { 1, 2, 4 };
+	for ( int i = 0; i < 3; i++ )
+	{
+		ovrLoaderResult result;
+		ok = RunLoader( options, recorder, sources, threadCounts[i], false, false, result ) && ok;
+		printf( "%d worker%s: %7.1f textures/s, %.2fx serial\n", threadCounts[i], threadCounts[i] > 1 ? "s" : " ",
+				sources.GetSizeI() / result.Seconds, serialSeconds / result.Seconds );
+	}
+
+	ovrLoaderResult paced;
+	ok = RunLoader( options, recorder, sources, 2, true, false, paced ) && ok;
+	printf( "paced:     %d frames at %.0f Hz with 2 workers, longest update %.2f ms (%.2f ms cpu) for a %.1f ms budget\n",
+			paced.NumFrames, 1.0 / options.FrameSeconds, paced.MaxUpdateSeconds * 1e3, paced.MaxUpdateCpuSeconds * 1e3,
+			options.UploadBudgetSeconds * 1e3 );
+
+	ovrLoaderResult cancelled;
+	ok = RunLoader( options, recorder, sources, 2, true, true, cancelled ) && ok;
+	printf( "cancel:    half of the requests freed at once, %d frames\n", cancelled.NumFrames );
+
+	ok = RunRequestKinds( options, sources ) && ok;
+	ok = RunHandles( options, sources ) && ok;
+
+	recorder.Uninstall();
+	printf( ok ? "OK\n" : "FAILED\n" );
+	return ok ? 0 : 1;
+}
+
+int main( int argc, char * argv[] )
+{
+	ovrBenchOptions options;
+	for ( int i = 1; i < argc; i++ )
+	{
+		const bool hasValue = ( i + 1 < argc );
+		if ( strcmp( argv[i], "-posters" ) == 0 && hasValue )
+		{
+			options.NumPosters = Alg::Max( atoi( argv[++i] ), 1 );
+		}
+		else if ( strcmp( argv[i], "-thumbs" ) == 0 && hasValue )
+		{
+			options.NumThumbnails = Alg::Max( atoi( argv[++i] ), 0 );
+		}
+		else if ( strcmp( argv[i], "-budget" ) == 0 && hasValue )
+		{
+			options.UploadBudgetSeconds = Alg::Max( atof( argv[++i] ), 0.0 ) * 1e-3;
+		}
+		else
+		{
+			printf( "USAGE: TextureLoaderBench [-posters <n>] [-thumbs <n>] [-budget <ms>]\n" );
+			return 1;
+		}
+	}
+
+	System::Init( Log::ConfigureDefaultLog( LogMask_None ) );
+	const int result = RunTest( options );
+	System::Destroy();
+
+	return result;
+}
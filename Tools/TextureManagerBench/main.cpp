@@ -0,0 +1,494 @@
+/************************************************************************************
+
+Filename    :   main.cpp
+Content     :   Host test of ovrTextureManager on the GL recorder: scrolls a thumbnail
+				view over thousands of textures with a memory budget, checks every
+				eviction and the memory accounting against a reference LRU, and times
+				lookups and evictions.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "Kernel/OVR_System.h"
+#include "Kernel/OVR_Alg.h"
+#include "Kernel/OVR_Std.h"
+#include "Kernel/OVR_MemBuffer.h"
+#include "GlTexture.h"
+#include "GlRecorder.h"
+#include "OVR_TextureManager.h"
+#include "BenchCommon.h"
+
+using namespace OVR;
+
+// Prints the first few errors only, a broken manager would otherwise flood the output.
+static int NumErrors = 0;
+
+static void Error( const char * format, ... )
+{
+	if ( NumErrors++ < 10 )
+	{
+		va_list args;
+		va_start( args, format );
+		vprintf( format, args );
+		va_end( args );
+	}
+}
+
+struct ovrBenchOptions
+{
+	ovrBenchOptions() :
+		NumTextures( 2000 ),
+		NumVisible( 64 ),
+		NumFrames( 5000 ),
+		BudgetBytes( 8 * 1024 * 1024 ),
+		NumEvictionTextures( 20000 ) {}
+
+	int		NumTextures;
+	int		NumVisible;
+	int		NumFrames;
+	size_t	BudgetBytes;
+	int		NumEvictionTextures;
+};
+
+// The kinds of textures in the view, by texture index modulo 4.
+enum ovrTextureKind
+{
+	KIND_ETC2_RGB,		// 256x256 with mips
+	KIND_ETC2_RGBA,		// 256x256 with mips
+	KIND_ASTC_8x8,		// 512x512 with mips
+	KIND_RGBA,			// 64x64 without mips, loaded from raw pixels
+	KIND_MAX
+};
+
+static const char * TextureTempName = "/tmp/TextureManagerBench.ktx";
+
+// A KTX file with a full mip chain, and its size in GPU memory.
+static size_t BuildTextureKTX( const eTextureFormat format, const int size, MemBufferT< uint8_t > & ktx )
+{
+	size_t dataSize = 0;
+	int mipCount = 0;
+	for ( int w = size; ; w >>= 1 )
+	{
+		dataSize += GetOvrTextureSize( format, w, w );
+		mipCount++;
+		if ( w == 1 )
+		{
+			break;
+		}
+	}
+
+	ovrTextureImage image;
+	image.Format = format;
+	image.Width = size;
+	image.Height = size;
+	image.MipCount = mipCount;
+	image.NumFaces = 1;
+	image.OwnedData = (uint8_t *)calloc( dataSize, 1 );
+	image.Data = image.OwnedData;
+	image.DataSize = dataSize;
+	if ( !WriteTextureKTX( TextureTempName, image ) )
+	{
+		printf( "failed to write %s\n", TextureTempName );
+		exit( 1 );
+	}
+	MemBufferFile file( TextureTempName );
+	ktx.Realloc( file.Length );
+	memcpy( ktx, file.Buffer, file.Length );
+	remove( TextureTempName );
+	return dataSize;
+}
+
+struct ovrTextureSources
+{
+	MemBufferT< uint8_t >	Ktx[KIND_RGBA];
+	Array< uint8_t >		Pixels;
+	size_t					Sizes[KIND_MAX];		// the real GPU memory
+	size_t					Estimates[KIND_MAX];	// what 32 bits per texel and a third for mips came to
+};
+
+static void BuildSources( ovrTextureSources & sources )
+{
+	static const eTextureFormat formats[KIND_RGBA] = { Texture_ETC2_RGB, Texture_ETC2_RGBA, Texture_ASTC_8x8 };
+	static const int sizes[KIND_MAX] = { 256, 256, 512, 64 };
+	for ( int kind = 0; kind < KIND_RGBA; kind++ )
+	{
+		sources.Sizes[kind] = BuildTextureKTX( formats[kind], sizes[kind], sources.Ktx[kind] );
+		sources.Estimates[kind] = sizes[kind] * sizes[kind] * 4 * 4 / 3;
+	}
+	sources.Pixels.Resize( sizes[KIND_RGBA] * sizes[KIND_RGBA] * 4 );
+	memset( sources.Pixels.GetDataPtr(), 0x80, sources.Pixels.GetSize() );
+	sources.Sizes[KIND_RGBA] = sources.Pixels.GetSize();
+	sources.Estimates[KIND_RGBA] = sources.Pixels.GetSize();
+}
+
+static String GetTextureUri( const int index )
+{
+	char uri[64];
+	OVR_sprintf( uri, sizeof( uri ), "apk:///assets/thumbs/thumb%05d.ktx", index );
+	return String( uri );
+}
+
+static textureHandle_t LoadBenchTexture( ovrTextureManager & manager, const ovrTextureSources & sources, const int index, const String & uri )
+{
+	const int kind = index % KIND_MAX;
+	if ( kind == KIND_RGBA )
+	{
+		return manager.LoadRGBATexture( uri.ToCStr(), sources.Pixels.GetDataPtr(), 64, 64 );
+	}
+	return manager.LoadTexture( uri.ToCStr(), sources.Ktx[kind], sources.Ktx[kind].GetSize() );
+}
+
+//==============================================================
+// ovrReferenceLru
+//
+// What the manager should hold: unreferenced textures are kept, least recently
+// released first, until the memory goes over the budget.
+class ovrReferenceLru
+{
+public:
+	ovrReferenceLru( const int numTextures, const size_t budget ) :
+		MemoryUsed( 0 ),
+		Budget( budget ),
+		NumLoads( 0 ),
+		NumEvictions( 0 )
+	{
+		RefCounts.Resize( numTextures );
+		Resident.Resize( numTextures );
+		for ( int i = 0; i < numTextures; i++ )
+		{
+			RefCounts[i] = 0;
+			Resident[i] = false;
+		}
+	}
+
+	void Load( const int index, const size_t size )
+	{
+		if ( Resident[index] )
+		{
+			if ( RefCounts[index]++ == 0 )
+			{
+				Unreferenced.RemoveAt( FindUnreferenced( index ) );
+			}
+			return;
+		}
+		Resident[index] = true;
+		RefCounts[index] = 1;
+		MemoryUsed += size;
+		NumLoads++;
+		Evict();
+	}
+
+	void Free( const int index )
+	{
+		if ( --RefCounts[index] == 0 )
+		{
+			Unreferenced.PushBack( index );
+			Evict();
+		}
+	}
+
+	size_t				MemoryUsed;
+	size_t				Budget;
+	int					NumLoads;
+	int					NumEvictions;
+	Array< int >		RefCounts;
+	Array< bool >		Resident;
+	Array< size_t >		Sizes;
+
+private:
+	Array< int >		Unreferenced;	// least recently released first
+
+	int FindUnreferenced( const int index ) const
+	{
+		for ( int i = 0; i < Unreferenced.GetSizeI(); i++ )
+		{
+			if ( Unreferenced[i] == index )
+			{
+				return i;
+			}
+		}
+		OVR_ASSERT( false );
+		return -1;
+	}
+
+	void Evict()
+	{
+		while ( MemoryUsed > Budget && Unreferenced.GetSizeI() > 0 )
+		{
+			const int oldest = Unreferenced[0];
+			Unreferenced.RemoveAt( 0 );
+			Resident[oldest] = false;
+			MemoryUsed -= Sizes[oldest];
+			NumEvictions++;
+		}
+	}
+};
+
+static int CountCommands( const ovrGlRecorder & recorder, const ovrGlCommand cmd )
+{
+	int count = 0;
+	const ovrGlRecorder::StreamArray & stream = recorder.GetStream();
+	for ( UPInt i = 0; i < stream.GetSize(); i += 1 + ( stream[i] & 0xFFFF ) )
+	{
+		if ( (ovrGlCommand)( stream[i] >> 16 ) == cmd )
+		{
+			count += stream[i + 1];		// the number of names
+		}
+	}
+	return count;
+}
+
+// Scrolls a view of NumVisible thumbnails over the textures. Every frame loads the
+// visible textures and then releases the ones of the previous frame.
+static bool RunScroll( const ovrBenchOptions & options, ovrGlRecorder & recorder, const ovrTextureSources & sources )
+{
+	bool ok = true;
+
+	Array< String > uris;
+	for ( int i = 0; i < options.NumTextures; i++ )
+	{
+		uris.PushBack( GetTextureUri( i ) );
+	}
+
+	ovrTextureManager * manager = ovrTextureManager::Create();
+	manager->SetMemoryBudget( options.BudgetBytes );
+
+	ovrReferenceLru reference( options.NumTextures, options.BudgetBytes );
+	reference.Sizes.Resize( options.NumTextures );
+	for ( int i = 0; i < options.NumTextures; i++ )
+	{
+		reference.Sizes[i] = sources.Sizes[i % KIND_MAX];
+	}
+
+	Array< textureHandle_t > handles[2];
+	Array< int > indices[2];
+	uint32_t seed = 1;
+	int position = 0;
+	int numDeletes = 0;
+	double seconds = 0.0;
+	for ( int frame = 0; frame < options.NumFrames; frame++ )
+	{
+		// mostly scrolling, sometimes jumping to another part of the list
+		if ( Random( seed ) % 64 == 0 )
+		{
+			position = Random( seed ) % ( options.NumTextures - options.NumVisible );
+		}
+		else
+		{
+			position = ( position + Random( seed ) % 4 ) % ( options.NumTextures - options.NumVisible );
+		}
+
+		Array< textureHandle_t > & current = handles[frame & 1];
+		Array< textureHandle_t > & previous = handles[( frame & 1 ) ^ 1];
+		Array< int > & currentIndices = indices[frame & 1];
+		Array< int > & previousIndices = indices[( frame & 1 ) ^ 1];
+
+		recorder.Clear();
+		const double start = GetSeconds();
+		current.Resize( 0 );
+		for ( int i = position; i < position + options.NumVisible; i++ )
+		{
+			current.PushBack( LoadBenchTexture( *manager, sources, i, uris[i] ) );
+		}
+		for ( int i = 0; i < previous.GetSizeI(); i++ )
+		{
+			manager->FreeTexture( previous[i] );
+		}
+		seconds += GetSeconds() - start;
+		numDeletes += CountCommands( recorder, GL_CMD_DELETE_TEXTURES );
+
+		currentIndices.Resize( 0 );
+		for ( int i = position; i < position + options.NumVisible; i++ )
+		{
+			reference.Load( i, reference.Sizes[i] );
+			currentIndices.PushBack( i );
+		}
+		for ( int i = 0; i < previousIndices.GetSizeI(); i++ )
+		{
+			reference.Free( previousIndices[i] );
+		}
+
+		for ( int i = 0; i < current.GetSizeI(); i++ )
+		{
+			if ( !current[i].IsValid() || !manager->GetGlTexture( current[i] ).IsValid() )
+			{
+				Error( "frame %d: %s did not load\n", frame, uris[currentIndices[i]].ToCStr() );
+				ok = false;
+			}
+		}
+		if ( manager->GetMemoryUsed() != reference.MemoryUsed )
+		{
+			Error( "frame %d: the manager uses %zu bytes, expected %zu\n", frame, manager->GetMemoryUsed(), reference.MemoryUsed );
+			ok = false;
+		}
+		if ( ( frame & 15 ) == 0 || frame == options.NumFrames - 1 )
+		{
+			for ( int i = 0; i < options.NumTextures; i++ )
+			{
+				if ( manager->GetTextureHandle( uris[i].ToCStr() ).IsValid() != reference.Resident[i] )
+				{
+					Error( "frame %d: %s is %sresident\n", frame, uris[i].ToCStr(), reference.Resident[i] ? "not " : "" );
+					ok = false;
+				}
+			}
+		}
+	}
+	if ( numDeletes != reference.NumEvictions )
+	{
+		Error( "%d textures deleted, expected %d evictions\n", numDeletes, reference.NumEvictions );
+		ok = false;
+	}
+
+	const int totalLoads = options.NumFrames * options.NumVisible;
+	printf( "scroll:   %d frames, %d loads, %d uploads, %d evictions, %.2f MB resident, %.0f loads/s\n",
+			options.NumFrames, totalLoads, reference.NumLoads, reference.NumEvictions, manager->GetMemoryUsed() / ( 1024.0 * 1024.0 ),
+			totalLoads / seconds );
+
+	// Lookups of resident textures, by uri and by repeated loads.
+	const int numLookups = 1000000;
+	int numResident = 0;
+	double lookupStart = GetSeconds();
+	for ( int i = 0; i < numLookups; i++ )
+	{
+		numResident += manager->GetTextureHandle( uris[i % options.NumTextures].ToCStr() ).IsValid();
+	}
+	const double lookupSeconds = GetSeconds() - lookupStart;
+
+	const Array< textureHandle_t > & visible = handles[( options.NumFrames - 1 ) & 1];
+	const Array< int > & visibleIndices = indices[( options.NumFrames - 1 ) & 1];
+	lookupStart = GetSeconds();
+	for ( int i = 0; i < numLookups; i++ )
+	{
+		const int v = i % visible.GetSizeI();
+		manager->FreeTexture( LoadBenchTexture( *manager, sources, visibleIndices[v], uris[visibleIndices[v]] ) );
+	}
+	const double reloadSeconds = GetSeconds() - lookupStart;
+	printf( "lookups:  %.1f M uri lookups/s (%d%% resident), %.1f M load+free hits/s\n",
+			numLookups / lookupSeconds * 1e-6, numResident * 100 / numLookups, numLookups / reloadSeconds * 1e-6 );
+
+	for ( int i = 0; i < visible.GetSizeI(); i++ )
+	{
+		manager->FreeTexture( visible[i] );
+	}
+	ovrTextureManager::Destroy( manager );
+	return ok;
+}
+
+// Fills the manager with unreferenced textures under a large budget, then shrinks
+// the budget so almost all of them are evicted at once.
+static bool RunEviction( const ovrBenchOptions & options, ovrGlRecorder & recorder )
+{
+	bool ok = true;
+
+	static uint8_t pixels[4 * 4 * 4];
+	const size_t size = sizeof( pixels );
+	ovrTextureManager * manager = ovrTextureManager::Create();
+	manager->SetMemoryBudget( options.NumEvictionTextures * size );
+	Array< textureHandle_t > handles;
+	for ( int i = 0; i < options.NumEvictionTextures; i++ )
+	{
+		handles.PushBack( manager->LoadRGBATexture( i, pixels, 4, 4 ) );
+	}
+	for ( int i = 0; i < handles.GetSizeI(); i++ )
+	{
+		manager->FreeTexture( handles[i] );
+	}
+
+	recorder.Clear();
+	const int kept = 16;
+	const double start = GetSeconds();
+	manager->SetMemoryBudget( kept * size );
+	const double seconds = GetSeconds() - start;
+
+	// the most recently released ones are kept
+	const int numDeletes = CountCommands( recorder, GL_CMD_DELETE_TEXTURES );
+	if ( numDeletes != options.NumEvictionTextures - kept || manager->GetMemoryUsed() != kept * size )
+	{
+		Error( "evicted %d textures to %zu bytes, expected %d to %zu\n", numDeletes, manager->GetMemoryUsed(),
+				options.NumEvictionTextures - kept, kept * size );
+		ok = false;
+	}
+	for ( int i = 0; i < options.NumEvictionTextures; i++ )
+	{
+		if ( manager->GetTextureHandle( i ).IsValid() != ( i >= options.NumEvictionTextures - kept ) )
+		{
+			Error( "icon %d was %sevicted\n", i, ( i >= options.NumEvictionTextures - kept ) ? "" : "not " );
+			ok = false;
+			break;
+		}
+	}
+	printf( "eviction: %d of %d unreferenced textures in %.2f ms\n", numDeletes, options.NumEvictionTextures, seconds * 1e3 );
+
+	ovrTextureManager::Destroy( manager );
+	return ok;
+}
+
+static int RunTest( const ovrBenchOptions & options )
+{
+	ovrGlRecorder recorder;
+	recorder.Install();
+
+	ovrTextureSources sources;
+	BuildSources( sources );
+	static const char * kindNames[KIND_MAX] = { "ETC2 RGB 256", "ETC2 RGBA 256", "ASTC 8x8 512", "RGBA 64" };
+	for ( int kind = 0; kind < KIND_MAX; kind++ )
+	{
+		printf( "%-14s %7zu bytes, %7zu bytes as 32 bit texels\n", kindNames[kind], sources.Sizes[kind], sources.Estimates[kind] );
+	}
+	printf( "%d textures, %d visible, %.1f MB budget\n", options.NumTextures, options.NumVisible, options.BudgetBytes / ( 1024.0 * 1024.0 ) );
+
+	bool ok = RunScroll( options, recorder, sources );
+	ok = RunEviction( options, recorder ) && ok;
+
+	recorder.Uninstall();
+	if ( NumErrors > 10 )
+	{
+		printf( "%d more errors\n", NumErrors - 10 );
+	}
+	printf( ok ? "OK\n" : "FAILED\n" );
+	return ok ? 0 : 1;
+}
+
+int main( int argc, char * argv[] )
+{
+	ovrBenchOptions options;
+	for ( int i = 1; i < argc; i++ )
+	{
+		const bool hasValue = ( i + 1 < argc );
+		if ( strcmp( argv[i], "-textures" ) == 0 && hasValue )
+		{
+			options.NumTextures = Alg::Max( atoi( argv[++i] ), options.NumVisible + 1 );
+		}
+		else if ( strcmp( argv[i], "-frames" ) == 0 && hasValue )
+		{
+			options.NumFrames = Alg::Max( atoi( argv[++i] ), 1 );
+		}
+		else if ( strcmp( argv[i], "-budget" ) == 0 && hasValue )
+		{
+			options.BudgetBytes = (size_t)Alg::Max( atoi( argv[++i] ), 1 ) * 1024;
+		}
+		else if ( strcmp( argv[i], "-evict" ) == 0 && hasValue )
+		{
+			options.NumEvictionTextures = Alg::Max( atoi( argv[++i] ), 32 );
+		}
+		else
+		{
+			printf( "USAGE: TextureManagerBench [-textures <n>] [-frames <n>] [-budget <KB>] [-evict <n>]\n" );
+			return 1;
+		}
+	}
+
+	System::Init( Log::ConfigureDefaultLog( LogMask_None ) );
+	const int result = RunTest( options );
+	System::Destroy();
+
+	return result;
+}
@@ -46,6 +46,8 @@ class App;
 class OvrStoragePaths;
 class ovrFileSys;
 class ovrTextureManager;
+class ovrTextureLoader;
+class ovrFrameStats;
 
 enum ovrIntentType
 {
@@ -278,6 +280,8 @@ public:
 	virtual int						GetSystemProperty( const ovrSystemProperty propType ) = 0;
 	virtual int						GetSystemStatus( const ovrSystemStatus statusType ) = 0;
 	virtual const VrDeviceStatus &	GetDeviceStatus() const = 0;
+	// Frame interval percentiles, hitches and phase times over the last few seconds.
+	virtual const ovrFrameStats &	GetFrameStats() const = 0;
 
 	//-----------------------------------------------------------------
 	// accessors
@@ -315,6 +319,9 @@ public:
 
 	// it's possible that this could return NULL if it's called before InitGLObjects()
 	virtual	ovrTextureManager *			GetTextureManager() = 0;
+	// Decodes textures on worker threads and uploads a few of them at the start of every
+	// frame. NULL before InitGLObjects(), the same as the texture manager.
+	virtual	ovrTextureLoader *			GetTextureLoader() = 0;
 	// ----DEPRECATED_DRAWEYEVIEW
 	// This function is provided as a temporary means to transition
 	// an app to return surfaces from Frame. Please do not write any
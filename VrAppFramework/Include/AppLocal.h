@@ -15,6 +15,7 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 #include "GlSetup.h"
 #include "PointTracker.h"
 #include "VrFrameBuilder.h"
+#include "OVR_FrameStats.h"
 #include "Kernel/OVR_Threads.h"
 
 namespace OVR {
@@ -65,6 +66,7 @@ public:
 	virtual int						GetSystemProperty( const ovrSystemProperty propType );
 	virtual int						GetSystemStatus( const ovrSystemStatus statusType );
 	virtual const VrDeviceStatus &	GetDeviceStatus() const;
+	virtual const ovrFrameStats &	GetFrameStats() const;
 
 	//-----------------------------------------------------------------
 	// accessors
@@ -95,6 +97,7 @@ public:
 	virtual ovrMobile *					GetOvrMobile();
 	virtual ovrFileSys &				GetFileSys();
 	virtual	ovrTextureManager *			GetTextureManager();
+	virtual	ovrTextureLoader *			GetTextureLoader();
 	virtual ovrSurfaceRender &			GetSurfaceRender();
 
 	//-----------------------------------------------------------------
@@ -183,6 +186,8 @@ private:
 	ovrInputEvents		InputEvents;
 	VrFrameBuilder		TheVrFrame;					// passed to VrAppInterface::Frame()
 	long long			EnteredVrModeFrame;			// frame number when VR mode was last entered
+	ovrFrameStats		FrameStats;					// frame intervals and phase times of the VR thread loop
+	double				DisplayRefreshRate;
 
 	ovrSettings			VrSettings;					// passed to VrAppInterface::Configure()
 
@@ -209,6 +214,7 @@ private:
 
 	ovrFileSys *		FileSys;
 	ovrTextureManager *	TextureManager;
+	ovrTextureLoader *	TextureLoader;
 
 	//-----------------------------------------------------------------
 
@@ -59,6 +59,56 @@ struct fontParms_t {
 	float					ColorCenter;	// blow this distance, color is 0, above this color is 1
 };
 
+//==============================================================
+// ovrTextWrapCache
+// The line breaks and per-line metrics of a word-wrapped string. Passing the same
+// cache to BitmapFont::WordWrapText() each time a text object changes lets the font
+// re-flow only the lines around the edit, and BitmapFont::CalcTextMetrics() can read
+// the metrics from the lines instead of scanning the text again.
+class ovrTextWrapCache
+{
+public:
+	ovrTextWrapCache();
+
+	void				Clear();
+
+	String const &		GetSourceText() const { return Source; }
+	String const &		GetWrappedText() const { return Wrapped; }
+	int					GetNumLines() const { return Lines.GetSizeI(); }
+	// Number of lines laid out by the last update, the rest were reused.
+	int					GetNumReflowedLines() const { return NumReflowedLines; }
+
+private:
+	friend class BitmapFontLocal;
+
+	struct ovrLine
+	{
+		int32_t	Start;			// byte offset of the line's first character in the source text
+		int32_t	WidthStart;		// the wrap width is measured from here, which is the space before Start after a break at a space
+		int32_t	Resume;			// the characters in [Start, Resume) were read by the line before and are not break points
+		int32_t	End;			// byte offset after the line's last character
+		int32_t	Next;			// byte offset the next line starts at, the bytes in [End, Next) become the line break
+		int32_t	NextWidthStart;	// WidthStart and Resume of the next line
+		int32_t	NextResume;
+		int32_t	ScanEnd;		// byte offset after the last character that was read to place the break
+		int32_t	NumChars;		// characters on the line that have a glyph
+		int32_t	NumCodes;		// all characters on the line, not counting the line break
+		float	Width;			// native (unscaled) widths, ascents and descents as CalcTextMetrics() measures them
+		float	MaxAscent;
+		float	MaxDescent;
+		bool	HasTab;			// tabs are written as spaces when wrapping
+		bool	IsLast;			// the line ends the text
+	};
+
+	String				Source;
+	String				Wrapped;
+	Array< ovrLine >	Lines;
+	uint32_t			FontId;
+	float				WidthMeters;
+	float				FontScale;
+	int					NumReflowedLines;
+};
+
 //==============================================================
 // BitmapFont
 class BitmapFont
@@ -86,6 +136,13 @@ public:
 	// Another version of WordWrapText which doesn't break in between strings that are listed in wholeStrsList array
 	// Ex : "Gear VR", we don't want to break in between "Gear" & "VR" so we need to pass "Gear VR" string in wholeStrsList
 	virtual bool			WordWrapText( String & inOutText, const float widthMeters, OVR::Array< OVR::String > wholeStrsList, const float fontScale = 1.0f ) const = 0;
+	// Word wraps text into the cache the same way as above. If the cache holds an earlier version of
+	// the text wrapped with the same font, width and scale, only the lines touched by the change are
+	// laid out again. A negative width only splits lines at '\n' and leaves the text unchanged.
+	virtual void			WordWrapText( ovrTextWrapCache & cache, char const * text, const float widthMeters, const float fontScale = 1.0f ) const = 0;
+	// Same results as CalcTextMetrics() on the cache's wrapped text, without scanning it again.
+	virtual void	        CalcTextMetrics( ovrTextWrapCache const & cache, size_t & len, float & width, float & height,
+									float & ascent, float & descent, float & fontHeight, float * lineWidths, int const maxLines, int & numLines ) const = 0;
 
 	// Get the last part of the string that will fit in the provided width. Returns an offset if the entire string doesn't fit. The offset can be used to help
 	// with right justification. It is the width of the part of the last character that would have fit.
@@ -147,6 +204,10 @@ public:
 
 	virtual void		SetCullEnabled( const bool enabled ) = 0;
 
+	// Strings that are drawn again with the same font and parameters reuse their cached
+	// layout. Set both to 0 to disable the cache, e.g. for text that changes every frame.
+	virtual void		SetLayoutCacheBudget( int const maxEntries, int const maxVertices ) = 0;
+
 protected:
     virtual     ~BitmapFontSurface() { }
 };
@@ -58,6 +58,11 @@ public:
 
 	// Create the VAO and vertex and index buffers from arrays of data.
 	void	Create( const VertexAttribs & attribs, const Array< TriangleIndex > & indices );
+	// Create the VAO and buffers from vertex attributes that are already packed the way the
+	// above Create() packs them: each attribute in attribMask ( 1 << VERTEX_ATTRIBUTE_LOCATION_* )
+	// as a contiguous array, in VertexAttribs order. The data is uploaded without a copy.
+	void	Create( const void * packedVertices, const int attribMask, const int numVertices,
+					const TriangleIndex * indices, const int numIndices, const Bounds3f & bounds );
 	void	Update( const VertexAttribs & attribs, const bool updateBounds = true );
 
 	// ----DEPRECATED_DRAWEYEVIEW
@@ -118,6 +118,8 @@ public:
 		, target( 0 )
 		, Width( 0 )
 		, Height( 0 )
+		, Format( Texture_None )
+		, MipCount( 0 )
 	{
 	}
 
@@ -128,6 +130,8 @@ public:
 		, target( target_ )
 		, Width( w )
 		, Height( h )
+		, Format( Texture_None )
+		, MipCount( 0 )
 	{
 	}
 	operator unsigned() const
@@ -141,11 +145,20 @@ public:
 	unsigned		target;
 	int				Width;
 	int				Height;
+	eTextureFormat	Format;		// Texture_None unless the texture was created from image data here
+	int				MipCount;
 };
 
 bool TextureFormatToGlFormat( const eTextureFormat format, const bool useSrgbFormat, GLenum & glFormat, GLenum & glInternalFormat );
 bool GlFormatToTextureFormat( eTextureFormat & format, const GLenum glFormat, const GLenum glInternalFormat );
 
+// Returns the number of bytes used by a single mip level of the given format and size.
+int32_t GetOvrTextureSize( const eTextureFormat format, const int w, const int h );
+
+// Returns the GPU memory of all mip levels and faces of the texture, or 0 if the
+// format of the texture is not known.
+size_t GetGlTextureSize( const GlTexture & texture );
+
 // Allocates a GPU texture and uploads the raw data.
 GlTexture	LoadRGBATextureFromMemory( const uint8_t * texture, const int width, const int height, const bool useSrgbFormat );
 GlTexture	LoadRGBACubeTextureFromMemory( const uint8_t * texture, const int dim, const bool useSrgbFormat );
@@ -185,6 +198,51 @@ void FreeRGBABuffer( const unsigned char * buffer );
 GlTexture	LoadTextureFromBuffer( const char * fileName, const MemBuffer & buffer,
 				const TextureFlags_t & flags, int & width, int & height );
 
+//==============================================================
+// ovrTextureImage
+// The CPU side of a texture load: the pixels or compressed blocks of every
+// level plus what CreateTextureFromImage needs to upload them. Decoding
+// doesn't touch GL, so it can be done on any thread.
+class ovrTextureImage
+{
+public:
+	ovrTextureImage();
+	~ovrTextureImage();
+
+	void				Free();
+
+	eTextureFormat		Format;
+	int					Width;
+	int					Height;
+	int					MipCount;
+	int					NumFaces;			// 1, or 6 for a cube map
+	bool				UseSrgbFormat;
+	bool				ImageSizeStored;	// KTX style, each level is preceded by its size
+	bool				GenerateMipmaps;	// glGenerateMipmap after the upload
+	const uint8_t *		Data;				// either OwnedData or a pointer into the decoded file buffer
+	size_t				DataSize;
+	uint8_t *			OwnedData;			// malloc'd, released by Free()
+
+private:
+	ovrTextureImage( const ovrTextureImage & ) = delete;
+	ovrTextureImage & operator = ( const ovrTextureImage & ) = delete;
+};
+
+// Decodes a file buffer without touching GL. The extension of fileName determines the
+// file type, as for LoadTextureFromBuffer. For .pvr, .ktx and .astc files the image
+// points into the buffer, so the buffer must outlive the image.
+// If buildMipmaps is true, uncompressed images get their mip chain built on the CPU
+// instead of with glGenerateMipmap at upload time.
+bool		DecodeTextureBuffer( const char * fileName, const MemBuffer & buffer, const TextureFlags_t & flags,
+				const bool buildMipmaps, ovrTextureImage & image );
+
+// Uploads a decoded image. Must be called on a thread with a GL context.
+GlTexture	CreateTextureFromImage( const char * fileName, const ovrTextureImage & image );
+
+// Writes a single face image with tightly packed levels (ImageSizeStored == false)
+// as a .ktx file, so that it can be loaded back without decoding. Doesn't touch GL.
+bool		WriteTextureKTX( const char * fileName, const ovrTextureImage & image );
+
 // Returns 0 if the file is not found.
 // For a file placed in the project assets folder, nameInZip would be
 // something like "assets/cube.pvr".
@@ -12,6 +12,8 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 #ifndef OVR_IMAGEDATA_H
 #define OVR_IMAGEDATA_H
 
+#include <stddef.h>
+
 namespace OVR {
 
 // Uncompressed .pvr textures are much more efficient to load than bmp/tga/etc.
@@ -23,17 +25,40 @@ void		Write32BitPvrTexture( const char * fileName, const unsigned char * texture
 // If srgb is true, the resampling will be gamma correct, otherwise it is just sumOf4 >> 2
 unsigned char * QuarterImageSize( const unsigned char * src, const int width, const int height, const bool srgb );
 
+// Returns all mip levels of an RGBA image in one buffer, level 0 first, down to 1x1.
+// Each level is max( 1, size >> 1 ) of the previous one, as in GL, and filtered like
+// QuarterImageSize. Up to numThreads threads share the larger levels.
+// The returned buffer should be freed with free()
+unsigned char * BuildMipChainRGBA( const unsigned char * src, const int width, const int height,
+					const bool srgb, const int numThreads, int & outNumLevels, size_t & outSize );
+
 // The returned buffer should be freed with free().
 enum ImageFilter
 {
 	IMAGE_FILTER_NEAREST,
 	IMAGE_FILTER_LINEAR,
-	IMAGE_FILTER_CUBIC
+	IMAGE_FILTER_CUBIC,
+	IMAGE_FILTER_BOX,
+	IMAGE_FILTER_LANCZOS
 };
-// filter: 0 = nearest, 1 = linear, 2 = cubic
+// When shrinking, every filter except nearest is widened by the scale factor so all
+// source texels contribute. If linear is true the filtering is done in linear space.
+// Up to numThreads threads share the rows.
 unsigned char * ScaleImageRGBA( const unsigned char * src, const int width, const int height,
 					const int newWidth, const int newHeight,
-					const ImageFilter filter, const bool linear = true );
+					const ImageFilter filter, const bool linear = true, const int numThreads = 1 );
+
+// Compresses RGBA pixels to ETC2 RGB8, or to ETC2 RGBA8 with EAC alpha if alpha is true.
+// Partial blocks at the right and bottom edges repeat the last column and row.
+// out must hold GetETC2Size( width, height, alpha ) bytes.
+size_t			GetETC2Size( const int width, const int height, const bool alpha );
+void			CompressImageETC2( const unsigned char * rgba, const int width, const int height, const bool alpha,
+					unsigned char * out, const int numThreads );
+
+// Builds the mip chain like BuildMipChainRGBA and compresses every level with CompressImageETC2.
+// The returned buffer should be freed with free()
+unsigned char * CompressMipChainETC2( const unsigned char * rgba, const int width, const int height,
+					const bool srgb, const bool alpha, const int numThreads, int & outNumLevels, size_t & outSize );
 
 }	// namespace OVR
 
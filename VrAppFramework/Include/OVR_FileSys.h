@@ -18,6 +18,8 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 
 namespace OVR {
 
+class ovrMountTable;
+
 //==============================================================
 // ovrFileSys
 class ovrFileSys
@@ -44,6 +46,10 @@ public:
 	virtual bool			FileExists( char const * uri ) = 0;
 	// Gets the local path for the specified URI. File must exist. Returns false if path is not accessible directly by the file system.
 	virtual bool			GetLocalPathForURI( char const * uri, String &outputPath ) = 0;
+
+	// Virtual folders that can be listed and searched without going to the file system.
+	// Nothing is mounted by default.
+	virtual ovrMountTable &	GetMountTable() = 0;
 };
 
 } // namespace OVR
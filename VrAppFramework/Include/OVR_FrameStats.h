@@ -0,0 +1,141 @@
+/************************************************************************************
+
+Filename    :   OVR_FrameStats.h
+Content     :   Rolling frame interval and frame phase statistics.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#if !defined( OVR_FrameStats_h )
+#define OVR_FrameStats_h
+
+#include "Kernel/OVR_Types.h"
+#include "Kernel/OVR_String.h"
+
+namespace OVR
+{
+
+// The parts of the VR thread loop that are timed separately.
+enum ovrFramePhase
+{
+	FRAME_PHASE_ADVANCE,		// VrFrameBuilder::AdvanceVrFrame and the framework input processing
+	FRAME_PHASE_FRAME,			// VrAppInterface::Frame and the debug console
+	FRAME_PHASE_DRAW,			// DrawEyeViews, including the wait in vrapi_SubmitFrame
+	FRAME_PHASE_MAX
+};
+
+// A frame is a hitch at threshold i if its interval is longer than
+// HitchThresholds[i] times the frame period: 1.5 means it missed at least one
+// display refresh, 2.5 at least two and 4.5 at least four.
+static const int	NUM_HITCH_THRESHOLDS = 3;
+
+struct ovrFrameStatsSummary
+{
+	int			NumFrames;						// frames in the window
+	double		Period;							// target frame period in seconds
+
+	// All times are in seconds, over the frames in the window.
+	double		MeanInterval;
+	double		MedianInterval;
+	double		Percentile90Interval;
+	double		Percentile99Interval;
+	double		MaxInterval;
+	double		Jitter;							// standard deviation of the interval
+	int			Hitches[NUM_HITCH_THRESHOLDS];
+	int			MissedRefreshes;				// display refreshes that showed a stale frame
+	double		PhaseMean[FRAME_PHASE_MAX];
+	double		PhaseMax[FRAME_PHASE_MAX];
+
+	// Since the last Reset.
+	long long	TotalFrames;
+	long long	TotalHitches[NUM_HITCH_THRESHOLDS];
+	long long	TotalMissedRefreshes;
+};
+
+//==============================================================
+// ovrFrameStats
+//
+// Records the interval between consecutive frames and the time spent in each
+// frame phase into a fixed size ring of the last MAX_FRAMES frames, so the
+// statistics cover a rolling window of a few seconds and recording never
+// allocates. Recording costs one clock read per call; the percentiles are only
+// computed when a summary is requested.
+//
+// The clock can be replaced, so a loop can be driven with a fake clock and
+// give the same statistics on every run.
+//
+// Not thread safe, all calls must come from the thread that runs the loop.
+class ovrFrameStats
+{
+public:
+	static const int	MAX_FRAMES = 512;	// power of two
+	static const double	HitchThresholds[NUM_HITCH_THRESHOLDS];
+
+	typedef double		(*ovrFrameClock)();	// seconds
+
+						ovrFrameStats();
+
+	// Defaults to the monotonic clock.
+	void				SetClock( const ovrFrameClock clock );
+	// The time a frame should take, i.e. the minimum vsyncs over the refresh rate.
+	void				SetFramePeriod( const double seconds );
+	double				GetFramePeriod() const { return Period; }
+
+	// Closes the previous frame, with the interval since its BeginFrame.
+	void				BeginFrame();
+	// Drops the open frame without recording it, e.g. when the loop was paused
+	// and the next interval would include the pause.
+	void				DiscardFrame();
+
+	// Closes the open phase, if any. Time in a phase entered more than once
+	// in a frame adds up.
+	void				BeginPhase( const ovrFramePhase phase );
+	void				EndPhase();
+
+	// Forgets all frames, including the totals.
+	void				Reset();
+
+	void				GetSummary( ovrFrameStatsSummary & summary ) const;
+	// One line with the interval statistics and one with the phases. Times are in milliseconds.
+	void				DumpText( StringBuffer & out ) const;
+	void				LogSummary() const;
+
+	// Logs the summary every logPeriod seconds of the clock. Zero disables it.
+	void				SetLogPeriod( const double seconds );
+	void				LogIfDue();
+
+	static double		GetMonotonicSeconds();
+
+private:
+	struct ovrFrameRecord
+	{
+		float			Interval;
+		float			Phases[FRAME_PHASE_MAX];
+	};
+
+	ovrFrameClock		Clock;
+	double				Period;
+	double				LogPeriod;
+	double				NextLogTime;
+
+	bool				FrameOpen;
+	double				FrameStart;
+	int					OpenPhase;			// -1 if none
+	double				PhaseStart;
+	float				OpenPhases[FRAME_PHASE_MAX];
+
+	long long			TotalFrames;
+	long long			TotalHitches[NUM_HITCH_THRESHOLDS];
+	long long			TotalMissedRefreshes;
+
+	ovrFrameRecord		Frames[MAX_FRAMES];
+
+	static int			MissedRefreshes( const double interval, const double period );
+};
+
+} // namespace OVR
+
+#endif // OVR_FrameStats_h
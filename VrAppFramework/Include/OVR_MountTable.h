@@ -0,0 +1,161 @@
+/************************************************************************************
+
+Filename    :   OVR_MountTable.h
+Content     :   Ordered mounts of folders, packages and memory files with a sorted index.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#if !defined( OVR_MountTable_h )
+#define OVR_MountTable_h
+
+#include "Kernel/OVR_Types.h"
+#include "Kernel/OVR_Array.h"
+#include "Kernel/OVR_Hash.h"
+#include "Kernel/OVR_String.h"
+#include "Kernel/OVR_Threads.h"
+#include "Kernel/OVR_MemBuffer.h"
+
+namespace OVR
+{
+
+// A file mounted from memory. The name and the data must stay valid while it is mounted.
+struct ovrMemoryFile
+{
+	const char *	Name;			// relative to the mount point
+	const void *	Data;
+	size_t			Size;
+};
+
+//==============================================================
+// ovrMountTable
+//
+// A virtual file system built from an ordered list of mounts. Every mount
+// appears under a virtual folder, and a path in an earlier mount hides the same
+// path in the later ones, the same way the search paths do. Folders present in
+// several mounts list the contents of all of them.
+//
+// The names of all mounts are indexed once, into one array sorted by folder
+// and then by name, so the contents of a folder, an existence check and the
+// literal part of a glob pattern are each found with a binary search instead
+// of going to the file system. On Linux and Android the mounted folders can be
+// watched with inotify; Refresh() then rescans only the folders that reported
+// a change.
+//
+// Paths are relative, use '/' and are case sensitive. Names that start with a
+// '.' are skipped, as in DirectoryFileList. Listings are sorted by byte value.
+//
+// Thread safe.
+class ovrMountTable
+{
+public:
+						ovrMountTable();
+						~ovrMountTable();
+
+	// mountPoint is the virtual folder the mount appears under, "" for the
+	// root. The mount functions return an id for Unmount, or -1 if the mount
+	// could not be indexed.
+	int					MountFolder( const char * mountPoint, const char * localPath, const bool watch );
+	// The zip file stays owned by the caller and must stay open while it is mounted.
+	int					MountPackage( const char * mountPoint, void * zipFile );
+	int					MountMemory( const char * mountPoint, const ovrMemoryFile * files, const int numFiles );
+	void				Unmount( const int id );
+
+	// Applies the changes the watched folders reported since the last call.
+	// Returns true if the index changed.
+	bool				Refresh();
+
+	bool				FileExists( const char * path ) const;
+	bool				FolderExists( const char * path ) const;
+	// Appends the files and sub folders of a folder as full virtual paths, sub
+	// folders with a trailing slash. Returns false if the folder does not exist.
+	bool				ListFolder( const char * path, Array< String > & out ) const;
+	// Appends the paths that match a pattern, with the same form as ListFolder.
+	// '*' matches any run of characters and '?' any one character, neither
+	// matches a '/'. Returns the number of matches.
+	int					Glob( const char * pattern, Array< String > & out ) const;
+
+	bool				ReadFile( const char * path, MemBufferT< uint8_t > & outBuffer ) const;
+	// Returns false if the file is not in a mounted folder.
+	bool				GetLocalPath( const char * path, String & outPath ) const;
+
+	int					GetNumEntries() const;
+
+private:
+	enum ovrMountType
+	{
+		MOUNT_FOLDER,
+		MOUNT_PACKAGE,
+		MOUNT_MEMORY
+	};
+
+	// A file or folder. Path has no trailing slash. Entries are ordered by the
+	// folder part of the path and then by the name, so the contents of a
+	// folder, and everything below any folder path prefix, are contiguous.
+	struct ovrMountEntry
+	{
+		String			Path;
+		int				NameOffset;		// start of the last component
+		int				Mount;
+		int				Data;			// index of the memory file, -1 otherwise
+		bool			IsFolder;
+	};
+
+	struct ovrMount
+	{
+		ovrMountType	Type;
+		bool			Active;
+		bool			Watch;
+		String			MountPoint;		// without a trailing slash
+		String			LocalPath;		// for folders, without a trailing slash
+		void *			ZipFile;
+		Array< ovrMemoryFile >			MemoryFiles;
+		Array< ovrMountEntry >			Entries;		// sorted
+	};
+
+	// A watched folder, relative to the root of its mount.
+	struct ovrWatch
+	{
+		int				Mount;
+		String			Folder;
+	};
+
+	mutable Mutex		TableMutex;
+	Array< ovrMount * >	Mounts;
+	Array< ovrMountEntry >			Index;			// sorted, the entries of all mounts with the hidden ones dropped
+	int					WatchFd;
+	Hash< int, ovrWatch >			Watches;
+
+	static int			CompareEntries( const ovrMountEntry & a, const ovrMountEntry & b );
+	static bool			EntryLess( const ovrMountEntry & a, const ovrMountEntry & b );
+	static void			SortEntries( Array< ovrMountEntry > & entries );
+	static void			MakeEntry( const String & path, const bool isFolder, const int mount, const int data, ovrMountEntry & entry );
+	static void			AddFolders( const String & path, const int mount, Array< ovrMountEntry > & entries );
+	static String		JoinPath( const String & folder, const char * name );
+	static String		NormalizePath( const char * path );
+	static const char *	TrimPath( const char * path, int & length );
+
+	// Index of the first entry that is not less than the folder and name, or the count.
+	static int			LowerBound( const Array< ovrMountEntry > & entries, const char * folder, const int folderLength,
+									const char * name, const int nameLength );
+	// The range of the entries directly in a folder.
+	static void			FolderRange( const Array< ovrMountEntry > & entries, const String & folder, int & first, int & end );
+	// The range of the entries whose folder starts with a prefix.
+	static void			PrefixRange( const Array< ovrMountEntry > & entries, const char * prefix, const int prefixLength, int & first, int & end );
+	static int			FindEntry( const Array< ovrMountEntry > & entries, const char * path, const int length );
+
+	int					AddMount( ovrMount * mount, Array< ovrMountEntry > & entries );
+	void				RebuildIndex();
+	String				LocalPathOf( const ovrMount & mount, const String & path ) const;
+
+	void				ScanFolder( const int mount, const String & folder, const bool recurse, Array< ovrMountEntry > & entries );
+	bool				WatchFolder( const int mount, const String & folder );
+	bool				RescanFolders( const int mount, const Array< String > & folders );
+};
+
+} // namespace OVR
+
+#endif // OVR_MountTable_h
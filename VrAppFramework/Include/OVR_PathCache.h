@@ -0,0 +1,153 @@
+/************************************************************************************
+
+Filename    :   OVR_PathCache.h
+Content     :   Cache of relative path to search path resolutions for GetFullPath.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#if !defined( OVR_PathCache_h )
+#define OVR_PathCache_h
+
+#include "Kernel/OVR_Types.h"
+#include "Kernel/OVR_Array.h"
+#include "Kernel/OVR_Hash.h"
+#include "Kernel/OVR_String.h"
+#include "Kernel/OVR_Threads.h"
+
+namespace OVR
+{
+
+//==============================================================
+// ovrPathCache
+//
+// Remembers in which search path a relative path was found, or that it was not
+// found in any, so resolving the same name again does not stat every candidate.
+//
+// An entry depends on the folders its candidates are in. Each folder's
+// modification time is checked at most once every revalidate interval, and a
+// change drops the entries of every name looked up in that folder. A folder
+// modified within the last two seconds can change again without its time
+// changing, so names in such a folder are not cached until it settles. Flush()
+// drops everything, for callers that create a file and need it found at once.
+//
+// Thread safe. The candidates are probed outside the lock.
+class ovrPathCache
+{
+public:
+	static const int	NOT_FOUND = -2;
+	static const int	FOUND_RELATIVE = -1;	// the relative path itself exists
+	static const int	MAX_ENTRIES = 65536;	// the entries are flushed when full
+
+						ovrPathCache();
+
+	// The instance used by GetFullPath and GetFullPaths.
+	static ovrPathCache &	Get();
+
+	// Returns the index of the search path the file was found in, or
+	// FOUND_RELATIVE, or NOT_FOUND. outPath is only set if the file was found.
+	int					Resolve( const Array< String > & searchPaths, const char * relativePath, String & outPath );
+
+	// Resolves all paths at once: the uncached names are probed one folder
+	// listing at a time instead of one stat per candidate. outPaths[i] is left
+	// empty if relativePaths[i] was not found. Returns the number found.
+	int					ResolveBatch( const Array< String > & searchPaths, const Array< String > & relativePaths, Array< String > & outPaths );
+
+	void				Flush();
+	// Zero checks the folders on every lookup.
+	void				SetRevalidateSeconds( const double seconds );
+
+	int					GetNumHits() const { return NumHits; }
+	int					GetNumMisses() const { return NumMisses; }
+	int					GetNumProbes() const { return NumProbes; }	// stat calls and folder listings
+
+private:
+	struct ovrFolder
+	{
+		String			Path;
+		bool			Exists;
+		bool			Racy;			// modified too recently to trust the time
+		int64_t			ModifiedTime;
+		double			CheckTime;
+		uint32_t		Generation;		// incremented when the modification time changes
+	};
+
+	// The folders the candidates of the names in one sub folder of one search path list are in.
+	struct ovrFolderSet
+	{
+		Array< int >	Folders;
+	};
+
+	struct ovrSearchList
+	{
+		Array< String >	Paths;
+		uint64_t		Hash;
+	};
+
+	struct ovrEntry
+	{
+		String			RelativePath;
+		String			FullPath;
+		int				SearchList;
+		int				FolderSet;
+		int				FoundIndex;
+		uint32_t		Generation;		// sum of the folder generations when probed
+	};
+
+	// State of one lookup between the locked sections.
+	struct ovrPending
+	{
+		int				Index;			// into the names
+		int				FolderSet;
+		uint32_t		Generation;
+		bool			Cacheable;
+		int				FoundIndex;
+		String			FullPath;
+	};
+
+	Mutex				CacheMutex;
+	double				RevalidateSeconds;
+	uint32_t			FlushCount;
+
+	Array< ovrSearchList >			SearchLists;
+	Hash< uint64_t, int >			SearchListIndex;
+	Array< ovrFolder >				Folders;
+	Hash< String, int, String::HashFunctor >	FolderIndex;
+	Array< ovrFolderSet >			FolderSets;
+	Hash< String, int, String::HashFunctor >	FolderSetIndex;		// "<search list>:<sub folder>"
+	Array< ovrEntry >				Entries;
+	Hash< uint64_t, int >			EntryIndex;
+	int								LastFolderSetList;
+	String							LastFolderSetSubFolder;
+	int								LastFolderSet;
+
+	int					NumHits;
+	int					NumMisses;
+	int					NumProbes;
+
+	static uint64_t		HashSearchPaths( const Array< String > & searchPaths );
+	static uint64_t		HashName( const uint64_t listHash, const char * relativePath );
+
+	int					FindSearchList( const Array< String > & searchPaths, const uint64_t listHash ) const;
+	int					AddSearchList( const Array< String > & searchPaths, const uint64_t listHash );
+	int					FindOrAddFolder( const String & path );
+	int					FindOrAddFolderSet( const int searchList, const char * relativePath );
+	// Returns false if the folder can not be trusted to show changes.
+	bool				ValidateFolder( const int folder, const double now );
+	bool				ValidateFolderSet( const int folderSet, const double now, uint32_t & generation );
+	const ovrEntry *	FindEntry( const int searchList, const uint64_t key, const char * relativePath, const double now );
+	void				BeginLookup( const int searchList, const uint64_t key, const char * relativePath,
+									 const double now, ovrPending & pending, bool & hit );
+	void				AddEntry( const int searchList, const uint64_t key, const char * relativePath, const ovrPending & pending );
+
+	int					Probe( const Array< String > & searchPaths, const char * relativePath, String & outPath );
+	void				ProbeBatch( const Array< String > & searchPaths, const Array< String > & relativePaths,
+									Array< ovrPending > & pending );
+};
+
+} // namespace OVR
+
+#endif // OVR_PathCache_h
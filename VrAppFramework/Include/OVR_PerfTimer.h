@@ -13,6 +13,7 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 #define OVR_PerfTimer_h
 
 #include "Kernel/OVR_LogUtils.h"
+#include "OVR_Profiler.h"
 
 namespace OVR
 {
@@ -134,11 +135,15 @@ private:
 //
 // On exiting the scope, ovrPerfTimer will deconstruct and output the
 // time spent in the scope.
+//
+// If OVR_USE_PROFILER is defined, with or without OVR_USE_PERF_TIMER, every
+// timer and accumulated timer scope is also recorded as an ovrProfileZone,
+// see OVR_Profiler.h.
 
 #if defined( OVR_USE_PERF_TIMER )
-#	define OVR_PERF_TIMER( name_ )	ovrPerfTimer name_##_Timer( #name_, nullptr )
+#	define OVR_PERF_TIMER( name_ )	ovrPerfTimer name_##_Timer( #name_, nullptr ); OVR_PROFILE_ZONE( name_ )
 #else
-#	define OVR_PERF_TIMER( name_ ) 
+#	define OVR_PERF_TIMER( name_ ) OVR_PROFILE_ZONE( name_ )
 #endif // OVR_USE_PERF_TIMER
 
 // To accumulate a timer over multiple passes use OVR_PERF_ACCUMULATOR() with the same
@@ -151,7 +156,7 @@ private:
 // accumulator.
 #if defined( OVR_USE_PERF_TIMER )
 #	define OVR_PERF_ACCUMULATOR( name_ ) ovrPerfTimerAccumulator name_##_Accumulator( #name_ )
-#	define OVR_PERF_ACCUMULATE( name_ ) ovrPerfTimer name_##_Timer( #name_, & name_##_Accumulator )
+#	define OVR_PERF_ACCUMULATE( name_ ) ovrPerfTimer name_##_Timer( #name_, & name_##_Accumulator ); OVR_PROFILE_ZONE( name_ )
 #	define OVR_PERF_REPORT( name_ ) name_##_Accumulator.Report( nullptr )
 #	define OVR_PERF_REPORT_MSG( name_, msg_ ) name_##_Accumulator.Report( msg_ )
 #	define OVR_PERF_ACCUMULATOR_EXTERN( name_ ) extern ovrPerfTimerAccumulator name_##_Accumulator
@@ -159,7 +164,7 @@ private:
 #	define OVR_PERF_TIMER_STOP_MSG( name_, msg_ ) name_##_Timer.Stop( msg_, true )
 #else
 #	define OVR_PERF_ACCUMULATOR( name_ ) 
-#	define OVR_PERF_ACCUMULATE( name_ ) 
+#	define OVR_PERF_ACCUMULATE( name_ ) OVR_PROFILE_ZONE( name_ )
 #	define OVR_PERF_REPORT( name_ )
 #	define OVR_PERF_REPORT_MSG( name_, msg_ )
 #	define OVR_PERF_ACCUMULATOR_EXTERN( name_ ) 
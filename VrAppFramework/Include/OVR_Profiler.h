@@ -0,0 +1,253 @@
+/************************************************************************************
+
+Filename    :   OVR_Profiler.h
+Content     :   Hierarchical per-thread CPU zone profiler with latency histograms.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#if !defined( OVR_Profiler_h )
+#define OVR_Profiler_h
+
+#include <time.h>
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#endif
+#include "Kernel/OVR_Types.h"
+#include "Kernel/OVR_Atomic.h"
+#include "Kernel/OVR_String.h"
+
+namespace OVR
+{
+
+//==============================================================
+// ovrLatencyHistogram
+//
+// Log-linear histogram of durations in nanoseconds, in the style of an HDR
+// histogram: every power of two is split into 16 linear buckets, so any
+// percentile is within about 6% of the exact value over the whole range from
+// 1 ns to 4 s. The minimum, maximum and total are exact.
+class ovrLatencyHistogram
+{
+public:
+	static const int	SUB_BUCKET_BITS = 4;
+	static const int	SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+	static const int	NUM_BUCKETS = ( 32 - SUB_BUCKET_BITS + 1 ) * SUB_BUCKETS;
+
+						ovrLatencyHistogram() { Clear(); }
+
+	void				Clear();
+	void				Add( const uint32_t nanoseconds );
+
+	uint32_t			GetCount() const { return Count; }
+	uint64_t			GetTotal() const { return Total; }
+	uint32_t			GetMin() const { return Count > 0 ? Min : 0; }
+	uint32_t			GetMax() const { return Max; }
+	// fraction in [0, 1], e.g. 0.99 for the 99th percentile.
+	uint32_t			GetPercentile( const double fraction ) const;
+
+	static int			BucketForValue( const uint32_t nanoseconds );
+	static uint32_t		BucketLowerBound( const int bucket );
+
+private:
+	uint32_t			Count;
+	uint32_t			Min;
+	uint32_t			Max;
+	uint64_t			Total;
+	uint32_t			Buckets[NUM_BUCKETS];
+};
+
+//==============================================================
+// ovrProfileThread
+//
+// The recording state of one thread. Zones form a tree per thread: a zone
+// entered from two different parents gets two nodes. The owning thread writes
+// one event per zone exit into a ring buffer; ovrProfiler::Update() drains the
+// rings of all threads from another thread without ever blocking the writers.
+// When the writer laps the reader the oldest events are dropped and counted.
+//
+// Events are timed in raw counter ticks, which are cheaper to read than the
+// monotonic clock, and converted to nanoseconds when they are drained. Zones
+// longer than 2^32 ticks (1.4 s at 3 GHz) are clamped.
+//
+// Nodes are only appended and their name and parent never change once the
+// node count is published, so the reader can walk them without a lock.
+// Threads register on their first zone and are never unregistered, so the
+// zones of finished threads stay in the report.
+class ovrProfileThread
+{
+public:
+	static const int	MAX_NODES = 1024;
+	static const int	MAX_EVENTS = 16384;		// power of two
+	static const int	ROOT_NODE = 0;
+	static const int	OVERFLOW_NODE = 1;		// all zones past MAX_NODES are recorded here
+
+	static ovrProfileThread *	Get()
+	{
+		ovrProfileThread * thread = Current;
+		return ( thread != nullptr ) ? thread : Register();
+	}
+
+	static uint64_t		GetNanoseconds()
+	{
+		struct timespec now;
+		clock_gettime( CLOCK_MONOTONIC, &now );
+		return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+	}
+
+	// The time stamp counter on x86 and the virtual counter on ARMv8, which is
+	// also what the monotonic clock reads there. Other CPUs use the clock.
+	static uint64_t		GetTicks()
+	{
+#if defined( __x86_64__ ) || defined( __i386__ )
+		return __rdtsc();
+#elif defined( __aarch64__ )
+		uint64_t ticks;
+		asm volatile( "mrs %0, cntvct_el0" : "=r" ( ticks ) );
+		return ticks;
+#else
+		return GetNanoseconds();
+#endif
+	}
+
+	int					Enter( const char * name )
+	{
+		// Most zones are entered from the same parent every time, so check
+		// the child that was entered last from this parent first.
+		ovrProfileNode & parent = Nodes[CurrentNode];
+		int node = parent.LastChild;
+		if ( node < 0 || Nodes[node].Name != name )
+		{
+			node = FindChild( CurrentNode, name );
+			parent.LastChild = node;
+		}
+		CurrentNode = node;
+		return node;
+	}
+
+	void				Leave( const int node, const uint64_t ticks )
+	{
+		ovrProfileEvent & event = Events[WriteIndex & ( MAX_EVENTS - 1 )];
+		event.Node = node;
+		event.Ticks = ( ticks < 0xFFFFFFFFull ) ? (uint32_t)ticks : 0xFFFFFFFF;
+		WriteIndex++;
+		PublishedWriteIndex.Store_Release( WriteIndex );
+		CurrentNode = Nodes[node].Parent;
+	}
+
+	// Read by ovrProfiler on other threads, see the class comment.
+	struct ovrProfileNode
+	{
+		const char *	Name;			// zones are identified by the name pointer
+		int				Parent;
+		int				LastChild;		// owner thread only
+		int				FirstChild;		// owner thread only
+		int				NextSibling;	// owner thread only
+	};
+
+	struct ovrProfileEvent
+	{
+		uint32_t		Node;
+		uint32_t		Ticks;
+	};
+
+	String					Name;				// guarded by the profiler lock
+	int						CurrentNode;
+	int						NumNodesLocal;
+	AtomicInt< uint32_t >	NumNodes;
+	uint32_t				WriteIndex;
+	AtomicInt< uint32_t >	PublishedWriteIndex;
+	ovrProfileNode			Nodes[MAX_NODES];
+	ovrProfileEvent			Events[MAX_EVENTS];
+
+private:
+	friend class ovrProfiler;
+
+	static thread_local ovrProfileThread *	Current;
+
+							ovrProfileThread();
+
+	static ovrProfileThread *	Register();
+	int						FindChild( const int parent, const char * name );
+	int						AddNode( const int parent, const char * name );
+};
+
+//==============================================================
+// ovrProfileZone
+//
+// Times the enclosing scope as a child of the zone the thread is currently in.
+// The name must be a string literal, or otherwise live as long as the process.
+class ovrProfileZone
+{
+public:
+	explicit			ovrProfileZone( const char * name ) :
+							Thread( ovrProfileThread::Get() ),
+							Node( Thread->Enter( name ) ),
+							Start( ovrProfileThread::GetTicks() )
+						{
+						}
+						~ovrProfileZone()
+						{
+							Thread->Leave( Node, ovrProfileThread::GetTicks() - Start );
+						}
+
+private:
+	ovrProfileThread *	Thread;
+	int					Node;
+	uint64_t			Start;
+
+	ovrProfileZone( ovrProfileZone const & ) = delete;
+	ovrProfileZone & operator = ( ovrProfileZone const & ) = delete;
+};
+
+//==============================================================
+// ovrProfiler
+//
+// Aggregates the zones recorded on all threads into one latency histogram per
+// zone node. All functions are thread safe; they serialize on one lock that the
+// recording threads only take once, when they register.
+class ovrProfiler
+{
+public:
+	// Names the calling thread in the reports. Threads default to "Thread <n>".
+	// If the thread has not recorded a zone yet, name must stay valid until it does.
+	static void			SetThreadName( const char * name );
+
+	// Moves the events recorded since the last call into the histograms.
+	// Call at least once every MAX_EVENTS zones per thread, e.g. once a frame.
+	static void			Update();
+	// Clears the histograms, but keeps the zone tree.
+	static void			Reset();
+
+	// Both drain the rings first. Times are in microseconds.
+	static void			DumpText( StringBuffer & out );
+	static void			DumpJson( StringBuffer & out );
+
+	// Events lost because a thread recorded more than MAX_EVENTS zones between updates.
+	static uint32_t		GetNumDroppedEvents();
+};
+
+// To profile a scope, define OVR_USE_PROFILER, then include OVR_Profiler.h
+// (or OVR_PerfTimer.h, which then also profiles every OVR_PERF_TIMER and
+// OVR_PERF_ACCUMULATE scope):
+//
+// #define OVR_USE_PROFILER
+// #include "OVR_Profiler.h"
+//
+// void Frame()
+// {
+//     OVR_PROFILE_ZONE( Frame );
+//     [... code to time...]
+// }
+#if defined( OVR_USE_PROFILER )
+#	define OVR_PROFILE_ZONE( name_ )	ovrProfileZone name_##_Zone( #name_ )
+#else
+#	define OVR_PROFILE_ZONE( name_ )
+#endif // OVR_USE_PROFILER
+
+} // namespace OVR
+
+#endif // OVR_Profiler_h
@@ -0,0 +1,95 @@
+/************************************************************************************
+
+Filename    :   OVR_TextureLoader.h
+Content     :   Decodes textures on worker threads and uploads them on the GL thread.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#if !defined( OVR_TextureLoader_h )
+#define OVR_TextureLoader_h
+
+#include "Kernel/OVR_TypesafeNumber.h"
+#include "Kernel/OVR_MemBuffer.h"
+#include "GlTexture.h"
+
+namespace OVR {
+
+class ovrFileSys;
+
+enum ovrAsyncTextureHandle
+{
+	INVALID_ASYNC_TEXTURE_HANDLE = -1
+};
+
+typedef TypesafeNumberT< int, ovrAsyncTextureHandle, INVALID_ASYNC_TEXTURE_HANDLE > asyncTextureHandle_t;
+
+enum ovrAsyncTextureState
+{
+	ASYNC_TEXTURE_INVALID,	// the handle doesn't refer to a request
+	ASYNC_TEXTURE_PENDING,	// still being read, decoded or waiting for an upload slot
+	ASYNC_TEXTURE_READY,	// uploaded, GetTexture() returns the real texture
+	ASYNC_TEXTURE_FAILED	// the load failed, GetTexture() keeps returning the placeholder
+};
+
+//==============================================================
+// ovrTextureLoader
+//
+// Splits texture loading into a CPU stage (file read, decode, mip generation)
+// that runs on an ovrWorkerPool and an upload stage that runs in Update() on the
+// GL thread with a time budget, so loads never stall a frame for long. Requests
+// are decoded in the order they are made, each one as soon as a worker is free.
+//
+// Each load returns a handle. Until the upload has happened GetTexture() returns
+// a shared placeholder texture, so callers can render with it immediately.
+// Once a request is READY its texture belongs to the caller; the request itself
+// must be released with FreeRequest().
+class ovrTextureLoader
+{
+public:
+	virtual ~ovrTextureLoader() {}
+
+	// Must be called on the GL thread, the placeholder texture is created here.
+	static ovrTextureLoader *	Create( int const numThreads );
+	static void					Destroy( ovrTextureLoader * & loader );
+
+	// Reads the uri on a worker thread. The file system must outlive the loader.
+	virtual asyncTextureHandle_t	LoadTextureFromUri( ovrFileSys & fileSys, char const * uri,
+											TextureFlags_t const & flags ) = 0;
+	// Reads a file system path on a worker thread.
+	virtual asyncTextureHandle_t	LoadTextureFromFile( char const * path, TextureFlags_t const & flags ) = 0;
+	// Takes ownership of the buffer. fileName is only used for its extension and logging.
+	virtual asyncTextureHandle_t	LoadTextureFromBuffer( char const * fileName, MemBufferT< uint8_t > & buffer,
+											TextureFlags_t const & flags ) = 0;
+	// Takes ownership of the buffer, which holds a zip entry read raw. The entry is
+	// inflated and its crc is checked on a worker thread before the decode.
+	virtual asyncTextureHandle_t	LoadTextureFromZipEntry( char const * fileName, MemBufferT< uint8_t > & buffer,
+											int const compressionMethod, int const uncompressedSize,
+											uint32_t const crc, TextureFlags_t const & flags ) = 0;
+	// Queues an image that was decoded elsewhere for the budgeted upload. The image
+	// must own its data, which is taken over; image is left empty.
+	virtual asyncTextureHandle_t	LoadTextureFromImage( char const * fileName, ovrTextureImage & image ) = 0;
+
+	// Uploads decoded textures until uploadBudgetSeconds is spent. At least one texture
+	// is uploaded per call if any is waiting, so a large texture can't starve.
+	// Returns the number of textures uploaded. Call once per frame on the GL thread.
+	virtual int						Update( double const uploadBudgetSeconds ) = 0;
+
+	virtual ovrAsyncTextureState	GetState( asyncTextureHandle_t const handle ) const = 0;
+	// Returns the loaded texture once READY, otherwise the placeholder.
+	virtual GlTexture				GetTexture( asyncTextureHandle_t const handle ) const = 0;
+
+	// Forgets the request. A pending load is discarded; an uploaded texture stays with the caller.
+	// The handle is INVALID from then on, also after its slot is reused by a new request.
+	virtual void					FreeRequest( asyncTextureHandle_t const handle ) = 0;
+
+	// Number of requests that have not been decoded or uploaded yet.
+	virtual int						GetNumPending() const = 0;
+};
+
+} // namespace OVR
+
+#endif // OVR_TextureLoader_h
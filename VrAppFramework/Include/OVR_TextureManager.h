@@ -118,8 +118,18 @@ public:
 										ovrTextureFilter const filterType = FILTER_DEFAULT,
 										ovrTextureWrap const wrapType = WRAP_DEFAULT ) = 0;
 
+	// Releases one reference to the texture. Every successful load, including loads that
+	// return an already loaded texture, adds a reference. Once the last reference is
+	// released the texture is either deleted or, if a memory budget is set, kept around
+	// until the least-recently-used unreferenced textures must be evicted.
 	virtual void				FreeTexture( textureHandle_t const handle ) = 0;
 
+	// Sets the GPU memory that textures may occupy. Unreferenced textures are
+	// kept for reuse until this budget is exceeded. 0 (the default) deletes textures as
+	// soon as their last reference is released.
+	virtual void				SetMemoryBudget( size_t const budgetBytes ) = 0;
+	virtual size_t				GetMemoryUsed() const = 0;
+
 	virtual ovrManagedTexture	GetTexture( textureHandle_t const handle ) const = 0;
 	virtual GlTexture			GetGlTexture( textureHandle_t const handle ) const = 0;
 	
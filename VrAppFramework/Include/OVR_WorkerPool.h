@@ -0,0 +1,99 @@
+/************************************************************************************
+
+Filename    :   OVR_WorkerPool.h
+Content     :   Persistent worker threads for splitting per-frame work.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#if !defined( OVR_WorkerPool_h )
+#define OVR_WorkerPool_h
+
+#include "Kernel/OVR_Types.h"
+#include "Kernel/OVR_Array.h"
+#include "Kernel/OVR_Threads.h"
+
+namespace OVR
+{
+
+// Runs task number task, 0 <= task < numTasks.
+typedef void ( *ovrWorkerTaskFunc )( void * data, const int task );
+
+//==============================================================
+// ovrWorkerPool
+//
+// A few threads that stay asleep until Run() hands them tasks. Unlike starting
+// threads for each call, this is cheap enough to do several times per frame.
+// The calling thread works on the tasks too, and Run() returns once all of
+// them are done. Start() and Wait() split Run() in two, so the caller can do
+// work of its own while the workers get going. The tasks are handed out in order, but finish in any order, so
+// results that must be deterministic should be written per task and merged by
+// the caller.
+//
+// Run() and Start() must only be called from one thread at a time.
+class ovrWorkerPool
+{
+public:
+							ovrWorkerPool();
+							~ovrWorkerPool();
+
+	// The smallest jobs worth handing to the pool, smaller ones are done on the
+	// calling thread. Waking the workers and waiting for the last task costs
+	// some tens of microseconds, which is about how long one core takes to cull
+	// 256 models (ModelRenderBench) or to animate 1024 joints (JointAnimationBench).
+	// A texture decode takes much longer, so a model load hands even one to the
+	// pool it is given.
+	static const int		MIN_PARALLEL_CULL_MODELS = 256;
+	static const int		MIN_PARALLEL_ANIMATION_JOINTS = 1024;
+
+	// Starts numThreads workers in addition to the calling thread. With 0
+	// workers, Run() executes the tasks on the calling thread. Background work
+	// that must not compete with the frame can use a lower priority.
+	void					Init( const int numThreads, const Thread::ThreadPriority priority = Thread::NormalPriority );
+	void					Shutdown();
+
+	bool					IsInitialized() const { return Initialized; }
+	// The number of threads that execute tasks, including the caller of Run().
+	int						GetNumThreads() const { return Threads.GetSizeI() + 1; }
+
+	void					Run( const int numTasks, ovrWorkerTaskFunc func, void * data );
+
+	// Hands the tasks to the workers and returns at once. Every Start() must be
+	// followed by a Wait(), which runs any tasks the workers haven't picked up on
+	// the calling thread and returns once all of them are done.
+	void					Start( const int numTasks, ovrWorkerTaskFunc func, void * data );
+	void					Wait();
+	// True once the workers have finished every task of the last Start(), so that
+	// Wait() returns without blocking. Lets work started in one frame be collected
+	// in a later one. With 0 workers the tasks only run in Wait().
+	bool					IsFinished();
+
+private:
+	Array< Thread * >		Threads;
+	Mutex					TaskMutex;
+	WaitCondition			TaskCondition;		// signaled when tasks are added or on shutdown
+	WaitCondition			DoneCondition;		// signaled when the last task finishes
+	ovrWorkerTaskFunc		TaskFunc;
+	void *					TaskData;
+	int						NumTasks;
+	int						NextTask;
+	int						NumUnfinished;
+	bool					Exiting;
+	bool					Initialized;
+
+	// Runs tasks until none are left to start.
+	void					RunTasks();
+
+	static threadReturn_t	ThreadFn( Thread * thread, void * data );
+
+	// not copyable
+							ovrWorkerPool( const ovrWorkerPool & );
+	ovrWorkerPool &			operator = ( const ovrWorkerPool & );
+};
+
+} // namespace OVR
+
+#endif // OVR_WorkerPool_h
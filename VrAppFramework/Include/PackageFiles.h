@@ -13,6 +13,8 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 #define OVRPACKAGEFILES_H
 
 #include "Kernel/OVR_MemBuffer.h"
+#include "Kernel/OVR_Array.h"
+#include "Kernel/OVR_String.h"
 
 // The application package is the moral equivalent of the filesystem, so
 // I don't feel too bad about making it globally accessible, versus requiring
@@ -52,10 +54,21 @@ void			ovr_CloseOtherApplicationPackage( void * & zipFile );
 // These are probably NOT thread safe!
 bool			ovr_OtherPackageFileExists( void * zipFile, const char * nameInZip );
 
+// Appends the names of all files in the package, in the order they are stored.
+// Folders that are stored explicitly end in a slash.
+void			ovr_ListOtherApplicationPackage( void * zipFile, Array< String > & outNames );
+
 // Returns NULL buffer if the file is not found.
 bool			ovr_ReadFileFromOtherApplicationPackage( void * zipFile, const char * nameInZip, int & length, void * & buffer );
 bool			ovr_ReadFileFromOtherApplicationPackage( void * zipFile, const char * nameInZip, MemBufferT< uint8_t > & buffer );
 
+// Returns the contents of a zip entry that was read raw (unzOpenCurrentFile2 with raw set),
+// inflated into 'inflated' if the entry is deflated, or NULL if it can't be inflated or its
+// crc doesn't match. It doesn't touch the package, so it can run on any thread.
+const uint8_t *	ovr_InflateZipEntry( const char * nameInZip, const uint8_t * data, const int dataSize,
+						const int compressionMethod, const int uncompressedSize, const uint32_t crc,
+						MemBufferT< uint8_t > & inflated );
+
 
 //--------------------------------------------------------------
 // Functions for reading assets from this process's application package
@@ -76,6 +89,14 @@ const char *	ovr_GetApplicationPackageCachePath();
 // back in much faster.
 void			ovr_OpenApplicationPackage( const char * packageName, const char * cachePath );
 
+// Limits the total size of the files extracted to the cachePath. The least
+// recently used files are deleted to stay under the budget, and files larger
+// than the budget are not cached at all. Defaults to 128 MB.
+void			ovr_SetApplicationPackageCacheBudget( const size_t maxBytes );
+
+// Returns the number of bytes currently used by extracted files in the cachePath.
+size_t			ovr_GetApplicationPackageCacheSize();
+
 // These are probably NOT thread safe!
 bool			ovr_PackageFileExists( const char * nameInZip );
 
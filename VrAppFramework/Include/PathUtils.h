@@ -85,6 +85,15 @@ String	GetFullPath		( const Array< String > & searchPaths, const String & relati
 bool	GetFullPath		( const Array< String > & searchPaths, char const * relativePath, 	char * outPath, 	const int outMaxLen );
 bool	GetFullPath		( const Array< String > & searchPaths, char const * relativePath, 	String & outPath 						);
 
+// Resolves each of relativePaths like GetFullPath, but probes the uncached ones one folder
+// at a time. outPaths[i] is empty if relativePaths[i] was not found. Returns the number found.
+int		GetFullPaths	( const Array< String > & searchPaths, const Array< String > & relativePaths, Array< String > & outPaths );
+
+// GetFullPath remembers where each path was found, or that it was not, until the folders
+// it was looked for in change (see ovrPathCache). Flush after creating or deleting a file
+// that has to be found, or not found, right away.
+void	FlushFullPathCache();
+
 bool	ToRelativePath	( const Array< String > & searchPaths, char const * fullPath, 		char * outPath, 	const int outMaxLen );
 bool	ToRelativePath	( const Array< String > & searchPaths, char const * fullPath, 		String & outPath 						);
 
@@ -13,6 +13,7 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 
 #include "Kernel/OVR_Math.h"
 #include "Kernel/OVR_Array.h"
+#include "Kernel/OVR_Hash.h"
 #include "Kernel/OVR_String.h"
 #include "Kernel/OVR_GlUtils.h"
 
@@ -55,7 +56,9 @@ struct ovrDrawCounters
 				numProgramBinds( 0 ),
 				numParameterUpdates( 0 ),
 				numTextureBinds( 0 ),
-				numBufferBinds( 0 ) {}
+				numBufferBinds( 0 ),
+				numUniformsSkipped( 0 ),
+				numBindsSkipped( 0 ) {}
 
 	int		numElements;
 	int		numDrawCalls;
@@ -63,6 +66,8 @@ struct ovrDrawCounters
 	int		numParameterUpdates;		// MVP, etc
 	int		numTextureBinds;
 	int		numBufferBinds;
+	int		numUniformsSkipped;			// glUniform calls dropped because the program already had the value
+	int		numBindsSkipped;			// texture, buffer and texture unit binds dropped because nothing changed
 };
 
 struct ovrDrawSurface
@@ -97,6 +102,97 @@ struct ovrDrawSurface
 	const ovrSurfaceDef *		surface;
 };
 
+//==============================================================
+// Draw order sort keys
+//
+// The packed 64 bit key, from the most significant bit:
+//   4 bits  layer, lower layers are drawn first
+//   1 bit   blend, opaque surfaces are drawn before blended ones
+// opaque:
+//  12 bits  program, so surfaces with the same program are drawn together
+//  12 bits  material, the first texture
+//  24 bits  view depth, front-to-back for early depth rejection
+// blended:
+//  24 bits  view depth, back-to-front for correct blending
+//  12 bits  program
+//  12 bits  material
+// Program and texture names are truncated, a collision only costs a state change.
+
+// viewDepth is the distance along the view direction, larger values are farther away.
+uint64_t				DrawSortKey( const ovrSurfaceDef & surfaceDef, const float viewDepth, const int layer = 0 );
+
+// Scratch memory of SortSurfaceList, kept by the caller between frames so
+// sorting does not allocate every frame.
+struct ovrSurfaceSortBuffers
+{
+	typedef ArrayConstPolicy< 0, 16, true >	FramePolicy;	// keeps its memory when cleared
+
+	Array< int, FramePolicy >				Order;
+	Array< int, FramePolicy >				Temp;
+	Array< ovrDrawSurface, FramePolicy >	Sorted;
+};
+
+// Stable radix sort of the surfaces by the sort keys, one key per surface.
+// Surfaces with identical keys keep their order, so the result is the same every frame.
+void					SortSurfaceList( Array< ovrDrawSurface > & surfaceList, const uint64_t * sortKeys,
+										 ovrSurfaceSortBuffers & buffers );
+
+//==============================================================
+// ovrUniformShadowCache
+//
+// Remembers the last value sent to each uniform of each program, so unchanged
+// glUniform calls can be dropped. Uniform values are stored in the GL program
+// object, so they survive switching to another program and back. Other code can
+// set uniforms on the same programs, so Reset() must be called before the cache
+// is used again after other code had a chance to run.
+class ovrUniformShadowCache
+{
+public:
+	// Slots below ovrUniform::MAX_UNIFORMS are the program parms.
+	enum ovrShadowSlot
+	{
+		SLOT_VIEW_ID = ovrUniform::MAX_UNIFORMS,
+		SLOT_MODEL_MATRIX,
+		SLOT_VIEW_MATRIX,
+		SLOT_PROJECTION_MATRIX,
+		SLOT_DEPRECATED_MVP,
+		SLOT_DEPRECATED_MODEL,
+		SLOT_DEPRECATED_VALUES,		// one slot per ovrGraphicsCommand::uniformValues
+		SLOT_MAX = SLOT_DEPRECATED_VALUES + ovrUniform::MAX_UNIFORMS
+	};
+
+	// Larger values, e.g. joint arrays, are never cached.
+	static const int		MAX_VALUE_SIZE = GlProgram::MAX_VIEWS * sizeof( Matrix4f );
+
+							ovrUniformShadowCache();
+
+	// Forgets all values in constant time.
+	void					Reset();
+	// A disabled cache reports every value as changed.
+	void					SetEnabled( const bool enabled ) { Enabled = enabled; }
+	// Selects the program the following Update calls refer to.
+	void					SetProgram( const unsigned int program );
+	// Returns true if the value has to be sent, i.e. it differs from the value last
+	// recorded for this slot of the current program, and records it.
+	bool					Update( const int slot, const void * value, const int size );
+
+private:
+	struct ovrProgramValues
+	{
+		unsigned int		Program;
+		uint32_t			Serial;				// the values are only valid if this matches the cache serial
+		uint32_t			ValidMask;			// one bit per slot
+		uint8_t				Sizes[SLOT_MAX];
+		uint8_t				Values[SLOT_MAX][MAX_VALUE_SIZE];
+	};
+
+	Array< ovrProgramValues >	Programs;
+	Hash< unsigned int, int >	ProgramIndex;
+	uint32_t				Serial;
+	int						Current;			// index in Programs, -1 if no program is selected
+	bool					Enabled;
+};
+
 class ovrSurfaceRender
 {
 public:
@@ -114,6 +210,12 @@ public:
 											   const Matrix4f & viewMatrix,
 											   const Matrix4f & projectionMatrix,
 											   const int eye = -1 );
+
+	// RenderSurfaceList drops uniform updates, binds and blend functions that would not
+	// change the GL state. With filtering off they are sent for every surface, which
+	// draws the same and is only useful to check the filtering.
+	void					SetFilterRedundantCalls( const bool filter );
+
 private:
 	// Returns the index of the updated SceneMatrices UBO.
 	int						UpdateSceneMatrices( const Matrix4f * viewMatrix,
@@ -130,6 +232,9 @@ private:
 
 	Matrix4f				CachedViewMatrix[GlProgram::MAX_VIEWS];
 	Matrix4f				CachedProjectionMatrix[GlProgram::MAX_VIEWS];
+
+	ovrUniformShadowCache	UniformCache;
+	bool					FilterRedundantCalls;
 };
 
 // Set this true for log spew from BuildDrawSurfaceList and RenderSurfaceList.
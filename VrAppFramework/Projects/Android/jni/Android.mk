@@ -57,7 +57,13 @@ LOCAL_SRC_FILES  := ../../../Src/BitmapFont.cpp \
                     ../../../Src/OVR_Stream.cpp \
                     ../../../Src/DebugConsole.cpp \
 					../../../Src/JobManager.cpp \
-                    ../../../Src/OVR_TextureManager.cpp
+                    ../../../Src/OVR_TextureManager.cpp \
+                    ../../../Src/OVR_TextureLoader.cpp \
+                    ../../../Src/OVR_Profiler.cpp \
+                    ../../../Src/OVR_FrameStats.cpp \
+                    ../../../Src/OVR_PathCache.cpp \
+                    ../../../Src/OVR_MountTable.cpp \
+                    ../../../Src/OVR_WorkerPool.cpp
 
 # GL platform interface
 LOCAL_EXPORT_LDLIBS += -lEGL
@@ -45,6 +45,7 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 #include "OVR_Uri.h"
 #include "OVR_FileSys.h"
 #include "OVR_TextureManager.h"
+#include "OVR_TextureLoader.h"
 #include "OVR_Input.h"
 #include "DebugConsole.h"
 
@@ -68,6 +69,12 @@ static double AppLocalConstructTime = -1.0;	// time when AppLocal was constructe
 // name and URI cannot. The handler will use sscanf() to parse the first two strings, then
 // assume the JSON text is everything immediately following the space after the URI string.
 static const char * EMPTY_INTENT_STR = "<EMPTY>";
+
+// Texture decoding runs below the priority of the VR thread, the uploads take at
+// most this long per frame unless a single texture takes longer.
+static const int TEXTURE_LOADER_THREADS = 2;
+static const double TEXTURE_UPLOAD_BUDGET_SECONDS = 0.002;
+
 void ComposeIntentMessage( char const * packageName, char const * uri, char const * jsonText, 
 		char * out, size_t outSize )
 {
@@ -226,6 +233,8 @@ AppLocal::AppLocal( JNIEnv & jni_, jobject activityObject_, VrAppInterface & int
 	, InputEvents()
 	, TheVrFrame()
 	, EnteredVrModeFrame( 0 )
+	, FrameStats()
+	, DisplayRefreshRate( 60.0 )
 	, VrThread( &ThreadStarter, this, 256 * 1024 )
 	, ExitCode( 0 )
 	, RecenterYawFrameStart( 0 )
@@ -237,6 +246,7 @@ AppLocal::AppLocal( JNIEnv & jni_, jobject activityObject_, VrAppInterface & int
 	, ErrorMessageEndTime( -1.0 )
 	, FileSys( nullptr )
 	, TextureManager( nullptr )
+	, TextureLoader( nullptr )
 {
 	LOG( "----------------- AppLocal::AppLocal() -----------------");
 
@@ -715,6 +725,7 @@ void AppLocal::InitGlObjects()
 	//--- MV_INVALIDATE_WORKAROUND	
 
 	TextureManager = ovrTextureManager::Create();
+	TextureLoader = ovrTextureLoader::Create( TEXTURE_LOADER_THREADS );
 
 	SurfaceRender.Init();
 
@@ -1120,6 +1131,25 @@ void AppLocal::Command( const char * msg )
 		return;	
 	}
 
+	if ( MatchesHead( "framestats ", msg ) )
+	{
+		const char * parms = msg + 11;
+		if ( MatchesHead( "reset", parms ) )
+		{
+			FrameStats.Reset();
+			LOG( "Frame stats reset" );
+		}
+		else if ( parms[0] >= '0' && parms[0] <= '9' )
+		{
+			FrameStats.SetLogPeriod( atof( parms ) );
+		}
+		else
+		{
+			FrameStats.LogSummary();
+		}
+		return;
+	}
+
 	if ( MatchesHead( "intent ", msg ) )
 	{
 		LOG( "%p msg: intent", this );
@@ -1210,6 +1240,54 @@ void AppLocal::FrameworkInputProcessing( const VrInput & input )
 	}
 }
 
+// "profile" logs the zone profile of all threads, "profile json <file>" writes it
+// to a file as JSON and "profile reset" starts over. Zones are only recorded in
+// files compiled with OVR_USE_PROFILER.
+static void ProfileCommand( void * appPtr, const char * cmd )
+{
+	OVR_UNUSED( appPtr );
+
+	if ( OVR_strncmp( cmd, "reset", 5 ) == 0 )
+	{
+		ovrProfiler::Reset();
+		LOG( "Profile reset" );
+		return;
+	}
+
+	StringBuffer out;
+	if ( OVR_strncmp( cmd, "json ", 5 ) == 0 )
+	{
+		ovrProfiler::DumpJson( out );
+		FILE * f = fopen( cmd + 5, "wb" );
+		const bool ok = ( f != NULL ) && fwrite( out.ToCStr(), 1, out.GetSize(), f ) == out.GetSize();
+		if ( f != NULL )
+		{
+			fclose( f );
+		}
+		LOG( "%s profile '%s'", ok ? "Wrote" : "Failed to write", cmd + 5 );
+		return;
+	}
+
+	// one line at a time, the log truncates long messages
+	ovrProfiler::DumpText( out );
+	const char * line = out.ToCStr();
+	while ( *line != '\0' )
+	{
+		const char * end = strchr( line, '\n' );
+		const int length = ( end != NULL ) ? (int)( end - line ) : (int)strlen( line );
+		LOG_WITH_TAG( "OVRProfile", "%.*s", length, line );
+		line += length + ( end != NULL ? 1 : 0 );
+	}
+}
+
+// "framestats" logs the frame statistics of the VR thread, "framestats <seconds>"
+// logs them periodically, zero stops it, and "framestats reset" starts over.
+// The console runs on another thread, so the command is passed on to the VR thread.
+static void FrameStatsCommand( void * appPtr, const char * cmd )
+{
+	static_cast< AppLocal * >( appPtr )->GetMessageQueue().PostPrintf( "framestats %s", cmd );
+}
+
 #if defined( OVR_OS_WIN32 )
 static void GetInputEvents( ovrInputEvents & inputEvents )
 {
@@ -1265,6 +1343,13 @@ void * AppLocal::VrThreadFunction()
 		// Init the adb 'console' and register console functions
 		InitConsole( Java );
 		RegisterConsoleFunction( "print", OVR::DebugPrint );
+		RegisterConsoleFunction( "profile", ProfileCommand );
+		RegisterConsoleFunction( "framestats", FrameStatsCommand );
+
+		const int refreshRate = vrapi_GetSystemPropertyInt( &Java, VRAPI_SYS_PROP_DISPLAY_REFRESH_RATE );
+		DisplayRefreshRate = ( refreshRate > 0 ) ? refreshRate : 60.0;
+
+		ovrProfiler::SetThreadName( "VrThread" );
 	}
 
 	while( !( VrThreadSynced && ReadyToExit ) )
@@ -1287,6 +1372,8 @@ void * AppLocal::VrThreadFunction()
 		// Wait for messages until we are in VR mode.
 		if ( OvrMobile == NULL )
 		{
+			// Don't count the time out of VR mode as a frame.
+			FrameStats.DiscardFrame();
 			// Don't wait if the exit conditions are satisfied.
 			if ( !( VrThreadSynced && ReadyToExit ) )
 			{
@@ -1298,6 +1385,7 @@ void * AppLocal::VrThreadFunction()
 		// if there is an error condition, warp swap and nothing else
 		if ( ErrorTextureSwapChain != NULL )
 		{
+			FrameStats.DiscardFrame();
 			if ( vrapi_GetTimeInSeconds() >= ErrorMessageEndTime )
 			{
 				// Push black images to the screen to eliminate any frames of lost head tracking.
@@ -1335,6 +1423,11 @@ void * AppLocal::VrThreadFunction()
 		}
 #endif
 
+		// The frame interval runs from here to here in the next iteration.
+		FrameStats.SetFramePeriod( Alg::Max( VrSettings.MinimumVsyncs, 1 ) / DisplayRefreshRate );
+		FrameStats.BeginFrame();
+		FrameStats.BeginPhase( FRAME_PHASE_ADVANCE );
+
 		{
 			OVR_PERF_TIMER( VrThreadFunction_Loop_AdvanceVrFrame );
 			// Update ovrFrameInput.
@@ -1381,6 +1474,14 @@ void * AppLocal::VrThreadFunction()
 			input.TextureSwapChainIndex = eyes.TextureSwapChainIndex;
 		}
 
+		{
+			OVR_PERF_TIMER( VrThreadFunction_Loop_TextureLoader_Update );
+			// textures finished here can be used by the app in this frame
+			TextureLoader->Update( TEXTURE_UPLOAD_BUDGET_SECONDS );
+		}
+
+		FrameStats.BeginPhase( FRAME_PHASE_FRAME );
+
 		ovrFrameResult res = appInterface->Frame( input );
 		this->LastViewMatrix = res.FrameMatrices.CenterView;
 
@@ -1395,9 +1496,16 @@ void * AppLocal::VrThreadFunction()
 
 		OVR_PERF_TIMER( VrThreadFunction_DrawEyeViews );
 
+		FrameStats.BeginPhase( FRAME_PHASE_DRAW );
+
 		// Draw the eye views.
 		DrawEyeViews( res );
 
+		FrameStats.EndPhase();
+		FrameStats.LogIfDue();
+
+		// Collect the zones profiled this frame.
+		ovrProfiler::Update();
 
 		//SPAM( "FRAME END" );
 	}
@@ -1417,6 +1525,7 @@ void * AppLocal::VrThreadFunction()
 		appInterface = NULL;
 
 		ovrTextureManager::Destroy( TextureManager );
+		ovrTextureLoader::Destroy( TextureLoader );
 
 		ShutdownGlObjects();
 
@@ -1469,6 +1578,11 @@ const VrDeviceStatus & AppLocal::GetDeviceStatus() const
 	return TheVrFrame.Get().DeviceStatus;
 }
 
+const ovrFrameStats & AppLocal::GetFrameStats() const
+{
+	return FrameStats;
+}
+
 const ovrEyeBufferParms & AppLocal::GetEyeBufferParms() const
 {
 	return VrSettings.EyeBufferParms;
@@ -1640,6 +1754,11 @@ ovrTextureManager * AppLocal::GetTextureManager()
 	return TextureManager;
 }
 
+ovrTextureLoader * AppLocal::GetTextureLoader()
+{
+	return TextureLoader;
+}
+
 ovrSurfaceRender & AppLocal::GetSurfaceRender()
 {
 	return SurfaceRender;
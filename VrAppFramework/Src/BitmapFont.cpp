@@ -18,6 +18,8 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 
 #if defined( OVR_OS_WIN32 )
 #include <intrin.h>
+#elif defined( OVR_CPU_X86_64 )
+#include <xmmintrin.h>		// for ftoi
 #endif
 
 #include <errno.h>
@@ -29,6 +31,9 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 #include "Kernel/OVR_JSON.h"
 #include "Kernel/OVR_GlUtils.h"
 #include "Kernel/OVR_LogUtils.h"
+#include "Kernel/OVR_Hash.h"
+#include "Kernel/OVR_List.h"
+#include "Kernel/OVR_Atomic.h"
 
 #include "GlProgram.h"
 #include "GlTexture.h"
@@ -118,6 +123,41 @@ public:
 	float	ColorCenterOffset;
 };
 
+//==============================================================
+// ovrGlyphPageTable
+// Maps character codes to glyph indices. Character codes are split into pages of 256 and
+// only pages that contain a glyph are stored, so fonts with a few high code points or
+// large, sparse ranges (CJK) don't need an entry for every code below the highest glyph.
+// Storage page 0 is shared by all empty pages, which keeps Find() free of branches other
+// than the range check.
+class ovrGlyphPageTable
+{
+public:
+	static const int		PAGE_BITS = 8;
+	static const int		PAGE_SIZE = 1 << PAGE_BITS;
+	static const uint32_t	MAX_CHAR_CODE = 0x10FFFF;
+	static const uint16_t	INVALID_GLYPH = 0xFFFF;	// fonts are limited to 0xFFFF glyphs
+
+	void	Build( Array< FontGlyphType > const & glyphs );
+
+	int		Find( uint32_t const charCode ) const
+	{
+		uint32_t const page = charCode >> PAGE_BITS;
+		if ( page >= PageMap.GetSize() )
+		{
+			return -1;
+		}
+		uint16_t const glyphIndex = Entries[( PageMap[page] << PAGE_BITS ) | ( charCode & ( PAGE_SIZE - 1 ) )];
+		return glyphIndex == INVALID_GLYPH ? -1 : glyphIndex;
+	}
+
+	size_t	GetMemoryUsage() const { return PageMap.GetSize() * sizeof( uint16_t ) + Entries.GetSize() * sizeof( uint16_t ); }
+
+private:
+	Array< uint16_t >	PageMap;	// storage page for each page of character codes
+	Array< uint16_t >	Entries;	// storage pages, PAGE_SIZE glyph indices each
+};
+
 class FontInfoType
 {
 public:
@@ -166,7 +206,7 @@ public:
 	float						MaxDescent;		// maximum descent of any character
 	float						EdgeWidth;		// adjust the edge falloff. Helps with fonts that have smaller glyph sizes in the texture (CJK)
 	OVR::Array< FontGlyphType >	Glyphs;			// info about each glyph in the font
-	OVR::Array< int32_t >		CharCodeMap;	// index by character code to get the index of a glyph for the character
+	ovrGlyphPageTable			CharCodeMap;	// maps a character code to the index of its glyph
 	Array< ovrFontWeight >		FontWeights;
 
 private:
@@ -184,7 +224,8 @@ public:
 	BitmapFontLocal() :
 		FontTexture(),
 		ImageWidth( 0 ),
-		ImageHeight( 0 )
+		ImageHeight( 0 ),
+		LayoutId( 0 )
 	{
 	}
 	~BitmapFontLocal()
@@ -211,6 +252,11 @@ public:
 
 	bool					WordWrapText( String & inOutText, const float widthMeters, const float fontScale = 1.0f ) const;
 	bool					WordWrapText( String & inOutText, const float widthMeters, OVR::Array< OVR::String > wholeStrsList, const float fontScale = 1.0f ) const;
+	virtual void			WordWrapText( ovrTextWrapCache & cache, char const * text, const float widthMeters, const float fontScale = 1.0f ) const;
+	virtual void			CalcTextMetrics( ovrTextWrapCache const & cache, size_t & len,
+									float & width, float & height,
+									float & ascent, float & descent, float & fontHeight,
+									float * lineWidths, int const maxLines, int & numLines ) const;
 	float					GetLastFitChars( String & inOutText, const float widthMeters, const float fontScale = 1.0f ) const;
 	float					GetFirstFitChars( String & inOutText, const float widthMeters, const float fontScale = 1.0f ) const;
 
@@ -233,12 +279,17 @@ public:
 	int     				GetImageWidth() const { return ImageWidth; }
 	int     				GetImageHeight() const { return ImageHeight; }
 	const GlTexture &  		GetFontTexture() const { return FontTexture; }
+	// Unique for each load of a font, so cached text layouts can't outlive the glyphs they were built from.
+	uint32_t				GetLayoutId() const { return LayoutId; }
 
 private:
 	FontInfoType			FontInfo;
 	GlTexture      			FontTexture;
 	int         			ImageWidth;
 	int         			ImageHeight;
+	uint32_t				LayoutId;
+
+	static AtomicInt< uint32_t >	NextLayoutId;
 
 	GlProgram				FontProgram;
 
@@ -248,6 +299,8 @@ private:
 									size_t const bufferSize, bool const isASTC );
 	bool					LoadFontInfo( char const * glyphFileName );
 	bool					LoadFontInfoFromBuffer( unsigned char const * buffer, size_t const bufferSize );
+	void					WrapLine( char const * text, const float widthMeters, const float fontScale,
+									ovrTextWrapCache::ovrLine & line ) const;
 };
 
 // We cast BitmapFont to BitmapFontLocal internally so that we do not have to expose
@@ -414,7 +467,8 @@ public:
 		Pivot( 0.0f ),
 		Rotation(),
 		Billboard( true ),
-		TrackRoll( false )
+		TrackRoll( false ),
+		LayoutSerial( 0 )
 	{
 	}
 
@@ -425,7 +479,8 @@ public:
 		Pivot( 0.0f ),
 		Rotation(),
 		Billboard( true ),
-		TrackRoll( false )
+		TrackRoll( false ),
+		LayoutSerial( 0 )
 	{
 		Copy( other );
 	}
@@ -450,6 +505,7 @@ public:
 		Rotation	= other.Rotation;
 		Billboard	= other.Billboard;
 		TrackRoll	= other.TrackRoll;
+		LayoutSerial = other.LayoutSerial;
 
 		other.Font = NULL;
 		other.Verts = NULL;
@@ -463,7 +519,8 @@ public:
 		Pivot( pivot ),
 		Rotation( rot ),
 		Billboard( billboard ),
-		TrackRoll( trackRoll )
+		TrackRoll( trackRoll ),
+		LayoutSerial( 0 )
 	{
 		Verts = new fontVertex_t[numVerts];
 	}
@@ -488,6 +545,7 @@ public:
 	Quatf						Rotation;	// additional rotation to apply
 	bool						Billboard;	// true to always face the camera
 	bool						TrackRoll;	// if true, when billboarded, roll with the camera
+	uint32_t					LayoutSerial;	// serial of the cached layout the vertices came from, 0 if not cached
 };
 
 // Sets up VB and VAO for font drawing
@@ -870,6 +928,400 @@ ovrSurfaceDef BitmapFontLocal::TextSurface( const char * text,
 	return s;
 }
 
+//==============================================================
+// ovrTextLayoutKey
+// Everything that affects the local-space vertices DrawTextToVertexBlock() produces.
+// The position only moves the pivot, so it isn't part of the key.
+struct ovrTextLayoutKey
+{
+	ovrTextLayoutKey( BitmapFont const & font, fontParms_t const & parms, Vector3f const & normal,
+			Vector3f const & up, float const scale, Vector4f const & color, char const * text ) :
+		Text( text ),
+		FontId( AsLocal( font ).GetLayoutId() ),
+		Color( ColorToABGR( color ) ),
+		Scale( scale ),
+		AlphaCenter( parms.AlphaCenter ),
+		ColorCenter( parms.ColorCenter ),
+		// billboarded text is laid out on fixed axes
+		Normal( parms.Billboard ? Vector3f::ZERO : normal ),
+		Up( parms.Billboard ? Vector3f::ZERO : up ),
+		AlignHoriz( parms.AlignHoriz ),
+		AlignVert( parms.AlignVert ),
+		Billboard( parms.Billboard ),
+		TrackRoll( parms.TrackRoll )
+	{
+	}
+
+	uint32_t	Hash() const
+	{
+		// FNV-1a over the text and then the parameters
+		uint32_t h = 2166136261u;
+		for ( char const * p = Text; *p != '\0'; ++p )
+		{
+			h = ( h ^ static_cast< uint8_t >( *p ) ) * 16777619u;
+		}
+		uint32_t const parms[] =
+		{
+			FontId, Color, FloatBits( Scale ), FloatBits( AlphaCenter ), FloatBits( ColorCenter ),
+			FloatBits( Normal.x ), FloatBits( Normal.y ), FloatBits( Normal.z ),
+			FloatBits( Up.x ), FloatBits( Up.y ), FloatBits( Up.z ),
+			static_cast< uint32_t >( AlignHoriz | ( AlignVert << 8 ) | ( Billboard << 16 ) | ( TrackRoll << 24 ) )
+		};
+		for ( int i = 0; i < static_cast< int >( sizeof( parms ) / sizeof( parms[0] ) ); ++i )
+		{
+			h = ( h ^ parms[i] ) * 16777619u;
+		}
+		return h;
+	}
+
+	bool		operator == ( ovrTextLayoutKey const & other ) const
+	{
+		return FontId == other.FontId && Color == other.Color && Scale == other.Scale &&
+				AlphaCenter == other.AlphaCenter && ColorCenter == other.ColorCenter &&
+				Normal == other.Normal && Up == other.Up &&
+				AlignHoriz == other.AlignHoriz && AlignVert == other.AlignVert &&
+				Billboard == other.Billboard && TrackRoll == other.TrackRoll &&
+				OVR_strcmp( Text, other.Text ) == 0;
+	}
+
+	char const *			Text;
+	uint32_t				FontId;
+	uint32_t				Color;
+	float					Scale;
+	float					AlphaCenter;
+	float					ColorCenter;
+	Vector3f				Normal;
+	Vector3f				Up;
+	HorizontalJustification	AlignHoriz;
+	VerticalJustification	AlignVert;
+	bool					Billboard;
+	bool					TrackRoll;
+
+private:
+	static uint32_t	FloatBits( float const f )
+	{
+		uint32_t bits;
+		memcpy( &bits, &f, sizeof( bits ) );
+		return bits;
+	}
+};
+
+//==============================================================
+// ovrTextLayoutEntry
+struct ovrTextLayoutEntry : public ListNode< ovrTextLayoutEntry >
+{
+	ovrTextLayoutEntry( ovrTextLayoutKey const & key, uint32_t const hash ) :
+		Key( key ),
+		Text( key.Text ),
+		KeyHash( hash ),
+		Serial( 0 ),
+		LastFrame( 0 ),
+		Verts( NULL ),
+		NumVerts( 0 ),
+		ToNextLine( 0.0f )
+	{
+		Key.Text = Text.ToCStr();
+	}
+
+	~ovrTextLayoutEntry()
+	{
+		delete [] Verts;
+	}
+
+	ovrTextLayoutKey	Key;		// Key.Text points to Text
+	String				Text;
+	uint32_t			KeyHash;
+	uint32_t			Serial;		// unique for each inserted layout, never reused
+	uint32_t			LastFrame;	// last frame the layout was drawn in
+	fontVertex_t *		Verts;		// local-space vertices, relative to the pivot
+	int					NumVerts;
+	Vector3f			ToNextLine;
+};
+
+//==============================================================
+// ovrTextLayoutCache
+// Keeps the vertices of recently drawn strings so that text drawn again with the same
+// font and parameters (HUDs, labels, menus) is copied instead of being decoded, measured
+// and laid out every frame. Least recently used layouts are dropped once either the
+// entry or the vertex budget is exceeded, but never a layout that was already drawn in
+// the current frame: when one frame draws more text than fits, the text that doesn't fit
+// is laid out every frame instead of evicting everything else in a cycle.
+class ovrTextLayoutCache
+{
+public:
+	static const int	DEFAULT_MAX_ENTRIES = 1024;
+	static const int	DEFAULT_MAX_VERTICES = 64 * 1024;
+
+							ovrTextLayoutCache();
+							~ovrTextLayoutCache();
+
+	void					SetBudget( int const maxEntries, int const maxVertices );
+	// Call once per frame, after all text for the frame has been drawn.
+	void					AdvanceFrame() { FrameNumber++; }
+
+	// Returns the cached layout and marks it as most recently used, or NULL on a miss.
+	ovrTextLayoutEntry const *	Find( ovrTextLayoutKey const & key, uint32_t const hash );
+	// Copies the vertices into the cache. Layouts larger than the vertex budget aren't kept
+	// and NULL is returned.
+	ovrTextLayoutEntry const *	Insert( ovrTextLayoutKey const & key, uint32_t const hash,
+									fontVertex_t const * verts, int const numVerts, Vector3f const & toNextLine );
+	void					Clear();
+
+private:
+	Hash< uint32_t, ovrTextLayoutEntry * >	Index;
+	List< ovrTextLayoutEntry >				LruList;	// most recently used first
+	int										NumEntries;
+	int										NumVertices;
+	int										MaxEntries;
+	int										MaxVertices;
+	uint32_t								FrameNumber;
+	uint32_t								NextSerial;
+
+	void					Evict( ovrTextLayoutEntry * entry );
+	// Returns false if there isn't enough room without evicting layouts used this frame.
+	bool					MakeRoom( int const extraEntries, int const extraVertices, bool const keepCurrentFrame );
+};
+
+ovrTextLayoutCache::ovrTextLayoutCache() :
+	NumEntries( 0 ),
+	NumVertices( 0 ),
+	MaxEntries( DEFAULT_MAX_ENTRIES ),
+	MaxVertices( DEFAULT_MAX_VERTICES ),
+	FrameNumber( 0 ),
+	NextSerial( 1 )
+{
+}
+
+ovrTextLayoutCache::~ovrTextLayoutCache()
+{
+	Clear();
+}
+
+void ovrTextLayoutCache::SetBudget( int const maxEntries, int const maxVertices )
+{
+	MaxEntries = Alg::Max( maxEntries, 0 );
+	MaxVertices = Alg::Max( maxVertices, 0 );
+	MakeRoom( 0, 0, false );
+}
+
+ovrTextLayoutEntry const * ovrTextLayoutCache::Find( ovrTextLayoutKey const & key, uint32_t const hash )
+{
+	ovrTextLayoutEntry ** entry = Index.Get( hash );
+	if ( entry == NULL || !( (*entry)->Key == key ) )
+	{
+		return NULL;
+	}
+	(*entry)->LastFrame = FrameNumber;
+	LruList.BringToFront( *entry );
+	return *entry;
+}
+
+ovrTextLayoutEntry const * ovrTextLayoutCache::Insert( ovrTextLayoutKey const & key, uint32_t const hash,
+		fontVertex_t const * verts, int const numVerts, Vector3f const & toNextLine )
+{
+	if ( numVerts > MaxVertices || MaxEntries == 0 )
+	{
+		return NULL;
+	}
+
+	// a different string with the same hash is simply replaced
+	ovrTextLayoutEntry ** existing = Index.Get( hash );
+	if ( existing != NULL )
+	{
+		Evict( *existing );
+	}
+	if ( !MakeRoom( 1, numVerts, true ) )
+	{
+		return NULL;
+	}
+
+	ovrTextLayoutEntry * entry = new ovrTextLayoutEntry( key, hash );
+	entry->Serial = NextSerial++;
+	entry->LastFrame = FrameNumber;
+	if ( numVerts > 0 )
+	{
+		entry->Verts = new fontVertex_t[numVerts];
+		memcpy( entry->Verts, verts, numVerts * sizeof( fontVertex_t ) );
+	}
+	entry->NumVerts = numVerts;
+	entry->ToNextLine = toNextLine;
+
+	LruList.PushFront( entry );
+	Index.Set( hash, entry );
+	NumEntries++;
+	NumVertices += numVerts;
+	return entry;
+}
+
+void ovrTextLayoutCache::Clear()
+{
+	while ( !LruList.IsEmpty() )
+	{
+		ovrTextLayoutEntry * entry = LruList.GetFirst();
+		LruList.Remove( entry );
+		delete entry;
+	}
+	Index.Clear();
+	NumEntries = 0;
+	NumVertices = 0;
+}
+
+void ovrTextLayoutCache::Evict( ovrTextLayoutEntry * entry )
+{
+	NumEntries--;
+	NumVertices -= entry->NumVerts;
+	Index.Remove( entry->KeyHash );
+	LruList.Remove( entry );
+	delete entry;
+}
+
+bool ovrTextLayoutCache::MakeRoom( int const extraEntries, int const extraVertices, bool const keepCurrentFrame )
+{
+	while ( NumEntries + extraEntries > MaxEntries || NumVertices + extraVertices > MaxVertices )
+	{
+		if ( LruList.IsEmpty() )
+		{
+			return false;
+		}
+		ovrTextLayoutEntry * oldest = LruList.GetLast();
+		if ( keepCurrentFrame && oldest->LastFrame == FrameNumber )
+		{
+			return false;
+		}
+		Evict( oldest );
+	}
+	return true;
+}
+
+//==============================================================
+// ovrVertexRange
+struct ovrVertexRange
+{
+	ovrVertexRange() : First( 0 ), Count( 0 ) {}
+	ovrVertexRange( int const first, int const count ) : First( first ), Count( count ) {}
+
+	bool operator == ( ovrVertexRange const & other ) const { return First == other.First && Count == other.Count; }
+	bool operator != ( ovrVertexRange const & other ) const { return !( *this == other ); }
+
+	int		First;
+	int		Count;
+};
+
+//==============================================================
+// ovrVertexRangeAllocator
+// First-fit allocator for ranges of the font surface's vertex buffer. The free ranges
+// are kept sorted by position and adjacent ranges are merged when freed.
+class ovrVertexRangeAllocator
+{
+public:
+	void	Init( int const numVertices );
+	// Returns the first vertex of the range, or -1 if no free range is large enough.
+	int		Alloc( int const count );
+	void	Free( int const first, int const count );
+
+private:
+	Array< ovrVertexRange >	FreeRanges;
+};
+
+void ovrVertexRangeAllocator::Init( int const numVertices )
+{
+	FreeRanges.Clear();
+	if ( numVertices > 0 )
+	{
+		FreeRanges.PushBack( ovrVertexRange( 0, numVertices ) );
+	}
+}
+
+int ovrVertexRangeAllocator::Alloc( int const count )
+{
+	for ( int i = 0; i < FreeRanges.GetSizeI(); i++ )
+	{
+		ovrVertexRange & range = FreeRanges[i];
+		if ( range.Count >= count )
+		{
+			int const first = range.First;
+			range.First += count;
+			range.Count -= count;
+			if ( range.Count == 0 )
+			{
+				FreeRanges.RemoveAt( i );
+			}
+			return first;
+		}
+	}
+	return -1;
+}
+
+void ovrVertexRangeAllocator::Free( int const first, int const count )
+{
+	if ( count <= 0 )
+	{
+		return;
+	}
+
+	// find the first free range after the freed one
+	int lo = 0;
+	int hi = FreeRanges.GetSizeI();
+	while ( lo < hi )
+	{
+		int const mid = ( lo + hi ) >> 1;
+		if ( FreeRanges[mid].First < first )
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	bool const joinPrev = lo > 0 && FreeRanges[lo - 1].First + FreeRanges[lo - 1].Count == first;
+	bool const joinNext = lo < FreeRanges.GetSizeI() && first + count == FreeRanges[lo].First;
+	if ( joinPrev && joinNext )
+	{
+		FreeRanges[lo - 1].Count += count + FreeRanges[lo].Count;
+		FreeRanges.RemoveAt( lo );
+	}
+	else if ( joinPrev )
+	{
+		FreeRanges[lo - 1].Count += count;
+	}
+	else if ( joinNext )
+	{
+		FreeRanges[lo].First = first;
+		FreeRanges[lo].Count += count;
+	}
+	else
+	{
+		FreeRanges.InsertAt( lo, ovrVertexRange( first, count ) );
+	}
+}
+
+//==============================================================
+// ovrFontBlockSlot
+// Where a vertex block's transformed vertices live in the vertex buffer. Blocks that are
+// not billboarded and come from a cached layout keep their slot for as long as they are
+// drawn every frame with the same layout at the same position, so their vertices are
+// neither transformed nor uploaded again.
+struct ovrFontBlockSlot
+{
+	ovrFontBlockSlot() :
+		LayoutSerial( 0 ),
+		Pivot( 0.0f ),
+		Bounds( Bounds3f::Init ),
+		LastFrame( 0 )
+	{
+	}
+
+	bool IsStatic() const { return LayoutSerial != 0; }
+
+	uint32_t			LayoutSerial;	// 0 if the slot is rewritten every frame
+	Vector3f			Pivot;
+	ovrVertexRange		Range;			// Range.First is -1 if the block isn't drawn
+	Bounds3f			Bounds;			// bounds of the transformed vertices
+	uint32_t			LastFrame;		// last frame a block was placed in this slot
+};
+
 //==================================================================================================
 // BitmapFontSurfaceLocal
 //
@@ -907,20 +1359,45 @@ public:
 
 	virtual void		SetCullEnabled( const bool enabled );
 
+	virtual void		SetLayoutCacheBudget( int const maxEntries, int const maxVertices );
+
 private:
 	// This limitation may not exist anymore now that ModelMatrix is no longer a member.
 	BitmapFontSurfaceLocal &	operator = ( BitmapFontSurfaceLocal const & rhs );
 
 	mutable ovrSurfaceDef	FontSurfaceDef;
 
-	fontVertex_t *  Vertices;	// vertices that are written to the VBO
+	fontVertex_t *  Vertices;	// CPU copy of the VBO, written in slots that persist across frames
+	fontIndex_t *	Indices;	// CPU copy of the index buffer, in draw order
 	int             MaxVertices;
 	int             MaxIndices;
 	int             CurVertex;  // reset every Render()
 	int             CurIndex;   // reset every Render()
 	bool			Initialized;
+	bool			WarnedFull;	// only warn once when the vertex buffer is full
+	uint32_t		FrameNumber;
 
 	Array< VertexBlockType >	    VertexBlocks;	// each pointer in the array points to an allocated block ov
+
+	ovrTextLayoutCache				LayoutCache;	// layouts of recently drawn strings
+
+	// arrays that are refilled every frame never shrink, so they don't reallocate every frame
+	typedef ArrayConstPolicy< 0, 16, true >	FramePolicy;
+
+	ovrVertexRangeAllocator						VertexAlloc;	// free ranges of the VBO
+	Array< ovrFontBlockSlot, FramePolicy >		StaticSlots;	// static blocks whose vertices are in the VBO
+	Hash< uint32_t, int >						StaticSlotIndex;	// slot hash -> index into StaticSlots
+	Array< ovrFontBlockSlot, FramePolicy >		FrameSlots;		// slot of each vertex block drawn this frame
+	Array< ovrVertexRange, FramePolicy >		DrawnRanges;	// vertex ranges in the order of the index buffer
+	Array< ovrVertexRange, FramePolicy >		DirtyRanges;	// vertex ranges written this frame
+	Array< uint16_t, FramePolicy >				SortKeys;
+	Array< int, FramePolicy >					SortOrder;
+	Array< int, FramePolicy >					SortTemp;
+
+	static uint32_t		SlotHash( uint32_t const layoutSerial, Vector3f const & pivot );
+	void				TransformVertexBlock( VertexBlockType const & vb, Matrix4f const & transform,
+								ovrFontBlockSlot & slot );
+	void				UploadDirtyRanges( int const firstChangedIndex );
 };
 
 //==================================================================================================
@@ -959,11 +1436,7 @@ bool FontInfoType::LoadFromBuffer( void const * buffer, size_t const bufferSize
 		return false;
 	}
 
-	int32_t maxCharCode = -1;
-	// currently we're only supporting the first unicode plane up to 65k. If we were to support other planes
-	// we could conceivably end up with a very sparse 1,114,111 byte type for mapping character codes to
-	// glyphs and if that's the case we may just want to use a hash, or use a combination of tables for
-	// the first 65K and hashes for the other, less-frequently-used characters.
+	// glyph indices are stored as 16 bits in the character code map
 	static const int MAX_GLYPHS = 0xffff;
 
 	// load the glyphs
@@ -1094,8 +1567,6 @@ bool FontInfoType::LoadFromBuffer( void const * buffer, size_t const bufferSize
 				{
 					MaxDescent = descent;
 				}
-
-				maxCharCode = Alg::Max( maxCharCode, g.CharCode );
 			}
 		}
 	}
@@ -1113,32 +1584,61 @@ bool FontInfoType::LoadFromBuffer( void const * buffer, size_t const bufferSize
 	ScaleFactorX = DEFAULT_SCALE_FACTOR * DEFAULT_TEXT_SCALE * widthScaleFactor * TweakScale;
 	ScaleFactorY = DEFAULT_SCALE_FACTOR * DEFAULT_TEXT_SCALE * heightScaleFactor * TweakScale;
 
-	// This is not intended for wide or ucf character sets -- depending on the size range of
-	// character codes lookups may need to be changed to use a hash.
-	if ( maxCharCode >= MAX_GLYPHS )
-	{
-		OVR_ASSERT( maxCharCode <= MAX_GLYPHS );
-		maxCharCode = MAX_GLYPHS;
-	}
+	CharCodeMap.Build( Glyphs );
+
+	jsonRoot->Release();
 
-	// resize the array to the maximum glyph value
-	CharCodeMap.Resize( maxCharCode + 1 );
+	return true;
+}
 
-	// init to empty value
-	for ( int i = 0; i < CharCodeMap.GetSizeI(); ++i )
+//==============================
+// ovrGlyphPageTable::Build
+void ovrGlyphPageTable::Build( Array< FontGlyphType > const & glyphs )
+{
+	uint32_t maxCharCode = 0;
+	for ( int i = 0; i < glyphs.GetSizeI(); ++i )
 	{
-		CharCodeMap[ i ] = -1;
+		uint32_t const charCode = static_cast< uint32_t >( glyphs[i].CharCode );
+		if ( charCode <= MAX_CHAR_CODE )
+		{
+			maxCharCode = Alg::Max( maxCharCode, charCode );
+		}
 	}
 
-	for ( int i = 0; i < Glyphs.GetSizeI(); ++i )
+	PageMap.Resize( ( maxCharCode >> PAGE_BITS ) + 1 );
+	for ( int i = 0; i < PageMap.GetSizeI(); ++i )
 	{
-		FontGlyphType const & g = Glyphs[i];
-		CharCodeMap[g.CharCode] = i;
+		PageMap[i] = 0;
 	}
 
-	jsonRoot->Release();
+	// the shared empty page
+	Entries.Resize( PAGE_SIZE );
+	for ( int i = 0; i < PAGE_SIZE; ++i )
+	{
+		Entries[i] = INVALID_GLYPH;
+	}
 
-	return true;
+	for ( int i = 0; i < glyphs.GetSizeI() && i < INVALID_GLYPH; ++i )
+	{
+		uint32_t const charCode = static_cast< uint32_t >( glyphs[i].CharCode );
+		if ( charCode > MAX_CHAR_CODE )
+		{
+			WARN( "ovrGlyphPageTable: character code 0x%x is out of range", charCode );
+			continue;
+		}
+		uint32_t const page = charCode >> PAGE_BITS;
+		if ( PageMap[page] == 0 )
+		{
+			PageMap[page] = static_cast< uint16_t >( Entries.GetSizeI() >> PAGE_BITS );
+			const int first = Entries.GetSizeI();
+			Entries.Resize( first + PAGE_SIZE );
+			for ( int j = first; j < Entries.GetSizeI(); ++j )
+			{
+				Entries[j] = INVALID_GLYPH;
+			}
+		}
+		Entries[( PageMap[page] << PAGE_BITS ) | ( charCode & ( PAGE_SIZE - 1 ) )] = static_cast< uint16_t >( i );
+	}
 }
 
 class ovrGlyphSort
@@ -1237,15 +1737,15 @@ FontGlyphType const & FontInfoType::GlyphForCharCode( uint32_t const charCode )
 {
 	auto lookupGlyph = [this] ( uint32_t const ch )
 	{
-		return ch >= CharCodeMap.GetSize() ? -1 : CharCodeMap[ch];
+		return CharCodeMap.Find( ch );
 	};
 
-	int glyphIndex = lookupGlyph( charCode );//charCode >= CharCodeMap.GetSize() ? -1 : CharCodeMap[charCode];
+	int glyphIndex = lookupGlyph( charCode );
 	if ( glyphIndex < 0 || glyphIndex >= Glyphs.GetSizeI() )
 	{
 #if defined( OVR_BUILD_DEBUG )		
-		WARN( "FontInfoType::GlyphForCharCode FAILED TO FIND GLYPH FOR CHARACTER! charCode %u => %i [mapsize=%i] [glyphsize=%i]",
-			charCode, glyphIndex, CharCodeMap.GetSize(), Glyphs.GetSizeI() );
+		WARN( "FontInfoType::GlyphForCharCode FAILED TO FIND GLYPH FOR CHARACTER! charCode %u => %i [glyphsize=%i]",
+			charCode, glyphIndex, Glyphs.GetSizeI() );
 #endif
 
 		switch( charCode )
@@ -1302,10 +1802,33 @@ FontGlyphType const & FontInfoType::GlyphForCharCode( uint32_t const charCode )
 	return Glyphs[glyphIndex];
 }
 
+//==================================================================================================
+// ovrTextWrapCache
+//==================================================================================================
+
+ovrTextWrapCache::ovrTextWrapCache() :
+	FontId( 0 ),
+	WidthMeters( 0.0f ),
+	FontScale( 0.0f ),
+	NumReflowedLines( 0 )
+{
+}
+
+void ovrTextWrapCache::Clear()
+{
+	Source.Clear();
+	Wrapped.Clear();
+	Lines.Clear();
+	FontId = 0;
+	NumReflowedLines = 0;
+}
+
 //==================================================================================================
 // BitmapFontLocal
 //==================================================================================================
 
+AtomicInt< uint32_t > BitmapFontLocal::NextLayoutId( 0 );
+
 static bool ExtensionMatches( char const * fileName, char const * ext )
 {
 	if ( fileName == NULL || ext == NULL )
@@ -1334,6 +1857,8 @@ bool BitmapFontLocal::Load( ovrFileSys & fileSys, char const * uri )
 		return false;
 	}
 
+	LayoutId = NextLayoutId.ExchangeAdd_Sync( 1 ) + 1;
+
 	if ( !FontInfo.Load( fileSys, uri ) )
 	{
 		return false;
@@ -1449,239 +1974,359 @@ bool BitmapFontLocal::WordWrapText( String & inOutText, const float widthMeters,
 // BitmapFontLocal::WordWrapText
 bool BitmapFontLocal::WordWrapText( String & inOutText, const float widthMeters, OVR::Array< OVR::String > wholeStrsList, const float fontScale ) const
 {
-	char const * source = inOutText.ToCStr();
-	if ( *source == '\0' )
+	if ( inOutText.IsEmpty() )
 	{
 		//LOG( "Tried to word-wrap NULL text!" );
 		return false;
 	}
 
-	//LOG( "Word-wrapping '%s'", source );
+	ovrTextWrapCache cache;
+	WordWrapText( cache, inOutText.ToCStr(), Alg::Max( widthMeters, 0.0f ), fontScale );
+	inOutText = cache.GetWrappedText();
+	return true;
+}
 
-	// we will change characters in the new string and can potentially add line breaks after some characters
-	// so it may grow larger than the original string.
-	// While determining the length of the string, find any characters that may potentially have a line
-	// break added after them and increase the string length by 1 for each.
-	auto IsPostLineBreakChar = [] ( uint32_t const ch ) 
+//==============================
+// DecodeNextCharFast
+// UTF8Util::DecodeNextChar with the common ASCII case inlined.
+static inline uint32_t DecodeNextCharFast( char const ** p )
+{
+	uint8_t const ch = static_cast< uint8_t >( **p );
+	if ( ch < 0x80 )
 	{
-		// array of characters after which we can add line breaks.
-		uint32_t const postLineBreakChars[] =
-		{
-			',', '.', ':', ';', '>', '!', '?', ')', ']', '-', '=', '+', '*', '\\', '/', 
-			0x3002,	// Chinese 'full-stop
-			'\0' // list terminator
-		};
-
-		for ( int i = 0; postLineBreakChars[i] != 0; ++i )
-		{
-			if ( ch == postLineBreakChars[i] )
-			{
-				return true;
-			}
-		}
-		return false;
-	};
+		*p += ( ch != 0 );
+		return ch;
+	}
+	return UTF8Util::DecodeNextChar( p );
+}
 
-	size_t lengthInBytes = 0;
-	char const * cur = source;
-	for ( ; ; )
+// Characters after which a line break can be inserted.
+static bool IsPostLineBreakChar( uint32_t const ch )
+{
+	switch ( ch )
 	{
-		char const * prev = cur;
-		uint32_t const charCode = UTF8Util::DecodeNextChar( &cur );
-		ptrdiff_t const numBytes = cur - prev;
-		
-		if ( charCode == '\0' )
-		{
-			break;
-		}
-
-		lengthInBytes += static_cast< int >( numBytes );
-		
-		if ( IsPostLineBreakChar( charCode ) )
-		{
-			++lengthInBytes;	// add one byte for '\n'
-		}
+		case ',': case '.': case ':': case ';': case '>': case '!': case '?': case ')': case ']':
+		case '-': case '=': case '+': case '*': case '\\': case '/':
+		case 0x3002:	// Chinese full-stop
+			return true;
+		default:
+			return false;
 	}
+}
 
-	// we now have the maximum possible length of the string with line-breaks.
-	char * dest = new char[lengthInBytes + 1];
-	dest[lengthInBytes] = '\0';
-	intptr_t destOffset = 0;
+// CheckForColorEscape looks up to this many bytes ahead of a character.
+static const int32_t MAX_WRAP_LOOKAHEAD = 10;
 
-	cur = source;	// reset
-	intptr_t lastLineBreakOfs = -1;
-	intptr_t lastPostLineBreakOfs = -1;
+//==============================
+// BitmapFontLocal::WrapLine
+// Lays out the line that starts at line.Start, line.WidthStart and line.Resume. A line only
+// depends on the text from its WidthStart onwards, which is what allows re-flowing a wrapped
+// string from any line. A negative width only breaks at '\n', like CalcTextMetrics().
+//
+// The breaks are placed where the original single pass wrapper placed them: the width of the
+// space at a break and of the characters that were read past the break point carries over to
+// the next line, a break after punctuation wins over a space right behind it, and a character
+// that doesn't fit on an empty line leaves the line empty. Unlike that wrapper, a line that
+// doesn't fit never moves a break into the line before an explicit line break.
+void BitmapFontLocal::WrapLine( char const * text, const float widthMeters, const float fontScale,
+		ovrTextWrapCache::ovrLine & line ) const
+{
+	struct lineState_t
+	{
+		int32_t	NumChars;
+		int32_t	NumCodes;
+		float	Width;
+		float	MaxAscent;
+		float	MaxDescent;
+	};
 
+	bool const wrap = widthMeters >= 0.0f;
 	float const xScale = FontInfo.ScaleFactorX * fontScale;
-	double lineWidthAtLastBreak = 0.0;
-	double lineWidth = 0.0;
-	bool isCJK = false;
+	double widthInMeters = 0.0;
+	if ( wrap && line.WidthStart < line.Start )
+	{
+		widthInMeters += GlyphForCharCode( ' ' ).AdvanceX * xScale;	// the space the previous line broke at
+	}
+
+	lineState_t cur = { 0, 0, 0.0f, 0.0f, 0.0f };
+	lineState_t atSpace = cur;
+	lineState_t atPostBreak = cur;
+	int32_t spaceOfs = -1;			// offset of the last space
+	int32_t postBreakOfs = -1;		// offset after the last character that can be followed by a break
+	bool hasTab = false;
+
+	auto finishLine = [&]( int32_t const end, int32_t const next, int32_t const nextWidthStart, int32_t const nextResume,
+			int32_t const scanEnd, lineState_t const & state )
+	{
+		line.End = end;
+		line.Next = next;
+		line.NextWidthStart = nextWidthStart;
+		line.NextResume = nextResume;
+		line.ScanEnd = scanEnd;
+		line.NumChars = state.NumChars;
+		line.NumCodes = state.NumCodes;
+		line.Width = state.Width;
+		line.MaxAscent = state.MaxAscent;
+		line.MaxDescent = state.MaxDescent;
+		line.HasTab = hasTab && end > line.Start;
+		line.IsLast = false;
+	};
 
-	while ( *cur != '\0' )
+	char const * p = text + line.Start;
+	for ( ; ; )
 	{
-		// skip over formatting
 		uint32_t color;
 		uint32_t weight;
-		char const * p = cur;
-		while( CheckForFormatEscape( &p, color, weight ) ) { }
-		ptrdiff_t numFormatChars = p - cur;
-		if ( numFormatChars > 0 )
-		{
-			// copy the formatting to the destination
-			memcpy( dest + destOffset, cur, numFormatChars );
-			cur += numFormatChars;
-			destOffset += numFormatChars;
-		}
-
-		double lastLineWidth = lineWidth;
-		intptr_t lastDestOffset = destOffset;
+		while ( CheckForFormatEscape( &p, color, weight ) );
 
-		char const * pre = cur;
-		uint32_t charCode = UTF8Util::DecodeNextChar( &cur );
+		int32_t const charOfs = static_cast< int32_t >( p - text );
+		uint32_t charCode = DecodeNextCharFast( &p );
+		int32_t const nextOfs = static_cast< int32_t >( p - text );
 		if ( charCode == '\0' )
 		{
-			UTF8Util::EncodeChar( dest, &destOffset, '\0' );
-			break;
-		}
-		intptr_t const charCodeSize = cur - pre;
-		// determine if the string is Chinese, Japanese or Korean.
-		isCJK |= ( charCode >= 0x4E00 && charCode <= 0x9FAF ) || ( charCode >= 0x3000 && charCode <= 0x30FF );
-		
-		// replace tabs with a space
-		if ( charCode == '\t' )
-		{
-			charCode = ' ';
+			// also stops at a truncated UTF-8 sequence, like the other text functions
+			finishLine( charOfs, charOfs, charOfs, charOfs, charOfs, cur );
+			line.IsLast = true;
+			return;
 		}
-		
-		if ( charCode == ' ' )
+		if ( charCode == '\n' )
 		{
-			lastLineBreakOfs = destOffset;
-			lineWidthAtLastBreak = lineWidth;	// line width *before* the space
+			finishLine( charOfs, nextOfs, nextOfs, nextOfs, nextOfs, cur );
+			return;
 		}
-		else if ( charCode == '\\' )
+		if ( wrap )
 		{
-			// replace verbatim "\n" and "\r" with explicit breaks
-			char const * temp = cur;
-			uint32_t nextCode = UTF8Util::DecodeNextChar( &temp );
-			if ( nextCode == 'r' || nextCode == 'n' )
+			if ( charCode == '\r' )
 			{
-				lineWidth = 0.0;
-				lineWidthAtLastBreak = 0.0;
-				cur = temp;	// skip the next character
-				// output a linefeed
-				UTF8Util::EncodeChar( dest, &destOffset, '\n' );
-				continue;
+				finishLine( charOfs, nextOfs, nextOfs, nextOfs, nextOfs, cur );
+				return;
+			}
+			if ( charCode == '\\' && ( *p == 'n' || *p == 'r' ) )
+			{
+				// a verbatim "\n" or "\r" is an explicit break
+				finishLine( charOfs, nextOfs + 1, nextOfs + 1, nextOfs + 1, nextOfs + 1, cur );
+				return;
+			}
+			if ( charCode == '\t' )
+			{
+				charCode = ' ';
+				hasTab = true;
 			}
 		}
-		else if ( charCode == '\r' || charCode == '\n' )
+		else if ( charCode == '\r' )
 		{
-			lineWidth = 0.0;
-			lineWidthAtLastBreak = 0.0;
-			// output a linefeed 
-			UTF8Util::EncodeChar( dest, &destOffset, '\n' );
+			cur.NumCodes++;		// skipped by CalcTextMetrics() but still counted
 			continue;
 		}
 
 		FontGlyphType const & g = GlyphForCharCode( charCode );
-		lineWidth += g.AdvanceX * xScale;
 
-		if ( lineWidth >= widthMeters )
+		// the characters before Resume were already checked against the width by the previous line
+		if ( wrap )
 		{
-			if ( charCode == ' ' )
+			widthInMeters += g.AdvanceX * xScale;
+			if ( charOfs >= line.Resume )
 			{
-				// just turn the emitted character into a linefeed
-				charCode = '\n';
-			}
-			else
-			{
-				if ( lastLineBreakOfs < 0 && lastPostLineBreakOfs < 0 )
+				if ( charCode == ' ' )
 				{
-					// we're unable to wrap based on punctuation or whitespace, so we must break at some
-					// arbitrary character. This is fine for Chinese, but not for western languages. It's 
-					// also relatively rare for western languages since they use spaces between each word.
-					/*if ( !isCJK )
-					{
-						return false;
-					}*/
-					// just break at the last character that didn't exceed the line width
-					lastPostLineBreakOfs = lastDestOffset;
-					lineWidthAtLastBreak = lastLineWidth;
+					spaceOfs = charOfs;
+					atSpace = cur;
 				}
-
-				intptr_t bestBreakOfs = lastLineBreakOfs > lastPostLineBreakOfs ? lastLineBreakOfs : lastPostLineBreakOfs;
-
-				char * destBreakPoint = dest + bestBreakOfs;
-
-				bool const overwrite = bestBreakOfs != lastPostLineBreakOfs;
-				if ( overwrite )
+				if ( widthInMeters >= widthMeters )
 				{
-					// we overwrote with a single byte, but we could have overwritten a multi-byte unicode character
-					// so we may need to shift the entire destination string down by (sizeof overwritten char) - 1 bytes.
-					// decode the character at the bestBreak point to determine how many bytes we need to skip
-					char const * afterDestBreakPoint = destBreakPoint;
-					uint32_t const overwrittenCode = UTF8Util::DecodeNextChar( &afterDestBreakPoint );
-					OVR_UNUSED( overwrittenCode );
-
-					// encode the line feed over the last break point.
-					UTF8Util::EncodeChar( dest, &bestBreakOfs, '\n' );
-
-					// determine if we need to shift the dest text down
-					ptrdiff_t numBytesToSkip = afterDestBreakPoint - destBreakPoint;
-					if ( numBytesToSkip > 1 )
+					if ( charCode == ' ' )
 					{
-						memcpy( dest + bestBreakOfs + 1, dest + bestBreakOfs + numBytesToSkip, lengthInBytes - bestBreakOfs );	
-						destOffset -= numBytesToSkip - 1;
+						// the space becomes the line break
+						finishLine( charOfs, nextOfs, charOfs, nextOfs, nextOfs, cur );
 					}
-				}
-				else
-				{
-					// move the buffer contents after the insertion point to make room for 1 byte
-					for ( intptr_t ofs = destOffset; ofs > bestBreakOfs; --ofs )
+					else if ( spaceOfs > postBreakOfs )
 					{
-						dest[ofs] = dest[ofs - 1];
+						finishLine( spaceOfs, spaceOfs + 1, spaceOfs, nextOfs, nextOfs, atSpace );
 					}
-					// encode the line feed after the last break point
-					UTF8Util::EncodeChar( dest, &bestBreakOfs, '\n' );
-					destOffset++;
+					else if ( postBreakOfs >= 0 )
+					{
+						finishLine( postBreakOfs, postBreakOfs, postBreakOfs, nextOfs, nextOfs, atPostBreak );
+					}
+					else
+					{
+						// no place to break, so break before the character that doesn't fit
+						finishLine( charOfs, charOfs, charOfs, nextOfs, nextOfs, cur );
+					}
+					return;
 				}
 			}
+		}
 
-			lastLineBreakOfs = -1;
-			lastPostLineBreakOfs = -1;
-			
-			// subtract the width after the last whitespace so that we don't lose any accumulated width.
-			lineWidth -= lineWidthAtLastBreak;
+		cur.NumChars++;
+		cur.NumCodes++;
+		cur.Width += g.AdvanceX * FontInfo.ScaleFactorX;
+		cur.MaxAscent = Alg::Max( cur.MaxAscent, g.BearingY );
+		cur.MaxDescent = Alg::Max( cur.MaxDescent, g.Height - g.BearingY );
+
+		// the character that started this line counts as a break point again
+		if ( wrap && nextOfs >= line.Resume && IsPostLineBreakChar( charCode ) )
+		{
+			postBreakOfs = nextOfs;
+			atPostBreak = cur;
 		}
+	}
+}
 
-		if ( IsPostLineBreakChar( charCode ) )
+//==============================
+// BitmapFontLocal::WordWrapText
+void BitmapFontLocal::WordWrapText( ovrTextWrapCache & cache, char const * text, const float widthMeters, const float fontScale ) const
+{
+	typedef ovrTextWrapCache::ovrLine ovrLine;
+
+	int32_t const newLength = static_cast< int32_t >( OVR_strlen( text ) );
+	int32_t const oldLength = static_cast< int32_t >( cache.Source.GetSize() );
+	char const * oldText = cache.Source.ToCStr();
+
+	bool const sameLayout = cache.Lines.GetSizeI() > 0 && cache.FontId == LayoutId &&
+			cache.WidthMeters == widthMeters && cache.FontScale == fontScale;
+
+	// find the edited range from the common prefix and suffix
+	int32_t prefix = 0;
+	int32_t suffix = 0;
+	if ( sameLayout )
+	{
+		int32_t const minLength = Alg::Min( oldLength, newLength );
+		while ( prefix < minLength && oldText[prefix] == text[prefix] )
 		{
-			lastPostLineBreakOfs = destOffset + charCodeSize;
-			lineWidthAtLastBreak = lineWidth;	// line width *after* the break char
+			prefix++;
 		}
+		if ( prefix == oldLength && prefix == newLength )
+		{
+			cache.NumReflowedLines = 0;
+			return;
+		}
+		while ( suffix < minLength - prefix && oldText[oldLength - 1 - suffix] == text[newLength - 1 - suffix] )
+		{
+			suffix++;
+		}
+	}
+	int32_t const delta = newLength - oldLength;
+	int32_t const editEndOld = oldLength - suffix;
+	int32_t const editEndNew = newLength - suffix;
 
-		// output the current character to the destination buffer
-		UTF8Util::EncodeChar( dest, &destOffset, charCode );
+	Array< ovrLine > & lines = cache.Lines;
+	int const numOldLines = sameLayout ? lines.GetSizeI() : 0;
 
-		// in CJK cases we cannot be absolutely certain of the number of breaks until we've scanned everything
-		// and computed the width (because we may break at any character). In that case, we may need to expand
-		// the buffer.
-		if ( destOffset + 6 > static_cast< intptr_t >( lengthInBytes ) )	// 6 bytes is max UTF-8 encoding size
+	// lines that never looked at the edited bytes are kept as they are
+	int firstLine = 0;
+	while ( firstLine < numOldLines - 1 && lines[firstLine].ScanEnd + MAX_WRAP_LOOKAHEAD <= prefix )
+	{
+		firstLine++;
+	}
+
+	// lay out lines from there until a line starts after the edit the same way an old line
+	// started, the old lines from that one on still apply
+	Array< ovrLine > newLines;
+	ovrLine line;
+	line.Start = line.WidthStart = line.Resume = 0;
+	if ( numOldLines > 0 )
+	{
+		line = lines[firstLine];
+	}
+	int reuseLine = numOldLines;
+	int oldLine = firstLine;
+	for ( ; ; )
+	{
+		WrapLine( text, widthMeters, fontScale, line );
+		newLines.PushBack( line );
+		if ( line.IsLast )
+		{
+			break;
+		}
+		line.Start = line.Next;
+		line.WidthStart = line.NextWidthStart;
+		line.Resume = line.NextResume;
+
+		if ( line.WidthStart >= editEndNew && line.WidthStart - delta >= editEndOld )
+		{
+			// an empty line and the line after it start at the same offset, with different Resume
+			while ( oldLine < numOldLines && ( lines[oldLine].Start < line.Start - delta ||
+					( lines[oldLine].Start == line.Start - delta && lines[oldLine].Resume < line.Resume - delta ) ) )
+			{
+				oldLine++;
+			}
+			if ( oldLine < numOldLines && lines[oldLine].Start == line.Start - delta &&
+					lines[oldLine].WidthStart == line.WidthStart - delta && lines[oldLine].Resume == line.Resume - delta )
+			{
+				reuseLine = oldLine;
+				break;
+			}
+		}
+	}
+
+	// replace the re-flowed lines and shift the reused ones
+	int const numReused = numOldLines - reuseLine;
+	int const numLines = firstLine + newLines.GetSizeI() + numReused;
+	if ( numLines > numOldLines )
+	{
+		lines.Resize( numLines );
+	}
+	memmove( &lines[0] + firstLine + newLines.GetSizeI(), &lines[0] + reuseLine, numReused * sizeof( ovrLine ) );
+	memcpy( &lines[0] + firstLine, newLines.GetDataPtr(), newLines.GetSizeI() * sizeof( ovrLine ) );
+	lines.Resize( numLines );
+	if ( delta != 0 )
+	{
+		for ( int i = numLines - numReused; i < numLines; ++i )
 		{
-			size_t newLen = ( lengthInBytes * 3 ) / 2;
-			char * newDest = new char[newLen + 1];
-			memcpy( newDest, dest, destOffset );
-			newDest[newLen] = '\0';
-			delete [] dest;
-			dest = newDest;
-			lengthInBytes = newLen;
+			lines[i].Start += delta;
+			lines[i].WidthStart += delta;
+			lines[i].Resume += delta;
+			lines[i].End += delta;
+			lines[i].Next += delta;
+			lines[i].NextWidthStart += delta;
+			lines[i].NextResume += delta;
+			lines[i].ScanEnd += delta;
 		}
 	}
 
-	dest[destOffset] = '\0';
-	inOutText = dest;
-	delete [] dest;
+	if ( text != oldText )	// re-wrapping the cached source for a new width
+	{
+		cache.Source = text;
+	}
+	cache.FontId = LayoutId;
+	cache.WidthMeters = widthMeters;
+	cache.FontScale = fontScale;
+	cache.NumReflowedLines = newLines.GetSizeI();
 
-	return true;
+	if ( widthMeters < 0.0f )
+	{
+		cache.Wrapped = cache.Source;
+		return;
+	}
+
+	// write out the lines with their breaks
+	size_t wrappedLength = numLines - 1;
+	for ( int i = 0; i < numLines; ++i )
+	{
+		wrappedLength += cache.Lines[i].End - cache.Lines[i].Start;
+	}
+	Array< char > wrapped;
+	wrapped.Resize( wrappedLength + 1 );
+	char * out = wrapped.GetDataPtr();
+	for ( int i = 0; i < numLines; ++i )
+	{
+		ovrLine const & line = cache.Lines[i];
+		memcpy( out, text + line.Start, line.End - line.Start );
+		if ( line.HasTab )
+		{
+			for ( char * c = out; c < out + ( line.End - line.Start ); ++c )
+			{
+				*c = ( *c == '\t' ) ? ' ' : *c;
+			}
+		}
+		out += line.End - line.Start;
+		if ( i < numLines - 1 )
+		{
+			*out++ = '\n';
+		}
+	}
+	*out = '\0';
+	cache.Wrapped = wrapped.GetDataPtr();
 }
 
 float BitmapFontLocal::GetFirstFitChars( String & inOutText, const float widthMeters, const float fontScale ) const
@@ -1694,23 +2339,26 @@ float BitmapFontLocal::GetFirstFitChars( String & inOutText, const float widthMe
 	float const xScale = FontInfo.ScaleFactorX * fontScale;
 	float lineWidth = 0.0f;
 
-	for ( int32_t pos = 0; pos < inOutText.GetLengthI(); ++pos )
+	// walk the UTF-8 once instead of looking up each character by index
+	char const * p = inOutText.ToCStr();
+	for ( int32_t pos = 0; ; ++pos )
 	{
-		uint32_t charCode = inOutText.GetCharAt( pos );
+		uint32_t charCode = DecodeNextCharFast( &p );
+		if ( charCode == '\0' )
+		{
+			break;
+		}
 		if ( charCode == '\n' )
 		{
 			inOutText = inOutText.Substring( 0, pos );
 			return widthMeters - lineWidth;
 		}
-		else if ( charCode != '\0' )
+		FontGlyphType const & glyph = GlyphForCharCode( charCode );
+		lineWidth += glyph.AdvanceX * xScale;
+		if ( lineWidth > widthMeters )
 		{
-			FontGlyphType const & glyph = GlyphForCharCode( charCode );
-			lineWidth += glyph.AdvanceX * xScale;
-			if ( lineWidth > widthMeters )
-			{
-				inOutText = inOutText.Substring( 0, pos - 1 ); // -1 to not include current char that didn't fit.
-				return widthMeters - ( lineWidth - glyph.AdvanceX * xScale );
-			}
+			inOutText = inOutText.Substring( 0, pos - 1 ); // -1 to not include current char that didn't fit.
+			return widthMeters - ( lineWidth - glyph.AdvanceX * xScale );
 		}
 	}
 	// Entire text fits, leave inOutText unchanged
@@ -1727,9 +2375,12 @@ float BitmapFontLocal::GetLastFitChars( String & inOutText, const float widthMet
 	float const xScale = FontInfo.ScaleFactorX * fontScale;
 	float lineWidth = 0.0f;
 
-	for ( int32_t pos = inOutText.GetLengthI( ) - 1; pos >= 0; --pos )
+	// walk the UTF-8 backwards once instead of looking up each character by index
+	char const * text = inOutText.ToCStr();
+	intptr_t offset = static_cast< intptr_t >( inOutText.GetSize() );
+	uint32_t charCode;
+	for ( int32_t pos = inOutText.GetLengthI( ) - 1; pos >= 0 && UTF8Util::DecodePrevChar( text, offset, charCode ); --pos )
 	{
-		uint32_t charCode = inOutText.GetCharAt( pos );
 		FontGlyphType const & glyph = GlyphForCharCode( charCode );
 		lineWidth += glyph.AdvanceX * xScale;
 		if ( lineWidth > widthMeters )
@@ -1880,6 +2531,84 @@ void BitmapFontLocal::CalcTextMetrics( char const * text, size_t & len, float &
 	//OVR_ASSERT( numLines <= maxLines );
 }
 
+//==============================
+// BitmapFontLocal::CalcTextMetrics
+// Mirrors the text version above, one line at a time.
+void BitmapFontLocal::CalcTextMetrics( ovrTextWrapCache const & cache, size_t & len, float & width, float & height,
+		float & firstAscent, float & lastDescent, float & fontHeight, float * lineWidths, int const maxLines, int & numLines ) const
+{
+	len = 0;
+	numLines = 0;
+	width = 0.0f;
+	height = 0.0f;
+
+	if ( lineWidths == NULL || maxLines <= 0 )
+	{
+		return;
+	}
+	if ( cache.Wrapped.IsEmpty() )
+	{
+		return;
+	}
+
+	float maxLineAscent = 0.0f;
+	float maxLineDescent = 0.0f;
+	firstAscent = 0.0f;
+	lastDescent = 0.0f;
+	fontHeight = FontInfo.FontHeight * FontInfo.ScaleFactorY;
+	lineWidths[0] = 0.0f;
+
+	int const numCacheLines = cache.Lines.GetSizeI();
+	for ( int i = 0; i < numCacheLines; ++i )
+	{
+		ovrTextWrapCache::ovrLine const & line = cache.Lines[i];
+		len += line.NumCodes + ( i < numCacheLines - 1 ? 1 : 0 );
+
+		if ( line.NumChars > 0 )
+		{
+			if ( numLines < maxLines )
+			{
+				lineWidths[numLines] += line.Width;
+			}
+			// all lines after the first line are full height
+			maxLineAscent = ( numLines == 0 ) ? Alg::Max( maxLineAscent, line.MaxAscent ) : FontInfo.FontHeight;
+			maxLineDescent = Alg::Max( maxLineDescent, line.MaxDescent );
+		}
+
+		// keep track of the widest line, which will be the width of the entire text block
+		if ( numLines < maxLines && lineWidths[numLines] > width )
+		{
+			width = lineWidths[numLines];
+		}
+
+		firstAscent = ( numLines == 0 ) ? maxLineAscent : firstAscent;
+		lastDescent = ( line.NumChars > 0 ) ? maxLineDescent : lastDescent;
+
+		numLines++;
+		if ( numLines < maxLines )
+		{
+			lineWidths[numLines] = 0.0f;
+			maxLineAscent = 0.0f;
+			maxLineDescent = 0.0f;
+		}
+	}
+
+	firstAscent *= FontInfo.ScaleFactorY;
+	lastDescent *= FontInfo.ScaleFactorY;
+	height = firstAscent;
+
+	if ( numLines < maxLines )
+	{
+		height += ( numLines - 1 ) * FontInfo.FontHeight * FontInfo.ScaleFactorY;
+	}
+	else
+	{
+		height += ( maxLines - 1 ) * FontInfo.FontHeight * FontInfo.ScaleFactorY;
+	}
+
+	height += lastDescent;
+}
+
 //==============================
 // BitmapFontLocal::TruncateText
 void BitmapFontLocal::TruncateText( String & inOutText, int const maxLines ) const
@@ -1926,11 +2655,14 @@ void BitmapFontLocal::TruncateText( String & inOutText, int const maxLines ) con
 // BitmapFontSurfaceLocal::BitmapFontSurface
 BitmapFontSurfaceLocal::BitmapFontSurfaceLocal() :
 	Vertices( NULL ),
+	Indices( NULL ),
 	MaxVertices( 0 ),
 	MaxIndices( 0 ),
 	CurVertex( 0 ),
 	CurIndex( 0 ),
-	Initialized( false )
+	Initialized( false ),
+	WarnedFull( false ),
+	FrameNumber( 0 )
 {
 }
 
@@ -1941,6 +2673,8 @@ BitmapFontSurfaceLocal::~BitmapFontSurfaceLocal()
 	FontSurfaceDef.geo.Free();
 	delete [] Vertices;
 	Vertices = NULL;
+	delete [] Indices;
+	Indices = NULL;
 }
 
 //==============================
@@ -1956,19 +2690,32 @@ void BitmapFontSurfaceLocal::Init( const int maxVertices )
 		Vertices = NULL;
 	}
 	OVR_ASSERT( maxVertices % 4 == 0 );
+	OVR_ASSERT( maxVertices <= 65536 );	// fontIndex_t is 16 bits
 
 	MaxVertices = maxVertices;
 	MaxIndices = ( maxVertices / 4 ) * 6;
 
 	Vertices = new fontVertex_t[ maxVertices ];
+	Indices = new fontIndex_t[ MaxIndices ];
 
 	CurVertex = 0;
 	CurIndex = 0;
 
+	VertexAlloc.Init( MaxVertices );
+	StaticSlots.Clear();
+	StaticSlotIndex.Clear();
+	DrawnRanges.Clear();
+
 	Bounds3f localBounds( Bounds3f::Init );
 	FontSurfaceDef.geo = FontGeometry( MaxVertices / 4, localBounds );
 	FontSurfaceDef.geo.indexCount = 0; // if there's anything to render this will be modified
 
+	// the indices are rewritten in draw order by Finish()
+	glBindVertexArray( FontSurfaceDef.geo.vertexArrayObject );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, FontSurfaceDef.geo.indexBuffer );
+	glBufferData( GL_ELEMENT_ARRAY_BUFFER, MaxIndices * sizeof( fontIndex_t ), NULL, GL_DYNAMIC_DRAW );
+	glBindVertexArray( 0 );
+
 	FontSurfaceDef.surfaceName = "font";
 
 	//FontSurfaceDef.graphicsCommand.GpuState.blendMode = GL_FUNC_ADD;
@@ -2005,8 +2752,26 @@ Vector3f BitmapFontSurfaceLocal::DrawText3D( BitmapFont const & font, fontParms_
 	{
 		return Vector3f::ZERO;	// nothing to do here, move along
 	}
+
+	ovrTextLayoutKey const key( font, parms, normal, up, scale, color, text );
+	uint32_t const keyHash = key.Hash();
+	ovrTextLayoutEntry const * layout = LayoutCache.Find( key, keyHash );
+	if ( layout != NULL )
+	{
+		if ( layout->NumVerts > 0 )
+		{
+			VertexBlockType vb( font, layout->NumVerts, pos, Quatf(), parms.Billboard, parms.TrackRoll );
+			memcpy( vb.Verts, layout->Verts, layout->NumVerts * sizeof( fontVertex_t ) );
+			vb.LayoutSerial = layout->Serial;
+			VertexBlocks.PushBack( vb );
+		}
+		return layout->ToNextLine;
+	}
+
 	Vector3f toNextLine;
 	VertexBlockType vb = DrawTextToVertexBlock( font, parms, pos, normal, up, scale, color, text, &toNextLine );
+	ovrTextLayoutEntry const * inserted = LayoutCache.Insert( key, keyHash, vb.Verts, vb.NumVerts, toNextLine );
+	vb.LayoutSerial = ( inserted != NULL ) ? inserted->Serial : 0;
 
 	// add the new vertex block to the array of vertex blocks
 	VertexBlocks.PushBack( vb );
@@ -2053,22 +2818,138 @@ Vector3f BitmapFontSurfaceLocal::DrawTextBillboarded3Df( BitmapFont const & font
 }
 
 
-//==============================================================
-// vbSort_t
-// small structure that is used to sort vertex blocks by their distance to the camera
-//==============================================================
-struct vbSort_t
+//==============================
+// DepthSortKey
+// Squared distances are never negative, so their IEEE bits sort like the values. The top
+// 16 bits keep 7 bits of mantissa, which is still finer than the old qsort comparator that
+// truncated the difference of the squared distances to an integer.
+static uint16_t DepthSortKey( float const distanceSquared )
 {
-	int		VertexBlockIndex;
-	float	DistanceSquared;
-};
+	uint32_t bits;
+	memcpy( &bits, &distanceSquared, sizeof( bits ) );
+	return static_cast< uint16_t >( bits >> 16 );
+}
 
 //==============================
-// VertexBlockSortFn
-// sort function for vertex blocks
-int VertexBlockSortFn( void const * a, void const * b )
+// RadixSortBlocks
+// Stable LSD radix sort of block indices by their 16 bit keys, nearest first.
+static void RadixSortBlocks( uint16_t const * keys, int const n, int * order, int * temp )
 {
-	return ftoi( ((vbSort_t const*)a)->DistanceSquared - ((vbSort_t const*)b)->DistanceSquared );
+	int counts[2][256];
+	memset( counts, 0, sizeof( counts ) );
+	for ( int i = 0; i < n; i++ )
+	{
+		counts[0][keys[i] & 0xFF]++;
+		counts[1][keys[i] >> 8]++;
+	}
+	for ( int pass = 0; pass < 2; pass++ )
+	{
+		int sum = 0;
+		for ( int b = 0; b < 256; b++ )
+		{
+			int const count = counts[pass][b];
+			counts[pass][b] = sum;
+			sum += count;
+		}
+	}
+	for ( int i = 0; i < n; i++ )
+	{
+		temp[counts[0][keys[i] & 0xFF]++] = i;
+	}
+	for ( int i = 0; i < n; i++ )
+	{
+		int const index = temp[i];
+		order[counts[1][keys[index] >> 8]++] = index;
+	}
+}
+
+static bool VertexRangeLess( ovrVertexRange const & a, ovrVertexRange const & b )
+{
+	return a.First < b.First;
+}
+
+//==============================
+// BitmapFontSurfaceLocal::SlotHash
+uint32_t BitmapFontSurfaceLocal::SlotHash( uint32_t const layoutSerial, Vector3f const & pivot )
+{
+	uint32_t words[4];
+	words[0] = layoutSerial;
+	memcpy( &words[1], &pivot.x, 3 * sizeof( float ) );
+	uint32_t h = 2166136261u;
+	for ( int i = 0; i < 4; i++ )
+	{
+		h = ( h ^ words[i] ) * 16777619u;
+	}
+	return h;
+}
+
+//==============================
+// BitmapFontSurfaceLocal::TransformVertexBlock
+// Writes the transformed vertices of the block into its slot of the vertex array.
+void BitmapFontSurfaceLocal::TransformVertexBlock( VertexBlockType const & vb, Matrix4f const & transform,
+		ovrFontBlockSlot & slot )
+{
+	fontVertex_t * out = &Vertices[slot.Range.First];
+	slot.Bounds.Clear();
+	for ( int j = 0; j < vb.NumVerts; j++ )
+	{
+		fontVertex_t const & v = vb.Verts[j];
+		Vector3f const position = transform.Transform( v.xyz );
+		out[j].xyz = position;
+		out[j].s = v.s;
+		out[j].t = v.t;
+		*(UInt32*)(&out[j].rgba[0]) = *(UInt32*)(&v.rgba[0]);
+		*(UInt32*)(&out[j].fontParms[0]) = *(UInt32*)(&v.fontParms[0]);
+
+		slot.Bounds.AddPoint( position );
+	}
+	DirtyRanges.PushBack( slot.Range );
+}
+
+//==============================
+// BitmapFontSurfaceLocal::UploadDirtyRanges
+void BitmapFontSurfaceLocal::UploadDirtyRanges( int const firstChangedIndex )
+{
+	bool const indicesChanged = firstChangedIndex >= 0 && firstChangedIndex < CurIndex;
+	if ( DirtyRanges.GetSizeI() == 0 && !indicesChanged )
+	{
+		return;
+	}
+
+	glBindVertexArray( FontSurfaceDef.geo.vertexArrayObject );
+
+	if ( DirtyRanges.GetSizeI() > 0 )
+	{
+		glBindBuffer( GL_ARRAY_BUFFER, FontSurfaceDef.geo.vertexBuffer );
+
+		// ranges separated by a small gap are uploaded with one call
+		int const MAX_MERGE_GAP = 64;
+		Alg::QuickSortSliced( DirtyRanges, 0, DirtyRanges.GetSize(), VertexRangeLess );
+		ovrVertexRange upload = DirtyRanges[0];
+		for ( int i = 1; i <= DirtyRanges.GetSizeI(); i++ )
+		{
+			if ( i < DirtyRanges.GetSizeI() && DirtyRanges[i].First <= upload.First + upload.Count + MAX_MERGE_GAP )
+			{
+				int const end = Alg::Max( upload.First + upload.Count, DirtyRanges[i].First + DirtyRanges[i].Count );
+				upload.Count = end - upload.First;
+				continue;
+			}
+			glBufferSubData( GL_ARRAY_BUFFER, upload.First * sizeof( fontVertex_t ),
+					upload.Count * sizeof( fontVertex_t ), (void *)&Vertices[upload.First] );
+			if ( i < DirtyRanges.GetSizeI() )
+			{
+				upload = DirtyRanges[i];
+			}
+		}
+	}
+
+	if ( indicesChanged )
+	{
+		glBufferSubData( GL_ELEMENT_ARRAY_BUFFER, firstChangedIndex * sizeof( fontIndex_t ),
+				( CurIndex - firstChangedIndex ) * sizeof( fontIndex_t ), (void *)&Indices[firstChangedIndex] );
+	}
+
+	glBindVertexArray( 0 );
 }
 
 //==============================
@@ -2076,40 +2957,79 @@ int VertexBlockSortFn( void const * a, void const * b )
 // transform all vertex blocks into the vertices array so they're ready to be uploaded to the VBO
 // We don't have to do this for each eye because the billboarded surfaces are sorted / aligned
 // based on the center view matrix's view direction.
+//
+// Vertices stay in the VBO across frames. A block that is not billboarded and is drawn with the
+// same cached layout at the same position as in the previous frame keeps its slot and is neither
+// transformed nor uploaded again. Everything else gets a new slot, and only the written ranges
+// are uploaded. The blocks are drawn in sorted order through the index buffer, which is only
+// rewritten from the first block whose position in the order changed.
 void BitmapFontSurfaceLocal::Finish( Matrix4f const & viewMatrix )
 {
 	//SPAM( "BitmapFontSurfaceLocal::Finish" );
 
 	FontSurfaceDef.geo.localBounds.Clear();
+	FrameNumber++;
 
 	Matrix4f invViewMatrix = viewMatrix.Inverted(); // if the view is never scaled or sheared we could use Transposed() here instead
 	Vector3f viewPos = invViewMatrix.GetTranslation();
 	Vector3f viewUp = GetViewMatrixUp( viewMatrix );
 
-	// sort vertex blocks indices based on distance to pivot
-	int const MAX_VERTEX_BLOCKS = 256;
-	vbSort_t vbSort[MAX_VERTEX_BLOCKS];
 	int const n = VertexBlocks.GetSizeI();
-	for ( int i = 0; i < n; ++i )
-	{
-		vbSort[i].VertexBlockIndex = i;
-		VertexBlockType & vb = VertexBlocks[i];
-		vbSort[i].DistanceSquared = ( vb.Pivot - viewPos ).LengthSq();
+	FrameSlots.Resize( n );
+	DirtyRanges.Resize( 0 );
+
+	// reclaim the slots of static blocks that are drawn exactly as in the last frame
+	int numReclaimed = 0;
+	for ( int i = 0; i < n; i++ )
+	{
+		VertexBlockType const & vb = VertexBlocks[i];
+		ovrFontBlockSlot & slot = FrameSlots[i];
+		slot.LayoutSerial = vb.Billboard ? 0 : vb.LayoutSerial;
+		slot.Pivot = vb.Pivot;
+		slot.Range = ovrVertexRange( -1, vb.NumVerts );
+		slot.LastFrame = FrameNumber;
+		if ( !slot.IsStatic() )
+		{
+			continue;
+		}
+		int const * index = StaticSlotIndex.Get( SlotHash( slot.LayoutSerial, slot.Pivot ) );
+		if ( index == NULL )
+		{
+			continue;
+		}
+		ovrFontBlockSlot & prev = StaticSlots[*index];
+		if ( prev.LayoutSerial == slot.LayoutSerial && prev.Pivot == slot.Pivot && prev.LastFrame != FrameNumber )
+		{
+			prev.LastFrame = FrameNumber;
+			slot.Range = prev.Range;
+			slot.Bounds = prev.Bounds;
+			numReclaimed++;
+		}
 	}
 
-	qsort( vbSort, n, sizeof( vbSort[0] ), VertexBlockSortFn );
-
-	// transform the vertex blocks into the vertices array
-	CurIndex = 0;
-	CurVertex = 0;
+	// free the slots of static blocks that were not drawn again
+	bool staticSlotsChanged = numReclaimed != StaticSlots.GetSizeI();
+	for ( int i = 0; i < StaticSlots.GetSizeI(); i++ )
+	{
+		if ( StaticSlots[i].LastFrame != FrameNumber )
+		{
+			VertexAlloc.Free( StaticSlots[i].Range.First, StaticSlots[i].Range.Count );
+		}
+	}
 
 	// TODO:
 	// To add multiple-font-per-surface support, we need to add a 3rd component to s and t,
 	// then get the font for each vertex block, and set the texture index on each vertex in
 	// the third texture coordinate.
-	for ( int i = 0; i < VertexBlocks.GetSizeI(); ++i )
+	for ( int i = 0; i < n; i++ )
 	{
-		VertexBlockType & vb = VertexBlocks[vbSort[i].VertexBlockIndex];
+		VertexBlockType const & vb = VertexBlocks[i];
+		ovrFontBlockSlot & slot = FrameSlots[i];
+		if ( slot.Range.First >= 0 || vb.NumVerts == 0 )
+		{
+			continue;
+		}
+
 		Matrix4f transform;
 		if ( vb.Billboard )
 		{
@@ -2123,7 +3043,6 @@ void BitmapFontSurfaceLocal::Finish( Matrix4f const & viewMatrix )
 				float const len = textNormal.Length();
 				if ( len < Mathf::SmallestNonDenormal )
 				{
-					vb.Free();
 					continue;
 				}
                 textNormal *= 1.0f / len;
@@ -2137,31 +3056,113 @@ void BitmapFontSurfaceLocal::Finish( Matrix4f const & viewMatrix )
 			transform.SetTranslation( vb.Pivot );
 		}
 
-		for ( int j = 0; j < vb.NumVerts; j++ )
+		int const first = VertexAlloc.Alloc( vb.NumVerts );
+		if ( first < 0 )
 		{
-			fontVertex_t const & v = vb.Verts[j];
-			Vector3f const position = transform.Transform( v.xyz );
-			Vertices[CurVertex].xyz = position;
-			Vertices[CurVertex].s = v.s;
-			Vertices[CurVertex].t = v.t;
-			*(UInt32*)(&Vertices[CurVertex].rgba[0]) = *(UInt32*)(&v.rgba[0]);
-			*(UInt32*)(&Vertices[CurVertex].fontParms[0]) = *(UInt32*)(&v.fontParms[0]);
-			CurVertex++;
+			if ( !WarnedFull )
+			{
+				WARN( "BitmapFontSurfaceLocal::Finish: out of vertices, the surface holds %i", MaxVertices );
+				WarnedFull = true;
+			}
+			continue;
+		}
+		slot.Range.First = first;
+		TransformVertexBlock( vb, transform, slot );
+		staticSlotsChanged |= slot.IsStatic();
+	}
 
-			FontSurfaceDef.geo.localBounds.AddPoint( position );
+	// sort vertex blocks indices based on distance to pivot
+	SortKeys.Resize( n );
+	SortOrder.Resize( n );
+	SortTemp.Resize( n );
+	for ( int i = 0; i < n; i++ )
+	{
+		SortKeys[i] = DepthSortKey( ( VertexBlocks[i].Pivot - viewPos ).LengthSq() );
+	}
+	RadixSortBlocks( SortKeys.GetDataPtr(), n, SortOrder.GetDataPtr(), SortTemp.GetDataPtr() );
+
+	// write the indices in draw order, starting at the first block that changed place
+	CurIndex = 0;
+	CurVertex = 0;
+	int firstChangedIndex = -1;
+	int numDrawn = 0;
+	for ( int i = 0; i < n; i++ )
+	{
+		ovrFontBlockSlot const & slot = FrameSlots[SortOrder[i]];
+		if ( slot.Range.First < 0 )
+		{
+			continue;
+		}
+		FontSurfaceDef.geo.localBounds = Bounds3f::Union( FontSurfaceDef.geo.localBounds, slot.Bounds );
+
+		if ( firstChangedIndex < 0 && ( numDrawn >= DrawnRanges.GetSizeI() || DrawnRanges[numDrawn] != slot.Range ) )
+		{
+			firstChangedIndex = CurIndex;
+		}
+		if ( firstChangedIndex >= 0 )
+		{
+			fontIndex_t v = static_cast< fontIndex_t >( slot.Range.First );
+			fontIndex_t * indices = &Indices[CurIndex];
+			for ( int q = 0; q < slot.Range.Count / 4; q++ )
+			{
+				indices[0] = v + 2;
+				indices[1] = v + 1;
+				indices[2] = v + 0;
+				indices[3] = v + 3;
+				indices[4] = v + 2;
+				indices[5] = v + 0;
+				indices += 6;
+				v += 4;
+			}
+			if ( numDrawn < DrawnRanges.GetSizeI() )
+			{
+				DrawnRanges[numDrawn] = slot.Range;
+			}
+			else
+			{
+				DrawnRanges.PushBack( slot.Range );
+			}
+		}
+		CurIndex += ( slot.Range.Count / 4 ) * 6;
+		CurVertex += slot.Range.Count;
+		numDrawn++;
+	}
+	DrawnRanges.Resize( numDrawn );
+
+	// keep the static slots for the next frame, the others are rewritten every frame
+	if ( staticSlotsChanged )
+	{
+		StaticSlots.Resize( 0 );
+		StaticSlotIndex.Clear();
+	}
+	for ( int i = 0; i < n; i++ )
+	{
+		ovrFontBlockSlot const & slot = FrameSlots[i];
+		if ( slot.Range.First < 0 )
+		{
+			continue;
+		}
+		if ( !slot.IsStatic() )
+		{
+			VertexAlloc.Free( slot.Range.First, slot.Range.Count );
+		}
+		else if ( staticSlotsChanged )
+		{
+			StaticSlotIndex.Set( SlotHash( slot.LayoutSerial, slot.Pivot ), StaticSlots.GetSizeI() );
+			StaticSlots.PushBack( slot );
 		}
-		CurIndex += ( vb.NumVerts / 2 ) * 3;
-		// free this vertex block
-		vb.Free();
 	}
-	// remove all elements from the vertex block (but don't free the memory since it's likely to be
-	// needed on the next frame.
+
+	// free all vertex blocks but keep the array's memory since it's likely to be needed on the next frame
+	for ( int i = 0; i < n; i++ )
+	{
+		VertexBlocks[i].Free();
+	}
 	VertexBlocks.Clear();
 
-	glBindVertexArray( FontSurfaceDef.geo.vertexArrayObject );
-	glBindBuffer( GL_ARRAY_BUFFER, FontSurfaceDef.geo.vertexBuffer );
-	glBufferSubData( GL_ARRAY_BUFFER, 0, CurVertex * sizeof( fontVertex_t ), (void *)Vertices );
-	glBindVertexArray( 0 );
+	LayoutCache.AdvanceFrame();
+
+	UploadDirtyRanges( firstChangedIndex );
 	FontSurfaceDef.geo.indexCount = CurIndex;
 }
 
@@ -2189,6 +3190,13 @@ void BitmapFontSurfaceLocal::SetCullEnabled( const bool enabled )
 	FontSurfaceDef.graphicsCommand.GpuState.cullEnable = enabled;
 }
 
+//==============================
+// BitmapFontSurfaceLocal::SetLayoutCacheBudget
+void BitmapFontSurfaceLocal::SetLayoutCacheBudget( int const maxEntries, int const maxVertices )
+{
+	LayoutCache.SetBudget( maxEntries, maxVertices );
+}
+
 //==============================
 // BitmapFont::Create
 BitmapFont * BitmapFont::Create()
@@ -94,6 +94,68 @@ void GlGeometry::Create( const VertexAttribs & attribs, const Array< TriangleInd
 	}
 }
 
+void GlGeometry::Create( const void * packedVertices, const int attribMask, const int numVertices,
+						const TriangleIndex * indices, const int numIndices, const Bounds3f & bounds )
+{
+	// in VertexAttribs order
+	static const struct
+	{
+		int		location;
+		int		glType;
+		int		glComponents;
+		int		size;
+	} packedAttribs[] =
+	{
+		{ VERTEX_ATTRIBUTE_LOCATION_POSITION,		GL_FLOAT,	3,	sizeof( Vector3f ) },
+		{ VERTEX_ATTRIBUTE_LOCATION_NORMAL,			GL_FLOAT,	3,	sizeof( Vector3f ) },
+		{ VERTEX_ATTRIBUTE_LOCATION_TANGENT,		GL_FLOAT,	3,	sizeof( Vector3f ) },
+		{ VERTEX_ATTRIBUTE_LOCATION_BINORMAL,		GL_FLOAT,	3,	sizeof( Vector3f ) },
+		{ VERTEX_ATTRIBUTE_LOCATION_COLOR,			GL_FLOAT,	4,	sizeof( Vector4f ) },
+		{ VERTEX_ATTRIBUTE_LOCATION_UV0,			GL_FLOAT,	2,	sizeof( Vector2f ) },
+		{ VERTEX_ATTRIBUTE_LOCATION_UV1,			GL_FLOAT,	2,	sizeof( Vector2f ) },
+		{ VERTEX_ATTRIBUTE_LOCATION_JOINT_INDICES,	GL_INT,		4,	sizeof( Vector4i ) },
+		{ VERTEX_ATTRIBUTE_LOCATION_JOINT_WEIGHTS,	GL_FLOAT,	4,	sizeof( Vector4f ) }
+	};
+
+	vertexCount = numVertices;
+	indexCount = numIndices;
+
+	glGenBuffers( 1, &vertexBuffer );
+	glGenBuffers( 1, &indexBuffer );
+	glGenVertexArrays( 1, &vertexArrayObject );
+	glBindVertexArray( vertexArrayObject );
+	glBindBuffer( GL_ARRAY_BUFFER, vertexBuffer );
+
+	size_t offset = 0;
+	for ( int i = 0; i < (int)( sizeof( packedAttribs ) / sizeof( packedAttribs[0] ) ); i++ )
+	{
+		if ( ( attribMask & ( 1 << packedAttribs[i].location ) ) != 0 && numVertices > 0 )
+		{
+			glEnableVertexAttribArray( packedAttribs[i].location );
+			glVertexAttribPointer( packedAttribs[i].location, packedAttribs[i].glComponents, packedAttribs[i].glType, false, packedAttribs[i].size, (void *)( offset ) );
+			offset += numVertices * packedAttribs[i].size;
+		}
+		else
+		{
+			glDisableVertexAttribArray( packedAttribs[i].location );
+		}
+	}
+
+	glBufferData( GL_ARRAY_BUFFER, offset, packedVertices, GL_STATIC_DRAW );
+
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, indexBuffer );
+	glBufferData( GL_ELEMENT_ARRAY_BUFFER, numIndices * sizeof( indices[0] ), indices, GL_STATIC_DRAW );
+
+	glBindVertexArray( 0 );
+
+	for ( int i = 0; i < (int)( sizeof( packedAttribs ) / sizeof( packedAttribs[0] ) ); i++ )
+	{
+		glDisableVertexAttribArray( packedAttribs[i].location );
+	}
+
+	localBounds = bounds;
+}
+
 void GlGeometry::Update( const VertexAttribs & attribs, const bool updateBounds )
 {
 	vertexCount = attribs.position.GetSizeI();
@@ -20,6 +20,7 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 #include "stb_image.h"
 #include "PackageFiles.h"
 #include "OVR_FileSys.h"
+#include "ImageData.h"
 
 //#define OVR_USE_PERF_TIMER
 #include "OVR_PerfTimer.h"
@@ -63,6 +64,8 @@ GlTexture::GlTexture( const unsigned texture_, const int w, const int h )
 	, target( GL_TEXTURE_2D )
 	, Width( w )
 	, Height( h )
+	, Format( Texture_None )
+	, MipCount( 0 )
 {
 }
 
@@ -225,7 +228,7 @@ static int GetASTCTextureSize( const eTextureFormat format, const int w, const i
 	return numBytes;
 }
 
-static int32_t GetOvrTextureSize( const eTextureFormat format, const int w, const int h )
+int32_t GetOvrTextureSize( const eTextureFormat format, const int w, const int h )
 {
     switch ( format & Texture_TypeMask )
     {
@@ -305,6 +308,24 @@ static int32_t GetOvrTextureSize( const eTextureFormat format, const int w, cons
     return 0;
 }
 
+size_t GetGlTextureSize( const GlTexture & texture )
+{
+	if ( texture.Format == Texture_None )
+	{
+		return 0;
+	}
+	size_t size = 0;
+	int w = texture.Width;
+	int h = texture.Height;
+	for ( int i = 0; i < texture.MipCount; i++ )
+	{
+		size += GetOvrTextureSize( texture.Format, w, h );
+		w = Alg::Max( w >> 1, 1 );
+		h = Alg::Max( h >> 1, 1 );
+	}
+	return ( texture.target == GL_TEXTURE_CUBE_MAP ) ? size * 6 : size;
+}
+
 static GlTexture CreateGlTexture( const char * fileName, const eTextureFormat format, const int width, const int height,
 						const void * data, const size_t dataSize,
 						const int mipcount, const bool useSrgbFormat, const bool imageSizeStored )
@@ -411,6 +432,8 @@ static GlTexture CreateGlTexture( const char * fileName, const eTextureFormat fo
 	else
 	{
 		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
+		// the chain may stop before 1x1, so don't let the texture be incomplete
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mipcount - 1 );
 	}
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
 
@@ -418,7 +441,10 @@ static GlTexture CreateGlTexture( const char * fileName, const eTextureFormat fo
 
 	glBindTexture( GL_TEXTURE_2D, 0 );
 
-	return GlTexture( texId, GL_TEXTURE_2D, width, height );
+	GlTexture texture( texId, GL_TEXTURE_2D, width, height );
+	texture.Format = format;
+	texture.MipCount = mipcount;
+	return texture;
 }
 
 static GlTexture CreateGlCubeTexture( const char * fileName, const eTextureFormat format, const int width, const int height,
@@ -520,7 +546,10 @@ static GlTexture CreateGlCubeTexture( const char * fileName, const eTextureForma
 
 	glBindTexture( GL_TEXTURE_CUBE_MAP, 0 );
 
-	return GlTexture( texId, GL_TEXTURE_CUBE_MAP, width, height );
+	GlTexture texture( texId, GL_TEXTURE_CUBE_MAP, width, height );
+	texture.Format = format;
+	texture.MipCount = mipcount;
+	return texture;
 }
 
 GlTexture LoadRGBATextureFromMemory( const uint8_t * texture, const int width, const int height, const bool useSrgbFormat )
@@ -558,8 +587,14 @@ struct astcHeader
 	unsigned char		zsize[3];
 };
 
-GlTexture LoadASTCTextureFromMemory( uint8_t const * buffer, const size_t bufferSize, const int numPlanes )
+static bool ParseTextureASTC( const uint8_t * buffer, const size_t bufferSize, const int numPlanes, ovrTextureImage & image )
 {
+	if ( bufferSize < sizeof( astcHeader ) )
+	{
+		LOG( "Invalid ASTC file" );
+		return false;
+	}
+
 	astcHeader const * header = reinterpret_cast< astcHeader const * >( buffer );
 
 	int const w = ( (int)header->xsize[2] << 16 ) | ( (int)header->xsize[1] << 8 ) | ( (int)header->xsize[0] );
@@ -571,7 +606,7 @@ GlTexture LoadASTCTextureFromMemory( uint8_t const * buffer, const size_t buffer
 	{
 		OVR_ASSERT( header->blockDim_z == 1 );
 		LOG( "Only 2D ASTC textures are supported" );
-		return GlTexture();
+		return false;
 	}
 
 	eTextureFormat format = Texture_None;
@@ -654,9 +689,26 @@ GlTexture LoadASTCTextureFromMemory( uint8_t const * buffer, const size_t buffer
 	{
 		OVR_ASSERT( format != Texture_None );
 		LOG( "Unhandled ASTC block size: %i x %i", header->blockDim_x, header->blockDim_y );
+		return false;
+	}
+
+	image.Format = format;
+	image.Width = w;
+	image.Height = h;
+	image.MipCount = 1;
+	image.Data = buffer;
+	image.DataSize = bufferSize;
+	return true;
+}
+
+GlTexture LoadASTCTextureFromMemory( uint8_t const * buffer, const size_t bufferSize, const int numPlanes )
+{
+	ovrTextureImage image;
+	if ( !ParseTextureASTC( buffer, bufferSize, numPlanes, image ) )
+	{
 		return GlTexture();
 	}
-	return CreateGlTexture( "memory-ASTC", format, w, h, buffer, bufferSize, 1, false, false );
+	return CreateTextureFromImage( "memory-ASTC", image );
 }
 /*
 
@@ -753,23 +805,20 @@ struct OVR_PVR_HEADER
 };
 #pragma pack()
 
-GlTexture LoadTexturePVR( const char * fileName, const unsigned char * buffer, const int bufferLength,
-						bool useSrgbFormat, bool noMipMaps, int & width, int & height )
+static bool ParseTexturePVR( const char * fileName, const unsigned char * buffer, const int bufferLength,
+						bool useSrgbFormat, bool noMipMaps, ovrTextureImage & image )
 {
-	width = 0;
-	height = 0;
-
 	if ( bufferLength < ( int )( sizeof( OVR_PVR_HEADER ) ) )
 	{
 		LOG( "%s: Invalid PVR file", fileName );
-		return GlTexture( 0, 0, 0 );
+		return false;
 	}
 
 	const OVR_PVR_HEADER & header = *( OVR_PVR_HEADER * )buffer;
 	if ( header.Version != 0x03525650 )
 	{
 		LOG( "%s: Invalid PVR file version", fileName );
-		return GlTexture( 0, 0, 0 );
+		return false;
 	}
 
 	eTextureFormat format = Texture_None;
@@ -782,8 +831,8 @@ GlTexture LoadTexturePVR( const char * fileName, const unsigned char * buffer, c
 		case 23:					format = Texture_ETC2_RGBA;	break;
 		case 578721384203708274llu:	format = Texture_RGBA;		break;
 		default:
-			LOG( "%s: Unknown PVR texture format %llu, size %ix%i", fileName, header.PixelFormat, width, height );
-			return GlTexture( 0, 0, 0 );
+			LOG( "%s: Unknown PVR texture format %llu, size %ix%i", fileName, header.PixelFormat, header.Width, header.Height );
+			return false;
 	}
 
 	// skip the metadata
@@ -791,30 +840,43 @@ GlTexture LoadTexturePVR( const char * fileName, const unsigned char * buffer, c
 	if ( ( startTex < sizeof( OVR_PVR_HEADER ) ) || ( startTex >= static_cast< size_t >( bufferLength ) ) )
 	{
 		LOG( "%s: Invalid PVR header sizes", fileName );
-		return GlTexture( 0, 0, 0 );
+		return false;
 	}
 
 	const UInt32 mipCount = ( noMipMaps ) ? 1 : OVR::Alg::Max( static_cast<UInt32>( 1u ), header.MipMapCount );
 
-	width = header.Width;
-	height = header.Height;
-
-	if ( header.NumFaces == 1 )
-	{
-		return CreateGlTexture( fileName, format, width, height, buffer + startTex, bufferLength - startTex, mipCount, useSrgbFormat, false );
-	}
-	else if ( header.NumFaces == 6 )
-	{
-		return CreateGlCubeTexture( fileName, format, width, height, buffer + startTex, bufferLength - startTex, mipCount, useSrgbFormat, false );
-	}
-	else
+	if ( header.NumFaces != 1 && header.NumFaces != 6 )
 	{
 		LOG( "%s: PVR file has unsupported number of faces %d", fileName, header.NumFaces );
+		return false;
 	}
 
+	image.Format = format;
+	image.Width = header.Width;
+	image.Height = header.Height;
+	image.MipCount = mipCount;
+	image.NumFaces = header.NumFaces;
+	image.UseSrgbFormat = useSrgbFormat;
+	image.Data = buffer + startTex;
+	image.DataSize = bufferLength - startTex;
+	return true;
+}
+
+GlTexture LoadTexturePVR( const char * fileName, const unsigned char * buffer, const int bufferLength,
+						bool useSrgbFormat, bool noMipMaps, int & width, int & height )
+{
 	width = 0;
 	height = 0;
-	return GlTexture( 0, 0, 0 );
+
+	ovrTextureImage image;
+	if ( !ParseTexturePVR( fileName, buffer, bufferLength, useSrgbFormat, noMipMaps, image ) )
+	{
+		return GlTexture( 0, 0, 0 );
+	}
+
+	width = image.Width;
+	height = image.Height;
+	return CreateTextureFromImage( fileName, image );
 }
 
 
@@ -951,16 +1013,13 @@ struct OVR_KTX_HEADER
 };
 #pragma pack()
 
-GlTexture LoadTextureKTX( const char * fileName, const unsigned char * buffer, const int bufferLength,
-						bool useSrgbFormat, bool noMipMaps, int & width, int & height )
+static bool ParseTextureKTX( const char * fileName, const unsigned char * buffer, const int bufferLength,
+						bool useSrgbFormat, bool noMipMaps, ovrTextureImage & image )
 {
-	width = 0;
-	height = 0;
-
 	if ( bufferLength < (int)( sizeof( OVR_KTX_HEADER ) ) )
 	{
     	LOG( "%s: Invalid KTX file", fileName );
-        return GlTexture( 0, 0, 0 );
+        return false;
 	}
 
 	const char fileIdentifier[12] =
@@ -972,25 +1031,25 @@ GlTexture LoadTextureKTX( const char * fileName, const unsigned char * buffer, c
 	if ( memcmp( header.identifier, fileIdentifier, sizeof( fileIdentifier ) ) != 0 )
 	{
 		LOG( "%s: Invalid KTX file", fileName );
-		return GlTexture( 0, 0, 0 );
+		return false;
 	}
 	// only support little endian
 	if ( header.endianness != 0x04030201 )
 	{
 		LOG( "%s: KTX file has wrong endianess", fileName );
-		return GlTexture( 0, 0, 0 );
+		return false;
 	}
 	// only support compressed or unsigned byte
 	if ( header.glType != 0 && header.glType != GL_UNSIGNED_BYTE )
 	{
 		LOG( "%s: KTX file has unsupported glType %d", fileName, header.glType );
-		return GlTexture( 0, 0, 0 );
+		return false;
 	}
 	// no support for texture arrays
 	if ( header.numberOfArrayElements != 0 )
 	{
 		LOG( "%s: KTX file has unsupported number of array elements %d", fileName, header.numberOfArrayElements );
-		return GlTexture( 0, 0, 0 );
+		return false;
 	}
 
 	// derive the texture format from the GL format
@@ -998,7 +1057,7 @@ GlTexture LoadTextureKTX( const char * fileName, const unsigned char * buffer, c
 	if ( !GlFormatToTextureFormat( format, header.glFormat, header.glInternalFormat ) )
 	{
 		LOG( "%s: KTX file has unsupported glFormat %d, glInternalFormat %d", fileName, header.glFormat, header.glInternalFormat );
-		return GlTexture( 0, 0, 0 );
+		return false;
 	}
 
 	// skip the key value data
@@ -1006,30 +1065,120 @@ GlTexture LoadTextureKTX( const char * fileName, const unsigned char * buffer, c
 	if ( ( startTex < sizeof( OVR_KTX_HEADER ) ) || ( startTex >= static_cast< size_t >( bufferLength ) ) )
 	{
 		LOG( "%s: Invalid KTX header sizes", fileName );
+		return false;
+	}
+
+	const UInt32 mipCount = ( noMipMaps ) ? 1 : OVR::Alg::Max( static_cast<UInt32>( 1u ), header.numberOfMipmapLevels );
+
+	if ( header.numberOfFaces != 1 && header.numberOfFaces != 6 )
+	{
+		LOG( "%s: KTX file has unsupported number of faces %d", fileName, header.numberOfFaces );
+		return false;
+	}
+
+	image.Format = format;
+	image.Width = header.pixelWidth;
+	image.Height = header.pixelHeight;
+	image.MipCount = mipCount;
+	image.NumFaces = header.numberOfFaces;
+	image.UseSrgbFormat = useSrgbFormat;
+	image.ImageSizeStored = true;
+	image.Data = buffer + startTex;
+	image.DataSize = bufferLength - startTex;
+	return true;
+}
+
+GlTexture LoadTextureKTX( const char * fileName, const unsigned char * buffer, const int bufferLength,
+						bool useSrgbFormat, bool noMipMaps, int & width, int & height )
+{
+	width = 0;
+	height = 0;
+
+	ovrTextureImage image;
+	if ( !ParseTextureKTX( fileName, buffer, bufferLength, useSrgbFormat, noMipMaps, image ) )
+	{
 		return GlTexture( 0, 0, 0 );
 	}
 
-	width = header.pixelWidth;
-	height = header.pixelHeight;
+	width = image.Width;
+	height = image.Height;
+	return CreateTextureFromImage( fileName, image );
+}
 
-	const UInt32 mipCount = ( noMipMaps ) ? 1 : OVR::Alg::Max( static_cast<UInt32>( 1u ), header.numberOfMipmapLevels );
+bool WriteTextureKTX( const char * fileName, const ovrTextureImage & image )
+{
+	if ( image.Data == NULL || image.NumFaces != 1 || image.ImageSizeStored )
+	{
+		WARN( "%s: can only write single face images without stored level sizes to KTX", fileName );
+		return false;
+	}
 
-	if ( header.numberOfFaces == 1 )
+	GLenum glFormat;
+	GLenum glInternalFormat;
+	if ( !TextureFormatToGlFormat( image.Format, image.UseSrgbFormat, glFormat, glInternalFormat ) )
 	{
-		return CreateGlTexture( fileName, format, width, height, buffer + startTex, bufferLength - startTex, mipCount, useSrgbFormat, true );
+		WARN( "%s: no GL format for texture format %d", fileName, image.Format );
+		return false;
 	}
-	else if ( header.numberOfFaces == 6 )
+
+	const bool compressed = IsCompressedFormat( image.Format );
+
+	OVR_KTX_HEADER header = {};
+	const char fileIdentifier[12] =
+	{
+		'\xAB', 'K', 'T', 'X', ' ', '1', '1', '\xBB', '\r', '\n', '\x1A', '\n'
+	};
+	memcpy( header.identifier, fileIdentifier, sizeof( fileIdentifier ) );
+	header.endianness = 0x04030201;
+	header.glType = compressed ? 0 : GL_UNSIGNED_BYTE;
+	header.glTypeSize = 1;
+	header.glFormat = compressed ? 0 : glFormat;
+	header.glInternalFormat = glInternalFormat;
+	header.glBaseInternalFormat = glFormat;
+	header.pixelWidth = image.Width;
+	header.pixelHeight = image.Height;
+	header.numberOfFaces = 1;
+	header.numberOfMipmapLevels = image.MipCount;
+
+	// write to a temporary file first so a reader never sees a partial file
+	String tempName( fileName );
+	tempName += ".tmp";
+	FILE * f = fopen( tempName.ToCStr(), "wb" );
+	if ( f == NULL )
 	{
-		return CreateGlCubeTexture( fileName, format, width, height, buffer + startTex, bufferLength - startTex, mipCount, useSrgbFormat, true );
+		WARN( "Failed to write %s", tempName.ToCStr() );
+		return false;
 	}
-	else
+
+	bool ok = fwrite( &header, sizeof( header ), 1, f ) == 1;
+
+	const unsigned char * level = image.Data;
+	for ( int i = 0, w = image.Width, h = image.Height; ok && i < image.MipCount; i++ )
 	{
-		LOG( "%s: KTX file has unsupported number of faces %d", fileName, header.numberOfFaces );
+		const UInt32 imageSize = GetOvrTextureSize( image.Format, w, h );
+		if ( level + imageSize > image.Data + image.DataSize )
+		{
+			ok = false;
+			break;
+		}
+		const UByte padding[4] = {};
+		const size_t paddingSize = 3 - ( ( imageSize + 3 ) % 4 );
+		ok = fwrite( &imageSize, sizeof( imageSize ), 1, f ) == 1 &&
+			fwrite( level, imageSize, 1, f ) == 1 &&
+			fwrite( padding, 1, paddingSize, f ) == paddingSize;
+		level += imageSize;
+		w = Alg::Max( 1, w >> 1 );
+		h = Alg::Max( 1, h >> 1 );
 	}
 
-	width = 0;
-	height = 0;
-	return GlTexture( 0, 0, 0 );
+	ok &= ( fclose( f ) == 0 );
+	if ( !ok || rename( tempName.ToCStr(), fileName ) != 0 )
+	{
+		WARN( "Failed to write %s", fileName );
+		remove( tempName.ToCStr() );
+		return false;
+	}
+	return true;
 }
 
 unsigned char * LoadImageToRGBABuffer( const char * fileName, const unsigned char * inBuffer, const size_t inBufferLen,
@@ -1058,79 +1207,152 @@ void FreeRGBABuffer( const unsigned char * buffer )
 	stbi_image_free( (void*)buffer );
 }
 
-GlTexture LoadTextureFromBuffer( const char * fileName, const MemBuffer & buffer,
-		const TextureFlags_t & flags, int & width, int & height )
+//==============================================================
+// ovrTextureImage
+
+ovrTextureImage::ovrTextureImage()
+	: Format( Texture_None )
+	, Width( 0 )
+	, Height( 0 )
+	, MipCount( 0 )
+	, NumFaces( 1 )
+	, UseSrgbFormat( false )
+	, ImageSizeStored( false )
+	, GenerateMipmaps( false )
+	, Data( NULL )
+	, DataSize( 0 )
+	, OwnedData( NULL )
 {
-	const String ext = String( fileName ).GetExtension().ToLower();
+}
 
-	// LOG( "Loading texture buffer %s (%s), length %i", fileName, ext.ToCStr(), buffer.Length );
+ovrTextureImage::~ovrTextureImage()
+{
+	Free();
+}
 
-	GlTexture texId;
-	width = 0;
-	height = 0;
+void ovrTextureImage::Free()
+{
+	free( OwnedData );
+	OwnedData = NULL;
+	Data = NULL;
+	DataSize = 0;
+	Format = Texture_None;
+	Width = 0;
+	Height = 0;
+	MipCount = 0;
+	NumFaces = 1;
+	UseSrgbFormat = false;
+	ImageSizeStored = false;
+	GenerateMipmaps = false;
+}
+
+// Replaces the single RGBA level in image.OwnedData with the full mip chain.
+static void BuildRGBAMipChain( ovrTextureImage & image )
+{
+	OVR_PERF_TIMER( BuildRGBAMipChain );
+
+	// Decoding already runs on a loader thread per texture, so stay on this one.
+	int mipCount = 0;
+	size_t totalSize = 0;
+	uint8_t * chain = BuildMipChainRGBA( image.OwnedData, image.Width, image.Height,
+			image.UseSrgbFormat, 1, mipCount, totalSize );
+	if ( chain == NULL )
+	{
+		return;
+	}
+
+	free( image.OwnedData );
+	image.OwnedData = chain;
+	image.Data = chain;
+	image.DataSize = totalSize;
+	image.MipCount = mipCount;
+}
+
+bool DecodeTextureBuffer( const char * fileName, const MemBuffer & buffer, const TextureFlags_t & flags,
+		const bool buildMipmaps, ovrTextureImage & image )
+{
+	OVR_PERF_TIMER( DecodeTextureBuffer );
+
+	image.Free();
 
 	if ( fileName == NULL || buffer.Buffer == NULL || buffer.Length < 1 )
 	{
 		// can't load anything from an empty buffer
+		return false;
 	}
-	else if (	ext == ".jpg" || ext == ".tga" ||
-				ext == ".png" || ext == ".bmp" ||
-				ext == ".psd" || ext == ".gif" ||
-				ext == ".hdr" || ext == ".pic" )
+
+	const String ext = String( fileName ).GetExtension().ToLower();
+
+	if (	ext == ".jpg" || ext == ".tga" ||
+			ext == ".png" || ext == ".bmp" ||
+			ext == ".psd" || ext == ".gif" ||
+			ext == ".hdr" || ext == ".pic" )
 	{
 		// Uncompressed files loaded by stb_image
+		int width = 0;
+		int height = 0;
 		int comp;
-		stbi_uc * image = stbi_load_from_memory( (unsigned char *)buffer.Buffer, buffer.Length, &width, &height, &comp, 4 );
-		if ( image != NULL )
+		stbi_uc * pixels = stbi_load_from_memory( (unsigned char *)buffer.Buffer, buffer.Length, &width, &height, &comp, 4 );
+		if ( pixels == NULL )
+		{
+			LOG( "stbi_load_from_memory() failed!" );
+			return false;
+		}
+
+		// Optionally outline the border alpha.
+		if ( flags & TEXTUREFLAG_ALPHA_BORDER )
 		{
-			// Optionally outline the border alpha.
-			if ( flags & TEXTUREFLAG_ALPHA_BORDER )
+			for ( int i = 0 ; i < width ; i++ )
 			{
-				for ( int i = 0 ; i < width ; i++ )
-				{
-					image[i*4+3] = 0;
-					image[((height-1)*width+i)*4+3] = 0;
-				}
-				for ( int i = 0 ; i < height ; i++ )
-				{
-					image[i*width*4+3] = 0;
-					image[(i*width+width-1)*4+3] = 0;
-				}
+				pixels[i*4+3] = 0;
+				pixels[((height-1)*width+i)*4+3] = 0;
 			}
-
-			const size_t dataSize = GetOvrTextureSize( Texture_RGBA, width, height );
-			texId = CreateGlTexture( fileName, Texture_RGBA, width, height, image, dataSize,
-					1 /* one mip level */, flags & TEXTUREFLAG_USE_SRGB, false );
-			free( image );
-			if ( !( flags & TEXTUREFLAG_NO_MIPMAPS ) )
+			for ( int i = 0 ; i < height ; i++ )
 			{
-				glBindTexture( texId.target, texId.texture );
-				glGenerateMipmap( texId.target );
-				glTexParameteri( texId.target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
+				pixels[i*width*4+3] = 0;
+				pixels[(i*width+width-1)*4+3] = 0;
 			}
-	    }
-		else
+		}
+
+		image.Format = Texture_RGBA;
+		image.Width = width;
+		image.Height = height;
+		image.MipCount = 1;
+		image.UseSrgbFormat = ( flags & TEXTUREFLAG_USE_SRGB ) != 0;
+		image.OwnedData = pixels;
+		image.Data = pixels;
+		image.DataSize = GetOvrTextureSize( Texture_RGBA, width, height );
+
+		if ( !( flags & TEXTUREFLAG_NO_MIPMAPS ) )
 		{
-			LOG( "stbi_load_from_memory() failed!" );
+			if ( buildMipmaps )
+			{
+				BuildRGBAMipChain( image );
+			}
+			else
+			{
+				image.GenerateMipmaps = true;
+			}
 		}
+		return true;
 	}
 	else if ( ext == ".pvr" )
 	{
-		texId = LoadTexturePVR( fileName, (const unsigned char *)buffer.Buffer, buffer.Length,
+		return ParseTexturePVR( fileName, (const unsigned char *)buffer.Buffer, buffer.Length,
 						( flags & TEXTUREFLAG_USE_SRGB ),
 						( flags & TEXTUREFLAG_NO_MIPMAPS ),
-						width, height );
+						image );
 	}
 	else if ( ext == ".ktx" )
 	{
-		texId = LoadTextureKTX( fileName, (const unsigned char *)buffer.Buffer, buffer.Length,
+		return ParseTextureKTX( fileName, (const unsigned char *)buffer.Buffer, buffer.Length,
 						( flags & TEXTUREFLAG_USE_SRGB ),
 						( flags & TEXTUREFLAG_NO_MIPMAPS ),
-						width, height );
+						image );
 	}
 	else if ( ext == ".astc" )
 	{
-		texId = LoadASTCTextureFromMemory( (const unsigned char*)buffer.Buffer, buffer.Length, 4 );
+		return ParseTextureASTC( (const unsigned char*)buffer.Buffer, buffer.Length, 4, image );
 	}
 	else if ( ext == ".pkm" )
 	{
@@ -1140,6 +1362,56 @@ GlTexture LoadTextureFromBuffer( const char * fileName, const MemBuffer & buffer
 	{
 		LOG( "unsupported file extension '%s', for file '%s'", ext.ToCStr(), fileName );
 	}
+	return false;
+}
+
+GlTexture CreateTextureFromImage( const char * fileName, const ovrTextureImage & image )
+{
+	if ( image.Data == NULL )
+	{
+		return GlTexture( 0, 0, 0 );
+	}
+
+	if ( image.NumFaces == 6 )
+	{
+		return CreateGlCubeTexture( fileName, image.Format, image.Width, image.Height, image.Data, image.DataSize,
+				image.MipCount, image.UseSrgbFormat, image.ImageSizeStored );
+	}
+
+	GlTexture texId = CreateGlTexture( fileName, image.Format, image.Width, image.Height, image.Data, image.DataSize,
+			image.MipCount, image.UseSrgbFormat, image.ImageSizeStored );
+	if ( texId.IsValid() && image.GenerateMipmaps )
+	{
+		glBindTexture( texId.target, texId.texture );
+		glGenerateMipmap( texId.target );
+		glTexParameteri( texId.target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
+		glBindTexture( texId.target, 0 );
+
+		texId.MipCount = 1;
+		for ( int size = Alg::Max( image.Width, image.Height ); size > 1; size >>= 1 )
+		{
+			texId.MipCount++;
+		}
+	}
+	return texId;
+}
+
+GlTexture LoadTextureFromBuffer( const char * fileName, const MemBuffer & buffer,
+		const TextureFlags_t & flags, int & width, int & height )
+{
+	// LOG( "Loading texture buffer %s, length %i", fileName, buffer.Length );
+
+	GlTexture texId;
+	width = 0;
+	height = 0;
+
+	ovrTextureImage image;
+	if ( DecodeTextureBuffer( fileName, buffer, flags, false, image ) )
+	{
+		width = image.Width;
+		height = image.Height;
+		texId = CreateTextureFromImage( fileName, image );
+	}
 
 	// Create a default texture if the load failed
 	if ( texId.texture == 0 )
@@ -11,7 +11,8 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 
 #include "GlTexture.h"
 
-#if defined( OVR_OS_ANDROID )
+// The format table is plain GLES, so the host benches in Tools/ build it as well.
+#if defined( OVR_OS_ANDROID ) || defined( OVR_GL_HOST_SHIM )
 
 #define GL_COMPRESSED_RGBA_ASTC_4x4_KHR   0x93B0
 #define GL_COMPRESSED_RGBA_ASTC_5x4_KHR   0x93B1
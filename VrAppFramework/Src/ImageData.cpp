@@ -15,10 +15,21 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 #include <stdio.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 
 #include "Kernel/OVR_Types.h"
 #include "Kernel/OVR_Alg.h"
+#include "Kernel/OVR_Array.h"
+#include "Kernel/OVR_Math.h"
 #include "Kernel/OVR_LogUtils.h"
+#include "Kernel/OVR_Threads.h"
+
+#if defined( OVR_CPU_ARM_NEON ) || defined( __ARM_NEON )
+#include <arm_neon.h>
+#elif defined( OVR_CPU_SSE )
+#include <emmintrin.h>
+#endif
 
 namespace OVR {
 
@@ -77,11 +88,6 @@ inline int ClampInt( const int x, const int min, const int max )
 	return min + ( ( AbsInt( x - min ) - AbsInt( x - min - max ) + max ) >> 1 );
 }
 
-inline float FracFloat( const float x )
-{
-	return x - floorf( x );
-}
-
 // "A Standard Default Color Space for the Internet - sRGB, Version 1.10"
 // Michael Stokes, Matthew Anderson, Srinivasan Chandrasekar, Ricardo Motta
 // November 5, 1996
@@ -111,315 +117,1200 @@ static float LinearToSRGB( float c )
 	}
 }
 
-unsigned char * QuarterImageSize( const unsigned char * src, const int width, const int height, const bool srgb )
+//==============================================================
+// ovrSrgbTables
+//
+// SRGBToLinear and LinearToSRGB are too slow to call per pixel and channel.
+// The forward direction only ever sees 256 values. For the inverse, Thresholds[k]
+// is the smallest float that LinearToSRGB quantizes to k or more, so the byte
+// is found with a bucket lookup and one compare. This gives exactly the same
+// result as ( int )( LinearToSRGB( l ) * 255.0f + 0.5f ) for every float.
+struct ovrSrgbTables
+{
+	static const int	NUM_BUCKETS = 4096;
+
+						ovrSrgbTables();
+
+	float				ToLinear[256];
+	float				Thresholds[257];
+	unsigned char		Buckets[NUM_BUCKETS];
+};
+
+static int LinearToSRGBByte( const float c )
+{
+	return ClampInt( ( int )( LinearToSRGB( c ) * 255.0f + 0.5f ), 0, 255 );
+}
+
+static float FloatFromBits( const UInt32 bits )
+{
+	float f;
+	memcpy( &f, &bits, sizeof( f ) );
+	return f;
+}
+
+ovrSrgbTables::ovrSrgbTables()
 {
-	float table[256];
-	if ( srgb )
+	for ( int i = 0; i < 256; i++ )
+	{
+		ToLinear[i] = SRGBToLinear( i * ( 1.0f / 255.0f ) );
+	}
+
+	// Positive floats sort like their bit patterns, so binary search the bits in [0, 1].
+	Thresholds[0] = 0.0f;
+	for ( int k = 1; k < 256; k++ )
 	{
-		for ( int i = 0; i < 256; i++ )
+		UInt32 lo = 0;
+		UInt32 hi = 0x3F800000;
+		while ( lo < hi )
 		{
-			table[ i ] = SRGBToLinear( i * ( 1.0f / 255.0f ) );
+			const UInt32 mid = lo + ( ( hi - lo ) >> 1 );
+			if ( LinearToSRGBByte( FloatFromBits( mid ) ) >= k )
+			{
+				hi = mid;
+			}
+			else
+			{
+				lo = mid + 1;
+			}
 		}
+		Thresholds[k] = FloatFromBits( lo );
 	}
+	Thresholds[256] = 2.0f;	// never reached
 
-	const int newWidth = OVR::Alg::Max( 1, width >> 1 );
-	const int newHeight = OVR::Alg::Max( 1, height >> 1 );
-	unsigned char * out = (unsigned char *)malloc( newWidth * newHeight * 4 );
-	unsigned char * out_p = out;
-	for ( int y = 0; y < newHeight; y++ )
+	// A bucket is narrower than one output step everywhere on the curve,
+	// so at most one threshold falls inside it.
+	for ( int i = 0; i < NUM_BUCKETS; i++ )
+	{
+		Buckets[i] = ( unsigned char )LinearToSRGBByte( i * ( 1.0f / NUM_BUCKETS ) );
+	}
+}
+
+static const ovrSrgbTables & GetSrgbTables()
+{
+	static ovrSrgbTables tables;
+	return tables;
+}
+
+static inline unsigned char LinearToSRGBByteFast( const ovrSrgbTables & tables, const float linear )
+{
+	const float c = Alg::Clamp( linear, 0.0f, 1.0f );
+	const int bucket = Alg::Min( ( int )( c * ovrSrgbTables::NUM_BUCKETS ), ovrSrgbTables::NUM_BUCKETS - 1 );
+	const int k = tables.Buckets[bucket];
+	return ( unsigned char )( k + ( c >= tables.Thresholds[k + 1] ) );
+}
+
+// Writes rows [y0, y1) of the half size level of src.
+// A source dimension of 1 is repeated instead of being read past.
+static void QuarterImageRows( const unsigned char * src, const int width, const int height,
+		unsigned char * dst, const int y0, const int y1, const bool srgb )
+{
+	const ovrSrgbTables & tables = GetSrgbTables();
+
+	const int newWidth = Alg::Max( 1, width >> 1 );
+	const int stride = width * 4;
+	const int stepX = ( width > 1 ) ? 4 : 0;
+
+	for ( int y = y0; y < y1; y++ )
 	{
-		const unsigned char * in_p = src + y * 2 * width * 4;
-		for ( int x = 0; x < newWidth; x++ )
+		const unsigned char * row0 = src + ( y * 2 ) * stride;
+		const unsigned char * row1 = ( y * 2 + 1 < height ) ? row0 + stride : row0;
+		unsigned char * out_p = dst + y * newWidth * 4;
+
+		int x = 0;
+		if ( srgb )
 		{
-			for ( int i = 0; i < 4; i++ )
+			for ( ; x < newWidth; x++ )
 			{
-				if ( srgb )
+				const unsigned char * p0 = row0 + x * 8;
+				const unsigned char * p1 = row1 + x * 8;
+				for ( int i = 0; i < 4; i++ )
 				{
-					const float linear = ( table[ in_p[ i ] ] +
-						table[ in_p[ 4 + i ] ] +
-						table[ in_p[ width * 4 + i ] ] +
-						table[ in_p[ width * 4 + 4 + i ] ] ) * 0.25f;
-					const float gamma = LinearToSRGB( linear );
-					out_p[ i ] = ( unsigned char )ClampInt( ( int )( gamma * 255.0f + 0.5f ), 0, 255 );
-				}
-				else
-				{
-					out_p[ i ] = ( in_p[ i ] +
-						in_p[ 4 + i ] +
-						in_p[ width * 4 + i ] +
-						in_p[ width * 4 + 4 + i ] ) >> 2;
+					const float linear = ( tables.ToLinear[ p0[ i ] ] +
+						tables.ToLinear[ p0[ stepX + i ] ] +
+						tables.ToLinear[ p1[ i ] ] +
+						tables.ToLinear[ p1[ stepX + i ] ] ) * 0.25f;
+					out_p[ x * 4 + i ] = LinearToSRGBByteFast( tables, linear );
 				}
 			}
-			out_p += 4;
-			in_p += 8;
+			continue;
+		}
+
+		if ( stepX != 0 )
+		{
+			// four output pixels from eight source pixels per row
+#if defined( OVR_CPU_ARM_NEON ) || defined( __ARM_NEON )
+			for ( ; x + 4 <= newWidth; x += 4 )
+			{
+				const uint32x4x2_t r0 = vld2q_u32( ( const uint32_t * )( row0 + x * 8 ) );
+				const uint32x4x2_t r1 = vld2q_u32( ( const uint32_t * )( row1 + x * 8 ) );
+				const uint8x16_t e0 = vreinterpretq_u8_u32( r0.val[0] );
+				const uint8x16_t o0 = vreinterpretq_u8_u32( r0.val[1] );
+				const uint8x16_t e1 = vreinterpretq_u8_u32( r1.val[0] );
+				const uint8x16_t o1 = vreinterpretq_u8_u32( r1.val[1] );
+				uint16x8_t lo = vaddl_u8( vget_low_u8( e0 ), vget_low_u8( o0 ) );
+				uint16x8_t hi = vaddl_u8( vget_high_u8( e0 ), vget_high_u8( o0 ) );
+				lo = vaddw_u8( vaddw_u8( lo, vget_low_u8( e1 ) ), vget_low_u8( o1 ) );
+				hi = vaddw_u8( vaddw_u8( hi, vget_high_u8( e1 ) ), vget_high_u8( o1 ) );
+				vst1q_u8( out_p + x * 4, vcombine_u8( vshrn_n_u16( lo, 2 ), vshrn_n_u16( hi, 2 ) ) );
+			}
+#elif defined( OVR_CPU_SSE )
+			const __m128i zero = _mm_setzero_si128();
+			for ( ; x + 4 <= newWidth; x += 4 )
+			{
+				const __m128 a0 = _mm_castsi128_ps( _mm_loadu_si128( ( const __m128i * )( row0 + x * 8 ) ) );
+				const __m128 b0 = _mm_castsi128_ps( _mm_loadu_si128( ( const __m128i * )( row0 + x * 8 + 16 ) ) );
+				const __m128 a1 = _mm_castsi128_ps( _mm_loadu_si128( ( const __m128i * )( row1 + x * 8 ) ) );
+				const __m128 b1 = _mm_castsi128_ps( _mm_loadu_si128( ( const __m128i * )( row1 + x * 8 + 16 ) ) );
+				const __m128i e0 = _mm_castps_si128( _mm_shuffle_ps( a0, b0, _MM_SHUFFLE( 2, 0, 2, 0 ) ) );
+				const __m128i o0 = _mm_castps_si128( _mm_shuffle_ps( a0, b0, _MM_SHUFFLE( 3, 1, 3, 1 ) ) );
+				const __m128i e1 = _mm_castps_si128( _mm_shuffle_ps( a1, b1, _MM_SHUFFLE( 2, 0, 2, 0 ) ) );
+				const __m128i o1 = _mm_castps_si128( _mm_shuffle_ps( a1, b1, _MM_SHUFFLE( 3, 1, 3, 1 ) ) );
+				__m128i lo = _mm_add_epi16( _mm_unpacklo_epi8( e0, zero ), _mm_unpacklo_epi8( o0, zero ) );
+				__m128i hi = _mm_add_epi16( _mm_unpackhi_epi8( e0, zero ), _mm_unpackhi_epi8( o0, zero ) );
+				lo = _mm_add_epi16( lo, _mm_add_epi16( _mm_unpacklo_epi8( e1, zero ), _mm_unpacklo_epi8( o1, zero ) ) );
+				hi = _mm_add_epi16( hi, _mm_add_epi16( _mm_unpackhi_epi8( e1, zero ), _mm_unpackhi_epi8( o1, zero ) ) );
+				_mm_storeu_si128( ( __m128i * )( out_p + x * 4 ),
+						_mm_packus_epi16( _mm_srli_epi16( lo, 2 ), _mm_srli_epi16( hi, 2 ) ) );
+			}
+#endif
+		}
+
+		for ( ; x < newWidth; x++ )
+		{
+			const unsigned char * p0 = row0 + x * 8;
+			const unsigned char * p1 = row1 + x * 8;
+			for ( int i = 0; i < 4; i++ )
+			{
+				out_p[ x * 4 + i ] = ( unsigned char )( ( p0[ i ] + p0[ stepX + i ] + p1[ i ] + p1[ stepX + i ] ) >> 2 );
+			}
 		}
 	}
+}
+
+unsigned char * QuarterImageSize( const unsigned char * src, const int width, const int height, const bool srgb )
+{
+	const int newWidth = OVR::Alg::Max( 1, width >> 1 );
+	const int newHeight = OVR::Alg::Max( 1, height >> 1 );
+	unsigned char * out = (unsigned char *)malloc( newWidth * newHeight * 4 );
+	QuarterImageRows( src, width, height, out, 0, newHeight, srgb );
 	return out;
 }
 
-static const float BICUBIC_SHARPEN = 0.75f;	// same as default PhotoShop bicubic filter
+// Splits [0, count) into ranges and runs them on up to numThreads threads.
+// The calling thread runs the first range.
+typedef void ( *ovrImageRangeFunc )( void * data, const int begin, const int end );
 
-static void FilterWeights( const float s, const int filter, float weights[ 4 ] )
+struct ovrImageRangeJob
 {
-	switch ( filter )
-	{
-	case IMAGE_FILTER_NEAREST:
+	ovrImageRangeFunc	Func;
+	void *				Data;
+	int					Begin;
+	int					End;
+};
+
+static threadReturn_t ImageRangeThreadFn( Thread * thread, void * data )
+{
+	OVR_UNUSED( thread );
+	const ovrImageRangeJob * job = static_cast< const ovrImageRangeJob * >( data );
+	job->Func( job->Data, job->Begin, job->End );
+	return (threadReturn_t)0;
+}
+
+static void ParallelForRange( const int numThreads, const int count, ovrImageRangeFunc func, void * data )
+{
+	static const int MAX_THREADS = 16;
+	const int threadCount = Alg::Clamp( Alg::Min( numThreads, count ), 1, MAX_THREADS );
+
+	ovrImageRangeJob jobs[MAX_THREADS];
+	for ( int t = 0; t < threadCount; t++ )
 	{
-				weights[ 0 ] = 1.0f;
-				break;
+		jobs[t].Func = func;
+		jobs[t].Data = data;
+		jobs[t].Begin = ( int )( ( ( int64_t )count * t ) / threadCount );
+		jobs[t].End = ( int )( ( ( int64_t )count * ( t + 1 ) ) / threadCount );
 	}
-	case IMAGE_FILTER_LINEAR:
+
+	Thread * threads[MAX_THREADS] = {};
+	for ( int t = 1; t < threadCount; t++ )
 	{
-				weights[ 0 ] = 1.0f - s;
-				weights[ 1 ] = s;
-				break;
+		Thread::CreateParams createParams( ImageRangeThreadFn, &jobs[t], 128 * 1024, -1, Thread::Running );
+		threads[t] = new Thread( createParams );
 	}
-	case IMAGE_FILTER_CUBIC:
+	func( data, jobs[0].Begin, jobs[0].End );
+	for ( int t = 1; t < threadCount; t++ )
 	{
-				weights[ 0 ] = ( ( ( ( +0.0f - BICUBIC_SHARPEN ) * s + ( +0.0f + 2.0f * BICUBIC_SHARPEN ) ) * s + ( -BICUBIC_SHARPEN ) ) * s + ( 0.0f ) );
-				weights[ 1 ] = ( ( ( ( +2.0f - BICUBIC_SHARPEN ) * s + ( -3.0f + 1.0f * BICUBIC_SHARPEN ) ) * s + ( 0.0f ) ) * s + ( 1.0f ) );
-				weights[ 2 ] = ( ( ( ( -2.0f + BICUBIC_SHARPEN ) * s + ( +3.0f - 2.0f * BICUBIC_SHARPEN ) ) * s + ( BICUBIC_SHARPEN ) ) * s + ( 0.0f ) );
-				weights[ 3 ] = ( ( ( ( +0.0f + BICUBIC_SHARPEN ) * s + ( +0.0f - 1.0f * BICUBIC_SHARPEN ) ) * s + ( 0.0f ) ) * s + ( 0.0f ) );
-				break;
+		threads[t]->Join();
+		delete threads[t];
 	}
+}
+
+//==============================================================
+// Mip chain generation
+//
+// The larger levels are built in bands of MIP_BAND_ROWS source rows: every band
+// is taken down MIP_BAND_LEVELS levels while it is still in cache, and the bands
+// are independent, so they are also what gets split across threads. The few
+// remaining small levels are built whole afterwards.
+
+static const int MIP_BAND_LEVELS = 4;
+static const int MIP_BAND_ROWS = 1 << MIP_BAND_LEVELS;
+
+struct ovrMipChainLevel
+{
+	unsigned char *	Data;
+	int				Width;
+	int				Height;
+};
+
+struct ovrMipChainJob
+{
+	const ovrMipChainLevel *	Levels;
+	int							BandLevels;
+	bool						Srgb;
+};
+
+static void BuildMipBands( void * data, const int firstBand, const int lastBand )
+{
+	const ovrMipChainJob & job = *static_cast< const ovrMipChainJob * >( data );
+	for ( int band = firstBand; band < lastBand; band++ )
+	{
+		for ( int level = 1; level <= job.BandLevels; level++ )
+		{
+			const ovrMipChainLevel & src = job.Levels[level - 1];
+			const ovrMipChainLevel & dst = job.Levels[level];
+			const int y0 = ( band * MIP_BAND_ROWS ) >> level;
+			const int y1 = Alg::Min( dst.Height, ( ( band + 1 ) * MIP_BAND_ROWS ) >> level );
+			QuarterImageRows( src.Data, src.Width, src.Height, dst.Data, y0, y1, job.Srgb );
+		}
 	}
 }
 
-unsigned char * ScaleImageRGBANonLinear( const unsigned char * src, const int width, const int height, const int newWidth, const int newHeight, const ImageFilter filter )
+unsigned char * BuildMipChainRGBA( const unsigned char * src, const int width, const int height,
+		const bool srgb, const int numThreads, int & outNumLevels, size_t & outSize )
 {
-	// if we're passed an invalid 
-	if ( src == NULL || width * height <= 0 )
+	outNumLevels = 0;
+	outSize = 0;
+	if ( src == NULL || width <= 0 || height <= 0 )
 	{
 		return NULL;
 	}
 
-	int footprintMin = 0;
-	int footprintMax = 0;
-	int offsetX = 0;
-	int offsetY = 0;
-	switch ( filter )
+	static const int MAX_LEVELS = 32;
+	ovrMipChainLevel levels[MAX_LEVELS];
+	int numLevels = 0;
+	size_t totalSize = 0;
+	for ( int w = width, h = height; ; w = Alg::Max( 1, w >> 1 ), h = Alg::Max( 1, h >> 1 ) )
 	{
-	case IMAGE_FILTER_NEAREST:
+		levels[numLevels].Width = w;
+		levels[numLevels].Height = h;
+		numLevels++;
+		totalSize += (size_t)w * h * 4;
+		if ( w == 1 && h == 1 )
+		{
+			break;
+		}
+	}
+
+	unsigned char * chain = (unsigned char *)malloc( totalSize );
+	if ( chain == NULL )
 	{
-				footprintMin = 0;
-				footprintMax = 0;
-				offsetX = width;
-				offsetY = height;
-				break;
+		LOG( "Failed to allocate mip chain!" );
+		return NULL;
 	}
-	case IMAGE_FILTER_LINEAR:
+	size_t offset = 0;
+	for ( int i = 0; i < numLevels; i++ )
 	{
-				footprintMin = 0;
-				footprintMax = 1;
-				offsetX = width - newWidth;
-				offsetY = height - newHeight;
-				break;
+		levels[i].Data = chain + offset;
+		offset += (size_t)levels[i].Width * levels[i].Height * 4;
 	}
-	case IMAGE_FILTER_CUBIC:
+	memcpy( chain, src, (size_t)width * height * 4 );
+
+	// Banding needs every band level to still be exactly half the height of
+	// the level before it.
+	int bandLevels = 0;
+	while ( bandLevels < MIP_BAND_LEVELS && bandLevels + 1 < numLevels && ( height >> ( bandLevels + 1 ) ) > 0 )
 	{
-				footprintMin = -1;
-				footprintMax = 2;
-				offsetX = width - newWidth;
-				offsetY = height - newHeight;
-				break;
+		bandLevels++;
 	}
+
+	if ( bandLevels > 0 )
+	{
+		ovrMipChainJob job;
+		job.Levels = levels;
+		job.BandLevels = bandLevels;
+		job.Srgb = srgb;
+		ParallelForRange( numThreads, ( height + MIP_BAND_ROWS - 1 ) / MIP_BAND_ROWS, BuildMipBands, &job );
+	}
+
+	for ( int level = bandLevels + 1; level < numLevels; level++ )
+	{
+		const ovrMipChainLevel & s = levels[level - 1];
+		QuarterImageRows( s.Data, s.Width, s.Height, levels[level].Data, 0, levels[level].Height, srgb );
 	}
 
-	unsigned char * scaled = ( unsigned char * )malloc( newWidth * newHeight * 4 * sizeof( unsigned char ) );
+	outNumLevels = numLevels;
+	outSize = totalSize;
+	return chain;
+}
+
+//==============================================================
+// Resampling
+//
+// ScaleImageRGBA is separable: a horizontal pass from the source rows into a
+// float buffer of newWidth x height, then a vertical pass into the result.
+// For every output column and row the source taps and their weights are
+// computed once into a table with a fixed number of taps per output. When
+// shrinking, the kernel is stretched by the scale factor so every source pixel
+// contributes, instead of point sampling four neighbours and aliasing.
+
+static const float BICUBIC_SHARPEN = 0.75f;	// same as default PhotoShop bicubic filter
 
-	if ( scaled == NULL )
+static float FilterSupport( const ImageFilter filter )
+{
+	switch ( filter )
 	{
-		LOG( "Failed to allocate resample buffers!" );
-		free( scaled );
-		return NULL;
+		case IMAGE_FILTER_NEAREST:	return 0.5f;
+		case IMAGE_FILTER_BOX:		return 0.5f;
+		case IMAGE_FILTER_LINEAR:	return 1.0f;
+		case IMAGE_FILTER_CUBIC:	return 2.0f;
+		case IMAGE_FILTER_LANCZOS:	return 3.0f;
+	}
+	return 1.0f;
+}
+
+static float Sinc( const float x )
+{
+	if ( fabsf( x ) < 1e-6f )
+	{
+		return 1.0f;
 	}
+	const float px = MATH_FLOAT_PI * x;
+	return sinf( px ) / px;
+}
 
-	for ( int y = 0; y < newHeight; y++ )
+static float FilterKernel( const ImageFilter filter, const float x )
+{
+	const float ax = fabsf( x );
+	switch ( filter )
 	{
-		const int srcY = ( y * height * 2 + offsetY ) / ( newHeight * 2 );
-		const float fracY = FracFloat( ( ( float )y * height * 2.0f + offsetY ) / ( newHeight * 2.0f ) );
+		case IMAGE_FILTER_NEAREST:
+		case IMAGE_FILTER_BOX:
+		{
+			return ( ax < 0.5f ) ? 1.0f : 0.0f;
+		}
+		case IMAGE_FILTER_LINEAR:
+		{
+			return ( ax < 1.0f ) ? 1.0f - ax : 0.0f;
+		}
+		case IMAGE_FILTER_CUBIC:
+		{
+			// Keys cubic with a = -BICUBIC_SHARPEN
+			const float a = -BICUBIC_SHARPEN;
+			if ( ax < 1.0f )
+			{
+				return ( ( a + 2.0f ) * ax - ( a + 3.0f ) ) * ax * ax + 1.0f;
+			}
+			if ( ax < 2.0f )
+			{
+				return ( ( a * ax - 5.0f * a ) * ax + 8.0f * a ) * ax - 4.0f * a;
+			}
+			return 0.0f;
+		}
+		case IMAGE_FILTER_LANCZOS:
+		{
+			return ( ax < 3.0f ) ? Sinc( x ) * Sinc( x * ( 1.0f / 3.0f ) ) : 0.0f;
+		}
+	}
+	return 0.0f;
+}
 
-		float weightsY[ 4 ] = { 0 };
-		FilterWeights( fracY, filter, weightsY );
+struct ovrResampleTable
+{
+	int				TapsPerOutput;
+	Array< int >	Indices;	// TapsPerOutput source indices per output, clamped to the source
+	Array< float >	Weights;	// normalized, unused taps have weight 0
+};
+
+static void BuildResampleTable( const int srcSize, const int dstSize, const ImageFilter filter, ovrResampleTable & table )
+{
+	const float scale = ( float )srcSize / ( float )dstSize;
 
-		for ( int x = 0; x < newWidth; x++ )
+	if ( filter == IMAGE_FILTER_NEAREST )
+	{
+		table.TapsPerOutput = 1;
+		table.Indices.Resize( dstSize );
+		table.Weights.Resize( dstSize );
+		for ( int i = 0; i < dstSize; i++ )
 		{
-			const int srcX = ( x * width * 2 + offsetX ) / ( newWidth * 2 );
-			const float fracX = FracFloat( ( ( float )x * width * 2.0f + offsetX ) / ( newWidth * 2.0f ) );
+			table.Indices[i] = ClampInt( ( i * srcSize * 2 + srcSize ) / ( dstSize * 2 ), 0, srcSize - 1 );
+			table.Weights[i] = 1.0f;
+		}
+		return;
+	}
+
+	const float filterScale = Alg::Max( 1.0f, scale );
+	const float support = FilterSupport( filter ) * filterScale;
+	table.TapsPerOutput = ( int )ceilf( support * 2.0f ) + 1;
+	table.Indices.Resize( dstSize * table.TapsPerOutput );
+	table.Weights.Resize( dstSize * table.TapsPerOutput );
 
-			float weightsX[ 4 ] = { 0 };
-			FilterWeights( fracX, filter, weightsX );
+	for ( int i = 0; i < dstSize; i++ )
+	{
+		int * indices = &table.Indices[i * table.TapsPerOutput];
+		float * weights = &table.Weights[i * table.TapsPerOutput];
 
-			float fR = 0.0f;
-			float fG = 0.0f;
-			float fB = 0.0f;
-			float fA = 0.0f;
+		const float center = ( i + 0.5f ) * scale - 0.5f;
+		const int first = ( int )floorf( center - support ) + 1;
 
-			for ( int fpY = footprintMin; fpY <= footprintMax; fpY++ )
+		float sum = 0.0f;
+		for ( int t = 0; t < table.TapsPerOutput; t++ )
+		{
+			indices[t] = ClampInt( first + t, 0, srcSize - 1 );
+			weights[t] = FilterKernel( filter, ( first + t - center ) / filterScale );
+			sum += weights[t];
+		}
+
+		if ( fabsf( sum ) < 1e-6f )
+		{
+			// a box that falls between two texels when magnifying
+			for ( int t = 0; t < table.TapsPerOutput; t++ )
 			{
-				const float wY = weightsY[ fpY - footprintMin ];
+				weights[t] = 0.0f;
+			}
+			indices[0] = ClampInt( ( int )floorf( center + 0.5f ), 0, srcSize - 1 );
+			weights[0] = 1.0f;
+			continue;
+		}
+
+		const float invSum = 1.0f / sum;
+		for ( int t = 0; t < table.TapsPerOutput; t++ )
+		{
+			weights[t] *= invSum;
+		}
+	}
+}
+
+struct ovrResampleJob
+{
+	const unsigned char *	Src;
+	int						Width;
+	int						Height;
+	int						NewWidth;
+	int						NewHeight;
+	bool					Linear;
+	const ovrResampleTable *	TableX;
+	const ovrResampleTable *	TableY;
+	const uint8_t *			RowUsed;	// source rows with a non-zero vertical weight
+	float *					Horizontal;	// NewWidth x Height RGBA
+	unsigned char *			Dst;
+};
 
-				for ( int fpX = footprintMin; fpX <= footprintMax; fpX++ )
+static void ResampleHorizontalRows( void * data, const int y0, const int y1 )
+{
+	const ovrResampleJob & job = *static_cast< const ovrResampleJob * >( data );
+	const ovrSrgbTables & tables = GetSrgbTables();
+	const int taps = job.TableX->TapsPerOutput;
+
+	// When point sampling down, most texels are never read, so converting
+	// the whole row first would be wasted.
+	const bool convertRow = taps * job.NewWidth >= job.Width;
+
+	float * row = ( float * )malloc( job.Width * 4 * sizeof( float ) );
+	for ( int y = y0; y < y1; y++ )
+	{
+		if ( !job.RowUsed[y] )
+		{
+			continue;
+		}
+
+		const unsigned char * in = job.Src + ( size_t )y * job.Width * 4;
+		float * out = job.Horizontal + ( size_t )y * job.NewWidth * 4;
+
+		if ( !convertRow )
+		{
+			for ( int x = 0; x < job.NewWidth; x++ )
+			{
+				const int * indices = &job.TableX->Indices[x * taps];
+				const float * weights = &job.TableX->Weights[x * taps];
+				for ( int c = 0; c < 4; c++ )
 				{
-					const float wX = weightsX[ fpX - footprintMin ];
-					const float wXY = wX * wY;
-
-					const int cx = ClampInt( srcX + fpX, 0, width - 1 );
-					const int cy = ClampInt( srcY + fpY, 0, height - 1 );
-					fR += src[ ( cy * width + cx ) * 4 + 0 ] * wXY;
-					fG += src[ ( cy * width + cx ) * 4 + 1 ] * wXY;
-					fB += src[ ( cy * width + cx ) * 4 + 2 ] * wXY;
-					fA += src[ ( cy * width + cx ) * 4 + 3 ] * wXY;
+					float sum = 0.0f;
+					for ( int t = 0; t < taps; t++ )
+					{
+						const unsigned char v = in[indices[t] * 4 + c];
+						sum += ( job.Linear ? tables.ToLinear[v] : ( float )v ) * weights[t];
+					}
+					out[x * 4 + c] = sum;
 				}
 			}
+			continue;
+		}
 
-			scaled[ ( y * newWidth + x ) * 4 + 0 ] = (unsigned char) Alg::Clamp( fR, 0.0f, 255.0f );
-			scaled[ ( y * newWidth + x ) * 4 + 1 ] = (unsigned char) Alg::Clamp( fG, 0.0f, 255.0f );
-			scaled[ ( y * newWidth + x ) * 4 + 2 ] = (unsigned char) Alg::Clamp( fB, 0.0f, 255.0f );
-			scaled[ ( y * newWidth + x ) * 4 + 3 ] = (unsigned char) Alg::Clamp( fA, 0.0f, 255.0f );
+		// Each source texel feeds several outputs when shrinking, so convert once.
+		if ( job.Linear )
+		{
+			for ( int i = 0; i < job.Width * 4; i++ )
+			{
+				row[i] = tables.ToLinear[in[i]];
+			}
+		}
+		else
+		{
+			for ( int i = 0; i < job.Width * 4; i++ )
+			{
+				row[i] = ( float )in[i];
+			}
+		}
+
+		for ( int x = 0; x < job.NewWidth; x++ )
+		{
+			const int * indices = &job.TableX->Indices[x * taps];
+			const float * weights = &job.TableX->Weights[x * taps];
+#if defined( OVR_CPU_ARM_NEON ) || defined( __ARM_NEON )
+			float32x4_t sum = vdupq_n_f32( 0.0f );
+			for ( int t = 0; t < taps; t++ )
+			{
+				sum = vmlaq_n_f32( sum, vld1q_f32( row + indices[t] * 4 ), weights[t] );
+			}
+			vst1q_f32( out + x * 4, sum );
+#elif defined( OVR_CPU_SSE )
+			__m128 sum = _mm_setzero_ps();
+			for ( int t = 0; t < taps; t++ )
+			{
+				sum = _mm_add_ps( sum, _mm_mul_ps( _mm_loadu_ps( row + indices[t] * 4 ), _mm_set1_ps( weights[t] ) ) );
+			}
+			_mm_storeu_ps( out + x * 4, sum );
+#else
+			float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			for ( int t = 0; t < taps; t++ )
+			{
+				const float * p = row + indices[t] * 4;
+				for ( int c = 0; c < 4; c++ )
+				{
+					sum[c] += p[c] * weights[t];
+				}
+			}
+			for ( int c = 0; c < 4; c++ )
+			{
+				out[x * 4 + c] = sum[c];
+			}
+#endif
 		}
 	}
+	free( row );
+}
 
-	return scaled;
+static void ResampleVerticalRows( void * data, const int y0, const int y1 )
+{
+	const ovrResampleJob & job = *static_cast< const ovrResampleJob * >( data );
+	const ovrSrgbTables & tables = GetSrgbTables();
+	const int taps = job.TableY->TapsPerOutput;
+	const int count = job.NewWidth * 4;
+
+	float * acc = ( float * )malloc( count * sizeof( float ) );
+	for ( int y = y0; y < y1; y++ )
+	{
+		memset( acc, 0, count * sizeof( float ) );
+		for ( int t = 0; t < taps; t++ )
+		{
+			const float w = job.TableY->Weights[y * taps + t];
+			if ( w == 0.0f )
+			{
+				continue;
+			}
+			const float * in = job.Horizontal + ( size_t )job.TableY->Indices[y * taps + t] * count;
+			int i = 0;
+#if defined( OVR_CPU_ARM_NEON ) || defined( __ARM_NEON )
+			for ( ; i + 4 <= count; i += 4 )
+			{
+				vst1q_f32( acc + i, vmlaq_n_f32( vld1q_f32( acc + i ), vld1q_f32( in + i ), w ) );
+			}
+#elif defined( OVR_CPU_SSE )
+			const __m128 w4 = _mm_set1_ps( w );
+			for ( ; i + 4 <= count; i += 4 )
+			{
+				_mm_storeu_ps( acc + i, _mm_add_ps( _mm_loadu_ps( acc + i ), _mm_mul_ps( _mm_loadu_ps( in + i ), w4 ) ) );
+			}
+#endif
+			for ( ; i < count; i++ )
+			{
+				acc[i] += in[i] * w;
+			}
+		}
+
+		unsigned char * out = job.Dst + ( size_t )y * count;
+		if ( job.Linear )
+		{
+			for ( int i = 0; i < count; i++ )
+			{
+				out[i] = LinearToSRGBByteFast( tables, acc[i] );
+			}
+		}
+		else
+		{
+			for ( int i = 0; i < count; i++ )
+			{
+				out[i] = ( unsigned char )Alg::Clamp( ( int )( acc[i] + 0.5f ), 0, 255 );
+			}
+		}
+	}
+	free( acc );
 }
 
-unsigned char * ScaleImageRGBA( const unsigned char * src, const int width, const int height, const int newWidth, const int newHeight, const ImageFilter filter, const bool linear )
+unsigned char * ScaleImageRGBA( const unsigned char * src, const int width, const int height,
+		const int newWidth, const int newHeight, const ImageFilter filter, const bool linear, const int numThreads )
 {
-	if ( src == NULL || width * height <= 0 )
+	if ( src == NULL || width <= 0 || height <= 0 || newWidth <= 0 || newHeight <= 0 )
+	{
+		return NULL;
+	}
+
+	unsigned char * scaled = ( unsigned char * )malloc( ( size_t )newWidth * newHeight * 4 );
+	float * horizontal = ( float * )malloc( ( size_t )newWidth * height * 4 * sizeof( float ) );
+
+	if ( scaled == NULL || horizontal == NULL )
 	{
+		LOG( "Failed to allocate resample buffers!" );
+		free( scaled );
+		free( horizontal );
 		return NULL;
 	}
 
-	if ( !linear )
+	ovrResampleTable tableX;
+	ovrResampleTable tableY;
+	BuildResampleTable( width, newWidth, filter, tableX );
+	BuildResampleTable( height, newHeight, filter, tableY );
+
+	Array< uint8_t > rowUsed;
+	rowUsed.Resize( height );
+	memset( rowUsed.GetDataPtr(), 0, height );
+	for ( int i = 0; i < tableY.Weights.GetSizeI(); i++ )
 	{
-		return ScaleImageRGBANonLinear( src, width, height, newWidth, newHeight, filter );
+		if ( tableY.Weights[i] != 0.0f )
+		{
+			rowUsed[tableY.Indices[i]] = 1;
+		}
 	}
 
-	int footprintMin = 0;
-	int footprintMax = 0;
-	int offsetX = 0;
-	int offsetY = 0;
-	switch ( filter )
+	ovrResampleJob job;
+	job.Src = src;
+	job.Width = width;
+	job.Height = height;
+	job.NewWidth = newWidth;
+	job.NewHeight = newHeight;
+	job.Linear = linear;
+	job.TableX = &tableX;
+	job.TableY = &tableY;
+	job.RowUsed = rowUsed.GetDataPtr();
+	job.Horizontal = horizontal;
+	job.Dst = scaled;
+
+	ParallelForRange( numThreads, height, ResampleHorizontalRows, &job );
+	ParallelForRange( numThreads, newHeight, ResampleVerticalRows, &job );
+
+	free( horizontal );
+
+	return scaled;
+}
+
+//==============================================================
+// ETC2 compression
+//
+// A fast encoder for runtime generated images such as thumbnails. RGB blocks
+// try the ETC1 individual and differential modes with both flips, picking the
+// best modifier table per sub-block, and the ETC2 planar mode for smooth
+// gradients. The T and H modes are not used. Alpha is encoded as EAC with a
+// search over all 16 modifier tables.
+//
+// Pixels inside a block are numbered column first, p = x * 4 + y, as in the spec.
+
+static const int EtcModifiers[8][2] =
+{
+	{ 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+};
+
+static const int EacModifiers[16][8] =
+{
+	{ -3, -6,  -9, -15, 2, 5, 8, 14 },
+	{ -3, -7, -10, -13, 2, 6, 9, 12 },
+	{ -2, -5,  -8, -13, 1, 4, 7, 12 },
+	{ -2, -4,  -6, -13, 1, 3, 5, 12 },
+	{ -3, -6,  -8, -12, 2, 5, 7, 11 },
+	{ -3, -7,  -9, -11, 2, 6, 8, 10 },
+	{ -4, -7,  -8, -11, 3, 6, 7, 10 },
+	{ -3, -5,  -8, -11, 2, 4, 7, 10 },
+	{ -2, -6,  -8, -10, 1, 5, 7,  9 },
+	{ -2, -5,  -8, -10, 1, 4, 7,  9 },
+	{ -2, -4,  -8, -10, 1, 3, 7,  9 },
+	{ -2, -5,  -7, -10, 1, 4, 6,  9 },
+	{ -3, -4,  -7, -10, 2, 3, 6,  9 },
+	{ -1, -2,  -3, -10, 0, 1, 2,  9 },
+	{ -4, -6,  -8,  -9, 3, 5, 7,  8 },
+	{ -3, -5,  -7,  -9, 2, 4, 6,  8 }
+};
+
+static inline int Clamp255( const int x )
+{
+	return ( x < 0 ) ? 0 : ( ( x > 255 ) ? 255 : x );
+}
+
+static inline void StoreBigEndian64( unsigned char * out, const UInt64 bits )
+{
+	for ( int i = 0; i < 8; i++ )
+	{
+		out[i] = ( unsigned char )( bits >> ( 56 - i * 8 ) );
+	}
+}
+
+struct ovrEtcSubblock
+{
+	int		Error;
+	int		Table;
+	int		Indices[16];	// modifier index per block pixel, only the sub-block's pixels are set
+};
+
+// Finds the modifier table and per pixel indices with the lowest squared error
+// for the pixels of one sub-block around a base color.
+static void EncodeEtcSubblock( const int rgb[16][3], const int * pixels, const int base[3], ovrEtcSubblock & result )
+{
+	result.Error = INT_MAX;
+	for ( int table = 0; table < 8; table++ )
 	{
-	case IMAGE_FILTER_NEAREST:
+		const int modifiers[4] = { EtcModifiers[table][0], EtcModifiers[table][1], -EtcModifiers[table][0], -EtcModifiers[table][1] };
+		int candidates[4][3];
+		for ( int m = 0; m < 4; m++ )
+		{
+			for ( int c = 0; c < 3; c++ )
+			{
+				candidates[m][c] = Clamp255( base[c] + modifiers[m] );
+			}
+		}
+
+		int error = 0;
+		int indices[8];
+		for ( int i = 0; i < 8 && error < result.Error; i++ )
+		{
+			const int * px = rgb[pixels[i]];
+			int bestError = INT_MAX;
+			for ( int m = 0; m < 4; m++ )
+			{
+				const int dr = candidates[m][0] - px[0];
+				const int dg = candidates[m][1] - px[1];
+				const int db = candidates[m][2] - px[2];
+				const int e = dr * dr + dg * dg + db * db;
+				if ( e < bestError )
+				{
+					bestError = e;
+					indices[i] = m;
+				}
+			}
+			error += bestError;
+		}
+
+		if ( error < result.Error )
+		{
+			result.Error = error;
+			result.Table = table;
+			for ( int i = 0; i < 8; i++ )
+			{
+				result.Indices[pixels[i]] = indices[i];
+			}
+		}
+	}
+}
+
+static UInt64 PackEtcIndices( const ovrEtcSubblock & s0, const int * pixels0, const ovrEtcSubblock & s1, const int * pixels1 )
+{
+	UInt64 bits = 0;
+	for ( int i = 0; i < 8; i++ )
 	{
-				footprintMin = 0;
-				footprintMax = 0;
-				offsetX = width;
-				offsetY = height;
-				break;
+		const int p0 = pixels0[i];
+		const int p1 = pixels1[i];
+		const int i0 = s0.Indices[p0];
+		const int i1 = s1.Indices[p1];
+		bits |= ( UInt64 )( i0 >> 1 ) << ( 16 + p0 ) | ( UInt64 )( i0 & 1 ) << p0;
+		bits |= ( UInt64 )( i1 >> 1 ) << ( 16 + p1 ) | ( UInt64 )( i1 & 1 ) << p1;
 	}
-	case IMAGE_FILTER_LINEAR:
+	return bits;
+}
+
+// True if a differential mode color byte would overflow and select another mode.
+static bool EtcDifferentialOverflows( const int byte )
+{
+	const int base = ( byte >> 3 ) & 31;
+	const int delta = ( ( byte & 7 ) ^ 4 ) - 4;
+	return base + delta < 0 || base + delta > 31;
+}
+
+static UInt64 EncodeEtcPlanar( const int rgb[16][3], int & outError )
+{
+	// least squares fit of c = o + x * dx + y * dy; x and y are uncorrelated on the grid
+	int q[3][3];	// O, H, V per channel
+	for ( int c = 0; c < 3; c++ )
 	{
-				footprintMin = 0;
-				footprintMax = 1;
-				offsetX = width - newWidth;
-				offsetY = height - newHeight;
-				break;
+		float sum = 0.0f;
+		float sumX = 0.0f;
+		float sumY = 0.0f;
+		for ( int p = 0; p < 16; p++ )
+		{
+			const float v = ( float )rgb[p][c];
+			sum += v;
+			sumX += v * ( ( p >> 2 ) - 1.5f );
+			sumY += v * ( ( p & 3 ) - 1.5f );
+		}
+		const float dx = sumX * ( 1.0f / 20.0f );
+		const float dy = sumY * ( 1.0f / 20.0f );
+		const float o = sum * ( 1.0f / 16.0f ) - 1.5f * dx - 1.5f * dy;
+		const float values[3] = { o, o + 4.0f * dx, o + 4.0f * dy };
+		const int maxValue = ( c == 1 ) ? 127 : 63;
+		for ( int k = 0; k < 3; k++ )
+		{
+			q[k][c] = ClampInt( ( int )( values[k] * maxValue / 255.0f + 0.5f ), 0, maxValue );
+		}
 	}
-	case IMAGE_FILTER_CUBIC:
+
+	int expanded[3][3];
+	for ( int k = 0; k < 3; k++ )
 	{
-				footprintMin = -1;
-				footprintMax = 2;
-				offsetX = width - newWidth;
-				offsetY = height - newHeight;
-				break;
+		expanded[k][0] = ( q[k][0] << 2 ) | ( q[k][0] >> 4 );
+		expanded[k][1] = ( q[k][1] << 1 ) | ( q[k][1] >> 6 );
+		expanded[k][2] = ( q[k][2] << 2 ) | ( q[k][2] >> 4 );
 	}
+
+	outError = 0;
+	for ( int p = 0; p < 16; p++ )
+	{
+		const int x = p >> 2;
+		const int y = p & 3;
+		for ( int c = 0; c < 3; c++ )
+		{
+			const int v = Clamp255( ( x * ( expanded[1][c] - expanded[0][c] ) + y * ( expanded[2][c] - expanded[0][c] ) + 4 * expanded[0][c] + 2 ) >> 2 );
+			outError += ( v - rgb[p][c] ) * ( v - rgb[p][c] );
+		}
 	}
 
-	unsigned char * scaled = ( unsigned char * )malloc( newWidth * newHeight * 4 * sizeof( unsigned char ) );
+	const int ro = q[0][0], go = q[0][1], bo = q[0][2];
+	const int rh = q[1][0], gh = q[1][1], bh = q[1][2];
+	const int rv = q[2][0], gv = q[2][1], bv = q[2][2];
 
-	float * srcLinear = ( float * )malloc( width * height * 4 * sizeof( float ) );
-	float * scaledLinear = ( float * )malloc( newWidth * newHeight * 4 * sizeof( float ) );
+	unsigned char b[8];
+	b[0] = ( unsigned char )( ( ro << 1 ) | ( go >> 6 ) );
+	b[1] = ( unsigned char )( ( ( go & 0x3F ) << 1 ) | ( bo >> 5 ) );
+	b[2] = ( unsigned char )( ( bo & 0x18 ) | ( ( bo >> 1 ) & 3 ) );
+	b[3] = ( unsigned char )( ( ( bo & 1 ) << 7 ) | ( ( rh >> 1 ) << 2 ) | 2 | ( rh & 1 ) );
+	b[4] = ( unsigned char )( ( gh << 1 ) | ( bh >> 5 ) );
+	b[5] = ( unsigned char )( ( ( bh & 0x1F ) << 3 ) | ( rv >> 3 ) );
+	b[6] = ( unsigned char )( ( ( rv & 7 ) << 5 ) | ( gv >> 2 ) );
+	b[7] = ( unsigned char )( ( ( gv & 3 ) << 6 ) | bv );
 
-	if ( scaled == NULL || srcLinear == NULL || scaledLinear == NULL )
+	// The unused bits select planar mode: red and green must not overflow, blue must.
+	if ( EtcDifferentialOverflows( b[0] ) )
 	{
-		LOG( "Failed to allocate resample buffers!" );
-		free( scaled );
-		free( srcLinear );
-		free( scaledLinear );
-		return NULL;
+		b[0] |= 0x80;
+	}
+	if ( EtcDifferentialOverflows( b[1] ) )
+	{
+		b[1] |= 0x80;
+	}
+	if ( ( ( bo >> 3 ) & 3 ) + ( ( bo >> 1 ) & 3 ) < 4 )
+	{
+		b[2] |= 0x04;	// small base, negative delta
+	}
+	else
+	{
+		b[2] |= 0xE0;	// large base, positive delta
 	}
 
-	float table[ 256 ];
-	for ( int i = 0; i < 256; i++ )
+	UInt64 bits = 0;
+	for ( int i = 0; i < 8; i++ )
 	{
-		table[ i ] = SRGBToLinear( i * ( 1.0f / 255.0f ) );
+		bits = ( bits << 8 ) | b[i];
 	}
+	return bits;
+}
+
+static UInt64 EncodeEtc2RgbBlock( const int rgb[16][3] )
+{
+	// sub-block pixel lists for flip 0 (2x4 side by side) and flip 1 (4x2 stacked)
+	static const int SubblockPixels[2][2][8] =
+	{
+		{ { 0, 1, 2, 3, 4, 5, 6, 7 }, { 8, 9, 10, 11, 12, 13, 14, 15 } },
+		{ { 0, 1, 4, 5, 8, 9, 12, 13 }, { 2, 3, 6, 7, 10, 11, 14, 15 } }
+	};
 
-	for ( int y = 0; y < height; y++ )
+	int bestError = INT_MAX;
+	UInt64 bestBits = 0;
+
+	for ( int flip = 0; flip < 2; flip++ )
 	{
-		for ( int x = 0; x < width; x++ )
+		int average[2][3];
+		for ( int s = 0; s < 2; s++ )
 		{
-			for ( int c = 0; c < 4; c++ )
+			for ( int c = 0; c < 3; c++ )
 			{
-				srcLinear[ ( y * width + x ) * 4 + c ] = table[ src[ ( y * width + x ) * 4 + c ] ];
+				int sum = 0;
+				for ( int i = 0; i < 8; i++ )
+				{
+					sum += rgb[SubblockPixels[flip][s][i]][c];
+				}
+				average[s][c] = ( sum + 4 ) >> 3;
 			}
 		}
-	}
 
-	for ( int y = 0; y < newHeight; y++ )
-	{
-		const int srcY = ( y * height * 2 + offsetY ) / ( newHeight * 2 );
-		const float fracY = FracFloat( ( ( float )y * height * 2.0f + offsetY ) / ( newHeight * 2.0f ) );
+		// differential mode, if the two 5 bit colors are close enough
+		int q5[2][3];
+		bool differential = true;
+		for ( int s = 0; s < 2; s++ )
+		{
+			for ( int c = 0; c < 3; c++ )
+			{
+				q5[s][c] = ( average[s][c] * 31 + 127 ) / 255;
+			}
+		}
+		for ( int c = 0; c < 3; c++ )
+		{
+			const int delta = q5[1][c] - q5[0][c];
+			differential &= ( delta >= -4 && delta <= 3 );
+		}
 
-		float weightsY[ 4 ] = { 0 };
-		FilterWeights( fracY, filter, weightsY );
+		for ( int mode = differential ? 0 : 1; mode < 2; mode++ )
+		{
+			int base[2][3];
+			for ( int s = 0; s < 2; s++ )
+			{
+				for ( int c = 0; c < 3; c++ )
+				{
+					if ( mode == 0 )
+					{
+						base[s][c] = ( q5[s][c] << 3 ) | ( q5[s][c] >> 2 );
+					}
+					else
+					{
+						base[s][c] = ( ( average[s][c] * 15 + 127 ) / 255 ) * 17;
+					}
+				}
+			}
+
+			ovrEtcSubblock sub[2];
+			EncodeEtcSubblock( rgb, SubblockPixels[flip][0], base[0], sub[0] );
+			EncodeEtcSubblock( rgb, SubblockPixels[flip][1], base[1], sub[1] );
+			const int error = sub[0].Error + sub[1].Error;
+			if ( error >= bestError )
+			{
+				continue;
+			}
+
+			UInt64 bits = 0;
+			if ( mode == 0 )
+			{
+				for ( int c = 0; c < 3; c++ )
+				{
+					const int shift = 59 - c * 8;
+					bits |= ( UInt64 )q5[0][c] << shift;
+					bits |= ( UInt64 )( ( q5[1][c] - q5[0][c] ) & 7 ) << ( shift - 3 );
+				}
+				bits |= ( UInt64 )1 << 33;
+			}
+			else
+			{
+				for ( int c = 0; c < 3; c++ )
+				{
+					const int shift = 60 - c * 8;
+					bits |= ( UInt64 )( base[0][c] / 17 ) << shift;
+					bits |= ( UInt64 )( base[1][c] / 17 ) << ( shift - 4 );
+				}
+			}
+			bits |= ( UInt64 )sub[0].Table << 37;
+			bits |= ( UInt64 )sub[1].Table << 34;
+			bits |= ( UInt64 )flip << 32;
+			bits |= PackEtcIndices( sub[0], SubblockPixels[flip][0], sub[1], SubblockPixels[flip][1] );
+
+			bestError = error;
+			bestBits = bits;
+		}
+	}
 
-		for ( int x = 0; x < newWidth; x++ )
+	if ( bestError > 0 )
+	{
+		int planarError = 0;
+		const UInt64 planarBits = EncodeEtcPlanar( rgb, planarError );
+		if ( planarError < bestError )
 		{
-			const int srcX = ( x * width * 2 + offsetX ) / ( newWidth * 2 );
-			const float fracX = FracFloat( ( ( float )x * width * 2.0f + offsetX ) / ( newWidth * 2.0f ) );
+			bestBits = planarBits;
+		}
+	}
 
-			float weightsX[ 4 ] = { 0 };
-			FilterWeights( fracX, filter, weightsX );
+	return bestBits;
+}
 
-			float fR = 0.0f;
-			float fG = 0.0f;
-			float fB = 0.0f;
-			float fA = 0.0f;
+static UInt64 EncodeEacAlphaBlock( const int alpha[16] )
+{
+	int minAlpha = 255;
+	int maxAlpha = 0;
+	for ( int p = 0; p < 16; p++ )
+	{
+		minAlpha = Alg::Min( minAlpha, alpha[p] );
+		maxAlpha = Alg::Max( maxAlpha, alpha[p] );
+	}
+
+	if ( minAlpha == maxAlpha )
+	{
+		// table 13 has a zero modifier at index 4
+		UInt64 bits = ( UInt64 )minAlpha << 56 | ( UInt64 )1 << 52 | ( UInt64 )13 << 48;
+		for ( int p = 0; p < 16; p++ )
+		{
+			bits |= ( UInt64 )4 << ( 45 - p * 3 );
+		}
+		return bits;
+	}
 
-			for ( int fpY = footprintMin; fpY <= footprintMax; fpY++ )
+	int bestError = INT_MAX;
+	UInt64 bestBits = 0;
+	for ( int table = 0; table < 16 && bestError > 0; table++ )
+	{
+		const int * modifiers = EacModifiers[table];
+		const int modifierRange = modifiers[7] - modifiers[3];
+		const int idealMultiplier = ( maxAlpha - minAlpha + modifierRange / 2 ) / modifierRange;
+		for ( int multiplier = Alg::Max( 1, idealMultiplier - 1 ); multiplier <= Alg::Min( 15, idealMultiplier + 1 ); multiplier++ )
+		{
+			const int base = Clamp255( ( ( minAlpha + maxAlpha ) - ( modifiers[7] + modifiers[3] ) * multiplier + 1 ) >> 1 );
+			int values[8];
+			for ( int i = 0; i < 8; i++ )
 			{
-				const float wY = weightsY[ fpY - footprintMin ];
+				values[i] = Clamp255( base + modifiers[i] * multiplier );
+			}
 
-				for ( int fpX = footprintMin; fpX <= footprintMax; fpX++ )
+			int error = 0;
+			UInt64 bits = ( UInt64 )base << 56 | ( UInt64 )multiplier << 52 | ( UInt64 )table << 48;
+			for ( int p = 0; p < 16 && error < bestError; p++ )
+			{
+				int best = 0;
+				int bestPixelError = INT_MAX;
+				for ( int i = 0; i < 8; i++ )
 				{
-					const float wX = weightsX[ fpX - footprintMin ];
-					const float wXY = wX * wY;
-
-					const int cx = ClampInt( srcX + fpX, 0, width - 1 );
-					const int cy = ClampInt( srcY + fpY, 0, height - 1 );
-					fR += srcLinear[ ( cy * width + cx ) * 4 + 0 ] * wXY;
-					fG += srcLinear[ ( cy * width + cx ) * 4 + 1 ] * wXY;
-					fB += srcLinear[ ( cy * width + cx ) * 4 + 2 ] * wXY;
-					fA += srcLinear[ ( cy * width + cx ) * 4 + 3 ] * wXY;
+					const int e = ( values[i] - alpha[p] ) * ( values[i] - alpha[p] );
+					if ( e < bestPixelError )
+					{
+						bestPixelError = e;
+						best = i;
+					}
 				}
+				error += bestPixelError;
+				bits |= ( UInt64 )best << ( 45 - p * 3 );
 			}
 
-			scaledLinear[ ( y * newWidth + x ) * 4 + 0 ] = fR;
-			scaledLinear[ ( y * newWidth + x ) * 4 + 1 ] = fG;
-			scaledLinear[ ( y * newWidth + x ) * 4 + 2 ] = fB;
-			scaledLinear[ ( y * newWidth + x ) * 4 + 3 ] = fA;
+			if ( error < bestError )
+			{
+				bestError = error;
+				bestBits = bits;
+			}
 		}
 	}
+	return bestBits;
+}
+
+struct ovrEtcJob
+{
+	const unsigned char *	Src;
+	int						Width;
+	int						Height;
+	bool					Alpha;
+	unsigned char *			Dst;
+};
 
-	for ( int y = 0; y < newHeight; y++ )
+static void CompressETC2Rows( void * data, const int firstBlockRow, const int lastBlockRow )
+{
+	const ovrEtcJob & job = *static_cast< const ovrEtcJob * >( data );
+	const int blocksX = ( job.Width + 3 ) / 4;
+	const int blockBytes = job.Alpha ? 16 : 8;
+
+	for ( int by = firstBlockRow; by < lastBlockRow; by++ )
 	{
-		for ( int x = 0; x < newWidth; x++ )
+		unsigned char * out = job.Dst + ( size_t )by * blocksX * blockBytes;
+		for ( int bx = 0; bx < blocksX; bx++ )
 		{
-			for ( int c = 0; c < 4; c++ )
+			// partial blocks at the edges repeat the last row and column
+			int rgb[16][3];
+			int alpha[16];
+			for ( int p = 0; p < 16; p++ )
+			{
+				const int x = Alg::Min( bx * 4 + ( p >> 2 ), job.Width - 1 );
+				const int y = Alg::Min( by * 4 + ( p & 3 ), job.Height - 1 );
+				const unsigned char * px = job.Src + ( ( size_t )y * job.Width + x ) * 4;
+				rgb[p][0] = px[0];
+				rgb[p][1] = px[1];
+				rgb[p][2] = px[2];
+				alpha[p] = px[3];
+			}
+
+			if ( job.Alpha )
 			{
-				const float gamma = LinearToSRGB( scaledLinear[ ( y * newWidth + x ) * 4 + c ] );
-				scaled[ ( y * newWidth + x ) * 4 + c ] = ( unsigned char )ClampInt( ( int )( gamma * 255.0f + 0.5f ), 0, 255 );
+				StoreBigEndian64( out, EncodeEacAlphaBlock( alpha ) );
+				out += 8;
 			}
+			StoreBigEndian64( out, EncodeEtc2RgbBlock( rgb ) );
+			out += 8;
 		}
 	}
+}
 
-	free( scaledLinear );
-	free( srcLinear );
+size_t GetETC2Size( const int width, const int height, const bool alpha )
+{
+	return ( size_t )( ( width + 3 ) / 4 ) * ( ( height + 3 ) / 4 ) * ( alpha ? 16 : 8 );
+}
 
-	return scaled;
+void CompressImageETC2( const unsigned char * rgba, const int width, const int height, const bool alpha,
+		unsigned char * out, const int numThreads )
+{
+	ovrEtcJob job;
+	job.Src = rgba;
+	job.Width = width;
+	job.Height = height;
+	job.Alpha = alpha;
+	job.Dst = out;
+	ParallelForRange( numThreads, ( height + 3 ) / 4, CompressETC2Rows, &job );
+}
+
+unsigned char * CompressMipChainETC2( const unsigned char * rgba, const int width, const int height,
+		const bool srgb, const bool alpha, const int numThreads, int & outNumLevels, size_t & outSize )
+{
+	outNumLevels = 0;
+	outSize = 0;
+
+	int numLevels = 0;
+	size_t chainSize = 0;
+	unsigned char * chain = BuildMipChainRGBA( rgba, width, height, srgb, numThreads, numLevels, chainSize );
+	if ( chain == NULL )
+	{
+		return NULL;
+	}
+
+	size_t totalSize = 0;
+	for ( int i = 0, w = width, h = height; i < numLevels; i++, w = Alg::Max( 1, w >> 1 ), h = Alg::Max( 1, h >> 1 ) )
+	{
+		totalSize += GetETC2Size( w, h, alpha );
+	}
+
+	unsigned char * compressed = ( unsigned char * )malloc( totalSize );
+	if ( compressed == NULL )
+	{
+		free( chain );
+		return NULL;
+	}
+
+	const unsigned char * src = chain;
+	unsigned char * dst = compressed;
+	for ( int i = 0, w = width, h = height; i < numLevels; i++, w = Alg::Max( 1, w >> 1 ), h = Alg::Max( 1, h >> 1 ) )
+	{
+		CompressImageETC2( src, w, h, alpha, dst, numThreads );
+		src += ( size_t )w * h * 4;
+		dst += GetETC2Size( w, h, alpha );
+	}
+	free( chain );
+
+	outNumLevels = numLevels;
+	outSize = totalSize;
+	return compressed;
 }
 
 }	// namespace OVR
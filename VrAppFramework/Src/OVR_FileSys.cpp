@@ -10,6 +10,7 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 *************************************************************************************/
 
 #include "OVR_FileSys.h"
+#include "OVR_MountTable.h"
 
 #include "OVR_Stream_Impl.h"
 #include "Kernel/OVR_UTF8Util.h"
@@ -43,11 +44,13 @@ public:
 	virtual bool			ReadFile( char const * uri, MemBufferT< uint8_t > & outBuffer );
 	virtual bool			FileExists( char const * uri );
 	virtual bool			GetLocalPathForURI( char const * uri, String &outputPath );
+	virtual ovrMountTable &	GetMountTable() { return MountTable; }
 
 	virtual void			Shutdown();
 
 private:
 	Array< ovrUriScheme* >	Schemes;
+	ovrMountTable			MountTable;
 
 private:
 	int						FindSchemeIndexForName( char const * schemeName ) const;
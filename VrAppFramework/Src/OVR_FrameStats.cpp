@@ -0,0 +1,270 @@
+/************************************************************************************
+
+Filename    :   OVR_FrameStats.cpp
+Content     :   Rolling frame interval and frame phase statistics.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include "OVR_FrameStats.h"
+
+#include <time.h>
+#include <math.h>
+#include <string.h>
+#include "Kernel/OVR_Alg.h"
+#include "Kernel/OVR_LogUtils.h"
+
+namespace OVR
+{
+
+const double ovrFrameStats::HitchThresholds[NUM_HITCH_THRESHOLDS] = { 1.5, 2.5, 4.5 };
+
+static const char * FramePhaseNames[FRAME_PHASE_MAX] =
+{
+	"advance",
+	"frame",
+	"draw"
+};
+
+double ovrFrameStats::GetMonotonicSeconds()
+{
+	struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+ovrFrameStats::ovrFrameStats() :
+	Clock( GetMonotonicSeconds ),
+	Period( 1.0 / 60.0 ),
+	LogPeriod( 0.0 ),
+	NextLogTime( 0.0 )
+{
+	Reset();
+}
+
+void ovrFrameStats::SetClock( const ovrFrameClock clock )
+{
+	Clock = ( clock != NULL ) ? clock : GetMonotonicSeconds;
+	Reset();
+}
+
+void ovrFrameStats::SetFramePeriod( const double seconds )
+{
+	Period = seconds;
+}
+
+void ovrFrameStats::Reset()
+{
+	FrameOpen = false;
+	FrameStart = 0.0;
+	OpenPhase = -1;
+	PhaseStart = 0.0;
+	for ( int i = 0; i < FRAME_PHASE_MAX; i++ )
+	{
+		OpenPhases[i] = 0.0f;
+	}
+	TotalFrames = 0;
+	for ( int i = 0; i < NUM_HITCH_THRESHOLDS; i++ )
+	{
+		TotalHitches[i] = 0;
+	}
+	TotalMissedRefreshes = 0;
+	NextLogTime = Clock() + LogPeriod;
+}
+
+int ovrFrameStats::MissedRefreshes( const double interval, const double period )
+{
+	const int refreshes = (int)floor( interval / period + 0.5 );
+	return ( refreshes > 1 ) ? refreshes - 1 : 0;
+}
+
+void ovrFrameStats::BeginFrame()
+{
+	const double now = Clock();
+
+	if ( FrameOpen )
+	{
+		if ( OpenPhase >= 0 )
+		{
+			OpenPhases[OpenPhase] += (float)( now - PhaseStart );
+		}
+
+		const double interval = now - FrameStart;
+		ovrFrameRecord & record = Frames[TotalFrames & ( MAX_FRAMES - 1 )];
+		record.Interval = (float)interval;
+		for ( int i = 0; i < FRAME_PHASE_MAX; i++ )
+		{
+			record.Phases[i] = OpenPhases[i];
+		}
+
+		TotalFrames++;
+		for ( int i = 0; i < NUM_HITCH_THRESHOLDS; i++ )
+		{
+			TotalHitches[i] += ( interval > HitchThresholds[i] * Period );
+		}
+		TotalMissedRefreshes += MissedRefreshes( interval, Period );
+	}
+
+	FrameOpen = true;
+	FrameStart = now;
+	OpenPhase = -1;
+	for ( int i = 0; i < FRAME_PHASE_MAX; i++ )
+	{
+		OpenPhases[i] = 0.0f;
+	}
+}
+
+void ovrFrameStats::DiscardFrame()
+{
+	FrameOpen = false;
+	OpenPhase = -1;
+}
+
+void ovrFrameStats::BeginPhase( const ovrFramePhase phase )
+{
+	const double now = Clock();
+	if ( OpenPhase >= 0 )
+	{
+		OpenPhases[OpenPhase] += (float)( now - PhaseStart );
+	}
+	OpenPhase = phase;
+	PhaseStart = now;
+}
+
+void ovrFrameStats::EndPhase()
+{
+	if ( OpenPhase >= 0 )
+	{
+		OpenPhases[OpenPhase] += (float)( Clock() - PhaseStart );
+		OpenPhase = -1;
+	}
+}
+
+// Nearest rank percentile of sorted values.
+static double Percentile( const float * sorted, const int count, const double fraction )
+{
+	int rank = (int)ceil( fraction * count ) - 1;
+	rank = Alg::Clamp( rank, 0, count - 1 );
+	return sorted[rank];
+}
+
+void ovrFrameStats::GetSummary( ovrFrameStatsSummary & summary ) const
+{
+	memset( &summary, 0, sizeof( summary ) );
+
+	const int count = (int)Alg::Min( TotalFrames, (long long)MAX_FRAMES );
+	summary.NumFrames = count;
+	summary.Period = Period;
+	summary.TotalFrames = TotalFrames;
+	for ( int i = 0; i < NUM_HITCH_THRESHOLDS; i++ )
+	{
+		summary.TotalHitches[i] = TotalHitches[i];
+	}
+	summary.TotalMissedRefreshes = TotalMissedRefreshes;
+	if ( count == 0 )
+	{
+		return;
+	}
+
+	// The ring is not in frame order once it wrapped, which does not matter for any of these.
+	float sorted[MAX_FRAMES];
+	double sum = 0.0;
+	for ( int i = 0; i < count; i++ )
+	{
+		const ovrFrameRecord & record = Frames[i];
+		sorted[i] = record.Interval;
+		sum += record.Interval;
+		for ( int j = 0; j < NUM_HITCH_THRESHOLDS; j++ )
+		{
+			summary.Hitches[j] += ( record.Interval > HitchThresholds[j] * Period );
+		}
+		summary.MissedRefreshes += MissedRefreshes( record.Interval, Period );
+		for ( int j = 0; j < FRAME_PHASE_MAX; j++ )
+		{
+			summary.PhaseMean[j] += record.Phases[j];
+			summary.PhaseMax[j] = Alg::Max( summary.PhaseMax[j], (double)record.Phases[j] );
+		}
+	}
+	summary.MeanInterval = sum / count;
+	for ( int j = 0; j < FRAME_PHASE_MAX; j++ )
+	{
+		summary.PhaseMean[j] /= count;
+	}
+
+	// Two passes, the single pass formula loses the small jitter of a steady frame rate.
+	double variance = 0.0;
+	for ( int i = 0; i < count; i++ )
+	{
+		const double delta = sorted[i] - summary.MeanInterval;
+		variance += delta * delta;
+	}
+	summary.Jitter = sqrt( variance / count );
+
+	Alg::QuickSortSliced( sorted, 0, count, Alg::OperatorLess< float >::Compare );
+	summary.MedianInterval = Percentile( sorted, count, 0.5 );
+	summary.Percentile90Interval = Percentile( sorted, count, 0.9 );
+	summary.Percentile99Interval = Percentile( sorted, count, 0.99 );
+	summary.MaxInterval = sorted[count - 1];
+}
+
+void ovrFrameStats::DumpText( StringBuffer & out ) const
+{
+	ovrFrameStatsSummary summary;
+	GetSummary( summary );
+
+	out.AppendFormat( "%d frames, period %.2f: mean %.2f p50 %.2f p90 %.2f p99 %.2f max %.2f jitter %.2f, "
+			"hitches %d/%d/%d, missed %d, total %lld frames %lld missed\n",
+			summary.NumFrames, summary.Period * 1e3,
+			summary.MeanInterval * 1e3, summary.MedianInterval * 1e3,
+			summary.Percentile90Interval * 1e3, summary.Percentile99Interval * 1e3,
+			summary.MaxInterval * 1e3, summary.Jitter * 1e3,
+			summary.Hitches[0], summary.Hitches[1], summary.Hitches[2],
+			summary.MissedRefreshes, summary.TotalFrames, summary.TotalMissedRefreshes );
+	out.AppendString( "phases:" );
+	for ( int i = 0; i < FRAME_PHASE_MAX; i++ )
+	{
+		out.AppendFormat( " %s %.2f (max %.2f)", FramePhaseNames[i], summary.PhaseMean[i] * 1e3, summary.PhaseMax[i] * 1e3 );
+	}
+	out.AppendChar( '\n' );
+}
+
+void ovrFrameStats::SetLogPeriod( const double seconds )
+{
+	LogPeriod = seconds;
+	NextLogTime = Clock() + LogPeriod;
+}
+
+void ovrFrameStats::LogIfDue()
+{
+	if ( LogPeriod <= 0.0 )
+	{
+		return;
+	}
+	const double now = Clock();
+	if ( now < NextLogTime )
+	{
+		return;
+	}
+	NextLogTime = now + LogPeriod;
+	LogSummary();
+}
+
+void ovrFrameStats::LogSummary() const
+{
+	// one line at a time, the log truncates long messages
+	StringBuffer out;
+	DumpText( out );
+	const char * line = out.ToCStr();
+	while ( *line != '\0' )
+	{
+		const char * end = strchr( line, '\n' );
+		const int length = ( end != NULL ) ? (int)( end - line ) : (int)strlen( line );
+		LOG_WITH_TAG( "OVRFrameStats", "%.*s", length, line );
+		line += length + ( end != NULL ? 1 : 0 );
+	}
+}
+
+} // namespace OVR
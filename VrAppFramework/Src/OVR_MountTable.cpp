@@ -0,0 +1,1235 @@
+/************************************************************************************
+
+Filename    :   OVR_MountTable.cpp
+Content     :   Ordered mounts of folders, packages and memory files with a sorted index.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include "OVR_MountTable.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#if defined( OVR_OS_WIN32 )
+#include <io.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#if defined( OVR_OS_ANDROID ) || defined( OVR_OS_LINUX )
+#include <sys/inotify.h>
+#define OVR_MOUNT_TABLE_WATCH
+#endif
+
+#include "Kernel/OVR_Std.h"
+#include "Kernel/OVR_Alg.h"
+#include "Kernel/OVR_LogUtils.h"
+#include "PackageFiles.h"
+#include "ScopedMutex.h"
+
+namespace OVR
+{
+
+// A file or sub folder found by listing a folder.
+struct ovrFolderItem
+{
+	String		Name;
+	bool		IsFolder;
+
+	bool operator < ( const ovrFolderItem & other ) const
+	{
+		return strcmp( Name.ToCStr(), other.Name.ToCStr() ) < 0;
+	}
+};
+
+// Lists the files and sub folders of a local folder, sorted by name. Returns
+// false if the folder can not be opened.
+static bool ReadFolder( const String & localPath, Array< ovrFolderItem > & items )
+{
+	items.Clear();
+#if defined( OVR_OS_WIN32 )
+	String pattern( localPath );
+	pattern += "/*.*";
+	__finddata64_t fileInfo;
+	intptr_t handle = _findfirst64( pattern.ToCStr(), &fileInfo );
+	if ( handle == -1 )
+	{
+		return false;
+	}
+	do
+	{
+		if ( fileInfo.name[0] == '.' )
+		{
+			continue;
+		}
+		ovrFolderItem item;
+		item.Name = fileInfo.name;
+		item.IsFolder = ( fileInfo.attrib & _A_SUBDIR ) != 0;
+		items.PushBack( item );
+	} while ( _findnext64( handle, &fileInfo ) != -1 );
+	_findclose( handle );
+#else
+	DIR * dir = opendir( localPath.ToCStr() );
+	if ( dir == NULL )
+	{
+		return false;
+	}
+	struct dirent * entry;
+	while ( ( entry = readdir( dir ) ) != NULL )
+	{
+		if ( entry->d_name[0] == '.' )
+		{
+			continue;
+		}
+		ovrFolderItem item;
+		item.Name = entry->d_name;
+		if ( entry->d_type == DT_DIR || entry->d_type == DT_REG )
+		{
+			item.IsFolder = ( entry->d_type == DT_DIR );
+		}
+		else if ( entry->d_type == DT_LNK || entry->d_type == DT_UNKNOWN )
+		{
+			// links count as what they point to
+			String path( localPath );
+			path += "/";
+			path += entry->d_name;
+			struct stat st;
+			if ( stat( path.ToCStr(), &st ) != 0 || !( S_ISDIR( st.st_mode ) || S_ISREG( st.st_mode ) ) )
+			{
+				continue;
+			}
+			item.IsFolder = S_ISDIR( st.st_mode );
+		}
+		else
+		{
+			continue;
+		}
+		items.PushBack( item );
+	}
+	closedir( dir );
+#endif
+	if ( items.GetSizeI() > 1 )
+	{
+		Alg::QuickSort( items );
+	}
+	return true;
+}
+
+// True if any component of the path starts with a '.'.
+static bool IsHiddenPath( const char * path )
+{
+	for ( const char * s = path; *s != '\0'; s++ )
+	{
+		if ( *s == '.' && ( s == path || s[-1] == '/' ) )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// '*' and '?' do not match a '/'.
+static bool GlobMatch( const char * pattern, const char * s )
+{
+	for ( ; *pattern != '\0'; pattern++, s++ )
+	{
+		if ( *pattern == '*' )
+		{
+			for ( ; ; s++ )
+			{
+				if ( GlobMatch( pattern + 1, s ) )
+				{
+					return true;
+				}
+				if ( *s == '\0' || *s == '/' )
+				{
+					return false;
+				}
+			}
+		}
+		if ( *s == '\0' || ( *pattern == '?' ? *s == '/' : *pattern != *s ) )
+		{
+			return false;
+		}
+	}
+	return *s == '\0';
+}
+
+static int FolderLength( const int nameOffset )
+{
+	return nameOffset > 0 ? nameOffset - 1 : 0;
+}
+
+// Compares the folder part of an entry with a folder.
+static int CompareFolder( const char * path, const int nameOffset, const char * folder, const int folderLength )
+{
+	const int length = FolderLength( nameOffset );
+	const int c = memcmp( path, folder, Alg::Min( length, folderLength ) );
+	if ( c != 0 )
+	{
+		return c;
+	}
+	return ( length < folderLength ) ? -1 : ( ( length > folderLength ) ? 1 : 0 );
+}
+
+static int CompareName( const char * name, const char * other, const int otherLength )
+{
+	const int length = (int)strlen( name );
+	const int c = memcmp( name, other, Alg::Min( length, otherLength ) );
+	if ( c != 0 )
+	{
+		return c;
+	}
+	return ( length < otherLength ) ? -1 : ( ( length > otherLength ) ? 1 : 0 );
+}
+
+//==============================
+// ovrMountTable::ovrMountTable
+ovrMountTable::ovrMountTable() :
+	WatchFd( -1 )
+{
+}
+
+//==============================
+// ovrMountTable::~ovrMountTable
+ovrMountTable::~ovrMountTable()
+{
+	for ( int i = 0; i < Mounts.GetSizeI(); i++ )
+	{
+		delete Mounts[i];
+	}
+	Mounts.Clear();
+#if defined( OVR_MOUNT_TABLE_WATCH )
+	if ( WatchFd >= 0 )
+	{
+		close( WatchFd );
+	}
+#endif
+}
+
+//==============================
+// ovrMountTable::CompareEntries
+int ovrMountTable::CompareEntries( const ovrMountEntry & a, const ovrMountEntry & b )
+{
+	const int c = CompareFolder( a.Path.ToCStr(), a.NameOffset, b.Path.ToCStr(), FolderLength( b.NameOffset ) );
+	if ( c != 0 )
+	{
+		return c;
+	}
+	return strcmp( a.Path.ToCStr() + a.NameOffset, b.Path.ToCStr() + b.NameOffset );
+}
+
+//==============================
+// ovrMountTable::EntryLess
+bool ovrMountTable::EntryLess( const ovrMountEntry & a, const ovrMountEntry & b )
+{
+	return CompareEntries( a, b ) < 0;
+}
+
+//==============================
+// ovrMountTable::SortEntries
+// Sorts and drops the duplicates, keeping the first of equal entries.
+void ovrMountTable::SortEntries( Array< ovrMountEntry > & entries )
+{
+	if ( entries.GetSizeI() < 2 )
+	{
+		return;
+	}
+	Alg::QuickSortSliced( entries, 0, entries.GetSize(), EntryLess );
+	int count = 1;
+	for ( int i = 1; i < entries.GetSizeI(); i++ )
+	{
+		if ( CompareEntries( entries[count - 1], entries[i] ) != 0 )
+		{
+			entries[count++] = entries[i];
+		}
+	}
+	entries.Resize( count );
+}
+
+//==============================
+// ovrMountTable::MakeEntry
+void ovrMountTable::MakeEntry( const String & path, const bool isFolder, const int mount, const int data, ovrMountEntry & entry )
+{
+	const char * slash = strrchr( path.ToCStr(), '/' );
+	entry.Path = path;
+	entry.NameOffset = ( slash != NULL ) ? (int)( slash + 1 - path.ToCStr() ) : 0;
+	entry.Mount = mount;
+	entry.Data = data;
+	entry.IsFolder = isFolder;
+}
+
+//==============================
+// ovrMountTable::AddFolders
+// Adds a folder and all its parents.
+void ovrMountTable::AddFolders( const String & path, const int mount, Array< ovrMountEntry > & entries )
+{
+	const char * s = path.ToCStr();
+	for ( int i = 0; ; i++ )
+	{
+		if ( s[i] == '/' || ( s[i] == '\0' && i > 0 ) )
+		{
+			ovrMountEntry entry;
+			MakeEntry( String( s, i ), true, mount, -1, entry );
+			entries.PushBack( entry );
+		}
+		if ( s[i] == '\0' )
+		{
+			break;
+		}
+	}
+}
+
+//==============================
+// ovrMountTable::JoinPath
+String ovrMountTable::JoinPath( const String & folder, const char * name )
+{
+	if ( folder.IsEmpty() )
+	{
+		return String( name );
+	}
+	if ( name[0] == '\0' )
+	{
+		return folder;
+	}
+	String path( folder );
+	path += "/";
+	path += name;
+	return path;
+}
+
+//==============================
+// ovrMountTable::NormalizePath
+// Drops leading and trailing slashes.
+String ovrMountTable::NormalizePath( const char * path )
+{
+	int length;
+	path = TrimPath( path, length );
+	return String( path, length );
+}
+
+//==============================
+// ovrMountTable::TrimPath
+// Skips the leading slashes and returns the length without the trailing ones.
+const char * ovrMountTable::TrimPath( const char * path, int & length )
+{
+	while ( *path == '/' )
+	{
+		path++;
+	}
+	length = (int)strlen( path );
+	while ( length > 0 && path[length - 1] == '/' )
+	{
+		length--;
+	}
+	return path;
+}
+
+//==============================
+// ovrMountTable::LowerBound
+int ovrMountTable::LowerBound( const Array< ovrMountEntry > & entries, const char * folder, const int folderLength,
+		const char * name, const int nameLength )
+{
+	int first = 0;
+	int count = entries.GetSizeI();
+	while ( count > 0 )
+	{
+		const int step = count / 2;
+		const ovrMountEntry & entry = entries[first + step];
+		int c = CompareFolder( entry.Path.ToCStr(), entry.NameOffset, folder, folderLength );
+		if ( c == 0 )
+		{
+			c = CompareName( entry.Path.ToCStr() + entry.NameOffset, name, nameLength );
+		}
+		if ( c < 0 )
+		{
+			first += step + 1;
+			count -= step + 1;
+		}
+		else
+		{
+			count = step;
+		}
+	}
+	return first;
+}
+
+//==============================
+// ovrMountTable::FolderRange
+void ovrMountTable::FolderRange( const Array< ovrMountEntry > & entries, const String & folder, int & first, int & end )
+{
+	const int folderLength = folder.GetLengthI();
+	first = LowerBound( entries, folder.ToCStr(), folderLength, "", 0 );
+
+	// upper bound on the folder alone
+	int lo = first;
+	int count = entries.GetSizeI() - first;
+	while ( count > 0 )
+	{
+		const int step = count / 2;
+		const ovrMountEntry & entry = entries[lo + step];
+		if ( CompareFolder( entry.Path.ToCStr(), entry.NameOffset, folder.ToCStr(), folderLength ) <= 0 )
+		{
+			lo += step + 1;
+			count -= step + 1;
+		}
+		else
+		{
+			count = step;
+		}
+	}
+	end = lo;
+}
+
+//==============================
+// ovrMountTable::PrefixRange
+void ovrMountTable::PrefixRange( const Array< ovrMountEntry > & entries, const char * prefix, const int prefixLength, int & first, int & end )
+{
+	// an entry's folder truncated to the prefix length compares -1, 0 or 1
+	// with the prefix, and the 0s are contiguous
+	for ( int pass = 0; pass < 2; pass++ )
+	{
+		int lo = 0;
+		int count = entries.GetSizeI();
+		while ( count > 0 )
+		{
+			const int step = count / 2;
+			const ovrMountEntry & entry = entries[lo + step];
+			const int length = FolderLength( entry.NameOffset );
+			int c = memcmp( entry.Path.ToCStr(), prefix, Alg::Min( length, prefixLength ) );
+			if ( c == 0 && length < prefixLength )
+			{
+				c = -1;
+			}
+			if ( ( pass == 0 ) ? ( c < 0 ) : ( c <= 0 ) )
+			{
+				lo += step + 1;
+				count -= step + 1;
+			}
+			else
+			{
+				count = step;
+			}
+		}
+		( ( pass == 0 ) ? first : end ) = lo;
+	}
+}
+
+//==============================
+// ovrMountTable::FindEntry
+int ovrMountTable::FindEntry( const Array< ovrMountEntry > & entries, const char * path, const int length )
+{
+	int nameOffset = length;
+	while ( nameOffset > 0 && path[nameOffset - 1] != '/' )
+	{
+		nameOffset--;
+	}
+	const int folderLength = FolderLength( nameOffset );
+	const int index = LowerBound( entries, path, folderLength, path + nameOffset, length - nameOffset );
+	if ( index < entries.GetSizeI() && entries[index].NameOffset == nameOffset &&
+			entries[index].Path.GetLengthI() == length && memcmp( entries[index].Path.ToCStr(), path, length ) == 0 )
+	{
+		return index;
+	}
+	return -1;
+}
+
+//==============================
+// ovrMountTable::AddMount
+int ovrMountTable::AddMount( ovrMount * mount, Array< ovrMountEntry > & entries )
+{
+	AddFolders( mount->MountPoint, Mounts.GetSizeI() - 1, entries );
+	SortEntries( entries );
+	mount->Entries.Clear();
+	mount->Entries.Append( entries.GetDataPtr(), entries.GetSize() );
+	mount->Active = true;
+	RebuildIndex();
+	return Mounts.GetSizeI() - 1;
+}
+
+//==============================
+// ovrMountTable::RebuildIndex
+// Merges the sorted entries of the mounts, an entry of an earlier mount hiding
+// an equal one of a later mount.
+void ovrMountTable::RebuildIndex()
+{
+	Array< ovrMountEntry > merged;
+	Array< ovrMountEntry > next;
+	for ( int i = 0; i < Mounts.GetSizeI(); i++ )
+	{
+		if ( !Mounts[i]->Active )
+		{
+			continue;
+		}
+		const Array< ovrMountEntry > & entries = Mounts[i]->Entries;
+		next.Clear();
+		next.Reserve( merged.GetSize() + entries.GetSize() );
+		int a = 0;
+		int b = 0;
+		while ( a < merged.GetSizeI() || b < entries.GetSizeI() )
+		{
+			if ( b >= entries.GetSizeI() )
+			{
+				next.PushBack( merged[a++] );
+				continue;
+			}
+			if ( a >= merged.GetSizeI() )
+			{
+				next.PushBack( entries[b++] );
+				continue;
+			}
+			const int c = CompareEntries( merged[a], entries[b] );
+			if ( c <= 0 )
+			{
+				next.PushBack( merged[a++] );
+				b += ( c == 0 );
+			}
+			else
+			{
+				next.PushBack( entries[b++] );
+			}
+		}
+		merged = next;
+	}
+	Index = merged;
+}
+
+//==============================
+// ovrMountTable::LocalPathOf
+String ovrMountTable::LocalPathOf( const ovrMount & mount, const String & path ) const
+{
+	if ( path.GetLengthI() < mount.MountPoint.GetLengthI() )
+	{
+		// a parent of the mount point
+		return String();
+	}
+	const char * relative = path.ToCStr() + mount.MountPoint.GetLengthI();
+	if ( *relative == '/' )
+	{
+		relative++;
+	}
+	return JoinPath( mount.LocalPath, relative );
+}
+
+//==============================
+// ovrMountTable::WatchFolder
+// Returns true if the folder was not watched yet.
+bool ovrMountTable::WatchFolder( const int mount, const String & folder )
+{
+#if defined( OVR_MOUNT_TABLE_WATCH )
+	if ( WatchFd < 0 )
+	{
+		return false;
+	}
+	const String localPath = JoinPath( Mounts[mount]->LocalPath, folder.ToCStr() );
+	const int wd = inotify_add_watch( WatchFd, localPath.ToCStr(),
+			IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR );
+	if ( wd < 0 )
+	{
+		WARN( "ovrMountTable: can not watch '%s', changes will be missed", localPath.ToCStr() );
+		return false;
+	}
+	// watching a folder again returns the same descriptor
+	const bool isNew = ( Watches.Get( wd ) == NULL );
+	ovrWatch watch;
+	watch.Mount = mount;
+	watch.Folder = folder;
+	Watches.Set( wd, watch );
+	return isNew;
+#else
+	OVR_UNUSED( mount );
+	OVR_UNUSED( folder );
+	return false;
+#endif
+}
+
+//==============================
+// ovrMountTable::ScanFolder
+// Adds the entries in a folder of a mount, relative to its root.
+void ovrMountTable::ScanFolder( const int mount, const String & folder, const bool recurse, Array< ovrMountEntry > & entries )
+{
+	const ovrMount & m = *Mounts[mount];
+	if ( m.Watch )
+	{
+		// before listing, so nothing created in between is missed
+		WatchFolder( mount, folder );
+	}
+	Array< ovrFolderItem > items;
+	if ( !ReadFolder( JoinPath( m.LocalPath, folder.ToCStr() ), items ) )
+	{
+		return;
+	}
+	const String virtualFolder = JoinPath( m.MountPoint, folder.ToCStr() );
+	for ( int i = 0; i < items.GetSizeI(); i++ )
+	{
+		ovrMountEntry entry;
+		MakeEntry( JoinPath( virtualFolder, items[i].Name.ToCStr() ), items[i].IsFolder, mount, -1, entry );
+		entries.PushBack( entry );
+		if ( items[i].IsFolder && recurse )
+		{
+			ScanFolder( mount, JoinPath( folder, items[i].Name.ToCStr() ), true, entries );
+		}
+	}
+}
+
+//==============================
+// ovrMountTable::RescanFolders
+// Lists the folders again and updates the entries of the mount. Only the new
+// sub folders are scanned recursively. Returns true if anything changed.
+bool ovrMountTable::RescanFolders( const int mount, const Array< String > & folders )
+{
+	ovrMount & m = *Mounts[mount];
+	const Array< ovrMountEntry > & entries = m.Entries;
+
+	Array< bool > removed;
+	removed.Resize( entries.GetSize() );
+	for ( int i = 0; i < removed.GetSizeI(); i++ )
+	{
+		removed[i] = false;
+	}
+	Array< ovrMountEntry > added;
+	Array< String > removedFolders;
+	bool changed = false;
+
+	Array< ovrFolderItem > items;
+	for ( int f = 0; f < folders.GetSizeI(); f++ )
+	{
+		const String virtualFolder = JoinPath( m.MountPoint, folders[f].ToCStr() );
+		// A folder that is not indexed yet is new, and is scanned when its
+		// parent is. One that is gone was dropped with its parent.
+		if ( !folders[f].IsEmpty() && FindEntry( entries, virtualFolder.ToCStr(), virtualFolder.GetLengthI() ) < 0 )
+		{
+			continue;
+		}
+		if ( !ReadFolder( JoinPath( m.LocalPath, folders[f].ToCStr() ), items ) )
+		{
+			items.Clear();
+		}
+
+		int first;
+		int end;
+		FolderRange( entries, virtualFolder, first, end );
+		int i = first;
+		int j = 0;
+		while ( i < end || j < items.GetSizeI() )
+		{
+			int c;
+			if ( i >= end )
+			{
+				c = 1;
+			}
+			else if ( j >= items.GetSizeI() )
+			{
+				c = -1;
+			}
+			else
+			{
+				c = strcmp( entries[i].Path.ToCStr() + entries[i].NameOffset, items[j].Name.ToCStr() );
+				if ( c == 0 && entries[i].IsFolder != items[j].IsFolder )
+				{
+					// replaced by a different kind, drop the old one first
+					c = -1;
+					j--;
+				}
+			}
+			if ( c < 0 )
+			{
+				removed[i] = true;
+				if ( entries[i].IsFolder )
+				{
+					removedFolders.PushBack( entries[i].Path );
+					int dfirst;
+					int dend;
+					FolderRange( entries, entries[i].Path, dfirst, dend );
+					for ( int k = dfirst; k < dend; k++ )
+					{
+						removed[k] = true;
+					}
+					const String prefix = entries[i].Path + "/";
+					PrefixRange( entries, prefix.ToCStr(), prefix.GetLengthI(), dfirst, dend );
+					for ( int k = dfirst; k < dend; k++ )
+					{
+						removed[k] = true;
+					}
+				}
+				changed = true;
+				i++;
+			}
+			else if ( c > 0 )
+			{
+				ovrMountEntry entry;
+				MakeEntry( JoinPath( virtualFolder, items[j].Name.ToCStr() ), items[j].IsFolder, mount, -1, entry );
+				added.PushBack( entry );
+				if ( items[j].IsFolder )
+				{
+					ScanFolder( mount, JoinPath( folders[f], items[j].Name.ToCStr() ), true, added );
+				}
+				changed = true;
+				j++;
+			}
+			else
+			{
+				if ( items[j].IsFolder && m.Watch && WatchFolder( mount, JoinPath( folders[f], items[j].Name.ToCStr() ) ) )
+				{
+					// The folder was deleted and created again since the last
+					// refresh, so its old watch is gone and its contents may differ.
+					int dfirst;
+					int dend;
+					FolderRange( entries, entries[i].Path, dfirst, dend );
+					for ( int k = dfirst; k < dend; k++ )
+					{
+						removed[k] = true;
+					}
+					const String prefix = entries[i].Path + "/";
+					PrefixRange( entries, prefix.ToCStr(), prefix.GetLengthI(), dfirst, dend );
+					for ( int k = dfirst; k < dend; k++ )
+					{
+						removed[k] = true;
+					}
+					ScanFolder( mount, JoinPath( folders[f], items[j].Name.ToCStr() ), true, added );
+					changed = true;
+				}
+				i++;
+				j++;
+			}
+		}
+	}
+
+	if ( !changed )
+	{
+		return false;
+	}
+
+#if defined( OVR_MOUNT_TABLE_WATCH )
+	// A folder moved out of the mount keeps its watches, which would report
+	// changes under its old name.
+	if ( removedFolders.GetSizeI() > 0 )
+	{
+		Array< int > stale;
+		for ( Hash< int, ovrWatch >::ConstIterator it = Watches.Begin(); it != Watches.End(); ++it )
+		{
+			if ( it->Second.Mount != mount )
+			{
+				continue;
+			}
+			const String path = JoinPath( m.MountPoint, it->Second.Folder.ToCStr() );
+			for ( int k = 0; k < removedFolders.GetSizeI(); k++ )
+			{
+				const int length = removedFolders[k].GetLengthI();
+				if ( strncmp( path.ToCStr(), removedFolders[k].ToCStr(), length ) == 0 &&
+						( path[length] == '\0' || path[length] == '/' ) )
+				{
+					stale.PushBack( it->First );
+					break;
+				}
+			}
+		}
+		for ( int k = 0; k < stale.GetSizeI(); k++ )
+		{
+			inotify_rm_watch( WatchFd, stale[k] );
+			Watches.Remove( stale[k] );
+		}
+	}
+#endif
+
+	SortEntries( added );
+	Array< ovrMountEntry > merged;
+	merged.Reserve( entries.GetSize() + added.GetSize() );
+	int a = 0;
+	int b = 0;
+	while ( a < entries.GetSizeI() || b < added.GetSizeI() )
+	{
+		if ( a < entries.GetSizeI() && removed[a] )
+		{
+			a++;
+			continue;
+		}
+		if ( b >= added.GetSizeI() || ( a < entries.GetSizeI() && CompareEntries( entries[a], added[b] ) < 0 ) )
+		{
+			merged.PushBack( entries[a++] );
+		}
+		else
+		{
+			merged.PushBack( added[b++] );
+		}
+	}
+	m.Entries = merged;
+	return true;
+}
+
+//==============================
+// ovrMountTable::MountFolder
+int ovrMountTable::MountFolder( const char * mountPoint, const char * localPath, const bool watch )
+{
+	ovrScopedMutex mutex( TableMutex );
+
+	ovrMount * mount = new ovrMount();
+	mount->Type = MOUNT_FOLDER;
+	mount->Active = false;
+	mount->Watch = false;
+	mount->MountPoint = NormalizePath( mountPoint );
+	mount->LocalPath = localPath;
+	while ( mount->LocalPath.GetLengthI() > 1 && mount->LocalPath.ToCStr()[mount->LocalPath.GetLengthI() - 1] == '/' )
+	{
+		mount->LocalPath = String( mount->LocalPath.ToCStr(), mount->LocalPath.GetLengthI() - 1 );
+	}
+	mount->ZipFile = NULL;
+	Mounts.PushBack( mount );
+	const int id = Mounts.GetSizeI() - 1;
+
+	Array< ovrFolderItem > items;
+	if ( !ReadFolder( mount->LocalPath, items ) )
+	{
+		WARN( "ovrMountTable: can not open folder '%s'", localPath );
+		return -1;
+	}
+
+#if defined( OVR_MOUNT_TABLE_WATCH )
+	if ( watch && WatchFd < 0 )
+	{
+		WatchFd = inotify_init();
+		if ( WatchFd >= 0 )
+		{
+			fcntl( WatchFd, F_SETFL, fcntl( WatchFd, F_GETFL ) | O_NONBLOCK );
+			fcntl( WatchFd, F_SETFD, FD_CLOEXEC );
+		}
+		else
+		{
+			WARN( "ovrMountTable: inotify is not available, folders will not be watched" );
+		}
+	}
+	mount->Watch = watch && WatchFd >= 0;
+#else
+	OVR_UNUSED( watch );
+#endif
+
+	Array< ovrMountEntry > entries;
+	ScanFolder( id, String(), true, entries );
+	LOG( "ovrMountTable: mounted '%s' at '%s' with %d entries", localPath, mount->MountPoint.ToCStr(), entries.GetSizeI() );
+	return AddMount( mount, entries );
+}
+
+//==============================
+// ovrMountTable::MountPackage
+int ovrMountTable::MountPackage( const char * mountPoint, void * zipFile )
+{
+	if ( zipFile == NULL )
+	{
+		return -1;
+	}
+
+	Array< String > names;
+	ovr_ListOtherApplicationPackage( zipFile, names );
+
+	ovrScopedMutex mutex( TableMutex );
+
+	ovrMount * mount = new ovrMount();
+	mount->Type = MOUNT_PACKAGE;
+	mount->Active = false;
+	mount->Watch = false;
+	mount->MountPoint = NormalizePath( mountPoint );
+	mount->ZipFile = zipFile;
+	Mounts.PushBack( mount );
+	const int id = Mounts.GetSizeI() - 1;
+
+	Array< ovrMountEntry > entries;
+	entries.Reserve( names.GetSize() * 2 );
+	for ( int i = 0; i < names.GetSizeI(); i++ )
+	{
+		if ( IsHiddenPath( names[i].ToCStr() ) )
+		{
+			continue;
+		}
+		const String path = JoinPath( mount->MountPoint, NormalizePath( names[i].ToCStr() ).ToCStr() );
+		const bool isFolder = names[i].GetLengthI() > 0 && names[i].ToCStr()[names[i].GetLengthI() - 1] == '/';
+		const char * slash = strrchr( path.ToCStr(), '/' );
+		if ( slash != NULL )
+		{
+			AddFolders( String( path.ToCStr(), slash - path.ToCStr() ), id, entries );
+		}
+		ovrMountEntry entry;
+		MakeEntry( path, isFolder, id, -1, entry );
+		entries.PushBack( entry );
+	}
+	return AddMount( mount, entries );
+}
+
+//==============================
+// ovrMountTable::MountMemory
+int ovrMountTable::MountMemory( const char * mountPoint, const ovrMemoryFile * files, const int numFiles )
+{
+	ovrScopedMutex mutex( TableMutex );
+
+	ovrMount * mount = new ovrMount();
+	mount->Type = MOUNT_MEMORY;
+	mount->Active = false;
+	mount->Watch = false;
+	mount->MountPoint = NormalizePath( mountPoint );
+	mount->ZipFile = NULL;
+	mount->MemoryFiles.Append( files, numFiles );
+	Mounts.PushBack( mount );
+	const int id = Mounts.GetSizeI() - 1;
+
+	Array< ovrMountEntry > entries;
+	for ( int i = 0; i < numFiles; i++ )
+	{
+		if ( IsHiddenPath( files[i].Name ) )
+		{
+			continue;
+		}
+		const String path = JoinPath( mount->MountPoint, NormalizePath( files[i].Name ).ToCStr() );
+		const char * slash = strrchr( path.ToCStr(), '/' );
+		if ( slash != NULL )
+		{
+			AddFolders( String( path.ToCStr(), slash - path.ToCStr() ), id, entries );
+		}
+		ovrMountEntry entry;
+		MakeEntry( path, false, id, i, entry );
+		entries.PushBack( entry );
+	}
+	return AddMount( mount, entries );
+}
+
+//==============================
+// ovrMountTable::Unmount
+void ovrMountTable::Unmount( const int id )
+{
+	ovrScopedMutex mutex( TableMutex );
+
+	if ( id < 0 || id >= Mounts.GetSizeI() || !Mounts[id]->Active )
+	{
+		return;
+	}
+#if defined( OVR_MOUNT_TABLE_WATCH )
+	Array< int > watches;
+	for ( Hash< int, ovrWatch >::ConstIterator it = Watches.Begin(); it != Watches.End(); ++it )
+	{
+		if ( it->Second.Mount == id )
+		{
+			watches.PushBack( it->First );
+		}
+	}
+	for ( int i = 0; i < watches.GetSizeI(); i++ )
+	{
+		inotify_rm_watch( WatchFd, watches[i] );
+		Watches.Remove( watches[i] );
+	}
+#endif
+	Mounts[id]->Active = false;
+	Mounts[id]->Entries.ClearAndRelease();
+	Mounts[id]->MemoryFiles.ClearAndRelease();
+	RebuildIndex();
+}
+
+//==============================
+// ovrMountTable::Refresh
+bool ovrMountTable::Refresh()
+{
+#if defined( OVR_MOUNT_TABLE_WATCH )
+	ovrScopedMutex mutex( TableMutex );
+
+	if ( WatchFd < 0 )
+	{
+		return false;
+	}
+
+	// the folders to rescan of each mount
+	Array< Array< String > > dirty;
+	dirty.Resize( Mounts.GetSize() );
+	bool overflow = false;
+
+	char buffer[4096] __attribute__ ( ( aligned( __alignof__( struct inotify_event ) ) ) );
+	for ( ; ; )
+	{
+		const ssize_t length = read( WatchFd, buffer, sizeof( buffer ) );
+		if ( length <= 0 )
+		{
+			break;
+		}
+		for ( const char * p = buffer; p < buffer + length; )
+		{
+			const struct inotify_event * event = (const struct inotify_event *)p;
+			p += sizeof( struct inotify_event ) + event->len;
+
+			if ( event->mask & IN_Q_OVERFLOW )
+			{
+				overflow = true;
+				continue;
+			}
+			const ovrWatch * watch = Watches.Get( event->wd );
+			if ( watch == NULL )
+			{
+				continue;
+			}
+			if ( event->mask & IN_IGNORED )
+			{
+				Watches.Remove( event->wd );
+				continue;
+			}
+			if ( ( event->mask & ( IN_DELETE_SELF | IN_MOVE_SELF ) ) != 0 && !watch->Folder.IsEmpty() )
+			{
+				// the parent folder reports it too
+				continue;
+			}
+			if ( ( event->mask & IN_ISDIR ) == 0 && event->len > 0 && event->name[0] == '.' )
+			{
+				continue;
+			}
+			Array< String > & folders = dirty[watch->Mount];
+			if ( folders.GetSizeI() == 0 || !( folders.Back() == watch->Folder ) )
+			{
+				folders.PushBack( watch->Folder );
+			}
+		}
+	}
+
+	bool changed = false;
+	for ( int i = 0; i < Mounts.GetSizeI(); i++ )
+	{
+		ovrMount & m = *Mounts[i];
+		if ( !m.Active || !m.Watch )
+		{
+			continue;
+		}
+		if ( overflow )
+		{
+			// events were lost, scan the whole mount again
+			Array< ovrMountEntry > entries;
+			ScanFolder( i, String(), true, entries );
+			AddFolders( m.MountPoint, i, entries );
+			SortEntries( entries );
+			m.Entries = entries;
+			changed = true;
+			continue;
+		}
+		if ( dirty[i].GetSizeI() == 0 )
+		{
+			continue;
+		}
+		// parents first, so new folders are scanned as a whole
+		Alg::QuickSort( dirty[i] );
+		int count = 1;
+		for ( int j = 1; j < dirty[i].GetSizeI(); j++ )
+		{
+			if ( !( dirty[i][j] == dirty[i][count - 1] ) )
+			{
+				dirty[i][count++] = dirty[i][j];
+			}
+		}
+		dirty[i].Resize( count );
+		changed |= RescanFolders( i, dirty[i] );
+	}
+
+	if ( changed )
+	{
+		RebuildIndex();
+	}
+	return changed;
+#else
+	return false;
+#endif
+}
+
+//==============================
+// ovrMountTable::FileExists
+bool ovrMountTable::FileExists( const char * path ) const
+{
+	int length;
+	path = TrimPath( path, length );
+
+	ovrScopedMutex mutex( TableMutex );
+	const int index = FindEntry( Index, path, length );
+	return index >= 0 && !Index[index].IsFolder;
+}
+
+//==============================
+// ovrMountTable::FolderExists
+bool ovrMountTable::FolderExists( const char * path ) const
+{
+	int length;
+	path = TrimPath( path, length );
+	if ( length == 0 )
+	{
+		return true;
+	}
+	ovrScopedMutex mutex( TableMutex );
+	const int index = FindEntry( Index, path, length );
+	return index >= 0 && Index[index].IsFolder;
+}
+
+//==============================
+// ovrMountTable::ListFolder
+bool ovrMountTable::ListFolder( const char * path, Array< String > & out ) const
+{
+	const String folder = NormalizePath( path );
+
+	ovrScopedMutex mutex( TableMutex );
+	if ( !folder.IsEmpty() )
+	{
+		const int index = FindEntry( Index, folder.ToCStr(), folder.GetLengthI() );
+		if ( index < 0 || !Index[index].IsFolder )
+		{
+			return false;
+		}
+	}
+	int first;
+	int end;
+	FolderRange( Index, folder, first, end );
+	out.Reserve( out.GetSize() + ( end - first ) );
+	for ( int i = first; i < end; i++ )
+	{
+		out.PushBack( Index[i].IsFolder ? Index[i].Path + "/" : Index[i].Path );
+	}
+	return true;
+}
+
+//==============================
+// ovrMountTable::Glob
+int ovrMountTable::Glob( const char * pattern, Array< String > & out ) const
+{
+	const String normalized = NormalizePath( pattern );
+	const char * p = normalized.ToCStr();
+	const int literalLength = (int)strcspn( p, "*?" );
+	const char * lastSlash = NULL;
+	for ( const char * s = p; s < p + literalLength; s++ )
+	{
+		if ( *s == '/' )
+		{
+			lastSlash = s;
+		}
+	}
+
+	ovrScopedMutex mutex( TableMutex );
+
+	// The literal part narrows the entries to one range: a name prefix in one
+	// folder when the wildcards are all in the name, otherwise a folder prefix.
+	int first;
+	int end;
+	bool stopAtName = false;
+	const char * namePrefix = NULL;
+	int namePrefixLength = 0;
+	if ( strchr( p + literalLength, '/' ) == NULL )
+	{
+		const int folderLength = ( lastSlash != NULL ) ? (int)( lastSlash - p ) : 0;
+		namePrefix = ( lastSlash != NULL ) ? lastSlash + 1 : p;
+		namePrefixLength = (int)( p + literalLength - namePrefix );
+		first = LowerBound( Index, p, folderLength, namePrefix, namePrefixLength );
+		int folderFirst;
+		FolderRange( Index, String( p, folderLength ), folderFirst, end );
+		stopAtName = true;
+	}
+	else
+	{
+		PrefixRange( Index, p, literalLength, first, end );
+	}
+
+	int count = 0;
+	for ( int i = first; i < end; i++ )
+	{
+		const ovrMountEntry & entry = Index[i];
+		if ( stopAtName && strncmp( entry.Path.ToCStr() + entry.NameOffset, namePrefix, namePrefixLength ) != 0 )
+		{
+			break;
+		}
+		if ( GlobMatch( p, entry.Path.ToCStr() ) )
+		{
+			out.PushBack( entry.IsFolder ? entry.Path + "/" : entry.Path );
+			count++;
+		}
+	}
+	return count;
+}
+
+//==============================
+// ovrMountTable::ReadFile
+bool ovrMountTable::ReadFile( const char * path, MemBufferT< uint8_t > & outBuffer ) const
+{
+	const String normalized = NormalizePath( path );
+
+	ovrMountType type;
+	String source;
+	void * zipFile = NULL;
+	ovrMemoryFile memoryFile;
+	{
+		ovrScopedMutex mutex( TableMutex );
+		const int index = FindEntry( Index, normalized.ToCStr(), normalized.GetLengthI() );
+		if ( index < 0 || Index[index].IsFolder )
+		{
+			return false;
+		}
+		const ovrMount & mount = *Mounts[Index[index].Mount];
+		type = mount.Type;
+		switch ( type )
+		{
+			case MOUNT_FOLDER:
+				source = LocalPathOf( mount, normalized );
+				break;
+			case MOUNT_PACKAGE:
+				source = LocalPathOf( mount, normalized );	// the name in the zip
+				zipFile = mount.ZipFile;
+				break;
+			case MOUNT_MEMORY:
+				memoryFile = mount.MemoryFiles[Index[index].Data];
+				break;
+		}
+	}
+
+	// read without holding the lock
+	switch ( type )
+	{
+		case MOUNT_FOLDER:
+		{
+			FILE * f = fopen( source.ToCStr(), "rb" );
+			if ( f == NULL )
+			{
+				return false;
+			}
+			fseek( f, 0, SEEK_END );
+			const long length = ftell( f );
+			fseek( f, 0, SEEK_SET );
+			outBuffer.Realloc( length > 0 ? (size_t)length : 0 );
+			const bool ok = length >= 0 && fread( (uint8_t *)outBuffer, 1, (size_t)length, f ) == (size_t)length;
+			fclose( f );
+			return ok;
+		}
+		case MOUNT_PACKAGE:
+			return ovr_ReadFileFromOtherApplicationPackage( zipFile, source.ToCStr(), outBuffer );
+		case MOUNT_MEMORY:
+			outBuffer.Realloc( memoryFile.Size );
+			memcpy( (uint8_t *)outBuffer, memoryFile.Data, memoryFile.Size );
+			return true;
+	}
+	return false;
+}
+
+//==============================
+// ovrMountTable::GetLocalPath
+bool ovrMountTable::GetLocalPath( const char * path, String & outPath ) const
+{
+	const String normalized = NormalizePath( path );
+
+	ovrScopedMutex mutex( TableMutex );
+	const int index = FindEntry( Index, normalized.ToCStr(), normalized.GetLengthI() );
+	if ( index < 0 || Mounts[Index[index].Mount]->Type != MOUNT_FOLDER )
+	{
+		return false;
+	}
+	outPath = LocalPathOf( *Mounts[Index[index].Mount], normalized );
+	return !outPath.IsEmpty();
+}
+
+//==============================
+// ovrMountTable::GetNumEntries
+int ovrMountTable::GetNumEntries() const
+{
+	ovrScopedMutex mutex( TableMutex );
+	return Index.GetSizeI();
+}
+
+} // namespace OVR
@@ -0,0 +1,626 @@
+/************************************************************************************
+
+Filename    :   OVR_PathCache.cpp
+Content     :   Cache of relative path to search path resolutions for GetFullPath.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include "OVR_PathCache.h"
+
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#if defined( OVR_OS_WIN32 )
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+#include "Kernel/OVR_Std.h"
+#include "Kernel/OVR_LogUtils.h"
+#include "ScopedMutex.h"
+
+namespace OVR
+{
+
+// Uncached names in the same folder are probed with one listing of the folder
+// instead of one stat each when there are at least this many.
+static const int MIN_NAMES_TO_LIST_FOLDER = 8;
+
+// A folder modified this recently may change again within the resolution of its time.
+static const int64_t RACY_SECONDS = 2;
+
+static double GetSeconds()
+{
+#if defined( OVR_OS_WIN32 )
+	return GetTickCount64() * 1e-3;
+#else
+	struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return now.tv_sec + now.tv_nsec * 1e-9;
+#endif
+}
+
+static bool PathExists( const char * path )
+{
+	struct stat st;
+	return stat( path, &st ) == 0;
+}
+
+// The folder a path is in, including the trailing separator, or "." for a bare name.
+static String FolderOfPath( const char * path )
+{
+	const char * end = strrchr( path, '/' );
+	if ( end == NULL )
+	{
+		return String( "." );
+	}
+	return String( path, end + 1 - path );
+}
+
+static const uint64_t FNV_OFFSET = 14695981039346656037ull;
+static const uint64_t FNV_PRIME = 1099511628211ull;
+
+static uint64_t HashBytes( uint64_t hash, const char * s )
+{
+	for ( ; *s != '\0'; s++ )
+	{
+		hash = ( hash ^ (uint8_t)*s ) * FNV_PRIME;
+	}
+	return hash;
+}
+
+uint64_t ovrPathCache::HashSearchPaths( const Array< String > & searchPaths )
+{
+	uint64_t hash = FNV_OFFSET;
+	for ( int i = 0; i < searchPaths.GetSizeI(); i++ )
+	{
+		hash = HashBytes( hash, searchPaths[i].ToCStr() );
+		hash = ( hash ^ 0xFF ) * FNV_PRIME;		// no path contains 0xFF, so the separation is unambiguous
+	}
+	return hash;
+}
+
+uint64_t ovrPathCache::HashName( const uint64_t listHash, const char * relativePath )
+{
+	return HashBytes( listHash, relativePath );
+}
+
+ovrPathCache::ovrPathCache() :
+	RevalidateSeconds( 1.0 ),
+	FlushCount( 0 ),
+	LastFolderSetList( -1 ),
+	LastFolderSet( -1 ),
+	NumHits( 0 ),
+	NumMisses( 0 ),
+	NumProbes( 0 )
+{
+}
+
+ovrPathCache & ovrPathCache::Get()
+{
+	// Never destroyed, GetFullPath may still be called while static objects are destroyed.
+	static ovrPathCache * cache = new ovrPathCache();
+	return *cache;
+}
+
+void ovrPathCache::Flush()
+{
+	ovrScopedMutex lock( CacheMutex );
+	SearchLists.Clear();
+	SearchListIndex.Clear();
+	Folders.Clear();
+	FolderIndex.Clear();
+	FolderSets.Clear();
+	FolderSetIndex.Clear();
+	Entries.Clear();
+	EntryIndex.Clear();
+	LastFolderSet = -1;
+	FlushCount++;
+}
+
+void ovrPathCache::SetRevalidateSeconds( const double seconds )
+{
+	ovrScopedMutex lock( CacheMutex );
+	RevalidateSeconds = seconds;
+}
+
+int ovrPathCache::FindSearchList( const Array< String > & searchPaths, const uint64_t listHash ) const
+{
+	const int * index = SearchListIndex.Get( listHash );
+	if ( index == NULL )
+	{
+		return -1;
+	}
+	const Array< String > & paths = SearchLists[*index].Paths;
+	if ( paths.GetSizeI() != searchPaths.GetSizeI() )
+	{
+		return -1;
+	}
+	for ( int i = 0; i < paths.GetSizeI(); i++ )
+	{
+		if ( paths[i] != searchPaths[i] )
+		{
+			return -1;
+		}
+	}
+	return *index;
+}
+
+int ovrPathCache::AddSearchList( const Array< String > & searchPaths, const uint64_t listHash )
+{
+	// A colliding list replaces the old one in the index, the entries of the
+	// old one then just stop being found.
+	ovrSearchList & list = SearchLists.PushDefault();
+	list.Paths = searchPaths;
+	list.Hash = listHash;
+	SearchListIndex.Set( listHash, SearchLists.GetSizeI() - 1 );
+	return SearchLists.GetSizeI() - 1;
+}
+
+int ovrPathCache::FindOrAddFolder( const String & path )
+{
+	const int * index = FolderIndex.Get( path );
+	if ( index != NULL )
+	{
+		return *index;
+	}
+	ovrFolder & folder = Folders.PushDefault();
+	folder.Path = path;
+	folder.Exists = false;
+	folder.Racy = true;
+	folder.ModifiedTime = -1;
+	folder.CheckTime = -1e30;	// checked on first use
+	folder.Generation = 0;
+	FolderIndex.Add( path, Folders.GetSizeI() - 1 );
+	return Folders.GetSizeI() - 1;
+}
+
+int ovrPathCache::FindOrAddFolderSet( const int searchList, const char * relativePath )
+{
+	// Names in the same sub folder have their candidates in the same folders,
+	// and names are mostly looked up a folder at a time.
+	const char * end = strrchr( relativePath, '/' );
+	const int subFolderLength = ( end != NULL ) ? (int)( end + 1 - relativePath ) : 0;
+	if ( LastFolderSet >= 0 && LastFolderSetList == searchList &&
+		( subFolderLength == 0 ? LastFolderSetSubFolder == "." :
+			( (int)LastFolderSetSubFolder.GetSize() == subFolderLength &&
+			  OVR_strncmp( LastFolderSetSubFolder.ToCStr(), relativePath, subFolderLength ) == 0 ) ) )
+	{
+		return LastFolderSet;
+	}
+
+	const String subFolder = FolderOfPath( relativePath );
+	LastFolderSetList = searchList;
+	LastFolderSetSubFolder = subFolder;
+	StringBuffer key;
+	key.AppendFormat( "%d:%s", searchList, subFolder.ToCStr() );
+	const int * index = FolderSetIndex.Get( key );
+	if ( index != NULL )
+	{
+		LastFolderSet = *index;
+		return *index;
+	}
+
+	const Array< String > & paths = SearchLists[searchList].Paths;
+	Array< int > folders;
+	folders.PushBack( FindOrAddFolder( subFolder ) );
+	for ( int i = 0; i < paths.GetSizeI(); i++ )
+	{
+		// A search path without a trailing separator joins the first part of the name.
+		const String candidate = paths[i] + relativePath;
+		folders.PushBack( FindOrAddFolder( FolderOfPath( candidate.ToCStr() ) ) );
+	}
+
+	ovrFolderSet & set = FolderSets.PushDefault();
+	set.Folders = folders;
+	FolderSetIndex.Add( key, FolderSets.GetSizeI() - 1 );
+	LastFolderSet = FolderSets.GetSizeI() - 1;
+	return LastFolderSet;
+}
+
+bool ovrPathCache::ValidateFolder( const int index, const double now )
+{
+	ovrFolder & folder = Folders[index];
+	if ( !folder.Racy && now - folder.CheckTime < RevalidateSeconds )
+	{
+		return true;
+	}
+	folder.CheckTime = now;
+
+	struct stat st;
+	const bool exists = stat( folder.Path.ToCStr(), &st ) == 0;
+	const int64_t modifiedTime = exists ? (int64_t)st.st_mtime : -1;
+	NumProbes++;
+	if ( exists != folder.Exists || modifiedTime != folder.ModifiedTime )
+	{
+		folder.Exists = exists;
+		folder.ModifiedTime = modifiedTime;
+		folder.Generation++;
+	}
+	folder.Racy = exists && modifiedTime >= (int64_t)time( NULL ) - RACY_SECONDS;
+	return !folder.Racy;
+}
+
+bool ovrPathCache::ValidateFolderSet( const int index, const double now, uint32_t & generation )
+{
+	const ovrFolderSet & set = FolderSets[index];
+	bool trusted = true;
+	generation = 0;
+	for ( int i = 0; i < set.Folders.GetSizeI(); i++ )
+	{
+		trusted &= ValidateFolder( set.Folders[i], now );
+		generation += Folders[set.Folders[i]].Generation;
+	}
+	return trusted;
+}
+
+const ovrPathCache::ovrEntry * ovrPathCache::FindEntry( const int searchList, const uint64_t key, const char * relativePath, const double now )
+{
+	const int * index = EntryIndex.Get( key );
+	if ( index == NULL )
+	{
+		return NULL;
+	}
+	const ovrEntry & entry = Entries[*index];
+	if ( entry.SearchList != searchList || OVR_strcmp( entry.RelativePath.ToCStr(), relativePath ) != 0 )
+	{
+		return NULL;
+	}
+	uint32_t generation;
+	if ( !ValidateFolderSet( entry.FolderSet, now, generation ) || generation != entry.Generation )
+	{
+		return NULL;
+	}
+	return &entry;
+}
+
+// Called with the lock held. On a miss, snapshots the folder generations
+// before the candidates are probed, so a change during the probe is noticed.
+void ovrPathCache::BeginLookup( const int searchList, const uint64_t key, const char * relativePath,
+								const double now, ovrPending & pending, bool & hit )
+{
+	const ovrEntry * entry = FindEntry( searchList, key, relativePath, now );
+	if ( entry != NULL )
+	{
+		pending.FoundIndex = entry->FoundIndex;
+		pending.FullPath = entry->FullPath;
+		hit = true;
+		NumHits++;
+		return;
+	}
+	hit = false;
+	NumMisses++;
+	pending.FolderSet = FindOrAddFolderSet( searchList, relativePath );
+	pending.Cacheable = ValidateFolderSet( pending.FolderSet, now, pending.Generation );
+}
+
+void ovrPathCache::AddEntry( const int searchList, const uint64_t key, const char * relativePath, const ovrPending & pending )
+{
+	if ( Entries.GetSizeI() >= MAX_ENTRIES )
+	{
+		// The folders and lists stay, only the entries go.
+		Entries.Clear();
+		EntryIndex.Clear();
+	}
+
+	const int * existing = EntryIndex.Get( key );
+	const int index = ( existing != NULL ) ? *existing : Entries.GetSizeI();
+	if ( existing == NULL )
+	{
+		Entries.PushDefault();
+		EntryIndex.Add( key, index );
+	}
+
+	ovrEntry & entry = Entries[index];
+	entry.RelativePath = relativePath;
+	entry.FullPath = pending.FullPath;
+	entry.SearchList = searchList;
+	entry.FolderSet = pending.FolderSet;
+	entry.FoundIndex = pending.FoundIndex;
+	entry.Generation = pending.Generation;
+}
+
+// The same order GetFullPath always used: the path itself, then each search path.
+int ovrPathCache::Probe( const Array< String > & searchPaths, const char * relativePath, String & outPath )
+{
+	int probes = 1;
+	int foundIndex = NOT_FOUND;
+	if ( PathExists( relativePath ) )
+	{
+		outPath = relativePath;
+		foundIndex = FOUND_RELATIVE;
+	}
+	else
+	{
+		char fullPath[1024];
+		for ( int i = 0; i < searchPaths.GetSizeI(); i++, probes++ )
+		{
+			OVR_sprintf( fullPath, sizeof( fullPath ), "%s%s", searchPaths[i].ToCStr(), relativePath );
+			if ( PathExists( fullPath ) )
+			{
+				outPath = fullPath;
+				foundIndex = i;
+				break;
+			}
+		}
+	}
+
+	ovrScopedMutex lock( CacheMutex );
+	NumProbes += probes;
+	return foundIndex;
+}
+
+int ovrPathCache::Resolve( const Array< String > & searchPaths, const char * relativePath, String & outPath )
+{
+	const uint64_t listHash = HashSearchPaths( searchPaths );
+	const uint64_t key = HashName( listHash, relativePath );
+	const double now = GetSeconds();
+
+	ovrPending pending;
+	int searchList;
+	uint32_t flushCount;
+	{
+		ovrScopedMutex lock( CacheMutex );
+		searchList = FindSearchList( searchPaths, listHash );
+		if ( searchList < 0 )
+		{
+			searchList = AddSearchList( searchPaths, listHash );
+		}
+		bool hit;
+		BeginLookup( searchList, key, relativePath, now, pending, hit );
+		if ( hit )
+		{
+			if ( pending.FoundIndex != NOT_FOUND )
+			{
+				outPath = pending.FullPath;
+			}
+			return pending.FoundIndex;
+		}
+		flushCount = FlushCount;
+	}
+
+	pending.FoundIndex = Probe( searchPaths, relativePath, pending.FullPath );
+
+	if ( pending.Cacheable )
+	{
+		ovrScopedMutex lock( CacheMutex );
+		if ( flushCount == FlushCount )
+		{
+			AddEntry( searchList, key, relativePath, pending );
+		}
+	}
+
+	if ( pending.FoundIndex != NOT_FOUND )
+	{
+		outPath = pending.FullPath;
+	}
+	return pending.FoundIndex;
+}
+
+// Names found in a folder listing are trusted when the listing has the exact
+// name and it is not a link, which may dangle. A name that only matches with a
+// different case, or that has characters the ASCII case folding does not cover,
+// is checked with a stat, because the folder may be on a case insensitive file
+// system. A name that is not in the listing at all does not exist either way.
+struct ovrFolderListing
+{
+	Hash< String, bool, String::HashFunctor >	Exact;		// name -> is a link
+	Hash< String, bool, String::HashFunctor >	Folded;		// lower case name
+
+	static String Fold( const char * name )
+	{
+		char folded[1024];
+		int length = 0;
+		for ( ; name[length] != '\0' && length < (int)sizeof( folded ) - 1; length++ )
+		{
+			const char c = name[length];
+			folded[length] = ( c >= 'A' && c <= 'Z' ) ? c + ( 'a' - 'A' ) : c;
+		}
+		folded[length] = '\0';
+		return String( folded );
+	}
+
+	static bool IsAscii( const char * name )
+	{
+		for ( ; *name != '\0'; name++ )
+		{
+			if ( (uint8_t)*name >= 0x80 )
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool Read( const char * path )
+	{
+#if defined( OVR_OS_WIN32 )
+		OVR_UNUSED( path );
+		return false;
+#else
+		DIR * dir = opendir( path );
+		if ( dir == NULL )
+		{
+			return false;
+		}
+		struct dirent * entry;
+		while ( ( entry = readdir( dir ) ) != NULL )
+		{
+			const bool isLink = entry->d_type == DT_LNK || entry->d_type == DT_UNKNOWN;
+			Exact.Set( String( entry->d_name ), isLink );
+			Folded.Set( Fold( entry->d_name ), true );
+		}
+		closedir( dir );
+		return true;
+#endif
+	}
+
+	// Returns true if the name certainly exists, sets needsStat if only a stat can tell.
+	bool Find( const char * name, bool & needsStat ) const
+	{
+		needsStat = false;
+		const bool * isLink = Exact.Get( String( name ) );
+		if ( isLink != NULL )
+		{
+			needsStat = *isLink;
+			return !*isLink;
+		}
+		needsStat = !IsAscii( name ) || Folded.Get( Fold( name ) ) != NULL;
+		return false;
+	}
+};
+
+void ovrPathCache::ProbeBatch( const Array< String > & searchPaths, const Array< String > & relativePaths,
+							   Array< ovrPending > & pending )
+{
+	int probes = 0;
+	Array< int > unresolved;
+	for ( int i = 0; i < pending.GetSizeI(); i++ )
+	{
+		pending[i].FoundIndex = NOT_FOUND;
+		unresolved.PushBack( i );
+	}
+
+	// One pass per candidate, in the order GetFullPath probes them. Each pass
+	// groups the names that are still unresolved by the folder their candidate is in.
+	for ( int level = FOUND_RELATIVE; level < searchPaths.GetSizeI() && unresolved.GetSizeI() > 0; level++ )
+	{
+		const String prefix = ( level >= 0 ) ? searchPaths[level] : String();
+		Hash< String, Array< int >, String::HashFunctor > groups;
+		for ( int i = 0; i < unresolved.GetSizeI(); i++ )
+		{
+			const String candidate = prefix + relativePaths[pending[unresolved[i]].Index];
+			const String folder = FolderOfPath( candidate.ToCStr() );
+			Array< int > * group = groups.Get( folder );
+			if ( group == NULL )
+			{
+				groups.Add( folder, Array< int >() );
+				group = groups.Get( folder );
+			}
+			group->PushBack( unresolved[i] );
+		}
+
+		for ( Hash< String, Array< int >, String::HashFunctor >::ConstIterator iter = groups.Begin(); iter != groups.End(); ++iter )
+		{
+			const String & folder = iter->First;
+			const Array< int > & group = iter->Second;
+
+			ovrFolderListing listing;
+			const bool listed = group.GetSizeI() >= MIN_NAMES_TO_LIST_FOLDER && listing.Read( folder.ToCStr() );
+			probes += listed;
+
+			for ( int i = 0; i < group.GetSizeI(); i++ )
+			{
+				ovrPending & p = pending[group[i]];
+				const String candidate = prefix + relativePaths[p.Index];
+				bool found;
+				if ( listed )
+				{
+					const char * name = candidate.ToCStr() + ( folder == "." ? 0 : folder.GetSize() );
+					bool needsStat;
+					found = listing.Find( name, needsStat );
+					if ( needsStat )
+					{
+						found = PathExists( candidate.ToCStr() );
+						probes++;
+					}
+				}
+				else
+				{
+					found = PathExists( candidate.ToCStr() );
+					probes++;
+				}
+				if ( found )
+				{
+					p.FoundIndex = level;
+					p.FullPath = candidate;
+				}
+			}
+		}
+
+		int numUnresolved = 0;
+		for ( int i = 0; i < unresolved.GetSizeI(); i++ )
+		{
+			if ( pending[unresolved[i]].FoundIndex == NOT_FOUND )
+			{
+				unresolved[numUnresolved++] = unresolved[i];
+			}
+		}
+		unresolved.Resize( numUnresolved );
+	}
+
+	ovrScopedMutex lock( CacheMutex );
+	NumProbes += probes;
+}
+
+int ovrPathCache::ResolveBatch( const Array< String > & searchPaths, const Array< String > & relativePaths, Array< String > & outPaths )
+{
+	const uint64_t listHash = HashSearchPaths( searchPaths );
+	const double now = GetSeconds();
+
+	outPaths.Clear();
+	outPaths.Resize( relativePaths.GetSizeI() );
+
+	Array< ovrPending > misses;
+	int searchList;
+	uint32_t flushCount;
+	int numFound = 0;
+	{
+		ovrScopedMutex lock( CacheMutex );
+		searchList = FindSearchList( searchPaths, listHash );
+		if ( searchList < 0 )
+		{
+			searchList = AddSearchList( searchPaths, listHash );
+		}
+		for ( int i = 0; i < relativePaths.GetSizeI(); i++ )
+		{
+			const uint64_t key = HashName( listHash, relativePaths[i].ToCStr() );
+			ovrPending pending;
+			bool hit;
+			BeginLookup( searchList, key, relativePaths[i].ToCStr(), now, pending, hit );
+			if ( hit )
+			{
+				if ( pending.FoundIndex != NOT_FOUND )
+				{
+					outPaths[i] = pending.FullPath;
+					numFound++;
+				}
+				continue;
+			}
+			pending.Index = i;
+			misses.PushBack( pending );
+		}
+		flushCount = FlushCount;
+	}
+
+	if ( misses.GetSizeI() == 0 )
+	{
+		return numFound;
+	}
+
+	ProbeBatch( searchPaths, relativePaths, misses );
+
+	ovrScopedMutex lock( CacheMutex );
+	for ( int i = 0; i < misses.GetSizeI(); i++ )
+	{
+		const ovrPending & pending = misses[i];
+		const String & relativePath = relativePaths[pending.Index];
+		if ( pending.Cacheable && flushCount == FlushCount )
+		{
+			AddEntry( searchList, HashName( listHash, relativePath.ToCStr() ), relativePath.ToCStr(), pending );
+		}
+		if ( pending.FoundIndex != NOT_FOUND )
+		{
+			outPaths[pending.Index] = pending.FullPath;
+			numFound++;
+		}
+	}
+	return numFound;
+}
+
+} // namespace OVR
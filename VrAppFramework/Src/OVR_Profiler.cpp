@@ -0,0 +1,521 @@
+/************************************************************************************
+
+Filename    :   OVR_Profiler.cpp
+Content     :   Hierarchical per-thread CPU zone profiler with latency histograms.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include "OVR_Profiler.h"
+
+#include <string.h>
+#include "Kernel/OVR_Array.h"
+#include "Kernel/OVR_Threads.h"
+#include "Kernel/OVR_LogUtils.h"
+
+#include "ScopedMutex.h"
+
+namespace OVR
+{
+
+//==============================================================
+// ovrLatencyHistogram
+
+void ovrLatencyHistogram::Clear()
+{
+	Count = 0;
+	Min = 0xFFFFFFFF;
+	Max = 0;
+	Total = 0;
+	memset( Buckets, 0, sizeof( Buckets ) );
+}
+
+int ovrLatencyHistogram::BucketForValue( const uint32_t nanoseconds )
+{
+	if ( nanoseconds < SUB_BUCKETS )
+	{
+		return nanoseconds;
+	}
+	const int msb = 31 - __builtin_clz( nanoseconds );
+	const int shift = msb - SUB_BUCKET_BITS;
+	return ( shift + 1 ) * SUB_BUCKETS + ( ( nanoseconds >> shift ) & ( SUB_BUCKETS - 1 ) );
+}
+
+uint32_t ovrLatencyHistogram::BucketLowerBound( const int bucket )
+{
+	if ( bucket < SUB_BUCKETS )
+	{
+		return bucket;
+	}
+	const int shift = bucket / SUB_BUCKETS - 1;
+	return (uint32_t)( SUB_BUCKETS + bucket % SUB_BUCKETS ) << shift;
+}
+
+void ovrLatencyHistogram::Add( const uint32_t nanoseconds )
+{
+	Count++;
+	Total += nanoseconds;
+	Min = Alg::Min( Min, nanoseconds );
+	Max = Alg::Max( Max, nanoseconds );
+	Buckets[BucketForValue( nanoseconds )]++;
+}
+
+uint32_t ovrLatencyHistogram::GetPercentile( const double fraction ) const
+{
+	if ( Count == 0 )
+	{
+		return 0;
+	}
+	// the rank of the sample, counting from 1
+	const uint32_t rank = Alg::Max( 1u, (uint32_t)( fraction * Count + 0.5 ) );
+	uint32_t sum = 0;
+	for ( int i = 0; i < NUM_BUCKETS; i++ )
+	{
+		sum += Buckets[i];
+		if ( sum >= rank )
+		{
+			// report the middle of the bucket, clamped to the exact extremes
+			const uint32_t lower = BucketLowerBound( i );
+			const uint32_t upper = ( i + 1 < NUM_BUCKETS ) ? BucketLowerBound( i + 1 ) - 1 : 0xFFFFFFFF;
+			const uint32_t middle = lower + ( upper - lower ) / 2;
+			return Alg::Clamp( middle, GetMin(), Max );
+		}
+	}
+	return Max;
+}
+
+//==============================================================
+// ovrProfileThread
+
+thread_local ovrProfileThread * ovrProfileThread::Current = nullptr;
+
+ovrProfileThread::ovrProfileThread() :
+	CurrentNode( ROOT_NODE ),
+	NumNodesLocal( 0 ),
+	NumNodes( 0 ),
+	WriteIndex( 0 ),
+	PublishedWriteIndex( 0 )
+{
+	AddNode( -1, "root" );
+	AddNode( ROOT_NODE, "(out of zone nodes)" );
+}
+
+int ovrProfileThread::AddNode( const int parent, const char * name )
+{
+	const int index = NumNodesLocal;
+	ovrProfileNode & node = Nodes[index];
+	node.Name = name;
+	node.Parent = parent;
+	node.LastChild = -1;
+	node.FirstChild = -1;
+	node.NextSibling = -1;
+	if ( parent >= 0 )
+	{
+		node.NextSibling = Nodes[parent].FirstChild;
+		Nodes[parent].FirstChild = index;
+	}
+	NumNodesLocal++;
+	NumNodes.Store_Release( NumNodesLocal );
+	return index;
+}
+
+int ovrProfileThread::FindChild( const int parent, const char * name )
+{
+	for ( int child = Nodes[parent].FirstChild; child >= 0; child = Nodes[child].NextSibling )
+	{
+		if ( Nodes[child].Name == name )
+		{
+			return child;
+		}
+	}
+	if ( NumNodesLocal >= MAX_NODES )
+	{
+		return OVERFLOW_NODE;
+	}
+	return AddNode( parent, name );
+}
+
+//==============================================================
+// ovrProfiler
+
+// The aggregated state of one thread, only touched with the profiler mutex held.
+struct ovrProfileThreadStats
+{
+	ovrProfileThreadStats() :
+		Thread( nullptr ),
+		ReadIndex( 0 ) {}
+
+	ovrProfileThread *				Thread;
+	uint32_t						ReadIndex;
+	Array< ovrLatencyHistogram * >	Histograms;		// per node, allocated when the node first shows up
+};
+
+// Allocated on first use and never freed, like the thread buffers, so threads
+// can still record zones while static objects are destroyed.
+struct ovrProfilerGlobals
+{
+	ovrProfilerGlobals() :
+		NumDroppedEvents( 0 ),
+		NanosecondsPerTick( CalibrateTicks() ) {}
+
+	Mutex							ProfilerMutex;
+	Array< ovrProfileThreadStats >	ProfileThreads;
+	uint32_t						NumDroppedEvents;
+	double							NanosecondsPerTick;
+
+	static double					CalibrateTicks();
+};
+
+double ovrProfilerGlobals::CalibrateTicks()
+{
+#if defined( __x86_64__ ) || defined( __i386__ )
+	// The time stamp counter rate is not exposed, so measure it against the
+	// clock. This only happens once per process, when the first thread registers.
+	const uint64_t startNanoseconds = ovrProfileThread::GetNanoseconds();
+	const uint64_t startTicks = ovrProfileThread::GetTicks();
+	uint64_t nanoseconds;
+	do
+	{
+		nanoseconds = ovrProfileThread::GetNanoseconds();
+	} while ( nanoseconds - startNanoseconds < 5000000 );
+	const uint64_t ticks = ovrProfileThread::GetTicks() - startTicks;
+	return ( ticks > 0 ) ? (double)( nanoseconds - startNanoseconds ) / ticks : 1.0;
+#elif defined( __aarch64__ )
+	uint64_t frequency;
+	asm volatile( "mrs %0, cntfrq_el0" : "=r" ( frequency ) );
+	return ( frequency > 0 ) ? 1e9 / frequency : 1.0;
+#else
+	return 1.0;
+#endif
+}
+
+static ovrProfilerGlobals & Globals()
+{
+	static ovrProfilerGlobals * globals = new ovrProfilerGlobals();
+	return *globals;
+}
+
+static thread_local const char *		PendingThreadName = nullptr;	// set before the thread registered
+
+ovrProfileThread * ovrProfileThread::Register()
+{
+	ovrProfileThread * thread = new ovrProfileThread();
+
+	ovrProfilerGlobals & globals = Globals();
+	ovrScopedMutex mutex( globals.ProfilerMutex );
+	thread->Name = ( PendingThreadName != nullptr ) ? String( PendingThreadName ) : String::Format( "Thread %d", globals.ProfileThreads.GetSizeI() );
+	ovrProfileThreadStats stats;
+	stats.Thread = thread;
+	globals.ProfileThreads.PushBack( stats );
+
+	Current = thread;
+	return thread;
+}
+
+void ovrProfiler::SetThreadName( const char * name )
+{
+	// don't allocate the buffers of a thread that may never record a zone
+	ovrProfileThread * thread = ovrProfileThread::Current;
+	if ( thread == nullptr )
+	{
+		PendingThreadName = name;
+		return;
+	}
+
+	ovrProfilerGlobals & globals = Globals();
+	ovrScopedMutex mutex( globals.ProfilerMutex );
+	thread->Name = name;
+}
+
+// Must be called with the profiler mutex held.
+static void DrainThread( ovrProfilerGlobals & globals, ovrProfileThreadStats & stats )
+{
+	ovrProfileThread & thread = *stats.Thread;
+
+	const uint32_t write = thread.PublishedWriteIndex.Load_Acquire();
+	uint32_t read = stats.ReadIndex;
+	if ( write - read > (uint32_t)ovrProfileThread::MAX_EVENTS )
+	{
+		globals.NumDroppedEvents += write - read - ovrProfileThread::MAX_EVENTS;
+		read = write - ovrProfileThread::MAX_EVENTS;
+	}
+	if ( read == write )
+	{
+		return;
+	}
+
+	static ovrProfileThread::ovrProfileEvent events[ovrProfileThread::MAX_EVENTS];
+	const uint32_t count = write - read;
+	for ( uint32_t i = 0; i < count; i++ )
+	{
+		events[i] = thread.Events[( read + i ) & ( ovrProfileThread::MAX_EVENTS - 1 )];
+	}
+
+	// The writer may have wrapped around and overwritten the oldest events while
+	// they were copied. The atomic add of zero orders the copy before this read.
+	const uint32_t after = thread.PublishedWriteIndex.ExchangeAdd_Sync( 0 );
+	uint32_t first = 0;
+	if ( after - read > (uint32_t)ovrProfileThread::MAX_EVENTS )
+	{
+		first = Alg::Min( count, after - read - ovrProfileThread::MAX_EVENTS );
+		globals.NumDroppedEvents += first;
+	}
+	stats.ReadIndex = write;
+
+	const int numNodes = thread.NumNodes.Load_Acquire();
+	const int oldNumNodes = stats.Histograms.GetSizeI();
+	if ( numNodes > oldNumNodes )
+	{
+		stats.Histograms.Resize( numNodes );
+		for ( int i = oldNumNodes; i < numNodes; i++ )
+		{
+			stats.Histograms[i] = nullptr;
+		}
+	}
+
+	for ( uint32_t i = first; i < count; i++ )
+	{
+		const ovrProfileThread::ovrProfileEvent & event = events[i];
+		if ( event.Node >= (uint32_t)numNodes )
+		{
+			continue;	// torn event
+		}
+		ovrLatencyHistogram * & histogram = stats.Histograms[event.Node];
+		if ( histogram == nullptr )
+		{
+			histogram = new ovrLatencyHistogram();
+		}
+		const double nanoseconds = event.Ticks * globals.NanosecondsPerTick;
+		histogram->Add( ( nanoseconds < 4294967295.0 ) ? (uint32_t)nanoseconds : 0xFFFFFFFF );
+	}
+}
+
+void ovrProfiler::Update()
+{
+	ovrProfilerGlobals & globals = Globals();
+	ovrScopedMutex mutex( globals.ProfilerMutex );
+	for ( int i = 0; i < globals.ProfileThreads.GetSizeI(); i++ )
+	{
+		DrainThread( globals, globals.ProfileThreads[i] );
+	}
+}
+
+void ovrProfiler::Reset()
+{
+	ovrProfilerGlobals & globals = Globals();
+	ovrScopedMutex mutex( globals.ProfilerMutex );
+	for ( int i = 0; i < globals.ProfileThreads.GetSizeI(); i++ )
+	{
+		ovrProfileThreadStats & stats = globals.ProfileThreads[i];
+		// skip what was recorded before the reset
+		stats.ReadIndex = stats.Thread->PublishedWriteIndex.Load_Acquire();
+		for ( int j = 0; j < stats.Histograms.GetSizeI(); j++ )
+		{
+			if ( stats.Histograms[j] != nullptr )
+			{
+				stats.Histograms[j]->Clear();
+			}
+		}
+	}
+	globals.NumDroppedEvents = 0;
+}
+
+uint32_t ovrProfiler::GetNumDroppedEvents()
+{
+	ovrProfilerGlobals & globals = Globals();
+	ovrScopedMutex mutex( globals.ProfilerMutex );
+	return globals.NumDroppedEvents;
+}
+
+static double Microseconds( const uint64_t nanoseconds )
+{
+	return nanoseconds * 1e-3;
+}
+
+// Children in the order they were first entered. The child lists of the
+// thread are owned by the thread, so they are rebuilt from the parents.
+static void BuildChildLists( const ovrProfileThreadStats & stats, Array< Array< int > > & children )
+{
+	const int numNodes = stats.Histograms.GetSizeI();
+	children.Clear();
+	children.Resize( numNodes );
+	for ( int i = 1; i < numNodes; i++ )
+	{
+		children[stats.Thread->Nodes[i].Parent].PushBack( i );
+	}
+}
+
+// True if the zone or one of its children completed at least once. A zone that is
+// still open, like a thread main loop, is reported with a count of zero.
+static bool HasSamples( const ovrProfileThreadStats & stats, const Array< Array< int > > & children, const int node )
+{
+	if ( stats.Histograms[node] != nullptr && stats.Histograms[node]->GetCount() > 0 )
+	{
+		return true;
+	}
+	for ( int i = 0; i < children[node].GetSizeI(); i++ )
+	{
+		if ( HasSamples( stats, children, children[node][i] ) )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+static const ovrLatencyHistogram & NodeHistogram( const ovrProfileThreadStats & stats, const int node )
+{
+	static const ovrLatencyHistogram empty;
+	return ( stats.Histograms[node] != nullptr ) ? *stats.Histograms[node] : empty;
+}
+
+static void DumpTextNode( StringBuffer & out, const ovrProfileThreadStats & stats,
+		const Array< Array< int > > & children, const int node, const int depth )
+{
+	const int indent = depth * 2;
+	const ovrLatencyHistogram & histogram = NodeHistogram( stats, node );
+	out.AppendFormat( "%*s%-*s %8u %10.3f %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+			indent, "", 40 - indent, stats.Thread->Nodes[node].Name,
+			histogram.GetCount(),
+			Microseconds( histogram.GetTotal() ) * 1e-3,
+			Microseconds( histogram.GetTotal() ) / Alg::Max( 1u, histogram.GetCount() ),
+			Microseconds( histogram.GetPercentile( 0.5 ) ),
+			Microseconds( histogram.GetPercentile( 0.9 ) ),
+			Microseconds( histogram.GetPercentile( 0.99 ) ),
+			Microseconds( histogram.GetMax() ) );
+	for ( int i = 0; i < children[node].GetSizeI(); i++ )
+	{
+		if ( HasSamples( stats, children, children[node][i] ) )
+		{
+			DumpTextNode( out, stats, children, children[node][i], depth + 1 );
+		}
+	}
+}
+
+void ovrProfiler::DumpText( StringBuffer & out )
+{
+	Update();
+
+	ovrProfilerGlobals & globals = Globals();
+	ovrScopedMutex mutex( globals.ProfilerMutex );
+	Array< Array< int > > children;
+	for ( int i = 0; i < globals.ProfileThreads.GetSizeI(); i++ )
+	{
+		const ovrProfileThreadStats & stats = globals.ProfileThreads[i];
+		if ( stats.Histograms.GetSizeI() == 0 )
+		{
+			continue;
+		}
+		BuildChildLists( stats, children );
+		out.AppendFormat( "%s\n", stats.Thread->Name.ToCStr() );
+		out.AppendFormat( "%-40s %8s %10s %9s %9s %9s %9s %9s\n",
+				"zone", "count", "total ms", "mean us", "p50 us", "p90 us", "p99 us", "max us" );
+		const Array< int > & zones = children[ovrProfileThread::ROOT_NODE];
+		for ( int j = 0; j < zones.GetSizeI(); j++ )
+		{
+			if ( HasSamples( stats, children, zones[j] ) )
+			{
+				DumpTextNode( out, stats, children, zones[j], 0 );
+			}
+		}
+	}
+	if ( globals.NumDroppedEvents > 0 )
+	{
+		out.AppendFormat( "%u events dropped\n", globals.NumDroppedEvents );
+	}
+}
+
+static void AppendJsonString( StringBuffer & out, const char * str )
+{
+	out.AppendChar( '"' );
+	for ( const char * c = str; *c != '\0'; c++ )
+	{
+		if ( *c == '"' || *c == '\\' )
+		{
+			out.AppendChar( '\\' );
+		}
+		if ( (unsigned char)*c >= ' ' )
+		{
+			out.AppendChar( *c );
+		}
+	}
+	out.AppendChar( '"' );
+}
+
+static void DumpJsonZones( StringBuffer & out, const ovrProfileThreadStats & stats,
+		const Array< Array< int > > & children, const int parent );
+
+static void DumpJsonNode( StringBuffer & out, const ovrProfileThreadStats & stats,
+		const Array< Array< int > > & children, const int node )
+{
+	const ovrLatencyHistogram & histogram = NodeHistogram( stats, node );
+	out.AppendString( "{\"name\":" );
+	AppendJsonString( out, stats.Thread->Nodes[node].Name );
+	out.AppendFormat( ",\"count\":%u,\"total_us\":%.1f,\"min_us\":%.3f,\"p50_us\":%.3f,\"p90_us\":%.3f,\"p99_us\":%.3f,\"max_us\":%.3f,\"children\":",
+			histogram.GetCount(),
+			Microseconds( histogram.GetTotal() ),
+			Microseconds( histogram.GetMin() ),
+			Microseconds( histogram.GetPercentile( 0.5 ) ),
+			Microseconds( histogram.GetPercentile( 0.9 ) ),
+			Microseconds( histogram.GetPercentile( 0.99 ) ),
+			Microseconds( histogram.GetMax() ) );
+	DumpJsonZones( out, stats, children, node );
+	out.AppendChar( '}' );
+}
+
+static void DumpJsonZones( StringBuffer & out, const ovrProfileThreadStats & stats,
+		const Array< Array< int > > & children, const int parent )
+{
+	out.AppendChar( '[' );
+	bool first = true;
+	for ( int i = 0; i < children[parent].GetSizeI(); i++ )
+	{
+		if ( HasSamples( stats, children, children[parent][i] ) )
+		{
+			if ( !first )
+			{
+				out.AppendChar( ',' );
+			}
+			first = false;
+			DumpJsonNode( out, stats, children, children[parent][i] );
+		}
+	}
+	out.AppendChar( ']' );
+}
+
+void ovrProfiler::DumpJson( StringBuffer & out )
+{
+	Update();
+
+	ovrProfilerGlobals & globals = Globals();
+	ovrScopedMutex mutex( globals.ProfilerMutex );
+	Array< Array< int > > children;
+	out.AppendString( "{\"threads\":[" );
+	for ( int i = 0; i < globals.ProfileThreads.GetSizeI(); i++ )
+	{
+		const ovrProfileThreadStats & stats = globals.ProfileThreads[i];
+		BuildChildLists( stats, children );
+		if ( i > 0 )
+		{
+			out.AppendChar( ',' );
+		}
+		out.AppendString( "{\"name\":" );
+		AppendJsonString( out, stats.Thread->Name.ToCStr() );
+		out.AppendString( ",\"zones\":" );
+		if ( children.GetSizeI() > 0 )
+		{
+			DumpJsonZones( out, stats, children, ovrProfileThread::ROOT_NODE );
+		}
+		else
+		{
+			out.AppendString( "[]" );
+		}
+		out.AppendChar( '}' );
+	}
+	out.AppendFormat( "],\"dropped_events\":%u}\n", globals.NumDroppedEvents );
+}
+
+} // namespace OVR
@@ -0,0 +1,589 @@
+/************************************************************************************
+
+Filename    :   OVR_TextureLoader.cpp
+Content     :   Decodes textures on worker threads and uploads them on the GL thread.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include "OVR_TextureLoader.h"
+
+#include "Kernel/OVR_Types.h"
+#include "Kernel/OVR_String.h"
+#include "Kernel/OVR_Array.h"
+#include "Kernel/OVR_LogUtils.h"
+#include "Kernel/OVR_SysFile.h"
+
+#include "VrApi.h"
+
+#include "OVR_FileSys.h"
+#include "OVR_WorkerPool.h"
+#include "PackageFiles.h"
+#include "ScopedMutex.h"
+
+//#define OVR_USE_PERF_TIMER
+#include "OVR_PerfTimer.h"
+
+namespace OVR {
+
+//==============================================================
+// ovrTextureLoadJob
+// Everything the worker needs for one texture. Owned by the loader; only the
+// worker that takes it from PendingJobs touches it until it is handed back
+// through DecodedJobs.
+struct ovrTextureLoadJob
+{
+	ovrTextureLoadJob()
+		: RequestIndex( -1 )
+		, FileSys( nullptr )
+		, ReadFile( false )
+		, ZipEntry( false )
+		, CompressionMethod( 0 )
+		, UncompressedSize( 0 )
+		, Crc( 0 )
+		, Succeeded( false )
+		, Cancelled( false )
+	{
+	}
+
+	int						RequestIndex;
+	String					FileName;
+	ovrFileSys *			FileSys;	// if not null, FileName is a uri read from here on the worker
+	bool					ReadFile;	// FileName is a path read on the worker
+	bool					ZipEntry;	// Buffer is a raw zip entry inflated on the worker
+	int						CompressionMethod;
+	int						UncompressedSize;
+	uint32_t				Crc;
+	MemBufferT< uint8_t >	Buffer;		// file contents, may be referenced by Image
+	TextureFlags_t			Flags;
+	ovrTextureImage			Image;
+	bool					Succeeded;	// set before the job is queued if Image is already decoded
+	bool					Cancelled;	// set by FreeRequest under JobMutex
+};
+
+//==============================
+// ovrTextureRequest
+struct ovrTextureRequest
+{
+	ovrTextureRequest()
+		: State( ASYNC_TEXTURE_INVALID )
+		, Job( nullptr )
+		, Generation( 0 )
+	{
+	}
+
+	ovrAsyncTextureState	State;
+	GlTexture				Texture;
+	ovrTextureLoadJob *		Job;		// while pending
+	int						Generation;	// bumped when the request is freed, so old handles go stale
+};
+
+//==============================================================
+// ovrTextureLoaderImpl
+class ovrTextureLoaderImpl : public ovrTextureLoader
+{
+public:
+	friend class ovrTextureLoader;
+
+	static const int	MAX_THREADS = 4;
+
+	// A handle is the request index with the slot's generation above it.
+	static const int	HANDLE_INDEX_BITS = 20;
+	static const int	HANDLE_INDEX_MASK = ( 1 << HANDLE_INDEX_BITS ) - 1;
+	static const int	HANDLE_GENERATION_MASK = ( 1 << ( 31 - HANDLE_INDEX_BITS ) ) - 1;
+
+	virtual asyncTextureHandle_t	LoadTextureFromUri( ovrFileSys & fileSys, char const * uri,
+											TextureFlags_t const & flags ) OVR_OVERRIDE;
+	virtual asyncTextureHandle_t	LoadTextureFromFile( char const * path, TextureFlags_t const & flags ) OVR_OVERRIDE;
+	virtual asyncTextureHandle_t	LoadTextureFromBuffer( char const * fileName, MemBufferT< uint8_t > & buffer,
+											TextureFlags_t const & flags ) OVR_OVERRIDE;
+	virtual asyncTextureHandle_t	LoadTextureFromZipEntry( char const * fileName, MemBufferT< uint8_t > & buffer,
+											int const compressionMethod, int const uncompressedSize,
+											uint32_t const crc, TextureFlags_t const & flags ) OVR_OVERRIDE;
+	virtual asyncTextureHandle_t	LoadTextureFromImage( char const * fileName, ovrTextureImage & image ) OVR_OVERRIDE;
+
+	virtual int						Update( double const uploadBudgetSeconds ) OVR_OVERRIDE;
+
+	virtual ovrAsyncTextureState	GetState( asyncTextureHandle_t const handle ) const OVR_OVERRIDE;
+	virtual GlTexture				GetTexture( asyncTextureHandle_t const handle ) const OVR_OVERRIDE;
+
+	virtual void					FreeRequest( asyncTextureHandle_t const handle ) OVR_OVERRIDE;
+
+	virtual int						GetNumPending() const OVR_OVERRIDE { return NumPending; }
+
+private:
+	// only accessed on the GL thread
+	Array< ovrTextureRequest >		Requests;
+	Array< int >					FreeRequests;
+	Array< ovrTextureLoadJob * >	UploadQueue;	// decoded, waiting for Update
+	int								NumPending;
+	GlTexture						Placeholder;
+
+	// Every worker runs one DecodeTask from Init() to Shutdown(), which takes
+	// jobs from PendingJobs as they come and sleeps while there are none.
+	ovrWorkerPool					Workers;
+
+	// shared with the workers
+	Array< ovrTextureLoadJob * >	PendingJobs;	// waiting for a worker, in request order
+	Array< ovrTextureLoadJob * >	DecodedJobs;	// finished by a worker
+	bool							Exiting;
+	Mutex							JobMutex;
+	WaitCondition					JobCondition;	// signaled when a job is queued or on shutdown
+
+private:
+	ovrTextureLoaderImpl();
+	virtual ~ovrTextureLoaderImpl();
+
+	void					Init( int const numThreads );
+	void					Shutdown();
+
+	asyncTextureHandle_t	EnqueueJob( ovrTextureLoadJob * job );
+	void					DecodeJob( ovrTextureLoadJob * job );
+	int						IndexForHandle( asyncTextureHandle_t const handle ) const;
+	asyncTextureHandle_t	HandleForIndex( int const idx ) const;
+
+	static void				DecodeTask( void * data, int const task );
+};
+
+//==============================
+// ovrTextureLoaderImpl::ovrTextureLoaderImpl
+ovrTextureLoaderImpl::ovrTextureLoaderImpl()
+	: NumPending( 0 )
+	, Exiting( false )
+{
+}
+
+//==============================
+// ovrTextureLoaderImpl::~ovrTextureLoaderImpl
+ovrTextureLoaderImpl::~ovrTextureLoaderImpl()
+{
+	OVR_ASSERT( !Workers.IsInitialized() );	// call Shutdown() explicitly
+}
+
+//==============================
+// ovrTextureLoaderImpl::Init
+void ovrTextureLoaderImpl::Init( int const numThreads )
+{
+	// same 8x8 pattern LoadTextureFromBuffer uses when a load fails
+	static uint8_t placeholderTexture[8 * 8 * 3] =
+	{
+		255,255,255, 255,255,255, 255,255,255, 255,255,255, 255,255,255, 255,255,255, 255,255,255, 255,255,255,
+		255,255,255,  64, 64, 64,  64, 64, 64,  64, 64, 64,  64, 64, 64,  64, 64, 64,  64, 64, 64, 255,255,255,
+		255,255,255,  64, 64, 64,  64, 64, 64,  64, 64, 64,  64, 64, 64,  64, 64, 64,  64, 64, 64, 255,255,255,
+		255,255,255,  64, 64, 64,  64, 64, 64, 255,255,255, 255,255,255,  64, 64, 64,  64, 64, 64, 255,255,255,
+		255,255,255,  64, 64, 64,  64, 64, 64, 255,255,255, 255,255,255,  64, 64, 64,  64, 64, 64, 255,255,255,
+		255,255,255,  64, 64, 64,  64, 64, 64,  64, 64, 64,  64, 64, 64,  64, 64, 64,  64, 64, 64, 255,255,255,
+		255,255,255,  64, 64, 64,  64, 64, 64,  64, 64, 64,  64, 64, 64,  64, 64, 64,  64, 64, 64, 255,255,255,
+		255,255,255, 255,255,255, 255,255,255, 255,255,255, 255,255,255, 255,255,255, 255,255,255, 255,255,255
+	};
+	Placeholder = LoadRGBTextureFromMemory( placeholderTexture, 8, 8, false );
+
+	// the loader never waits for a decode, so at least one worker must run them
+	Workers.Init( Alg::Clamp( numThreads, 1, MAX_THREADS ), Thread::BelowNormalPriority );
+	Workers.Start( Workers.GetNumThreads() - 1, DecodeTask, this );
+}
+
+//==============================
+// ovrTextureLoaderImpl::Shutdown
+void ovrTextureLoaderImpl::Shutdown()
+{
+	// the workers finish the decodes they are on and return
+	{
+		ovrScopedMutex mutex( JobMutex );
+		Exiting = true;
+		JobCondition.NotifyAll();
+	}
+	Workers.Wait();
+	Workers.Shutdown();
+
+	for ( int i = 0; i < PendingJobs.GetSizeI(); ++i )
+	{
+		delete PendingJobs[i];
+	}
+	PendingJobs.Resize( 0 );
+
+	for ( int i = 0; i < DecodedJobs.GetSizeI(); ++i )
+	{
+		delete DecodedJobs[i];
+	}
+	DecodedJobs.Resize( 0 );
+	for ( int i = 0; i < UploadQueue.GetSizeI(); ++i )
+	{
+		delete UploadQueue[i];
+	}
+	UploadQueue.Resize( 0 );
+
+	// textures of READY requests belong to the caller
+	Requests.Resize( 0 );
+	FreeRequests.Resize( 0 );
+	NumPending = 0;
+
+	DeleteTexture( Placeholder );
+}
+
+//==============================
+// ovrTextureLoaderImpl::DecodeTask
+// Runs on a worker thread until Shutdown().
+void ovrTextureLoaderImpl::DecodeTask( void * data, int const task )
+{
+	OVR_UNUSED( task );
+	ovrTextureLoaderImpl * loader = static_cast< ovrTextureLoaderImpl * >( data );
+
+	ovrTextureLoadJob * job = nullptr;
+	for ( ; ; )
+	{
+		{
+			ovrScopedMutex mutex( loader->JobMutex );
+			if ( job != nullptr )
+			{
+				loader->DecodedJobs.PushBack( job );
+				job = nullptr;
+			}
+			while ( !loader->Exiting )
+			{
+				if ( loader->PendingJobs.GetSizeI() == 0 )
+				{
+					loader->JobCondition.Wait( &loader->JobMutex );
+					continue;
+				}
+				job = loader->PendingJobs[0];
+				loader->PendingJobs.RemoveAt( 0 );
+				if ( !job->Cancelled )
+				{
+					break;
+				}
+				// freed before a worker got to it
+				loader->DecodedJobs.PushBack( job );
+				job = nullptr;
+			}
+			if ( job == nullptr )
+			{
+				return;
+			}
+		}
+		loader->DecodeJob( job );
+	}
+}
+
+//==============================
+// ovrTextureLoaderImpl::DecodeJob
+// Runs on a worker thread.
+void ovrTextureLoaderImpl::DecodeJob( ovrTextureLoadJob * job )
+{
+	OVR_PERF_TIMER( TextureLoader_DecodeJob );
+
+	if ( job->FileSys != nullptr && !job->FileSys->ReadFile( job->FileName.ToCStr(), job->Buffer ) )
+	{
+		LOG( "Failed to read '%s'", job->FileName.ToCStr() );
+		return;
+	}
+	if ( job->ReadFile )
+	{
+		SysFile file;
+		if ( !file.Open( job->FileName, File::Open_Read ) )
+		{
+			LOG( "Failed to open '%s'", job->FileName.ToCStr() );
+			return;
+		}
+		const int length = file.GetLength();
+		void * buffer = malloc( length );
+		const bool read = ( file.Read( static_cast< uint8_t * >( buffer ), length ) == length );
+		file.Close();
+		if ( !read )
+		{
+			free( buffer );
+			LOG( "Failed to read '%s'", job->FileName.ToCStr() );
+			return;
+		}
+		job->Buffer.TakeOwnershipOfBuffer( buffer, length );
+	}
+	if ( job->ZipEntry )
+	{
+		MemBufferT< uint8_t > inflated;
+		if ( ovr_InflateZipEntry( job->FileName.ToCStr(), job->Buffer, static_cast< int >( job->Buffer.GetSize() ),
+				job->CompressionMethod, job->UncompressedSize, job->Crc, inflated ) == nullptr )
+		{
+			return;
+		}
+		// a stored entry is used as is
+		if ( !inflated.IsNull() )
+		{
+			job->Buffer = inflated;
+		}
+	}
+
+	MemBuffer const buffer( job->Buffer, static_cast< int >( job->Buffer.GetSize() ) );
+	job->Succeeded = DecodeTextureBuffer( job->FileName.ToCStr(), buffer, job->Flags, true, job->Image );
+}
+
+//==============================
+// ovrTextureLoaderImpl::EnqueueJob
+// Jobs with Succeeded already set skip the workers.
+asyncTextureHandle_t ovrTextureLoaderImpl::EnqueueJob( ovrTextureLoadJob * job )
+{
+	int idx;
+	if ( FreeRequests.GetSizeI() > 0 )
+	{
+		idx = FreeRequests.Back();
+		FreeRequests.PopBack();
+	}
+	else
+	{
+		idx = Requests.GetSizeI();
+		Requests.PushBack( ovrTextureRequest() );
+	}
+
+	OVR_ASSERT( idx <= HANDLE_INDEX_MASK );
+
+	Requests[idx].State = ASYNC_TEXTURE_PENDING;
+	Requests[idx].Texture = GlTexture();
+	Requests[idx].Job = job;
+	job->RequestIndex = idx;
+	NumPending++;
+
+	if ( job->Succeeded )
+	{
+		UploadQueue.PushBack( job );
+	}
+	else
+	{
+		ovrScopedMutex mutex( JobMutex );
+		PendingJobs.PushBack( job );
+		JobCondition.Notify();
+	}
+
+	return HandleForIndex( idx );
+}
+
+//==============================
+// ovrTextureLoaderImpl::LoadTextureFromUri
+asyncTextureHandle_t ovrTextureLoaderImpl::LoadTextureFromUri( ovrFileSys & fileSys, char const * uri,
+		TextureFlags_t const & flags )
+{
+	ovrTextureLoadJob * job = new ovrTextureLoadJob();
+	job->FileName = uri;
+	job->FileSys = &fileSys;
+	job->Flags = flags;
+	return EnqueueJob( job );
+}
+
+//==============================
+// ovrTextureLoaderImpl::LoadTextureFromFile
+asyncTextureHandle_t ovrTextureLoaderImpl::LoadTextureFromFile( char const * path, TextureFlags_t const & flags )
+{
+	ovrTextureLoadJob * job = new ovrTextureLoadJob();
+	job->FileName = path;
+	job->ReadFile = true;
+	job->Flags = flags;
+	return EnqueueJob( job );
+}
+
+//==============================
+// ovrTextureLoaderImpl::LoadTextureFromBuffer
+asyncTextureHandle_t ovrTextureLoaderImpl::LoadTextureFromBuffer( char const * fileName, MemBufferT< uint8_t > & buffer,
+		TextureFlags_t const & flags )
+{
+	ovrTextureLoadJob * job = new ovrTextureLoadJob();
+	job->FileName = fileName;
+	job->Buffer = buffer;	// takes ownership
+	job->Flags = flags;
+	return EnqueueJob( job );
+}
+
+//==============================
+// ovrTextureLoaderImpl::LoadTextureFromZipEntry
+asyncTextureHandle_t ovrTextureLoaderImpl::LoadTextureFromZipEntry( char const * fileName, MemBufferT< uint8_t > & buffer,
+		int const compressionMethod, int const uncompressedSize, uint32_t const crc, TextureFlags_t const & flags )
+{
+	ovrTextureLoadJob * job = new ovrTextureLoadJob();
+	job->FileName = fileName;
+	job->Buffer = buffer;	// takes ownership
+	job->ZipEntry = true;
+	job->CompressionMethod = compressionMethod;
+	job->UncompressedSize = uncompressedSize;
+	job->Crc = crc;
+	job->Flags = flags;
+	return EnqueueJob( job );
+}
+
+//==============================
+// ovrTextureLoaderImpl::LoadTextureFromImage
+asyncTextureHandle_t ovrTextureLoaderImpl::LoadTextureFromImage( char const * fileName, ovrTextureImage & image )
+{
+	OVR_ASSERT( image.Data == image.OwnedData );
+
+	ovrTextureLoadJob * job = new ovrTextureLoadJob();
+	job->FileName = fileName;
+	ovrTextureImage & dest = job->Image;
+	dest.Format = image.Format;
+	dest.Width = image.Width;
+	dest.Height = image.Height;
+	dest.MipCount = image.MipCount;
+	dest.NumFaces = image.NumFaces;
+	dest.UseSrgbFormat = image.UseSrgbFormat;
+	dest.ImageSizeStored = image.ImageSizeStored;
+	dest.GenerateMipmaps = image.GenerateMipmaps;
+	dest.Data = image.OwnedData;
+	dest.DataSize = image.DataSize;
+	dest.OwnedData = image.OwnedData;
+	image.OwnedData = NULL;
+	image.Free();
+	// an empty image goes through the workers and fails like any other load
+	job->Succeeded = ( dest.Data != NULL );
+	return EnqueueJob( job );
+}
+
+//==============================
+// ovrTextureLoaderImpl::Update
+int ovrTextureLoaderImpl::Update( double const uploadBudgetSeconds )
+{
+	OVR_PERF_TIMER( TextureLoader_Update );
+
+	{
+		ovrScopedMutex mutex( JobMutex );
+		for ( int i = 0; i < DecodedJobs.GetSizeI(); ++i )
+		{
+			UploadQueue.PushBack( DecodedJobs[i] );
+		}
+		DecodedJobs.Resize( 0 );
+	}
+
+	double const startTime = vrapi_GetTimeInSeconds();
+	int numUploaded = 0;
+	int numProcessed = 0;
+	for ( ; numProcessed < UploadQueue.GetSizeI(); ++numProcessed )
+	{
+		if ( numUploaded > 0 && vrapi_GetTimeInSeconds() - startTime >= uploadBudgetSeconds )
+		{
+			break;
+		}
+
+		ovrTextureLoadJob * job = UploadQueue[numProcessed];
+		if ( !job->Cancelled )
+		{
+			ovrTextureRequest & request = Requests[job->RequestIndex];
+			request.Job = nullptr;
+			request.State = ASYNC_TEXTURE_FAILED;
+			if ( job->Succeeded )
+			{
+				request.Texture = CreateTextureFromImage( job->FileName.ToCStr(), job->Image );
+				if ( request.Texture.IsValid() )
+				{
+					request.State = ASYNC_TEXTURE_READY;
+				}
+				numUploaded++;
+			}
+			if ( request.State == ASYNC_TEXTURE_FAILED )
+			{
+				WARN( "Failed to load %s", job->FileName.ToCStr() );
+			}
+			NumPending--;
+		}
+		delete job;
+	}
+	UploadQueue.RemoveMultipleAt( 0, numProcessed );
+
+	return numUploaded;
+}
+
+//==============================
+// ovrTextureLoaderImpl::IndexForHandle
+// Returns -1 for a handle whose request was freed, even if the slot was reused.
+int ovrTextureLoaderImpl::IndexForHandle( asyncTextureHandle_t const handle ) const
+{
+	if ( !handle.IsValid() )
+	{
+		return -1;
+	}
+	int const idx = handle.Get() & HANDLE_INDEX_MASK;
+	if ( idx >= Requests.GetSizeI() || Requests[idx].Generation != ( handle.Get() >> HANDLE_INDEX_BITS ) )
+	{
+		return -1;
+	}
+	return idx;
+}
+
+//==============================
+// ovrTextureLoaderImpl::HandleForIndex
+asyncTextureHandle_t ovrTextureLoaderImpl::HandleForIndex( int const idx ) const
+{
+	return asyncTextureHandle_t( ( Requests[idx].Generation << HANDLE_INDEX_BITS ) | idx );
+}
+
+//==============================
+// ovrTextureLoaderImpl::GetState
+ovrAsyncTextureState ovrTextureLoaderImpl::GetState( asyncTextureHandle_t const handle ) const
+{
+	int const idx = IndexForHandle( handle );
+	if ( idx < 0 )
+	{
+		return ASYNC_TEXTURE_INVALID;
+	}
+	return Requests[idx].State;
+}
+
+//==============================
+// ovrTextureLoaderImpl::GetTexture
+GlTexture ovrTextureLoaderImpl::GetTexture( asyncTextureHandle_t const handle ) const
+{
+	int const idx = IndexForHandle( handle );
+	if ( idx < 0 || Requests[idx].State != ASYNC_TEXTURE_READY )
+	{
+		return Placeholder;
+	}
+	return Requests[idx].Texture;
+}
+
+//==============================
+// ovrTextureLoaderImpl::FreeRequest
+void ovrTextureLoaderImpl::FreeRequest( asyncTextureHandle_t const handle )
+{
+	int const idx = IndexForHandle( handle );
+	if ( idx < 0 || Requests[idx].State == ASYNC_TEXTURE_INVALID )
+	{
+		return;
+	}
+
+	if ( Requests[idx].Job != nullptr )
+	{
+		// the job is deleted when it comes back through Update
+		ovrScopedMutex mutex( JobMutex );
+		Requests[idx].Job->Cancelled = true;
+		NumPending--;
+	}
+
+	int const generation = ( Requests[idx].Generation + 1 ) & HANDLE_GENERATION_MASK;
+	Requests[idx] = ovrTextureRequest();
+	Requests[idx].Generation = generation;
+	FreeRequests.PushBack( idx );
+}
+
+//==============================================================================================
+// ovrTextureLoader
+//==============================================================================================
+
+//==============================
+// ovrTextureLoader::Create
+ovrTextureLoader * ovrTextureLoader::Create( int const numThreads )
+{
+	ovrTextureLoaderImpl * loader = new ovrTextureLoaderImpl();
+	loader->Init( numThreads );
+	return loader;
+}
+
+//==============================
+// ovrTextureLoader::Destroy
+void ovrTextureLoader::Destroy( ovrTextureLoader * & loader )
+{
+	if ( loader != nullptr )
+	{
+		static_cast< ovrTextureLoaderImpl * >( loader )->Shutdown();
+		delete loader;
+		loader = nullptr;
+	}
+}
+
+} // namespace OVR
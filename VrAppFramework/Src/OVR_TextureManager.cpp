@@ -25,8 +25,6 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 
 namespace OVR {
 
-#define USE_HASH
-
 //==============================================================================================
 // ovrManagedTexture
 //==============================================================================================
@@ -71,6 +69,30 @@ public:
 	{
 		return DJB2Hash( data.ToCStr() );
 	}
+	// allows lookups with a plain C string without constructing a String
+	UPInt operator()( char const * data ) const
+	{
+		return DJB2Hash( data );
+	}
+};
+
+//==============================================================
+// ovrTextureRecord
+// Bookkeeping kept in parallel with each ovrManagedTexture.
+struct ovrTextureRecord
+{
+	ovrTextureRecord()
+		: RefCount( 0 )
+		, SizeInBytes( 0 )
+		, PrevUnreferenced( -1 )
+		, NextUnreferenced( -1 )
+	{
+	}
+
+	int			RefCount;			// number of outstanding loads
+	size_t		SizeInBytes;		// GPU memory
+	int			PrevUnreferenced;	// links of the unreferenced textures, least recently used first
+	int			NextUnreferenced;
 };
 
 //==============================================================
@@ -100,6 +122,9 @@ public:
 
 	virtual void				FreeTexture( textureHandle_t const handle ) OVR_OVERRIDE;
 
+	virtual void				SetMemoryBudget( size_t const budgetBytes ) OVR_OVERRIDE;
+	virtual size_t				GetMemoryUsed() const OVR_OVERRIDE { return MemoryUsed; }
+
 	virtual ovrManagedTexture	GetTexture( textureHandle_t const handle ) const OVR_OVERRIDE;
 	virtual GlTexture			GetGlTexture( textureHandle_t const handle ) const OVR_OVERRIDE;
 
@@ -110,21 +135,25 @@ public:
 
 private:
 	Array< ovrManagedTexture >	Textures;
+	Array< ovrTextureRecord >	Records;		// parallel to Textures
 	Array< int >				FreeTextures;
 	bool						Initialized;
 
-#if defined( USE_HASH )
 	OVR::Hash< String, int, ovrUriHash< String > >	UriHash;
-#endif
+	OVR::Hash< int, int >		IconIdHash;
+
+	size_t						MemoryBudget;
+	size_t						MemoryUsed;
+	int							OldestUnreferenced;	// head of the list of unreferenced textures
+	int							NewestUnreferenced;
 
 	mutable int					NumUriLoads;
 	mutable int					NumActualUriLoads;
 	mutable int					NumBufferLoads;
 	mutable int					NumActualBufferLoads;
 	mutable int					NumStringSearches;
-	mutable int					NumStringCompares;
 	mutable int					NumSearches;
-	mutable int					NumCompares;
+	mutable int					NumEvictions;
 
 private:
 	ovrTextureManagerImpl();
@@ -134,6 +163,14 @@ private:
 	int				FindTextureIndex( int const iconId ) const;
 	int				IndexForHandle( textureHandle_t const handle ) const;
 	textureHandle_t AllocTexture();
+	textureHandle_t	AddRef( int const idx );
+	void			AddTexture( int const idx, ovrManagedTexture const & texture, size_t const sizeInBytes );
+	void			DeleteTexture( int const idx );
+	void			LinkUnreferenced( int const idx );
+	void			UnlinkUnreferenced( int const idx );
+	void			EvictUnreferenced();
+
+	static size_t	GetTextureSize( GlTexture const & tex );
 
 	static void		SetTextureWrapping( GlTexture & tex, ovrTextureWrap const wrapType );
 	static void		SetTextureFiltering( GlTexture & tex, ovrTextureFilter const filterType );
@@ -143,14 +180,17 @@ private:
 // ovrTextureManagerImpl::
 ovrTextureManagerImpl::ovrTextureManagerImpl()
 	: Initialized( false )
+	, MemoryBudget( 0 )
+	, MemoryUsed( 0 )
+	, OldestUnreferenced( -1 )
+	, NewestUnreferenced( -1 )
 	, NumUriLoads( 0 )
 	, NumActualUriLoads( 0 )
 	, NumBufferLoads( 0 )
 	, NumActualBufferLoads( 0 )
 	, NumStringSearches( 0 )
-	, NumStringCompares( 0 )
 	, NumSearches( 0 )
-	, NumCompares( 0 )
+	, NumEvictions( 0 )
 {
 }
 
@@ -165,9 +205,7 @@ ovrTextureManagerImpl::~ovrTextureManagerImpl()
 // ovrTextureManagerImpl::
 void ovrTextureManagerImpl::Init()
 {
-#if defined( USE_HASH )
 	UriHash.SetCapacity( 512 );
-#endif
 	Initialized = true;
 }
 
@@ -184,10 +222,13 @@ void ovrTextureManagerImpl::Shutdown()
 	}
 
 	Textures.Resize( 0 );
+	Records.Resize( 0 );
 	FreeTextures.Resize( 0 );
-#if defined( USE_HASH )
 	UriHash.Clear();
-#endif
+	IconIdHash.Clear();
+	MemoryUsed = 0;
+	OldestUnreferenced = -1;
+	NewestUnreferenced = -1;
 
 	Initialized = false;
 }
@@ -263,7 +304,7 @@ textureHandle_t ovrTextureManagerImpl::LoadTexture( ovrFileSys & fileSys, char c
 	int idx = FindTextureIndex( uri );
 	if ( idx >= 0 )
 	{
-		return Textures[idx].GetHandle();
+		return AddRef( idx );
 	}
 
 	int w;
@@ -282,10 +323,7 @@ textureHandle_t ovrTextureManagerImpl::LoadTexture( ovrFileSys & fileSys, char c
 		SetTextureFiltering( tex, filterType );
 
 		idx = IndexForHandle( handle );
-		Textures[idx] = ovrManagedTexture( handle, uri, tex );
-#if defined( USE_HASH )
-		UriHash.Add( String( uri ), idx );
-#endif
+		AddTexture( idx, ovrManagedTexture( handle, uri, tex ), GetTextureSize( tex ) );
 
 		NumActualUriLoads++;
 	}
@@ -305,7 +343,7 @@ textureHandle_t	ovrTextureManagerImpl::LoadTexture( char const * uri, void const
 	int idx = FindTextureIndex( uri );
 	if ( idx >= 0 )
 	{
-		return Textures[idx].GetHandle();
+		return AddRef( idx );
 	}
 
 	int width = 0;
@@ -328,13 +366,10 @@ textureHandle_t	ovrTextureManagerImpl::LoadTexture( char const * uri, void const
 		SetTextureFiltering( tex, filterType );
 
 		idx = IndexForHandle( handle );
-		Textures[idx] = ovrManagedTexture( handle, uri, tex );
-#if defined( USE_HASH )
 		{
 			OVR_PERF_TIMER( LoadTexture_FromBuffer_Hash );
-			UriHash.Add( String( uri ), idx );
+			AddTexture( idx, ovrManagedTexture( handle, uri, tex ), GetTextureSize( tex ) );
 		}
-#endif
 
 		NumActualBufferLoads++;
 	}
@@ -361,7 +396,7 @@ textureHandle_t	ovrTextureManagerImpl::LoadRGBATexture( char const * uri, void c
 	int idx = FindTextureIndex( uri );
 	if ( idx >= 0 )
 	{
-		return Textures[idx].GetHandle();
+		return AddRef( idx );
 	}
 
 	GlTexture tex;
@@ -383,13 +418,10 @@ textureHandle_t	ovrTextureManagerImpl::LoadRGBATexture( char const * uri, void c
 		SetTextureFiltering( tex, filterType );
 
 		idx = IndexForHandle( handle );
-		Textures[idx] = ovrManagedTexture( handle, uri, tex );
-#if defined( USE_HASH )
 		{
 			OVR_PERF_TIMER( LoadRGBATexture_uri_Hash );
-			UriHash.Add( String( uri ), idx );
+			AddTexture( idx, ovrManagedTexture( handle, uri, tex ), GetTextureSize( tex ) );
 		}
-#endif
 		NumActualBufferLoads++;
 	}
 	return handle;
@@ -412,7 +444,7 @@ textureHandle_t	ovrTextureManagerImpl::LoadRGBATexture( int const iconId, void c
 	int idx = FindTextureIndex( iconId );
 	if ( idx >= 0 )
 	{
-		return Textures[idx].GetHandle();
+		return AddRef( idx );
 	}
 
 	GlTexture tex;
@@ -433,7 +465,7 @@ textureHandle_t	ovrTextureManagerImpl::LoadRGBATexture( int const iconId, void c
 		SetTextureFiltering( tex, filterType );
 
 		idx = IndexForHandle( handle );
-		Textures[idx] = ovrManagedTexture( handle, iconId, tex );
+		AddTexture( idx, ovrManagedTexture( handle, iconId, tex ), GetTextureSize( tex ) );
 
 		NumActualBufferLoads++;
 	}
@@ -469,17 +501,35 @@ GlTexture ovrTextureManagerImpl::GetGlTexture( textureHandle_t const handle ) co
 void ovrTextureManagerImpl::FreeTexture( textureHandle_t const handle )
 {
 	int idx = IndexForHandle( handle );
-	if ( idx >= 0 )
+	if ( idx < 0 || !Textures[idx].IsValid() )
 	{
-#if defined( USE_HASH )
-		if ( Textures[idx].GetUri().IsEmpty() )
-		{
-			UriHash.Remove( Textures[idx].GetUri() );
-		}
-#endif
-		Textures[idx].Free();
-		FreeTextures.PushBack( idx );
+		return;
 	}
+
+	OVR_ASSERT( Records[idx].RefCount > 0 );
+	if ( --Records[idx].RefCount > 0 )
+	{
+		return;
+	}
+
+	if ( MemoryBudget == 0 )
+	{
+		DeleteTexture( idx );
+	}
+	else
+	{
+		// keep the texture around in case it is requested again
+		LinkUnreferenced( idx );
+		EvictUnreferenced();
+	}
+}
+
+//==============================
+// ovrTextureManagerImpl::SetMemoryBudget
+void ovrTextureManagerImpl::SetMemoryBudget( size_t const budgetBytes )
+{
+	MemoryBudget = budgetBytes;
+	EvictUnreferenced();
 }
 
 //==============================
@@ -500,23 +550,11 @@ int ovrTextureManagerImpl::FindTextureIndex( char const * uri ) const
 	}
 #endif
 
-#if defined( USE_HASH )
 	int index = -1;
-	if ( UriHash.Get( String( uri ), &index ) )
+	if ( UriHash.GetAlt( uri, &index ) )
 	{
 		return index;
 	}
-#else
-	for ( int i = 0; i < Textures.GetSizeI(); ++i )
-	{
-		if ( Textures[i].IsValid() && OVR_stricmp( uri, Textures[i].GetUri() ) == 0 )
-		{
-			NumCompares += i;
-			return i;
-		}
-	}
-	NumStringCompares += Textures.GetSizeI();
-#endif
 	return -1;
 }
 
@@ -527,20 +565,141 @@ int ovrTextureManagerImpl::FindTextureIndex( int const iconId ) const
 	OVR_PERF_TIMER( FindTextureIndex_iconId );
 
 	NumSearches++;
-	if ( Textures.GetSizeI() > 0 )
+
+	int index = -1;
+	if ( IconIdHash.Get( iconId, &index ) )
 	{
-		return 0;
+		return index;
 	}
-	for ( int i = 0; i < Textures.GetSizeI(); ++i )
+	return -1;
+}
+
+//==============================
+// ovrTextureManagerImpl::AddRef
+textureHandle_t ovrTextureManagerImpl::AddRef( int const idx )
+{
+	if ( Records[idx].RefCount++ == 0 )
 	{
-		if ( Textures[i].IsValid() && Textures[i].GetIconId() == iconId )
-		{
-			NumCompares += i;
-			return i;
-		}
+		UnlinkUnreferenced( idx );
 	}
-	NumCompares += Textures.GetSizeI();
-	return -1;
+	return Textures[idx].GetHandle();
+}
+
+//==============================
+// ovrTextureManagerImpl::AddTexture
+void ovrTextureManagerImpl::AddTexture( int const idx, ovrManagedTexture const & texture, size_t const sizeInBytes )
+{
+	Textures[idx] = texture;
+	Records[idx] = ovrTextureRecord();
+	Records[idx].RefCount = 1;
+	Records[idx].SizeInBytes = sizeInBytes;
+
+	if ( texture.GetSource() == ovrManagedTexture::TEXTURE_SOURCE_URI )
+	{
+		UriHash.Set( texture.GetUri(), idx );
+	}
+	else if ( texture.GetSource() == ovrManagedTexture::TEXTURE_SOURCE_ICON )
+	{
+		IconIdHash.Set( texture.GetIconId(), idx );
+	}
+
+	MemoryUsed += sizeInBytes;
+	EvictUnreferenced();
+}
+
+//==============================
+// ovrTextureManagerImpl::DeleteTexture
+void ovrTextureManagerImpl::DeleteTexture( int const idx )
+{
+	if ( Textures[idx].GetSource() == ovrManagedTexture::TEXTURE_SOURCE_URI )
+	{
+		UriHash.Remove( Textures[idx].GetUri() );
+	}
+	else if ( Textures[idx].GetSource() == ovrManagedTexture::TEXTURE_SOURCE_ICON )
+	{
+		IconIdHash.Remove( Textures[idx].GetIconId() );
+	}
+	MemoryUsed -= Records[idx].SizeInBytes;
+	Records[idx] = ovrTextureRecord();
+	Textures[idx].Free();
+	FreeTextures.PushBack( idx );
+}
+
+//==============================
+// ovrTextureManagerImpl::LinkUnreferenced
+// Appends a texture that lost its last reference as the most recently used.
+void ovrTextureManagerImpl::LinkUnreferenced( int const idx )
+{
+	Records[idx].PrevUnreferenced = NewestUnreferenced;
+	Records[idx].NextUnreferenced = -1;
+	if ( NewestUnreferenced >= 0 )
+	{
+		Records[NewestUnreferenced].NextUnreferenced = idx;
+	}
+	else
+	{
+		OldestUnreferenced = idx;
+	}
+	NewestUnreferenced = idx;
+}
+
+//==============================
+// ovrTextureManagerImpl::UnlinkUnreferenced
+// Removes a texture from the unreferenced list, if it is on it.
+void ovrTextureManagerImpl::UnlinkUnreferenced( int const idx )
+{
+	ovrTextureRecord & record = Records[idx];
+	if ( record.PrevUnreferenced < 0 && OldestUnreferenced != idx )
+	{
+		return;
+	}
+	if ( record.PrevUnreferenced >= 0 )
+	{
+		Records[record.PrevUnreferenced].NextUnreferenced = record.NextUnreferenced;
+	}
+	else
+	{
+		OldestUnreferenced = record.NextUnreferenced;
+	}
+	if ( record.NextUnreferenced >= 0 )
+	{
+		Records[record.NextUnreferenced].PrevUnreferenced = record.PrevUnreferenced;
+	}
+	else
+	{
+		NewestUnreferenced = record.PrevUnreferenced;
+	}
+	record.PrevUnreferenced = -1;
+	record.NextUnreferenced = -1;
+}
+
+//==============================
+// ovrTextureManagerImpl::EvictUnreferenced
+// Deletes the least recently used unreferenced textures until the budget is met.
+// Referenced textures are never evicted, so usage can remain above the budget.
+void ovrTextureManagerImpl::EvictUnreferenced()
+{
+	while ( MemoryUsed > MemoryBudget && OldestUnreferenced >= 0 )
+	{
+		const int oldest = OldestUnreferenced;
+		UnlinkUnreferenced( oldest );
+		DeleteTexture( oldest );
+		NumEvictions++;
+	}
+}
+
+//==============================
+// ovrTextureManagerImpl::GetTextureSize
+size_t ovrTextureManagerImpl::GetTextureSize( GlTexture const & tex )
+{
+	const size_t size = GetGlTextureSize( tex );
+	if ( size > 0 )
+	{
+		return size;
+	}
+	// not created from image data, so assume 32 bits per texel and a full mip chain
+	size_t const baseSize = static_cast< size_t >( GetOvrTextureSize( Texture_RGBA, tex.Width, tex.Height ) );
+	return baseSize + baseSize / 3;
 }
 
 //==============================
@@ -565,11 +724,13 @@ textureHandle_t ovrTextureManagerImpl::AllocTexture()
 		int idx = FreeTextures[FreeTextures.GetSizeI() - 1];
 		FreeTextures.PopBack();
 		Textures[idx] = ovrManagedTexture();
+		Records[idx] = ovrTextureRecord();
 		return textureHandle_t( idx );
 	}
 
 	int idx = Textures.GetSizeI();
 	Textures.PushBack( ovrManagedTexture() );
+	Records.PushBack( ovrTextureRecord() );
 
 	return textureHandle_t( idx );
 }
@@ -608,10 +769,11 @@ void ovrTextureManagerImpl::PrintStats() const
 	LOG( "NumActualBufferLoads: %i",	NumActualBufferLoads );
 
 	LOG( "NumStringSearches: %i", NumStringSearches );
-	LOG( "NumStringCompares: %i", NumStringCompares );
-
 	LOG( "NumSearches: %i", NumSearches );
-	LOG( "NumCompares: %i", NumCompares );
+
+	LOG( "MemoryUsed:   %llu", static_cast< uint64_t >( MemoryUsed ) );
+	LOG( "MemoryBudget: %llu", static_cast< uint64_t >( MemoryBudget ) );
+	LOG( "NumEvictions: %i", NumEvictions );
 }
 
 //==============================================================================================
@@ -0,0 +1,182 @@
+/************************************************************************************
+
+Filename    :   OVR_WorkerPool.cpp
+Content     :   Persistent worker threads for splitting per-frame work.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include "OVR_WorkerPool.h"
+
+#include "Kernel/OVR_Alg.h"
+#include "ScopedMutex.h"
+
+namespace OVR
+{
+
+static const int MAX_WORKER_THREADS = 16;
+
+//==============================
+// ovrWorkerPool::ovrWorkerPool
+ovrWorkerPool::ovrWorkerPool()
+	: TaskFunc( NULL )
+	, TaskData( NULL )
+	, NumTasks( 0 )
+	, NextTask( 0 )
+	, NumUnfinished( 0 )
+	, Exiting( false )
+	, Initialized( false )
+{
+}
+
+//==============================
+// ovrWorkerPool::~ovrWorkerPool
+ovrWorkerPool::~ovrWorkerPool()
+{
+	Shutdown();
+}
+
+//==============================
+// ovrWorkerPool::Init
+void ovrWorkerPool::Init( const int numThreads, const Thread::ThreadPriority priority )
+{
+	Shutdown();
+
+	Exiting = false;
+	Initialized = true;
+	const int count = Alg::Clamp( numThreads, 0, MAX_WORKER_THREADS );
+	for ( int i = 0; i < count; i++ )
+	{
+		Thread::CreateParams createParams( ovrWorkerPool::ThreadFn, this, 128 * 1024, -1, Thread::Running, priority );
+		Threads.PushBack( new Thread( createParams ) );
+	}
+}
+
+//==============================
+// ovrWorkerPool::Shutdown
+void ovrWorkerPool::Shutdown()
+{
+	{
+		ovrScopedMutex mutex( TaskMutex );
+		Exiting = true;
+		TaskCondition.NotifyAll();
+	}
+	for ( int i = 0; i < Threads.GetSizeI(); i++ )
+	{
+		Threads[i]->Join();
+		delete Threads[i];
+	}
+	Threads.Resize( 0 );
+	Initialized = false;
+}
+
+//==============================
+// ovrWorkerPool::RunTasks
+void ovrWorkerPool::RunTasks()
+{
+	TaskMutex.DoLock();
+	while ( NextTask < NumTasks )
+	{
+		const int task = NextTask++;
+		TaskMutex.Unlock();
+
+		TaskFunc( TaskData, task );
+
+		TaskMutex.DoLock();
+		if ( --NumUnfinished == 0 )
+		{
+			DoneCondition.NotifyAll();
+		}
+	}
+	TaskMutex.Unlock();
+}
+
+//==============================
+// ovrWorkerPool::Run
+void ovrWorkerPool::Run( const int numTasks, ovrWorkerTaskFunc func, void * data )
+{
+	if ( numTasks <= 0 )
+	{
+		return;
+	}
+	if ( Threads.GetSizeI() == 0 || numTasks == 1 )
+	{
+		for ( int task = 0; task < numTasks; task++ )
+		{
+			func( data, task );
+		}
+		return;
+	}
+
+	Start( numTasks, func, data );
+	Wait();
+}
+
+//==============================
+// ovrWorkerPool::Start
+void ovrWorkerPool::Start( const int numTasks, ovrWorkerTaskFunc func, void * data )
+{
+	ovrScopedMutex mutex( TaskMutex );
+	OVR_ASSERT( NextTask >= NumTasks );
+	TaskFunc = func;
+	TaskData = data;
+	NumTasks = Alg::Max( numTasks, 0 );
+	NextTask = 0;
+	NumUnfinished = NumTasks;
+	TaskCondition.NotifyAll();
+}
+
+//==============================
+// ovrWorkerPool::Wait
+void ovrWorkerPool::Wait()
+{
+	RunTasks();
+
+	ovrScopedMutex mutex( TaskMutex );
+	while ( NumUnfinished > 0 )
+	{
+		DoneCondition.Wait( &TaskMutex );
+	}
+	NumTasks = 0;
+	NextTask = 0;
+}
+
+//==============================
+// ovrWorkerPool::IsFinished
+bool ovrWorkerPool::IsFinished()
+{
+	ovrScopedMutex mutex( TaskMutex );
+	return NumUnfinished == 0;
+}
+
+//==============================
+// ovrWorkerPool::ThreadFn
+threadReturn_t ovrWorkerPool::ThreadFn( Thread * thread, void * data )
+{
+	ovrWorkerPool * pool = static_cast< ovrWorkerPool * >( data );
+
+	thread->SetThreadName( "OVR::Worker" );
+
+	for ( ; ; )
+	{
+		{
+			ovrScopedMutex mutex( pool->TaskMutex );
+			while ( !pool->Exiting && pool->NextTask >= pool->NumTasks )
+			{
+				pool->TaskCondition.Wait( &pool->TaskMutex );
+			}
+			if ( pool->Exiting )
+			{
+				break;
+			}
+		}
+		pool->RunTasks();
+	}
+
+	return (threadReturn_t)0;
+}
+
+} // namespace OVR
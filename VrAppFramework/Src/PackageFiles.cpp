@@ -15,12 +15,18 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 #include "Kernel/OVR_LogUtils.h"
 #include "Kernel/OVR_String.h"
 #include "Kernel/OVR_Threads.h"
+#include "Kernel/OVR_Hash.h"
+#include "Kernel/OVR_List.h"
 
 #include "unzip.h"
 
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#if defined( OVR_OS_ANDROID ) || defined( OVR_OS_LINUX )
+#include <dirent.h>
+#include <unistd.h>
+#endif
 #include "ScopedMutex.h"
 
 namespace OVR
@@ -34,6 +40,394 @@ const char *	ovr_GetApplicationPackageCachePath()
 	return CachePath;
 }
 
+//==============================================================
+// ovrPackageCache
+//
+// Index of the decompressed files in CachePath. The manifest is loaded once
+// when the package is opened, so lookups never touch the filesystem unless
+// the file is actually in the cache. Entries are kept in most-recently-used
+// order and the least recently used ones are deleted whenever a new file takes
+// the total size over the budget.
+//
+// All access happens with PackageFileMutex held.
+//==============================================================
+
+static const uint32_t	PACKAGE_CACHE_MANIFEST_MAGIC		= 0x4d43504f;	// "OPCM"
+static const uint32_t	PACKAGE_CACHE_MANIFEST_VERSION		= 1;
+static const char *		PACKAGE_CACHE_MANIFEST_NAME			= "cache_manifest.dat";
+static const char *		PACKAGE_CACHE_MANIFEST_TEMP_NAME	= "cache_manifest.tmp";
+static const int		PACKAGE_CACHE_TOUCHES_PER_SAVE		= 64;
+static const uint32_t	PACKAGE_CACHE_MAX_ENTRIES			= 1 << 20;
+
+struct ovrPackageCacheEntry : public ListNode< ovrPackageCacheEntry >
+{
+	uint32_t	Crc;
+	uint32_t	Size;
+	uint32_t	LastUse;
+};
+
+struct ovrPackageCacheManifestEntry
+{
+	uint32_t	Crc;
+	uint32_t	Size;
+	uint32_t	LastUse;
+};
+
+class ovrPackageCache
+{
+public:
+					ovrPackageCache();
+					~ovrPackageCache();
+
+	void			Open( const char * cachePath );
+	void			SetBudget( size_t maxBytes );
+
+	// Returns true if a file for the crc with the given size is in the cache.
+	bool			Contains( const uint32_t crc, const uint32_t size ) const;
+	// Marks an entry as most recently used.
+	void			Touch( const uint32_t crc );
+	// Returns false if a file of the given size can never fit in the budget.
+	bool			CanInsert( const uint32_t size ) const;
+	// Records a file that was just renamed into the cache path and evicts the
+	// least recently used files to make room for it. Nothing is evicted for a
+	// write that fails, so the valid entries survive a full disk.
+	void			Insert( const uint32_t crc, const uint32_t size );
+	// Drops an entry whose file turned out to be missing or damaged.
+	void			Remove( const uint32_t crc );
+
+	size_t			GetTotalBytes() const { return TotalBytes; }
+
+private:
+	Hash< uint32_t, ovrPackageCacheEntry * >	Index;
+	List< ovrPackageCacheEntry >				LruList;	// most recently used first
+	size_t										TotalBytes;
+	size_t										BudgetBytes;
+	uint32_t									UseCounter;
+	int											TouchesSinceSave;
+	bool										Dirty;
+
+	void			Clear();
+	void			AddEntry( const uint32_t crc, const uint32_t size, const uint32_t lastUse );
+	void			EvictEntry( ovrPackageCacheEntry * entry );
+	void			EnforceBudget();
+	bool			LoadManifest();
+	void			ScanCacheFiles();
+	void			SaveManifest();
+};
+
+static const size_t DEFAULT_PACKAGE_CACHE_BUDGET_BYTES = 128 * 1024 * 1024;
+
+static void MakeCacheFileName( char * out, const size_t outSize, const uint32_t crc, const char * extension )
+{
+	OVR_sprintf( out, outSize, "%s/%08x.%s", CachePath, (unsigned)crc, extension );
+}
+
+ovrPackageCache::ovrPackageCache() :
+	TotalBytes( 0 ),
+	BudgetBytes( DEFAULT_PACKAGE_CACHE_BUDGET_BYTES ),
+	UseCounter( 0 ),
+	TouchesSinceSave( 0 ),
+	Dirty( false )
+{
+}
+
+ovrPackageCache::~ovrPackageCache()
+{
+	Clear();
+}
+
+void ovrPackageCache::Clear()
+{
+	while ( !LruList.IsEmpty() )
+	{
+		ovrPackageCacheEntry * entry = LruList.GetFirst();
+		LruList.Remove( entry );
+		delete entry;
+	}
+	Index.Clear();
+	TotalBytes = 0;
+}
+
+void ovrPackageCache::Open( const char * cachePath )
+{
+	Clear();
+	UseCounter = 0;
+	TouchesSinceSave = 0;
+	Dirty = false;
+
+	if ( cachePath == NULL || cachePath[0] == '\0' )
+	{
+		return;
+	}
+
+	if ( !LoadManifest() )
+	{
+		// No usable manifest, so adopt whatever a previous version left behind.
+		ScanCacheFiles();
+		Dirty = true;
+	}
+
+	EnforceBudget();
+	if ( Dirty )
+	{
+		SaveManifest();
+	}
+	LOG( "Package cache: %i files, %zu bytes, budget %zu bytes", Index.GetSizeI(), TotalBytes, BudgetBytes );
+}
+
+void ovrPackageCache::SetBudget( size_t maxBytes )
+{
+	BudgetBytes = maxBytes;
+	EnforceBudget();
+	if ( Dirty )
+	{
+		SaveManifest();
+	}
+}
+
+bool ovrPackageCache::Contains( const uint32_t crc, const uint32_t size ) const
+{
+	ovrPackageCacheEntry * const * entry = Index.Get( crc );
+	return entry != NULL && (*entry)->Size == size;
+}
+
+void ovrPackageCache::Touch( const uint32_t crc )
+{
+	ovrPackageCacheEntry ** entry = Index.Get( crc );
+	if ( entry == NULL )
+	{
+		return;
+	}
+	(*entry)->LastUse = ++UseCounter;
+	LruList.BringToFront( *entry );
+	Dirty = true;
+
+	// Recency only matters for eviction order, so don't rewrite the
+	// manifest on every hit.
+	if ( ++TouchesSinceSave >= PACKAGE_CACHE_TOUCHES_PER_SAVE )
+	{
+		SaveManifest();
+	}
+}
+
+bool ovrPackageCache::CanInsert( const uint32_t size ) const
+{
+	return size <= BudgetBytes;
+}
+
+void ovrPackageCache::Insert( const uint32_t crc, const uint32_t size )
+{
+	ovrPackageCacheEntry ** existing = Index.Get( crc );
+	if ( existing != NULL )
+	{
+		// The rename replaced the old file, so only the accounting changes.
+		TotalBytes -= (*existing)->Size;
+		LruList.Remove( *existing );
+		delete *existing;
+		Index.Remove( crc );
+	}
+	AddEntry( crc, size, ++UseCounter );
+	EnforceBudget();
+	SaveManifest();
+}
+
+void ovrPackageCache::Remove( const uint32_t crc )
+{
+	ovrPackageCacheEntry ** entry = Index.Get( crc );
+	if ( entry != NULL )
+	{
+		EvictEntry( *entry );
+		SaveManifest();
+	}
+}
+
+void ovrPackageCache::AddEntry( const uint32_t crc, const uint32_t size, const uint32_t lastUse )
+{
+	ovrPackageCacheEntry * entry = new ovrPackageCacheEntry;
+	entry->Crc = crc;
+	entry->Size = size;
+	entry->LastUse = lastUse;
+
+	// Keep the list ordered by LastUse, which is normally just a push to the front.
+	ovrPackageCacheEntry * before = LruList.GetFirst();
+	while ( !LruList.IsNull( before ) && before->LastUse > lastUse )
+	{
+		before = LruList.GetNext( before );
+	}
+	if ( LruList.IsNull( before ) )
+	{
+		LruList.PushBack( entry );
+	}
+	else
+	{
+		before->InsertNodeBefore( entry );
+	}
+
+	Index.Set( crc, entry );
+	TotalBytes += size;
+	if ( lastUse > UseCounter )
+	{
+		UseCounter = lastUse;
+	}
+	Dirty = true;
+}
+
+void ovrPackageCache::EvictEntry( ovrPackageCacheEntry * entry )
+{
+#if defined( OVR_OS_ANDROID ) || defined( OVR_OS_LINUX )
+	char cacheName[1024];
+	MakeCacheFileName( cacheName, sizeof( cacheName ), entry->Crc, "bin" );
+	if ( unlink( cacheName ) == -1 )
+	{
+		LOG( "Failed to delete cache file %s", cacheName );
+	}
+#endif
+	TotalBytes -= entry->Size;
+	Index.Remove( entry->Crc );
+	LruList.Remove( entry );
+	delete entry;
+	Dirty = true;
+}
+
+void ovrPackageCache::EnforceBudget()
+{
+	while ( !LruList.IsEmpty() && TotalBytes > BudgetBytes )
+	{
+		ovrPackageCacheEntry * oldest = LruList.GetLast();
+		LOG( "Evicting cache file %08x (%u bytes)", (unsigned)oldest->Crc, (unsigned)oldest->Size );
+		EvictEntry( oldest );
+	}
+}
+
+bool ovrPackageCache::LoadManifest()
+{
+#if defined( OVR_OS_ANDROID ) || defined( OVR_OS_LINUX )
+	char manifestName[1024];
+	OVR_sprintf( manifestName, sizeof( manifestName ), "%s/%s", CachePath, PACKAGE_CACHE_MANIFEST_NAME );
+
+	const int fd = open( manifestName, O_RDONLY );
+	if ( fd < 0 )
+	{
+		return false;
+	}
+
+	bool ok = false;
+	uint32_t header[3] = {};
+	if ( read( fd, header, sizeof( header ) ) == (int)sizeof( header ) &&
+			header[0] == PACKAGE_CACHE_MANIFEST_MAGIC && header[1] == PACKAGE_CACHE_MANIFEST_VERSION &&
+			header[2] <= PACKAGE_CACHE_MAX_ENTRIES )
+	{
+		const int numEntries = (int)header[2];
+		Array< ovrPackageCacheManifestEntry > entries;
+		entries.Resize( numEntries );
+		const int bytes = numEntries * (int)sizeof( ovrPackageCacheManifestEntry );
+		if ( numEntries == 0 || read( fd, entries.GetDataPtr(), bytes ) == bytes )
+		{
+			for ( int i = 0; i < numEntries; i++ )
+			{
+				if ( Index.Get( entries[i].Crc ) == NULL )
+				{
+					AddEntry( entries[i].Crc, entries[i].Size, entries[i].LastUse );
+				}
+			}
+			ok = true;
+		}
+	}
+	close( fd );
+
+	if ( !ok )
+	{
+		LOG( "Ignoring damaged cache manifest %s", manifestName );
+		Clear();
+		return false;
+	}
+	Dirty = false;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void ovrPackageCache::ScanCacheFiles()
+{
+#if defined( OVR_OS_ANDROID ) || defined( OVR_OS_LINUX )
+	DIR * dir = opendir( CachePath );
+	if ( dir == NULL )
+	{
+		return;
+	}
+	struct dirent * entry;
+	while ( ( entry = readdir( dir ) ) != NULL )
+	{
+		unsigned crc = 0;
+		char extension[4] = {};
+		if ( sscanf( entry->d_name, "%08x.%3s", &crc, extension ) != 2 || OVR_strlen( entry->d_name ) != 12 )
+		{
+			continue;
+		}
+		char fileName[1024];
+		OVR_sprintf( fileName, sizeof( fileName ), "%s/%s", CachePath, entry->d_name );
+		if ( OVR_strcmp( extension, "tmp" ) == 0 )
+		{
+			// Left over from an interrupted write.
+			unlink( fileName );
+			continue;
+		}
+		if ( OVR_strcmp( extension, "bin" ) != 0 )
+		{
+			continue;
+		}
+		struct stat s = {};
+		if ( stat( fileName, &s ) != -1 && Index.Get( crc ) == NULL )
+		{
+			AddEntry( crc, (uint32_t)s.st_size, 0 );
+		}
+	}
+	closedir( dir );
+#endif
+}
+
+void ovrPackageCache::SaveManifest()
+{
+	TouchesSinceSave = 0;
+#if defined( OVR_OS_ANDROID ) || defined( OVR_OS_LINUX )
+	Array< ovrPackageCacheManifestEntry > entries;
+	entries.Reserve( Index.GetSizeI() );
+	for ( const ovrPackageCacheEntry * entry = LruList.GetFirst(); !LruList.IsNull( entry ); entry = LruList.GetNext( entry ) )
+	{
+		ovrPackageCacheManifestEntry e = { entry->Crc, entry->Size, entry->LastUse };
+		entries.PushBack( e );
+	}
+	const uint32_t header[3] = { PACKAGE_CACHE_MANIFEST_MAGIC, PACKAGE_CACHE_MANIFEST_VERSION, (uint32_t)entries.GetSize() };
+
+	char tempName[1024];
+	OVR_sprintf( tempName, sizeof( tempName ), "%s/%s", CachePath, PACKAGE_CACHE_MANIFEST_TEMP_NAME );
+	char manifestName[1024];
+	OVR_sprintf( manifestName, sizeof( manifestName ), "%s/%s", CachePath, PACKAGE_CACHE_MANIFEST_NAME );
+
+	// Write to a temp file and rename so a crash never leaves a partial manifest.
+	const int fd = open( tempName, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR );
+	if ( fd < 0 )
+	{
+		LOG( "Failed to open cache manifest %s", tempName );
+		return;
+	}
+	const int bytes = entries.GetSizeI() * (int)sizeof( ovrPackageCacheManifestEntry );
+	const bool written = write( fd, header, sizeof( header ) ) == (int)sizeof( header ) &&
+						( bytes == 0 || write( fd, entries.GetDataPtr(), bytes ) == bytes );
+	close( fd );
+	if ( !written || rename( tempName, manifestName ) == -1 )
+	{
+		LOG( "Failed to write cache manifest %s", manifestName );
+		unlink( tempName );
+		return;
+	}
+#endif
+	Dirty = false;
+}
+
+static ovrPackageCache PackageCache;
+
 OvrApkFile::OvrApkFile( void * zipFile ) : 
 	ZipFile( zipFile ) 
 { 
@@ -109,6 +503,30 @@ bool ovr_OtherPackageFileExists( void* zipFile, const char * nameInZip )
 	return true;
 }
 
+void ovr_ListOtherApplicationPackage( void * zipFile, Array< String > & outNames )
+{
+	if ( zipFile == 0 )
+	{
+		return;
+	}
+
+	ovrScopedMutex mutex( PackageFileMutex );
+
+	if ( unzGoToFirstFile( zipFile ) != UNZ_OK )
+	{
+		return;
+	}
+	do
+	{
+		unz_file_info fileInfo;
+		char fileName[1024];
+		if ( unzGetCurrentFileInfo( zipFile, &fileInfo, fileName, sizeof( fileName ), NULL, 0, NULL, 0 ) == UNZ_OK )
+		{
+			outNames.PushBack( String( fileName ) );
+		}
+	} while ( unzGoToNextFile( zipFile ) == UNZ_OK );
+}
+
 
 bool ovr_ReadFileFromOtherApplicationPackage( void * zipFile, const char * nameInZip, MemBufferT< uint8_t > & outBuffer )
 {
@@ -149,53 +567,44 @@ bool ovr_ReadFileFromOtherApplicationPackage( void * zipFile, const char * nameI
 	}
 
 	// Check for an already extracted cache file based on the CRC if
-	// the file is compressed.
-	if ( info.compression_method != 0 && CachePath[0] )
+	// the file is compressed.  The cache index is consulted first so
+	// misses never touch the filesystem.
+	if ( info.compression_method != 0 && CachePath[0] && PackageCache.Contains( (uint32_t)info.crc, (uint32_t)info.uncompressed_size ) )
 	{
 		char	cacheName[1024];
-		sprintf( cacheName, "%s/%08x.bin", CachePath, (unsigned)info.crc );
-#if defined( OVR_OS_ANDROID )
+		MakeCacheFileName( cacheName, sizeof( cacheName ), (uint32_t)info.crc, "bin" );
+#if defined( OVR_OS_ANDROID ) || defined( OVR_OS_LINUX )
 		const int fd = open( cacheName, O_RDONLY );
-		if ( fd > 0 )
+		if ( fd >= 0 )
 		{
-			struct stat	s = {};
-
-			if ( fstat( fd, &s ) != -1 )
+//			LOG( "Loading cached file for: %s", nameInZip );
+			length = info.uncompressed_size;
+			buffer = malloc( length );
+			const int r = read( fd, buffer, length );
+			close( fd );
+			if ( r != length )
 			{
-//				LOG( "Loading cached file for: %s", nameInZip );
-				length = s.st_size;
-				if ( length != (int)info.uncompressed_size )
-				{
-					LOG( "Cached file for %s has length %i != %i", nameInZip,
-							length, info.uncompressed_size );
-					// Fall through to normal load.
-				}
-				else
-				{
-					buffer = malloc( length );
-					const int r = read( fd, buffer, length );
-					close( fd );
-					if ( r != length )
-					{
-						LOG( "Cached file for %s only read %i != %i", nameInZip,
-								r, length );
-						free( buffer );
-						// Fall through to normal load.
-					}
-					else
-					{	// Got the cached file.
-						return true;
-					}
-				}
+				LOG( "Cached file for %s only read %i != %i", nameInZip,
+						r, length );
+				free( buffer );
+				buffer = NULL;
+				length = 0;
+				PackageCache.Remove( (uint32_t)info.crc );
+				// Fall through to normal load.
 			}
-			close( fd );
+			else
+			{	// Got the cached file.
+				PackageCache.Touch( (uint32_t)info.crc );
+				return true;
+			}
+		}
+		else
+		{
+			LOG( "Cached file for %s is missing", nameInZip );
+			PackageCache.Remove( (uint32_t)info.crc );
 		}
 #endif
 	}
-	else
-	{
-//		LOG( "Not compressed: %s", nameInZip );
-	}
 
 	const int openRet = unzOpenCurrentFile( zipFile );
 	if ( openRet != UNZ_OK )
@@ -220,16 +629,16 @@ bool ovr_ReadFileFromOtherApplicationPackage( void * zipFile, const char * nameI
 	unzCloseCurrentFile( zipFile );
 
 	// Optionally write out to the cache directory
-	if ( info.compression_method != 0 && CachePath[0] )
+	if ( info.compression_method != 0 && CachePath[0] && PackageCache.CanInsert( (uint32_t)length ) )
 	{
 		char	tempName[1024];
-		sprintf( tempName, "%s/%08x.tmp", CachePath, (unsigned)info.crc );
+		MakeCacheFileName( tempName, sizeof( tempName ), (uint32_t)info.crc, "tmp" );
 
 		char	cacheName[1024];
-		sprintf( cacheName, "%s/%08x.bin", CachePath, (unsigned)info.crc );
-#if defined( OVR_OS_ANDROID )
+		MakeCacheFileName( cacheName, sizeof( cacheName ), (uint32_t)info.crc, "bin" );
+#if defined( OVR_OS_ANDROID ) || defined( OVR_OS_LINUX )
 		const int fd = open( tempName, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR );
-		if ( fd > 0 )
+		if ( fd >= 0 )
 		{
 			const int r = write( fd, buffer, length );
 			close( fd );
@@ -238,15 +647,18 @@ bool ovr_ReadFileFromOtherApplicationPackage( void * zipFile, const char * nameI
 				if ( rename( tempName, cacheName ) == -1 )
 				{
 					LOG( "Failed to rename cache file for %s", nameInZip );
+					unlink( tempName );
 				}
 				else
 				{
 					LOG( "Cache file generated for %s", nameInZip );
+					PackageCache.Insert( (uint32_t)info.crc, (uint32_t)length );
 				}
 			}
 			else
 			{
 				LOG( "Only wrote %i of %i for cached %s", r, length, nameInZip );
+				unlink( tempName );
 			}
 		}
 		else
@@ -265,6 +677,54 @@ bool ovr_ReadFileFromOtherApplicationPackage( void * zipFile, const char * nameI
 
 static unzFile packageZipFile = 0;
 
+const uint8_t * ovr_InflateZipEntry( const char * nameInZip, const uint8_t * data, const int dataSize,
+		const int compressionMethod, const int uncompressedSize, const uint32_t crc,
+		MemBufferT< uint8_t > & inflated )
+{
+	const uint8_t * file = data;
+	if ( compressionMethod == Z_DEFLATED )
+	{
+		inflated.Realloc( uncompressedSize );
+
+		z_stream stream;
+		memset( &stream, 0, sizeof( stream ) );
+		if ( inflateInit2( &stream, -MAX_WBITS ) != Z_OK )
+		{
+			return NULL;
+		}
+		stream.next_in = const_cast< Bytef * >( data );
+		stream.avail_in = dataSize;
+		stream.next_out = inflated;
+		stream.avail_out = uncompressedSize;
+		const int ret = inflate( &stream, Z_FINISH );
+		inflateEnd( &stream );
+		if ( ret != Z_STREAM_END || stream.total_out != (uLong)uncompressedSize )
+		{
+			WARN( "Failed to inflate %s", nameInZip );
+			return NULL;
+		}
+		file = inflated;
+	}
+	else if ( compressionMethod != 0 )
+	{
+		WARN( "Unsupported compression method %d for %s", compressionMethod, nameInZip );
+		return NULL;
+	}
+	else if ( dataSize != uncompressedSize )
+	{
+		WARN( "Failed to read %s", nameInZip );
+		return NULL;
+	}
+
+	// the entry was read raw, so its crc is checked here
+	if ( crc32( 0, file, uncompressedSize ) != crc )
+	{
+		WARN( "Bad crc for %s", nameInZip );
+		return NULL;
+	}
+	return file;
+}
+
 void * ovr_GetApplicationPackageFile()
 {
 	return packageZipFile;
@@ -279,10 +739,25 @@ void ovr_OpenApplicationPackage( const char * packageCodePath, const char * cach
 	if ( cachePath_ != NULL )
 	{
 		OVR_strncpy( CachePath, sizeof( CachePath ), cachePath_, sizeof( CachePath ) - 1 );
+
+		ovrScopedMutex mutex( PackageFileMutex );
+		PackageCache.Open( CachePath );
 	}
 	packageZipFile = ovr_OpenOtherApplicationPackage( packageCodePath );
 }
 
+void ovr_SetApplicationPackageCacheBudget( const size_t maxBytes )
+{
+	ovrScopedMutex mutex( PackageFileMutex );
+	PackageCache.SetBudget( maxBytes );
+}
+
+size_t ovr_GetApplicationPackageCacheSize()
+{
+	ovrScopedMutex mutex( PackageFileMutex );
+	return PackageCache.GetTotalBytes();
+}
+
 bool ovr_PackageFileExists( const char * nameInZip )
 {
 	return ovr_OtherPackageFileExists( packageZipFile, nameInZip );
@@ -15,6 +15,7 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 #include "Android/JniUtils.h"
 #include "VrCommon.h"
 #include "App.h"
+#include "OVR_PathCache.h"
 
 #include "VrApi.h"				// for vrapi_GetSystemPropertyString
 #include "VrApi_SystemUtils.h"	// for vrapi_ShowFatalError
@@ -225,42 +226,21 @@ long long OvrStoragePaths::GetAvailableInternalMemoryInBytes( JNIEnv * jni, jobj
 
 String GetFullPath( const Array<String>& searchPaths, const String & relativePath )
 {
-	if ( FileExists( relativePath.ToCStr() ) )
-	{
-		return relativePath;
-	}
-
-	const int numSearchPaths = searchPaths.GetSizeI();
-	for ( int index = 0; index < numSearchPaths; ++index )
-	{
-		const String fullPath = searchPaths.At( index ) + String( relativePath );
-		if ( FileExists( fullPath.ToCStr() ) )
-		{
-			return fullPath;
-		}
-	}
-
-	return String();
+	String fullPath;
+	ovrPathCache::Get().Resolve( searchPaths, relativePath.ToCStr(), fullPath );
+	return fullPath;
 }
 
 bool GetFullPath( const Array<String>& searchPaths, char const * relativePath, char * outPath, const int outMaxLen )
 {
 	OVR_ASSERT( outPath != NULL && outMaxLen >= 1 );
 
-	if ( FileExists( relativePath ) )
+	String fullPath;
+	if ( ovrPathCache::Get().Resolve( searchPaths, relativePath, fullPath ) != ovrPathCache::NOT_FOUND )
 	{
-		OVR_sprintf( outPath, OVR_strlen( relativePath ) + 1, "%s", relativePath );
+		OVR_sprintf( outPath, outMaxLen, "%s", fullPath.ToCStr() );
 		return true;
 	}
-
-	for ( int i = 0; i < searchPaths.GetSizeI(); ++i )
-	{
-		OVR_sprintf( outPath, outMaxLen, "%s%s", searchPaths[i].ToCStr(), relativePath );
-		if ( FileExists( outPath ) )
-		{
-			return true;	// outpath is now set to the full path
-		}
-	}
 	// just return the relative path if we never found the file
 	OVR_sprintf( outPath, outMaxLen, "%s", relativePath );
 	return false;
@@ -268,13 +248,17 @@ bool GetFullPath( const Array<String>& searchPaths, char const * relativePath, c
 
 bool GetFullPath( const Array<String>& searchPaths, char const * relativePath, String & outPath )
 {
-	char largePath[1024];
-	bool result = GetFullPath( searchPaths, relativePath, largePath, sizeof( largePath ) );
-	if ( result )
-	{
-		outPath = largePath;
-	}
-	return result;
+	return ovrPathCache::Get().Resolve( searchPaths, relativePath, outPath ) != ovrPathCache::NOT_FOUND;
+}
+
+int GetFullPaths( const Array< String > & searchPaths, const Array< String > & relativePaths, Array< String > & outPaths )
+{
+	return ovrPathCache::Get().ResolveBatch( searchPaths, relativePaths, outPaths );
+}
+
+void FlushFullPathCache()
+{
+	ovrPathCache::Get().Flush();
 }
 
 bool ToRelativePath( const Array<String>& searchPaths, char const * fullPath, char * outPath, const int outMaxLen )
@@ -31,11 +31,31 @@ bool LogRenderSurfaces = false;	// Do not check in set to true!
 
 OVR_PERF_ACCUMULATOR( SurfaceRender_ChangeGpuState );
 
-static void ChangeGpuState( const ovrGpuState oldState, const ovrGpuState newState, bool force = false )
+// glBlendFunc and glBlendEquation set the alpha factors and mode to the color ones,
+// so the alpha members of a state are only used with BLEND_ENABLE_SEPARATE.
+// The alpha members of the current state always hold what GL uses.
+static bool BlendFuncEqual( const ovrGpuState & current, const ovrGpuState & state )
+{
+	const bool separate = ( state.blendEnable == ovrGpuState::BLEND_ENABLE_SEPARATE );
+	return current.blendSrc == state.blendSrc
+		&& current.blendDst == state.blendDst
+		&& current.blendMode == state.blendMode
+		&& current.blendSrcAlpha == ( separate ? state.blendSrcAlpha : state.blendSrc )
+		&& current.blendDstAlpha == ( separate ? state.blendDstAlpha : state.blendDst )
+		&& current.blendModeAlpha == ( separate ? state.blendModeAlpha : state.blendMode );
+}
+
+// Sends the GL calls for the differences between the current and the new state
+// and makes the new state current.
+// With filter false the blend function is sent for every state that enables blending.
+static void ChangeGpuState( ovrGpuState & currentState, const ovrGpuState & newState, bool force = false, const bool filter = true )
 {
 	OVR_PERF_ACCUMULATE( SurfaceRender_ChangeGpuState );
 
-	if ( force || newState.blendEnable != oldState.blendEnable )
+	const ovrGpuState oldState = currentState;
+	currentState = newState;
+
+	if ( force || ( newState.blendEnable != ovrGpuState::BLEND_DISABLE ) != ( oldState.blendEnable != ovrGpuState::BLEND_DISABLE ) )
 	{
 		if ( newState.blendEnable )
 		{
@@ -46,14 +66,9 @@ static void ChangeGpuState( const ovrGpuState oldState, const ovrGpuState newSta
 			glDisable( GL_BLEND );
 		}
 	}
-	if ( force || newState.blendEnable != oldState.blendEnable
-			|| newState.blendSrc != oldState.blendSrc
-			|| newState.blendDst != oldState.blendDst
-			|| newState.blendSrcAlpha != oldState.blendSrcAlpha
-			|| newState.blendDstAlpha != oldState.blendDstAlpha
-			|| newState.blendMode != oldState.blendMode
-			|| newState.blendModeAlpha != oldState.blendModeAlpha
-			)
+	// The blend function doesn't matter while blending is disabled, so it is left
+	// alone until a surface enables blending with a different function.
+	if ( force || ( newState.blendEnable != ovrGpuState::BLEND_DISABLE && ( !filter || !BlendFuncEqual( oldState, newState ) ) ) )
 	{
 		if ( newState.blendEnable == ovrGpuState::BLEND_ENABLE_SEPARATE )
 		{
@@ -67,6 +82,21 @@ static void ChangeGpuState( const ovrGpuState oldState, const ovrGpuState newSta
 			glBlendEquation( newState.blendMode );
 		}
 	}
+	if ( !force && newState.blendEnable == ovrGpuState::BLEND_DISABLE )
+	{
+		currentState.blendSrc = oldState.blendSrc;
+		currentState.blendDst = oldState.blendDst;
+		currentState.blendSrcAlpha = oldState.blendSrcAlpha;
+		currentState.blendDstAlpha = oldState.blendDstAlpha;
+		currentState.blendMode = oldState.blendMode;
+		currentState.blendModeAlpha = oldState.blendModeAlpha;
+	}
+	else if ( newState.blendEnable != ovrGpuState::BLEND_ENABLE_SEPARATE )
+	{
+		currentState.blendSrcAlpha = newState.blendSrc;
+		currentState.blendDstAlpha = newState.blendDst;
+		currentState.blendModeAlpha = newState.blendMode;
+	}
 	GL_CheckErrors( "blendSrc/blendDst" );
 
 	if ( force || newState.depthFunc != oldState.depthFunc )
@@ -156,7 +186,8 @@ static void ChangeGpuState( const ovrGpuState oldState, const ovrGpuState newSta
 }
 
 ovrSurfaceRender::ovrSurfaceRender() :
-	 CurrentSceneMatricesIdx( 0 )
+	 CurrentSceneMatricesIdx( 0 ),
+	 FilterRedundantCalls( true )
 {
 }
 
@@ -182,6 +213,12 @@ void ovrSurfaceRender::Shutdown()
 	}
 }
 
+void ovrSurfaceRender::SetFilterRedundantCalls( const bool filter )
+{
+	FilterRedundantCalls = filter;
+	UniformCache.SetEnabled( filter );
+}
+
 int ovrSurfaceRender::UpdateSceneMatrices( const Matrix4f * viewMatrix,
 										   const Matrix4f * projectionMatrix,
 										   const int numViews )
@@ -238,6 +275,221 @@ int ovrSurfaceRender::UpdateSceneMatrices( const Matrix4f * viewMatrix,
 	return CurrentSceneMatricesIdx;
 }
 
+//==============================================================
+// Draw order sort keys
+
+// Positive floats sort like their bit patterns, the top 24 bits below the sign are kept.
+static uint64_t DepthBits( const float viewDepth )
+{
+	if ( !( viewDepth > 0.0f ) )
+	{
+		return 0;
+	}
+	uint32_t bits;
+	memcpy( &bits, &viewDepth, sizeof( bits ) );
+	return ( bits >> 7 ) & 0xFFFFFF;
+}
+
+// The texture a surface is grouped by: the first sampled texture.
+static unsigned int SurfaceMaterial( const ovrGraphicsCommand & cmd )
+{
+	if ( cmd.Program.UseDeprecatedInterface )
+	{
+		return ( cmd.numUniformTextures > 0 ) ? cmd.uniformTextures[0].texture : 0;
+	}
+	for ( int i = 0; i < ovrUniform::MAX_UNIFORMS; i++ )
+	{
+		if ( cmd.Program.Uniforms[i].Type == ovrProgramParmType::MAX )
+		{
+			break;
+		}
+		if ( cmd.Program.Uniforms[i].Type == ovrProgramParmType::TEXTURE_SAMPLED && cmd.UniformData[i].Data != NULL )
+		{
+			return static_cast< const GlTexture * >( cmd.UniformData[i].Data )->texture;
+		}
+	}
+	return 0;
+}
+
+uint64_t DrawSortKey( const ovrSurfaceDef & surfaceDef, const float viewDepth, const int layer )
+{
+	const ovrGraphicsCommand & cmd = surfaceDef.graphicsCommand;
+	const uint64_t program = cmd.Program.Program & 0xFFF;
+	const uint64_t material = SurfaceMaterial( cmd ) & 0xFFF;
+	const uint64_t depth = DepthBits( viewDepth );
+
+	uint64_t key = (uint64_t)( layer & 0xF ) << 60;
+	if ( cmd.GpuState.blendEnable != ovrGpuState::BLEND_DISABLE )
+	{
+		key |= (uint64_t)1 << 59;
+		key |= ( 0xFFFFFF - depth ) << 35;
+		key |= program << 23;
+		key |= material << 11;
+	}
+	else
+	{
+		key |= program << 47;
+		key |= material << 35;
+		key |= depth << 11;
+	}
+	return key;
+}
+
+// Stable LSD radix sort of indices by 64 bit keys, 8 bits per pass.
+// Passes in which all keys have the same digit are skipped, which
+// is common for the layer and blend bits.
+static void RadixSortKeys( const uint64_t * keys, const int count, int * order, int * temp )
+{
+	static const int NUM_PASSES = 8;
+	int counts[NUM_PASSES][256];
+	memset( counts, 0, sizeof( counts ) );
+	for ( int i = 0; i < count; i++ )
+	{
+		const uint64_t key = keys[i];
+		for ( int pass = 0; pass < NUM_PASSES; pass++ )
+		{
+			counts[pass][( key >> ( pass * 8 ) ) & 0xFF]++;
+		}
+		order[i] = i;
+	}
+
+	int * src = order;
+	int * dst = temp;
+	for ( int pass = 0; pass < NUM_PASSES; pass++ )
+	{
+		const int shift = pass * 8;
+		if ( counts[pass][( keys[0] >> shift ) & 0xFF] == count )
+		{
+			continue;
+		}
+		int sum = 0;
+		for ( int b = 0; b < 256; b++ )
+		{
+			const int c = counts[pass][b];
+			counts[pass][b] = sum;
+			sum += c;
+		}
+		for ( int i = 0; i < count; i++ )
+		{
+			const int index = src[i];
+			dst[counts[pass][( keys[index] >> shift ) & 0xFF]++] = index;
+		}
+		Alg::Swap( src, dst );
+	}
+	if ( src != order )
+	{
+		memcpy( order, src, count * sizeof( int ) );
+	}
+}
+
+void SortSurfaceList( Array< ovrDrawSurface > & surfaceList, const uint64_t * sortKeys, ovrSurfaceSortBuffers & buffers )
+{
+	const int count = surfaceList.GetSizeI();
+	if ( count < 2 )
+	{
+		return;
+	}
+
+	buffers.Order.Resize( count );
+	buffers.Temp.Resize( count );
+	buffers.Sorted.Resize( count );
+	RadixSortKeys( sortKeys, count, buffers.Order.GetDataPtr(), buffers.Temp.GetDataPtr() );
+
+	for ( int i = 0; i < count; i++ )
+	{
+		buffers.Sorted[i] = surfaceList[buffers.Order[i]];
+	}
+	for ( int i = 0; i < count; i++ )
+	{
+		surfaceList[i] = buffers.Sorted[i];
+	}
+}
+
+//==============================================================
+// ovrUniformShadowCache
+
+ovrUniformShadowCache::ovrUniformShadowCache() :
+	Serial( 1 ),
+	Current( -1 ),
+	Enabled( true )
+{
+}
+
+void ovrUniformShadowCache::Reset()
+{
+	Serial++;
+	Current = -1;
+}
+
+void ovrUniformShadowCache::SetProgram( const unsigned int program )
+{
+	const int * index = ProgramIndex.Get( program );
+	if ( index != NULL )
+	{
+		Current = *index;
+	}
+	else
+	{
+		Current = Programs.GetSizeI();
+		Programs.Resize( Current + 1 );
+		Programs[Current].Program = program;
+		Programs[Current].Serial = 0;
+		ProgramIndex.Add( program, Current );
+	}
+
+	ovrProgramValues & values = Programs[Current];
+	if ( values.Serial != Serial )
+	{
+		values.Serial = Serial;
+		values.ValidMask = 0;
+	}
+}
+
+bool ovrUniformShadowCache::Update( const int slot, const void * value, const int size )
+{
+	OVR_ASSERT( slot >= 0 && slot < SLOT_MAX );
+	if ( !Enabled || Current < 0 )
+	{
+		return true;
+	}
+
+	ovrProgramValues & values = Programs[Current];
+	const uint32_t bit = 1u << slot;
+	if ( size > MAX_VALUE_SIZE )
+	{
+		values.ValidMask &= ~bit;
+		return true;
+	}
+	if ( ( values.ValidMask & bit ) != 0 && values.Sizes[slot] == size && memcmp( values.Values[slot], value, size ) == 0 )
+	{
+		return false;
+	}
+	memcpy( values.Values[slot], value, size );
+	values.Sizes[slot] = static_cast< uint8_t >( size );
+	values.ValidMask |= bit;
+	return true;
+}
+
+//==============================================================
+// ovrSurfaceRender
+
+static int UniformDataSize( const ovrProgramParmType type, const int count )
+{
+	switch ( type )
+	{
+		case ovrProgramParmType::INT:			return sizeof( int );
+		case ovrProgramParmType::INT_VECTOR2:	return 2 * sizeof( int );
+		case ovrProgramParmType::INT_VECTOR3:	return 3 * sizeof( int );
+		case ovrProgramParmType::INT_VECTOR4:	return 4 * sizeof( int );
+		case ovrProgramParmType::FLOAT:			return sizeof( float );
+		case ovrProgramParmType::FLOAT_VECTOR2:	return 2 * sizeof( float );
+		case ovrProgramParmType::FLOAT_VECTOR3:	return 3 * sizeof( float );
+		case ovrProgramParmType::FLOAT_VECTOR4:	return 4 * sizeof( float );
+		case ovrProgramParmType::FLOAT_MATRIX4:	return count * sizeof( Matrix4f );
+		default:								return 0;
+	}
+}
+
 OVR_PERF_ACCUMULATOR( SurfaceRender_ChangeProgram );
 OVR_PERF_ACCUMULATOR( SurfaceRender_UpdateUniforms );
 OVR_PERF_ACCUMULATOR( SurfaceRender_geo_Draw );
@@ -258,6 +510,10 @@ ovrDrawCounters ovrSurfaceRender::RenderSurfaceList( const Array<ovrDrawSurface>
 	GLuint				currentBuffers[ ovrUniform::MAX_UNIFORMS ] = {};
 	GLuint				currentTextures[ ovrUniform::MAX_UNIFORMS ] = {};
 	GLuint				currentProgramObject = 0;
+	int					currentTextureUnit = -1;
+
+	// Other code may have changed uniforms of our programs since the last call.
+	UniformCache.Reset();
 
 	// ----DEPRECATED_DRAWEYEVIEW
 	const Matrix4f vpMatrix = eye < 0 ? projectionMatrix * viewMatrix : (&projectionMatrix)[eye] * (&viewMatrix)[eye];
@@ -265,6 +521,21 @@ ovrDrawCounters ovrSurfaceRender::RenderSurfaceList( const Array<ovrDrawSurface>
 
 	const int sceneMatricesIdx = UpdateSceneMatrices( &viewMatrix, &projectionMatrix, eye < 0 ? 1 : 2 /* num eyes */ );
 
+	const int viewId = eye < 0 ? 0 : eye;
+
+	// ----IMAGE_EXTERNAL_WORKAROUND
+	/// WORKAROUND: setting glUniformMatrix4fv transpose to GL_TRUE for an array of matrices
+	/// produces garbage using the Adreno 420 OpenGL ES 3.0 driver.
+	const int numViewMatrices = eye < 0 ? 1 : 2;
+	Matrix4f projMatrixT[2];
+	Matrix4f viewMatrixT[2];
+	for ( int j = 0; j < numViewMatrices; j++ )
+	{
+		projMatrixT[j] = (&projectionMatrix)[j].Transposed();
+		viewMatrixT[j] = (&viewMatrix)[j].Transposed();
+	}
+	// ----IMAGE_EXTERNAL_WORKAROUND
+
 	// counters
 	ovrDrawCounters counters;
 
@@ -277,8 +548,7 @@ ovrDrawCounters ovrSurfaceRender::RenderSurfaceList( const Array<ovrDrawSurface>
 
 		if ( cmd.Program.IsValid() && cmd.Program.UseDeprecatedInterface == false )
 		{
-			ChangeGpuState( currentGpuState, cmd.GpuState );
-			currentGpuState = cmd.GpuState;
+			ChangeGpuState( currentGpuState, cmd.GpuState, false, FilterRedundantCalls );
 			GL_CheckErrors( surfaceDef.surfaceName.ToCStr() );
 
 			// update the program object
@@ -289,45 +559,67 @@ ovrDrawCounters ovrSurfaceRender::RenderSurfaceList( const Array<ovrDrawSurface>
 
 				currentProgramObject = cmd.Program.Program;
 				glUseProgram( cmd.Program.Program );
+				UniformCache.SetProgram( cmd.Program.Program );
 			}
 
 			// Update globally defined system level uniforms.
 			{
 				if ( cmd.Program.ViewID.Location >= 0 )	// not defined when multiview enabled
 				{
-					glUniform1i( cmd.Program.ViewID.Location, eye < 0 ? 0 : eye );
+					if ( UniformCache.Update( ovrUniformShadowCache::SLOT_VIEW_ID, &viewId, sizeof( viewId ) ) )
+					{
+						glUniform1i( cmd.Program.ViewID.Location, viewId );
+					}
+					else
+					{
+						counters.numUniformsSkipped++;
+					}
+				}
+				if ( UniformCache.Update( ovrUniformShadowCache::SLOT_MODEL_MATRIX, &drawSurface.modelMatrix, sizeof( Matrix4f ) ) )
+				{
+					glUniformMatrix4fv( cmd.Program.ModelMatrix.Location, 1, GL_TRUE, drawSurface.modelMatrix.M[0] );
+				}
+				else
+				{
+					counters.numUniformsSkipped++;
 				}
-				glUniformMatrix4fv( cmd.Program.ModelMatrix.Location, 1, GL_TRUE, drawSurface.modelMatrix.M[0] );
 
 				if ( cmd.Program.SceneMatrices.Location >= 0 )
 				{
-					glBindBufferBase( GL_UNIFORM_BUFFER, cmd.Program.SceneMatrices.Binding, SceneMatrices[sceneMatricesIdx].GetBuffer() );
+					const GLuint sceneMatricesBuffer = SceneMatrices[sceneMatricesIdx].GetBuffer();
+					if ( !FilterRedundantCalls || currentBuffers[cmd.Program.SceneMatrices.Binding] != sceneMatricesBuffer )
+					{
+						currentBuffers[cmd.Program.SceneMatrices.Binding] = sceneMatricesBuffer;
+						glBindBufferBase( GL_UNIFORM_BUFFER, cmd.Program.SceneMatrices.Binding, sceneMatricesBuffer );
+					}
+					else
+					{
+						counters.numBindsSkipped++;
+					}
 				}
 
 				// ----IMAGE_EXTERNAL_WORKAROUND
 				if ( cmd.Program.ProjectionMatrix.Location >= 0 )
 				{
-					/// WORKAROUND: setting glUniformMatrix4fv transpose to GL_TRUE for an array of matrices
-					/// produces garbage using the Adreno 420 OpenGL ES 3.0 driver.
-					static Matrix4f projMatrixT[2];
-					const int numMatrices = eye < 0 ? 1 : 2;
-					for ( int j = 0; j < numMatrices; j++ )
+					if ( UniformCache.Update( ovrUniformShadowCache::SLOT_PROJECTION_MATRIX, projMatrixT, numViewMatrices * sizeof( Matrix4f ) ) )
+					{
+						glUniformMatrix4fv( cmd.Program.ProjectionMatrix.Location, numViewMatrices, GL_FALSE, projMatrixT[0].M[0] );
+					}
+					else
 					{
-						projMatrixT[j] = (&projectionMatrix)[j].Transposed();
+						counters.numUniformsSkipped++;
 					}
-					glUniformMatrix4fv( cmd.Program.ProjectionMatrix.Location, eye < 0 ? 1 : 2, GL_FALSE, projMatrixT[0].M[0] );
 				}
 				if ( cmd.Program.ViewMatrix.Location >= 0 )
 				{
-					/// WORKAROUND: setting glUniformMatrix4fv transpose to GL_TRUE for an array of matrices
-					/// produces garbage using the Adreno 420 OpenGL ES 3.0 driver.
-					static Matrix4f viewMatrixT[2];
-					const int numMatrices = eye < 0 ? 1 : 2;
-					for ( int j = 0; j < numMatrices; j++ )
+					if ( UniformCache.Update( ovrUniformShadowCache::SLOT_VIEW_MATRIX, viewMatrixT, numViewMatrices * sizeof( Matrix4f ) ) )
 					{
-						viewMatrixT[j] = (&viewMatrix)[j].Transposed();
+						glUniformMatrix4fv( cmd.Program.ViewMatrix.Location, numViewMatrices, GL_FALSE, viewMatrixT[0].M[0] );
+					}
+					else
+					{
+						counters.numUniformsSkipped++;
 					}
-					glUniformMatrix4fv( cmd.Program.ViewMatrix.Location, eye < 0 ? 1 : 2, GL_FALSE, viewMatrixT[0].M[0] );
 				}
 				// ----IMAGE_EXTERNAL_WORKAROUND
 			}
@@ -342,6 +634,15 @@ ovrDrawCounters ovrSurfaceRender::RenderSurfaceList( const Array<ovrDrawSurface>
 					counters.numParameterUpdates++;
 					const int parmLocation = cmd.Program.Uniforms[i].Location;
 
+					// skip values the program already has
+					if ( parmLocation >= 0 && cmd.UniformData[i].Data != NULL &&
+						cmd.Program.Uniforms[i].Type < ovrProgramParmType::TEXTURE_SAMPLED &&
+						!UniformCache.Update( i, cmd.UniformData[i].Data, UniformDataSize( cmd.Program.Uniforms[i].Type, cmd.UniformData[i].Count ) ) )
+					{
+						counters.numUniformsSkipped++;
+						continue;
+					}
+
 					switch( cmd.Program.Uniforms[i].Type )
 					{
 						case ovrProgramParmType::INT:
@@ -453,9 +754,21 @@ ovrDrawCounters ovrSurfaceRender::RenderSurfaceList( const Array<ovrDrawSurface>
 								{
 									counters.numTextureBinds++;
 									currentTextures[parmBinding] = texture.texture;
-									glActiveTexture( GL_TEXTURE0 + parmBinding );
+									if ( !FilterRedundantCalls || currentTextureUnit != parmBinding )
+									{
+										currentTextureUnit = parmBinding;
+										glActiveTexture( GL_TEXTURE0 + parmBinding );
+									}
+									else
+									{
+										counters.numBindsSkipped++;
+									}
 									glBindTexture( texture.target ? texture.target : GL_TEXTURE_2D, texture.texture );
 								}
+								else
+								{
+									counters.numBindsSkipped++;
+								}
 							}
 						}
 						break;
@@ -471,6 +784,10 @@ ovrDrawCounters ovrSurfaceRender::RenderSurfaceList( const Array<ovrDrawSurface>
 									currentBuffers[parmBinding] = buffer.GetBuffer();
 									glBindBufferBase( GL_UNIFORM_BUFFER, parmBinding, buffer.GetBuffer() );
 								}
+								else
+								{
+									counters.numBindsSkipped++;
+								}
 							}
 						}
 						break;
@@ -490,8 +807,7 @@ ovrDrawCounters ovrSurfaceRender::RenderSurfaceList( const Array<ovrDrawSurface>
 			Matrix4f mvp = vpMatrix * drawSurface.modelMatrix;
 
 			// Update GPU state -- blending, etc
-			ChangeGpuState( currentGpuState, cmd.GpuState );
-			currentGpuState = cmd.GpuState;
+			ChangeGpuState( currentGpuState, cmd.GpuState, false, FilterRedundantCalls );
 			GL_CheckErrors( surfaceDef.surfaceName.ToCStr() );
 
 			// Update texture bindings
@@ -503,11 +819,23 @@ ovrDrawCounters ovrSurfaceRender::RenderSurfaceList( const Array<ovrDrawSurface>
 				{
 					counters.numTextureBinds++;
 					currentTextures[textureNum] = texNObj;
-					glActiveTexture( GL_TEXTURE0 + textureNum );
+					if ( !FilterRedundantCalls || currentTextureUnit != textureNum )
+					{
+						currentTextureUnit = textureNum;
+						glActiveTexture( GL_TEXTURE0 + textureNum );
+					}
+					else
+					{
+						counters.numBindsSkipped++;
+					}
 					// Something is leaving target set to 0; assume GL_TEXTURE_2D
 					glBindTexture( cmd.uniformTextures[textureNum].target ?
 							cmd.uniformTextures[textureNum].target : GL_TEXTURE_2D, texNObj );
 				}
+				else
+				{
+					counters.numBindsSkipped++;
+				}
 			}
 			GL_CheckErrors( surfaceDef.surfaceName.ToCStr() );
 
@@ -521,6 +849,7 @@ ovrDrawCounters ovrSurfaceRender::RenderSurfaceList( const Array<ovrDrawSurface>
 
 					currentProgramObject = cmd.Program.Program;
 					glUseProgram( currentProgramObject );
+					UniformCache.SetProgram( currentProgramObject );
 				}
 			}
 			GL_CheckErrors( surfaceDef.surfaceName.ToCStr() );
@@ -534,39 +863,60 @@ ovrDrawCounters ovrSurfaceRender::RenderSurfaceList( const Array<ovrDrawSurface>
 				{
 					if ( cmd.Program.ViewID.Location >= 0 ) // not defined when multiview enabled
 					{
-						glUniform1i( cmd.Program.ViewID.Location, eye < 0 ? 0 : eye );
+						if ( UniformCache.Update( ovrUniformShadowCache::SLOT_VIEW_ID, &viewId, sizeof( viewId ) ) )
+						{
+							glUniform1i( cmd.Program.ViewID.Location, viewId );
+						}
+						else
+						{
+							counters.numUniformsSkipped++;
+						}
+					}
+					if ( UniformCache.Update( ovrUniformShadowCache::SLOT_MODEL_MATRIX, &drawSurface.modelMatrix, sizeof( Matrix4f ) ) )
+					{
+						glUniformMatrix4fv( cmd.Program.ModelMatrix.Location, 1, GL_TRUE, drawSurface.modelMatrix.M[0] );
+					}
+					else
+					{
+						counters.numUniformsSkipped++;
 					}
-					glUniformMatrix4fv( cmd.Program.ModelMatrix.Location, 1, GL_TRUE, drawSurface.modelMatrix.M[0] );
 
 					if ( cmd.Program.SceneMatrices.Location >= 0 )
 					{
-						glBindBufferBase( GL_UNIFORM_BUFFER, cmd.Program.SceneMatrices.Binding, SceneMatrices[sceneMatricesIdx].GetBuffer() );
+						const GLuint sceneMatricesBuffer = SceneMatrices[sceneMatricesIdx].GetBuffer();
+						if ( !FilterRedundantCalls || currentBuffers[cmd.Program.SceneMatrices.Binding] != sceneMatricesBuffer )
+						{
+							currentBuffers[cmd.Program.SceneMatrices.Binding] = sceneMatricesBuffer;
+							glBindBufferBase( GL_UNIFORM_BUFFER, cmd.Program.SceneMatrices.Binding, sceneMatricesBuffer );
+						}
+						else
+						{
+							counters.numBindsSkipped++;
+						}
 					}
 
 					// ----IMAGE_EXTERNAL_WORKAROUND
 					if ( cmd.Program.ProjectionMatrix.Location >= 0 )
 					{
-						/// WORKAROUND: setting glUniformMatrix4fv transpose to GL_TRUE for an array of matrices
-						/// produces garbage using the Adreno 420 OpenGL ES 3.0 driver.
-						static Matrix4f projMatrixT[2];
-						const int numMatrices = eye < 0 ? 1 : 2;
-						for ( int j = 0; j < numMatrices; j++ )
+						if ( UniformCache.Update( ovrUniformShadowCache::SLOT_PROJECTION_MATRIX, projMatrixT, numViewMatrices * sizeof( Matrix4f ) ) )
 						{
-							projMatrixT[j] = (&projectionMatrix)[j].Transposed();
+							glUniformMatrix4fv( cmd.Program.ProjectionMatrix.Location, numViewMatrices, GL_FALSE, projMatrixT[0].M[0] );
+						}
+						else
+						{
+							counters.numUniformsSkipped++;
 						}
-						glUniformMatrix4fv( cmd.Program.ProjectionMatrix.Location, eye < 0 ? 1 : 2, GL_FALSE, projMatrixT[0].M[0] );
 					}
 					if ( cmd.Program.ViewMatrix.Location >= 0 )
 					{
-						/// WORKAROUND: setting glUniformMatrix4fv transpose to GL_TRUE for an array of matrices
-						/// produces garbage using the Adreno 420 OpenGL ES 3.0 driver.
-						static Matrix4f viewMatrixT[2];
-						const int numMatrices = eye < 0 ? 1 : 2;
-						for ( int j = 0; j < numMatrices; j++ )
+						if ( UniformCache.Update( ovrUniformShadowCache::SLOT_VIEW_MATRIX, viewMatrixT, numViewMatrices * sizeof( Matrix4f ) ) )
 						{
-							viewMatrixT[j] = (&viewMatrix)[j].Transposed();
+							glUniformMatrix4fv( cmd.Program.ViewMatrix.Location, numViewMatrices, GL_FALSE, viewMatrixT[0].M[0] );
+						}
+						else
+						{
+							counters.numUniformsSkipped++;
 						}
-						glUniformMatrix4fv( cmd.Program.ViewMatrix.Location, eye < 0 ? 1 : 2, GL_FALSE, viewMatrixT[0].M[0] );
 					}
 					// ----IMAGE_EXTERNAL_WORKAROUND
 				}
@@ -574,13 +924,27 @@ ovrDrawCounters ovrSurfaceRender::RenderSurfaceList( const Array<ovrDrawSurface>
 				// FIXME: get rid of the MVP and transform vertices with the individial model/view/projection matrices for improved precision
 				if ( cmd.Program.uMvp != -1 )
 				{
-					glUniformMatrix4fv( cmd.Program.uMvp, 1, GL_TRUE, &mvp.M[0][0] );
+					if ( UniformCache.Update( ovrUniformShadowCache::SLOT_DEPRECATED_MVP, &mvp, sizeof( mvp ) ) )
+					{
+						glUniformMatrix4fv( cmd.Program.uMvp, 1, GL_TRUE, &mvp.M[0][0] );
+					}
+					else
+					{
+						counters.numUniformsSkipped++;
+					}
 				}
 
 				// set the model matrix
 				if ( cmd.Program.uModel != -1 )
 				{
-					glUniformMatrix4fv( cmd.Program.uModel, 1, GL_TRUE, &drawSurface.modelMatrix.M[0][0] );
+					if ( UniformCache.Update( ovrUniformShadowCache::SLOT_DEPRECATED_MODEL, &drawSurface.modelMatrix, sizeof( Matrix4f ) ) )
+					{
+						glUniformMatrix4fv( cmd.Program.uModel, 1, GL_TRUE, &drawSurface.modelMatrix.M[0][0] );
+					}
+					else
+					{
+						counters.numUniformsSkipped++;
+					}
 				}
 
 				// set the joint matrices ubo
@@ -594,6 +958,10 @@ ovrDrawCounters ovrSurfaceRender::RenderSurfaceList( const Array<ovrDrawSurface>
 						currentBuffers[cmd.Program.uJointsBinding] = bufferObj;
 						glBindBufferBase( GL_UNIFORM_BUFFER, cmd.Program.uJointsBinding, bufferObj );
 					}
+					else
+					{
+						counters.numBindsSkipped++;
+					}
 				}
 			}
 			GL_CheckErrors( surfaceDef.surfaceName.ToCStr() );
@@ -608,7 +976,18 @@ ovrDrawCounters ovrSurfaceRender::RenderSurfaceList( const Array<ovrDrawSurface>
 						break;
 					}
 					counters.numParameterUpdates++;
-					glUniform4fv( slot, 1, cmd.uniformValues[unif] );
+					// the slot is part of the value, commands with the same program can order their slots differently
+					GLfloat slotValue[5];
+					memcpy( slotValue, &slot, sizeof( GLfloat ) );
+					memcpy( slotValue + 1, cmd.uniformValues[unif], 4 * sizeof( GLfloat ) );
+					if ( UniformCache.Update( ovrUniformShadowCache::SLOT_DEPRECATED_VALUES + unif, slotValue, sizeof( slotValue ) ) )
+					{
+						glUniform4fv( slot, 1, cmd.uniformValues[unif] );
+					}
+					else
+					{
+						counters.numUniformsSkipped++;
+					}
 				}
 			}
 			GL_CheckErrors( surfaceDef.surfaceName.ToCStr() );
@@ -13,6 +13,8 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 #include "FolderBrowser.h"
 
 #include "Kernel/OVR_Threads.h"
+#include "Kernel/OVR_SysFile.h"
+#include "Kernel/OVR_MemBuffer.h"
 #include <stdio.h>
 #include "App.h"
 #include "VRMenuMgr.h"
@@ -23,6 +25,7 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 #include "Kernel/OVR_String_Utils.h"
 #include "stb_image.h"
 #include "PackageFiles.h"
+#include "ImageData.h"
 #include "AnimComponents.h"
 #include "VrCommon.h"
 #include "VRMenuObject.h"
@@ -775,6 +778,7 @@ OvrFolderBrowser::OvrFolderBrowser(
 	, AllowPanelTouchUp( false )
 	, TextureCommands( 10000 )
 	, BackgroundCommands( 10000 )
+	, ThumbnailLoader( guiSys.GetApp()->GetTextureLoader() )
 	, ControllerDirectionLock( NO_LOCK )
 	, LastControllerInputTimeStamp( 0.0f )
 	, IsTouchDownPosistionTracked( false )
@@ -868,6 +872,18 @@ OvrFolderBrowser::~OvrFolderBrowser()
 	ThumbnailThreadCondition.NotifyAll();
 	ThumbnailThreadMutex.Unlock();
 	BackgroundCommands.ClearMessages();
+
+	// a texture that was uploaded but not picked up yet belongs to us
+	for ( int i = 0; i < ThumbnailUploads.GetSizeI(); ++i )
+	{
+		if ( ThumbnailLoader->GetState( ThumbnailUploads[i].Request ) == ASYNC_TEXTURE_READY )
+		{
+			GlTexture texId = ThumbnailLoader->GetTexture( ThumbnailUploads[i].Request );
+			DeleteTexture( texId );
+		}
+		ThumbnailLoader->FreeRequest( ThumbnailUploads[i].Request );
+	}
+	ThumbnailUploads.Resize( 0 );
 	
 	int numFolders = Folders.GetSizeI();
 	for ( int i = 0; i < numFolders; ++i )
@@ -907,9 +923,10 @@ void OvrFolderBrowser::Frame_Impl( OvrGuiSys & guiSys, ovrFrameInput const & vrF
 		}
 
 		//LOG( "TextureCommands: %s", cmd );
-		LoadThumbnailToTexture( guiSys, cmd );
+		QueueThumbnailUpload( cmd );
 		free( ( void * )cmd );
 	}
+	UpdateThumbnailUploads( guiSys );
 
 	// --
 	// Logic for restricted scrolling
@@ -1580,13 +1597,29 @@ threadReturn_t OvrFolderBrowser::ThumbnailThread( Thread *thread, void * v )
 
 						const String fullPath( fileName );
 
+						// a cached thumbnail is read and decoded by the texture loader
+						String cacheName;
+						if ( folderBrowser->IsThumbnailCached( fileName, cacheName ) )
+						{
+							folderBrowser->TextureCommands.PostPrintf( "cached %i %i:%s",
+								folderId, panelId, cacheName.ToCStr() );
+							free( ( void * )msg );
+							continue;
+						}
+
+						ovrThumbnailImage * thumbnail = NULL;
 						int		width;
 						int		height;
 						unsigned char * data = folderBrowser->LoadThumbnail( fileName, width, height );
 						if ( data != NULL )
 						{
-							folderBrowser->TextureCommands.PostPrintf( "thumb %i %i %p %i %i",
-								folderId, panelId, data, width, height );
+							thumbnail = folderBrowser->CompressThumbnail( data, width, height, fileName );
+						}
+
+						if ( thumbnail != NULL )
+						{
+							folderBrowser->TextureCommands.PostPrintf( "thumb %i %i %p",
+								folderId, panelId, thumbnail );
 						}
 						else
 						{
@@ -1626,10 +1659,12 @@ threadReturn_t OvrFolderBrowser::ThumbnailThread( Thread *thread, void * v )
 							width,
 							height );
 
-						if ( data != NULL )
+						ovrThumbnailImage * thumbnail = ( data != NULL ) ?
+								folderBrowser->CompressThumbnail( data, width, height, cacheDestination ) : NULL;
+						if ( thumbnail != NULL )
 						{
-							folderBrowser->TextureCommands.PostPrintf( "thumb %i %i %p %i %i",
-								folderId, panelId, data, width, height );
+							folderBrowser->TextureCommands.PostPrintf( "thumb %i %i %p",
+								folderId, panelId, thumbnail );
 						}
 						else
 						{
@@ -1649,35 +1684,151 @@ threadReturn_t OvrFolderBrowser::ThumbnailThread( Thread *thread, void * v )
 	}
 }
 
+//==============================================================
+// ovrThumbnailImage
+// A thumbnail ready for upload, handed from the thumbnail thread to the GL thread.
+struct ovrThumbnailImage
+{
+	ovrTextureImage			Image;	// owns its data
+};
+
+String OvrFolderBrowser::ThumbCacheName( const char * thumbnailFile ) const
+{
+	const size_t hash = String::BernsteinHashFunction( thumbnailFile, OVR_strlen( thumbnailFile ) );
+	char cacheName[ 1024 ];
+	OVR_sprintf( cacheName, sizeof( cacheName ), "%sthumbcache/%08x_%ix%i.ktx", AppCachePath.ToCStr(),
+			static_cast< unsigned >( hash ), ThumbWidth, ThumbHeight );
+	return String( cacheName );
+}
+
+bool OvrFolderBrowser::IsThumbnailCached( const char * thumbnailFile, String & cacheName ) const
+{
+	cacheName = ThumbCacheName( thumbnailFile );
+
+	// the cache is stale if the thumbnail was replaced after it was written
+	FileStat cacheStat;
+	FileStat sourceStat;
+	return SysFile::GetFileStat( &cacheStat, cacheName ) &&
+		!( SysFile::GetFileStat( &sourceStat, String( thumbnailFile ) ) && sourceStat.ModifyTime > cacheStat.ModifyTime );
+}
+
+ovrThumbnailImage * OvrFolderBrowser::CompressThumbnail( unsigned char * rgba, const int width, const int height,
+		const char * thumbnailFile ) const
+{
+	if ( !ApplyThumbAntialiasing( rgba, width, height ) )
+	{
+		WARN( "OvrFolderBrowser::CompressThumbnail Failed to apply AA to %s", thumbnailFile );
+	}
+
+	ovrThumbnailImage * thumbnail = new ovrThumbnailImage;
+	ovrTextureImage & image = thumbnail->Image;
+	image.Width = width;
+	image.Height = height;
+	image.NumFaces = 1;
+	image.UseSrgbFormat = true;
+
+	// the alpha channel carries the panel anti-aliasing, so keep it
+	int mipCount = 0;
+	size_t size = 0;
+	uint8_t * compressed = CompressMipChainETC2( rgba, width, height, true, true, 1, mipCount, size );
+	if ( compressed == NULL )
+	{
+		// upload uncompressed and let GL build the mips
+		image.Format = Texture_RGBA;
+		image.MipCount = 1;
+		image.GenerateMipmaps = true;
+		image.OwnedData = rgba;
+		image.Data = rgba;
+		image.DataSize = static_cast< size_t >( width ) * height * 4;
+		return thumbnail;
+	}
+	free( rgba );
+
+	image.Format = Texture_ETC2_RGBA;
+	image.MipCount = mipCount;
+	image.OwnedData = compressed;
+	image.Data = compressed;
+	image.DataSize = size;
+
+	const String cacheName = ThumbCacheName( thumbnailFile );
+	MakePath( cacheName.ToCStr(), permissionFlags_t( PERMISSION_WRITE ) | PERMISSION_READ );
+	WriteTextureKTX( cacheName.ToCStr(), image );
+
+	return thumbnail;
+}
+
+void OvrFolderBrowser::QueueThumbnailUpload( const char * thumbnailCommand )
+{
+	ovrThumbnailUpload upload;
+	upload.FolderId = -1;
+	upload.PanelId = -1;
+	upload.Cached = MatchesHead( "cached ", thumbnailCommand );
+	if ( upload.Cached )
+	{
+		sscanf( thumbnailCommand, "cached %i %i", &upload.FolderId, &upload.PanelId );
+		const char * cacheName = strstr( thumbnailCommand, ":" ) + 1;
+		upload.Request = ThumbnailLoader->LoadTextureFromFile( cacheName, TextureFlags_t( TEXTUREFLAG_USE_SRGB ) );
+	}
+	else
+	{
+		ovrThumbnailImage * thumbnail;
+		sscanf( thumbnailCommand, "thumb %i %i %p", &upload.FolderId, &upload.PanelId, &thumbnail );
+		upload.Request = ThumbnailLoader->LoadTextureFromImage( "thumbnail", thumbnail->Image );
+		delete thumbnail;
+	}
+	ThumbnailUploads.PushBack( upload );
+}
+
+void OvrFolderBrowser::UpdateThumbnailUploads( OvrGuiSys & guiSys )
+{
+	for ( int i = 0; i < ThumbnailUploads.GetSizeI(); )
+	{
+		const ovrThumbnailUpload upload = ThumbnailUploads[i];
+		const ovrAsyncTextureState state = ThumbnailLoader->GetState( upload.Request );
+		if ( state == ASYNC_TEXTURE_PENDING )
+		{
+			i++;
+			continue;
+		}
+		GlTexture texId = ( state == ASYNC_TEXTURE_READY ) ? ThumbnailLoader->GetTexture( upload.Request ) : GlTexture();
+		ThumbnailLoader->FreeRequest( upload.Request );
+		ThumbnailUploads.RemoveAt( i );
+
+		if ( texId.IsValid() && upload.Cached && ( texId.Width != ThumbWidth || texId.Height != ThumbHeight ) )
+		{
+			WARN( "OvrFolderBrowser::UpdateThumbnailUploads cached thumbnail is %ix%i", texId.Width, texId.Height );
+			DeleteTexture( texId );
+		}
+		if ( !texId.IsValid() )
+		{
+			continue;
+		}
+		SetPanelThumbnail( guiSys, upload.FolderId, upload.PanelId, texId );
+	}
+}
+
 // THUMBFIX: call this to load final thumbnail onto the panel
-void OvrFolderBrowser::LoadThumbnailToTexture( OvrGuiSys & guiSys, const char * thumbnailCommand )
-{	
-	int folderId;
-	int panelId;
-	unsigned char * data;
-	int width;
-	int height;
-
-	sscanf( thumbnailCommand, "thumb %i %i %p %i %i", &folderId, &panelId, &data, &width, &height );
+void OvrFolderBrowser::SetPanelThumbnail( OvrGuiSys & guiSys, const int folderId, const int panelId, GlTexture texId )
+{
 	if ( folderId < 0 || panelId < 0 )
 	{
-		delete data;
+		DeleteTexture( texId );
 		return;
 	}
 
 	FolderView * folder = GetFolderView( folderId );
 	if ( folder == NULL )
 	{
-		WARN( "OvrFolderBrowser::LoadThumbnailToTexture failed to find FolderView at %i", folderId );
-		free( data );
+		WARN( "OvrFolderBrowser::SetPanelThumbnail failed to find FolderView at %i", folderId );
+		DeleteTexture( texId );
 		return;
 	}
 
 	Array<PanelView*> * panels = &folder->Panels;
 	if ( panels == NULL )
 	{
-		WARN( "OvrFolderBrowser::LoadThumbnailToTexture failed to get panels array from folder" );
-		free( data );
+		WARN( "OvrFolderBrowser::SetPanelThumbnail failed to get panels array from folder" );
+		DeleteTexture( texId );
 		return;
 	}
 
@@ -1697,35 +1848,23 @@ void OvrFolderBrowser::LoadThumbnailToTexture( OvrGuiSys & guiSys, const char *
 
 	if ( panel == NULL ) // Panel not found as it was moved. Delete data and bail
 	{
-		WARN( "OvrFolderBrowser::LoadThumbnailToTexture failed to find panel id %d in folder %d", panelId, folderId );
-		free( data );
+		WARN( "OvrFolderBrowser::SetPanelThumbnail failed to find panel id %d in folder %d", panelId, folderId );
+		DeleteTexture( texId );
 		return;
 	}
 
-	if ( !ApplyThumbAntialiasing( data, width, height ) )
-	{
-		WARN( "OvrFolderBrowser::LoadThumbnailToTexture Failed to apply AA to %s", thumbnailCommand );
-	}
-
 	// Grab the Panel from VRMenu
 	menuHandle_t thumbHandle = panel->GetThumbnailHandle();
 	VRMenuObject * panelObject = guiSys.GetVRMenuMgr().ToObject( thumbHandle );
 	OVR_ASSERT( panelObject );
 
-	GlTexture texId = LoadRGBATextureFromMemory( data, width, height, true /* srgb */ );
-	free( data );
+	panelObject->SetSurfaceTexture( 0, 0, SURFACE_TEXTURE_DIFFUSE,
+		texId, ThumbWidth, ThumbHeight );
 
-	if ( texId )
-	{
-		panelObject->SetSurfaceTexture( 0, 0, SURFACE_TEXTURE_DIFFUSE,
-			texId, ThumbWidth, ThumbHeight );
-
-		panel->TextureId = texId;
+	panel->TextureId = texId;
 
-		BuildTextureMipmaps( texId );
-		MakeTextureTrilinear( texId );
-		MakeTextureClamped( texId );
-	}
+	MakeTextureTrilinear( texId );
+	MakeTextureClamped( texId );
 }
 
 void OvrFolderBrowser::LoadFolderViewPanels( OvrGuiSys & guiSys, const OvrMetaData & metaData, const OvrMetaData::Category & category, const int folderIndex, FolderView & folder,
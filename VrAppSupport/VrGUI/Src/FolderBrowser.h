@@ -19,6 +19,7 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 #include "ScrollManager.h"
 #include "Kernel/OVR_Lockless.h"
 #include "VRMenuComponent.h"
+#include "OVR_TextureLoader.h"
 
 namespace OVR {
 
@@ -27,6 +28,7 @@ class OvrFolderSwipeComponent;
 class OvrFolderBrowserSwipeComponent;
 class OvrDefaultComponent;
 class OvrPanel_OnUp;
+struct ovrThumbnailImage;
 
 //==============================================================
 // OvrFolderBrowser
@@ -272,7 +274,18 @@ protected:
 
 private:
 	static threadReturn_t		ThumbnailThread( Thread * thread, void * v );
-	void				LoadThumbnailToTexture( OvrGuiSys & guiSys, const char * thumbnailCommand );
+	// Thumbnails are uploaded through the app's texture loader, a few per frame.
+	void				QueueThumbnailUpload( const char * thumbnailCommand );
+	void				UpdateThumbnailUploads( OvrGuiSys & guiSys );
+	void				SetPanelThumbnail( OvrGuiSys & guiSys, const int folderId, const int panelId, GlTexture texId );
+
+	// Thumbnails are kept in the app cache as ETC2 compressed .ktx files with mips,
+	// so they only have to be decoded and compressed once. Called on the thumbnail thread.
+	String				ThumbCacheName( const char * thumbnailFile ) const;
+	bool				IsThumbnailCached( const char * thumbnailFile, String & cacheName ) const;
+	// Takes ownership of rgba.
+	ovrThumbnailImage *	CompressThumbnail( unsigned char * rgba, const int width, const int height,
+								const char * thumbnailFile ) const;
 
 	friend class OvrPanel_OnUp;
 	void				OnPanelUp( OvrGuiSys & guiSys, const OvrMetaDatum * data );
@@ -334,6 +347,16 @@ private:
 	ovrMessageQueue		TextureCommands;
 	ovrMessageQueue		BackgroundCommands;
 
+	struct ovrThumbnailUpload
+	{
+		int						FolderId;
+		int						PanelId;
+		bool					Cached;		// loaded from the thumbnail cache, the size is checked
+		asyncTextureHandle_t	Request;
+	};
+	ovrTextureLoader *			ThumbnailLoader;
+	Array< ovrThumbnailUpload >	ThumbnailUploads;
+
 	enum eThumbnailThreadState
 	{
 		THUMBNAIL_THREAD_WORK,
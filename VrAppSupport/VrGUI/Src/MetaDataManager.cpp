@@ -59,11 +59,11 @@ void OvrMetaData::InitFromDirectory( const char * relativePath, const Array< Str
 
 	LOG( "OvrMetaData start category: %s", currentCategory.CategoryTag.ToCStr() );
 	Array< String > subDirs;
+	Array< String > looseFiles;
 	// Grab the categories and loose files
 	for ( int i = 0; i < fileList.GetSizeI(); i++ )
 	{
 		const String & s = fileList[ i ];
-		const String fileBase = ExtractFileBase( s );
 		// subdirectory - add category
 		if ( MatchesExtension( s.ToCStr(), "/" ) )
 		{
@@ -76,6 +76,17 @@ void OvrMetaData::InitFromDirectory( const char * relativePath, const Array< Str
 		{
 			continue;
 		}
+		looseFiles.PushBack( s );
+	}
+
+	// Resolve all loose files at once, they are mostly in the same few folders.
+	Array< String > fullPaths;
+	GetFullPaths( searchPaths, looseFiles, fullPaths );
+
+	for ( int i = 0; i < looseFiles.GetSizeI(); i++ )
+	{
+		const String & s = looseFiles[ i ];
+		const String fileBase = ExtractFileBase( s );
 
 		// Add loose file
 		const int dataIndex = MetaData.GetSizeI();
@@ -84,8 +95,9 @@ void OvrMetaData::InitFromDirectory( const char * relativePath, const Array< Str
 		{
 			datum->Id = dataIndex;
 			datum->Tags.PushBack( currentCategory.CategoryTag );
-			if ( GetFullPath( searchPaths, s.ToCStr(), datum->Url ) )
+			if ( !fullPaths[ i ].IsEmpty() )
 			{
+				datum->Url = fullPaths[ i ];
 				StringHash< int >::ConstIterator iter = UrlToIndex.FindCaseInsensitive( datum->Url );
 				if ( iter == UrlToIndex.End() )
 				{
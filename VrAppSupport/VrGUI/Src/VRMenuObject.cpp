@@ -1340,11 +1340,14 @@ Bounds3f VRMenuObject::GetTextLocalBounds( BitmapFont const & font ) const
 	{
 		TextDirty = false;
 
-		// word-wrap the text if wrapping is specified
-		if ( FontParms.WrapWidth >= 0.0f )
+		// word-wrap the text if wrapping is specified. The layout is always updated so
+		// the metrics can be read from it.
+		bool const wrap = FontParms.WrapWidth >= 0.0f;
+		font.WordWrapText( TextWrap, Text.ToCStr(), wrap ? FontParms.WrapWidth * localScale.x * textLocalScale.x : -1.0f,
+				localScale.x * textLocalScale.x * FontParms.Scale );
+		if ( wrap )
 		{
-
-			font.WordWrapText( Text, FontParms.WrapWidth * localScale.x * textLocalScale.x, localScale.x * textLocalScale.x * FontParms.Scale );
+			Text = TextWrap.GetWrappedText();
 		}
 
 		// also union the text bounds
@@ -1360,7 +1363,7 @@ Bounds3f VRMenuObject::GetTextLocalBounds( BitmapFont const & font ) const
 			int requestedLines = Alg::Clamp( FontParms.MaxLines, 1, 16 );
 			int numLines = 0;			
 
-			font.CalcTextMetrics( Text.ToCStr(), len, TextMetrics.w, TextMetrics.h,
+			font.CalcTextMetrics( TextWrap, len, TextMetrics.w, TextMetrics.h,
 					TextMetrics.ascent, TextMetrics.descent, TextMetrics.fontHeight, lineWidths, requestedLines, numLines );
 
 			// for the time being if we exceed the number of lines we truncate the last few lines and add a ... 
@@ -1126,6 +1126,7 @@ private:
 	Vector3f					MaxsBoundsExpand;	// amount to expand local bounds maxs
 	mutable Bounds3f			CullBounds;			// bounds of this object and all its children in the local space of its parent
     mutable textMetrics_t       TextMetrics;		// cached metrics for the text
+	mutable ovrTextWrapCache	TextWrap;			// line layout of the text, re-flowed incrementally on edits
 
 	struct ovrTextSurface
 	{
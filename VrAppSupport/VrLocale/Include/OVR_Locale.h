@@ -73,6 +73,16 @@ public:
 	// been loaded. The name is only an identifier used for error reporting.
 	virtual bool			AddStringsFromAndroidFormatXMLBuffer( char const * name, char const * buffer, size_t const size ) = 0;
 
+	// loads a string table compiled from strings.xml files by StringTableCompiler. Tables are
+	// mapped in place when the file is local. Strings in tables are found before strings
+	// added from XML files, and earlier tables are searched before later ones.
+	virtual bool			LoadStringTable( ovrFileSys & fileSys, char const * fileName ) = 0;
+
+	// returns the localized string for a key, with or without the "@string/" prefix, or NULL if
+	// no loaded table or XML file has the key. Unlike GetString, this never allocates and never
+	// falls back to the Android resources. The string remains valid as long as the locale.
+	virtual char const *	FindString( char const * key ) const = 0;
+
 	// returns the localized string associated with the passed key. Returns false if the
 	// key was not found. If the key was not found, out will be set to the defaultStr.
 	virtual bool			GetString( char const * key, char const * defaultStr, String & out ) const = 0;
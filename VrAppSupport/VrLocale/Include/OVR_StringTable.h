@@ -0,0 +1,138 @@
+/************************************************************************************
+
+Filename    :   OVR_StringTable.h
+Content     :   Compiled string tables with a minimal perfect hash.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+This source code is licensed under the BSD-style license found in the
+LICENSE file in the Oculus360Photos/ directory. An additional grant
+of patent rights can be found in the PATENTS file in the same directory.
+
+************************************************************************************/
+
+#if !defined( OVR_STRINGTABLE_H_ )
+#define OVR_STRINGTABLE_H_
+
+#include <stdint.h>
+#include "Kernel/OVR_Array.h"
+#include "Kernel/OVR_Hash.h"
+#include "Kernel/OVR_String.h"
+#include "Kernel/OVR_MemBuffer.h"
+
+namespace OVR {
+
+// The file is the header followed by the displacements, the entries and the
+// NUL terminated key and value characters. All offsets are in bytes from the
+// start of the file and all sections are 4 byte aligned, so a table can be
+// used in place from a mapped file. Little endian.
+static const uint32_t	STRING_TABLE_MAGIC		= 0x4254534f;	// "OSTB"
+static const uint32_t	STRING_TABLE_VERSION	= 1;
+
+struct ovrStringTableHeader
+{
+	uint32_t	Magic;
+	uint32_t	Version;
+	uint32_t	NumStrings;
+	uint32_t	NumBuckets;
+	uint32_t	DisplacementOffset;		// int32_t[NumBuckets]
+	uint32_t	EntryOffset;			// ovrStringTableEntry[NumStrings]
+	uint32_t	CharOffset;
+	uint32_t	CharSize;				// the last character is a NUL
+};
+
+struct ovrStringTableEntry
+{
+	uint32_t	KeyOffset;				// from CharOffset
+	uint32_t	KeyLength;
+	uint32_t	ValueOffset;			// from CharOffset
+	uint32_t	ValueLength;
+};
+
+//==============================================================
+// ovrStringTable
+//
+// A string table compiled from Android strings.xml files, see
+// ovrStringTableBuilder. The key of a string selects a bucket, and the bucket's
+// displacement selects the entry, so a lookup is at most two hashes and one
+// key compare and never allocates. Loading maps or reads the file and checks
+// the offsets; nothing is parsed or inserted.
+class ovrStringTable
+{
+public:
+						ovrStringTable();
+						~ovrStringTable();
+
+	// Maps a local file.
+	bool				Open( char const * fileName );
+	// Takes ownership of a table that was read into memory.
+	bool				Load( char const * name, MemBufferT< uint8_t > & buffer );
+	void				Close();
+
+	// Returns the value for a key without the "@string/" prefix, or NULL.
+	char const *		Find( char const * key, size_t const keyLength ) const;
+	char const *		Find( char const * key ) const;
+
+	int					GetNumStrings() const { return Header != NULL ? (int)Header->NumStrings : 0; }
+	char const *		GetKey( const int index ) const;
+	char const *		GetValue( const int index ) const;
+
+	// The hash of a key for a displacement, 0 for the bucket.
+	static uint32_t		Hash( const uint32_t seed, char const * key, size_t const keyLength );
+
+private:
+	MemBufferT< uint8_t >			Buffer;
+	void *							Mapping;
+	size_t							MappingSize;
+	ovrStringTableHeader const *	Header;
+	int32_t const *					Displacements;
+	ovrStringTableEntry const *		Entries;
+	char const *					Chars;
+
+	bool				Validate( char const * name, uint8_t const * data, size_t const size );
+};
+
+//==============================================================
+// ovrStringTableBuilder
+//
+// Collects the strings of Android strings.xml files and writes a table for
+// ovrStringTable. As with ovrLocale, the first string added for a key wins.
+// A string whose whole value is a "@string/" reference to another key gets the
+// value of that key, the way the Android resource compiler resolves it.
+class ovrStringTableBuilder
+{
+public:
+	// Decodes the strings of a strings.xml buffer the same way ovrLocale does.
+	static bool			ParseAndroidFormatXML( char const * name, char const * buffer, size_t const size,
+								Array< String > & keys, Array< String > & values );
+
+	bool				AddAndroidFormatXML( char const * name, char const * buffer, size_t const size );
+	void				AddString( char const * key, char const * value );
+
+	int					GetNumStrings() const { return Keys.GetSizeI(); }
+
+	// Builds the table into a buffer, or writes it to a file.
+	bool				Build( MemBufferT< uint8_t > & outBuffer ) const;
+	bool				Write( char const * fileName ) const;
+
+private:
+	// Looks up the keys without copying them into a String.
+	struct KeyHashFunctor
+	{
+		size_t operator()( const String & key ) const { return String::BernsteinHashFunction( key.ToCStr(), key.GetSize() ); }
+		size_t operator()( char const * key ) const { return String::BernsteinHashFunction( key, OVR_strlen( key ) ); }
+	};
+
+	Array< String >		Keys;
+	Array< String >		Values;
+	Hash< String, int, KeyHashFunctor >	KeyIndex;
+
+	int					FindKey( char const * key ) const;
+	void				ResolveReferences( Array< String > & values ) const;
+};
+
+} // namespace OVR
+
+#endif // OVR_STRINGTABLE_H_
@@ -19,6 +19,7 @@ LOCAL_C_INCLUDES := $(LOCAL_PATH)/../../../Include
 LOCAL_EXPORT_C_INCLUDES := $(LOCAL_PATH)/../../../Include
 
 LOCAL_SRC_FILES := 	../../../Src/OVR_Locale.cpp \
+					../../../Src/OVR_StringTable.cpp \
 					../../../Src/tinyxml2.cpp
 
 LOCAL_STATIC_LIBRARIES := vrappframework
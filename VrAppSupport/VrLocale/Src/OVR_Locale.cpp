@@ -14,10 +14,10 @@ of patent rights can be found in the PATENTS file in the same directory.
 ************************************************************************************/
 
 #include "OVR_Locale.h"
+#include "OVR_StringTable.h"
 
 #include <sys/stat.h>
 
-#include "tinyxml2.h"
 #include "Kernel/OVR_Types.h"
 #include "Kernel/OVR_Array.h"
 #include "Kernel/OVR_Hash.h"
@@ -57,6 +57,11 @@ public:
 	{
 		return DJB2Hash( data.ToCStr() );
 	}
+	// allows looking up a key with GetAlt() without copying it into a String
+	UPInt operator()( char const * data ) const
+	{
+		return DJB2Hash( data );
+	}
 };
 
 //==============================================================
@@ -85,6 +90,10 @@ public:
 
 	virtual bool			AddStringsFromAndroidFormatXMLBuffer( char const * name, char const * buffer, size_t const size );
 
+	virtual bool			LoadStringTable( ovrFileSys & fileSys, char const * fileName );
+
+	virtual char const *	FindString( char const * key ) const;
+
 	virtual bool			GetString( char const * key, char const * defaultStr, String & out ) const;
 
 	virtual void			ReplaceLocalizedText( char const * inText, char * out, size_t const outSize ) const;
@@ -101,6 +110,7 @@ private:
 	String									LanguageCode;	// system-specific locale name
 	OVR::Hash< String, int, HashFunctor >	StringHash;
 	Array< String	>						Strings;
+	Array< ovrStringTable * >				StringTables;
 
 private:
 #if defined( OVR_OS_ANDROID )
@@ -108,6 +118,9 @@ private:
 #endif
 };
 
+// a value can reference a string that is itself a reference, but not indefinitely
+static const int MAX_REFERENCE_DEPTH = 16;
+
 char const *	ovrLocaleInternal::LOCALIZED_KEY_PREFIX = "@string/";
 OVR::UPInt		ovrLocaleInternal::LOCALIZED_KEY_PREFIX_LEN = OVR_strlen( LOCALIZED_KEY_PREFIX );
 
@@ -133,6 +146,11 @@ ovrLocaleInternal::ovrLocaleInternal( char const * name, char const * languageCo
 // ovrLocaleInternal::~ovrLocaleInternal
 ovrLocaleInternal::~ovrLocaleInternal()
 {
+	for ( int i = 0; i < StringTables.GetSizeI(); i++ )
+	{
+		delete StringTables[i];
+	}
+	StringTables.Clear();
 }
 
 //==============================
@@ -147,127 +165,26 @@ bool ovrLocaleInternal::IsSystemDefaultLocale() const
 #endif
 }
 
-static void GetValueFromNode( String & v, tinyxml2::XMLNode const * node )
-{
-	tinyxml2::XMLNode const * child = node->FirstChild();
-	if ( child != nullptr )
-	{
-		GetValueFromNode( v, child );
-	}
-	else
-	{
-		v += node->Value();
-	}
-	tinyxml2::XMLNode const * sib = node->NextSibling();
-	if ( sib != nullptr )
-	{
-		GetValueFromNode( v, sib );
-	}
-}
-
 //==============================
 // ovrLocaleInternal::AddStringsFromAndroidFormatXMLBuffer
 bool ovrLocaleInternal::AddStringsFromAndroidFormatXMLBuffer( char const * name, char const * buffer, size_t const size )
 {
-	tinyxml2::XMLDocument doc;
-	tinyxml2::XMLError error = doc.Parse( buffer, size );
-	if ( error != tinyxml2::XML_NO_ERROR )
+	// the string table compiler decodes with the same function, so compiled tables match
+	Array< String > keys;
+	Array< String > values;
+	if ( !ovrStringTableBuilder::ParseAndroidFormatXML( name, buffer, size, keys, values ) )
 	{
-		LOG( "ERROR: XML parse error %i parsing '%s'!", error, name );
 		return false;
 	}
 
-	tinyxml2::XMLElement * root = doc.RootElement();
-	if ( OVR_stricmp( root->Value(), "resources" ) != 0 )
+	for ( int i = 0; i < keys.GetSizeI(); i++ )
 	{
-		LOG( "ERROR: Expected root value of 'resources', found '%s'!\n", root->Value() );
-		return false;
-	}
-
-	tinyxml2::XMLElement const * curElement = root->FirstChildElement();
-	for ( ; curElement != NULL; curElement = curElement->NextSiblingElement() )
-	{
-		if ( OVR_stricmp( curElement->Value(), "string" ) != 0 )
-		{
-			LOG( "WARNING: Expected element value 'string', found '%s'!\n", curElement->Value() );
-			continue;
-		}
-
-		tinyxml2::XMLAttribute const * nameAttr = curElement->FindAttribute( "name" );
-
-		String key = nameAttr->Value();
-
-		String value;
-		String decodedValue;
-
-		tinyxml2::XMLNode const * childNode = curElement->FirstChild();
-		if ( childNode != nullptr )
-		{
-			GetValueFromNode( value, childNode );
-		}
-		else
-		{
-			value = curElement->GetText();
-		}
-
-		// fix special encodings. Use GetFirstCharAt() and GetNextChar() to handle UTF-8.
-		const char * in = value.ToCStr();
-		uint32_t curChar = UTF8Util::DecodeNextChar( &in );
-		while( curChar != 0 )
-		{
-			if ( curChar == '\\' )
-			{
-				uint32_t nextChar = UTF8Util::DecodeNextChar( &in );
-				if ( nextChar == 0 )
-				{
-					break;
-				}
-				else if ( nextChar == 'n' )
-				{
-					curChar = '\n';
-				}
-				else if ( nextChar == '\r' )
-				{
-					curChar = '\r';
-				}
-				else 
-				{
-					if ( nextChar != '<' &&
-					 nextChar != '>' &&
-					 nextChar != '"' &&
-					 nextChar != '\'' &&
-					 nextChar != '&' )
-					{
-						LOG( "Unknown escape sequence '\\%x'", nextChar );
-						decodedValue.AppendChar( curChar );
-					}
-					curChar = nextChar;
-				}
-			}
-			else if ( curChar == '%' )
-			{
-				// if we find "%%", skip over the second '%' char because the localization pipeline bot is erroneously 
-				// outputting doubled % format specifiers.
-				const char * prev = in;
-				uint32_t nextChar = UTF8Util::DecodeNextChar( &in );
-				if ( nextChar != '%' )
-				{
-					// if it wasn't a double '%', then don't skip the next character
-					in = prev;
-				}
-			}
-
-			decodedValue.AppendChar( curChar );
-
-			curChar = UTF8Util::DecodeNextChar( &in );
-		}
-		//LOG( "Name: '%s' = '%s'\n", key.ToCStr(), value.ToCStr() );
-
+		//LOG( "Name: '%s' = '%s'\n", keys[i].ToCStr(), values[i].ToCStr() );
 		int index = -1;
-		if ( !StringHash.Get( key, &index ) )
+		if ( !StringHash.Get( keys[i], &index ) )
 		{
-			StringHash.Add( key, Strings.GetSizeI() );
-			Strings.PushBack( decodedValue );
+			StringHash.Add( keys[i], Strings.GetSizeI() );
+			Strings.PushBack( values[i] );
 		}
 	}
 
@@ -288,6 +205,70 @@ bool ovrLocaleInternal::LoadStringsFromAndroidFormatXMLFile( ovrFileSys & fileSy
 	return AddStringsFromAndroidFormatXMLBuffer( fileName, reinterpret_cast< char const * > ( static_cast< uint8_t const * >( buffer) ), buffer.GetSize() );
 }
 
+//==============================
+// ovrLocaleInternal::LoadStringTable
+bool ovrLocaleInternal::LoadStringTable( ovrFileSys & fileSys, char const * fileName )
+{
+	ovrStringTable * table = new ovrStringTable();
+
+	// map the table in place if it is a local file, otherwise read it from the package
+	String localPath;
+	bool loaded = fileSys.GetLocalPathForURI( fileName, localPath ) && table->Open( localPath.ToCStr() );
+	if ( !loaded )
+	{
+		MemBufferT< uint8_t > buffer;
+		loaded = fileSys.ReadFile( fileName, buffer ) && table->Load( fileName, buffer );
+	}
+	if ( !loaded )
+	{
+		delete table;
+		return false;
+	}
+
+	StringTables.PushBack( table );
+	LOG( "Loaded %i strings from '%s'", table->GetNumStrings(), fileName );
+	return true;
+}
+
+//==============================
+// ovrLocaleInternal::FindString
+char const * ovrLocaleInternal::FindString( char const * key ) const
+{
+	if ( key == NULL )
+	{
+		return NULL;
+	}
+	char const * realKey = strncmp( key, LOCALIZED_KEY_PREFIX, LOCALIZED_KEY_PREFIX_LEN ) == 0 ? key + LOCALIZED_KEY_PREFIX_LEN : key;
+	size_t const realKeyLen = OVR_strlen( realKey );
+
+	for ( int i = 0; i < StringTables.GetSizeI(); i++ )
+	{
+		char const * value = StringTables[i]->Find( realKey, realKeyLen );
+		if ( value != NULL )
+		{
+			return value;
+		}
+	}
+
+	int const * index = StringHash.GetAlt( realKey );
+	if ( index == NULL )
+	{
+		return NULL;
+	}
+	// resolve a value that is only a reference to another string, as the compiled tables do
+	String const * value = &Strings[*index];
+	for ( int depth = 0; depth < MAX_REFERENCE_DEPTH && strncmp( value->ToCStr(), LOCALIZED_KEY_PREFIX, LOCALIZED_KEY_PREFIX_LEN ) == 0; depth++ )
+	{
+		int const * next = StringHash.GetAlt( value->ToCStr() + LOCALIZED_KEY_PREFIX_LEN );
+		if ( next == NULL )
+		{
+			break;
+		}
+		value = &Strings[*next];
+	}
+	return value->ToCStr();
+}
+
 #if defined( OVR_OS_ANDROID )
 //==============================
 // ovrLocale::GetStringJNI
@@ -354,15 +335,11 @@ bool ovrLocaleInternal::GetString( char const * key, char const * defaultStr, St
 
 	if ( strstr( key, LOCALIZED_KEY_PREFIX ) == key )
 	{
-		if ( Strings.GetSizeI() > 0 )
+		char const * value = FindString( key );
+		if ( value != NULL )
 		{
-			String realKey( key + LOCALIZED_KEY_PREFIX_LEN );
-			int index = -1;
-			if ( StringHash.Get( realKey, &index ) )
-			{
-				out = Strings[index];
-				return true;
-			}
+			out = value;
+			return true;
 		}
 	}
 #if defined( OVR_OS_ANDROID )
@@ -433,12 +410,18 @@ void ovrLocaleInternal::ReplaceLocalizedText( char const * inText, char * out, s
 		cur += ofs;
 		last = cur;
 
-		// get the localized text
-		String localized;
-		GetString( atString, atString, localized );
+		// get the localized text, only going through GetString for the keys that
+		// have to be looked up in the Android resources
+		char const * localized = FindString( atString );
+		String resourceString;
+		if ( localized == NULL )
+		{
+			GetString( atString, atString, resourceString );
+			localized = resourceString.ToCStr();
+		}
 
 		// copy localized text into the output buffer
-		if ( !CopyChars( out, outSize, outOfs, localized.ToCStr(), OVR_strlen( localized.ToCStr() ) ) )
+		if ( !CopyChars( out, outSize, outOfs, localized, OVR_strlen( localized ) ) )
 		{
 			return;
 		}
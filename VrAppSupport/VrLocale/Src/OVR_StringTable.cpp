@@ -0,0 +1,635 @@
+/************************************************************************************
+
+Filename    :   OVR_StringTable.cpp
+Content     :   Compiled string tables with a minimal perfect hash.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+This source code is licensed under the BSD-style license found in the
+LICENSE file in the Oculus360Photos/ directory. An additional grant
+of patent rights can be found in the PATENTS file in the same directory.
+
+************************************************************************************/
+
+#include "OVR_StringTable.h"
+
+#include <stdio.h>
+#include <string.h>
+#if !defined( OVR_OS_WIN32 )
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "tinyxml2.h"
+#include "Kernel/OVR_Std.h"
+#include "Kernel/OVR_Alg.h"
+#include "Kernel/OVR_Hash.h"
+#include "Kernel/OVR_UTF8Util.h"
+#include "Kernel/OVR_LogUtils.h"
+
+namespace OVR {
+
+static char const *	STRING_KEY_PREFIX = "@string/";
+static size_t const	STRING_KEY_PREFIX_LEN = 8;
+
+// Displacements are tried in increasing order until the keys of a bucket all
+// land in free slots. Buckets are placed largest first, so this is only reached
+// by a table that can not be built.
+static const int32_t MAX_DISPLACEMENT = 1 << 24;
+
+// A reference can point to another reference, but not indefinitely.
+static const int MAX_REFERENCE_DEPTH = 16;
+
+static inline uint32_t Align4( const uint32_t x )
+{
+	return ( x + 3 ) & ~3u;
+}
+
+//==============================================================
+// ovrStringTable
+
+//==============================
+// ovrStringTable::ovrStringTable
+ovrStringTable::ovrStringTable()
+	: Mapping( NULL )
+	, MappingSize( 0 )
+	, Header( NULL )
+	, Displacements( NULL )
+	, Entries( NULL )
+	, Chars( NULL )
+{
+}
+
+//==============================
+// ovrStringTable::~ovrStringTable
+ovrStringTable::~ovrStringTable()
+{
+	Close();
+}
+
+//==============================
+// ovrStringTable::Hash
+// FNV-1a with the seed mixed into the basis and a final avalanche, so that the
+// hashes for different seeds are independent enough to displace a bucket.
+uint32_t ovrStringTable::Hash( const uint32_t seed, char const * key, size_t const keyLength )
+{
+	uint32_t h = 2166136261u ^ ( seed * 0x9E3779B9u );
+	for ( size_t i = 0; i < keyLength; i++ )
+	{
+		h = ( h ^ (uint8_t)key[i] ) * 16777619u;
+	}
+	h ^= h >> 16;
+	h *= 0x85EBCA6Bu;
+	h ^= h >> 13;
+	h *= 0xC2B2AE35u;
+	h ^= h >> 16;
+	return h;
+}
+
+//==============================
+// ovrStringTable::Validate
+// Checks every offset once so lookups never have to.
+bool ovrStringTable::Validate( char const * name, uint8_t const * data, size_t const size )
+{
+	if ( size < sizeof( ovrStringTableHeader ) )
+	{
+		WARN( "String table '%s' is truncated", name );
+		return false;
+	}
+	ovrStringTableHeader const * header = reinterpret_cast< ovrStringTableHeader const * >( data );
+	if ( header->Magic != STRING_TABLE_MAGIC || header->Version != STRING_TABLE_VERSION )
+	{
+		WARN( "'%s' is not a version %d string table", name, STRING_TABLE_VERSION );
+		return false;
+	}
+	const uint64_t displacementEnd = (uint64_t)header->DisplacementOffset + (uint64_t)header->NumBuckets * sizeof( int32_t );
+	const uint64_t entryEnd = (uint64_t)header->EntryOffset + (uint64_t)header->NumStrings * sizeof( ovrStringTableEntry );
+	const uint64_t charEnd = (uint64_t)header->CharOffset + header->CharSize;
+	if ( ( header->DisplacementOffset & 3 ) != 0 || ( header->EntryOffset & 3 ) != 0 ||
+			displacementEnd > size || entryEnd > size || charEnd > size ||
+			( header->NumStrings > 0 && header->NumBuckets == 0 ) ||
+			header->CharSize == 0 || data[header->CharOffset + header->CharSize - 1] != '\0' )
+	{
+		WARN( "String table '%s' is corrupt", name );
+		return false;
+	}
+
+	int32_t const * displacements = reinterpret_cast< int32_t const * >( data + header->DisplacementOffset );
+	for ( uint32_t i = 0; i < header->NumBuckets; i++ )
+	{
+		if ( displacements[i] < 0 && (uint32_t)( -(int64_t)displacements[i] - 1 ) >= header->NumStrings )
+		{
+			WARN( "String table '%s' has a bad displacement", name );
+			return false;
+		}
+	}
+
+	char const * chars = reinterpret_cast< char const * >( data + header->CharOffset );
+	ovrStringTableEntry const * entries = reinterpret_cast< ovrStringTableEntry const * >( data + header->EntryOffset );
+	for ( uint32_t i = 0; i < header->NumStrings; i++ )
+	{
+		const ovrStringTableEntry & e = entries[i];
+		if ( (uint64_t)e.KeyOffset + e.KeyLength >= header->CharSize || chars[e.KeyOffset + e.KeyLength] != '\0' ||
+				(uint64_t)e.ValueOffset + e.ValueLength >= header->CharSize || chars[e.ValueOffset + e.ValueLength] != '\0' )
+		{
+			WARN( "String table '%s' has a bad entry", name );
+			return false;
+		}
+	}
+
+	Header = header;
+	Displacements = displacements;
+	Entries = entries;
+	Chars = chars;
+	return true;
+}
+
+//==============================
+// ovrStringTable::Open
+bool ovrStringTable::Open( char const * fileName )
+{
+	Close();
+#if defined( OVR_OS_WIN32 )
+	FILE * f = fopen( fileName, "rb" );
+	if ( f == NULL )
+	{
+		return false;
+	}
+	fseek( f, 0, SEEK_END );
+	const long size = ftell( f );
+	fseek( f, 0, SEEK_SET );
+	MemBufferT< uint8_t > buffer( size > 0 ? size : 0 );
+	const bool read = size > 0 && fread( buffer, size, 1, f ) == 1;
+	fclose( f );
+	return read && Load( fileName, buffer );
+#else
+	const int fd = open( fileName, O_RDONLY );
+	if ( fd < 0 )
+	{
+		return false;
+	}
+	struct stat st;
+	if ( fstat( fd, &st ) != 0 || st.st_size <= 0 )
+	{
+		close( fd );
+		return false;
+	}
+	void * mapping = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close( fd );
+	if ( mapping == MAP_FAILED )
+	{
+		WARN( "Failed to map string table '%s'", fileName );
+		return false;
+	}
+	Mapping = mapping;
+	MappingSize = st.st_size;
+	if ( !Validate( fileName, static_cast< uint8_t const * >( mapping ), MappingSize ) )
+	{
+		Close();
+		return false;
+	}
+	return true;
+#endif
+}
+
+//==============================
+// ovrStringTable::Load
+bool ovrStringTable::Load( char const * name, MemBufferT< uint8_t > & buffer )
+{
+	Close();
+	Buffer = buffer;
+	if ( !Validate( name, Buffer, Buffer.GetSize() ) )
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+//==============================
+// ovrStringTable::Close
+void ovrStringTable::Close()
+{
+#if !defined( OVR_OS_WIN32 )
+	if ( Mapping != NULL )
+	{
+		munmap( Mapping, MappingSize );
+	}
+#endif
+	Mapping = NULL;
+	MappingSize = 0;
+	MemBufferT< uint8_t > empty;
+	Buffer = empty;
+	Header = NULL;
+	Displacements = NULL;
+	Entries = NULL;
+	Chars = NULL;
+}
+
+//==============================
+// ovrStringTable::Find
+char const * ovrStringTable::Find( char const * key, size_t const keyLength ) const
+{
+	if ( Header == NULL || Header->NumStrings == 0 )
+	{
+		return NULL;
+	}
+	const int32_t d = Displacements[Hash( 0, key, keyLength ) % Header->NumBuckets];
+	if ( d == 0 )
+	{
+		return NULL;
+	}
+	const uint32_t slot = d < 0 ? (uint32_t)( -d - 1 ) : Hash( d, key, keyLength ) % Header->NumStrings;
+	const ovrStringTableEntry & e = Entries[slot];
+	if ( e.KeyLength != keyLength || memcmp( Chars + e.KeyOffset, key, keyLength ) != 0 )
+	{
+		return NULL;
+	}
+	return Chars + e.ValueOffset;
+}
+
+//==============================
+// ovrStringTable::Find
+char const * ovrStringTable::Find( char const * key ) const
+{
+	return Find( key, OVR_strlen( key ) );
+}
+
+//==============================
+// ovrStringTable::GetKey
+char const * ovrStringTable::GetKey( const int index ) const
+{
+	OVR_ASSERT( index >= 0 && index < GetNumStrings() );
+	return Chars + Entries[index].KeyOffset;
+}
+
+//==============================
+// ovrStringTable::GetValue
+char const * ovrStringTable::GetValue( const int index ) const
+{
+	OVR_ASSERT( index >= 0 && index < GetNumStrings() );
+	return Chars + Entries[index].ValueOffset;
+}
+
+//==============================================================
+// ovrStringTableBuilder
+
+static void GetValueFromNode( String & v, tinyxml2::XMLNode const * node )
+{
+	tinyxml2::XMLNode const * child = node->FirstChild();
+	if ( child != nullptr )
+	{
+		GetValueFromNode( v, child );
+	}
+	else
+	{
+		v += node->Value();
+	}
+	tinyxml2::XMLNode const * sib = node->NextSibling();
+	if ( sib != nullptr )
+	{
+		GetValueFromNode( v, sib );
+	}
+}
+
+//==============================
+// ovrStringTableBuilder::ParseAndroidFormatXML
+bool ovrStringTableBuilder::ParseAndroidFormatXML( char const * name, char const * buffer, size_t const size,
+		Array< String > & keys, Array< String > & values )
+{
+	tinyxml2::XMLDocument doc;
+	tinyxml2::XMLError error = doc.Parse( buffer, size );
+	if ( error != tinyxml2::XML_NO_ERROR )
+	{
+		LOG( "ERROR: XML parse error %i parsing '%s'!", error, name );
+		return false;
+	}
+
+	tinyxml2::XMLElement * root = doc.RootElement();
+	if ( OVR_stricmp( root->Value(), "resources" ) != 0 )
+	{
+		LOG( "ERROR: Expected root value of 'resources', found '%s'!\n", root->Value() );
+		return false;
+	}
+
+	tinyxml2::XMLElement const * curElement = root->FirstChildElement();
+	for ( ; curElement != NULL; curElement = curElement->NextSiblingElement() )
+	{
+		if ( OVR_stricmp( curElement->Value(), "string" ) != 0 )
+		{
+			LOG( "WARNING: Expected element value 'string', found '%s'!\n", curElement->Value() );
+			continue;
+		}
+
+		tinyxml2::XMLAttribute const * nameAttr = curElement->FindAttribute( "name" );
+		if ( nameAttr == NULL )
+		{
+			LOG( "WARNING: 'string' element without a name in '%s'!\n", name );
+			continue;
+		}
+
+		String value;
+		String decodedValue;
+
+		tinyxml2::XMLNode const * childNode = curElement->FirstChild();
+		if ( childNode != nullptr )
+		{
+			GetValueFromNode( value, childNode );
+		}
+		else
+		{
+			value = curElement->GetText();
+		}
+
+		// fix special encodings. Use GetFirstCharAt() and GetNextChar() to handle UTF-8.
+		const char * in = value.ToCStr();
+		uint32_t curChar = UTF8Util::DecodeNextChar( &in );
+		while( curChar != 0 )
+		{
+			if ( curChar == '\\' )
+			{
+				uint32_t nextChar = UTF8Util::DecodeNextChar( &in );
+				if ( nextChar == 0 )
+				{
+					break;
+				}
+				else if ( nextChar == 'n' )
+				{
+					curChar = '\n';
+				}
+				else if ( nextChar == '\r' )
+				{
+					curChar = '\r';
+				}
+				else
+				{
+					if ( nextChar != '<' &&
+					 nextChar != '>' &&
+					 nextChar != '"' &&
+					 nextChar != '\'' &&
+					 nextChar != '&' )
+					{
+						LOG( "Unknown escape sequence '\\%x'", nextChar );
+						decodedValue.AppendChar( curChar );
+					}
+					curChar = nextChar;
+				}
+			}
+			else if ( curChar == '%' )
+			{
+				// if we find "%%", skip over the second '%' char because the localization pipeline bot is erroneously
+				// outputting doubled % format specifiers.
+				const char * prev = in;
+				uint32_t nextChar = UTF8Util::DecodeNextChar( &in );
+				if ( nextChar != '%' )
+				{
+					// if it wasn't a double '%', then don't skip the next character
+					in = prev;
+				}
+			}
+
+			decodedValue.AppendChar( curChar );
+
+			curChar = UTF8Util::DecodeNextChar( &in );
+		}
+
+		keys.PushBack( nameAttr->Value() );
+		values.PushBack( decodedValue );
+	}
+
+	return true;
+}
+
+//==============================
+// ovrStringTableBuilder::FindKey
+int ovrStringTableBuilder::FindKey( char const * key ) const
+{
+	int index = -1;
+	KeyIndex.GetAlt( key, &index );
+	return index;
+}
+
+//==============================
+// ovrStringTableBuilder::AddString
+void ovrStringTableBuilder::AddString( char const * key, char const * value )
+{
+	if ( FindKey( key ) < 0 )
+	{
+		KeyIndex.Add( key, Keys.GetSizeI() );
+		Keys.PushBack( key );
+		Values.PushBack( value );
+	}
+}
+
+//==============================
+// ovrStringTableBuilder::AddAndroidFormatXML
+bool ovrStringTableBuilder::AddAndroidFormatXML( char const * name, char const * buffer, size_t const size )
+{
+	Array< String > keys;
+	Array< String > values;
+	if ( !ParseAndroidFormatXML( name, buffer, size, keys, values ) )
+	{
+		return false;
+	}
+	for ( int i = 0; i < keys.GetSizeI(); i++ )
+	{
+		AddString( keys[i].ToCStr(), values[i].ToCStr() );
+	}
+	return true;
+}
+
+//==============================
+// ovrStringTableBuilder::ResolveReferences
+void ovrStringTableBuilder::ResolveReferences( Array< String > & values ) const
+{
+	values = Values;
+	for ( int i = 0; i < values.GetSizeI(); i++ )
+	{
+		int index = i;
+		for ( int depth = 0; depth < MAX_REFERENCE_DEPTH; depth++ )
+		{
+			char const * value = Values[index].ToCStr();
+			if ( strncmp( value, STRING_KEY_PREFIX, STRING_KEY_PREFIX_LEN ) != 0 )
+			{
+				break;
+			}
+			const int next = FindKey( value + STRING_KEY_PREFIX_LEN );
+			if ( next < 0 )
+			{
+				break;
+			}
+			index = next;
+		}
+		if ( strncmp( Values[index].ToCStr(), STRING_KEY_PREFIX, STRING_KEY_PREFIX_LEN ) == 0 &&
+				FindKey( Values[index].ToCStr() + STRING_KEY_PREFIX_LEN ) >= 0 )
+		{
+			WARN( "String '%s' has a circular reference", Keys[i].ToCStr() );
+			continue;
+		}
+		values[i] = Values[index];
+	}
+}
+
+//==============================
+// ovrStringTableBuilder::Build
+// Hash and displace: every key hashes to one of NumBuckets buckets. Starting
+// with the largest bucket, each bucket searches for the displacement that
+// rehashes all of its keys to free slots. Single key buckets then take the
+// remaining slots directly, stored as -slot - 1, and empty buckets keep 0 so a
+// missing key usually fails before touching an entry.
+bool ovrStringTableBuilder::Build( MemBufferT< uint8_t > & outBuffer ) const
+{
+	const int numStrings = Keys.GetSizeI();
+	const int numBuckets = numStrings > 0 ? numStrings : 1;
+
+	Array< String > values;
+	ResolveReferences( values );
+
+	// bucket the keys
+	Array< Array< int > > buckets;
+	buckets.Resize( numBuckets );
+	for ( int i = 0; i < numStrings; i++ )
+	{
+		buckets[ovrStringTable::Hash( 0, Keys[i].ToCStr(), Keys[i].GetSize() ) % numBuckets].PushBack( i );
+	}
+	Array< int > order;
+	order.Resize( numBuckets );
+	for ( int i = 0; i < numBuckets; i++ )
+	{
+		order[i] = i;
+	}
+	Alg::QuickSortSliced( order, 0, order.GetSize(), [&buckets]( const int a, const int b )
+		{
+			return buckets[a].GetSizeI() > buckets[b].GetSizeI() ||
+					( buckets[a].GetSizeI() == buckets[b].GetSizeI() && a < b );
+		} );
+
+	Array< int32_t > displacements;
+	displacements.Resize( numBuckets );
+	memset( displacements.GetDataPtr(), 0, numBuckets * sizeof( int32_t ) );
+	Array< int > slotKeys;
+	slotKeys.Resize( numStrings );
+	for ( int i = 0; i < numStrings; i++ )
+	{
+		slotKeys[i] = -1;
+	}
+
+	Array< uint32_t > slots;
+	int o = 0;
+	for ( ; o < numBuckets && buckets[order[o]].GetSizeI() > 1; o++ )
+	{
+		const Array< int > & bucket = buckets[order[o]];
+		int32_t d = 1;
+		for ( ; d < MAX_DISPLACEMENT; d++ )
+		{
+			slots.Clear();
+			bool fits = true;
+			for ( int k = 0; k < bucket.GetSizeI() && fits; k++ )
+			{
+				const String & key = Keys[bucket[k]];
+				const uint32_t slot = ovrStringTable::Hash( d, key.ToCStr(), key.GetSize() ) % numStrings;
+				fits = slotKeys[slot] < 0;
+				for ( int s = 0; s < slots.GetSizeI() && fits; s++ )
+				{
+					fits = slots[s] != slot;
+				}
+				slots.PushBack( slot );
+			}
+			if ( fits )
+			{
+				break;
+			}
+		}
+		if ( d == MAX_DISPLACEMENT )
+		{
+			WARN( "Could not place a bucket of %d strings", bucket.GetSizeI() );
+			return false;
+		}
+		for ( int k = 0; k < bucket.GetSizeI(); k++ )
+		{
+			slotKeys[slots[k]] = bucket[k];
+		}
+		displacements[order[o]] = d;
+	}
+	int freeSlot = 0;
+	for ( ; o < numBuckets && buckets[order[o]].GetSizeI() == 1; o++ )
+	{
+		while ( slotKeys[freeSlot] >= 0 )
+		{
+			freeSlot++;
+		}
+		slotKeys[freeSlot] = buckets[order[o]][0];
+		displacements[order[o]] = -freeSlot - 1;
+	}
+
+	// lay out the file
+	ovrStringTableHeader header;
+	header.Magic = STRING_TABLE_MAGIC;
+	header.Version = STRING_TABLE_VERSION;
+	header.NumStrings = numStrings;
+	header.NumBuckets = numBuckets;
+	header.DisplacementOffset = Align4( sizeof( ovrStringTableHeader ) );
+	header.EntryOffset = header.DisplacementOffset + numBuckets * sizeof( int32_t );
+	header.CharOffset = header.EntryOffset + numStrings * sizeof( ovrStringTableEntry );
+	header.CharSize = 1;
+	for ( int i = 0; i < numStrings; i++ )
+	{
+		header.CharSize += Keys[i].GetSize() + 1 + values[i].GetSize() + 1;
+	}
+
+	outBuffer.Realloc( Align4( header.CharOffset + header.CharSize ) );
+	uint8_t * data = outBuffer;
+	memset( data, 0, outBuffer.GetSize() );
+	memcpy( data, &header, sizeof( header ) );
+	memcpy( data + header.DisplacementOffset, displacements.GetDataPtr(), numBuckets * sizeof( int32_t ) );
+
+	ovrStringTableEntry * entries = reinterpret_cast< ovrStringTableEntry * >( data + header.EntryOffset );
+	char * chars = reinterpret_cast< char * >( data + header.CharOffset );
+	uint32_t charOffset = 0;
+	for ( int slot = 0; slot < numStrings; slot++ )
+	{
+		const String & key = Keys[slotKeys[slot]];
+		const String & value = values[slotKeys[slot]];
+		ovrStringTableEntry & e = entries[slot];
+		e.KeyOffset = charOffset;
+		e.KeyLength = (uint32_t)key.GetSize();
+		memcpy( chars + charOffset, key.ToCStr(), e.KeyLength + 1 );
+		charOffset += e.KeyLength + 1;
+		e.ValueOffset = charOffset;
+		e.ValueLength = (uint32_t)value.GetSize();
+		memcpy( chars + charOffset, value.ToCStr(), e.ValueLength + 1 );
+		charOffset += e.ValueLength + 1;
+	}
+	chars[charOffset] = '\0';
+	return true;
+}
+
+//==============================
+// ovrStringTableBuilder::Write
+bool ovrStringTableBuilder::Write( char const * fileName ) const
+{
+	MemBufferT< uint8_t > buffer;
+	if ( !Build( buffer ) )
+	{
+		return false;
+	}
+	FILE * f = fopen( fileName, "wb" );
+	if ( f == NULL )
+	{
+		WARN( "Failed to open '%s' for writing", fileName );
+		return false;
+	}
+	const bool written = fwrite( static_cast< uint8_t * >( buffer ), buffer.GetSize(), 1, f ) == 1;
+	if ( fclose( f ) != 0 || !written )
+	{
+		WARN( "Failed to write '%s'", fileName );
+		return false;
+	}
+	return true;
+}
+
+} // namespace OVR
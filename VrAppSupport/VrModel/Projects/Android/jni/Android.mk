@@ -24,6 +24,8 @@ LOCAL_SRC_FILES := 	../../../Src/ModelFile.cpp \
 					../../../Src/ModelCollision.cpp \
 					../../../Src/ModelTrace.cpp \
 					../../../Src/ModelRender.cpp \
+					../../../Src/ModelAnimation.cpp \
+					../../../Src/ModelAssetCache.cpp \
 					../../../Src/SceneView.cpp
 
 LOCAL_STATIC_LIBRARIES := vrappframework
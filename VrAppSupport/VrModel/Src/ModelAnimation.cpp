@@ -0,0 +1,351 @@
+/************************************************************************************
+
+Filename    :   ModelAnimation.cpp
+Content     :   Evaluation of the procedural joint animations of models.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include "ModelAnimation.h"
+
+#include <math.h>
+#include <string.h>
+#include "Kernel/OVR_Alg.h"
+
+#if defined( OVR_CPU_ARM_NEON ) || defined( __ARM_NEON )
+#include <arm_neon.h>
+#elif defined( OVR_CPU_SSE )
+#include <xmmintrin.h>
+#endif
+
+namespace OVR
+{
+
+//==============================================================
+// Four floats, one per joint
+
+#if defined( OVR_CPU_ARM_NEON ) || defined( __ARM_NEON )
+
+typedef float32x4_t ovrFloat4;
+
+static inline ovrFloat4 Float4Splat( const float f ) { return vdupq_n_f32( f ); }
+static inline ovrFloat4 Float4Load( const float * p ) { return vld1q_f32( p ); }
+static inline void Float4Store( float * p, const ovrFloat4 v ) { vst1q_f32( p, v ); }
+static inline ovrFloat4 Float4Add( const ovrFloat4 a, const ovrFloat4 b ) { return vaddq_f32( a, b ); }
+static inline ovrFloat4 Float4Sub( const ovrFloat4 a, const ovrFloat4 b ) { return vsubq_f32( a, b ); }
+static inline ovrFloat4 Float4Mul( const ovrFloat4 a, const ovrFloat4 b ) { return vmulq_f32( a, b ); }
+static inline ovrFloat4 Float4Min( const ovrFloat4 a, const ovrFloat4 b ) { return vminq_f32( a, b ); }
+static inline ovrFloat4 Float4Max( const ovrFloat4 a, const ovrFloat4 b ) { return vmaxq_f32( a, b ); }
+
+#elif defined( OVR_CPU_SSE )
+
+typedef __m128 ovrFloat4;
+
+static inline ovrFloat4 Float4Splat( const float f ) { return _mm_set1_ps( f ); }
+static inline ovrFloat4 Float4Load( const float * p ) { return _mm_loadu_ps( p ); }
+static inline void Float4Store( float * p, const ovrFloat4 v ) { _mm_storeu_ps( p, v ); }
+static inline ovrFloat4 Float4Add( const ovrFloat4 a, const ovrFloat4 b ) { return _mm_add_ps( a, b ); }
+static inline ovrFloat4 Float4Sub( const ovrFloat4 a, const ovrFloat4 b ) { return _mm_sub_ps( a, b ); }
+static inline ovrFloat4 Float4Mul( const ovrFloat4 a, const ovrFloat4 b ) { return _mm_mul_ps( a, b ); }
+static inline ovrFloat4 Float4Min( const ovrFloat4 a, const ovrFloat4 b ) { return _mm_min_ps( a, b ); }
+static inline ovrFloat4 Float4Max( const ovrFloat4 a, const ovrFloat4 b ) { return _mm_max_ps( a, b ); }
+
+#else
+
+struct ovrFloat4
+{
+	float	v[4];
+};
+
+static inline ovrFloat4 Float4Splat( const float f ) { ovrFloat4 r; for ( int i = 0; i < 4; i++ ) { r.v[i] = f; } return r; }
+static inline ovrFloat4 Float4Load( const float * p ) { ovrFloat4 r; memcpy( r.v, p, sizeof( r.v ) ); return r; }
+static inline void Float4Store( float * p, const ovrFloat4 v ) { memcpy( p, v.v, sizeof( v.v ) ); }
+static inline ovrFloat4 Float4Add( const ovrFloat4 a, const ovrFloat4 b ) { ovrFloat4 r; for ( int i = 0; i < 4; i++ ) { r.v[i] = a.v[i] + b.v[i]; } return r; }
+static inline ovrFloat4 Float4Sub( const ovrFloat4 a, const ovrFloat4 b ) { ovrFloat4 r; for ( int i = 0; i < 4; i++ ) { r.v[i] = a.v[i] - b.v[i]; } return r; }
+static inline ovrFloat4 Float4Mul( const ovrFloat4 a, const ovrFloat4 b ) { ovrFloat4 r; for ( int i = 0; i < 4; i++ ) { r.v[i] = a.v[i] * b.v[i]; } return r; }
+static inline ovrFloat4 Float4Min( const ovrFloat4 a, const ovrFloat4 b ) { ovrFloat4 r; for ( int i = 0; i < 4; i++ ) { r.v[i] = Alg::Min( a.v[i], b.v[i] ); } return r; }
+static inline ovrFloat4 Float4Max( const ovrFloat4 a, const ovrFloat4 b ) { ovrFloat4 r; for ( int i = 0; i < 4; i++ ) { r.v[i] = Alg::Max( a.v[i], b.v[i] ); } return r; }
+
+#endif
+
+// Sine of angles in the range [-PI, 3*PI/2]. The angles are reflected into
+// [-PI/2, PI/2], where the series is accurate to about 1e-7.
+static ovrFloat4 Float4Sin( const ovrFloat4 angle )
+{
+	const ovrFloat4 pi = Float4Splat( Math<float>::Pi );
+	const ovrFloat4 upper = Float4Min( angle, Float4Sub( pi, angle ) );
+	const ovrFloat4 x = Float4Max( upper, Float4Sub( Float4Sub( Float4Splat( 0.0f ), pi ), upper ) );
+	const ovrFloat4 x2 = Float4Mul( x, x );
+	ovrFloat4 r = Float4Splat( -1.0f / 39916800.0f );
+	r = Float4Add( Float4Mul( r, x2 ), Float4Splat( 1.0f / 362880.0f ) );
+	r = Float4Add( Float4Mul( r, x2 ), Float4Splat( -1.0f / 5040.0f ) );
+	r = Float4Add( Float4Mul( r, x2 ), Float4Splat( 1.0f / 120.0f ) );
+	r = Float4Add( Float4Mul( r, x2 ), Float4Splat( -1.0f / 6.0f ) );
+	r = Float4Add( Float4Mul( r, x2 ), Float4Splat( 1.0f ) );
+	return Float4Mul( r, x );
+}
+
+// Cosine of angles in the range [-PI, PI].
+static ovrFloat4 Float4Cos( const ovrFloat4 angle )
+{
+	return Float4Sin( Float4Add( angle, Float4Splat( Math<float>::PiOver2 ) ) );
+}
+
+//==============================================================
+// Joint evaluation
+
+static const int JOINTS_PER_BLOCK = 4;
+
+// Returns the angle wrapped to [-PI, PI]. Times are in seconds since boot, so
+// the wrap is done in double precision before the angle fits in a float.
+static float WrapAngle( const double angle )
+{
+	return static_cast<float>( angle - floor( angle * ( 0.5 / Math<double>::Pi ) + 0.5 ) * ( 2.0 * Math<double>::Pi ) );
+}
+
+// Computes transform * local * inverse for four joints. The matrices are
+// stored as structures of arrays: element e of joint j is at [e][j]. The
+// bottom row of local is 0 0 0 1.
+static void TransformJoints4( const float transform[16][4], const ovrFloat4 local[12], const float inverse[16][4], float out[16][4] )
+{
+	for ( int r = 0; r < 4; r++ )
+	{
+		const ovrFloat4 t0 = Float4Load( transform[r * 4 + 0] );
+		const ovrFloat4 t1 = Float4Load( transform[r * 4 + 1] );
+		const ovrFloat4 t2 = Float4Load( transform[r * 4 + 2] );
+		const ovrFloat4 t3 = Float4Load( transform[r * 4 + 3] );
+
+		// row r of transform * local
+		ovrFloat4 a[4];
+		for ( int c = 0; c < 4; c++ )
+		{
+			a[c] = Float4Add( Float4Add( Float4Mul( t0, local[0 * 4 + c] ), Float4Mul( t1, local[1 * 4 + c] ) ), Float4Mul( t2, local[2 * 4 + c] ) );
+		}
+		a[3] = Float4Add( a[3], t3 );
+
+		for ( int c = 0; c < 4; c++ )
+		{
+			const ovrFloat4 m = Float4Add( Float4Add( Float4Mul( a[0], Float4Load( inverse[0 * 4 + c] ) ), Float4Mul( a[1], Float4Load( inverse[1 * 4 + c] ) ) ),
+									Float4Add( Float4Mul( a[2], Float4Load( inverse[2 * 4 + c] ) ), Float4Mul( a[3], Float4Load( inverse[3 * 4 + c] ) ) ) );
+			Float4Store( out[r * 4 + c], m );
+		}
+	}
+}
+
+// Evaluates up to four animated joints. Rotations are RotationY * RotationX * RotationZ
+// of the angles, a bob is a translation. Both are built for all four joints at
+// once, a bob has zero angles and a rotation has no translation.
+static void AnimateJointBlock( const ovrAnimatedJoint * joints, const int count, const double timeInSeconds )
+{
+	float transform[16][JOINTS_PER_BLOCK];
+	float inverse[16][JOINTS_PER_BLOCK];
+	float angles[3][JOINTS_PER_BLOCK];
+	float offsets[3][JOINTS_PER_BLOCK];
+	float phases[JOINTS_PER_BLOCK];
+	float out[16][JOINTS_PER_BLOCK];
+
+	memset( angles, 0, sizeof( angles ) );
+	memset( offsets, 0, sizeof( offsets ) );
+	memset( phases, 0, sizeof( phases ) );
+	if ( count < JOINTS_PER_BLOCK )
+	{
+		memset( transform, 0, sizeof( transform ) );
+		memset( inverse, 0, sizeof( inverse ) );
+	}
+
+	for ( int j = 0; j < count; j++ )
+	{
+		const ModelJoint & joint = *joints[j].Joint;
+		const double time = ( timeInSeconds + joint.timeOffset ) * joint.timeScale;
+		if ( joint.animation == MODEL_JOINT_ANIMATION_ROTATE )
+		{
+			for ( int i = 0; i < 3; i++ )
+			{
+				angles[i][j] = WrapAngle( joint.parameters[i] * ( Math<double>::DegreeToRadFactor * time ) );
+			}
+		}
+		else
+		{
+			// sway and bob follow the sine of the phase
+			phases[j] = WrapAngle( time * Math<double>::Pi );
+		}
+
+		const float * t = &joint.transform.M[0][0];
+		const float * inv = &joint.inverseTransform.M[0][0];
+		for ( int e = 0; e < 16; e++ )
+		{
+			transform[e][j] = t[e];
+			inverse[e][j] = inv[e];
+		}
+	}
+
+	float sines[JOINTS_PER_BLOCK];
+	Float4Store( sines, Float4Sin( Float4Load( phases ) ) );
+
+	for ( int j = 0; j < count; j++ )
+	{
+		const ModelJoint & joint = *joints[j].Joint;
+		if ( joint.animation == MODEL_JOINT_ANIMATION_SWAY )
+		{
+			for ( int i = 0; i < 3; i++ )
+			{
+				angles[i][j] = WrapAngle( joint.parameters[i] * ( Math<double>::DegreeToRadFactor * sines[j] ) );
+			}
+		}
+		else if ( joint.animation == MODEL_JOINT_ANIMATION_BOB )
+		{
+			for ( int i = 0; i < 3; i++ )
+			{
+				offsets[i][j] = joint.parameters[i] * sines[j];
+			}
+		}
+	}
+
+	const ovrFloat4 ax = Float4Load( angles[0] );
+	const ovrFloat4 ay = Float4Load( angles[1] );
+	const ovrFloat4 az = Float4Load( angles[2] );
+	const ovrFloat4 sx = Float4Sin( ax );
+	const ovrFloat4 cx = Float4Cos( ax );
+	const ovrFloat4 sy = Float4Sin( ay );
+	const ovrFloat4 cy = Float4Cos( ay );
+	const ovrFloat4 sz = Float4Sin( az );
+	const ovrFloat4 cz = Float4Cos( az );
+	const ovrFloat4 sysx = Float4Mul( sy, sx );
+	const ovrFloat4 cysx = Float4Mul( cy, sx );
+
+	ovrFloat4 local[12];
+	local[ 0] = Float4Add( Float4Mul( cy, cz ), Float4Mul( sysx, sz ) );
+	local[ 1] = Float4Sub( Float4Mul( sysx, cz ), Float4Mul( cy, sz ) );
+	local[ 2] = Float4Mul( sy, cx );
+	local[ 3] = Float4Load( offsets[0] );
+	local[ 4] = Float4Mul( cx, sz );
+	local[ 5] = Float4Mul( cx, cz );
+	local[ 6] = Float4Sub( Float4Splat( 0.0f ), sx );
+	local[ 7] = Float4Load( offsets[1] );
+	local[ 8] = Float4Sub( Float4Mul( cysx, sz ), Float4Mul( sy, cz ) );
+	local[ 9] = Float4Add( Float4Mul( sy, sz ), Float4Mul( cysx, cz ) );
+	local[10] = Float4Mul( cy, cx );
+	local[11] = Float4Load( offsets[2] );
+
+	TransformJoints4( transform, local, inverse, out );
+
+	for ( int j = 0; j < count; j++ )
+	{
+		float * m = &joints[j].Transform->M[0][0];
+		for ( int e = 0; e < 16; e++ )
+		{
+			m[e] = out[e][j];
+		}
+	}
+}
+
+void AnimateModelJoints( const Array< ModelJoint > & modelJoints, Array< Matrix4f > & joints, const double timeInSeconds )
+{
+	ovrAnimatedJoint block[JOINTS_PER_BLOCK];
+	int count = 0;
+
+	const int numJoints = Alg::Min( modelJoints.GetSizeI(), joints.GetSizeI() );
+	for ( int i = 0; i < numJoints; i++ )
+	{
+		if ( modelJoints[i].animation == MODEL_JOINT_ANIMATION_NONE )
+		{
+			continue;
+		}
+		block[count].Joint = &modelJoints[i];
+		block[count].Transform = &joints[i];
+		if ( ++count == JOINTS_PER_BLOCK )
+		{
+			AnimateJointBlock( block, count, timeInSeconds );
+			count = 0;
+		}
+	}
+	if ( count > 0 )
+	{
+		AnimateJointBlock( block, count, timeInSeconds );
+	}
+}
+
+//==============================================================
+// ovrJointAnimationBatch
+
+//==============================
+// ovrJointAnimationBatch::ovrJointAnimationBatch
+ovrJointAnimationBatch::ovrJointAnimationBatch()
+	: TimeInSeconds( 0.0 )
+	, NumTasks( 0 )
+{
+}
+
+//==============================
+// ovrJointAnimationBatch::Clear
+void ovrJointAnimationBatch::Clear()
+{
+	Joints.Resize( 0 );
+}
+
+//==============================
+// ovrJointAnimationBatch::AddModel
+void ovrJointAnimationBatch::AddModel( const Array< ModelJoint > & modelJoints, Array< Matrix4f > & joints )
+{
+	const int numJoints = Alg::Min( modelJoints.GetSizeI(), joints.GetSizeI() );
+	for ( int i = 0; i < numJoints; i++ )
+	{
+		if ( modelJoints[i].animation == MODEL_JOINT_ANIMATION_NONE )
+		{
+			continue;
+		}
+		ovrAnimatedJoint joint;
+		joint.Joint = &modelJoints[i];
+		joint.Transform = &joints[i];
+		Joints.PushBack( joint );
+	}
+}
+
+//==============================
+// ovrJointAnimationBatch::AnimateTask
+void ovrJointAnimationBatch::AnimateTask( void * data, const int task )
+{
+	const ovrJointAnimationBatch & batch = *static_cast< const ovrJointAnimationBatch * >( data );
+	const int numBlocks = ( batch.Joints.GetSizeI() + JOINTS_PER_BLOCK - 1 ) / JOINTS_PER_BLOCK;
+	const int firstBlock = (int)( ( (int64_t)numBlocks * task ) / batch.NumTasks );
+	const int endBlock = (int)( ( (int64_t)numBlocks * ( task + 1 ) ) / batch.NumTasks );
+
+	for ( int block = firstBlock; block < endBlock; block++ )
+	{
+		const int first = block * JOINTS_PER_BLOCK;
+		const int count = Alg::Min( JOINTS_PER_BLOCK, batch.Joints.GetSizeI() - first );
+		AnimateJointBlock( &batch.Joints[first], count, batch.TimeInSeconds );
+	}
+}
+
+//==============================
+// ovrJointAnimationBatch::Animate
+void ovrJointAnimationBatch::Animate( const double timeInSeconds, ovrWorkerPool * workers )
+{
+	// Small enough for an even split to balance, large enough to amortize a task.
+	static const int MIN_BLOCKS_PER_TASK = 64;
+	static const int TASKS_PER_THREAD = 4;
+
+	const int numBlocks = ( Joints.GetSizeI() + JOINTS_PER_BLOCK - 1 ) / JOINTS_PER_BLOCK;
+	if ( numBlocks == 0 )
+	{
+		return;
+	}
+
+	TimeInSeconds = timeInSeconds;
+	if ( workers == NULL )
+	{
+		NumTasks = 1;
+		AnimateTask( this, 0 );
+		return;
+	}
+
+	NumTasks = Alg::Max( 1, Alg::Min( ( numBlocks + MIN_BLOCKS_PER_TASK - 1 ) / MIN_BLOCKS_PER_TASK,
+			workers->GetNumThreads() * TASKS_PER_THREAD ) );
+	workers->Run( NumTasks, AnimateTask, this );
+}
+
+} // namespace OVR
@@ -0,0 +1,68 @@
+/************************************************************************************
+
+Filename    :   ModelAnimation.h
+Content     :   Evaluation of the procedural joint animations of models.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#ifndef OVR_ModelAnimation_h
+#define OVR_ModelAnimation_h
+
+#include "Kernel/OVR_Array.h"
+#include "Kernel/OVR_Math.h"
+#include "OVR_WorkerPool.h"
+#include "ModelFile.h"		// ModelJoint
+
+namespace OVR
+{
+
+// Writes the transform of each animated joint at the given time to joints.
+// Joints without animation are left unchanged.
+void AnimateModelJoints( const Array< ModelJoint > & modelJoints, Array< Matrix4f > & joints, const double timeInSeconds );
+
+// An animated joint and where its transform is written.
+struct ovrAnimatedJoint
+{
+	const ModelJoint *	Joint;
+	Matrix4f *			Transform;
+};
+
+//==============================================================
+// ovrJointAnimationBatch
+//
+// Collects the animated joints of many models and evaluates them together,
+// four joints at a time with SIMD. The joints are evaluated as
+// transform * animation * inverseTransform, with the inverse cached in the
+// ModelJoint at load.
+//
+// The transforms are written through pointers into the joint arrays, so the
+// arrays must not be resized between AddModel() and Animate().
+class ovrJointAnimationBatch
+{
+public:
+							ovrJointAnimationBatch();
+
+	void					Clear();
+	void					AddModel( const Array< ModelJoint > & modelJoints, Array< Matrix4f > & joints );
+
+	int						GetNumJoints() const { return Joints.GetSizeI(); }
+
+	// Evaluates all joints added since the last Clear(), split across the workers
+	// when they are given.
+	void					Animate( const double timeInSeconds, ovrWorkerPool * workers );
+
+private:
+	Array< ovrAnimatedJoint, ArrayConstPolicy< 0, 16, true > >	Joints;	// keeps its memory when cleared
+	double					TimeInSeconds;
+	int						NumTasks;
+
+	static void				AnimateTask( void * data, const int task );
+};
+
+} // namespace OVR
+
+#endif	// OVR_ModelAnimation_h
@@ -0,0 +1,58 @@
+/************************************************************************************
+
+Filename    :   ModelAssetCache.cpp
+Content     :   Content-addressed cache of the GL assets shared by loaded models.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#include "ModelAssetCache.h"
+
+#include <string.h>
+
+namespace OVR
+{
+
+static const uint64_t FNV_OFFSET = 14695981039346656037ull;
+static const uint64_t FNV_PRIME = 1099511628211ull;
+
+static inline uint64_t RotateLeft( const uint64_t x, const int bits )
+{
+	return ( x << bits ) | ( x >> ( 64 - bits ) );
+}
+
+// FNV-1a on 64 bit words instead of bytes, so it runs close to memory speed on
+// texture sized inputs. The multiply only carries upwards, so the product is
+// rotated to feed the high bits back, and the result gets a final avalanche.
+uint64_t HashAssetContent( const void * data, const size_t size, const uint64_t seed )
+{
+	const uint8_t * bytes = static_cast< const uint8_t * >( data );
+	uint64_t hash = ( FNV_OFFSET ^ seed ) * FNV_PRIME;
+
+	size_t i = 0;
+	for ( ; i + 8 <= size; i += 8 )
+	{
+		uint64_t word;
+		memcpy( &word, bytes + i, sizeof( word ) );
+		hash = RotateLeft( ( hash ^ word ) * FNV_PRIME, 31 );
+	}
+	if ( i < size )
+	{
+		uint64_t word = 0;
+		memcpy( &word, bytes + i, size - i );
+		hash = RotateLeft( ( hash ^ word ) * FNV_PRIME, 31 );
+	}
+
+	hash ^= (uint64_t)size;
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDull;
+	hash ^= hash >> 33;
+	hash *= 0xC4CEB9FE1A85EC53ull;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+} // namespace OVR
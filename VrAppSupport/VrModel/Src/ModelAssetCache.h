@@ -0,0 +1,156 @@
+/************************************************************************************
+
+Filename    :   ModelAssetCache.h
+Content     :   Content-addressed cache of the GL assets shared by loaded models.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+
+#ifndef MODELASSETCACHE_H
+#define MODELASSETCACHE_H
+
+#include "Kernel/OVR_Types.h"
+#include "Kernel/OVR_Hash.h"
+#include "Kernel/OVR_Threads.h"
+#include "ScopedMutex.h"
+
+namespace OVR
+{
+
+// Fast 64 bit hash of the source bytes of an asset. The seed carries whatever else
+// determines the asset, such as the load flags, so a key covers all of it.
+uint64_t	HashAssetContent( const void * data, const size_t size, const uint64_t seed = 0 );
+
+//==============================================================
+// ovrAssetCacheT
+//
+// Reference counted assets keyed by a hash of their source bytes. Every successful
+// Find() or Add() holds a reference, which Release() drops with the GL name of the
+// asset. The cache never frees an asset itself: the caller that drops the last
+// reference frees it, so the cache works for any asset type and without GL.
+//
+// Thread safe. The keys are trusted, equal keys are taken to be the same content.
+template< typename _type_ >
+class ovrAssetCacheT
+{
+public:
+					ovrAssetCacheT() :
+						NumHits( 0 ),
+						NumAdds( 0 ),
+						ResidentBytes( 0 ),
+						SharedBytes( 0 ) {}
+
+	// Returns true and adds a reference if an asset with the key is cached.
+	bool			Find( const uint64_t key, _type_ & value )
+	{
+		ovrScopedMutex lock( CacheMutex );
+		ovrEntry * entry = Entries.Get( key );
+		if ( entry == NULL )
+		{
+			return false;
+		}
+		entry->References++;
+		NumHits++;
+		SharedBytes += entry->Bytes;
+		value = entry->Value;
+		return true;
+	}
+
+	// Returns true if an asset with the key is cached, without adding a reference.
+	bool			Contains( const uint64_t key ) const
+	{
+		ovrScopedMutex lock( CacheMutex );
+		return Entries.Get( key ) != NULL;
+	}
+
+	// Adds an asset with one reference. 'name' identifies the asset to Release() and
+	// 'bytes' is its memory. Returns false if another load added the key first, in
+	// which case 'value' is replaced by the cached asset with a reference added, and
+	// the caller frees its own asset.
+	bool			Add( const uint64_t key, const unsigned name, const size_t bytes, _type_ & value )
+	{
+		ovrScopedMutex lock( CacheMutex );
+		ovrEntry * existing = Entries.Get( key );
+		if ( existing != NULL )
+		{
+			existing->References++;
+			NumHits++;
+			SharedBytes += existing->Bytes;
+			value = existing->Value;
+			return false;
+		}
+		ovrEntry entry;
+		entry.Value = value;
+		entry.Name = name;
+		entry.Bytes = bytes;
+		entry.References = 1;
+		Entries.Set( key, entry );
+		NameKeys.Set( name, key );
+		NumAdds++;
+		ResidentBytes += bytes;
+		return true;
+	}
+
+	// Drops a reference to the asset with the given name. Returns false if the asset
+	// is not cached, so the caller owns it. Otherwise 'last' is set when this was
+	// the last reference, and the caller frees the asset.
+	bool			Release( const unsigned name, bool & last )
+	{
+		ovrScopedMutex lock( CacheMutex );
+		const uint64_t * key = NameKeys.Get( name );
+		if ( key == NULL )
+		{
+			return false;
+		}
+		ovrEntry * entry = Entries.Get( *key );
+		OVR_ASSERT( entry != NULL && entry->References > 0 );
+		last = ( --entry->References == 0 );
+		if ( last )
+		{
+			ResidentBytes -= entry->Bytes;
+			Entries.Remove( *key );
+			NameKeys.Remove( name );
+		}
+		else
+		{
+			SharedBytes -= entry->Bytes;
+		}
+		return true;
+	}
+
+	int				GetNumEntries() const { return (int)Entries.GetSize(); }
+	int				GetNumHits() const { return NumHits; }
+	int				GetNumAdds() const { return NumAdds; }
+	size_t			GetResidentBytes() const { return ResidentBytes; }
+	// The memory the current references would take if each had its own copy.
+	size_t			GetSharedBytes() const { return SharedBytes; }
+
+private:
+	struct ovrEntry
+	{
+		_type_		Value;
+		unsigned	Name;
+		size_t		Bytes;
+		int			References;
+	};
+
+	mutable Mutex					CacheMutex;
+	Hash< uint64_t, ovrEntry >		Entries;
+	Hash< unsigned, uint64_t >		NameKeys;
+
+	int				NumHits;
+	int				NumAdds;
+	size_t			ResidentBytes;
+	size_t			SharedBytes;
+
+	// not copyable
+					ovrAssetCacheT( const ovrAssetCacheT & );
+	ovrAssetCacheT &	operator = ( const ovrAssetCacheT & );
+};
+
+} // namespace OVR
+
+#endif // MODELASSETCACHE_H
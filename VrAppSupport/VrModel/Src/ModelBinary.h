@@ -0,0 +1,182 @@
+/************************************************************************************
+
+Filename    :   ModelBinary.h
+Content     :   Chunked binary model container that replaces models.json + models.bin.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
+
+*************************************************************************************/
+#ifndef MODELBINARY_H
+#define MODELBINARY_H
+
+#include <stdint.h>
+
+/*
+
+A models.ovrm file holds everything models.json + models.bin hold, laid out so the
+loader can use the file in place instead of parsing it.
+
+	model_binary_header_t
+	model_binary_chunk_t[numChunks]		chunk directory
+	chunk data							each chunk starts MODEL_BINARY_ALIGNMENT aligned
+
+All values are little endian. A chunk holds 'count' fixed size records, except for
+the STRINGS chunk which holds zero terminated strings, and the VERTICES and INDICES
+chunks which hold the surface geometry. Names are byte offsets into the STRINGS chunk.
+Offsets in a surface are relative to the start of the VERTICES or INDICES chunk.
+
+The vertex attributes of a surface are packed the way GlGeometry packs them: each
+present attribute as a contiguous array, in the order of the attribute bits, so the
+vertex data can be handed to glBufferData straight from the file.
+
+A loader skips chunks with an id it does not know. Adding a chunk does not change
+the version; changing the layout of a record does.
+
+This header is shared with Tools/FbxConvert, which writes the file, so it only
+depends on stdint.h.
+
+*/
+
+static const uint32_t MODEL_BINARY_MAGIC		= 0x6D72766F;	// little endian "ovrm"
+static const uint32_t MODEL_BINARY_VERSION		= 1;
+static const uint32_t MODEL_BINARY_ALIGNMENT	= 16;
+static const char		MODEL_BINARY_FILE_NAME[]	= "models.ovrm";
+
+enum model_binary_chunk_id_t
+{
+	MODEL_BINARY_CHUNK_STRINGS			= 1,	// char
+	MODEL_BINARY_CHUNK_TEXTURES			= 2,	// model_binary_texture_t
+	MODEL_BINARY_CHUNK_JOINTS			= 3,	// model_binary_joint_t
+	MODEL_BINARY_CHUNK_TAGS				= 4,	// model_binary_tag_t
+	MODEL_BINARY_CHUNK_SURFACES			= 5,	// model_binary_surface_t
+	MODEL_BINARY_CHUNK_VERTICES			= 6,	// packed vertex attributes
+	MODEL_BINARY_CHUNK_INDICES			= 7,	// uint16_t
+	MODEL_BINARY_CHUNK_COLLISION		= 8,	// model_binary_polytope_t
+	MODEL_BINARY_CHUNK_GROUND_COLLISION	= 9,	// model_binary_polytope_t
+	MODEL_BINARY_CHUNK_PLANES			= 10,	// float[4], the planes of both collision models
+	MODEL_BINARY_CHUNK_TRACE			= 11,	// model_binary_trace_t, at most one
+	MODEL_BINARY_CHUNK_TRACE_VERTICES	= 12,	// float[3]
+	MODEL_BINARY_CHUNK_TRACE_UVS		= 13,	// float[2]
+	MODEL_BINARY_CHUNK_TRACE_INDICES	= 14,	// int32_t
+	MODEL_BINARY_CHUNK_TRACE_NODES		= 15,	// kdtree_node_t
+	MODEL_BINARY_CHUNK_TRACE_LEAFS		= 16,	// kdtree_leaf_t
+	MODEL_BINARY_CHUNK_TRACE_OVERFLOW	= 17	// int32_t
+};
+
+// Same bit order as VertexAttributeLocation.
+enum model_binary_attribute_t
+{
+	MODEL_BINARY_ATTRIBUTE_POSITION			= 1 << 0,	// float[3]
+	MODEL_BINARY_ATTRIBUTE_NORMAL			= 1 << 1,	// float[3]
+	MODEL_BINARY_ATTRIBUTE_TANGENT			= 1 << 2,	// float[3]
+	MODEL_BINARY_ATTRIBUTE_BINORMAL			= 1 << 3,	// float[3]
+	MODEL_BINARY_ATTRIBUTE_COLOR			= 1 << 4,	// float[4]
+	MODEL_BINARY_ATTRIBUTE_UV0				= 1 << 5,	// float[2]
+	MODEL_BINARY_ATTRIBUTE_UV1				= 1 << 6,	// float[2]
+	MODEL_BINARY_ATTRIBUTE_JOINT_INDICES	= 1 << 7,	// int32_t[4]
+	MODEL_BINARY_ATTRIBUTE_JOINT_WEIGHTS	= 1 << 8,	// float[4]
+	MODEL_BINARY_ATTRIBUTE_COUNT			= 9
+};
+
+static const int ModelBinaryAttributeSize[MODEL_BINARY_ATTRIBUTE_COUNT] = { 12, 12, 12, 12, 16, 8, 8, 16, 16 };
+
+enum model_binary_usage_t
+{
+	MODEL_BINARY_USAGE_DIFFUSE,
+	MODEL_BINARY_USAGE_NORMAL,
+	MODEL_BINARY_USAGE_SPECULAR,
+	MODEL_BINARY_USAGE_EMISSIVE,
+	MODEL_BINARY_USAGE_REFLECTION,
+	MODEL_BINARY_USAGE_COUNT
+};
+
+enum model_binary_occlusion_t
+{
+	MODEL_BINARY_OCCLUSION_OPAQUE,
+	MODEL_BINARY_OCCLUSION_PERFORATED,
+	MODEL_BINARY_OCCLUSION_TRANSPARENT
+};
+
+enum model_binary_material_t
+{
+	MODEL_BINARY_MATERIAL_OPAQUE,
+	MODEL_BINARY_MATERIAL_PERFORATED,
+	MODEL_BINARY_MATERIAL_TRANSPARENT,
+	MODEL_BINARY_MATERIAL_ADDITIVE
+};
+
+struct model_binary_header_t
+{
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	fileSize;
+	uint32_t	numChunks;
+};
+
+struct model_binary_chunk_t
+{
+	uint32_t	id;				// model_binary_chunk_id_t
+	uint32_t	offset;			// from the start of the file
+	uint32_t	size;			// in bytes
+	uint32_t	count;			// number of records
+};
+
+struct model_binary_texture_t
+{
+	uint32_t	name;			// without extension
+	uint16_t	usage;			// model_binary_usage_t
+	uint16_t	occlusion;		// model_binary_occlusion_t
+};
+
+struct model_binary_joint_t
+{
+	uint32_t	name;
+	uint32_t	animation;		// ModelJointAnimation
+	float		transform[4][4];
+	float		parameters[3];
+	float		timeOffset;
+	float		timeScale;
+};
+
+struct model_binary_tag_t
+{
+	uint32_t	name;
+	float		matrix[4][4];
+	int32_t		jointIndices[4];
+	float		jointWeights[4];
+};
+
+struct model_binary_surface_t
+{
+	uint32_t	name;			// source mesh names separated by ';'
+	uint32_t	material;		// model_binary_material_t
+	int32_t		textures[MODEL_BINARY_USAGE_COUNT];	// texture record per usage, or -1
+	float		bounds[2][3];
+	uint32_t	vertexAttribs;	// model_binary_attribute_t bits
+	uint32_t	vertexCount;
+	uint32_t	vertexOffset;	// 4 byte aligned
+	uint32_t	indexCount;
+	uint32_t	indexOffset;	// 2 byte aligned
+};
+
+struct model_binary_polytope_t
+{
+	uint32_t	name;
+	uint32_t	firstPlane;
+	uint32_t	numPlanes;
+};
+
+struct model_binary_trace_t
+{
+	int32_t		numVertices;
+	int32_t		numUvs;
+	int32_t		numIndices;
+	int32_t		numNodes;
+	int32_t		numLeafs;
+	int32_t		numOverflow;
+	float		bounds[2][3];
+};
+
+#endif // MODELBINARY_H
@@ -12,11 +12,18 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 #include "ModelCollision.h"
 
 #include <math.h>
+#include <string.h>
 
 #include "Kernel/OVR_Alg.h"
 #include "Kernel/OVR_Array.h"
 #include "Kernel/OVR_String.h"
 
+#if defined( OVR_CPU_ARM_NEON ) || defined( __ARM_NEON )
+#include <arm_neon.h>
+#elif defined( OVR_CPU_SSE )
+#include <xmmintrin.h>
+#endif
+
 namespace OVR {
 
 //-----------------------------------------------------------------------------
@@ -120,7 +127,7 @@ bool CollisionPolytope::PopOut( Vector3f & p ) const
 //	ModelCollision
 //-----------------------------------------------------------------------------
 
-bool ModelCollision::TestPoint( const Vector3f & p ) const
+bool ModelCollision::TestPoint_Exhaustive( const Vector3f & p ) const
 {
 	for ( int i = 0; i < Polytopes.GetSizeI(); i++ )
 	{
@@ -132,7 +139,7 @@ bool ModelCollision::TestPoint( const Vector3f & p ) const
 	return false;
 }
 
-bool ModelCollision::TestRay( const Vector3f & start, const Vector3f & dir, float & length, Planef * plane ) const
+bool ModelCollision::TestRay_Exhaustive( const Vector3f & start, const Vector3f & dir, float & length, Planef * plane ) const
 {
 	bool clipped = false;
 	for ( int i = 0; i < Polytopes.GetSizeI(); i++ )
@@ -155,7 +162,7 @@ bool ModelCollision::TestRay( const Vector3f & start, const Vector3f & dir, floa
 	return clipped;
 }
 
-bool ModelCollision::PopOut( Vector3f & p ) const
+bool ModelCollision::PopOut_Exhaustive( Vector3f & p ) const
 {
 	for ( int i = 0; i < Polytopes.GetSizeI(); i++ )
 	{
@@ -167,6 +174,616 @@ bool ModelCollision::PopOut( Vector3f & p ) const
 	return false;
 }
 
+//-----------------------------------------------------------------------------
+//	Four planes at a time
+//-----------------------------------------------------------------------------
+
+#if defined( OVR_CPU_ARM_NEON ) || defined( __ARM_NEON )
+
+typedef float32x4_t ovrFloat4;
+
+static inline ovrFloat4 Float4Splat( const float f ) { return vdupq_n_f32( f ); }
+static inline ovrFloat4 Float4Load( const float * p ) { return vld1q_f32( p ); }
+static inline void Float4Store( float * p, const ovrFloat4 v ) { vst1q_f32( p, v ); }
+static inline ovrFloat4 Float4Add( const ovrFloat4 a, const ovrFloat4 b ) { return vaddq_f32( a, b ); }
+static inline ovrFloat4 Float4Mul( const ovrFloat4 a, const ovrFloat4 b ) { return vmulq_f32( a, b ); }
+static inline int Float4GreaterThanZero( const ovrFloat4 a )
+{
+	uint32_t lanes[4];
+	vst1q_u32( lanes, vcgtq_f32( a, vdupq_n_f32( 0.0f ) ) );
+	return ( lanes[0] & 1 ) | ( lanes[1] & 2 ) | ( lanes[2] & 4 ) | ( lanes[3] & 8 );
+}
+
+#elif defined( OVR_CPU_SSE )
+
+typedef __m128 ovrFloat4;
+
+static inline ovrFloat4 Float4Splat( const float f ) { return _mm_set1_ps( f ); }
+static inline ovrFloat4 Float4Load( const float * p ) { return _mm_loadu_ps( p ); }
+static inline void Float4Store( float * p, const ovrFloat4 v ) { _mm_storeu_ps( p, v ); }
+static inline ovrFloat4 Float4Add( const ovrFloat4 a, const ovrFloat4 b ) { return _mm_add_ps( a, b ); }
+static inline ovrFloat4 Float4Mul( const ovrFloat4 a, const ovrFloat4 b ) { return _mm_mul_ps( a, b ); }
+static inline int Float4GreaterThanZero( const ovrFloat4 a ) { return _mm_movemask_ps( _mm_cmpgt_ps( a, _mm_setzero_ps() ) ); }
+
+#else
+
+struct ovrFloat4
+{
+	float	v[4];
+};
+
+static inline ovrFloat4 Float4Splat( const float f ) { ovrFloat4 r; for ( int i = 0; i < 4; i++ ) { r.v[i] = f; } return r; }
+static inline ovrFloat4 Float4Load( const float * p ) { ovrFloat4 r; memcpy( r.v, p, sizeof( r.v ) ); return r; }
+static inline void Float4Store( float * p, const ovrFloat4 v ) { memcpy( p, v.v, sizeof( v.v ) ); }
+static inline ovrFloat4 Float4Add( const ovrFloat4 a, const ovrFloat4 b ) { ovrFloat4 r; for ( int i = 0; i < 4; i++ ) { r.v[i] = a.v[i] + b.v[i]; } return r; }
+static inline ovrFloat4 Float4Mul( const ovrFloat4 a, const ovrFloat4 b ) { ovrFloat4 r; for ( int i = 0; i < 4; i++ ) { r.v[i] = a.v[i] * b.v[i]; } return r; }
+static inline int Float4GreaterThanZero( const ovrFloat4 a ) { int m = 0; for ( int i = 0; i < 4; i++ ) { m |= ( a.v[i] > 0.0f ) << i; } return m; }
+
+#endif
+
+// Plane::TestSide() for four planes, with the same operations in the same order.
+static inline ovrFloat4 TestSide4( const CollisionPlanes4 & planes, const ovrFloat4 x, const ovrFloat4 y, const ovrFloat4 z )
+{
+	return Float4Add( Float4Add( Float4Add( Float4Mul( Float4Load( planes.Nx ), x ), Float4Mul( Float4Load( planes.Ny ), y ) ),
+							Float4Mul( Float4Load( planes.Nz ), z ) ), Float4Load( planes.D ) );
+}
+
+// CollisionPolytope::TestPoint() on the packed planes.
+static bool TestPointPlanes( const CollisionPlanes4 * planes, const int numPlanes4, const Vector3f & p )
+{
+	const ovrFloat4 x = Float4Splat( p.x );
+	const ovrFloat4 y = Float4Splat( p.y );
+	const ovrFloat4 z = Float4Splat( p.z );
+	for ( int i = 0; i < numPlanes4; i++ )
+	{
+		if ( Float4GreaterThanZero( TestSide4( planes[i], x, y, z ) ) != 0 )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// CollisionPolytope::TestRay() on the packed planes.
+static bool TestRayPlanes( const CollisionPlanes4 * planes, const int numPlanes4, const Vector3f & start, const Vector3f & dir, float & length, Planef * plane )
+{
+	const Vector3f end = start + dir * length;
+
+	const ovrFloat4 startX = Float4Splat( start.x );
+	const ovrFloat4 startY = Float4Splat( start.y );
+	const ovrFloat4 startZ = Float4Splat( start.z );
+	const ovrFloat4 endX = Float4Splat( end.x );
+	const ovrFloat4 endY = Float4Splat( end.y );
+	const ovrFloat4 endZ = Float4Splat( end.z );
+
+	int crossing = -1;
+	float cdot1 = 0.0f;
+	float cdot2 = 0.0f;
+
+	for ( int i = 0; i < numPlanes4; i++ )
+	{
+		const ovrFloat4 dot1 = TestSide4( planes[i], startX, startY, startZ );
+		const int outside = Float4GreaterThanZero( dot1 );
+		if ( outside == 0 )
+		{
+			continue;
+		}
+		const ovrFloat4 dot2 = TestSide4( planes[i], endX, endY, endZ );
+		if ( ( outside & Float4GreaterThanZero( dot2 ) ) != 0 )
+		{
+			return false;
+		}
+
+		float dot1Lanes[4];
+		float dot2Lanes[4];
+		Float4Store( dot1Lanes, dot1 );
+		Float4Store( dot2Lanes, dot2 );
+		for ( int lane = 0; lane < 4; lane++ )
+		{
+			if ( ( outside & ( 1 << lane ) ) != 0 && dot2Lanes[lane] <= 0.0f )
+			{
+				if ( crossing == -1 || dot2Lanes[lane] > cdot2 )
+				{
+					crossing = i * 4 + lane;
+					cdot1 = dot1Lanes[lane];
+					cdot2 = dot2Lanes[lane];
+				}
+			}
+		}
+	}
+
+	if ( crossing < 0 )
+	{
+		return false;
+	}
+
+	length = length * ( cdot1 - COLLISION_EPSILON ) / ( cdot1 - cdot2 );
+	if ( length < 0.0f )
+	{
+		length = 0.0f;
+	}
+
+	if ( plane != NULL )
+	{
+		const CollisionPlanes4 & planes4 = planes[crossing >> 2];
+		*plane = Planef( planes4.Nx[crossing & 3], planes4.Ny[crossing & 3], planes4.Nz[crossing & 3], planes4.D[crossing & 3] );
+	}
+	return true;
+}
+
+// CollisionPolytope::PopOut() on the packed planes.
+static bool PopOutPlanes( const CollisionPlanes4 * planes, const int numPlanes4, Vector3f & p )
+{
+	const ovrFloat4 x = Float4Splat( p.x );
+	const ovrFloat4 y = Float4Splat( p.y );
+	const ovrFloat4 z = Float4Splat( p.z );
+
+	float minDist = FLT_MAX;
+	int crossing = -1;
+	for ( int i = 0; i < numPlanes4; i++ )
+	{
+		const ovrFloat4 dist = TestSide4( planes[i], x, y, z );
+		if ( Float4GreaterThanZero( dist ) != 0 )
+		{
+			return false;
+		}
+		float distLanes[4];
+		Float4Store( distLanes, dist );
+		for ( int lane = 0; lane < 4; lane++ )
+		{
+			const float d = fabsf( distLanes[lane] );
+			if ( d < minDist )
+			{
+				minDist = d;
+				crossing = i * 4 + lane;
+			}
+		}
+	}
+	if ( crossing < 0 )
+	{
+		return false;
+	}
+	const CollisionPlanes4 & planes4 = planes[crossing >> 2];
+	p += Vector3f( planes4.Nx[crossing & 3], planes4.Ny[crossing & 3], planes4.Nz[crossing & 3] ) * COLLISION_EPSILON;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+//	ModelCollision hierarchy
+//-----------------------------------------------------------------------------
+
+/*
+
+CollisionPolytope::TestRay() reports a hit when the start or the end of the ray is
+on the inside of each plane, which is not limited to rays that pass through the
+polytope. A ray of length L that is reported to hit has its midpoint within L / 2
+of each plane, so the midpoint is inside the polytope with all planes moved out by
+L / 2. The polytopes are culled with the bounds of the polytope with the planes
+moved out by COLLISION_BOUNDS_OFFSET. The extent of the moved out polytope along
+an axis is concave in the distance the planes are moved, so beyond the offset it
+grows no faster than it does up to the offset, which gives how much the bounds
+have to grow for longer rays. Points are inside the polytope itself, so they are
+culled with the bounds as they are.
+
+Polytopes that are not bounded are tested by every query. The polytopes that are
+hit are tested in the order of the exhaustive queries, because a ray is clipped
+by each polytope in turn.
+
+*/
+
+const float COLLISION_BOUNDS_OFFSET		= 0.1f;
+const float COLLISION_BOUNDS_LIMIT		= 1e5f;		// anything beyond is not bounded
+const int	COLLISION_MAX_BOUND_PLANES	= 32;		// the bounds of polytopes with more planes are not calculated
+const int	COLLISION_LEAF_POLYTOPES	= 4;
+const int	COLLISION_MAX_DEPTH			= 32;
+const int	COLLISION_MAX_CANDIDATES	= 256;		// rays that hit more polytopes test all of them
+
+// Calculates the bounds of the polytope with the planes moved out by 'offset' from
+// the corners where three planes meet. Returns false if the polytope is empty or
+// not bounded.
+static bool CalculatePolytopeBounds( const Array< Planef > & polytopePlanes, const float offset, Bounds3f & bounds )
+{
+	if ( polytopePlanes.GetSizeI() > COLLISION_MAX_BOUND_PLANES )
+	{
+		return false;
+	}
+
+	// The planes of a large box catch the polytopes that are not bounded.
+	Planef planes[COLLISION_MAX_BOUND_PLANES + 6];
+	int numPlanes = 0;
+	for ( int i = 0; i < polytopePlanes.GetSizeI(); i++ )
+	{
+		planes[numPlanes++] = Planef( polytopePlanes[i].N, polytopePlanes[i].D - offset * polytopePlanes[i].N.Length() );
+	}
+	for ( int i = 0; i < 6; i++ )
+	{
+		Vector3f normal( 0.0f );
+		normal[i >> 1] = ( i & 1 ) ? -1.0f : 1.0f;
+		planes[numPlanes++] = Planef( normal, -COLLISION_BOUNDS_LIMIT );
+	}
+
+	bounds = Bounds3f( Bounds3f::Init );
+	bool empty = true;
+	for ( int i = 0; i < numPlanes; i++ )
+	{
+		for ( int j = i + 1; j < numPlanes; j++ )
+		{
+			const Vector3f ij = planes[i].N.Cross( planes[j].N );
+			for ( int k = j + 1; k < numPlanes; k++ )
+			{
+				const Vector3f jk = planes[j].N.Cross( planes[k].N );
+				const Vector3f ki = planes[k].N.Cross( planes[i].N );
+				const float det = planes[i].N.Dot( jk );
+				if ( fabsf( det ) < 1e-6f )
+				{
+					continue;
+				}
+				const Vector3f corner = ( jk * planes[i].D + ki * planes[j].D + ij * planes[k].D ) * ( -1.0f / det );
+
+				// Keep corners that are slightly outside, the bounds only have to contain the polytope.
+				const float tolerance = 1e-4f * ( 1.0f + fabsf( corner.x ) + fabsf( corner.y ) + fabsf( corner.z ) );
+				bool inside = true;
+				for ( int m = 0; m < numPlanes && inside; m++ )
+				{
+					inside = planes[m].TestSide( corner ) <= tolerance * planes[m].N.Length();
+				}
+				if ( inside )
+				{
+					bounds.AddPoint( corner );
+					empty = false;
+				}
+			}
+		}
+	}
+	if ( empty )
+	{
+		return false;
+	}
+	for ( int i = 0; i < 3; i++ )
+	{
+		if ( bounds.GetMins()[i] < -0.5f * COLLISION_BOUNDS_LIMIT || bounds.GetMaxs()[i] > 0.5f * COLLISION_BOUNDS_LIMIT )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+struct collisionBuild_t
+{
+	Array< Bounds3f >	Bounds;		// at COLLISION_BOUNDS_OFFSET
+	Array< float >		Growth;
+	Array< int >		Polytopes;
+};
+
+static void BuildCollisionNode( collisionBuild_t & build, Array< CollisionNode > & nodes, const int nodeIndex, const int first, const int count, const int depth )
+{
+	CollisionNode node;
+	node.Bounds = Bounds3f( Bounds3f::Init );
+	node.Growth = 0.0f;
+	Bounds3f centers( Bounds3f::Init );
+	for ( int i = first; i < first + count; i++ )
+	{
+		const int polytope = build.Polytopes[i];
+		node.Bounds = Bounds3f::Union( node.Bounds, build.Bounds[polytope] );
+		node.Growth = Alg::Max( node.Growth, build.Growth[polytope] );
+		centers.AddPoint( ( build.Bounds[polytope].GetMins() + build.Bounds[polytope].GetMaxs() ) * 0.5f );
+	}
+
+	if ( count <= COLLISION_LEAF_POLYTOPES || depth >= COLLISION_MAX_DEPTH )
+	{
+		node.First = first;
+		node.Count = count;
+		nodes[nodeIndex] = node;
+		return;
+	}
+
+	// Split in the middle of the longest axis of the centers, or in half if they are all in the same place.
+	const Vector3f size = centers.GetSize();
+	const int axis = ( size.x > size.y ) ? ( size.x > size.z ? 0 : 2 ) : ( size.y > size.z ? 1 : 2 );
+	const float split = ( centers.GetMins()[axis] + centers.GetMaxs()[axis] ) * 0.5f;
+	int i = first;
+	int j = first + count - 1;
+	while ( i <= j )
+	{
+		const Bounds3f & bounds = build.Bounds[build.Polytopes[i]];
+		if ( ( bounds.GetMins()[axis] + bounds.GetMaxs()[axis] ) * 0.5f <= split )
+		{
+			i++;
+		}
+		else
+		{
+			Alg::Swap( build.Polytopes[i], build.Polytopes[j] );
+			j--;
+		}
+	}
+	int leftCount = i - first;
+	if ( leftCount == 0 || leftCount == count )
+	{
+		leftCount = count / 2;
+	}
+
+	// The children are next to each other.
+	node.First = nodes.GetSizeI();
+	node.Count = 0;
+	nodes[nodeIndex] = node;
+	nodes.AllocBack();
+	nodes.AllocBack();
+	BuildCollisionNode( build, nodes, node.First + 0, first, leftCount, depth + 1 );
+	BuildCollisionNode( build, nodes, node.First + 1, first + leftCount, count - leftCount, depth + 1 );
+}
+
+void ModelCollision::BuildHierarchy()
+{
+	Nodes.Clear();
+	NodePolytopes.Clear();
+	UnboundedPolytopes.Clear();
+	PolytopePlanes.Clear();
+	FirstPolytopePlanes.Clear();
+
+	// Pack the planes, padded with planes that every point is far inside of.
+	FirstPolytopePlanes.Resize( Polytopes.GetSizeI() + 1 );
+	for ( int i = 0; i < Polytopes.GetSizeI(); i++ )
+	{
+		const Array< Planef > & planes = Polytopes[i].Planes;
+		FirstPolytopePlanes[i] = PolytopePlanes.GetSizeI();
+		for ( int j = 0; j < planes.GetSizeI(); j += 4 )
+		{
+			CollisionPlanes4 & planes4 = PolytopePlanes[PolytopePlanes.AllocBack()];
+			for ( int lane = 0; lane < 4; lane++ )
+			{
+				const bool pad = ( j + lane >= planes.GetSizeI() );
+				planes4.Nx[lane] = pad ? 0.0f : planes[j + lane].N.x;
+				planes4.Ny[lane] = pad ? 0.0f : planes[j + lane].N.y;
+				planes4.Nz[lane] = pad ? 0.0f : planes[j + lane].N.z;
+				planes4.D[lane] = pad ? -Math<float>::HugeNumber : planes[j + lane].D;
+			}
+		}
+	}
+	FirstPolytopePlanes[Polytopes.GetSizeI()] = PolytopePlanes.GetSizeI();
+
+	collisionBuild_t build;
+	build.Bounds.Resize( Polytopes.GetSizeI() );
+	build.Growth.Resize( Polytopes.GetSizeI() );
+	for ( int i = 0; i < Polytopes.GetSizeI(); i++ )
+	{
+		Bounds3f bounds;
+		Bounds3f offsetBounds;
+		if ( Polytopes[i].Planes.GetSizeI() == 0 ||
+				!CalculatePolytopeBounds( Polytopes[i].Planes, 0.0f, bounds ) ||
+				!CalculatePolytopeBounds( Polytopes[i].Planes, COLLISION_BOUNDS_OFFSET, offsetBounds ) )
+		{
+			UnboundedPolytopes.PushBack( i );
+			continue;
+		}
+
+		// The fastest any side moves out, with some room for rounding.
+		float growth = 0.0f;
+		for ( int axis = 0; axis < 3; axis++ )
+		{
+			growth = Alg::Max( growth, bounds.GetMins()[axis] - offsetBounds.GetMins()[axis] );
+			growth = Alg::Max( growth, offsetBounds.GetMaxs()[axis] - bounds.GetMaxs()[axis] );
+		}
+		build.Growth[i] = growth / COLLISION_BOUNDS_OFFSET * 1.05f + 0.05f;
+
+		const Vector3f size = offsetBounds.GetSize();
+		const float pad = 1e-3f + 1e-5f * ( fabsf( offsetBounds.GetMins().x ) + fabsf( offsetBounds.GetMins().y ) + fabsf( offsetBounds.GetMins().z ) +
+											size.x + size.y + size.z );
+		build.Bounds[i] = Bounds3f( offsetBounds.GetMins() - Vector3f( pad ), offsetBounds.GetMaxs() + Vector3f( pad ) );
+		build.Polytopes.PushBack( i );
+	}
+
+	if ( build.Polytopes.GetSizeI() > 0 )
+	{
+		Nodes.AllocBack();
+		BuildCollisionNode( build, Nodes, 0, 0, build.Polytopes.GetSizeI(), 0 );
+	}
+	NodePolytopes = build.Polytopes;
+	NumHierarchyPolytopes = Polytopes.GetSizeI();
+}
+
+// Returns true if the ray segment passes through the bounds.
+static bool SegmentHitsBounds( const Vector3f & start, const Vector3f & delta, const Bounds3f & bounds )
+{
+	float t0 = 0.0f;
+	float t1 = 1.0f;
+	for ( int axis = 0; axis < 3; axis++ )
+	{
+		const float s = start[axis];
+		const float d = delta[axis];
+		const float mins = bounds.GetMins()[axis];
+		const float maxs = bounds.GetMaxs()[axis];
+		if ( fabsf( d ) < Math<float>::SmallestNonDenormal )
+		{
+			if ( s < mins || s > maxs )
+			{
+				return false;
+			}
+			continue;
+		}
+		const float rcp = 1.0f / d;
+		const float a = ( mins - s ) * rcp;
+		const float b = ( maxs - s ) * rcp;
+		t0 = Alg::Max( t0, Alg::Min( a, b ) );
+		t1 = Alg::Min( t1, Alg::Max( a, b ) );
+		if ( t0 > t1 )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static Bounds3f GrowBounds( const Bounds3f & bounds, const float growth, const float halfLength )
+{
+	const float grow = Alg::Max( 0.0f, halfLength - COLLISION_BOUNDS_OFFSET ) * growth;
+	return Bounds3f( bounds.GetMins() - Vector3f( grow ), bounds.GetMaxs() + Vector3f( grow ) );
+}
+
+// Calls 'visit' with the bounded polytopes that may contain the point, and the
+// polytopes that are not bounded, in no particular order.
+template< typename _visit_ >
+static void VisitPointPolytopes( const ModelCollision & model, const Vector3f & p, const _visit_ & visit )
+{
+	for ( int i = 0; i < model.UnboundedPolytopes.GetSizeI(); i++ )
+	{
+		visit( model.UnboundedPolytopes[i] );
+	}
+	if ( model.Nodes.GetSizeI() == 0 )
+	{
+		return;
+	}
+	int stack[COLLISION_MAX_DEPTH + 2];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while ( stackSize > 0 )
+	{
+		const CollisionNode & node = model.Nodes[stack[--stackSize]];
+		const Bounds3f & bounds = node.Bounds;
+		if ( p.x < bounds.GetMins().x || p.y < bounds.GetMins().y || p.z < bounds.GetMins().z ||
+				p.x > bounds.GetMaxs().x || p.y > bounds.GetMaxs().y || p.z > bounds.GetMaxs().z )
+		{
+			continue;
+		}
+		if ( node.Count == 0 )
+		{
+			stack[stackSize++] = node.First + 1;
+			stack[stackSize++] = node.First;
+			continue;
+		}
+		for ( int i = node.First; i < node.First + node.Count; i++ )
+		{
+			visit( model.NodePolytopes[i] );
+		}
+	}
+}
+
+bool ModelCollision::TestPoint( const Vector3f & p ) const
+{
+	if ( NumHierarchyPolytopes != Polytopes.GetSizeI() )
+	{
+		return TestPoint_Exhaustive( p );
+	}
+
+	bool inside = false;
+	VisitPointPolytopes( *this, p, [&]( const int i )
+	{
+		if ( !inside )
+		{
+			inside = TestPointPlanes( &PolytopePlanes[FirstPolytopePlanes[i]], FirstPolytopePlanes[i + 1] - FirstPolytopePlanes[i], p );
+		}
+	} );
+	return inside;
+}
+
+bool ModelCollision::PopOut( Vector3f & p ) const
+{
+	if ( NumHierarchyPolytopes != Polytopes.GetSizeI() )
+	{
+		return PopOut_Exhaustive( p );
+	}
+
+	// The exhaustive query pops out of the first polytope the point is inside of.
+	int first = Polytopes.GetSizeI();
+	VisitPointPolytopes( *this, p, [&]( const int i )
+	{
+		if ( i < first && TestPointPlanes( &PolytopePlanes[FirstPolytopePlanes[i]], FirstPolytopePlanes[i + 1] - FirstPolytopePlanes[i], p ) )
+		{
+			first = i;
+		}
+	} );
+	if ( first == Polytopes.GetSizeI() )
+	{
+		return false;
+	}
+	return PopOutPlanes( &PolytopePlanes[FirstPolytopePlanes[first]], FirstPolytopePlanes[first + 1] - FirstPolytopePlanes[first], p );
+}
+
+bool ModelCollision::TestRay( const Vector3f & start, const Vector3f & dir, float & length, Planef * plane ) const
+{
+	if ( NumHierarchyPolytopes != Polytopes.GetSizeI() )
+	{
+		return TestRay_Exhaustive( start, dir, length, plane );
+	}
+
+	// Gather the polytopes near the ray.
+	const Vector3f delta = dir * length;
+	const float halfLength = 0.5f * delta.Length();
+
+	int candidates[COLLISION_MAX_CANDIDATES];
+	int numCandidates = 0;
+	for ( int i = 0; i < UnboundedPolytopes.GetSizeI() && numCandidates < COLLISION_MAX_CANDIDATES; i++ )
+	{
+		candidates[numCandidates++] = UnboundedPolytopes[i];
+	}
+	if ( numCandidates >= COLLISION_MAX_CANDIDATES )
+	{
+		return TestRay_Exhaustive( start, dir, length, plane );
+	}
+
+	if ( Nodes.GetSizeI() > 0 )
+	{
+		int stack[COLLISION_MAX_DEPTH + 2];
+		int stackSize = 0;
+		stack[stackSize++] = 0;
+		while ( stackSize > 0 )
+		{
+			const CollisionNode & node = Nodes[stack[--stackSize]];
+			if ( !SegmentHitsBounds( start, delta, GrowBounds( node.Bounds, node.Growth, halfLength ) ) )
+			{
+				continue;
+			}
+			if ( node.Count == 0 )
+			{
+				stack[stackSize++] = node.First + 1;
+				stack[stackSize++] = node.First;
+				continue;
+			}
+			if ( numCandidates + node.Count > COLLISION_MAX_CANDIDATES )
+			{
+				return TestRay_Exhaustive( start, dir, length, plane );
+			}
+			for ( int i = node.First; i < node.First + node.Count; i++ )
+			{
+				candidates[numCandidates++] = NodePolytopes[i];
+			}
+		}
+	}
+
+	// Test them in order, since each polytope that is hit clips the ray for the next.
+	for ( int i = 1; i < numCandidates; i++ )
+	{
+		const int candidate = candidates[i];
+		int j = i;
+		for ( ; j > 0 && candidates[j - 1] > candidate; j-- )
+		{
+			candidates[j] = candidates[j - 1];
+		}
+		candidates[j] = candidate;
+	}
+
+	bool clipped = false;
+	for ( int c = 0; c < numCandidates; c++ )
+	{
+		const int i = candidates[c];
+		Planef clipPlane;
+		float clipLength = length;
+		if ( TestRayPlanes( &PolytopePlanes[FirstPolytopePlanes[i]], FirstPolytopePlanes[i + 1] - FirstPolytopePlanes[i], start, dir, clipLength, &clipPlane ) )
+		{
+			if ( clipLength < length )
+			{
+				length = clipLength;
+				if ( plane != NULL )
+				{
+					*plane = clipPlane;
+				}
+				clipped = true;
+			}
+		}
+	}
+	return clipped;
+}
+
 //-----------------------------------------------------------------------------
 //	SlideMove
 //-----------------------------------------------------------------------------
@@ -40,9 +40,31 @@ public:
 	Array< Planef > Planes;
 };
 
+// Four planes of a polytope, stored per component for SIMD tests.
+struct CollisionPlanes4
+{
+	float	Nx[4];
+	float	Ny[4];
+	float	Nz[4];
+	float	D[4];
+};
+
+// A node of the hierarchy over the polytopes. A ray of length L can only hit the
+// polytopes below the node if it passes through the bounds grown on all sides by
+// Growth times how far L / 2 exceeds COLLISION_BOUNDS_OFFSET, see ModelCollision.cpp.
+struct CollisionNode
+{
+	Bounds3f	Bounds;
+	float		Growth;
+	int			First;		// first child node, or first polytope in NodePolytopes
+	int			Count;		// number of polytopes, 0 for a node with children First and First + 1
+};
+
 class ModelCollision
 {
 public:
+			ModelCollision() : NumHierarchyPolytopes( -1 ) {}
+
 	// Returns true if the given point is inside solid.
 	bool	TestPoint( const Vector3f & p ) const;
 
@@ -54,8 +76,27 @@ public:
 	// Pops the given point out of any collision geometry the point may be inside of.
 	bool	PopOut( Vector3f & p ) const;
 
+	// Build a bounding volume hierarchy over the polytopes, so the queries above only
+	// test the polytopes near the query, with SIMD plane tests. The results are the same
+	// as those of the exhaustive queries. The hierarchy has to be built again after the
+	// polytopes change, until then the queries are exhaustive.
+	void	BuildHierarchy();
+
+	// Test every polytope.
+	bool	TestPoint_Exhaustive( const Vector3f & p ) const;
+	bool	TestRay_Exhaustive( const Vector3f & start, const Vector3f & dir, float & length, Planef * plane ) const;
+	bool	PopOut_Exhaustive( Vector3f & p ) const;
+
 public:
 	Array< CollisionPolytope > Polytopes;
+
+	// Built by BuildHierarchy().
+	int							NumHierarchyPolytopes;	// number of polytopes when the hierarchy was built
+	Array< CollisionNode >		Nodes;
+	Array< int >				NodePolytopes;			// polytope indices referenced by the leaf nodes
+	Array< int >				UnboundedPolytopes;		// polytopes that are tested by every query
+	Array< CollisionPlanes4 >	PolytopePlanes;			// the planes of all polytopes, padded to four per polytope
+	Array< int >				FirstPolytopePlanes;	// first PolytopePlanes of each polytope, plus one past the last
 };
 
 Vector3f SlideMove(
@@ -26,6 +26,9 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 #include "unzip.h"
 #include "PackageFiles.h"
 #include "OVR_FileSys.h"
+#include "OVR_WorkerPool.h"
+#include "OVR_TextureLoader.h"
+#include "ModelBinary.h"
 
 // Verbose log, redefine this as LOG() to get lots more info dumped
 #define LOGV(...)
@@ -34,12 +37,325 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 
 namespace OVR {
 
+//==============================================================
+// ovrModelTextureLoad
+//
+// The texture entries of a model package, from the compressed zip bytes to
+// the uploaded textures. Each decode task only touches its own entry and no GL,
+// so the tasks can run on any thread while the loading thread parses the
+// geometry. A deferred load hands the entries to an ovrTextureLoader instead.
+// Until an entry is uploaded, ModelFile::Textures and the surfaces hold a
+// placeholder texture, which the upload replaces.
+class ovrModelTextureLoad
+{
+public:
+	struct Entry
+	{
+		Entry() :
+			Compressed( NULL ),
+			CompressedSize( 0 ),
+			CompressionMethod( 0 ),
+			UncompressedSize( 0 ),
+			Crc( 0 ),
+			Clamped( false ),
+			MaxAniso( 0.0f ),
+			MaxLod( -1 ),
+			Finished( false ),
+			Decoded( false ),
+			ContentKey( 0 ),
+			Shareable( false ),
+			Shared( false ),
+			Replaced( false ) {}
+
+		String					Name;				// the zip entry name, the extension selects the decoder
+		const uint8_t *			Compressed;			// into the package data or CompressedCopy
+		MemBufferT< uint8_t >	CompressedCopy;		// when the package data doesn't outlive the load
+		int						CompressedSize;
+		int						CompressionMethod;	// 0 for stored, Z_DEFLATED
+		int						UncompressedSize;
+		uLong					Crc;
+		MemBufferT< uint8_t >	Uncompressed;		// inflated file, referenced by Image
+		ovrTextureImage			Image;
+		bool					Clamped;			// texture parameters applied after the upload
+		float					MaxAniso;
+		int						MaxLod;
+		bool					Finished;			// the decode was tried
+		bool					Decoded;
+		uint64_t				ContentKey;			// ModelAssetCache key of the package bytes
+		bool					Shareable;			// added to ModelAssetCache once uploaded
+		bool					Shared;				// ModelFile::Textures holds a cached texture, nothing to decode
+		asyncTextureHandle_t	Request;			// while the texture loader has the entry
+		bool					Replaced;			// the placeholder is replaced
+	};
+
+							ovrModelTextureLoad( ModelFile & model, const TextureFlags_t & flags ) :
+								Model( model ), Flags( flags ), Loader( NULL ) {}
+							~ovrModelTextureLoad();
+
+	ModelFile &				Model;		// the model whose placeholders are replaced
+	TextureFlags_t			Flags;
+	Array< Entry * >		Entries;	// Entries[i] is ModelFile::Textures[i]
+	ovrTextureLoader *		Loader;		// once the entries are handed to a loader
+
+	static void				DecodeTask( void * data, const int task );
+
+	// Uploads the entries that are not replaced yet on the calling thread, in package order.
+	void					Upload();
+	// Starts the loads of the entries and replaces the placeholders of the finished ones.
+	// Returns true once every placeholder is replaced.
+	bool					Update( ovrTextureLoader & loader );
+
+private:
+	// Returns the texture for an entry whose upload was tried: the default texture if
+	// it failed, or the shared one if the same bytes were uploaded for another entry.
+	GlTexture				FinishUpload( const Entry & entry, GlTexture texid, const size_t bytes ) const;
+	// Applies the sampler state of the entry and replaces its placeholder with texid.
+	void					Replace( const int index, GlTexture texid );
+
+	// not copyable
+							ovrModelTextureLoad( const ovrModelTextureLoad & );
+	ovrModelTextureLoad &	operator = ( const ovrModelTextureLoad & );
+};
+
+//==============================
+// ovrModelTextureLoad::~ovrModelTextureLoad
+ovrModelTextureLoad::~ovrModelTextureLoad()
+{
+	for ( int i = 0; i < Entries.GetSizeI(); i++ )
+	{
+		// an uploaded texture nobody collected belongs to the load
+		if ( Entries[i]->Request.IsValid() )
+		{
+			if ( Loader->GetState( Entries[i]->Request ) == ASYNC_TEXTURE_READY )
+			{
+				GlTexture texid = Loader->GetTexture( Entries[i]->Request );
+				FreeTexture( texid );
+			}
+			Loader->FreeRequest( Entries[i]->Request );
+		}
+		delete Entries[i];
+	}
+}
+
+//==============================
+// ovrModelTextureLoad::DecodeTask
+void ovrModelTextureLoad::DecodeTask( void * data, const int task )
+{
+	const ovrModelTextureLoad * load = static_cast< const ovrModelTextureLoad * >( data );
+	Entry & entry = *load->Entries[task];
+	if ( entry.Finished )
+	{
+		return;
+	}
+	// uploaded by another model, left unfinished in case it is freed before the upload
+	if ( entry.Shareable && ModelAssetCache::Get().Textures.Contains( entry.ContentKey ) )
+	{
+		return;
+	}
+	entry.Finished = true;
+
+	const uint8_t * file = ovr_InflateZipEntry( entry.Name.ToCStr(), entry.Compressed, entry.CompressedSize,
+								entry.CompressionMethod, entry.UncompressedSize, entry.Crc, entry.Uncompressed );
+	if ( file == NULL )
+	{
+		return;
+	}
+
+	entry.Decoded = DecodeTextureBuffer( entry.Name.ToCStr(), MemBuffer( file, entry.UncompressedSize ), load->Flags, false, entry.Image );
+}
+
+//==============================
+// ovrModelTextureLoad::FinishUpload
+GlTexture ovrModelTextureLoad::FinishUpload( const Entry & entry, GlTexture texid, const size_t bytes ) const
+{
+	if ( !texid.IsValid() )
+	{
+		// an empty buffer makes the default texture
+		int width;
+		int height;
+		texid = LoadTextureFromBuffer( entry.Name.ToCStr(), MemBuffer(), Flags, width, height );
+	}
+	else if ( entry.Shareable )
+	{
+		const GlTexture created = texid;
+		if ( !ModelAssetCache::Get().Textures.Add( entry.ContentKey, texid.texture, bytes, texid ) )
+		{
+			FreeTexture( created );
+		}
+	}
+	return texid;
+}
+
+//==============================
+// ovrModelTextureLoad::Replace
+void ovrModelTextureLoad::Replace( const int index, GlTexture texid )
+{
+	Entry & entry = *Entries[index];
+	entry.Replaced = true;
+
+	if ( entry.Clamped )
+	{
+		MakeTextureClamped( texid );
+	}
+	if ( entry.MaxAniso > 0.0f )
+	{
+		MakeTextureAniso( texid, entry.MaxAniso );
+	}
+	if ( entry.MaxLod >= 0 )
+	{
+		MakeTextureLodClamped( texid, entry.MaxLod );
+	}
+	if ( entry.Shared )
+	{
+		return;
+	}
+
+	const GlTexture placeholder = Model.Textures[index].texid;
+	Model.Textures[index].texid = texid;
+	for ( int j = 0; j < Model.Def.surfaces.GetSizeI(); j++ )
+	{
+		ovrGraphicsCommand & cmd = Model.Def.surfaces[j].graphicsCommand;
+		for ( int k = 0; k < ovrUniform::MAX_UNIFORMS; k++ )
+		{
+			if ( placeholder.texture != 0 && cmd.uniformTextures[k].texture == placeholder.texture )
+			{
+				cmd.uniformTextures[k] = texid;
+			}
+		}
+	}
+	FreeTexture( placeholder );
+}
+
+//==============================
+// ovrModelTextureLoad::Upload
+void ovrModelTextureLoad::Upload()
+{
+	OVR_ASSERT( Loader == NULL );
+
+	// the same order the textures were created in before
+	for ( int i = 0; i < Entries.GetSizeI(); i++ )
+	{
+		Entry & entry = *Entries[i];
+		if ( entry.Replaced )
+		{
+			continue;
+		}
+
+		GlTexture texid;
+		if ( entry.Shared )
+		{
+			texid = Model.Textures[i].texid;
+		}
+		else if ( entry.Shareable && ModelAssetCache::Get().Textures.Find( entry.ContentKey, texid ) )
+		{
+			// uploaded by another model since this one was parsed, or twice in this package
+		}
+		else
+		{
+			if ( !entry.Finished )
+			{
+				DecodeTask( this, i );
+			}
+			if ( entry.Decoded )
+			{
+				texid = CreateTextureFromImage( entry.Name.ToCStr(), entry.Image );
+			}
+			texid = FinishUpload( entry, texid, entry.Image.DataSize );
+		}
+		Replace( i, texid );
+	}
+}
+
+//==============================
+// ovrModelTextureLoad::Update
+bool ovrModelTextureLoad::Update( ovrTextureLoader & loader )
+{
+	OVR_ASSERT( Loader == NULL || Loader == &loader );
+	Loader = &loader;
+
+	bool replaced = true;
+	for ( int i = 0; i < Entries.GetSizeI(); i++ )
+	{
+		Entry & entry = *Entries[i];
+		if ( entry.Replaced )
+		{
+			continue;
+		}
+
+		GlTexture texid;
+		if ( entry.Shared )
+		{
+			texid = Model.Textures[i].texid;
+		}
+		else if ( !entry.Request.IsValid() )
+		{
+			if ( !( entry.Shareable && ModelAssetCache::Get().Textures.Find( entry.ContentKey, texid ) ) )
+			{
+				// the loader takes the compressed bytes, which a deferred load always copies
+				entry.Request = loader.LoadTextureFromZipEntry( entry.Name.ToCStr(), entry.CompressedCopy,
+									entry.CompressionMethod, entry.UncompressedSize, (uint32_t)entry.Crc, Flags );
+				entry.Compressed = NULL;
+				replaced = false;
+				continue;
+			}
+		}
+		else
+		{
+			const ovrAsyncTextureState state = loader.GetState( entry.Request );
+			if ( state == ASYNC_TEXTURE_PENDING )
+			{
+				replaced = false;
+				continue;
+			}
+			if ( state == ASYNC_TEXTURE_READY )
+			{
+				texid = loader.GetTexture( entry.Request );
+			}
+			loader.FreeRequest( entry.Request );
+			entry.Request = asyncTextureHandle_t();
+			texid = FinishUpload( entry, texid, entry.UncompressedSize );
+		}
+		Replace( i, texid );
+	}
+	return replaced;
+}
+
+//-----------------------------------------------------------------------------
+//	ModelAssetCache
+//-----------------------------------------------------------------------------
+
+ModelAssetCache & ModelAssetCache::Get()
+{
+	// Never destroyed, models may still be deleted while static objects are destroyed.
+	static ModelAssetCache * cache = new ModelAssetCache();
+	return *cache;
+}
+
+static void FreeModelFileTexture( GlTexture & texid )
+{
+	bool last = false;
+	if ( !ModelAssetCache::Get().Textures.Release( texid.texture, last ) || last )
+	{
+		FreeTexture( texid );
+	}
+}
+
+static void FreeModelFileGeometry( GlGeometry & geo )
+{
+	bool last = false;
+	if ( !ModelAssetCache::Get().Geometry.Release( geo.vertexBuffer, last ) || last )
+	{
+		geo.Free();
+	}
+}
+
 //-----------------------------------------------------------------------------
 //	ModelFile
 //-----------------------------------------------------------------------------
 
 ModelFile::ModelFile() :
-	UsingSrgbTextures( false )
+	UsingSrgbTextures( false ),
+	DeferredTextures( NULL )
 {
 }
 
@@ -47,15 +363,24 @@ ModelFile::~ModelFile()
 {
 	LOG( "Destroying ModelFileModel %s", FileName.ToCStr() );
 
+	// the placeholders of deferred textures are in Textures
+	delete DeferredTextures;
+	DeferredTextures = NULL;
+
 	for ( int i = 0; i < Textures.GetSizeI(); i++ )
 	{
-		FreeTexture( Textures[i].texid );
+		FreeModelFileTexture( Textures[i].texid );
 	}
 
+	// the joint buffer is shared by all surfaces
+	const unsigned int sharedJoints = ( Def.surfaces.GetSizeI() > 0 ) ? Def.surfaces[0].graphicsCommand.uniformJoints.GetBuffer() : 0;
 	for ( int j = 0; j < Def.surfaces.GetSizeI(); j++ )
 	{
-		const_cast<GlGeometry *>(&Def.surfaces[j].geo)->Free();
-		Def.surfaces[j].graphicsCommand.uniformJoints.Destroy();
+		FreeModelFileGeometry( *const_cast<GlGeometry *>(&Def.surfaces[j].geo) );
+		if ( j == 0 || Def.surfaces[j].graphicsCommand.uniformJoints.GetBuffer() != sharedJoints )
+		{
+			Def.surfaces[j].graphicsCommand.uniformJoints.Destroy();
+		}
 	}
 }
 
@@ -132,6 +457,49 @@ Bounds3f ModelFile::GetBounds() const
 	return modelBounds;
 }
 
+bool ModelFile::UpdateDeferredTextures( ovrTextureLoader & loader ) const
+{
+	if ( DeferredTextures == NULL )
+	{
+		return true;
+	}
+
+	if ( DeferredTextures->Update( loader ) )
+	{
+		delete DeferredTextures;
+		DeferredTextures = NULL;
+	}
+	return ( DeferredTextures == NULL );
+}
+
+void ModelFile::LoadDeferredTextures( ovrWorkerPool * workers ) const
+{
+	if ( DeferredTextures == NULL )
+	{
+		return;
+	}
+
+	LOGCPUTIME( "LoadDeferredTextures" );
+
+	// entries that were decoded while the package was parsed are skipped
+	ovrModelTextureLoad & load = *DeferredTextures;
+	if ( workers != NULL )
+	{
+		workers->Run( load.Entries.GetSizeI(), ovrModelTextureLoad::DecodeTask, &load );
+	}
+	else
+	{
+		for ( int i = 0; i < load.Entries.GetSizeI(); i++ )
+		{
+			ovrModelTextureLoad::DecodeTask( &load, i );
+		}
+	}
+	load.Upload();
+
+	delete DeferredTextures;
+	DeferredTextures = NULL;
+}
+
 //-----------------------------------------------------------------------------
 //	Model Loading
 //-----------------------------------------------------------------------------
@@ -160,6 +528,324 @@ void LoadModelFileTexture( ModelFile & model, const char * textureName,
 	model.Textures.PushBack( tex );
 }
 
+enum ModelMaterialType
+{
+	MATERIAL_TYPE_OPAQUE,
+	MATERIAL_TYPE_PERFORATED,
+	MATERIAL_TYPE_TRANSPARENT,
+	MATERIAL_TYPE_ADDITIVE
+};
+
+// Returns the loaded texture with the given name, or a default texture if the texture
+// file is missing, with the sampler state for the usage applied.
+static GlTexture FindModelFileTexture( ModelFile & model, const String & name, const model_binary_usage_t usage,
+										const MaterialParms & materialParms )
+{
+	// Try to match the texture names with the already loaded texture
+	// and create a default texture if the texture file is missing.
+	int i = 0;
+	for ( ; i < model.Textures.GetSizeI(); i++ )
+	{
+		if ( model.Textures[i].name.CompareNoCase( name ) == 0 )
+		{
+			break;
+		}
+	}
+	if ( i == model.Textures.GetSizeI() )
+	{
+		LOG( "texture %s defaulted", name.ToCStr() );
+		// Create a default texture.
+		LoadModelFileTexture( model, name.ToCStr(), NULL, 0, materialParms );
+	}
+
+	// placeholders get their parameters when they are replaced
+	ovrModelTextureLoad::Entry * deferred = ( model.DeferredTextures != NULL && i < model.DeferredTextures->Entries.GetSizeI() ) ?
+												model.DeferredTextures->Entries[i] : NULL;
+
+	if ( usage == MODEL_BINARY_USAGE_DIFFUSE )
+	{
+		if ( materialParms.EnableDiffuseAniso == true )
+		{
+			if ( deferred != NULL )
+			{
+				deferred->MaxAniso = 2.0f;
+			}
+			else
+			{
+				MakeTextureAniso( model.Textures[i].texid, 2.0f );
+			}
+		}
+	}
+	else if ( usage == MODEL_BINARY_USAGE_EMISSIVE )
+	{
+		if ( materialParms.EnableEmissiveLodClamp == true )
+		{
+			// LOD clamp lightmap textures to avoid light bleeding
+			if ( deferred != NULL )
+			{
+				deferred->MaxLod = 1;
+			}
+			else
+			{
+				MakeTextureLodClamped( model.Textures[i].texid, 1 );
+			}
+		}
+	}
+
+	return model.Textures[i].texid;
+}
+
+// Sets up the render state and program of a surface once its geometry is created.
+static void SetupModelFileSurface( ModelFile & model, const int index, const ModelMaterialType materialType,
+									const int textureIndices[MODEL_BINARY_USAGE_COUNT], const Array< GlTexture > & glTextures,
+									const bool vertexColors, const bool skinned,
+									const ModelGlPrograms & programs, const MaterialParms & materialParms )
+{
+	const int diffuseTextureIndex		= textureIndices[MODEL_BINARY_USAGE_DIFFUSE];
+	const int normalTextureIndex		= textureIndices[MODEL_BINARY_USAGE_NORMAL];
+	const int specularTextureIndex		= textureIndices[MODEL_BINARY_USAGE_SPECULAR];
+	const int emissiveTextureIndex		= textureIndices[MODEL_BINARY_USAGE_EMISSIVE];
+	const int reflectionTextureIndex	= textureIndices[MODEL_BINARY_USAGE_REFLECTION];
+
+	// Create the uniform buffer for storing the joint matrices. All surfaces
+	// of the model share it, so the joints are uploaded once per frame.
+	if ( model.Joints.GetSizeI() > 0 )
+	{
+		if ( index > 0 && model.Def.surfaces[0].graphicsCommand.uniformJoints.GetBuffer() != 0 )
+		{
+			model.Def.surfaces[index].graphicsCommand.uniformJoints = model.Def.surfaces[0].graphicsCommand.uniformJoints;
+		}
+		else
+		{
+			model.Def.surfaces[index].graphicsCommand.uniformJoints.Create( GLBUFFER_TYPE_UNIFORM, model.Joints.GetSize() * sizeof( Matrix4f ), NULL );
+		}
+	}
+
+	const char * materialTypeString = "opaque";
+	OVR_UNUSED( materialTypeString );	// we'll get warnings if the LOGV's compile out
+
+	// set up additional material flags for the surface
+	if ( materialType == MATERIAL_TYPE_PERFORATED )
+	{
+		// Just blend because alpha testing is rather expensive.
+		model.Def.surfaces[index].graphicsCommand.GpuState.blendEnable = ovrGpuState::BLEND_ENABLE;
+		model.Def.surfaces[index].graphicsCommand.GpuState.depthMaskEnable = false;
+		model.Def.surfaces[index].graphicsCommand.GpuState.blendSrc = GL_SRC_ALPHA;
+		model.Def.surfaces[index].graphicsCommand.GpuState.blendDst = GL_ONE_MINUS_SRC_ALPHA;
+		materialTypeString = "perforated";
+	}
+	else if ( materialType == MATERIAL_TYPE_TRANSPARENT || materialParms.Transparent )
+	{
+		model.Def.surfaces[index].graphicsCommand.GpuState.blendEnable = ovrGpuState::BLEND_ENABLE;
+		model.Def.surfaces[index].graphicsCommand.GpuState.depthMaskEnable = false;
+		model.Def.surfaces[index].graphicsCommand.GpuState.blendSrc = GL_SRC_ALPHA;
+		model.Def.surfaces[index].graphicsCommand.GpuState.blendDst = GL_ONE_MINUS_SRC_ALPHA;
+		materialTypeString = "transparent";
+	}
+	else if ( materialType == MATERIAL_TYPE_ADDITIVE )
+	{
+		model.Def.surfaces[index].graphicsCommand.GpuState.blendEnable = ovrGpuState::BLEND_ENABLE;
+		model.Def.surfaces[index].graphicsCommand.GpuState.depthMaskEnable = false;
+		model.Def.surfaces[index].graphicsCommand.GpuState.blendSrc = GL_ONE;
+		model.Def.surfaces[index].graphicsCommand.GpuState.blendDst = GL_ONE;
+		materialTypeString = "additive";
+	}
+
+	if ( diffuseTextureIndex >= 0 && diffuseTextureIndex < glTextures.GetSizeI() )
+	{
+		model.Def.surfaces[index].graphicsCommand.uniformTextures[0] = glTextures[diffuseTextureIndex];
+
+		if ( emissiveTextureIndex >= 0 && emissiveTextureIndex < glTextures.GetSizeI() )
+		{
+			model.Def.surfaces[index].graphicsCommand.uniformTextures[1] = glTextures[emissiveTextureIndex];
+
+			if (	normalTextureIndex >= 0 && normalTextureIndex < glTextures.GetSizeI() &&
+					specularTextureIndex >= 0 && specularTextureIndex < glTextures.GetSizeI() &&
+					reflectionTextureIndex >= 0 && reflectionTextureIndex < glTextures.GetSizeI() )
+			{
+				// reflection mapped material;
+				model.Def.surfaces[index].graphicsCommand.uniformTextures[2] = glTextures[normalTextureIndex];
+				model.Def.surfaces[index].graphicsCommand.uniformTextures[3] = glTextures[specularTextureIndex];
+				model.Def.surfaces[index].graphicsCommand.uniformTextures[4] = glTextures[reflectionTextureIndex];
+
+				model.Def.surfaces[index].graphicsCommand.numUniformTextures = 5;
+				if ( skinned )
+				{
+					if ( programs.ProgSkinnedReflectionMapped == NULL )
+					{
+						FAIL( "No ProgSkinnedReflectionMapped set");
+					}
+					model.Def.surfaces[index].graphicsCommand.Program = *programs.ProgSkinnedReflectionMapped;
+					LOGV( "%s skinned reflection mapped material", materialTypeString );
+				}
+				else
+				{
+					if ( programs.ProgReflectionMapped == NULL )
+					{
+						FAIL( "No ProgReflectionMapped set");
+					}
+					model.Def.surfaces[index].graphicsCommand.Program = *programs.ProgReflectionMapped;
+					LOGV( "%s reflection mapped material", materialTypeString );
+				}
+			}
+			else
+			{
+				// light mapped material
+				model.Def.surfaces[index].graphicsCommand.numUniformTextures = 2;
+				if ( skinned )
+				{
+					if ( programs.ProgSkinnedLightMapped == NULL )
+					{
+						FAIL( "No ProgSkinnedLightMapped set");
+					}
+					model.Def.surfaces[index].graphicsCommand.Program = *programs.ProgSkinnedLightMapped;
+					LOGV( "%s skinned light mapped material", materialTypeString );
+				}
+				else
+				{
+					if ( programs.ProgLightMapped == NULL )
+					{
+						FAIL( "No ProgLightMapped set");
+					}
+					model.Def.surfaces[index].graphicsCommand.Program = *programs.ProgLightMapped;
+					LOGV( "%s light mapped material", materialTypeString );
+				}
+			}
+		}
+		else
+		{
+			// diffuse only material
+			model.Def.surfaces[index].graphicsCommand.numUniformTextures = 1;
+			if ( skinned )
+			{
+				if ( programs.ProgSkinnedSingleTexture == NULL )
+				{
+					FAIL( "No ProgSkinnedSingleTexture set");
+				}
+				model.Def.surfaces[index].graphicsCommand.Program = *programs.ProgSkinnedSingleTexture;
+				LOGV( "%s skinned diffuse only material", materialTypeString );
+			}
+			else
+			{
+				if ( programs.ProgSingleTexture == NULL )
+				{
+					FAIL( "No ProgSingleTexture set");
+				}
+				model.Def.surfaces[index].graphicsCommand.Program = *programs.ProgSingleTexture;
+				LOGV( "%s diffuse only material", materialTypeString );
+			}
+		}
+	}
+	else if ( vertexColors )
+	{
+		// vertex color material
+		model.Def.surfaces[index].graphicsCommand.numUniformTextures = 0;
+		if ( skinned )
+		{
+			if ( programs.ProgSkinnedVertexColor == NULL )
+			{
+				FAIL( "No ProgSkinnedVertexColor set");
+			}
+			model.Def.surfaces[index].graphicsCommand.Program = *programs.ProgSkinnedVertexColor;
+			LOGV( "%s skinned vertex color material", materialTypeString );
+		}
+		else
+		{
+			if ( programs.ProgVertexColor == NULL )
+			{
+				FAIL( "No ProgVertexColor set");
+			}
+			model.Def.surfaces[index].graphicsCommand.Program = *programs.ProgVertexColor;
+			LOGV( "%s vertex color material", materialTypeString );
+		}
+	}
+	else
+	{
+		// surface without texture or vertex colors
+		model.Def.surfaces[index].graphicsCommand.uniformTextures[0] = GlTexture();
+		model.Def.surfaces[index].graphicsCommand.numUniformTextures = 1;
+		if ( skinned )
+		{
+			if ( programs.ProgSkinnedSingleTexture == NULL )
+			{
+				FAIL( "No ProgSkinnedSingleTexture set");
+			}
+			model.Def.surfaces[index].graphicsCommand.Program = *programs.ProgSkinnedSingleTexture;
+			LOGV( "%s skinned default texture material", materialTypeString );
+		}
+		else
+		{
+			if ( programs.ProgSingleTexture == NULL )
+			{
+				FAIL( "No ProgSingleTexture set");
+			}
+			model.Def.surfaces[index].graphicsCommand.Program = *programs.ProgSingleTexture;
+			LOGV( "%s default texture material", materialTypeString );
+		}
+	}
+
+	if ( materialParms.PolygonOffset )
+	{
+		model.Def.surfaces[index].graphicsCommand.GpuState.polygonOffsetEnable = true;
+		LOGV( "polygon offset material" );
+	}
+}
+
+// With MaterialParms::ShareAssets, the surface geometry is looked up by this key
+// before it is created, and shared after.
+template< typename _type_ >
+static uint64_t HashModelArray( const Array< _type_ > & array, const uint64_t key, size_t & bytes )
+{
+	bytes += array.GetSize() * sizeof( _type_ );
+	return HashAssetContent( array.GetDataPtr(), array.GetSize() * sizeof( _type_ ), key );
+}
+
+static uint64_t GetModelGeometryKey( const VertexAttribs & attribs, const Array< TriangleIndex > & indices, size_t & bytes )
+{
+	bytes = 0;
+	uint64_t key = 0;
+	key = HashModelArray( attribs.position, key, bytes );
+	key = HashModelArray( attribs.normal, key, bytes );
+	key = HashModelArray( attribs.tangent, key, bytes );
+	key = HashModelArray( attribs.binormal, key, bytes );
+	key = HashModelArray( attribs.color, key, bytes );
+	key = HashModelArray( attribs.uv0, key, bytes );
+	key = HashModelArray( attribs.uv1, key, bytes );
+	key = HashModelArray( attribs.jointIndices, key, bytes );
+	key = HashModelArray( attribs.jointWeights, key, bytes );
+	key = HashModelArray( indices, key, bytes );
+	return key;
+}
+
+static uint64_t GetModelGeometryKey( const uint8_t * vertices, const int attribMask, const int numVertices,
+									const TriangleIndex * indices, const int numIndices, const Bounds3f & bounds, size_t & bytes )
+{
+	size_t vertexSize = 0;
+	for ( int i = 0; i < MODEL_BINARY_ATTRIBUTE_COUNT; i++ )
+	{
+		if ( ( attribMask & ( 1 << i ) ) != 0 )
+		{
+			vertexSize += ModelBinaryAttributeSize[i];
+		}
+	}
+	const uint64_t parms[] = { (uint64_t)attribMask, (uint64_t)numVertices, (uint64_t)numIndices };
+	uint64_t key = HashAssetContent( parms, sizeof( parms ) );
+	key = HashAssetContent( &bounds, sizeof( bounds ), key );
+	key = HashAssetContent( vertices, vertexSize * numVertices, key );
+	key = HashAssetContent( indices, numIndices * sizeof( TriangleIndex ), key );
+	bytes = vertexSize * numVertices + numIndices * sizeof( TriangleIndex );
+	return key;
+}
+
+static void ShareModelGeometry( const uint64_t key, const size_t bytes, GlGeometry & geo )
+{
+	GlGeometry created = geo;
+	if ( !ModelAssetCache::Get().Geometry.Add( key, geo.vertexBuffer, bytes, geo ) )
+	{
+		created.Free();
+	}
+}
+
 template< typename _type_ >
 void ReadModelArray( Array< _type_ > & out, const char * string, const BinaryReader & bin, const int numElements )
 {
@@ -231,41 +917,16 @@ void LoadModelFileJson( ModelFile & model,
 					if ( texture.IsObject() )
 					{
 						const String name = texture.GetChildStringByName( "name" );
+						const String usage = texture.GetChildStringByName( "usage" );
 
-						// Try to match the texture names with the already loaded texture
-						// and create a default texture if the texture file is missing.
-						int i = 0;
-						for ( ; i < model.Textures.GetSizeI(); i++ )
-						{
-							if ( model.Textures[i].name.CompareNoCase( name ) == 0 )
-							{
-								break;
-							}
-						}
-						if ( i == model.Textures.GetSizeI() )
-						{
-							LOG( "texture %s defaulted", name.ToCStr() );
-							// Create a default texture.
-							LoadModelFileTexture( model, name.ToCStr(), NULL, 0, materialParms );
-						}
-						glTextures.PushBack( model.Textures[i].texid );
+						model_binary_usage_t textureUsage = MODEL_BINARY_USAGE_COUNT;
+						if ( usage == "diffuse" )			{ textureUsage = MODEL_BINARY_USAGE_DIFFUSE; }
+						else if ( usage == "normal" )		{ textureUsage = MODEL_BINARY_USAGE_NORMAL; }
+						else if ( usage == "specular" )		{ textureUsage = MODEL_BINARY_USAGE_SPECULAR; }
+						else if ( usage == "emissive" )		{ textureUsage = MODEL_BINARY_USAGE_EMISSIVE; }
+						else if ( usage == "reflection" )	{ textureUsage = MODEL_BINARY_USAGE_REFLECTION; }
 
-						const String usage = texture.GetChildStringByName( "usage" );
-						if ( usage == "diffuse" )
-						{
-							if ( materialParms.EnableDiffuseAniso == true )
-							{
-								MakeTextureAniso( model.Textures[i].texid, 2.0f );
-							}
-						}
-						else if ( usage == "emissive" )
-						{
-							if ( materialParms.EnableEmissiveLodClamp == true )
-							{
-								// LOD clamp lightmap textures to avoid light bleeding
-								MakeTextureLodClamped( model.Textures[i].texid, 1 );
-							}
-						}
+						glTextures.PushBack( FindModelFileTexture( model, name, textureUsage, materialParms ) );
 						/*
 						const String occlusion = texture.GetChildStringByName( "occlusion" );
 
@@ -296,6 +957,7 @@ void LoadModelFileJson( ModelFile & model,
 						model.Joints[index].index = static_cast<int>( index );
 						model.Joints[index].name = joint.GetChildStringByName( "name" );
 						StringUtils::StringTo( model.Joints[index].transform, joint.GetChildStringByName( "transform" ).ToCStr() );
+						model.Joints[index].inverseTransform = model.Joints[index].transform.Inverted();
 						model.Joints[index].animation = MODEL_JOINT_ANIMATION_NONE;
 						const String animation = joint.GetChildStringByName( "animation" );
 						if ( animation == "none" )			{ model.Joints[index].animation = MODEL_JOINT_ANIMATION_NONE; }
@@ -371,19 +1033,8 @@ void LoadModelFileJson( ModelFile & model,
 						// Surface Material
 						//
 
-						enum
-						{
-							MATERIAL_TYPE_OPAQUE,
-							MATERIAL_TYPE_PERFORATED,
-							MATERIAL_TYPE_TRANSPARENT,
-							MATERIAL_TYPE_ADDITIVE
-						} materialType = MATERIAL_TYPE_OPAQUE;
-
-						int diffuseTextureIndex = -1;
-						int normalTextureIndex = -1;
-						int specularTextureIndex = -1;
-						int emissiveTextureIndex = -1;
-						int reflectionTextureIndex = -1;
+						ModelMaterialType materialType = MATERIAL_TYPE_OPAQUE;
+						int textureIndices[MODEL_BINARY_USAGE_COUNT] = { -1, -1, -1, -1, -1 };
 
 						const JsonReader material( surface.GetChildByName( "material" ) );
 						if ( material.IsObject() )
@@ -395,11 +1046,11 @@ void LoadModelFileJson( ModelFile & model,
 							else if ( type == "transparent" )	{ materialType = MATERIAL_TYPE_TRANSPARENT; }
 							else if ( type == "additive" )		{ materialType = MATERIAL_TYPE_ADDITIVE; }
 
-							diffuseTextureIndex		= material.GetChildInt32ByName( "diffuse", -1 );
-							normalTextureIndex		= material.GetChildInt32ByName( "normal", -1 );
-							specularTextureIndex	= material.GetChildInt32ByName( "specular", -1 );
-							emissiveTextureIndex	= material.GetChildInt32ByName( "emissive", -1 );
-							reflectionTextureIndex	= material.GetChildInt32ByName( "reflection", -1 );
+							textureIndices[MODEL_BINARY_USAGE_DIFFUSE]		= material.GetChildInt32ByName( "diffuse", -1 );
+							textureIndices[MODEL_BINARY_USAGE_NORMAL]		= material.GetChildInt32ByName( "normal", -1 );
+							textureIndices[MODEL_BINARY_USAGE_SPECULAR]		= material.GetChildInt32ByName( "specular", -1 );
+							textureIndices[MODEL_BINARY_USAGE_EMISSIVE]		= material.GetChildInt32ByName( "emissive", -1 );
+							textureIndices[MODEL_BINARY_USAGE_REFLECTION]	= material.GetChildInt32ByName( "reflection", -1 );
 						}
 
 						//
@@ -471,185 +1122,27 @@ void LoadModelFileJson( ModelFile & model,
 						// Setup geometry, textures and render programs now that the vertex attributes are known.
 						//
 
-						model.Def.surfaces[index].geo.Create( attribs, indices );
-
-						// Create the uniform buffer for storing the joint matrices.
-						if ( model.Joints.GetSizeI() > 0 )
-						{
-							model.Def.surfaces[index].graphicsCommand.uniformJoints.Create( GLBUFFER_TYPE_UNIFORM, model.Joints.GetSize() * sizeof( Matrix4f ), NULL );
-						}
-
-						const char * materialTypeString = "opaque";
-						OVR_UNUSED( materialTypeString );	// we'll get warnings if the LOGV's compile out
-
-						// set up additional material flags for the surface
-						if ( materialType == MATERIAL_TYPE_PERFORATED )
-						{
-							// Just blend because alpha testing is rather expensive.
-							model.Def.surfaces[index].graphicsCommand.GpuState.blendEnable = ovrGpuState::BLEND_ENABLE;
-							model.Def.surfaces[index].graphicsCommand.GpuState.depthMaskEnable = false;
-							model.Def.surfaces[index].graphicsCommand.GpuState.blendSrc = GL_SRC_ALPHA;
-							model.Def.surfaces[index].graphicsCommand.GpuState.blendDst = GL_ONE_MINUS_SRC_ALPHA;
-							materialTypeString = "perforated";
-						}
-						else if ( materialType == MATERIAL_TYPE_TRANSPARENT || materialParms.Transparent )
-						{
-							model.Def.surfaces[index].graphicsCommand.GpuState.blendEnable = ovrGpuState::BLEND_ENABLE;
-							model.Def.surfaces[index].graphicsCommand.GpuState.depthMaskEnable = false;
-							model.Def.surfaces[index].graphicsCommand.GpuState.blendSrc = GL_SRC_ALPHA;
-							model.Def.surfaces[index].graphicsCommand.GpuState.blendDst = GL_ONE_MINUS_SRC_ALPHA;
-							materialTypeString = "transparent";
-						}
-						else if ( materialType == MATERIAL_TYPE_ADDITIVE )
-						{
-							model.Def.surfaces[index].graphicsCommand.GpuState.blendEnable = ovrGpuState::BLEND_ENABLE;
-							model.Def.surfaces[index].graphicsCommand.GpuState.depthMaskEnable = false;
-							model.Def.surfaces[index].graphicsCommand.GpuState.blendSrc = GL_ONE;
-							model.Def.surfaces[index].graphicsCommand.GpuState.blendDst = GL_ONE;
-							materialTypeString = "additive";
-						}
-
-						const bool skinned = (	attribs.jointIndices.GetSize() == attribs.position.GetSize() &&
-												attribs.jointWeights.GetSize() == attribs.position.GetSize() );
-
-						if ( diffuseTextureIndex >= 0 && diffuseTextureIndex < glTextures.GetSizeI() )
+						GlGeometry & geo = model.Def.surfaces[index].geo;
+						if ( materialParms.ShareAssets )
 						{
-							model.Def.surfaces[index].graphicsCommand.uniformTextures[0] = glTextures[diffuseTextureIndex];
-
-							if ( emissiveTextureIndex >= 0 && emissiveTextureIndex < glTextures.GetSizeI() )
-							{
-								model.Def.surfaces[index].graphicsCommand.uniformTextures[1] = glTextures[emissiveTextureIndex];
-
-								if (	normalTextureIndex >= 0 && normalTextureIndex < glTextures.GetSizeI() &&
-										specularTextureIndex >= 0 && specularTextureIndex < glTextures.GetSizeI() &&
-										reflectionTextureIndex >= 0 && reflectionTextureIndex < glTextures.GetSizeI() )
-								{
-									// reflection mapped material;
-									model.Def.surfaces[index].graphicsCommand.uniformTextures[2] = glTextures[normalTextureIndex];
-									model.Def.surfaces[index].graphicsCommand.uniformTextures[3] = glTextures[specularTextureIndex];
-									model.Def.surfaces[index].graphicsCommand.uniformTextures[4] = glTextures[reflectionTextureIndex];
-
-									model.Def.surfaces[index].graphicsCommand.numUniformTextures = 5;
-									if ( skinned )
-									{
-										if ( programs.ProgSkinnedReflectionMapped == NULL )
-										{
-											FAIL( "No ProgSkinnedReflectionMapped set");
-										}
-										model.Def.surfaces[index].graphicsCommand.Program = *programs.ProgSkinnedReflectionMapped;
-										LOGV( "%s skinned reflection mapped material", materialTypeString );
-									}
-									else
-									{
-										if ( programs.ProgReflectionMapped == NULL )
-										{
-											FAIL( "No ProgReflectionMapped set");
-										}
-										model.Def.surfaces[index].graphicsCommand.Program = *programs.ProgReflectionMapped;
-										LOGV( "%s reflection mapped material", materialTypeString );
-									}
-								}
-								else
-								{
-									// light mapped material
-									model.Def.surfaces[index].graphicsCommand.numUniformTextures = 2;
-									if ( skinned )
-									{
-										if ( programs.ProgSkinnedLightMapped == NULL )
-										{
-											FAIL( "No ProgSkinnedLightMapped set");
-										}
-										model.Def.surfaces[index].graphicsCommand.Program = *programs.ProgSkinnedLightMapped;
-										LOGV( "%s skinned light mapped material", materialTypeString );
-									}
-									else
-									{
-										if ( programs.ProgLightMapped == NULL )
-										{
-											FAIL( "No ProgLightMapped set");
-										}
-										model.Def.surfaces[index].graphicsCommand.Program = *programs.ProgLightMapped;
-										LOGV( "%s light mapped material", materialTypeString );
-									}
-								}
-							}
-							else
-							{
-								// diffuse only material
-								model.Def.surfaces[index].graphicsCommand.numUniformTextures = 1;
-								if ( skinned )
-								{
-									if ( programs.ProgSkinnedSingleTexture == NULL )
-									{
-										FAIL( "No ProgSkinnedSingleTexture set");
-									}
-									model.Def.surfaces[index].graphicsCommand.Program = *programs.ProgSkinnedSingleTexture;
-									LOGV( "%s skinned diffuse only material", materialTypeString );
-								}
-								else
-								{
-									if ( programs.ProgSingleTexture == NULL )
-									{
-										FAIL( "No ProgSingleTexture set");
-									}
-									model.Def.surfaces[index].graphicsCommand.Program = *programs.ProgSingleTexture;
-									LOGV( "%s diffuse only material", materialTypeString );
-								}
-							}
-						}
-						else if ( attribs.color.GetSizeI() > 0 )
-						{
-							// vertex color material
-							model.Def.surfaces[index].graphicsCommand.numUniformTextures = 0;
-							if ( skinned )
-							{
-								if ( programs.ProgSkinnedVertexColor == NULL )
-								{
-									FAIL( "No ProgSkinnedVertexColor set");
-								}
-								model.Def.surfaces[index].graphicsCommand.Program = *programs.ProgSkinnedVertexColor;
-								LOGV( "%s skinned vertex color material", materialTypeString );
-							}
-							else
-							{
-								if ( programs.ProgVertexColor == NULL )
-								{
-									FAIL( "No ProgVertexColor set");
-								}
-								model.Def.surfaces[index].graphicsCommand.Program = *programs.ProgVertexColor;
-								LOGV( "%s vertex color material", materialTypeString );
-							}
-						}
-						else
-						{
-							// surface without texture or vertex colors
-							model.Def.surfaces[index].graphicsCommand.uniformTextures[0] = GlTexture();
-							model.Def.surfaces[index].graphicsCommand.numUniformTextures = 1;
-							if ( skinned )
-							{
-								if ( programs.ProgSkinnedSingleTexture == NULL )
-								{
-									FAIL( "No ProgSkinnedSingleTexture set");
-								}
-								model.Def.surfaces[index].graphicsCommand.Program = *programs.ProgSkinnedSingleTexture;
-								LOGV( "%s skinned default texture material", materialTypeString );
-							}
-							else
-							{
-								if ( programs.ProgSingleTexture == NULL )
-								{
-									FAIL( "No ProgSingleTexture set");
-								}
-								model.Def.surfaces[index].graphicsCommand.Program = *programs.ProgSingleTexture;
-								LOGV( "%s default texture material", materialTypeString );
+							size_t bytes = 0;
+							const uint64_t key = GetModelGeometryKey( attribs, indices, bytes );
+							if ( !ModelAssetCache::Get().Geometry.Find( key, geo ) )
+							{
+								geo.Create( attribs, indices );
+								ShareModelGeometry( key, bytes, geo );
 							}
 						}
-
-						if ( materialParms.PolygonOffset )
+						else
 						{
-							model.Def.surfaces[index].graphicsCommand.GpuState.polygonOffsetEnable = true;
-							LOGV( "polygon offset material" );
+							geo.Create( attribs, indices );
 						}
+
+						const bool skinned = (	attribs.jointIndices.GetSize() == attribs.position.GetSize() &&
+												attribs.jointWeights.GetSize() == attribs.position.GetSize() );
+
+						SetupModelFileSurface( model, index, materialType, textureIndices, glTextures,
+												attribs.color.GetSizeI() > 0, skinned, programs, materialParms );
 					}
 				}
 			}
@@ -716,11 +1209,6 @@ void LoadModelFileJson( ModelFile & model,
 			traceModel.header.numNodes		= raytrace_model.GetChildInt32ByName( "numNodes" );
 			traceModel.header.numLeafs		= raytrace_model.GetChildInt32ByName( "numLeafs" );
 			traceModel.header.numOverflow	= raytrace_model.GetChildInt32ByName( "numOverflow" );
-			if ( !traceModel.Validate( true ) )
-			{
-				// this is a fatal error so that a model file from an untrusted source is never able to cause out-of-bounds reads.
-				FAIL( "Invalid model data" );
-			}
 
 			StringUtils::StringTo( traceModel.header.bounds, raytrace_model.GetChildStringByName( "bounds" ).ToCStr() );
 
@@ -768,6 +1256,12 @@ void LoadModelFileJson( ModelFile & model,
 			}
 
 			ReadModelArray( traceModel.overflow, raytrace_model.GetChildStringByName( "overflow" ).ToCStr(), bin, traceModel.header.numOverflow );
+
+			if ( !traceModel.Validate( true ) )
+			{
+				// this is a fatal error so that a model file from an untrusted source is never able to cause out-of-bounds reads.
+				FAIL( "Invalid model data" );
+			}
 		}
 	}
 	json->Release();
@@ -778,6 +1272,505 @@ void LoadModelFileJson( ModelFile & model,
 	}
 }
 
+// Returns the chunk with the given id, or NULL if the file has none.
+static const model_binary_chunk_t * FindModelBinaryChunk( const uint8_t * data, const uint32_t id )
+{
+	const model_binary_header_t * header = (const model_binary_header_t *)data;
+	const model_binary_chunk_t * chunks = (const model_binary_chunk_t *)( header + 1 );
+	for ( uint32_t i = 0; i < header->numChunks; i++ )
+	{
+		if ( chunks[i].id == id )
+		{
+			return &chunks[i];
+		}
+	}
+	return NULL;
+}
+
+// Verifies that every offset, count and index in the file stays within the file, so the
+// loader below can use the records without further checks.
+static bool ValidateModelBinary( const uint8_t * data, const int dataLength )
+{
+	if ( dataLength < (int)sizeof( model_binary_header_t ) || ( (size_t)data & 3 ) != 0 )
+	{
+		return false;
+	}
+	const model_binary_header_t * header = (const model_binary_header_t *)data;
+	if ( header->magic != MODEL_BINARY_MAGIC || header->version != MODEL_BINARY_VERSION || header->fileSize != (uint32_t)dataLength )
+	{
+		LOG( "ValidateModelBinary: bad header %08X version %d", header->magic, header->version );
+		return false;
+	}
+	if ( (uint64_t)header->numChunks * sizeof( model_binary_chunk_t ) > (uint64_t)dataLength - sizeof( model_binary_header_t ) )
+	{
+		return false;
+	}
+
+	static const struct
+	{
+		uint32_t	id;
+		uint32_t	recordSize;
+	} recordSizes[] =
+	{
+		{ MODEL_BINARY_CHUNK_STRINGS,			1 },
+		{ MODEL_BINARY_CHUNK_TEXTURES,			sizeof( model_binary_texture_t ) },
+		{ MODEL_BINARY_CHUNK_JOINTS,			sizeof( model_binary_joint_t ) },
+		{ MODEL_BINARY_CHUNK_TAGS,				sizeof( model_binary_tag_t ) },
+		{ MODEL_BINARY_CHUNK_SURFACES,			sizeof( model_binary_surface_t ) },
+		{ MODEL_BINARY_CHUNK_VERTICES,			1 },
+		{ MODEL_BINARY_CHUNK_INDICES,			sizeof( TriangleIndex ) },
+		{ MODEL_BINARY_CHUNK_COLLISION,			sizeof( model_binary_polytope_t ) },
+		{ MODEL_BINARY_CHUNK_GROUND_COLLISION,	sizeof( model_binary_polytope_t ) },
+		{ MODEL_BINARY_CHUNK_PLANES,			sizeof( Planef ) },
+		{ MODEL_BINARY_CHUNK_TRACE,				sizeof( model_binary_trace_t ) },
+		{ MODEL_BINARY_CHUNK_TRACE_VERTICES,	sizeof( Vector3f ) },
+		{ MODEL_BINARY_CHUNK_TRACE_UVS,			sizeof( Vector2f ) },
+		{ MODEL_BINARY_CHUNK_TRACE_INDICES,		sizeof( int ) },
+		{ MODEL_BINARY_CHUNK_TRACE_NODES,		sizeof( kdtree_node_t ) },
+		{ MODEL_BINARY_CHUNK_TRACE_LEAFS,		sizeof( kdtree_leaf_t ) },
+		{ MODEL_BINARY_CHUNK_TRACE_OVERFLOW,	sizeof( int ) }
+	};
+
+	const model_binary_chunk_t * chunks = (const model_binary_chunk_t *)( header + 1 );
+	for ( uint32_t i = 0; i < header->numChunks; i++ )
+	{
+		if ( ( chunks[i].offset & 3 ) != 0 || (uint64_t)chunks[i].offset + chunks[i].size > (uint64_t)dataLength )
+		{
+			LOG( "ValidateModelBinary: chunk %d out of range", chunks[i].id );
+			return false;
+		}
+		for ( int j = 0; j < (int)( sizeof( recordSizes ) / sizeof( recordSizes[0] ) ); j++ )
+		{
+			if ( recordSizes[j].id == chunks[i].id && (uint64_t)chunks[i].count * recordSizes[j].recordSize != chunks[i].size )
+			{
+				LOG( "ValidateModelBinary: chunk %d has a bad size", chunks[i].id );
+				return false;
+			}
+		}
+	}
+
+	// every name must be a string
+	const model_binary_chunk_t * strings = FindModelBinaryChunk( data, MODEL_BINARY_CHUNK_STRINGS );
+	if ( strings == NULL || strings->size == 0 || data[strings->offset + strings->size - 1] != '\0' )
+	{
+		return false;
+	}
+	static const uint32_t namedChunks[] =
+	{
+		MODEL_BINARY_CHUNK_TEXTURES,
+		MODEL_BINARY_CHUNK_JOINTS,
+		MODEL_BINARY_CHUNK_TAGS,
+		MODEL_BINARY_CHUNK_SURFACES,
+		MODEL_BINARY_CHUNK_COLLISION,
+		MODEL_BINARY_CHUNK_GROUND_COLLISION
+	};
+	for ( int i = 0; i < (int)( sizeof( namedChunks ) / sizeof( namedChunks[0] ) ); i++ )
+	{
+		const model_binary_chunk_t * chunk = FindModelBinaryChunk( data, namedChunks[i] );
+		if ( chunk != NULL && chunk->count > 0 )
+		{
+			// all named records start with the name
+			const uint32_t recordSize = chunk->size / chunk->count;
+			for ( uint32_t j = 0; j < chunk->count; j++ )
+			{
+				if ( *(const uint32_t *)( data + chunk->offset + j * recordSize ) >= strings->size )
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	// surface geometry
+	const model_binary_chunk_t * surfaces = FindModelBinaryChunk( data, MODEL_BINARY_CHUNK_SURFACES );
+	if ( surfaces != NULL && surfaces->count > 0 )
+	{
+		const model_binary_chunk_t * vertices = FindModelBinaryChunk( data, MODEL_BINARY_CHUNK_VERTICES );
+		const model_binary_chunk_t * indices = FindModelBinaryChunk( data, MODEL_BINARY_CHUNK_INDICES );
+		if ( vertices == NULL || indices == NULL )
+		{
+			return false;
+		}
+		const model_binary_surface_t * surface = (const model_binary_surface_t *)( data + surfaces->offset );
+		for ( uint32_t i = 0; i < surfaces->count; i++, surface++ )
+		{
+			uint32_t vertexSize = 0;
+			for ( int j = 0; j < MODEL_BINARY_ATTRIBUTE_COUNT; j++ )
+			{
+				vertexSize += ( surface->vertexAttribs & ( 1 << j ) ) ? ModelBinaryAttributeSize[j] : 0;
+			}
+			if (	surface->vertexCount > (uint32_t)GlGeometry::MAX_GEOMETRY_VERTICES ||
+					surface->indexCount > (uint32_t)GlGeometry::MAX_GEOMETRY_INDICES ||
+					( surface->vertexOffset & 3 ) != 0 ||
+					(uint64_t)surface->vertexOffset + (uint64_t)surface->vertexCount * vertexSize > vertices->size ||
+					( surface->indexOffset & 1 ) != 0 ||
+					(uint64_t)surface->indexOffset + (uint64_t)surface->indexCount * sizeof( TriangleIndex ) > indices->size )
+			{
+				LOG( "ValidateModelBinary: surface %d out of range", i );
+				return false;
+			}
+			// the indices go straight to the GPU
+			const TriangleIndex * surfaceIndices = (const TriangleIndex *)( data + indices->offset + surface->indexOffset );
+			for ( uint32_t j = 0; j < surface->indexCount; j++ )
+			{
+				if ( surfaceIndices[j] >= surface->vertexCount )
+				{
+					LOG( "ValidateModelBinary: surface %d index out of range", i );
+					return false;
+				}
+			}
+		}
+	}
+
+	// collision planes
+	const model_binary_chunk_t * planes = FindModelBinaryChunk( data, MODEL_BINARY_CHUNK_PLANES );
+	for ( uint32_t id = MODEL_BINARY_CHUNK_COLLISION; id <= MODEL_BINARY_CHUNK_GROUND_COLLISION; id++ )
+	{
+		const model_binary_chunk_t * polytopes = FindModelBinaryChunk( data, id );
+		if ( polytopes != NULL && polytopes->count > 0 )
+		{
+			const model_binary_polytope_t * polytope = (const model_binary_polytope_t *)( data + polytopes->offset );
+			for ( uint32_t i = 0; i < polytopes->count; i++, polytope++ )
+			{
+				if ( planes == NULL || (uint64_t)polytope->firstPlane + polytope->numPlanes > planes->count )
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	// The ray-trace arrays are checked against the header here and the indices
+	// by ModelTrace::Validate, which LoadModelFileBinary calls before it loads
+	// anything else.
+	const model_binary_chunk_t * trace = FindModelBinaryChunk( data, MODEL_BINARY_CHUNK_TRACE );
+	if ( trace != NULL && trace->count > 0 )
+	{
+		const model_binary_trace_t * traceHeader = (const model_binary_trace_t *)( data + trace->offset );
+		const int32_t * counts = &traceHeader->numVertices;
+		for ( uint32_t id = MODEL_BINARY_CHUNK_TRACE_VERTICES; id <= MODEL_BINARY_CHUNK_TRACE_OVERFLOW; id++ )
+		{
+			const model_binary_chunk_t * chunk = FindModelBinaryChunk( data, id );
+			if ( counts[id - MODEL_BINARY_CHUNK_TRACE_VERTICES] != ( chunk != NULL ? (int32_t)chunk->count : 0 ) )
+			{
+				LOG( "ValidateModelBinary: ray-trace chunk %d does not match the header", id );
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+template< typename _type_ >
+static void ReadModelBinaryArray( Array< _type_ > & out, const uint8_t * data, const uint32_t id )
+{
+	const model_binary_chunk_t * chunk = FindModelBinaryChunk( data, id );
+	out.Resize( chunk != NULL ? chunk->count : 0 );
+	if ( out.GetSize() > 0 )
+	{
+		memcpy( out.GetDataPtr(), data + chunk->offset, chunk->size );
+	}
+}
+
+// Loads a models.ovrm file, see ModelBinary.h. The geometry is uploaded straight from
+// the file data and everything else is copied out with one memcpy per array. Returns
+// false without touching the model if the file is not valid.
+bool LoadModelFileBinary( ModelFile & model,
+						const char * modelsBinary, const int modelsBinaryLength,
+						const ModelGlPrograms & programs, const MaterialParms & materialParms,
+						ModelGeo * outModelGeo )
+{
+	LOG( "loading %s", model.FileName.ToCStr() );
+
+	const uint8_t * data = (const uint8_t *)modelsBinary;
+	if ( !ValidateModelBinary( data, modelsBinaryLength ) )
+	{
+		WARN( "LoadModelFileBinary: bad %s in %s", MODEL_BINARY_FILE_NAME, model.FileName.ToCStr() );
+		return false;
+	}
+
+	//
+	// Ray-Trace Model
+	//
+
+	const model_binary_chunk_t * trace = FindModelBinaryChunk( data, MODEL_BINARY_CHUNK_TRACE );
+	if ( trace != NULL && trace->count > 0 )
+	{
+		ModelTrace & traceModel = model.TraceModel;
+		const model_binary_trace_t * traceHeader = (const model_binary_trace_t *)( data + trace->offset );
+
+		traceModel.header.numVertices	= traceHeader->numVertices;
+		traceModel.header.numUvs		= traceHeader->numUvs;
+		traceModel.header.numIndices	= traceHeader->numIndices;
+		traceModel.header.numNodes		= traceHeader->numNodes;
+		traceModel.header.numLeafs		= traceHeader->numLeafs;
+		traceModel.header.numOverflow	= traceHeader->numOverflow;
+		traceModel.header.bounds = Bounds3f( Vector3f( traceHeader->bounds[0][0], traceHeader->bounds[0][1], traceHeader->bounds[0][2] ),
+											Vector3f( traceHeader->bounds[1][0], traceHeader->bounds[1][1], traceHeader->bounds[1][2] ) );
+
+		ReadModelBinaryArray( traceModel.vertices, data, MODEL_BINARY_CHUNK_TRACE_VERTICES );
+		ReadModelBinaryArray( traceModel.uvs, data, MODEL_BINARY_CHUNK_TRACE_UVS );
+		ReadModelBinaryArray( traceModel.indices, data, MODEL_BINARY_CHUNK_TRACE_INDICES );
+		ReadModelBinaryArray( traceModel.nodes, data, MODEL_BINARY_CHUNK_TRACE_NODES );
+		ReadModelBinaryArray( traceModel.leafs, data, MODEL_BINARY_CHUNK_TRACE_LEAFS );
+		ReadModelBinaryArray( traceModel.overflow, data, MODEL_BINARY_CHUNK_TRACE_OVERFLOW );
+
+		// ValidateModelBinary only checks the counts, the indices are checked here
+		// before anything else is loaded, so that models.json can be used instead.
+		if ( !traceModel.Validate( true ) )
+		{
+			WARN( "LoadModelFileBinary: bad ray-trace model in %s", model.FileName.ToCStr() );
+			model.TraceModel = ModelTrace();
+			return false;
+		}
+	}
+
+	const char * strings = (const char *)data + FindModelBinaryChunk( data, MODEL_BINARY_CHUNK_STRINGS )->offset;
+
+	//
+	// Render Model Textures
+	//
+
+	Array< GlTexture > glTextures;
+
+	const model_binary_chunk_t * textures = FindModelBinaryChunk( data, MODEL_BINARY_CHUNK_TEXTURES );
+	if ( textures != NULL )
+	{
+		const model_binary_texture_t * texture = (const model_binary_texture_t *)( data + textures->offset );
+		glTextures.Reserve( textures->count );
+		for ( uint32_t i = 0; i < textures->count; i++ )
+		{
+			glTextures.PushBack( FindModelFileTexture( model, String( strings + texture[i].name ), (model_binary_usage_t)texture[i].usage, materialParms ) );
+		}
+	}
+
+	//
+	// Render Model Joints
+	//
+
+	const model_binary_chunk_t * joints = FindModelBinaryChunk( data, MODEL_BINARY_CHUNK_JOINTS );
+	if ( joints != NULL )
+	{
+		const model_binary_joint_t * joint = (const model_binary_joint_t *)( data + joints->offset );
+		model.Joints.Resize( joints->count );
+		for ( uint32_t i = 0; i < joints->count; i++ )
+		{
+			model.Joints[i].index = i;
+			model.Joints[i].name = strings + joint[i].name;
+			memcpy( model.Joints[i].transform.M, joint[i].transform, sizeof( joint[i].transform ) );
+			model.Joints[i].inverseTransform = model.Joints[i].transform.Inverted();
+			model.Joints[i].animation = ( joint[i].animation <= MODEL_JOINT_ANIMATION_BOB ) ? (ModelJointAnimation)joint[i].animation : MODEL_JOINT_ANIMATION_NONE;
+			model.Joints[i].parameters = Vector3f( joint[i].parameters[0], joint[i].parameters[1], joint[i].parameters[2] );
+			model.Joints[i].timeOffset = joint[i].timeOffset;
+			model.Joints[i].timeScale = joint[i].timeScale;
+		}
+	}
+
+	//
+	// Render Model Tags
+	//
+
+	const model_binary_chunk_t * tags = FindModelBinaryChunk( data, MODEL_BINARY_CHUNK_TAGS );
+	if ( tags != NULL )
+	{
+		const model_binary_tag_t * tag = (const model_binary_tag_t *)( data + tags->offset );
+		model.Tags.Resize( tags->count );
+		for ( uint32_t i = 0; i < tags->count; i++ )
+		{
+			model.Tags[i].name = strings + tag[i].name;
+			memcpy( model.Tags[i].matrix.M, tag[i].matrix, sizeof( tag[i].matrix ) );
+			model.Tags[i].jointIndices = Vector4i( tag[i].jointIndices[0], tag[i].jointIndices[1], tag[i].jointIndices[2], tag[i].jointIndices[3] );
+			model.Tags[i].jointWeights = Vector4f( tag[i].jointWeights[0], tag[i].jointWeights[1], tag[i].jointWeights[2], tag[i].jointWeights[3] );
+		}
+	}
+
+	//
+	// Render Model Surfaces
+	//
+
+	const model_binary_chunk_t * surfaces = FindModelBinaryChunk( data, MODEL_BINARY_CHUNK_SURFACES );
+	if ( surfaces != NULL && surfaces->count > 0 )
+	{
+		const uint8_t * vertices = data + FindModelBinaryChunk( data, MODEL_BINARY_CHUNK_VERTICES )->offset;
+		const uint8_t * indices = data + FindModelBinaryChunk( data, MODEL_BINARY_CHUNK_INDICES )->offset;
+
+		const model_binary_surface_t * surface = (const model_binary_surface_t *)( data + surfaces->offset );
+		model.Def.surfaces.Reserve( model.Def.surfaces.GetSize() + surfaces->count );
+		for ( uint32_t i = 0; i < surfaces->count; i++, surface++ )
+		{
+			const int index = model.Def.surfaces.AllocBack();
+
+			model.Def.surfaces[index].surfaceName = strings + surface->name;
+
+			LOGV( "surface %s", model.Def.surfaces[index].surfaceName.ToCStr() );
+
+			const Bounds3f bounds( Vector3f( surface->bounds[0][0], surface->bounds[0][1], surface->bounds[0][2] ),
+									Vector3f( surface->bounds[1][0], surface->bounds[1][1], surface->bounds[1][2] ) );
+			const TriangleIndex * surfaceIndices = (const TriangleIndex *)( indices + surface->indexOffset );
+
+			GlGeometry & geo = model.Def.surfaces[index].geo;
+			if ( materialParms.ShareAssets )
+			{
+				size_t bytes = 0;
+				const uint64_t key = GetModelGeometryKey( vertices + surface->vertexOffset, surface->vertexAttribs, surface->vertexCount,
+															surfaceIndices, surface->indexCount, bounds, bytes );
+				if ( !ModelAssetCache::Get().Geometry.Find( key, geo ) )
+				{
+					geo.Create( vertices + surface->vertexOffset, surface->vertexAttribs, surface->vertexCount,
+								surfaceIndices, surface->indexCount, bounds );
+					ShareModelGeometry( key, bytes, geo );
+				}
+			}
+			else
+			{
+				geo.Create( vertices + surface->vertexOffset, surface->vertexAttribs, surface->vertexCount,
+							surfaceIndices, surface->indexCount, bounds );
+			}
+
+			if ( outModelGeo != NULL )
+			{
+				const TriangleIndex indexOffset = static_cast<TriangleIndex>( (*outModelGeo).positions.GetSize() );
+				if ( ( surface->vertexAttribs & MODEL_BINARY_ATTRIBUTE_POSITION ) != 0 )
+				{
+					// positions are the first attribute
+					const Vector3f * positions = (const Vector3f *)( vertices + surface->vertexOffset );
+					for ( uint32_t j = 0; j < surface->vertexCount; j++ )
+					{
+						(*outModelGeo).positions.PushBack( positions[j] );
+					}
+				}
+				for ( uint32_t j = 0; j < surface->indexCount; j++ )
+				{
+					(*outModelGeo).indices.PushBack( surfaceIndices[j] + indexOffset );
+				}
+			}
+
+			const uint32_t jointAttribs = MODEL_BINARY_ATTRIBUTE_JOINT_INDICES | MODEL_BINARY_ATTRIBUTE_JOINT_WEIGHTS;
+			const bool skinned = ( surface->vertexAttribs & jointAttribs ) == jointAttribs;
+			const bool vertexColors = ( surface->vertexAttribs & MODEL_BINARY_ATTRIBUTE_COLOR ) != 0 && surface->vertexCount > 0;
+
+			SetupModelFileSurface( model, index, (ModelMaterialType)Alg::Min( surface->material, (uint32_t)MATERIAL_TYPE_ADDITIVE ),
+									surface->textures, glTextures, vertexColors, skinned, programs, materialParms );
+		}
+	}
+
+	//
+	// Collision Models
+	//
+
+	const model_binary_chunk_t * planes = FindModelBinaryChunk( data, MODEL_BINARY_CHUNK_PLANES );
+	for ( uint32_t id = MODEL_BINARY_CHUNK_COLLISION; id <= MODEL_BINARY_CHUNK_GROUND_COLLISION; id++ )
+	{
+		const model_binary_chunk_t * polytopes = FindModelBinaryChunk( data, id );
+		if ( polytopes != NULL )
+		{
+			ModelCollision & collision = ( id == MODEL_BINARY_CHUNK_COLLISION ) ? model.Collisions : model.GroundCollisions;
+			const model_binary_polytope_t * polytope = (const model_binary_polytope_t *)( data + polytopes->offset );
+			collision.Polytopes.Resize( polytopes->count );
+			for ( uint32_t i = 0; i < polytopes->count; i++ )
+			{
+				collision.Polytopes[i].Name = strings + polytope[i].name;
+				collision.Polytopes[i].Planes.Resize( polytope[i].numPlanes );
+				if ( polytope[i].numPlanes > 0 )
+				{
+					memcpy( collision.Polytopes[i].Planes.GetDataPtr(), data + planes->offset + polytope[i].firstPlane * sizeof( Planef ),
+							polytope[i].numPlanes * sizeof( Planef ) );
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+// Adds the texture entry the zip is positioned at as a placeholder texture that
+// ovrModelTextureLoad decodes later. The entry is opened raw, so a deflated entry is
+// inflated by the decode task instead of here. A shared texture with the same package
+// bytes is used as is.
+static void AddModelFileTextureEntry( ModelFile & model, unzFile zfp, const char * entryName, const unz_file_info & finfo,
+								const char * fileData, const bool deferred, const bool share )
+{
+	int method = 0;
+	int level = 0;
+	if ( unzOpenCurrentFile2( zfp, &method, &level, 1 ) != UNZ_OK )
+	{
+		WARN( "Failed to open %s from %s", entryName, model.FileName.ToCStr() );
+		return;
+	}
+
+	ovrModelTextureLoad::Entry * entry = new ovrModelTextureLoad::Entry;
+	entry->Name = entryName;
+	entry->CompressedSize = finfo.compressed_size;
+	entry->CompressionMethod = method;
+	entry->UncompressedSize = finfo.uncompressed_size;
+	entry->Crc = finfo.crc;
+
+	// a deferred load outlives the package data
+	if ( fileData != NULL && !deferred )
+	{
+		entry->Compressed = (const uint8_t *)fileData + unzGetCurrentFileZStreamPos64( zfp );
+	}
+	else
+	{
+		entry->CompressedCopy.Realloc( entry->CompressedSize );
+		if ( unzReadCurrentFile( zfp, entry->CompressedCopy, entry->CompressedSize ) != entry->CompressedSize )
+		{
+			WARN( "Failed to read %s from %s", entryName, model.FileName.ToCStr() );
+			entry->CompressedSize = 0;
+		}
+		entry->Compressed = entry->CompressedCopy;
+	}
+	unzCloseCurrentFile( zfp );
+
+	// file name metadata for enabling clamp mode
+	// Used for sky sides in Tuscany.
+	entry->Clamped = ( strstr( entryName, "_c." ) != NULL );
+
+	// the extension selects the decoder, so it is part of the key with the load flags
+	if ( share && entry->CompressedSize > 0 )
+	{
+		const char * extension = strrchr( entryName, '.' );
+		const uint64_t parms[] =
+		{
+			(uint64_t)entry->UncompressedSize,
+			(uint64_t)entry->Crc,
+			(uint64_t)entry->CompressionMethod,
+			(uint64_t)model.DeferredTextures->Flags.GetValue(),
+			(uint64_t)entry->Clamped,
+			( extension != NULL ) ? HashAssetContent( extension, strlen( extension ) ) : 0
+		};
+		entry->ContentKey = HashAssetContent( entry->Compressed, entry->CompressedSize, HashAssetContent( parms, sizeof( parms ) ) );
+		entry->Shareable = true;
+	}
+
+	ModelTexture tex;
+	tex.name = entryName;
+	tex.name.StripExtension();
+	if ( entry->Shareable && ModelAssetCache::Get().Textures.Find( entry->ContentKey, tex.texid ) )
+	{
+		// uploaded by an earlier model
+		entry->Shared = true;
+		entry->Finished = true;
+	}
+	else if ( deferred )
+	{
+		// rendered until the texture is uploaded
+		static const uint8_t placeholder[4] = { 128, 128, 128, 255 };
+		tex.texid = LoadRGBATextureFromMemory( placeholder, 1, 1, model.UsingSrgbTextures );
+	}
+	else
+	{
+		// only a name for the surfaces to refer to until the upload
+		GLuint texId;
+		glGenTextures( 1, &texId );
+		tex.texid = GlTexture( texId, 0, 0 );
+	}
+	model.Textures.PushBack( tex );
+
+	model.DeferredTextures->Entries.PushBack( entry );
+}
+
 static ModelFile * LoadModelFile( unzFile zfp, const char * fileName,
 								const char * fileData, const int fileDataLength,
 								const ModelGlPrograms & programs,
@@ -798,7 +1791,12 @@ static ModelFile * LoadModelFile( unzFile zfp, const char * fileName,
 		return modelPtr;
 	}
 
-	// load all texture files and locate the model files
+	// Collect the texture files and locate the model files. The textures are
+	// placeholders until they are decoded, which happens on the given workers
+	// while the model files are parsed, or by a texture loader for a deferred load.
+
+	const bool deferred = materialParms.DeferTextureLoads;
+	model.DeferredTextures = new ovrModelTextureLoad( model, materialParms.UseSrgbTextureFormats ? TextureFlags_t( TEXTUREFLAG_USE_SRGB ) : TextureFlags_t() );
 
 	const char * modelsJson = NULL;
 	int modelsJsonLength = 0;
@@ -806,6 +1804,9 @@ static ModelFile * LoadModelFile( unzFile zfp, const char * fileName,
 	const char * modelsBin = NULL;
 	int modelsBinLength = 0;
 
+	const char * modelsBinary = NULL;
+	int modelsBinaryLength = 0;
+
 	for ( int ret = unzGoToFirstFile( zfp ); ret == UNZ_OK; ret = unzGoToNextFile( zfp ) )
 	{
 		unz_file_info finfo;
@@ -813,6 +1814,28 @@ static ModelFile * LoadModelFile( unzFile zfp, const char * fileName,
 		unzGetCurrentFileInfo( zfp, &finfo, entryName, sizeof( entryName ), NULL, 0, NULL, 0 );
 		LOGV( "zip level: %ld, file: %s", finfo.compression_method, entryName );
 
+		// assume a 3 character extension
+		const size_t entryLength = strlen( entryName );
+		const char * extension = ( entryLength >= 4 ) ? &entryName[entryLength - 4] : entryName;
+
+		if (	OVR_stricmp( extension, ".pvr" ) == 0 ||
+				OVR_stricmp( extension, ".ktx" ) == 0 )
+		{
+			// only support .pvr and .ktx containers for now
+			AddModelFileTextureEntry( model, zfp, entryName, finfo, fileData, deferred, materialParms.ShareAssets );
+			continue;
+		}
+
+		const bool isJson = ( OVR_stricmp( entryName, "models.json" ) == 0 );
+		const bool isBin = ( OVR_stricmp( entryName, "models.bin" ) == 0 );
+		const bool isBinary = ( OVR_stricmp( entryName, MODEL_BINARY_FILE_NAME ) == 0 );
+		if ( !isJson && !isBin && !isBinary )
+		{
+			// ignore other files
+			LOG( "Ignoring %s", entryName );
+			continue;
+		}
+
 		if ( unzOpenCurrentFile( zfp ) != UNZ_OK )
 		{
 			WARN( "Failed to open %s from %s", entryName, fileName );
@@ -822,7 +1845,9 @@ static ModelFile * LoadModelFile( unzFile zfp, const char * fileName,
 		const int size = finfo.uncompressed_size;
 		char * buffer = NULL;
 
-		if ( finfo.compression_method == 0 && fileData != NULL )
+		// models.ovrm is used in place if it is stored and aligned
+		if ( finfo.compression_method == 0 && fileData != NULL &&
+				( !isBinary || ( ( (size_t)fileData + unzGetCurrentFileZStreamPos64( zfp ) ) & 3 ) == 0 ) )
 		{
 			buffer = (char *)fileData + unzGetCurrentFileZStreamPos64( zfp );
 		}
@@ -835,50 +1860,49 @@ static ModelFile * LoadModelFile( unzFile zfp, const char * fileName,
 			{
 				WARN( "Failed to read %s from %s", entryName, fileName );
 				delete [] buffer;
+				unzCloseCurrentFile( zfp );
 				continue;
 			}
 		}
 
-		// assume a 3 character extension
-		const size_t entryLength = strlen( entryName );
-		const char * extension = ( entryLength >= 4 ) ? &entryName[entryLength - 4] : entryName;
-
-		if ( OVR_stricmp( entryName, "models.json" ) == 0 )
+		// save these for parsing
+		if ( isJson )
 		{
-			// save this for parsing
 			modelsJson = (const char *)buffer;
 			modelsJsonLength = size;
-			buffer = NULL;	// don't free it now
 		}
-		else if ( OVR_stricmp( entryName, "models.bin" ) == 0 )
+		else if ( isBin )
 		{
-			// save this for parsing
 			modelsBin = (const char *)buffer;
 			modelsBinLength = size;
-			buffer = NULL;	// don't free it now
-		}
-		else if (	OVR_stricmp( extension, ".pvr" ) == 0 ||
-					OVR_stricmp( extension, ".ktx" ) == 0 )
-		{
-			// only support .pvr and .ktx containers for now
-			LoadModelFileTexture( model, entryName, buffer, size, materialParms );
 		}
 		else
 		{
-			// ignore other files
-			LOG( "Ignoring %s", entryName );
-		}
-
-		if ( buffer < fileData || buffer > fileData + fileDataLength )
-		{
-			delete [] buffer;
+			modelsBinary = (const char *)buffer;
+			modelsBinaryLength = size;
 		}
 
 		unzCloseCurrentFile( zfp );
 	}
 	unzClose( zfp );
 
-	if ( modelsJson != NULL )
+	// Even a single decode overlaps the parse, the workers are already running.
+	ovrWorkerPool * workers = deferred ? NULL : materialParms.Workers;
+	const bool decoding = ( workers != NULL && model.DeferredTextures->Entries.GetSizeI() > 0 );
+	if ( decoding )
+	{
+		workers->Start( model.DeferredTextures->Entries.GetSizeI(), ovrModelTextureLoad::DecodeTask, model.DeferredTextures );
+	}
+
+	// models.json + models.bin are only parsed without a valid models.ovrm
+	bool loaded = false;
+	if ( modelsBinary != NULL )
+	{
+		loaded = LoadModelFileBinary( model,
+							modelsBinary, modelsBinaryLength,
+							programs, materialParms, outModelGeo );
+	}
+	if ( !loaded && modelsJson != NULL )
 	{
 		LoadModelFileJson( model,
 							modelsJson, modelsJsonLength,
@@ -886,13 +1910,36 @@ static ModelFile * LoadModelFile( unzFile zfp, const char * fileName,
 							programs, materialParms, outModelGeo );
 	}
 
+	// Built while the workers are still decoding textures.
+	if ( materialParms.BuildTraceBvh && model.TraceModel.indices.GetSizeI() > 0 )
+	{
+		LOGV( "building ray-trace BVH.." );
+		model.TraceModel.BuildBvh();
+	}
+	model.Collisions.BuildHierarchy();
+	model.GroundCollisions.BuildHierarchy();
+
+	if ( decoding )
+	{
+		workers->Wait();
+	}
+	if ( !deferred || model.DeferredTextures->Entries.GetSizeI() == 0 )
+	{
+		// upload whatever is decoded, and decode the rest here
+		model.LoadDeferredTextures( NULL );
+	}
+
 	if ( modelsJson < fileData || modelsJson > fileData + fileDataLength )
 	{
-		delete modelsJson;
+		delete [] modelsJson;
 	}
 	if ( modelsBin < fileData || modelsBin > fileData + fileDataLength )
 	{
-		delete modelsBin;
+		delete [] modelsBin;
+	}
+	if ( modelsBinary < fileData || modelsBinary > fileData + fileDataLength )
+	{
+		delete [] modelsBinary;
 	}
 
 	return modelPtr;
@@ -19,9 +19,14 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 #include "ModelRender.h"		// ModelDef
 #include "ModelCollision.h"
 #include "ModelTrace.h"
+#include "ModelAssetCache.h"
 
 namespace OVR {
 
+class ovrWorkerPool;
+class ovrTextureLoader;
+class ovrModelTextureLoad;
+
 struct MaterialParms
 {
 	MaterialParms() :
@@ -29,13 +34,21 @@ struct MaterialParms
 		EnableDiffuseAniso( false ),
 		EnableEmissiveLodClamp( true ),
 		Transparent( false ),
-		PolygonOffset( false ) { }
+		PolygonOffset( false ),
+		DeferTextureLoads( false ),
+		BuildTraceBvh( false ),
+		ShareAssets( false ),
+		Workers( NULL ) { }
 
 	bool	UseSrgbTextureFormats;	// use sRGB textures
 	bool	EnableDiffuseAniso;		// enable anisotropic filtering on the diffuse texture
 	bool	EnableEmissiveLodClamp;	// enable LOD clamp on the emissive texture to avoid light bleeding
 	bool	Transparent;			// surfaces with this material flag need to render in a transparent pass
 	bool	PolygonOffset;			// render with polygon offset enabled
+	bool	DeferTextureLoads;		// bind placeholders and decode the textures on first use, see ModelFile::UpdateDeferredTextures
+	bool	BuildTraceBvh;			// trace the model with a BVH built at load time instead of the kd-tree, see ModelTrace::BuildBvh
+	bool	ShareAssets;			// share textures and geometry with the same content across models, see ModelAssetCache
+	ovrWorkerPool *	Workers;		// decodes the textures while the geometry is parsed, NULL decodes them after it
 };
 
 struct ModelTexture
@@ -57,6 +70,7 @@ struct ModelJoint
 	int					index;
 	String				name;
 	Matrix4f			transform;
+	Matrix4f			inverseTransform;	// transform.Inverted(), constant so it is computed once at load
 	ModelJointAnimation	animation;
 	Vector3f			parameters;
 	float				timeOffset;
@@ -78,7 +92,7 @@ class ModelFile
 {
 public:
 								ModelFile();
-								ModelFile( const char * name ) : FileName( name ) {}
+								ModelFile( const char * name ) : FileName( name ), UsingSrgbTextures( false ), DeferredTextures( NULL ) {}
 								~ModelFile();	// Frees all textures and geometry
 
 	ovrSurfaceDef *				FindNamedSurface( const char * name ) const;
@@ -90,6 +104,20 @@ public:
 	const ModelJoint *			GetJoint( const int index ) const { return &Joints[index]; }
 	Bounds3f					GetBounds() const;
 
+	// True while the textures loaded with MaterialParms::DeferTextureLoads are placeholders.
+	bool						HasDeferredTextures() const { return DeferredTextures != NULL; }
+	// Hands the deferred textures to the loader, which decodes them on its workers and
+	// uploads them within its per-frame budget, and replaces the placeholders of the
+	// textures uploaded so far. Call once per frame on the GL thread, after the loader's
+	// Update(), until it returns true. The loader must outlive the model.
+	// The surfaces and Textures are updated to the uploaded textures, copies of the
+	// placeholders made before this are not.
+	bool						UpdateDeferredTextures( ovrTextureLoader & loader ) const;
+	// Decodes the deferred textures, on the workers if given, and uploads them on the
+	// calling thread, which needs a GL context. Not for a model whose textures were
+	// handed to a loader with UpdateDeferredTextures().
+	void						LoadDeferredTextures( ovrWorkerPool * workers ) const;
+
 public:
 	String						FileName;
 	bool						UsingSrgbTextures;
@@ -113,6 +141,24 @@ public:
 
 	// This is typically used for gaze selection.
 	ModelTrace					TraceModel;
+
+	// Textures that are not uploaded yet, NULL once all of them are. Finishing the
+	// load only replaces placeholders, so it is allowed on a const model: the load
+	// keeps a reference to the model it fills in, and is mutable itself.
+	mutable ovrModelTextureLoad *	DeferredTextures;
+};
+
+// The textures and geometry of the models loaded with MaterialParms::ShareAssets.
+// A model holds a reference to each shared asset until it is destroyed, so the
+// assets of a shared model must not be freed or modified by the application.
+// The sampler state a model applies to a texture is seen by every model using it,
+// the same as for a texture used by two surfaces of one model.
+struct ModelAssetCache
+{
+	ovrAssetCacheT< GlTexture >		Textures;	// by the package bytes of the texture file
+	ovrAssetCacheT< GlGeometry >	Geometry;	// by the vertex and index data
+
+	static ModelAssetCache &		Get();
 };
 
 struct ModelGlPrograms
@@ -12,10 +12,15 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 #include "ModelRender.h"
 
 #include <stdlib.h>
-#include <algorithm>
 #include "Kernel/OVR_GlUtils.h"
 #include "Kernel/OVR_LogUtils.h"
 
+#if defined( OVR_CPU_ARM_NEON ) || defined( __ARM_NEON )
+#include <arm_neon.h>
+#elif defined( OVR_CPU_SSE )
+#include <xmmintrin.h>
+#endif
+
 namespace OVR
 {
 
@@ -130,56 +135,162 @@ static float BoundsSortCullKey( const Bounds3f & bounds, const Matrix4f & mvp )
 	return maxW;		// couldn't cull
 }
 
-struct bsort_t
+// BoundsSortCullKey with the eight corners transformed and tested as two
+// vectors of four. The corners only differ in which bound each axis takes: x
+// alternates, y alternates in pairs, and z is the minimum in the first vector
+// and the maximum in the second. The clip coordinates are summed in the same
+// order as Matrix4f::Transform, so the result is identical to BoundsSortCullKey.
+static float BoundsSortCullKeySimd( const Bounds3f & bounds, const Matrix4f & mvp )
 {
-	float						key;
-	Matrix4f					modelMatrix;
-	const Array< Matrix4f > *	joints;
-	const ovrSurfaceDef *		surface;
-	bool						transparent;
-
-	bool operator< (const bsort_t& b2) const
-	{
-		const bsort_t& b1 = *this;
-		bool trans1 = b1.transparent;
-		bool trans2 = b2.transparent;
-		if ( trans1 == trans2 )
+	if ( bounds.b[1].x == bounds.b[0].x &&  bounds.b[1].y == bounds.b[0].y )
+	{
+		return 0;
+	}
+
+	const float * m = &mvp.M[0][0];
+#if defined( OVR_CPU_ARM_NEON ) || defined( __ARM_NEON )
+	const float xs[4] = { bounds.b[0].x, bounds.b[1].x, bounds.b[0].x, bounds.b[1].x };
+	const float ys[4] = { bounds.b[0].y, bounds.b[0].y, bounds.b[1].y, bounds.b[1].y };
+	const float32x4_t x = vld1q_f32( xs );
+	const float32x4_t y = vld1q_f32( ys );
+	float32x4_t c[4][2];
+	for ( int r = 0; r < 4; r++ )
+	{
+		// separate multiplies and adds, a fused multiply-add would round differently
+		const float32x4_t xy = vaddq_f32( vmulq_n_f32( x, m[r * 4 + 0] ), vmulq_n_f32( y, m[r * 4 + 1] ) );
+		c[r][0] = vaddq_f32( vaddq_f32( xy, vdupq_n_f32( m[r * 4 + 2] * bounds.b[0].z ) ), vdupq_n_f32( m[r * 4 + 3] ) );
+		c[r][1] = vaddq_f32( vaddq_f32( xy, vdupq_n_f32( m[r * 4 + 2] * bounds.b[1].z ) ), vdupq_n_f32( m[r * 4 + 3] ) );
+	}
+	// a plane culls the bounds if no corner is on its inner side
+	uint32x4_t visible = vdupq_n_u32( ~0u );
+	for ( int r = 0; r < 3; r++ )
+	{
+		const float32x4_t nw0 = vnegq_f32( c[3][0] );
+		const float32x4_t nw1 = vnegq_f32( c[3][1] );
+		const uint32x4_t above = vorrq_u32( vcgtq_f32( c[r][0], nw0 ), vcgtq_f32( c[r][1], nw1 ) );
+		const uint32x4_t below = vorrq_u32( vcltq_f32( c[r][0], c[3][0] ), vcltq_f32( c[r][1], c[3][1] ) );
+		// reduce each plane's mask to all ones or all zeros
+		uint32x2_t a = vorr_u32( vget_low_u32( above ), vget_high_u32( above ) );
+		uint32x2_t b = vorr_u32( vget_low_u32( below ), vget_high_u32( below ) );
+		a = vpmax_u32( a, a );
+		b = vpmax_u32( b, b );
+		visible = vandq_u32( visible, vcombine_u32( a, b ) );
+	}
+	if ( vgetq_lane_u32( visible, 0 ) == 0 || vgetq_lane_u32( visible, 2 ) == 0 )
+	{
+		return 0;	// all off one side
+	}
+	float32x4_t w = vmaxq_f32( vmaxq_f32( c[3][0], c[3][1] ), vdupq_n_f32( 0.0f ) );
+	float32x2_t w2 = vpmax_f32( vget_low_f32( w ), vget_high_f32( w ) );
+	w2 = vpmax_f32( w2, w2 );
+	return vget_lane_f32( w2, 0 );
+#elif defined( OVR_CPU_SSE )
+	const __m128 x = _mm_setr_ps( bounds.b[0].x, bounds.b[1].x, bounds.b[0].x, bounds.b[1].x );
+	const __m128 y = _mm_setr_ps( bounds.b[0].y, bounds.b[0].y, bounds.b[1].y, bounds.b[1].y );
+	__m128 c[4][2];
+	for ( int r = 0; r < 4; r++ )
+	{
+		const __m128 xy = _mm_add_ps( _mm_mul_ps( x, _mm_set1_ps( m[r * 4 + 0] ) ), _mm_mul_ps( y, _mm_set1_ps( m[r * 4 + 1] ) ) );
+		c[r][0] = _mm_add_ps( _mm_add_ps( xy, _mm_set1_ps( m[r * 4 + 2] * bounds.b[0].z ) ), _mm_set1_ps( m[r * 4 + 3] ) );
+		c[r][1] = _mm_add_ps( _mm_add_ps( xy, _mm_set1_ps( m[r * 4 + 2] * bounds.b[1].z ) ), _mm_set1_ps( m[r * 4 + 3] ) );
+	}
+	// a plane culls the bounds if no corner is on its inner side
+	const __m128 signBit = _mm_set1_ps( -0.0f );
+	const __m128 nw0 = _mm_xor_ps( c[3][0], signBit );
+	const __m128 nw1 = _mm_xor_ps( c[3][1], signBit );
+	for ( int r = 0; r < 3; r++ )
+	{
+		if ( _mm_movemask_ps( _mm_or_ps( _mm_cmpgt_ps( c[r][0], nw0 ), _mm_cmpgt_ps( c[r][1], nw1 ) ) ) == 0 ||
+			_mm_movemask_ps( _mm_or_ps( _mm_cmplt_ps( c[r][0], c[3][0] ), _mm_cmplt_ps( c[r][1], c[3][1] ) ) ) == 0 )
 		{
-			float f1 = b1.key;
-			float f2 = b2.key;
-			if ( !trans1 )
-			{
-				// both are solid, sort front-to-back
-				return ( f1 < f2 );
-			}
-			else
-			{
-				// both are transparent, sort back-to-front
-				return ( f2 < f1 );
-			}
+			return 0;	// all off one side
 		}
-		// otherwise, one is solid and one is translucent... the solid is always rendered first
-		return !trans1;
-	};
-};
+	}
+	__m128 w = _mm_max_ps( _mm_max_ps( c[3][0], c[3][1] ), _mm_setzero_ps() );
+	w = _mm_max_ps( w, _mm_shuffle_ps( w, w, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+	w = _mm_max_ps( w, _mm_shuffle_ps( w, w, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+	return _mm_cvtss_f32( w );
+#else
+	return BoundsSortCullKey( bounds, mvp );
+#endif
+}
 
-void BuildModelSurfaceList(	Array<ovrDrawSurface> & surfaceList,
+// Updates the joint uniform buffer of a skinned surface. The transposed joints
+// are kept until a surface of another model is added, and a buffer shared by
+// several surfaces of the model is only updated for the first one.
+static void UpdateJointUniforms( ovrSurfaceListBuffers & buffers, const ModelState & modelState, const ovrSurfaceDef & surfaceDef )
+{
+	if ( modelState.Joints.GetSize() == 0 )
+	{
+		return;
+	}
+
+	if ( buffers.PaletteModel != &modelState )
+	{
+		const int numJoints = Alg::Min( modelState.Joints.GetSizeI(), MAX_JOINTS );
+		buffers.JointPalette.Resize( numJoints );
+		for ( int j = 0; j < numJoints; j++ )
+		{
+			buffers.JointPalette[j] = modelState.Joints[j].Transposed();
+		}
+		buffers.PaletteBuffers.Resize( 0 );
+		buffers.PaletteModel = &modelState;
+	}
+
+	const GlBuffer & uniformJoints = surfaceDef.graphicsCommand.uniformJoints;
+	for ( int i = 0; i < buffers.PaletteBuffers.GetSizeI(); i++ )
+	{
+		if ( buffers.PaletteBuffers[i] == uniformJoints.GetBuffer() )
+		{
+			return;
+		}
+	}
+	buffers.PaletteBuffers.PushBack( uniformJoints.GetBuffer() );
+
+	const size_t updateSize = buffers.JointPalette.GetSize() * sizeof( Matrix4f );
+	uniformJoints.Update( updateSize, buffers.JointPalette.GetDataPtr() );
+}
+
+// Returns the number of surfaces in the surface list if none are culled.
+static int MaxSurfaceListSize( const long long suppressModelsWithClientId, const Array<ModelState *> & emitModels,
+		const Array<ovrDrawSurface> & emitSurfaces )
+{
+	int count = emitSurfaces.GetSizeI();
+	for ( int modelNum = 0; modelNum < emitModels.GetSizeI(); modelNum++ )
+	{
+		const ModelState & modelState = *emitModels[ modelNum ];
+		if ( modelState.DontRenderForClientUid != suppressModelsWithClientId )
+		{
+			count += modelState.modelDef->surfaces.GetSizeI();
+		}
+	}
+	return count;
+}
+
+void BuildModelSurfaceList(	ovrSurfaceListBuffers & buffers,
+							Array<ovrDrawSurface> & surfaceList,
 							const long long suppressModelsWithClientId,
 							const Array<ModelState *> & emitModels,
 							const Array<ovrDrawSurface> & emitSurfaces,
 							const Matrix4f & viewMatrix,
 							const Matrix4f & projectionMatrix )
 {
-	// A mobile GPU will be in trouble if it draws more than this.
-	static const int MAX_DRAW_SURFACES = 1024;
-	bsort_t	bsort[ MAX_DRAW_SURFACES ];
+	// ----TODO_DRAWEYEVIEW : don't overwrite surfaces which may have already been added to the surfaceList.
+	int maxSurfaces = MaxSurfaceListSize( suppressModelsWithClientId, emitModels, emitSurfaces );
+	if ( buffers.MaxSurfaces > 0 )
+	{
+		maxSurfaces = Alg::Min( maxSurfaces, buffers.MaxSurfaces );
+	}
+	surfaceList.Resize( maxSurfaces );
+	buffers.SortKeys.Resize( maxSurfaces );
+	buffers.PaletteModel = NULL;
 
 	const Matrix4f vpMatrix = projectionMatrix * viewMatrix;
 
 	int	numSurfaces = 0;
 	int	cullCount = 0;
 
-	for ( int modelNum = 0; modelNum < emitModels.GetSizeI(); modelNum++ )
+	for ( int modelNum = 0; modelNum < emitModels.GetSizeI() && numSurfaces < maxSurfaces; modelNum++ )
 	{
 		const ModelState & modelState = *emitModels[ modelNum ];
 		if ( modelState.DontRenderForClientUid == suppressModelsWithClientId )
@@ -188,7 +299,7 @@ void BuildModelSurfaceList(	Array<ovrDrawSurface> & surfaceList,
 		}
 
 		const ModelDef & modelDef = *modelState.modelDef;
-		for ( int surfaceNum = 0; surfaceNum < modelDef.surfaces.GetSizeI(); surfaceNum++ )
+		for ( int surfaceNum = 0; surfaceNum < modelDef.surfaces.GetSizeI() && numSurfaces < maxSurfaces; surfaceNum++ )
 		{
 			const ovrSurfaceDef & surfaceDef = modelDef.surfaces[ surfaceNum ];
 			const float sort = BoundsSortCullKey( surfaceDef.geo.localBounds, vpMatrix * modelState.modelMatrix );
@@ -202,35 +313,17 @@ void BuildModelSurfaceList(	Array<ovrDrawSurface> & surfaceList,
 				continue;
 			}
 
-			if ( numSurfaces == MAX_DRAW_SURFACES )
-			{
-				break;
-			}
-
 			// Update the Joint Uniform Buffer
-			if ( modelState.Joints.GetSize() > 0 )
-			{
-				static Matrix4f transposedJoints[MAX_JOINTS];
-				const int numJoints = Alg::Min( modelState.Joints.GetSizeI(), MAX_JOINTS );
+			UpdateJointUniforms( buffers, modelState, surfaceDef );
 
-				for ( int j = 0; j < numJoints; j++ )
-				{
-					transposedJoints[j] = modelState.Joints[j].Transposed();
-				}
-
-				const size_t updateSize = numJoints * sizeof( Matrix4f );
-				surfaceDef.graphicsCommand.uniformJoints.Update( updateSize, &transposedJoints[0] );
-			}
-
-			bsort[ numSurfaces ].key = sort;
-			bsort[ numSurfaces ].modelMatrix = modelState.modelMatrix;
-			bsort[ numSurfaces ].surface = &surfaceDef;
-			bsort[ numSurfaces ].transparent = ( surfaceDef.graphicsCommand.GpuState.blendEnable != ovrGpuState::BLEND_DISABLE );
+			surfaceList[ numSurfaces ].modelMatrix = modelState.modelMatrix;
+			surfaceList[ numSurfaces ].surface = &surfaceDef;
+			buffers.SortKeys[ numSurfaces ] = DrawSortKey( surfaceDef, sort );
 			numSurfaces++;
 		}
 	}
 
-	for ( int i = 0; i < emitSurfaces.GetSizeI(); i++  )
+	for ( int i = 0; i < emitSurfaces.GetSizeI() && numSurfaces < maxSurfaces; i++  )
 	{
 		const ovrDrawSurface & drawSurf = emitSurfaces[i];
 		const ovrSurfaceDef & surfaceDef = *drawSurf.surface;
@@ -245,33 +338,183 @@ void BuildModelSurfaceList(	Array<ovrDrawSurface> & surfaceList,
 			continue;
 		}
 
-		if ( numSurfaces == MAX_DRAW_SURFACES )
+		surfaceList[ numSurfaces ].modelMatrix = drawSurf.modelMatrix;
+		surfaceList[ numSurfaces ].surface = &surfaceDef;
+		buffers.SortKeys[ numSurfaces ] = DrawSortKey( surfaceDef, sort );
+		numSurfaces++;
+	}
+
+	//LOG( "Culled %i, draw %i", cullCount, numSurfaces );
+
+	// Sort by transparency, then opaque surfaces by program, texture and far W,
+	// transparent surfaces by far W. The radix sort is stable, so surfaces with
+	// identical keys sort consistently from frame to frame.
+	surfaceList.Resize( numSurfaces );
+	SortSurfaceList( surfaceList, buffers.SortKeys.GetDataPtr(), buffers.Sort );
+
+	// the models may be gone by the next frame
+	buffers.PaletteModel = NULL;
+}
+
+void BuildModelSurfaceList(	Array<ovrDrawSurface> & surfaceList,
+							const long long suppressModelsWithClientId,
+							const Array<ModelState *> & emitModels,
+							const Array<ovrDrawSurface> & emitSurfaces,
+							const Matrix4f & viewMatrix,
+							const Matrix4f & projectionMatrix )
+{
+	ovrSurfaceListBuffers buffers;
+	BuildModelSurfaceList( buffers, surfaceList, suppressModelsWithClientId, emitModels, emitSurfaces, viewMatrix, projectionMatrix );
+}
+
+//==============================================================
+// Parallel surface list
+
+struct ovrCullModelsJob
+{
+	const Array<ModelState *> *			EmitModels;
+	long long							SuppressModelsWithClientId;
+	int									MaxSurfaces;		// 0 for no limit
+	Matrix4f							VpMatrix;
+	int									NumTasks;
+	ovrSurfaceListBuffers *				Buffers;
+};
+
+static void CullModelsTask( void * data, const int task )
+{
+	const ovrCullModelsJob & job = *static_cast< const ovrCullModelsJob * >( data );
+	const Array<ModelState *> & emitModels = *job.EmitModels;
+	const int firstModel = (int)( ( (int64_t)emitModels.GetSizeI() * task ) / job.NumTasks );
+	const int endModel = (int)( ( (int64_t)emitModels.GetSizeI() * ( task + 1 ) ) / job.NumTasks );
+
+	Array< ovrVisibleSurface, ovrSurfaceListBuffers::FramePolicy > & visible = job.Buffers->Visible[task];
+	visible.Resize( 0 );
+
+	for ( int modelNum = firstModel; modelNum < endModel; modelNum++ )
+	{
+		// no more than the limit can be used from any one task
+		if ( job.MaxSurfaces > 0 && visible.GetSizeI() >= job.MaxSurfaces )
 		{
 			break;
 		}
 
-		bsort[ numSurfaces ].key = sort;
-		bsort[ numSurfaces ].modelMatrix = drawSurf.modelMatrix;
-		bsort[ numSurfaces ].surface = &surfaceDef;
-		bsort[ numSurfaces ].transparent = ( surfaceDef.graphicsCommand.GpuState.blendEnable != ovrGpuState::BLEND_DISABLE );
-		numSurfaces++;
+		const ModelState & modelState = *emitModels[ modelNum ];
+		if ( modelState.DontRenderForClientUid == job.SuppressModelsWithClientId )
+		{
+			continue;
+		}
+
+		// one matrix for all the surfaces of the model
+		const Matrix4f mvp = job.VpMatrix * modelState.modelMatrix;
+		const ModelDef & modelDef = *modelState.modelDef;
+		for ( int surfaceNum = 0; surfaceNum < modelDef.surfaces.GetSizeI(); surfaceNum++ )
+		{
+			const ovrSurfaceDef & surfaceDef = modelDef.surfaces[ surfaceNum ];
+			const float sort = BoundsSortCullKeySimd( surfaceDef.geo.localBounds, mvp );
+			if ( sort == 0 )
+			{
+				if ( LogRenderSurfaces )
+				{
+					LOG( "Culled %s", surfaceDef.surfaceName.ToCStr() );
+				}
+				continue;
+			}
+
+			ovrVisibleSurface surface;
+			surface.ModelNum = modelNum;
+			surface.SurfaceNum = surfaceNum;
+			surface.SortKey = DrawSortKey( surfaceDef, sort );
+			visible.PushBack( surface );
+		}
 	}
+}
 
-	//LOG( "Culled %i, draw %i", cullCount, numSurfaces );
+void BuildModelSurfaceListParallel(	ovrWorkerPool & workers,
+									ovrSurfaceListBuffers & buffers,
+									Array<ovrDrawSurface> & surfaceList,
+									const long long suppressModelsWithClientId,
+									const Array<ModelState *> & emitModels,
+									const Array<ovrDrawSurface> & emitSurfaces,
+									const Matrix4f & viewMatrix,
+									const Matrix4f & projectionMatrix )
+{
+	// Small enough for an even split to balance, large enough to amortize a task.
+	static const int MIN_MODELS_PER_TASK = 64;
+	static const int TASKS_PER_THREAD = 4;
 
-	// sort by the far W and transparency
-	// IMPORTANT: use a stable sort so surfaces with identical bounds
-	// will sort consistently from frame to frame, rather than randomly
-	// as happens with qsort.
-	std::stable_sort( bsort, bsort+numSurfaces );
+	const int numTasks = Alg::Max( 1, Alg::Min( ( emitModels.GetSizeI() + MIN_MODELS_PER_TASK - 1 ) / MIN_MODELS_PER_TASK,
+			workers.GetNumThreads() * TASKS_PER_THREAD ) );
+	if ( buffers.Visible.GetSizeI() < numTasks )
+	{
+		buffers.Visible.Resize( numTasks );
+	}
 
-	// ----TODO_DRAWEYEVIEW : don't overwrite surfaces which may have already been added to the surfaceList.
-	surfaceList.Resize( numSurfaces );
-	for ( int i = 0; i < numSurfaces; i++ )
+	ovrCullModelsJob job;
+	job.EmitModels = &emitModels;
+	job.SuppressModelsWithClientId = suppressModelsWithClientId;
+	job.MaxSurfaces = buffers.MaxSurfaces;
+	job.VpMatrix = projectionMatrix * viewMatrix;
+	job.NumTasks = numTasks;
+	job.Buffers = &buffers;
+	workers.Run( numTasks, CullModelsTask, &job );
+
+	int maxSurfaces = emitSurfaces.GetSizeI();
+	for ( int task = 0; task < numTasks; task++ )
+	{
+		maxSurfaces += buffers.Visible[task].GetSizeI();
+	}
+	if ( buffers.MaxSurfaces > 0 )
+	{
+		maxSurfaces = Alg::Min( maxSurfaces, buffers.MaxSurfaces );
+	}
+	surfaceList.Resize( maxSurfaces );
+	buffers.SortKeys.Resize( maxSurfaces );
+	buffers.PaletteModel = NULL;
+	int	numSurfaces = 0;
+
+	// Merge in task order, which is model order, so the list and the joint
+	// uniform updates are the same as from BuildModelSurfaceList.
+	for ( int task = 0; task < numTasks && numSurfaces < maxSurfaces; task++ )
+	{
+		const Array< ovrVisibleSurface, ovrSurfaceListBuffers::FramePolicy > & taskVisible = buffers.Visible[task];
+		for ( int i = 0; i < taskVisible.GetSizeI() && numSurfaces < maxSurfaces; i++ )
+		{
+			const ModelState & modelState = *emitModels[ taskVisible[i].ModelNum ];
+			const ovrSurfaceDef & surfaceDef = modelState.modelDef->surfaces[ taskVisible[i].SurfaceNum ];
+
+			UpdateJointUniforms( buffers, modelState, surfaceDef );
+
+			surfaceList[ numSurfaces ].modelMatrix = modelState.modelMatrix;
+			surfaceList[ numSurfaces ].surface = &surfaceDef;
+			buffers.SortKeys[ numSurfaces ] = taskVisible[i].SortKey;
+			numSurfaces++;
+		}
+	}
+
+	for ( int i = 0; i < emitSurfaces.GetSizeI() && numSurfaces < maxSurfaces; i++ )
 	{
-		surfaceList[i].modelMatrix = bsort[i].modelMatrix;
-		surfaceList[i].surface = bsort[i].surface;
+		const ovrDrawSurface & drawSurf = emitSurfaces[i];
+		const ovrSurfaceDef & surfaceDef = *drawSurf.surface;
+		const float sort = BoundsSortCullKeySimd( surfaceDef.geo.localBounds, job.VpMatrix * drawSurf.modelMatrix );
+		if ( sort == 0 )
+		{
+			if ( LogRenderSurfaces )
+			{
+				LOG( "Culled %s", surfaceDef.surfaceName.ToCStr() );
+			}
+			continue;
+		}
+
+		surfaceList[ numSurfaces ].modelMatrix = drawSurf.modelMatrix;
+		surfaceList[ numSurfaces ].surface = &surfaceDef;
+		buffers.SortKeys[ numSurfaces ] = DrawSortKey( surfaceDef, sort );
+		numSurfaces++;
 	}
+
+	surfaceList.Resize( numSurfaces );
+	SortSurfaceList( surfaceList, buffers.SortKeys.GetDataPtr(), buffers.Sort );
+
+	buffers.PaletteModel = NULL;
 }
 
 }	// namespace OVR
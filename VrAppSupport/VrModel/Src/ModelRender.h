@@ -17,6 +17,7 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 #include "Kernel/OVR_GlUtils.h"
 
 #include "SurfaceRender.h"
+#include "OVR_WorkerPool.h"
 
 namespace OVR
 {
@@ -45,10 +46,53 @@ struct ModelState
 	long long			DontRenderForClientUid;	// skip rendering the model if the current scene's client uid matches this
 };
 
+// A model surface that was not culled.
+struct ovrVisibleSurface
+{
+	int					ModelNum;
+	int					SurfaceNum;
+	uint64_t			SortKey;
+};
+
+// Kept by the caller between frames, so building the surface list does not
+// allocate every frame, no matter how many surfaces are visible.
+struct ovrSurfaceListBuffers
+{
+	typedef ArrayConstPolicy< 0, 16, true >	FramePolicy;	// keeps its memory when cleared
+
+								ovrSurfaceListBuffers() : MaxSurfaces( 0 ), PaletteModel( NULL ) {}
+
+	// If not 0, the surface list stops at this many surfaces: the first ones that
+	// are not culled, in model order and then the emit surfaces. Crowded views then
+	// cost about as much as with the old fixed limit, but the surfaces over the
+	// limit are not drawn.
+	int									MaxSurfaces;
+
+	Array< Array< ovrVisibleSurface, FramePolicy > >	Visible;	// one list per parallel task
+	Array< uint64_t, FramePolicy >		SortKeys;		// one key per surface in the surface list
+	ovrSurfaceSortBuffers				Sort;
+	Array< Matrix4f, FramePolicy >		JointPalette;	// the transposed joints of PaletteModel
+	Array< unsigned int, FramePolicy >	PaletteBuffers;	// joint buffers that already hold JointPalette
+	const ModelState *					PaletteModel;
+};
+
 // The model surfaces are culled and added to the sorted surface list.
 // Application specific surfaces from the emit list are also added to the sorted surface list.
-// The surface list is sorted such that opaque surfaces come first, sorted front-to-back,
-// and transparent surfaces come last, sorted back-to-front.
+// The surface list is sorted with DrawSortKey: opaque surfaces come first, grouped by
+// program and texture and sorted front-to-back within a group, and transparent surfaces
+// come last, sorted back-to-front.
+// The joints of a skinned model are transposed once per frame, and uploaded once to
+// each joint buffer of the model's visible surfaces.
+// No more than buffers.MaxSurfaces surfaces are added, if it is not 0.
+void BuildModelSurfaceList(	ovrSurfaceListBuffers & buffers,
+							Array<ovrDrawSurface> & surfaceList,
+							const long long suppressModelsWithClientId,
+							const Array<ModelState *> & emitModels,
+							const Array<ovrDrawSurface> & emitSurfaces,
+							const Matrix4f & viewMatrix,
+							const Matrix4f & projectionMatrix );
+
+// Same as above with temporary buffers.
 void BuildModelSurfaceList(	Array<ovrDrawSurface> & surfaceList,
 							const long long suppressModelsWithClientId,
 							const Array<ModelState *> & emitModels,
@@ -56,6 +100,19 @@ void BuildModelSurfaceList(	Array<ovrDrawSurface> & surfaceList,
 							const Matrix4f & viewMatrix,
 							const Matrix4f & projectionMatrix );
 
+// Builds the same surface list as BuildModelSurfaceList with the models split
+// across the worker pool. Each model's matrix is computed once for all of its
+// surfaces and the bounds are tested with SIMD. The joint uniforms are still
+// updated on the calling thread.
+void BuildModelSurfaceListParallel(	ovrWorkerPool & workers,
+									ovrSurfaceListBuffers & buffers,
+									Array<ovrDrawSurface> & surfaceList,
+									const long long suppressModelsWithClientId,
+									const Array<ModelState *> & emitModels,
+									const Array<ovrDrawSurface> & emitSurfaces,
+									const Matrix4f & viewMatrix,
+									const Matrix4f & projectionMatrix );
+
 } // namespace OVR
 
 #endif	// OVR_ModelRender_h
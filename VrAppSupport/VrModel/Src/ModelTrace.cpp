@@ -12,11 +12,18 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 #include "ModelTrace.h"
 
 #include <math.h>
+#include <string.h>
 
 #include "Kernel/OVR_Alg.h"
 #include "Kernel/OVR_Array.h"
 #include "Kernel/OVR_LogUtils.h"
 
+#if defined( OVR_CPU_ARM_NEON ) || defined( __ARM_NEON )
+#include <arm_neon.h>
+#elif defined( OVR_CPU_SSE )
+#include <emmintrin.h>
+#endif
+
 namespace OVR
 {
 
@@ -30,6 +37,11 @@ namespace OVR
 
 const int RT_KDTREE_MAX_ITERATIONS	= 128;
 
+const UInt32 RT_BVH_LEAF			= 0x80000000;
+const UInt32 RT_BVH_NO_CHILD		= 0xFFFFFFFF;
+const int RT_BVH_MAX_TRIANGLES		= 1 << 28;
+const int RT_BVH_STACK_SIZE			= 3 * RT_BVH_MAX_DEPTH + 4;
+
 bool ModelTrace::Validate( const bool fullVerify ) const
 {
 	bool invalid = false;
@@ -40,7 +52,7 @@ bool ModelTrace::Validate( const bool fullVerify ) const
 	invalid |= header.numNodes != nodes.GetSizeI();
 	invalid |= header.numLeafs != leafs.GetSizeI();
 	invalid |= header.numOverflow != overflow.GetSizeI();
-	if ( !invalid )
+	if ( invalid )
 	{
 		LOG( "ModelTrace::Verify - invalid header" );
 		return false;
@@ -77,7 +89,7 @@ bool ModelTrace::Validate( const bool fullVerify ) const
 			}
 		}
 		const int numTris = indices.GetSizeI() / 3;
-		if ( numTris * 3 != indices.GetSizeI() * 3 )
+		if ( numTris * 3 != indices.GetSizeI() )
 		{
 			LOG( "ModelTrace::Verify - Orphaned indices" );
 			return false;
@@ -114,15 +126,52 @@ bool ModelTrace::Validate( const bool fullVerify ) const
 				}
 			}
 		}
-		// verify overflow list doesn't point to any out-of-range triangles
+		// verify overflow list doesn't point to any out-of-range triangles, the triangles
+		// of each leaf in the overflow list are terminated with -1
 		for ( int i = 0; i < overflow.GetSizeI(); ++i )
 		{
-			if ( overflow[i] < 0 || overflow[i] >= numTris )
+			if ( overflow[i] < -1 || overflow[i] >= numTris )
 			{
 				LOG( "ModelTrace::Verify - overflow index %i value %i is out of range, max %i", i, overflow[i], numTris - 1 );
 				return false;
 			}
 		}
+		// verify the BVH children and leaf triangles are in range
+		for ( int i = 0; i < bvhNodes.GetSizeI(); ++i )
+		{
+			for ( int j = 0; j < 4; j++ )
+			{
+				const UInt32 child = bvhNodes[i].children[j];
+				if ( child == RT_BVH_NO_CHILD )
+				{
+					continue;
+				}
+				if ( ( child & RT_BVH_LEAF ) == 0 )
+				{
+					if ( (int)child <= i || (int)child >= bvhNodes.GetSizeI() )
+					{
+						LOG( "ModelTrace::Verify - BVH node %i child %i of %i is out of range, max %i", i, j, child, bvhNodes.GetSizeI() - 1 );
+						return false;
+					}
+					continue;
+				}
+				const int first = child & ( RT_BVH_MAX_TRIANGLES - 1 );
+				const int count = ( ( child >> 28 ) & 7 ) + 1;
+				if ( first + count > bvhTriangles.GetSizeI() )
+				{
+					LOG( "ModelTrace::Verify - BVH node %i leaf %i triangles %i to %i are out of range, max %i", i, j, first, first + count - 1, bvhTriangles.GetSizeI() - 1 );
+					return false;
+				}
+			}
+		}
+		for ( int i = 0; i < bvhTriangles.GetSizeI(); ++i )
+		{
+			if ( bvhTriangles[i] < 0 || bvhTriangles[i] >= numTris )
+			{
+				LOG( "ModelTrace::Verify - BVH triangle %i value %i is out of range, max %i", i, bvhTriangles[i], numTris - 1 );
+				return false;
+			}
+		}
 		// verify indices do not point to any out-of-range vertices
 		for ( int i = 0; i < indices.GetSizeI(); ++i )
 		{
@@ -136,35 +185,125 @@ bool ModelTrace::Validate( const bool fullVerify ) const
 	return true;
 }
 
-traceResult_t ModelTrace::Trace( const Vector3f & start, const Vector3f & end ) const
+//==============================================================
+// Four floats, one per ray of a packet or per child of a BVH node
+
+#if defined( OVR_CPU_ARM_NEON ) || defined( __ARM_NEON )
+
+typedef float32x4_t ovrFloat4;
+typedef uint32x4_t ovrMask4;
+
+static inline ovrFloat4 Float4Splat( const float f ) { return vdupq_n_f32( f ); }
+static inline ovrFloat4 Float4Load( const float * p ) { return vld1q_f32( p ); }
+static inline void Float4Store( float * p, const ovrFloat4 v ) { vst1q_f32( p, v ); }
+static inline ovrFloat4 Float4Add( const ovrFloat4 a, const ovrFloat4 b ) { return vaddq_f32( a, b ); }
+static inline ovrFloat4 Float4Sub( const ovrFloat4 a, const ovrFloat4 b ) { return vsubq_f32( a, b ); }
+static inline ovrFloat4 Float4Mul( const ovrFloat4 a, const ovrFloat4 b ) { return vmulq_f32( a, b ); }
+static inline ovrMask4 Float4GreaterThan( const ovrFloat4 a, const ovrFloat4 b ) { return vcgtq_f32( a, b ); }
+static inline ovrMask4 Float4GreaterEqual( const ovrFloat4 a, const ovrFloat4 b ) { return vcgeq_f32( a, b ); }
+static inline ovrMask4 Float4LessEqual( const ovrFloat4 a, const ovrFloat4 b ) { return vcleq_f32( a, b ); }
+static inline ovrFloat4 Float4Min( const ovrFloat4 a, const ovrFloat4 b ) { return vminq_f32( a, b ); }
+static inline ovrFloat4 Float4Max( const ovrFloat4 a, const ovrFloat4 b ) { return vmaxq_f32( a, b ); }
+static inline ovrFloat4 Float4FromUInt16( const UInt16 * p ) { return vcvtq_f32_u32( vmovl_u16( vld1_u16( p ) ) ); }
+static inline ovrMask4 Mask4And( const ovrMask4 a, const ovrMask4 b ) { return vandq_u32( a, b ); }
+static inline int Mask4Bits( const ovrMask4 m )
 {
-	// in debug, at least warn programmers if they're loading a model
-	// that fails simple validation.
-	OVR_ASSERT( Validate( false ) );
+	uint32_t lanes[4];
+	vst1q_u32( lanes, m );
+	return ( lanes[0] & 1 ) | ( lanes[1] & 2 ) | ( lanes[2] & 4 ) | ( lanes[3] & 8 );
+}
 
-	traceResult_t result;
-	result.triangleIndex = -1;
-	result.fraction = 1.0f;
-	result.uv = Vector2f( 0.0f );
-	result.normal = Vector3f( 0.0f );
+#elif defined( OVR_CPU_SSE )
 
-	const Vector3f rayDelta = end - start;
-	const float rayLengthSqr = rayDelta.LengthSq();
-	const float rayLengthRcp = RcpSqrt( rayLengthSqr );
-	const float rayLength = rayLengthSqr * rayLengthRcp;
-	const Vector3f rayDir = rayDelta * rayLengthRcp;
+typedef __m128 ovrFloat4;
+typedef __m128 ovrMask4;
+
+static inline ovrFloat4 Float4Splat( const float f ) { return _mm_set1_ps( f ); }
+static inline ovrFloat4 Float4Load( const float * p ) { return _mm_loadu_ps( p ); }
+static inline void Float4Store( float * p, const ovrFloat4 v ) { _mm_storeu_ps( p, v ); }
+static inline ovrFloat4 Float4Add( const ovrFloat4 a, const ovrFloat4 b ) { return _mm_add_ps( a, b ); }
+static inline ovrFloat4 Float4Sub( const ovrFloat4 a, const ovrFloat4 b ) { return _mm_sub_ps( a, b ); }
+static inline ovrFloat4 Float4Mul( const ovrFloat4 a, const ovrFloat4 b ) { return _mm_mul_ps( a, b ); }
+static inline ovrMask4 Float4GreaterThan( const ovrFloat4 a, const ovrFloat4 b ) { return _mm_cmpgt_ps( a, b ); }
+static inline ovrMask4 Float4GreaterEqual( const ovrFloat4 a, const ovrFloat4 b ) { return _mm_cmpge_ps( a, b ); }
+static inline ovrMask4 Float4LessEqual( const ovrFloat4 a, const ovrFloat4 b ) { return _mm_cmple_ps( a, b ); }
+static inline ovrFloat4 Float4Min( const ovrFloat4 a, const ovrFloat4 b ) { return _mm_min_ps( a, b ); }
+static inline ovrFloat4 Float4Max( const ovrFloat4 a, const ovrFloat4 b ) { return _mm_max_ps( a, b ); }
+static inline ovrFloat4 Float4FromUInt16( const UInt16 * p ) { return _mm_cvtepi32_ps( _mm_unpacklo_epi16( _mm_loadl_epi64( (const __m128i *)p ), _mm_setzero_si128() ) ); }
+static inline ovrMask4 Mask4And( const ovrMask4 a, const ovrMask4 b ) { return _mm_and_ps( a, b ); }
+static inline int Mask4Bits( const ovrMask4 m ) { return _mm_movemask_ps( m ); }
+
+#else
+
+struct ovrFloat4
+{
+	float	v[4];
+};
+
+typedef int ovrMask4;
+
+static inline ovrFloat4 Float4Splat( const float f ) { ovrFloat4 r; for ( int i = 0; i < 4; i++ ) { r.v[i] = f; } return r; }
+static inline ovrFloat4 Float4Load( const float * p ) { ovrFloat4 r; memcpy( r.v, p, sizeof( r.v ) ); return r; }
+static inline void Float4Store( float * p, const ovrFloat4 v ) { memcpy( p, v.v, sizeof( v.v ) ); }
+static inline ovrFloat4 Float4Add( const ovrFloat4 a, const ovrFloat4 b ) { ovrFloat4 r; for ( int i = 0; i < 4; i++ ) { r.v[i] = a.v[i] + b.v[i]; } return r; }
+static inline ovrFloat4 Float4Sub( const ovrFloat4 a, const ovrFloat4 b ) { ovrFloat4 r; for ( int i = 0; i < 4; i++ ) { r.v[i] = a.v[i] - b.v[i]; } return r; }
+static inline ovrFloat4 Float4Mul( const ovrFloat4 a, const ovrFloat4 b ) { ovrFloat4 r; for ( int i = 0; i < 4; i++ ) { r.v[i] = a.v[i] * b.v[i]; } return r; }
+static inline ovrMask4 Float4GreaterThan( const ovrFloat4 a, const ovrFloat4 b ) { int m = 0; for ( int i = 0; i < 4; i++ ) { m |= ( a.v[i] > b.v[i] ) << i; } return m; }
+static inline ovrMask4 Float4GreaterEqual( const ovrFloat4 a, const ovrFloat4 b ) { int m = 0; for ( int i = 0; i < 4; i++ ) { m |= ( a.v[i] >= b.v[i] ) << i; } return m; }
+static inline ovrMask4 Float4LessEqual( const ovrFloat4 a, const ovrFloat4 b ) { int m = 0; for ( int i = 0; i < 4; i++ ) { m |= ( a.v[i] <= b.v[i] ) << i; } return m; }
+static inline ovrFloat4 Float4Min( const ovrFloat4 a, const ovrFloat4 b ) { ovrFloat4 r; for ( int i = 0; i < 4; i++ ) { r.v[i] = ( a.v[i] < b.v[i] ) ? a.v[i] : b.v[i]; } return r; }
+static inline ovrFloat4 Float4Max( const ovrFloat4 a, const ovrFloat4 b ) { ovrFloat4 r; for ( int i = 0; i < 4; i++ ) { r.v[i] = ( a.v[i] > b.v[i] ) ? a.v[i] : b.v[i]; } return r; }
+static inline ovrFloat4 Float4FromUInt16( const UInt16 * p ) { ovrFloat4 r; for ( int i = 0; i < 4; i++ ) { r.v[i] = (float)p[i]; } return r; }
+static inline ovrMask4 Mask4And( const ovrMask4 a, const ovrMask4 b ) { return a & b; }
+static inline int Mask4Bits( const ovrMask4 m ) { return m; }
+
+#endif
+
+//==============================================================
+// Single ray traversal
+
+// The state of a ray between the steps of the traversal, so a ray that leaves
+// its packet continues where the packet left it.
+struct traceRay_t
+{
+	Vector3f	start;
+	Vector3f	rayDelta;
+	Vector3f	rayDir;
+	Vector3f	rcpRayDir;
+	float		rayLengthRcp;
+	float		entryDistance;
+	float		bestDistance;
+	int			nodeIndex;		// -1 once the ray is done
+	int			iteration;
+	int			triangleIndex;
+	Vector2f	uv;
+};
+
+// Clips the ray to the model bounds. Returns false if the ray misses them.
+static bool BeginTrace( const ModelTrace & model, const Vector3f & start, const Vector3f & end, traceRay_t & ray )
+{
+	ray.start = start;
+	ray.rayDelta = end - start;
+	ray.triangleIndex = -1;
+	ray.nodeIndex = -1;
+	ray.iteration = 0;
+
+	const float rayLengthSqr = ray.rayDelta.LengthSq();
+	ray.rayLengthRcp = RcpSqrt( rayLengthSqr );
+	const float rayLength = rayLengthSqr * ray.rayLengthRcp;
+	ray.rayDir = ray.rayDelta * ray.rayLengthRcp;
 
-	const float rcpRayDirX = ( fabsf( rayDir.x ) > Math<float>::SmallestNonDenormal ) ? ( 1.0f / rayDir.x ) : Math<float>::HugeNumber;
-	const float rcpRayDirY = ( fabsf( rayDir.y ) > Math<float>::SmallestNonDenormal ) ? ( 1.0f / rayDir.y ) : Math<float>::HugeNumber;
-	const float rcpRayDirZ = ( fabsf( rayDir.z ) > Math<float>::SmallestNonDenormal ) ? ( 1.0f / rayDir.z ) : Math<float>::HugeNumber;
+	ray.rcpRayDir.x = ( fabsf( ray.rayDir.x ) > Math<float>::SmallestNonDenormal ) ? ( 1.0f / ray.rayDir.x ) : Math<float>::HugeNumber;
+	ray.rcpRayDir.y = ( fabsf( ray.rayDir.y ) > Math<float>::SmallestNonDenormal ) ? ( 1.0f / ray.rayDir.y ) : Math<float>::HugeNumber;
+	ray.rcpRayDir.z = ( fabsf( ray.rayDir.z ) > Math<float>::SmallestNonDenormal ) ? ( 1.0f / ray.rayDir.z ) : Math<float>::HugeNumber;
 
-	const float sX = ( header.bounds.GetMins()[0] - start.x ) * rcpRayDirX;
-	const float sY = ( header.bounds.GetMins()[1] - start.y ) * rcpRayDirY;
-	const float sZ = ( header.bounds.GetMins()[2] - start.z ) * rcpRayDirZ;
+	const float sX = ( model.header.bounds.GetMins()[0] - start.x ) * ray.rcpRayDir.x;
+	const float sY = ( model.header.bounds.GetMins()[1] - start.y ) * ray.rcpRayDir.y;
+	const float sZ = ( model.header.bounds.GetMins()[2] - start.z ) * ray.rcpRayDir.z;
 
-	const float tX = ( header.bounds.GetMaxs()[0] - start.x ) * rcpRayDirX;
-	const float tY = ( header.bounds.GetMaxs()[1] - start.y ) * rcpRayDirY;
-	const float tZ = ( header.bounds.GetMaxs()[2] - start.z ) * rcpRayDirZ;
+	const float tX = ( model.header.bounds.GetMaxs()[0] - start.x ) * ray.rcpRayDir.x;
+	const float tY = ( model.header.bounds.GetMaxs()[1] - start.y ) * ray.rcpRayDir.y;
+	const float tZ = ( model.header.bounds.GetMaxs()[2] - start.z ) * ray.rcpRayDir.z;
 
 	const float minX = Alg::Min( sX, tX );
 	const float minY = Alg::Min( sY, tY );
@@ -179,128 +318,578 @@ traceResult_t ModelTrace::Trace( const Vector3f & start, const Vector3f & end )
 
 	if ( t0 >= t1 )
 	{
-		return result;
+		return false;
 	}
 
-	float entryDistance = Alg::Max( t0, 0.0f );
-	float bestDistance = Alg::Min( t1 + 0.00001f, rayLength );
-	Vector2f uv;
-	
-	const kdtree_node_t * currentNode = &nodes[0];
-	
-	for ( int i = 0; i < RT_KDTREE_MAX_ITERATIONS; i++ )
+	ray.entryDistance = Alg::Max( t0, 0.0f );
+	ray.bestDistance = Alg::Min( t1 + 0.00001f, rayLength );
+	ray.nodeIndex = 0;
+	return true;
+}
+
+// Steps down the tree until a leaf node is found and returns the leaf.
+static int FindLeaf( const ModelTrace & model, traceRay_t & ray )
+{
+	const Vector3f rayEntryPoint = ray.start + ray.rayDir * ray.entryDistance;
+
+	const kdtree_node_t * currentNode = &model.nodes[ray.nodeIndex];
+	while ( ( currentNode->data & 1 ) == 0 )
 	{
-		const Vector3f rayEntryPoint = start + rayDir * entryDistance;
+		// Select the child node based on whether the entry point is left or right of the split plane.
+		// If the entry point is directly at the split plane then choose the side based on the ray direction.
+		const int nodePlane = ( ( currentNode->data >> 1 ) & 3 );
+		int child;
+		if ( rayEntryPoint[nodePlane] - currentNode->dist < 0.00001f ) child = 0;
+		else if ( rayEntryPoint[nodePlane] - currentNode->dist > 0.00001f ) child = 1;
+		else child = ( ray.rayDelta[nodePlane] > 0.0f );
+		ray.nodeIndex = ( currentNode->data >> 3 ) + child;
+		currentNode = &model.nodes[ray.nodeIndex];
+	}
+	return ( currentNode->data >> 3 );
+}
 
-		// Step down the tree until a leaf node is found.
-		while ( ( currentNode->data & 1 ) == 0 )
+// Calls 'test' for the triangles of a leaf, including the ones in the overflow list.
+template< typename _test_ >
+static void ForEachLeafTriangle( const ModelTrace & model, const kdtree_leaf_t & leaf, const _test_ & test )
+{
+	const int * leafTriangles = leaf.triangles;
+	int leafTriangleCount = RT_KDTREE_MAX_LEAF_TRIANGLES;
+	for ( int j = 0; j < leafTriangleCount; j++ )
+	{
+		int currentTriangle = leafTriangles[j];
+		if ( currentTriangle < 0 )
 		{
-			// Select the child node based on whether the entry point is left or right of the split plane.
-			// If the entry point is directly at the split plane then choose the side based on the ray direction.
-			const int nodePlane = ( ( currentNode->data >> 1 ) & 3 );
-			int child;
-			if ( rayEntryPoint[nodePlane] - currentNode->dist < 0.00001f ) child = 0;
-			else if ( rayEntryPoint[nodePlane] - currentNode->dist > 0.00001f ) child = 1;
-			else child = ( rayDelta[nodePlane] > 0.0f );
-			currentNode = &nodes[( currentNode->data >> 3 ) + child];
+			if ( currentTriangle == -1 )
+			{
+				break;
+			}
+
+			const int offset = ( currentTriangle & 0x7FFFFFFF );
+			leafTriangles = &model.overflow[offset];
+			leafTriangleCount = model.header.numOverflow - offset;
+			j = 0;
+			currentTriangle = leafTriangles[0];
 		}
+		test( currentTriangle );
+	}
+}
 
-		// Check for an intersection with a triangle in this leaf.
-		const kdtree_leaf_t * currentLeaf = &leafs[( currentNode->data >> 3 )];
-		const int * leafTriangles = currentLeaf->triangles;
-		int leafTriangleCount = RT_KDTREE_MAX_LEAF_TRIANGLES;
-		for ( int j = 0; j < leafTriangleCount; j++ )
+// Calculates the distance along the ray where the next leaf is entered and uses
+// a rope to get to it. Returns false if the ray is done.
+static bool ExitLeaf( const ModelTrace & model, const kdtree_leaf_t & leaf, traceRay_t & ray )
+{
+	const float sXX = ( leaf.bounds.GetMins()[0] - ray.start.x ) * ray.rcpRayDir.x;
+	const float sYY = ( leaf.bounds.GetMins()[1] - ray.start.y ) * ray.rcpRayDir.y;
+	const float sZZ = ( leaf.bounds.GetMins()[2] - ray.start.z ) * ray.rcpRayDir.z;
+
+	const float tXX = ( leaf.bounds.GetMaxs()[0] - ray.start.x ) * ray.rcpRayDir.x;
+	const float tYY = ( leaf.bounds.GetMaxs()[1] - ray.start.y ) * ray.rcpRayDir.y;
+	const float tZZ = ( leaf.bounds.GetMaxs()[2] - ray.start.z ) * ray.rcpRayDir.z;
+
+	const float maxXX = Alg::Max( sXX, tXX );
+	const float maxYY = Alg::Max( sYY, tYY );
+	const float maxZZ = Alg::Max( sZZ, tZZ );
+
+	ray.entryDistance = Alg::Min( maxXX, Alg::Min( maxYY, maxZZ ) );
+	if ( ray.entryDistance >= ray.bestDistance )
+	{
+		return false;
+	}
+
+	// Calculate the exit plane.
+	const int exitX = ( 0 << 1 ) | ( ( sXX < tXX ) ? 1 : 0 );
+	const int exitY = ( 1 << 1 ) | ( ( sYY < tYY ) ? 1 : 0 );
+	const int exitZ = ( 2 << 1 ) | ( ( sZZ < tZZ ) ? 1 : 0 );
+	const int exitPlane = ( maxXX < maxYY ) ? ( maxXX < maxZZ ? exitX : exitZ ) : ( maxYY < maxZZ ? exitY : exitZ );
+
+	// Use a rope to enter the adjacent leaf.
+	ray.nodeIndex = leaf.ropes[exitPlane];
+	return ( ray.nodeIndex != -1 );
+}
+
+// Tests the ray against the triangles of a leaf.
+static void IntersectLeaf( const ModelTrace & model, const kdtree_leaf_t & leaf, traceRay_t & ray )
+{
+	ForEachLeafTriangle( model, leaf, [&]( const int currentTriangle )
+	{
+		float distance;
+		float u;
+		float v;
+
+		if ( Intersect_RayTriangle( ray.start, ray.rayDir,
+									model.vertices[model.indices[currentTriangle * 3 + 0]],
+									model.vertices[model.indices[currentTriangle * 3 + 1]],
+									model.vertices[model.indices[currentTriangle * 3 + 2]], distance, u, v ) )
 		{
-			int currentTriangle = leafTriangles[j];
-			if ( currentTriangle < 0 )
+			if ( distance >= 0.0f && distance < ray.bestDistance )
 			{
-				if ( currentTriangle == -1 )
-				{
-					break;
-				}
+				ray.bestDistance = distance;
 
-				const int offset = ( currentTriangle & 0x7FFFFFFF );
-				leafTriangles = &overflow[offset];
-				leafTriangleCount = header.numOverflow - offset;
-				j = 0;
-				currentTriangle = leafTriangles[0];
+				ray.triangleIndex = currentTriangle * 3;
+				ray.uv.x = u;
+				ray.uv.y = v;
 			}
+		}
+	} );
+}
+
+// Walks the leaves along the ray, starting at the leaf the ray is about to enter.
+static void TraceLeaves( const ModelTrace & model, traceRay_t & ray )
+{
+	if ( ray.nodeIndex < 0 )
+	{
+		return;
+	}
 
-			float distance;
-			float u;
-			float v;
+	for ( ; ray.iteration < RT_KDTREE_MAX_ITERATIONS; ray.iteration++ )
+	{
+		// Check for an intersection with a triangle in this leaf.
+		const kdtree_leaf_t & leaf = model.leafs[FindLeaf( model, ray )];
+		IntersectLeaf( model, leaf, ray );
 
-			if ( Intersect_RayTriangle( start, rayDir,
-										vertices[indices[currentTriangle * 3 + 0]],
-										vertices[indices[currentTriangle * 3 + 1]],
-										vertices[indices[currentTriangle * 3 + 2]], distance, u, v ) )
+		if ( !ExitLeaf( model, leaf, ray ) )
+		{
+			break;
+		}
+	}
+	ray.nodeIndex = -1;
+}
+
+static traceResult_t EndTrace( const ModelTrace & model, const traceRay_t & ray )
+{
+	traceResult_t result;
+	result.triangleIndex = ray.triangleIndex;
+	result.fraction = 1.0f;
+	result.uv = Vector2f( 0.0f );
+	result.normal = Vector3f( 0.0f );
+
+	if ( result.triangleIndex != -1 )
+	{
+		result.fraction = ray.bestDistance * ray.rayLengthRcp;
+		// return default uvs if the model has no uvs
+		if ( model.uvs.GetSizeI() == 0 )
+		{
+			result.uv = Vector2f( 0.0f, 0.0f );
+		}
+		else
+		{
+			result.uv = model.uvs[model.indices[result.triangleIndex + 0]] * ( 1.0f - ray.uv.x - ray.uv.y ) +
+						model.uvs[model.indices[result.triangleIndex + 1]] * ray.uv.x +
+						model.uvs[model.indices[result.triangleIndex + 2]] * ray.uv.y;
+		}
+		const Vector3f d1 = model.vertices[model.indices[result.triangleIndex + 1]] - model.vertices[model.indices[result.triangleIndex + 0]];
+		const Vector3f d2 = model.vertices[model.indices[result.triangleIndex + 2]] - model.vertices[model.indices[result.triangleIndex + 0]];
+		result.normal = d1.Cross( d2 ).Normalized();
+	}
+
+	return result;
+}
+
+//==============================================================
+// BVH traversal
+
+struct bvhStackEntry_t
+{
+	UInt32	child;
+	float	distance;	// where the ray enters the child
+};
+
+// Walks the BVH front to back with a stack. The four children of a node are tested
+// at once, the children that are hit are pushed far to near, and children that start
+// beyond the closest hit so far are skipped when they are popped.
+static void TraceBvh( const ModelTrace & model, traceRay_t & ray )
+{
+	// The child bounds are rounded outwards, so the hits are not clipped to the model
+	// bounds like with the kd-tree, which cuts off hits on the bounds of large models.
+	ray.bestDistance = ray.rayDelta.LengthSq() * ray.rayLengthRcp;
+
+	// The bounds that are entered first along each axis.
+	const int nearX = ( ray.rcpRayDir.x < 0.0f ) ? 1 : 0;
+	const int nearY = ( ray.rcpRayDir.y < 0.0f ) ? 1 : 0;
+	const int nearZ = ( ray.rcpRayDir.z < 0.0f ) ? 1 : 0;
+
+	bvhStackEntry_t stack[RT_BVH_STACK_SIZE];
+	int stackSize = 0;
+	stack[stackSize].child = 0;
+	stack[stackSize].distance = ray.entryDistance;
+	stackSize++;
+
+	while ( stackSize > 0 )
+	{
+		const bvhStackEntry_t entry = stack[--stackSize];
+		if ( entry.distance >= ray.bestDistance )
+		{
+			continue;
+		}
+
+		if ( ( entry.child & RT_BVH_LEAF ) != 0 )
+		{
+			const int first = entry.child & ( RT_BVH_MAX_TRIANGLES - 1 );
+			const int count = ( ( entry.child >> 28 ) & 7 ) + 1;
+			for ( int i = first; i < first + count; i++ )
 			{
-				if ( distance >= 0.0f && distance < bestDistance )
+				const int currentTriangle = model.bvhTriangles[i];
+
+				float distance;
+				float u;
+				float v;
+
+				if ( Intersect_RayTriangle( ray.start, ray.rayDir,
+											model.vertices[model.indices[currentTriangle * 3 + 0]],
+											model.vertices[model.indices[currentTriangle * 3 + 1]],
+											model.vertices[model.indices[currentTriangle * 3 + 2]], distance, u, v ) )
 				{
-					bestDistance = distance;
+					if ( distance >= 0.0f && distance < ray.bestDistance )
+					{
+						ray.bestDistance = distance;
 
-					result.triangleIndex = currentTriangle * 3;
-					uv.x = u;
-					uv.y = v;
+						ray.triangleIndex = currentTriangle * 3;
+						ray.uv.x = u;
+						ray.uv.y = v;
+					}
 				}
 			}
+			continue;
 		}
 
-		// Calculate the distance along the ray where the next leaf is entered.
-		const float sXX = ( currentLeaf->bounds.GetMins()[0] - start.x ) * rcpRayDirX;
-		const float sYY = ( currentLeaf->bounds.GetMins()[1] - start.y ) * rcpRayDirY;
-		const float sZZ = ( currentLeaf->bounds.GetMins()[2] - start.z ) * rcpRayDirZ;
+		const bvh_node_t & node = model.bvhNodes[entry.child];
+
+		// distance = ( origin + bounds * scale - start ) * rcpRayDir = bounds * scaleX + offsetX
+		const ovrFloat4 scaleX = Float4Splat( node.scale[0] * ray.rcpRayDir.x );
+		const ovrFloat4 scaleY = Float4Splat( node.scale[1] * ray.rcpRayDir.y );
+		const ovrFloat4 scaleZ = Float4Splat( node.scale[2] * ray.rcpRayDir.z );
+		const ovrFloat4 offsetX = Float4Splat( ( node.origin[0] - ray.start.x ) * ray.rcpRayDir.x );
+		const ovrFloat4 offsetY = Float4Splat( ( node.origin[1] - ray.start.y ) * ray.rcpRayDir.y );
+		const ovrFloat4 offsetZ = Float4Splat( ( node.origin[2] - ray.start.z ) * ray.rcpRayDir.z );
 
-		const float tXX = ( currentLeaf->bounds.GetMaxs()[0] - start.x ) * rcpRayDirX;
-		const float tYY = ( currentLeaf->bounds.GetMaxs()[1] - start.y ) * rcpRayDirY;
-		const float tZZ = ( currentLeaf->bounds.GetMaxs()[2] - start.z ) * rcpRayDirZ;
+		const ovrFloat4 enterX = Float4Add( Float4Mul( Float4FromUInt16( node.bounds[nearX][0] ), scaleX ), offsetX );
+		const ovrFloat4 enterY = Float4Add( Float4Mul( Float4FromUInt16( node.bounds[nearY][1] ), scaleY ), offsetY );
+		const ovrFloat4 enterZ = Float4Add( Float4Mul( Float4FromUInt16( node.bounds[nearZ][2] ), scaleZ ), offsetZ );
+		const ovrFloat4 exitX = Float4Add( Float4Mul( Float4FromUInt16( node.bounds[1 - nearX][0] ), scaleX ), offsetX );
+		const ovrFloat4 exitY = Float4Add( Float4Mul( Float4FromUInt16( node.bounds[1 - nearY][1] ), scaleY ), offsetY );
+		const ovrFloat4 exitZ = Float4Add( Float4Mul( Float4FromUInt16( node.bounds[1 - nearZ][2] ), scaleZ ), offsetZ );
 
-		const float maxXX = Alg::Max( sXX, tXX );
-		const float maxYY = Alg::Max( sYY, tYY );
-		const float maxZZ = Alg::Max( sZZ, tZZ );
+		const ovrFloat4 enter = Float4Max( Float4Max( enterX, enterY ), Float4Max( enterZ, Float4Splat( 0.0f ) ) );
+		const ovrFloat4 exit = Float4Min( Float4Min( exitX, exitY ), Float4Min( exitZ, Float4Splat( ray.bestDistance ) ) );
 
-		entryDistance = Alg::Min( maxXX, Alg::Min( maxYY, maxZZ ) );
-		if ( entryDistance >= bestDistance )
+		const int hitMask = Mask4Bits( Float4LessEqual( enter, exit ) );
+		if ( hitMask == 0 )
 		{
-			break;
+			continue;
 		}
 
-		// Calculate the exit plane.
-		const int exitX = ( 0 << 1 ) | ( ( sXX < tXX ) ? 1 : 0 );
-		const int exitY = ( 1 << 1 ) | ( ( sYY < tYY ) ? 1 : 0 );
-		const int exitZ = ( 2 << 1 ) | ( ( sZZ < tZZ ) ? 1 : 0 );
-		const int exitPlane = ( maxXX < maxYY ) ? ( maxXX < maxZZ ? exitX : exitZ ) : ( maxYY < maxZZ ? exitY : exitZ );
+		float enterLanes[4];
+		Float4Store( enterLanes, enter );
 
-		// Use a rope to enter the adjacent leaf.
-		const int exitNodeIndex = currentLeaf->ropes[exitPlane];
-		if ( exitNodeIndex == -1 )
+		// Sort the children that are hit far to near.
+		int order[4];
+		int numHits = 0;
+		for ( int i = 0; i < 4; i++ )
 		{
-			break;
+			if ( ( hitMask & ( 1 << i ) ) == 0 || node.children[i] == RT_BVH_NO_CHILD )
+			{
+				continue;
+			}
+			int j = numHits++;
+			for ( ; j > 0 && enterLanes[order[j - 1]] < enterLanes[i]; j-- )
+			{
+				order[j] = order[j - 1];
+			}
+			order[j] = i;
 		}
 
-		currentNode = &nodes[exitNodeIndex];
+		for ( int i = 0; i < numHits; i++ )
+		{
+			stack[stackSize].child = node.children[order[i]];
+			stack[stackSize].distance = enterLanes[order[i]];
+			stackSize++;
+		}
 	}
+	ray.nodeIndex = -1;
+}
 
-	if ( result.triangleIndex != -1 )
+traceResult_t ModelTrace::Trace( const Vector3f & start, const Vector3f & end ) const
+{
+	// in debug, at least warn programmers if they're loading a model
+	// that fails simple validation.
+	OVR_ASSERT( Validate( false ) );
+
+	traceRay_t ray;
+	if ( BeginTrace( *this, start, end, ray ) )
 	{
-		result.fraction = bestDistance * rayLengthRcp;
-		// return default uvs if the model has no uvs
-		if ( uvs.GetSizeI() == 0 )
+		if ( HasBvh() )
 		{
-			result.uv = Vector2f( 0.0f, 0.0f );
+			TraceBvh( *this, ray );
 		}
 		else
 		{
-			result.uv = uvs[indices[result.triangleIndex + 0]] * ( 1.0f - uv.x - uv.y ) +
-						uvs[indices[result.triangleIndex + 1]] * uv.x +
-						uvs[indices[result.triangleIndex + 2]] * uv.y;
+			TraceLeaves( *this, ray );
 		}
-		const Vector3f d1 = vertices[indices[result.triangleIndex + 1]] - vertices[indices[result.triangleIndex + 0]];
-		const Vector3f d2 = vertices[indices[result.triangleIndex + 2]] - vertices[indices[result.triangleIndex + 0]];
-		result.normal = d1.Cross( d2 ).Normalized();
 	}
+	return EndTrace( *this, ray );
+}
 
-	return result;
+//==============================================================
+// Packet traversal
+
+/*
+
+The rays of a packet walk the leaves together. The ray that is furthest behind is
+advanced first, together with all rays that are in the same leaf, so the leaf is
+fetched once and each triangle is tested against four rays at a time. Rays that
+are ahead wait in their leaf until the others catch up, which keeps the packet
+together when the rays briefly diverge around an edge. Each ray still selects its
+own children and ropes with the code of a single ray, so it visits the same leaves
+and finds the same hit as Trace().
+
+The triangle test is Intersect_RayTriangle() with the same operations in the same
+order, so the packet and single ray results are the same to the bit wherever the
+scalar code isn't contracted into fused multiply-adds.
+
+*/
+
+struct tracePacket_t
+{
+	float	startX[RT_KDTREE_MAX_PACKET_RAYS];
+	float	startY[RT_KDTREE_MAX_PACKET_RAYS];
+	float	startZ[RT_KDTREE_MAX_PACKET_RAYS];
+	float	dirX[RT_KDTREE_MAX_PACKET_RAYS];
+	float	dirY[RT_KDTREE_MAX_PACKET_RAYS];
+	float	dirZ[RT_KDTREE_MAX_PACKET_RAYS];
+};
+
+static void IntersectPacketTriangle( const ModelTrace & model, const int triangle, const tracePacket_t & packet,
+									const int activeMask, traceRay_t * rays )
+{
+	const Vector3f & v0 = model.vertices[model.indices[triangle * 3 + 0]];
+	const Vector3f & v1 = model.vertices[model.indices[triangle * 3 + 1]];
+	const Vector3f & v2 = model.vertices[model.indices[triangle * 3 + 2]];
+
+	const Vector3f edge1 = v1 - v0;
+	const Vector3f edge2 = v2 - v0;
+
+	const ovrFloat4 e1x = Float4Splat( edge1.x );
+	const ovrFloat4 e1y = Float4Splat( edge1.y );
+	const ovrFloat4 e1z = Float4Splat( edge1.z );
+	const ovrFloat4 e2x = Float4Splat( edge2.x );
+	const ovrFloat4 e2y = Float4Splat( edge2.y );
+	const ovrFloat4 e2z = Float4Splat( edge2.z );
+	const ovrFloat4 zero = Float4Splat( 0.0f );
+	const ovrFloat4 smallest = Float4Splat( Math<float>::SmallestNonDenormal );
+
+	for ( int group = 0; group < RT_KDTREE_MAX_PACKET_RAYS / 4; group++ )
+	{
+		const int groupMask = ( activeMask >> ( group * 4 ) ) & 15;
+		if ( groupMask == 0 )
+		{
+			continue;
+		}
+
+		const int first = group * 4;
+		const ovrFloat4 dx = Float4Load( packet.dirX + first );
+		const ovrFloat4 dy = Float4Load( packet.dirY + first );
+		const ovrFloat4 dz = Float4Load( packet.dirZ + first );
+
+		// tv = rayStart - v0
+		const ovrFloat4 tvx = Float4Sub( Float4Load( packet.startX + first ), Float4Splat( v0.x ) );
+		const ovrFloat4 tvy = Float4Sub( Float4Load( packet.startY + first ), Float4Splat( v0.y ) );
+		const ovrFloat4 tvz = Float4Sub( Float4Load( packet.startZ + first ), Float4Splat( v0.z ) );
+
+		// pv = rayDir.Cross( edge2 )
+		const ovrFloat4 pvx = Float4Sub( Float4Mul( dy, e2z ), Float4Mul( dz, e2y ) );
+		const ovrFloat4 pvy = Float4Sub( Float4Mul( dz, e2x ), Float4Mul( dx, e2z ) );
+		const ovrFloat4 pvz = Float4Sub( Float4Mul( dx, e2y ), Float4Mul( dy, e2x ) );
+
+		// qv = tv.Cross( edge1 )
+		const ovrFloat4 qvx = Float4Sub( Float4Mul( tvy, e1z ), Float4Mul( tvz, e1y ) );
+		const ovrFloat4 qvy = Float4Sub( Float4Mul( tvz, e1x ), Float4Mul( tvx, e1z ) );
+		const ovrFloat4 qvz = Float4Sub( Float4Mul( tvx, e1y ), Float4Mul( tvy, e1x ) );
+
+		const ovrFloat4 det = Float4Add( Float4Add( Float4Mul( e1x, pvx ), Float4Mul( e1y, pvy ) ), Float4Mul( e1z, pvz ) );
+		const ovrFloat4 s = Float4Add( Float4Add( Float4Mul( tvx, pvx ), Float4Mul( tvy, pvy ) ), Float4Mul( tvz, pvz ) );
+		const ovrFloat4 t = Float4Add( Float4Add( Float4Mul( dx, qvx ), Float4Mul( dy, qvy ) ), Float4Mul( dz, qvz ) );
+
+		// A front facing triangle with the hit inside its edges.
+		ovrMask4 hit = Float4GreaterThan( det, smallest );
+		hit = Mask4And( hit, Float4GreaterEqual( s, zero ) );
+		hit = Mask4And( hit, Float4LessEqual( s, det ) );
+		hit = Mask4And( hit, Float4GreaterEqual( t, zero ) );
+		hit = Mask4And( hit, Float4LessEqual( Float4Add( s, t ), det ) );
+
+		const int hitMask = Mask4Bits( hit ) & groupMask;
+		if ( hitMask == 0 )
+		{
+			continue;
+		}
+
+		// The divide is only done for the rays that hit the triangle.
+		const ovrFloat4 d = Float4Add( Float4Add( Float4Mul( e2x, qvx ), Float4Mul( e2y, qvy ) ), Float4Mul( e2z, qvz ) );
+		float detLanes[4];
+		float sLanes[4];
+		float tLanes[4];
+		float dLanes[4];
+		Float4Store( detLanes, det );
+		Float4Store( sLanes, s );
+		Float4Store( tLanes, t );
+		Float4Store( dLanes, d );
+		for ( int lane = 0; lane < 4; lane++ )
+		{
+			if ( ( hitMask & ( 1 << lane ) ) == 0 )
+			{
+				continue;
+			}
+			const float rcpDet = 1.0f / detLanes[lane];
+			const float distance = dLanes[lane] * rcpDet;
+			traceRay_t & ray = rays[first + lane];
+			if ( distance >= 0.0f && distance < ray.bestDistance )
+			{
+				ray.bestDistance = distance;
+
+				ray.triangleIndex = triangle * 3;
+				ray.uv.x = sLanes[lane] * rcpDet;
+				ray.uv.y = tLanes[lane] * rcpDet;
+			}
+		}
+	}
+}
+
+static int CountBits( int mask )
+{
+	int count = 0;
+	for ( ; mask != 0; mask &= mask - 1 )
+	{
+		count++;
+	}
+	return count;
+}
+
+static void TracePacket( const ModelTrace & model, traceRay_t * rays, const int numRays )
+{
+	tracePacket_t packet;
+	memset( &packet, 0, sizeof( packet ) );
+
+	int activeMask = 0;
+	int leafOf[RT_KDTREE_MAX_PACKET_RAYS];
+	for ( int i = 0; i < numRays; i++ )
+	{
+		packet.startX[i] = rays[i].start.x;
+		packet.startY[i] = rays[i].start.y;
+		packet.startZ[i] = rays[i].start.z;
+		packet.dirX[i] = rays[i].rayDir.x;
+		packet.dirY[i] = rays[i].rayDir.y;
+		packet.dirZ[i] = rays[i].rayDir.z;
+		if ( rays[i].nodeIndex >= 0 )
+		{
+			activeMask |= 1 << i;
+			leafOf[i] = FindLeaf( model, rays[i] );
+		}
+	}
+
+	while ( activeMask != 0 )
+	{
+		// Advance the ray that is furthest behind, so the rays ahead of it
+		// wait in their leaf until the others catch up.
+		int first = -1;
+		for ( int i = 0; i < numRays; i++ )
+		{
+			if ( ( activeMask & ( 1 << i ) ) != 0 && ( first < 0 || rays[i].entryDistance < rays[first].entryDistance ) )
+			{
+				first = i;
+			}
+		}
+
+		// Take along all rays that are in the same leaf.
+		const int leafIndex = leafOf[first];
+		int groupMask = 0;
+		for ( int i = 0; i < numRays; i++ )
+		{
+			if ( ( activeMask & ( 1 << i ) ) != 0 && leafOf[i] == leafIndex )
+			{
+				groupMask |= 1 << i;
+			}
+		}
+
+		const kdtree_leaf_t & leaf = model.leafs[leafIndex];
+		if ( CountBits( groupMask ) > 1 )
+		{
+			ForEachLeafTriangle( model, leaf, [&]( const int currentTriangle )
+			{
+				IntersectPacketTriangle( model, currentTriangle, packet, groupMask, rays );
+			} );
+		}
+		else
+		{
+			IntersectLeaf( model, leaf, rays[first] );
+		}
+
+		for ( int i = 0; i < numRays; i++ )
+		{
+			if ( ( groupMask & ( 1 << i ) ) == 0 )
+			{
+				continue;
+			}
+			if ( ExitLeaf( model, leaf, rays[i] ) && ++rays[i].iteration < RT_KDTREE_MAX_ITERATIONS )
+			{
+				leafOf[i] = FindLeaf( model, rays[i] );
+			}
+			else
+			{
+				rays[i].nodeIndex = -1;
+				activeMask &= ~( 1 << i );
+			}
+		}
+	}
+}
+
+void ModelTrace::TraceBatch( const Vector3f * starts, const Vector3f * ends, const int count,
+							traceResult_t * results, const int packetRays ) const
+{
+	OVR_ASSERT( Validate( false ) );
+
+	// The packets are only used with the kd-tree.
+	if ( HasBvh() )
+	{
+		for ( int i = 0; i < count; i++ )
+		{
+			results[i] = Trace( starts[i], ends[i] );
+		}
+		return;
+	}
+
+	const int raysPerPacket = Alg::Clamp( packetRays, 1, RT_KDTREE_MAX_PACKET_RAYS );
+
+	traceRay_t rays[RT_KDTREE_MAX_PACKET_RAYS];
+	for ( int first = 0; first < count; first += raysPerPacket )
+	{
+		const int numRays = Alg::Min( raysPerPacket, count - first );
+		for ( int i = 0; i < numRays; i++ )
+		{
+			BeginTrace( *this, starts[first + i], ends[first + i], rays[i] );
+		}
+		// Rays that do not all point into the same octant rarely share leaves.
+		bool coherent = numRays > 1;
+		for ( int i = 1; i < numRays && coherent; i++ )
+		{
+			coherent = ( ( rays[i].rayDir.x < 0.0f ) == ( rays[0].rayDir.x < 0.0f ) ) &&
+						( ( rays[i].rayDir.y < 0.0f ) == ( rays[0].rayDir.y < 0.0f ) ) &&
+						( ( rays[i].rayDir.z < 0.0f ) == ( rays[0].rayDir.z < 0.0f ) );
+		}
+		if ( coherent )
+		{
+			TracePacket( *this, rays, numRays );
+		}
+		else
+		{
+			for ( int i = 0; i < numRays; i++ )
+			{
+				TraceLeaves( *this, rays[i] );
+			}
+		}
+		for ( int i = 0; i < numRays; i++ )
+		{
+			results[first + i] = EndTrace( *this, rays[i] );
+		}
+	}
 }
 
 traceResult_t ModelTrace::Trace_Exhaustive( const Vector3f & start, const Vector3f & end ) const
@@ -369,4 +958,345 @@ traceResult_t ModelTrace::Trace_Exhaustive( const Vector3f & start, const Vector
 	return result;
 }
 
+//==============================================================
+// BVH build
+
+/*
+
+	On fast Construction of SAH-based Bounding Volume Hierarchies
+	Ingo Wald
+	IEEE Symposium on Interactive Ray Tracing, 2007
+
+The triangles are binned by their centroids along each axis and the split with the
+lowest surface area heuristic cost is taken. A node is filled by splitting the child
+with the largest surface area until the node has four children, so the 4-ary tree is
+built directly instead of collapsing a binary tree.
+
+*/
+
+const int	RT_BVH_BINS				= 16;
+const float	RT_BVH_TRAVERSAL_COST	= 1.0f;	// relative to the cost of a ray-triangle test
+
+struct bvhRange_t
+{
+	int			first;
+	int			count;
+	Bounds3f	bounds;
+	Bounds3f	centroidBounds;
+};
+
+struct bvhBuild_t
+{
+	Array< Bounds3f >		triangleBounds;
+	Array< Vector3f >		centroids;
+	Array< int >			triangles;
+	Array< bvh_node_t >		nodes;
+};
+
+static float HalfArea( const Bounds3f & bounds )
+{
+	const Vector3f size = bounds.GetSize();
+	return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+static void CalculateRangeBounds( const bvhBuild_t & build, bvhRange_t & range )
+{
+	range.bounds = Bounds3f( Bounds3f::Init );
+	range.centroidBounds = Bounds3f( Bounds3f::Init );
+	for ( int i = range.first; i < range.first + range.count; i++ )
+	{
+		const int triangle = build.triangles[i];
+		range.bounds = Bounds3f::Union( range.bounds, build.triangleBounds[triangle] );
+		range.centroidBounds.AddPoint( build.centroids[triangle] );
+	}
+}
+
+static int CentroidBin( const float centroid, const float mins, const float binScale )
+{
+	return Alg::Clamp( (int)( ( centroid - mins ) * binScale ), 0, RT_BVH_BINS - 1 );
+}
+
+// Returns false if the range is better off as a leaf.
+static bool SplitRange( bvhBuild_t & build, const bvhRange_t & range, bvhRange_t & left, bvhRange_t & right )
+{
+	if ( range.count <= 1 )
+	{
+		return false;
+	}
+
+	const Vector3f centroidSize = range.centroidBounds.GetSize();
+
+	float bestCost = Math<float>::MaxValue;
+	int bestAxis = -1;
+	int bestBin = 0;
+
+	for ( int axis = 0; axis < 3; axis++ )
+	{
+		if ( centroidSize[axis] <= 0.0f )
+		{
+			continue;
+		}
+
+		const float binScale = RT_BVH_BINS / centroidSize[axis];
+		int binCounts[RT_BVH_BINS] = { 0 };
+		Bounds3f binBounds[RT_BVH_BINS];
+		for ( int i = 0; i < RT_BVH_BINS; i++ )
+		{
+			binBounds[i] = Bounds3f( Bounds3f::Init );
+		}
+		for ( int i = range.first; i < range.first + range.count; i++ )
+		{
+			const int triangle = build.triangles[i];
+			const int bin = CentroidBin( build.centroids[triangle][axis], range.centroidBounds.GetMins()[axis], binScale );
+			binCounts[bin]++;
+			binBounds[bin] = Bounds3f::Union( binBounds[bin], build.triangleBounds[triangle] );
+		}
+
+		// Sweep from the right to get the cost of the right side of each split.
+		float rightCosts[RT_BVH_BINS];
+		Bounds3f rightBounds( Bounds3f::Init );
+		int rightCount = 0;
+		for ( int i = RT_BVH_BINS - 1; i > 0; i-- )
+		{
+			rightBounds = Bounds3f::Union( rightBounds, binBounds[i] );
+			rightCount += binCounts[i];
+			rightCosts[i] = ( rightCount > 0 ) ? HalfArea( rightBounds ) * rightCount : 0.0f;
+		}
+
+		// Sweep from the left and split after bin 'i'.
+		Bounds3f leftBounds( Bounds3f::Init );
+		int leftCount = 0;
+		for ( int i = 0; i < RT_BVH_BINS - 1; i++ )
+		{
+			leftBounds = Bounds3f::Union( leftBounds, binBounds[i] );
+			leftCount += binCounts[i];
+			if ( leftCount == 0 || leftCount == range.count )
+			{
+				continue;
+			}
+			const float cost = HalfArea( leftBounds ) * leftCount + rightCosts[i + 1];
+			if ( cost < bestCost )
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = i;
+			}
+		}
+	}
+
+	int splitCount;
+	if ( bestAxis == -1 )
+	{
+		// All centroids are in the same place, so only split to keep the leaves small.
+		if ( range.count <= RT_BVH_MAX_LEAF_TRIANGLES )
+		{
+			return false;
+		}
+		splitCount = range.count / 2;
+	}
+	else
+	{
+		const float rangeArea = HalfArea( range.bounds );
+		const float splitCost = RT_BVH_TRAVERSAL_COST + ( ( rangeArea > 0.0f ) ? bestCost / rangeArea : (float)range.count );
+		if ( range.count <= RT_BVH_MAX_LEAF_TRIANGLES && splitCost >= (float)range.count )
+		{
+			return false;
+		}
+
+		// Partition the triangles around the split.
+		const float mins = range.centroidBounds.GetMins()[bestAxis];
+		const float binScale = RT_BVH_BINS / centroidSize[bestAxis];
+		int i = range.first;
+		int j = range.first + range.count - 1;
+		while ( i <= j )
+		{
+			if ( CentroidBin( build.centroids[build.triangles[i]][bestAxis], mins, binScale ) <= bestBin )
+			{
+				i++;
+			}
+			else
+			{
+				Alg::Swap( build.triangles[i], build.triangles[j] );
+				j--;
+			}
+		}
+		splitCount = i - range.first;
+	}
+
+	left.first = range.first;
+	left.count = splitCount;
+	right.first = range.first + splitCount;
+	right.count = range.count - splitCount;
+	CalculateRangeBounds( build, left );
+	CalculateRangeBounds( build, right );
+	return true;
+}
+
+static UInt16 QuantizeBound( const float value, const float origin, const float rcpScale, const int round )
+{
+	// Round outwards by an extra step so the child is never cut off by the rounding of the trace.
+	const float q = ( value - origin ) * rcpScale;
+	const int quantized = ( round < 0 ) ? (int)floorf( q ) - 1 : (int)ceilf( q ) + 1;
+	return (UInt16)Alg::Clamp( quantized, 0, 65535 );
+}
+
+// Fills in a node with the given ranges as children, after splitting them further
+// until there are four. Returns false if the tree gets too deep.
+static bool BuildNode( bvhBuild_t & build, const int nodeIndex, const bvhRange_t * initialRanges, const int numInitialRanges, const int depth )
+{
+	if ( depth >= RT_BVH_MAX_DEPTH )
+	{
+		return false;
+	}
+
+	bvhRange_t ranges[4];
+	bvhRange_t splits[4][2];
+	bool isSplit[4];
+	int numRanges = numInitialRanges;
+	for ( int i = 0; i < numRanges; i++ )
+	{
+		ranges[i] = initialRanges[i];
+		isSplit[i] = SplitRange( build, ranges[i], splits[i][0], splits[i][1] );
+	}
+
+	// Split the child with the largest area until there are four.
+	while ( numRanges < 4 )
+	{
+		int largest = -1;
+		for ( int i = 0; i < numRanges; i++ )
+		{
+			if ( isSplit[i] && ( largest < 0 || HalfArea( ranges[i].bounds ) > HalfArea( ranges[largest].bounds ) ) )
+			{
+				largest = i;
+			}
+		}
+		if ( largest < 0 )
+		{
+			break;
+		}
+		const bvhRange_t left = splits[largest][0];
+		const bvhRange_t right = splits[largest][1];
+		ranges[largest] = left;
+		ranges[numRanges] = right;
+		isSplit[largest] = SplitRange( build, ranges[largest], splits[largest][0], splits[largest][1] );
+		isSplit[numRanges] = SplitRange( build, ranges[numRanges], splits[numRanges][0], splits[numRanges][1] );
+		numRanges++;
+	}
+
+	// Quantize the child bounds relative to the node bounds.
+	Bounds3f nodeBounds( Bounds3f::Init );
+	for ( int i = 0; i < numRanges; i++ )
+	{
+		nodeBounds = Bounds3f::Union( nodeBounds, ranges[i].bounds );
+	}
+
+	bvh_node_t node;
+	float rcpScale[3];
+	for ( int axis = 0; axis < 3; axis++ )
+	{
+		const float mins = nodeBounds.GetMins()[axis];
+		const float maxs = nodeBounds.GetMaxs()[axis];
+		// Pad the bounds so flat nodes still have a scale and the rounding has room.
+		const float pad = ( maxs - mins ) * ( 4.0f / 65535.0f ) + ( fabsf( mins ) + fabsf( maxs ) ) * 1e-6f + 1e-6f;
+		node.origin[axis] = mins - pad;
+		node.scale[axis] = ( maxs + pad - node.origin[axis] ) / 65535.0f;
+		rcpScale[axis] = 1.0f / node.scale[axis];
+	}
+
+	for ( int i = 0; i < 4; i++ )
+	{
+		for ( int axis = 0; axis < 3; axis++ )
+		{
+			if ( i < numRanges )
+			{
+				node.bounds[0][axis][i] = QuantizeBound( ranges[i].bounds.GetMins()[axis], node.origin[axis], rcpScale[axis], -1 );
+				node.bounds[1][axis][i] = QuantizeBound( ranges[i].bounds.GetMaxs()[axis], node.origin[axis], rcpScale[axis], 1 );
+			}
+			else
+			{
+				// Empty bounds that are never hit.
+				node.bounds[0][axis][i] = 65535;
+				node.bounds[1][axis][i] = 0;
+			}
+		}
+		node.children[i] = RT_BVH_NO_CHILD;
+	}
+
+	// Leaves go straight into the node, the other children get a node of their own.
+	for ( int i = 0; i < numRanges; i++ )
+	{
+		if ( !isSplit[i] )
+		{
+			node.children[i] = RT_BVH_LEAF | ( ( ranges[i].count - 1 ) << 28 ) | ranges[i].first;
+			continue;
+		}
+		const int childIndex = build.nodes.GetSizeI();
+		build.nodes.AllocBack();
+		node.children[i] = childIndex;
+		if ( !BuildNode( build, childIndex, splits[i], 2, depth + 1 ) )
+		{
+			return false;
+		}
+	}
+
+	build.nodes[nodeIndex] = node;
+	return true;
+}
+
+bool ModelTrace::BuildBvh()
+{
+	const int numTris = indices.GetSizeI() / 3;
+	if ( numTris == 0 || numTris >= RT_BVH_MAX_TRIANGLES )
+	{
+		return false;
+	}
+
+	bvhBuild_t build;
+	build.triangleBounds.Resize( numTris );
+	build.centroids.Resize( numTris );
+	build.triangles.Resize( numTris );
+	for ( int i = 0; i < numTris; i++ )
+	{
+		Bounds3f & bounds = build.triangleBounds[i];
+		bounds = Bounds3f( Bounds3f::Init );
+		for ( int j = 0; j < 3; j++ )
+		{
+			const int index = indices[i * 3 + j];
+			if ( index < 0 || index >= vertices.GetSizeI() )
+			{
+				LOG( "ModelTrace::BuildBvh - index %i value %i is out of range, max %i", i * 3 + j, index, vertices.GetSizeI() - 1 );
+				return false;
+			}
+			bounds.AddPoint( vertices[index] );
+		}
+		build.centroids[i] = ( bounds.GetMins() + bounds.GetMaxs() ) * 0.5f;
+		build.triangles[i] = i;
+	}
+
+	bvhRange_t root;
+	root.first = 0;
+	root.count = numTris;
+	CalculateRangeBounds( build, root );
+
+	build.nodes.AllocBack();
+	if ( !BuildNode( build, 0, &root, 1, 0 ) )
+	{
+		LOG( "ModelTrace::BuildBvh - the BVH is deeper than %i", RT_BVH_MAX_DEPTH );
+		return false;
+	}
+
+	bvhNodes = build.nodes;
+	bvhTriangles = build.triangles;
+
+	// The kd-tree is no longer used.
+	nodes.ClearAndRelease();
+	leafs.ClearAndRelease();
+	overflow.ClearAndRelease();
+	header.numNodes = 0;
+	header.numLeafs = 0;
+	header.numOverflow = 0;
+	header.bounds = root.bounds;
+	return true;
+}
+
 }
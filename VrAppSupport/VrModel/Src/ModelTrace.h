@@ -1,7 +1,7 @@
 /************************************************************************************
 
 Filename    :   ModelTrace.h
-Content     :   Ray tracer using a KD-Tree.
+Content     :   Ray tracer using a KD-Tree or a BVH.
 Created     :   May, 2014
 Authors     :   J.M.P. van Waveren
 
@@ -19,6 +19,9 @@ namespace OVR
 {
 
 const int RT_KDTREE_MAX_LEAF_TRIANGLES	= 4;
+const int RT_KDTREE_MAX_PACKET_RAYS		= 8;
+const int RT_BVH_MAX_LEAF_TRIANGLES		= 8;
+const int RT_BVH_MAX_DEPTH				= 64;
 
 struct kdtree_header_t
 {
@@ -47,6 +50,20 @@ struct kdtree_leaf_t
 	Bounds3f	bounds;
 };
 
+// A node of the 4-ary BVH. The child bounds are stored relative to the node bounds,
+// quantized to 16 bits and rounded outwards: a child spans origin + bounds * scale.
+struct bvh_node_t
+{
+	float		origin[3];
+	float		scale[3];
+	UInt16		bounds[2][3][4];	// [min/max][axis][child]
+	// bit  [31   ] = leaf flag
+	// bits [30,28] = number of triangles - 1 of a leaf
+	// bits [27, 0] = index of the child node, or index of the first leaf triangle in bvhTriangles
+	// -1 = no child
+	UInt32		children[4];
+};
+
 struct traceResult_t
 {
 	int			triangleIndex;
@@ -66,6 +83,19 @@ public:
 	traceResult_t			Trace( const Vector3f & start, const Vector3f & end ) const;
 	traceResult_t			Trace_Exhaustive( const Vector3f & start, const Vector3f & end ) const;
 
+	// Traces the rays from starts[i] to ends[i] in packets of 'packetRays' rays, up to
+	// RT_KDTREE_MAX_PACKET_RAYS. Neighboring rays should be close together, like the rays
+	// of a block of pixels. The results are the same as those of Trace().
+	void					TraceBatch( const Vector3f * starts, const Vector3f * ends, const int count,
+										traceResult_t * results, const int packetRays = 4 ) const;
+
+	// Builds a BVH for the triangles with a binned SAH builder, which is fast enough
+	// to run at load time. Once the BVH is built the tracing functions use it instead
+	// of the kd-tree, which is released. Returns false, and keeps the kd-tree, if the
+	// BVH cannot be built.
+	bool					BuildBvh();
+	bool					HasBvh() const { return bvhNodes.GetSizeI() > 0; }
+
 public:
 	kdtree_header_t			header;
 	Array< Vector3f >		vertices;
@@ -74,6 +104,8 @@ public:
 	Array< kdtree_node_t >	nodes;
 	Array< kdtree_leaf_t >	leafs;
 	Array< int >			overflow;	// this is a flat array that stores extra triangle indices for leaves with > RT_KDTREE_MAX_LEAF_TRIANGLES
+	Array< bvh_node_t >		bvhNodes;
+	Array< int >			bvhTriangles;	// triangle indices referenced by the BVH leaves
 };
 
 }	// namespace OVR
@@ -275,54 +275,15 @@ void ModelInScene::AnimateJoints( const double timeInSeconds )
 	{
 		return;
 	}
-	for ( int i = 0; i < Definition->GetJointCount(); i++ )
-	{
-		const ModelJoint * joint = Definition->GetJoint( i );
-		if ( joint->animation == MODEL_JOINT_ANIMATION_NONE )
-		{
-			continue;
-		}
-
-		double time = ( timeInSeconds + joint->timeOffset ) * joint->timeScale;
-
-		switch( joint->animation )
-		{
-			case MODEL_JOINT_ANIMATION_SWAY:
-			{
-				time = sin( time * Math<double>::Pi );
-				// NOTE: fall through
-			}
-			case MODEL_JOINT_ANIMATION_ROTATE:
-			{
-				const Vector3d angles = Vector3d(joint->parameters) * ( Math<double>::DegreeToRadFactor * time );
-				const Matrix4f matrix = joint->transform *
-										Matrix4f::RotationY( static_cast<float>( fmod( angles.y, 2.0 * Math<double>::Pi ) ) ) *
-										Matrix4f::RotationX( static_cast<float>( fmod( angles.x, 2.0 * Math<double>::Pi ) ) ) *
-										Matrix4f::RotationZ( static_cast<float>( fmod( angles.z, 2.0 * Math<double>::Pi ) ) ) *
-										joint->transform.Inverted();
-				State.Joints[i] = matrix;
-				break;
-			}
-			case MODEL_JOINT_ANIMATION_BOB:
-			{
-				const float frac = static_cast<float>( sin( time * Math<double>::Pi ) );
-				const Vector3f offset = joint->parameters * frac;
-				const Matrix4f matrix = joint->transform *
-										Matrix4f::Translation( offset ) *
-										joint->transform.Inverted();
-				State.Joints[i] = matrix;
-				break;
-			}
-			case MODEL_JOINT_ANIMATION_NONE:
-				break;
-		}
-	}
+	AnimateModelJoints( Definition->Joints, State.Joints, timeInSeconds );
 }
 
 //-------------------------------------------------------------------------------------
 
 OvrSceneView::OvrSceneView() :
 	FreeWorldModelOnChange( false ),
+	TextureLoader( NULL ),
+	WarnedNoTextureLoader( false ),
 	LoadedPrograms( false ),
 	Paused( false ),
 	SuppressModelsWithClientId( -1 ),
@@ -381,15 +342,22 @@ void OvrSceneView::LoadWorldModel( const char * sceneFileName, const MaterialPar
 		GlPrograms = GetDefaultGLPrograms();
 	}
 
+	// the textures are decoded on the scene's workers while the geometry is parsed
+	MaterialParms parms = materialParms;
+	if ( parms.Workers == NULL )
+	{
+		parms.Workers = &GetWorkers();
+	}
+
 	ModelFile * model = NULL;
 	// Load the scene we are going to draw
 	if ( fromApk )
 	{
-		model = LoadModelFileFromApplicationPackage( sceneFileName, GlPrograms, materialParms );
+		model = LoadModelFileFromApplicationPackage( sceneFileName, GlPrograms, parms );
 	}
 	else
 	{
-		model = LoadModelFile( sceneFileName, GlPrograms, materialParms );
+		model = LoadModelFile( sceneFileName, GlPrograms, parms );
 	}
 
 	SetWorldModel( *model );
@@ -480,6 +448,16 @@ void OvrSceneView::RemoveModelIndex( int index )
 	Models[index] = NULL;
 }
 
+ovrWorkerPool & OvrSceneView::GetWorkers() const
+{
+	if ( !Workers.IsInitialized() )
+	{
+		// leave cores for the render and time warp threads
+		Workers.Init( Alg::Clamp( Thread::GetCPUCount() - 2, 0, 3 ) );
+	}
+	return Workers;
+}
+
 void OvrSceneView::GetFrameMatrices( const float fovDegreesX, const float fovDegreesY, ovrFrameMatrices & frameMatrices ) const
 {
 	frameMatrices.CenterView = GetCenterEyeViewMatrix();
@@ -508,7 +486,13 @@ void OvrSceneView::GenerateFrameSurfaceList( const ovrFrameMatrices & frameMatri
 		}
 	}
 
-	BuildModelSurfaceList( surfaceList, SuppressModelsWithClientId, emitModels, EmitSurfaces, centerEyeCullViewMatrix, symmetricEyeProjectionMatrix );
+	if ( emitModels.GetSizeI() >= ovrWorkerPool::MIN_PARALLEL_CULL_MODELS )
+	{
+		BuildModelSurfaceListParallel( GetWorkers(), CullBuffers, surfaceList, SuppressModelsWithClientId, emitModels, EmitSurfaces, centerEyeCullViewMatrix, symmetricEyeProjectionMatrix );
+		return;
+	}
+
+	BuildModelSurfaceList( CullBuffers, surfaceList, SuppressModelsWithClientId, emitModels, EmitSurfaces, centerEyeCullViewMatrix, symmetricEyeProjectionMatrix );
 }
 
 Matrix4f OvrSceneView::DrawEyeView( const int eye, const float fovDegreesX, const float fovDegreesY, ovrSurfaceRender & surfaceRender )
@@ -719,19 +703,51 @@ void OvrSceneView::Frame( const ovrFrameInput & vrFrame,
 	//
 	UpdateCenterEye();
 
+	//
+	// Deferred textures
+	//
+
+	for ( int i = 0; i < Models.GetSizeI(); i++ )
+	{
+		if ( Models[i] == NULL || Models[i]->Definition == NULL || !Models[i]->Definition->HasDeferredTextures() )
+		{
+			continue;
+		}
+		if ( TextureLoader != NULL )
+		{
+			// The loader decodes across frames and uploads within its budget,
+			// the placeholders are drawn until then.
+			Models[i]->Definition->UpdateDeferredTextures( *TextureLoader );
+		}
+		else
+		{
+			if ( !WarnedNoTextureLoader )
+			{
+				WARN( "OvrSceneView: no texture loader set, loading the deferred textures of %s in one frame",
+						Models[i]->Definition->FileName.ToCStr() );
+				WarnedNoTextureLoader = true;
+			}
+			Models[i]->Definition->LoadDeferredTextures( &GetWorkers() );
+		}
+	}
+
 	//
 	// Model animations
 	//
 
 	if ( !Paused )
 	{
+		JointAnimation.Clear();
 		for ( int i = 0; i < Models.GetSizeI(); i++ )
 		{
-			if ( Models[i] != NULL )
+			if ( Models[i] != NULL && Models[i]->Definition != NULL )
 			{
-				Models[i]->AnimateJoints( vrFrame.PredictedDisplayTimeInSeconds );
+				JointAnimation.AddModel( Models[i]->Definition->Joints, Models[i]->State.Joints );
 			}
 		}
+
+		ovrWorkerPool * workers = ( JointAnimation.GetNumJoints() >= ovrWorkerPool::MIN_PARALLEL_ANIMATION_JOINTS ) ? &GetWorkers() : NULL;
+		JointAnimation.Animate( vrFrame.PredictedDisplayTimeInSeconds, workers );
 	}
 
 	// External systems can add surfaces to this list before drawing.
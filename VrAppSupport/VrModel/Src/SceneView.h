@@ -13,6 +13,7 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 #define SCENEVIEW_H
 
 #include "ModelFile.h"
+#include "ModelAnimation.h"
 #include "App.h"		// ovrFrameResult
 #include "OVR_Input.h"	// ovrFrameInput, etc
 
@@ -133,6 +134,16 @@ public:
 	// Mod stick turning by this to help with sickness. If <= 0 then ignored
 	void					SetYawMod( const float yawMod ) { YawMod = yawMod; }
 
+	// Loads the textures of models loaded with MaterialParms::DeferTextureLoads, see
+	// ModelFile::UpdateDeferredTextures. Usually the App's loader, which uploads within
+	// a per-frame budget. Without a loader Frame() decodes and uploads all textures of
+	// such a model at once, which stalls that frame.
+	void					SetTextureLoader( ovrTextureLoader * loader ) { TextureLoader = loader; }
+
+	// Draw at most this many surfaces per frame, see ovrSurfaceListBuffers::MaxSurfaces.
+	// The default of 0 draws every surface that is not culled.
+	void					SetMaxDrawSurfaces( const int maxSurfaces ) { CullBuffers.MaxSurfaces = maxSurfaces; }
+
 private:
     void                    LoadWorldModel( const char * sceneFileName, const MaterialParms & materialParms, const bool fromApk );
 
@@ -147,6 +158,20 @@ private:
 	// Externally generated surfaces
 	Array<ovrDrawSurface>	EmitSurfaces;
 
+	// Splits culling and joint animation across threads once there are enough
+	// models, and decodes the textures of LoadWorldModel(). Started on first use,
+	// so scenes with few models never create the threads.
+	mutable ovrWorkerPool	Workers;
+	// Reused every frame by the serial and the parallel surface list.
+	mutable ovrSurfaceListBuffers	CullBuffers;
+	// The animated joints of all models, evaluated together.
+	ovrJointAnimationBatch	JointAnimation;
+	// Loads the textures of models with deferred textures, not owned.
+	ovrTextureLoader *		TextureLoader;
+	bool					WarnedNoTextureLoader;
+
+	ovrWorkerPool &			GetWorkers() const;
+
 	GlProgram				ProgVertexColor;
 	GlProgram				ProgSingleTexture;
 	GlProgram				ProgLightMapped;
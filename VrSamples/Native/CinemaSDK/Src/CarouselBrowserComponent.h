@@ -68,6 +68,8 @@ public:
 	void							SetPanelPoses( OvrVRMenuMgr & menuMgr, VRMenuObject * self, const Array<PanelPose> &panelPoses );
 	void 							SetMenuObjects( const Array<VRMenuObject *> &menuObjs, const Array<CarouselItemComponent *> &menuComps );
 	void							SetItems( const Array<CarouselItem *> &items );
+	// Call when the textures of the items changed.
+	void							RefreshItems() { PanelsNeedUpdate = true; }
 	void							SetSelectionIndex( const int selectedIndex );
     int 							GetSelection() const;
 	bool							HasSelection() const;
@@ -454,6 +454,8 @@ ovrFrameResult CinemaApp::Frame( const ovrFrameInput & vrFrame )
 		LOG( "Headset unmounted" );
 	}
 
+	MovieMgr.Frame();
+
 	// The View handles setting the FrameResult and Parms.
 	ViewMgr.Frame( vrFrame );
 
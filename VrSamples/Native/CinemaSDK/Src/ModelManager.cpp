@@ -210,6 +210,8 @@ SceneDef * ModelManager::LoadScene( const char *sceneFilename, bool useDynamicPr
 	materialParms.EnableDiffuseAniso = true;
 	// The emissive texture is used as a separate lighting texture and should not be LOD clamped.
 	materialParms.EnableEmissiveLodClamp = false;
+	// The theaters share many textures and meshes, which are loaded once for all of them.
+	materialParms.ShareAssets = true;
 
 	ModelGlPrograms glPrograms = ( useDynamicProgram ) ? Cinema.ShaderMgr.DynamicPrograms : Cinema.ShaderMgr.DefaultPrograms;
 
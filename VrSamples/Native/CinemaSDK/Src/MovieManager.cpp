@@ -20,6 +20,7 @@ of patent rights can be found in the PATENTS file in the same directory.
 #include "CinemaApp.h"
 #include "PackageFiles.h"
 #include "Native.h"
+#include "VrCommon.h"
 
 #if defined( OVR_OS_ANDROID )
 #include <dirent.h>
@@ -77,6 +78,14 @@ void MovieManager::OneTimeInit( const char * launchIntent )
 
 	const double start = vrapi_GetTimeInSeconds();
 
+	int width = 0;
+	int height = 0;
+	DefaultPoster = LoadTextureFromApplicationPackage( "assets/default_poster.png",
+			TextureFlags_t( TEXTUREFLAG_NO_DEFAULT ), width, height );
+	BuildTextureMipmaps( DefaultPoster );
+	MakeTextureTrilinear( DefaultPoster );
+	MakeTextureClamped( DefaultPoster );
+
 	LoadMovies();
 
 	LOG( "MovieManager::OneTimeInit: %i movies loaded, %3.1f seconds", Movies.GetSizeI(), vrapi_GetTimeInSeconds() - start );
@@ -85,6 +94,45 @@ void MovieManager::OneTimeInit( const char * launchIntent )
 void MovieManager::OneTimeShutdown()
 {
 	LOG( "MovieManager::OneTimeShutdown" );
+
+	ovrTextureLoader & loader = *Cinema.app->GetTextureLoader();
+	for ( int i = 0; i < PosterLoads.GetSizeI(); i++ )
+	{
+		if ( loader.GetState( PosterLoads[ i ].Request ) == ASYNC_TEXTURE_READY )
+		{
+			GlTexture poster = loader.GetTexture( PosterLoads[ i ].Request );
+			DeleteTexture( poster );
+		}
+		loader.FreeRequest( PosterLoads[ i ].Request );
+	}
+	PosterLoads.Clear();
+}
+
+void MovieManager::Frame()
+{
+	ovrTextureLoader & loader = *Cinema.app->GetTextureLoader();
+	for ( int i = 0; i < PosterLoads.GetSizeI(); )
+	{
+		const PosterLoad & load = PosterLoads[ i ];
+		const ovrAsyncTextureState state = loader.GetState( load.Request );
+		if ( state == ASYNC_TEXTURE_PENDING )
+		{
+			i++;
+			continue;
+		}
+		if ( state == ASYNC_TEXTURE_READY )
+		{
+			// the mips were built when the poster was decoded
+			GlTexture poster = loader.GetTexture( load.Request );
+			MakeTextureTrilinear( poster );
+			MakeTextureClamped( poster );
+			load.Movie->Poster = poster.texture;
+			load.Movie->PosterWidth = poster.Width;
+			load.Movie->PosterHeight = poster.Height;
+		}
+		loader.FreeRequest( load.Request );
+		PosterLoads.RemoveAt( i );
+	}
 }
 
 void MovieManager::LoadMovies()
@@ -227,40 +275,34 @@ void MovieManager::ReadMetaData( MovieDef *movie )
 
 void MovieManager::LoadPoster( MovieDef *movie )
 {
+	movie->Poster = DefaultPoster.texture;
+	movie->PosterWidth = DefaultPoster.Width;
+	movie->PosterHeight = DefaultPoster.Height;
+
 	String posterFilename = movie->Filename;
 	posterFilename.StripExtension();
 	posterFilename.AppendString( ".png" );
 
-	movie->Poster = LoadTextureFromBuffer( posterFilename.ToCStr(), MemBufferFile( posterFilename.ToCStr() ),
-			TextureFlags_t( TEXTUREFLAG_NO_DEFAULT ), movie->PosterWidth, movie->PosterHeight );
-
-	if ( movie->Poster == 0 && Cinema.IsExternalSDCardDir( posterFilename.ToCStr() ) )
+	if ( !FileExists( posterFilename.ToCStr() ) && Cinema.IsExternalSDCardDir( posterFilename.ToCStr() ) )
 	{
-		posterFilename = Native::GetExternalCacheDirectory( Cinema.app ) + ExtractFile( posterFilename );
-
 		// check if we have the thumbnail in the cache
-		movie->Poster = LoadTextureFromBuffer( posterFilename.ToCStr(), MemBufferFile( posterFilename.ToCStr() ),
-				TextureFlags_t( TEXTUREFLAG_NO_DEFAULT ), movie->PosterWidth, movie->PosterHeight );
-
-
-	}
-	// no thumbnail found, so create it.  if it's on an external sdcard, posterFilename will contain the new filename at this point and will load it from the cache
-	if ( ( movie->Poster == 0 ) && Native::CreateVideoThumbnail( Cinema.app, movie->Filename.ToCStr(), posterFilename.ToCStr(), PosterWidth, PosterHeight ) )
-	{
-		movie->Poster = LoadTextureFromBuffer( posterFilename.ToCStr(), MemBufferFile( posterFilename.ToCStr() ),
-				TextureFlags_t( TEXTUREFLAG_NO_DEFAULT ), movie->PosterWidth, movie->PosterHeight );
+		posterFilename = Native::GetExternalCacheDirectory( Cinema.app ) + ExtractFile( posterFilename );
 	}
 
-	// if all else failed, then just use the default poster
-	if ( movie->Poster == 0 )
+	// no thumbnail found, so create it.  if it's on an external sdcard, posterFilename will contain the new filename at this point and will load it from the cache
+	if ( !FileExists( posterFilename.ToCStr() ) &&
+		!Native::CreateVideoThumbnail( Cinema.app, movie->Filename.ToCStr(), posterFilename.ToCStr(), PosterWidth, PosterHeight ) )
 	{
-		movie->Poster = LoadTextureFromApplicationPackage( "assets/default_poster.png",
-				TextureFlags_t( TEXTUREFLAG_NO_DEFAULT ), movie->PosterWidth, movie->PosterHeight );
+		// if all else failed, then just use the default poster
+		return;
 	}
 
-	BuildTextureMipmaps( GlTexture( movie->Poster, movie->PosterWidth, movie->PosterHeight ) );
-	MakeTextureTrilinear( GlTexture( movie->Poster, movie->PosterWidth, movie->PosterHeight ) );
-	MakeTextureClamped( GlTexture( movie->Poster, movie->PosterWidth, movie->PosterHeight ) );
+	// decoded on the texture loader's workers, a poster that fails to load keeps the default
+	PosterLoad load;
+	load.Movie = movie;
+	load.Request = Cinema.app->GetTextureLoader()->LoadTextureFromFile( posterFilename.ToCStr(),
+			TextureFlags_t( TEXTUREFLAG_NO_DEFAULT ) );
+	PosterLoads.PushBack( load );
 }
 
 bool MovieManager::IsSupportedMovieFormat( const String &extension ) const
@@ -19,6 +19,7 @@ of patent rights can be found in the PATENTS file in the same directory.
 #include "Kernel/OVR_String.h"
 #include "Kernel/OVR_Array.h"
 #include "GlTexture.h"
+#include "OVR_TextureLoader.h"
 
 namespace OculusCinema {
 
@@ -75,6 +76,9 @@ public:
 	void					OneTimeInit( const char * launchIntent );
 	void					OneTimeShutdown();
 
+	// Swaps in the posters that finished loading. Until then a movie shows the default poster.
+	void					Frame();
+
 	Array<const MovieDef *>	GetMovieList( MovieCategory category ) const;
 
 	static const String 	GetMovieTitleFromFilename( const char *filepath );
@@ -88,7 +92,15 @@ public:
     static const char *		SupportedFormats[];
 
 private:
+	struct PosterLoad
+	{
+		MovieDef *				Movie;
+		asyncTextureHandle_t	Request;
+	};
+
 	CinemaApp &				Cinema;
+	GlTexture				DefaultPoster;
+	Array<PosterLoad>		PosterLoads;
 
 	MovieManager &			operator=( const MovieManager & );
 
@@ -28,6 +28,7 @@ bool MoviePosterComponent::ShowShadows = true;
 MoviePosterComponent::MoviePosterComponent() :
 	CarouselItemComponent( VRMenuEventFlags_t() ),
 	Movie( NULL ),
+	Texture( 0 ),
     Poster( NULL ),
 	PosterImage( NULL ),
     Is3DIcon( NULL ),
@@ -60,6 +61,7 @@ void MoviePosterComponent::SetMenuObjects( const int width, const int height, UI
     Shadow = shadow;
 
     Movie = NULL;
+    Texture = 0;
     Is3DIcon->SetVisible( false );
 	Shadow->SetVisible( false );
 	PosterImage->SetVisible( false );
@@ -78,7 +80,9 @@ void MoviePosterComponent::SetItem( VRMenuObject * self, const CarouselItem * it
 	Is3DIcon->SetColor( pose.Color );
 	Shadow->SetColor( pose.Color );
 
-	if ( movie != Movie )
+	// the poster texture changes once it has loaded
+	const GLuint texture = ( item == NULL ) ? 0 : item->Texture;
+	if ( movie != Movie || texture != Texture )
 	{
 		if ( movie != NULL )
 		{
@@ -96,6 +100,7 @@ void MoviePosterComponent::SetItem( VRMenuObject * self, const CarouselItem * it
 			PosterImage->SetVisible( false );
 		}
 		Movie = movie;
+		Texture = texture;
 	}
 }
 
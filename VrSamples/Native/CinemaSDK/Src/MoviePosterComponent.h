@@ -43,6 +43,7 @@ private:
                                     VRMenuObject * self, VRMenuEvent const & event );
 
     const MovieDef *	 	Movie;
+    GLuint					Texture;
 
     int						Width;
     int						Height;
@@ -840,6 +840,25 @@ bool MovieSelectionView::ErrorShown() const
 
 void MovieSelectionView::Frame( const ovrFrameInput & vrFrame )
 {
+	// posters keep loading after the movie list is built
+	bool postersChanged = false;
+	for ( int i = 0; i < MovieBrowserItems.GetSizeI(); i++ )
+	{
+		CarouselItem * item = MovieBrowserItems[ i ];
+		const MovieDef * movie = ( const MovieDef * )item->UserData;
+		if ( item->Texture != movie->Poster )
+		{
+			item->Texture 		= movie->Poster;
+			item->TextureWidth 	= movie->PosterWidth;
+			item->TextureHeight	= movie->PosterHeight;
+			postersChanged = true;
+		}
+	}
+	if ( postersChanged )
+	{
+		MovieBrowser->RefreshItems();
+	}
+
 	// We want 4x MSAA in the lobby
 	ovrEyeBufferParms eyeBufferParms = Cinema.app->GetEyeBufferParms();
 	eyeBufferParms.multisamples = 4;